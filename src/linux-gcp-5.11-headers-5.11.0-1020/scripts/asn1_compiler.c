@@ -554,6 +554,60 @@ static void parse(void);
 static void dump_elements(void);
 static void render(FILE *out, FILE *hdr);
 
+/*
+ * Write a generated file, but leave it untouched if it already has the
+ * right contents so that the objects built from it are not recompiled.
+ * A changed file is written under a temporary name and renamed into
+ * place so that an interrupted build never leaves it truncated.
+ */
+static void write_if_changed(const char *name, const char *buf, size_t len)
+{
+	struct stat st;
+	char *old, *tmpname;
+	FILE *f;
+	int fd;
+
+	fd = open(name, O_RDONLY);
+	if (fd >= 0) {
+		if (fstat(fd, &st) == 0 && st.st_size == len) {
+			old = malloc(len + 1);
+			if (old && read(fd, old, len) == len &&
+			    memcmp(old, buf, len) == 0) {
+				verbose("%s unchanged\n", name);
+				free(old);
+				close(fd);
+				return;
+			}
+			free(old);
+		}
+		close(fd);
+	}
+
+	tmpname = malloc(strlen(name) + 5);
+	if (!tmpname) {
+		perror(NULL);
+		exit(1);
+	}
+	sprintf(tmpname, "%s.tmp", name);
+
+	f = fopen(tmpname, "w");
+	if (!f) {
+		perror(tmpname);
+		exit(1);
+	}
+	if (fwrite(buf, 1, len, f) != len || fclose(f) < 0) {
+		perror(tmpname);
+		unlink(tmpname);
+		exit(1);
+	}
+	if (rename(tmpname, name) < 0) {
+		perror(name);
+		unlink(tmpname);
+		exit(1);
+	}
+	free(tmpname);
+}
+
 /*
  *
  */
@@ -562,6 +616,8 @@ int main(int argc, char **argv)
 	struct stat st;
 	ssize_t readlen;
 	FILE *out, *hdr;
+	char *out_buf, *hdr_buf;
+	size_t out_len, hdr_len;
 	char *buffer, *p;
 	char *kbuild_verbose;
 	int fd;
@@ -639,13 +695,13 @@ int main(int argc, char **argv)
 	parse();
 	dump_elements();
 
-	out = fopen(outputname, "w");
+	out = open_memstream(&out_buf, &out_len);
 	if (!out) {
 		perror(outputname);
 		exit(1);
 	}
 
-	hdr = fopen(headername, "w");
+	hdr = open_memstream(&hdr_buf, &hdr_len);
 	if (!hdr) {
 		perror(headername);
 		exit(1);
@@ -663,6 +719,8 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	write_if_changed(outputname, out_buf, out_len);
+	write_if_changed(headername, hdr_buf, hdr_len);
 	return 0;
 }
 
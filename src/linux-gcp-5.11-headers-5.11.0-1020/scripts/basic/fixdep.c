@@ -87,24 +87,58 @@
  *
  * (Note: it'd be easy to port over the complete mkdep state machine,
  *  but I don't think the added complexity is worth it)
+ *
+ * Most of fixdep's time goes into grepping the same few thousand headers
+ * over and over, once for every object.  For big parallel builds it can
+ * instead be run as a server,
+ *
+ *   fixdep --server <socket>
+ *
+ * which remembers the CONFIG_ words of each header it has scanned (until
+ * the header changes) and exits after a minute without requests.  When
+ * KBUILD_FIXDEP_SERVER names its socket in the environment, fixdep hands
+ * its work to the server and prints the reply; if the server cannot be
+ * reached or fails, fixdep does the work itself as usual.
  */
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <setjmp.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
 
+/* The server exits after this long without a request */
+#define SERVER_IDLE_MS	(60 * 1000)
+
 static void usage(void)
 {
 	fprintf(stderr, "Usage: fixdep <depfile> <target> <cmdline>\n");
+	fprintf(stderr, "       fixdep --server <socket>\n");
 	exit(1);
 }
 
+/* Where the dependency snippet goes: stdout, or a reply in server mode */
+static FILE *out;
+
+/* Set while the server handles a request, which an error must only abort */
+static jmp_buf *request_failed;
+
+static void die(int status)
+{
+	if (request_failed)
+		longjmp(*request_failed, status);
+	exit(status);
+}
+
 /*
  * In the intended usage of this program, the stdout is redirected to .*.cmd
  * files. The return value of printf() and putchar() must be checked to catch
@@ -116,33 +150,33 @@ static void xprintf(const char *format, ...)
 	int ret;
 
 	va_start(ap, format);
-	ret = vprintf(format, ap);
+	ret = vfprintf(out, format, ap);
 	if (ret < 0) {
 		perror("fixdep");
-		exit(1);
+		die(1);
 	}
 	va_end(ap);
 }
 
-static void xputchar(int c)
-{
-	int ret;
-
-	ret = putchar(c);
-	if (ret == EOF) {
-		perror("fixdep");
-		exit(1);
-	}
-}
-
 /*
  * Print out a dependency path from a symbol name
  */
 static void print_dep(const char *m, int slen, const char *dir)
 {
-	int c, prev_c = '/', i;
+	static char *path;
+	static int path_size;
+	int c, prev_c = '/', i, len = 0;
+
+	/* Build the path first, rather than print it character by character */
+	if (slen > path_size) {
+		path_size = slen;
+		path = realloc(path, path_size);
+		if (!path) {
+			perror("fixdep:realloc");
+			die(1);
+		}
+	}
 
-	xprintf("    $(wildcard %s/", dir);
 	for (i = 0; i < slen; i++) {
 		c = m[i];
 		if (c == '_')
@@ -150,10 +184,10 @@ static void print_dep(const char *m, int slen, const char *dir)
 		else
 			c = tolower(c);
 		if (c != '/' || prev_c != '/')
-			xputchar(c);
+			path[len++] = c;
 		prev_c = c;
 	}
-	xprintf(".h) \\\n");
+	xprintf("    $(wildcard %s/%.*s.h) \\\n", dir, len, path);
 }
 
 struct item {
@@ -163,7 +197,11 @@ struct item {
 	char		name[];
 };
 
-#define HASHSZ 256
+/*
+ * Objects that pull in a lot of headers use a few thousand distinct CONFIG_
+ * symbols, so keep enough buckets for the chains to stay short.
+ */
+#define HASHSZ 4096
 static struct item *hashtab[HASHSZ];
 
 static unsigned int strhash(const char *str, unsigned int sz)
@@ -200,7 +238,7 @@ static void define_config(const char *name, int len, unsigned int hash)
 
 	if (!aux) {
 		perror("fixdep:malloc");
-		exit(1);
+		die(1);
 	}
 	memcpy(aux->name, name, len);
 	aux->len = len;
@@ -209,6 +247,23 @@ static void define_config(const char *name, int len, unsigned int hash)
 	hashtab[hash % HASHSZ] = aux;
 }
 
+/*
+ * Forget the CONFIG_* words recorded for the previous object.
+ */
+static void clear_config(void)
+{
+	struct item *aux, *next;
+	int i;
+
+	for (i = 0; i < HASHSZ; i++) {
+		for (aux = hashtab[i]; aux; aux = next) {
+			next = aux->next;
+			free(aux);
+		}
+		hashtab[i] = NULL;
+	}
+}
+
 /*
  * Record the use of a CONFIG_* word.
  */
@@ -234,7 +289,8 @@ static int str_ends_with(const char *s, int slen, const char *sub)
 	return !memcmp(s + slen - sublen, sub, sublen);
 }
 
-static void parse_config_file(const char *p)
+static void parse_config_file(const char *p,
+			      void (*use)(const char *m, int slen))
 {
 	const char *q, *r;
 	const char *start = p;
@@ -253,12 +309,17 @@ static void parse_config_file(const char *p)
 		else
 			r = q;
 		if (r > p)
-			use_config(p, r - p);
+			use(p, r - p);
 		p = q;
 	}
 }
 
-static void *read_file(const char *filename)
+/*
+ * Read a whole file into *bufp, NUL-terminated, growing the buffer (whose
+ * size is kept in *sizep) as needed, so that it can be reused for each of the
+ * many headers an object depends on.
+ */
+static char *read_file(const char *filename, char **bufp, size_t *sizep)
 {
 	struct stat st;
 	int fd;
@@ -268,21 +329,29 @@ static void *read_file(const char *filename)
 	if (fd < 0) {
 		fprintf(stderr, "fixdep: error opening file: ");
 		perror(filename);
-		exit(2);
+		die(2);
 	}
 	if (fstat(fd, &st) < 0) {
 		fprintf(stderr, "fixdep: error fstat'ing file: ");
 		perror(filename);
-		exit(2);
+		close(fd);
+		die(2);
 	}
-	buf = malloc(st.st_size + 1);
-	if (!buf) {
-		perror("fixdep: malloc");
-		exit(2);
+	if ((size_t)st.st_size + 1 > *sizep) {
+		free(*bufp);
+		*sizep = st.st_size + 1;
+		*bufp = malloc(*sizep);
+		if (!*bufp) {
+			perror("fixdep: malloc");
+			close(fd);
+			die(2);
+		}
 	}
+	buf = *bufp;
 	if (read(fd, buf, st.st_size) != st.st_size) {
 		perror("fixdep: read");
-		exit(2);
+		close(fd);
+		die(2);
 	}
 	buf[st.st_size] = '\0';
 	close(fd);
@@ -290,6 +359,119 @@ static void *read_file(const char *filename)
 	return buf;
 }
 
+/* A header's CONFIG_ words, kept by the server for as long as it is unchanged */
+struct scan {
+	struct scan	*next;
+	dev_t		dev;
+	ino_t		ino;
+	off_t		size;
+	struct timespec	mtime;
+	struct timespec	ctime;
+	char		*words;		/* each NUL-terminated, then an empty one */
+	size_t		len;
+};
+
+static struct scan *scantab[HASHSZ];
+static int server;
+
+/* The scan being filled in by parse_config_file() */
+static struct scan *scanning;
+static size_t scanning_size;
+
+static void record_config(const char *m, int slen)
+{
+	struct scan *scan = scanning;
+
+	if (scan->len + slen + 2 > scanning_size) {
+		scanning_size = (scan->len + slen + 2) * 2;
+		scan->words = realloc(scan->words, scanning_size);
+		if (!scan->words) {
+			perror("fixdep:realloc");
+			die(1);
+		}
+	}
+	memcpy(scan->words + scan->len, m, slen);
+	scan->len += slen;
+	scan->words[scan->len++] = '\0';
+}
+
+static int same_time(const struct timespec *a, const struct timespec *b)
+{
+	return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+/*
+ * Find the CONFIG_ words of a header, scanning it only if it is new or
+ * has changed since the last time.  The stat is taken before reading, so
+ * a header that changes under us is scanned again next time.
+ */
+static struct scan *scan_file(const char *filename, char **bufp, size_t *sizep)
+{
+	struct stat st;
+	struct scan *scan;
+	unsigned int hash;
+
+	if (stat(filename, &st) < 0) {
+		fprintf(stderr, "fixdep: error opening file: ");
+		perror(filename);
+		die(2);
+	}
+
+	hash = strhash((const char *)&st.st_ino, sizeof(st.st_ino)) % HASHSZ;
+	for (scan = scantab[hash]; scan; scan = scan->next)
+		if (scan->ino == st.st_ino && scan->dev == st.st_dev)
+			break;
+
+	if (scan && scan->size == st.st_size &&
+	    same_time(&scan->mtime, &st.st_mtim) &&
+	    same_time(&scan->ctime, &st.st_ctim))
+		return scan;
+
+	if (!scan) {
+		scan = calloc(1, sizeof(*scan));
+		if (!scan) {
+			perror("fixdep:malloc");
+			die(1);
+		}
+		scan->dev = st.st_dev;
+		scan->ino = st.st_ino;
+		scan->next = scantab[hash];
+		scantab[hash] = scan;
+	}
+
+	/* Invalid until the scan below completes */
+	scan->size = -1;
+	scan->len = 0;
+	scanning = scan;
+	scanning_size = 0;
+	free(scan->words);
+	scan->words = NULL;
+	parse_config_file(read_file(filename, bufp, sizep), record_config);
+	record_config("", 0);
+
+	scan->size = st.st_size;
+	scan->mtime = st.st_mtim;
+	scan->ctime = st.st_ctim;
+	return scan;
+}
+
+/* Record the CONFIG_ words used in a prerequisite */
+static void use_file(const char *filename, char **bufp, size_t *sizep)
+{
+	struct scan *scan;
+	const char *w;
+	int len;
+
+	if (!server) {
+		parse_config_file(read_file(filename, bufp, sizep), use_config);
+		return;
+	}
+
+	scan = scan_file(filename, bufp, sizep);
+	for (w = scan->words; (len = strlen(w)); w += len + 1)
+		use_config(w, len);
+}
+
 /* Ignore certain dependencies */
 static int is_ignored_file(const char *s, int len)
 {
@@ -304,11 +486,13 @@ static int is_ignored_file(const char *s, int len)
  */
 static void parse_dep_file(char *m, const char *target)
 {
+	/* Kept across calls by the server, where an error skips the end */
+	static char *buf;
+	static size_t buf_size;
 	char *p;
 	int is_last, is_target;
 	int saw_any_target = 0;
 	int is_first_dep = 0;
-	void *buf;
 
 	while (1) {
 		/* Skip any "white space" */
@@ -358,9 +542,7 @@ static void parse_dep_file(char *m, const char *target)
 				xprintf("  %s \\\n", m);
 			}
 
-			buf = read_file(m);
-			parse_config_file(buf);
-			free(buf);
+			use_file(m, &buf, &buf_size);
 		}
 
 		if (is_last)
@@ -375,17 +557,215 @@ static void parse_dep_file(char *m, const char *target)
 
 	if (!saw_any_target) {
 		fprintf(stderr, "fixdep: parse error; no targets found\n");
-		exit(1);
+		die(1);
 	}
 
 	xprintf("\n%s: $(deps_%s)\n\n", target, target);
 	xprintf("$(deps_%s):\n", target);
 }
 
+static void fixdep(const char *depfile, const char *target,
+		   const char *cmdline)
+{
+	static char *buf;
+	static size_t buf_size;
+
+	xprintf("cmd_%s := %s\n\n", target, cmdline);
+
+	parse_dep_file(read_file(depfile, &buf, &buf_size), target);
+}
+
+/*
+ * A request is the client's working directory, depfile, target and
+ * command line, each NUL-terminated.  The reply is a status byte, then
+ * (if it is 0) what fixdep would have printed.
+ */
+static int read_all(int fd, char **bufp, size_t *lenp)
+{
+	size_t size = 4096, len = 0;
+	char *buf = malloc(size);
+	ssize_t r;
+
+	while (buf) {
+		if (len == size) {
+			char *tmp = realloc(buf, size *= 2);
+
+			if (!tmp)
+				break;
+			buf = tmp;
+		}
+		r = read(fd, buf + len, size - len);
+		if (r == 0) {
+			*bufp = buf;
+			*lenp = len;
+			return 0;
+		}
+		if (r < 0)
+			break;
+		len += r;
+	}
+	free(buf);
+	return -1;
+}
+
+static int send_all(int fd, const char *buf, size_t len)
+{
+	ssize_t r;
+
+	/* A peer that went away must not kill us with SIGPIPE */
+	while (len) {
+		r = send(fd, buf, len, MSG_NOSIGNAL);
+		if (r <= 0)
+			return -1;
+		buf += r;
+		len -= r;
+	}
+	return 0;
+}
+
+static void handle_request(int conn)
+{
+	const char *args[4];
+	char *req, *reply = NULL, *p;
+	size_t req_len, reply_len = 0;
+	char status = 1;
+	jmp_buf failed;
+	int i;
+
+	if (read_all(conn, &req, &req_len) < 0)
+		return;
+
+	for (i = 0, p = req; i < 4; i++) {
+		char *end = memchr(p, '\0', req + req_len - p);
+
+		if (!end)
+			goto out;
+		args[i] = p;
+		p = end + 1;
+	}
+	if (chdir(args[0]) < 0)
+		goto out;
+
+	out = open_memstream(&reply, &reply_len);
+	if (!out)
+		goto out;
+
+	clear_config();
+	request_failed = &failed;
+	if (!setjmp(failed)) {
+		fixdep(args[1], args[2], args[3]);
+		status = 0;
+	}
+	request_failed = NULL;
+	if (fclose(out) != 0)
+		status = 1;
+	out = NULL;
+
+out:
+	if (send_all(conn, &status, 1) == 0 && status == 0)
+		send_all(conn, reply, reply_len);
+	free(reply);
+	free(req);
+}
+
+static int serve(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	struct pollfd pfd;
+	int fd, conn, home;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "fixdep: socket path too long: %s\n", path);
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("fixdep: socket");
+		return 1;
+	}
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(fd, 128) < 0) {
+		perror(path);
+		return 1;
+	}
+
+	/* Requests chdir to the client's directory; come back to unlink */
+	home = open(".", O_RDONLY | O_DIRECTORY);
+	if (home < 0) {
+		perror("fixdep: open .");
+		return 1;
+	}
+
+	server = 1;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (poll(&pfd, 1, SERVER_IDLE_MS) != 0) {
+		conn = accept(fd, NULL, NULL);
+		if (conn < 0)
+			continue;
+		handle_request(conn);
+		close(conn);
+	}
+
+	if (fchdir(home) == 0)
+		unlink(path);
+	close(fd);
+	return 0;
+}
+
+/*
+ * Have the server at KBUILD_FIXDEP_SERVER do the work.  Nothing is printed
+ * unless the whole reply arrived, so that the caller can fall back to
+ * doing it locally on any failure.
+ */
+static int ask_server(const char *path, const char *depfile,
+		      const char *target, const char *cmdline)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	const char *args[4] = { NULL, depfile, target, cmdline };
+	char cwd[PATH_MAX], *reply = NULL;
+	size_t reply_len;
+	int fd, i, ret = -1;
+
+	if (strlen(path) >= sizeof(addr.sun_path) || !getcwd(cwd, sizeof(cwd)))
+		return -1;
+	strcpy(addr.sun_path, path);
+	args[0] = cwd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		goto out;
+
+	for (i = 0; i < 4; i++)
+		if (send_all(fd, args[i], strlen(args[i]) + 1) < 0)
+			goto out;
+	if (shutdown(fd, SHUT_WR) < 0 ||
+	    read_all(fd, &reply, &reply_len) < 0 ||
+	    reply_len < 1 || reply[0] != 0)
+		goto out;
+
+	if (fwrite(reply + 1, 1, reply_len - 1, out) != reply_len - 1) {
+		perror("fixdep");
+		exit(1);
+	}
+	ret = 0;
+out:
+	free(reply);
+	close(fd);
+	return ret;
+}
+
 int main(int argc, char *argv[])
 {
-	const char *depfile, *target, *cmdline;
-	void *buf;
+	const char *depfile, *target, *cmdline, *server_path;
+
+	if (argc == 3 && !strcmp(argv[1], "--server"))
+		return serve(argv[2]);
 
 	if (argc != 4)
 		usage();
@@ -394,11 +774,16 @@ int main(int argc, char *argv[])
 	target = argv[2];
 	cmdline = argv[3];
 
-	xprintf("cmd_%s := %s\n\n", target, cmdline);
+	out = stdout;
+	/* A dependency list easily runs to tens of KiB; cut down on writes */
+	setvbuf(stdout, NULL, _IOFBF, 64 * 1024);
 
-	buf = read_file(depfile);
-	parse_dep_file(buf, target);
-	free(buf);
+	server_path = getenv("KBUILD_FIXDEP_SERVER");
+	if (server_path && *server_path &&
+	    ask_server(server_path, depfile, target, cmdline) == 0)
+		return 0;
+
+	fixdep(depfile, target, cmdline);
 
 	return 0;
 }
@@ -538,7 +538,7 @@ static void check_explicit_phandles(struct check *c, struct dt_info *dti,
 		return;
 	}
 
-	node->phandle = phandle;
+	set_node_phandle(node, phandle);
 }
 ERROR(explicit_phandles, check_explicit_phandles, NULL);
 
@@ -20,6 +20,9 @@
 
 #include "util.h"
 
+/* Number of entries in the lookup cache shared by all queries */
+#define CACHE_SIZE	1024
+
 enum display_mode {
 	MODE_SHOW_VALUE,	/* show values for node properties */
 	MODE_LIST_PROPS,	/* list the properties for a node */
@@ -184,13 +187,14 @@ static int list_subnodes(const void *blob, int node)
  * display option provided.
  *
  * @param blob		FDT blob
+ * @param cache		Lookup cache for blob
  * @param disp		Display information / options
  * @param node		Node to display
  * @param property	Name of property to display, or NULL if none
  * @return 0 if ok, -ve on error
  */
-static int show_data_for_item(const void *blob, struct display_info *disp,
-		int node, const char *property)
+static int show_data_for_item(const void *blob, struct fdt_cache *cache,
+		struct display_info *disp, int node, const char *property)
 {
 	const void *value = NULL;
 	int len, err = 0;
@@ -206,7 +210,7 @@ static int show_data_for_item(const void *blob, struct display_info *disp,
 
 	default:
 		assert(property);
-		value = fdt_getprop(blob, node, property, &len);
+		value = fdt_getprop_cached(blob, cache, node, property, &len);
 		if (value) {
 			if (show_data(disp, value, len))
 				err = -1;
@@ -236,6 +240,8 @@ static int show_data_for_item(const void *blob, struct display_info *disp,
 static int do_fdtget(struct display_info *disp, const char *filename,
 		     char **arg, int arg_count, int args_per_step)
 {
+	static struct fdt_cache_entry cache_entries[CACHE_SIZE];
+	struct fdt_cache cache;
 	char *blob;
 	const char *prop;
 	int i, node;
@@ -243,9 +249,10 @@ static int do_fdtget(struct display_info *disp, const char *filename,
 	blob = utilfdt_read(filename);
 	if (!blob)
 		return -1;
+	fdt_cache_init(&cache, cache_entries, CACHE_SIZE);
 
 	for (i = 0; i + args_per_step <= arg_count; i += args_per_step) {
-		node = fdt_path_offset(blob, arg[i]);
+		node = fdt_path_offset_cached(blob, &cache, arg[i]);
 		if (node < 0) {
 			if (disp->default_val) {
 				puts(disp->default_val);
@@ -257,7 +264,7 @@ static int do_fdtget(struct display_info *disp, const char *filename,
 		}
 		prop = args_per_step == 1 ? NULL : arg[i + 1];
 
-		if (show_data_for_item(blob, disp, node, prop))
+		if (show_data_for_item(blob, &cache, disp, node, prop))
 			return -1;
 	}
 	return 0;
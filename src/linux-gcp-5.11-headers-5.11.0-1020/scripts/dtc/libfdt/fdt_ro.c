@@ -539,6 +539,218 @@ const char *fdt_get_alias(const void *fdt, const char *name)
 	return fdt_get_alias_namelen(fdt, name, strlen(name));
 }
 
+int fdt_cache_init(struct fdt_cache *cache, struct fdt_cache_entry *entries,
+		   int size)
+{
+	if ((size <= 0) || (size & (size - 1)))
+		return -FDT_ERR_BADVALUE;
+
+	cache->entries = entries;
+	cache->size = size;
+	fdt_cache_invalidate(cache);
+	return 0;
+}
+
+void fdt_cache_invalidate(struct fdt_cache *cache)
+{
+	int i;
+
+	cache->fdt = NULL;
+	for (i = 0; i < cache->size; i++)
+		cache->entries[i].key = -1;
+}
+
+static uint32_t fdt_cache_hash_(int key, const char *name, int namelen)
+{
+	uint32_t hash = 2166136261U;
+	int i;
+
+	hash = (hash ^ (uint32_t)key) * 16777619U;
+	for (i = 0; i < namelen; i++)
+		hash = (hash ^ (unsigned char)name[i]) * 16777619U;
+	return hash;
+}
+
+/*
+ * Return the entry for hash, first emptying the cache if it was
+ * filled from another tree or before the last structural change.
+ */
+static struct fdt_cache_entry *fdt_cache_slot_(const void *fdt,
+					       struct fdt_cache *cache,
+					       uint32_t hash)
+{
+	if ((cache->fdt != fdt) || (cache->generation != fdt_generation_)) {
+		fdt_cache_invalidate(cache);
+		cache->fdt = fdt;
+		cache->generation = fdt_generation_;
+	}
+
+	return &cache->entries[hash & (cache->size - 1)];
+}
+
+static void fdt_cache_fill_(struct fdt_cache_entry *e, int key, int offset,
+			    int namelen, uint32_t hash)
+{
+	e->key = key;
+	e->offset = offset;
+	e->namelen = namelen;
+	e->hash = hash;
+}
+
+int fdt_subnode_offset_cached(const void *fdt, struct fdt_cache *cache,
+			      int parentoffset, const char *name, int namelen)
+{
+	uint32_t hash = fdt_cache_hash_(2 * parentoffset, name, namelen);
+	struct fdt_cache_entry *e = fdt_cache_slot_(fdt, cache, hash);
+	int offset;
+
+	/*
+	 * Within one generation only the write-in-place functions can
+	 * have touched the tree, and those can only have replaced the
+	 * node with FDT_NOP tags, which fdt_nodename_eq_() rejects.
+	 */
+	if ((e->key >= 0) && (e->key == parentoffset) && (e->hash == hash)
+	    && (e->namelen == namelen)
+	    && fdt_nodename_eq_(fdt, e->offset, name, namelen))
+		return e->offset;
+
+	offset = fdt_subnode_offset_namelen(fdt, parentoffset, name, namelen);
+	if (offset >= 0)
+		fdt_cache_fill_(e, parentoffset, offset, namelen, hash);
+	return offset;
+}
+
+static const struct fdt_property *fdt_get_property_cached_(const void *fdt,
+							   struct fdt_cache *cache,
+							   int nodeoffset,
+							   const char *name,
+							   int namelen,
+							   int *lenp,
+							   int *poffset)
+{
+	uint32_t hash = fdt_cache_hash_(2 * nodeoffset + 1, name, namelen);
+	struct fdt_cache_entry *e = fdt_cache_slot_(fdt, cache, hash);
+	const struct fdt_property *prop;
+	int offset;
+
+	if ((e->key >= 0) && (e->key == nodeoffset) && (e->hash == hash)
+	    && (e->namelen == namelen)
+	    && (fdt_check_prop_offset_(fdt, e->offset) >= 0)) {
+		prop = fdt_get_property_by_offset_(fdt, e->offset, lenp);
+		if (prop && fdt_string_eq_(fdt, fdt32_ld(&prop->nameoff),
+					   name, namelen)) {
+			if (poffset)
+				*poffset = e->offset;
+			return prop;
+		}
+	}
+
+	prop = fdt_get_property_namelen_(fdt, nodeoffset, name, namelen, lenp,
+					 &offset);
+	if (prop) {
+		fdt_cache_fill_(e, nodeoffset, offset, namelen, hash);
+		if (poffset)
+			*poffset = offset;
+	}
+	return prop;
+}
+
+const struct fdt_property *fdt_get_property_cached(const void *fdt,
+						   struct fdt_cache *cache,
+						   int nodeoffset,
+						   const char *name, int *lenp)
+{
+	/* Prior to version 16, properties may need realignment
+	 * and this API does not work. fdt_getprop_*() will, however. */
+	if (!can_assume(LATEST) && fdt_version(fdt) < 0x10) {
+		if (lenp)
+			*lenp = -FDT_ERR_BADVERSION;
+		return NULL;
+	}
+
+	return fdt_get_property_cached_(fdt, cache, nodeoffset, name,
+					strlen(name), lenp, NULL);
+}
+
+static const void *fdt_getprop_cached_(const void *fdt,
+				       struct fdt_cache *cache,
+				       int nodeoffset, const char *name,
+				       int namelen, int *lenp)
+{
+	int poffset;
+	const struct fdt_property *prop;
+
+	prop = fdt_get_property_cached_(fdt, cache, nodeoffset, name, namelen,
+					lenp, &poffset);
+	if (!prop)
+		return NULL;
+
+	/* Handle realignment */
+	if (!can_assume(LATEST) && fdt_version(fdt) < 0x10 &&
+	    (poffset + sizeof(*prop)) % 8 && fdt32_ld(&prop->len) >= 8)
+		return prop->data + 4;
+	return prop->data;
+}
+
+const void *fdt_getprop_cached(const void *fdt, struct fdt_cache *cache,
+			       int nodeoffset, const char *name, int *lenp)
+{
+	return fdt_getprop_cached_(fdt, cache, nodeoffset, name, strlen(name),
+				   lenp);
+}
+
+int fdt_path_offset_cached(const void *fdt, struct fdt_cache *cache,
+			   const char *path)
+{
+	const char *end = path + strlen(path);
+	const char *p = path;
+	int offset = 0;
+
+	FDT_RO_PROBE(fdt);
+
+	/* see if we have an alias */
+	if (*path != '/') {
+		const char *q = memchr(path, '/', end - p);
+		int aliasoffset;
+
+		if (!q)
+			q = end;
+
+		aliasoffset = fdt_subnode_offset_cached(fdt, cache, 0,
+							"aliases", 7);
+		if (aliasoffset < 0)
+			return -FDT_ERR_BADPATH;
+		p = fdt_getprop_cached_(fdt, cache, aliasoffset, p, q - p,
+					NULL);
+		if (!p)
+			return -FDT_ERR_BADPATH;
+		offset = fdt_path_offset_cached(fdt, cache, p);
+
+		p = q;
+	}
+
+	while (p < end) {
+		const char *q;
+
+		while (*p == '/') {
+			p++;
+			if (p == end)
+				return offset;
+		}
+		q = memchr(p, '/', end - p);
+		if (! q)
+			q = end;
+
+		offset = fdt_subnode_offset_cached(fdt, cache, offset, p, q-p);
+		if (offset < 0)
+			return offset;
+
+		p = q;
+	}
+
+	return offset;
+}
+
 int fdt_get_path(const void *fdt, int nodeoffset, char *buf, int buflen)
 {
 	int pdepth = 0, p = 0;
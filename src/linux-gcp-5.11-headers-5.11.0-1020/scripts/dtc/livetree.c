@@ -6,6 +6,202 @@
 #include "dtc.h"
 #include "srcpos.h"
 
+/*
+ * Label and phandle index
+ *
+ * Looking a node up by label or phandle would otherwise walk the whole tree
+ * once per reference.  The index maps labels and phandles to the nodes of
+ * the tree it was built for.  Entries are checked when used, so deleting
+ * nodes or labels needs no update: a label that misses falls back to a walk.
+ * A phandle that is not in the index at all is taken to be unused, so nodes
+ * attached with add_child() are indexed as they come and phandles must be
+ * assigned with set_node_phandle().
+ */
+
+struct index_entry {
+	struct index_entry *next;
+	const char *label;	/* NULL for a phandle entry */
+	cell_t phandle;
+	struct node *node;
+};
+
+static struct node *index_root;
+static struct index_entry **index_table;
+static unsigned int index_size, index_count;
+
+static unsigned int index_hash(const char *label, cell_t phandle)
+{
+	unsigned int hash = 2166136261U;
+
+	if (!label)
+		return phandle * 2654435761U;
+
+	while (*label)
+		hash = (hash ^ (unsigned char)*label++) * 16777619U;
+	return hash;
+}
+
+static struct index_entry **index_slot(const char *label, cell_t phandle)
+{
+	struct index_entry **e;
+
+	e = &index_table[index_hash(label, phandle) & (index_size - 1)];
+	for (; *e; e = &(*e)->next)
+		if (label ? ((*e)->label && streq((*e)->label, label))
+			  : (!(*e)->label && (*e)->phandle == phandle))
+			break;
+	return e;
+}
+
+static struct index_entry *index_find(const char *label, cell_t phandle)
+{
+	if (!index_size)
+		return NULL;
+	return *index_slot(label, phandle);
+}
+
+static bool node_in_tree(struct node *tree, struct node *node)
+{
+	for (; node != tree; node = node->parent)
+		if (!node || node->deleted)
+			return false;
+	return true;
+}
+
+static bool index_entry_valid(struct index_entry *e)
+{
+	struct label *l;
+
+	if (!node_in_tree(index_root, e->node))
+		return false;
+
+	if (!e->label)
+		return e->node->phandle == e->phandle;
+
+	for_each_label(e->node->labels, l)
+		if (streq(l->label, e->label))
+			return true;
+	return false;
+}
+
+static void index_grow(void)
+{
+	struct index_entry **old_table = index_table, *e, *next;
+	unsigned int old_size = index_size, i;
+
+	index_size = old_size ? old_size * 2 : 256;
+	index_table = xmalloc(index_size * sizeof(*index_table));
+	memset(index_table, 0, index_size * sizeof(*index_table));
+
+	for (i = 0; i < old_size; i++)
+		for (e = old_table[i]; e; e = next) {
+			struct index_entry **slot;
+
+			next = e->next;
+			slot = &index_table[index_hash(e->label, e->phandle) &
+					    (index_size - 1)];
+			e->next = *slot;
+			*slot = e;
+		}
+	free(old_table);
+}
+
+/* Map @label (or @phandle) to @node, unless it maps to a live node already */
+static void index_add(const char *label, cell_t phandle, struct node *node)
+{
+	struct index_entry *e;
+
+	e = index_find(label, phandle);
+	if (e) {
+		if (!index_entry_valid(e))
+			e->node = node;
+		return;
+	}
+
+	if (index_count >= index_size)
+		index_grow();
+
+	e = xmalloc(sizeof(*e));
+	e->label = label;
+	e->phandle = phandle;
+	e->node = node;
+	e->next = index_table[index_hash(label, phandle) & (index_size - 1)];
+	index_table[index_hash(label, phandle) & (index_size - 1)] = e;
+	index_count++;
+}
+
+static void index_add_node(struct node *node)
+{
+	struct label *l;
+
+	for_each_label(node->labels, l)
+		index_add(l->label, 0, node);
+	if ((node->phandle != 0) && (node->phandle != -1))
+		index_add(NULL, node->phandle, node);
+}
+
+static void index_add_subtree(struct node *node)
+{
+	struct node *child;
+
+	if (node->deleted)
+		return;
+
+	index_add_node(node);
+	for_each_child(node, child)
+		index_add_subtree(child);
+}
+
+/* Drop any entries for @node, which is about to be freed */
+static void index_forget_node(struct node *node)
+{
+	struct index_entry **slot, *e;
+	struct label *l;
+
+	if (!index_size)
+		return;
+
+	for_each_label_withdel(node->labels, l) {
+		slot = index_slot(l->label, 0);
+		if (*slot && (*slot)->node == node) {
+			e = *slot;
+			*slot = e->next;
+			free(e);
+			index_count--;
+		}
+	}
+
+	slot = index_slot(NULL, node->phandle);
+	if (*slot && (*slot)->node == node) {
+		e = *slot;
+		*slot = e->next;
+		free(e);
+		index_count--;
+	}
+}
+
+/* (Re)build the index if it was built for a different tree */
+static void index_use(struct node *tree)
+{
+	struct index_entry *e, *next;
+	unsigned int i;
+
+	if (index_root == tree)
+		return;
+
+	for (i = 0; i < index_size; i++)
+		for (e = index_table[i]; e; e = next) {
+			next = e->next;
+			free(e);
+		}
+	free(index_table);
+	index_table = NULL;
+	index_size = index_count = 0;
+
+	index_root = tree;
+	index_add_subtree(tree);
+}
+
 /*
  * Tree building functions
  */
@@ -150,6 +346,8 @@ struct node *merge_nodes(struct node *old_node, struct node *new_node)
 	/* Add new node labels to old node */
 	for_each_label_withdel(new_node->labels, l)
 		add_label(&old_node->labels, l->label);
+	if (index_root)
+		index_add_node(old_node);
 
 	/* Move properties from the new node to the old node.  If there
 	 * is a collision, replace the old value with the new */
@@ -198,6 +396,7 @@ struct node *merge_nodes(struct node *old_node, struct node *new_node)
 
 		if (new_child->deleted) {
 			delete_node_by_name(old_node, new_child->name);
+			index_forget_node(new_child);
 			free(new_child);
 			continue;
 		}
@@ -220,6 +419,7 @@ struct node *merge_nodes(struct node *old_node, struct node *new_node)
 
 	/* The new node contents are now merged into the old node.  Free
 	 * the new node. */
+	index_forget_node(new_node);
 	free(new_node);
 
 	return old_node;
@@ -307,6 +507,9 @@ void add_child(struct node *parent, struct node *child)
 		p = &((*p)->next_sibling);
 
 	*p = child;
+
+	if (index_root)
+		index_add_subtree(child);
 }
 
 void delete_node_by_name(struct node *parent, char *name)
@@ -535,19 +738,17 @@ struct node *get_node_by_path(struct node *tree, const char *path)
 	return NULL;
 }
 
-struct node *get_node_by_label(struct node *tree, const char *label)
+static struct node *find_node_by_label(struct node *tree, const char *label)
 {
 	struct node *child, *node;
 	struct label *l;
 
-	assert(label && (strlen(label) > 0));
-
 	for_each_label(tree->labels, l)
 		if (streq(l->label, label))
 			return tree;
 
 	for_each_child(tree, child) {
-		node = get_node_by_label(child, label);
+		node = find_node_by_label(child, label);
 		if (node)
 			return node;
 	}
@@ -555,14 +756,27 @@ struct node *get_node_by_label(struct node *tree, const char *label)
 	return NULL;
 }
 
-struct node *get_node_by_phandle(struct node *tree, cell_t phandle)
+struct node *get_node_by_label(struct node *tree, const char *label)
 {
-	struct node *child, *node;
+	struct index_entry *e;
+	struct node *node;
 
-	if ((phandle == 0) || (phandle == -1)) {
-		assert(generate_fixups);
-		return NULL;
-	}
+	assert(label && (strlen(label) > 0));
+
+	index_use(tree);
+	e = index_find(label, 0);
+	if (e && index_entry_valid(e))
+		return e->node;
+
+	node = find_node_by_label(tree, label);
+	if (node)
+		index_add(label, 0, node);
+	return node;
+}
+
+static struct node *find_node_by_phandle(struct node *tree, cell_t phandle)
+{
+	struct node *child, *node;
 
 	if (tree->phandle == phandle) {
 		if (tree->deleted)
@@ -571,7 +785,7 @@ struct node *get_node_by_phandle(struct node *tree, cell_t phandle)
 	}
 
 	for_each_child(tree, child) {
-		node = get_node_by_phandle(child, phandle);
+		node = find_node_by_phandle(child, phandle);
 		if (node)
 			return node;
 	}
@@ -579,6 +793,36 @@ struct node *get_node_by_phandle(struct node *tree, cell_t phandle)
 	return NULL;
 }
 
+struct node *get_node_by_phandle(struct node *tree, cell_t phandle)
+{
+	struct index_entry *e;
+	struct node *node;
+
+	if ((phandle == 0) || (phandle == -1)) {
+		assert(generate_fixups);
+		return NULL;
+	}
+
+	index_use(tree);
+	e = index_find(NULL, phandle);
+	if (!e)
+		return NULL;
+	if (index_entry_valid(e))
+		return e->node;
+
+	node = find_node_by_phandle(tree, phandle);
+	if (node)
+		index_add(NULL, phandle, node);
+	return node;
+}
+
+void set_node_phandle(struct node *node, cell_t phandle)
+{
+	node->phandle = phandle;
+	if (index_root)
+		index_add(NULL, phandle, node);
+}
+
 struct node *get_node_by_ref(struct node *tree, const char *ref)
 {
 	if (streq(ref, "/"))
@@ -600,7 +844,7 @@ cell_t get_node_phandle(struct node *root, struct node *node)
 	while (get_node_by_phandle(root, phandle))
 		phandle++;
 
-	node->phandle = phandle;
+	set_node_phandle(node, phandle);
 
 	d = data_add_marker(d, TYPE_UINT32, NULL);
 	d = data_append_cell(d, phandle);
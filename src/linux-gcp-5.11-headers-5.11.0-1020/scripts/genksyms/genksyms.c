@@ -16,6 +16,7 @@
 #include <unistd.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <limits.h>
 #ifdef __GNU_LIBRARY__
 #include <getopt.h>
 #endif				/* __GNU_LIBRARY__ */
@@ -41,6 +42,38 @@ static int nsyms;
 static struct symbol *expansion_trail;
 static struct symbol *visited_symbols;
 
+/*
+ * Expanding a type yields the same bytes every time, unless one of the types
+ * it pulls in was already expanded for the current export, in which case
+ * that one is abbreviated to its name.  Expansions that did not depend on the
+ * rest of the export are remembered per type, as the CRC of the expansion
+ * started from a zero state, its length, and the symbols it put on the
+ * expansion trail.  Common types such as struct device are then folded into
+ * the CRC of later exports without being walked again.
+ */
+struct crc_memo_entry {
+	struct symbol *sym;		/* a symbol expanded in place, or */
+	struct crc_memo *memo;		/* a nested remembered expansion */
+};
+
+struct crc_memo {
+	unsigned long generation;
+	unsigned long crc;
+	unsigned long len;
+	int nentries;
+	struct crc_memo_entry entries[];
+};
+
+/* Bumped whenever a symbol is redefined, which invalidates all memos */
+static unsigned long symbol_generation;
+
+/* Per-export expansion state */
+static unsigned long expansion_len;
+static int expansion_count;
+static int expansion_min_hit;
+static struct crc_memo_entry *expansion_log;
+static int expansion_log_len, expansion_log_size;
+
 static const struct {
 	int n;
 	const char *name;
@@ -117,16 +150,100 @@ static const unsigned int crctab32[] = {
 	0x2d02ef8dU
 };
 
+/* Slice-by-8 tables; crctab32_slice[0] is crctab32 */
+static unsigned int crctab32_slice[8][256];
+
+/* crc32_zeros[k] appends 2^k zero bytes to a CRC */
+static unsigned int crc32_zeros[32][32];
+
+static unsigned int gf2_matrix_times(const unsigned int *mat, unsigned int vec)
+{
+	unsigned int sum = 0;
+
+	while (vec) {
+		if (vec & 1)
+			sum ^= *mat;
+		vec >>= 1;
+		mat++;
+	}
+	return sum;
+}
+
+static void gf2_matrix_square(unsigned int *square, const unsigned int *mat)
+{
+	int n;
+
+	for (n = 0; n < 32; n++)
+		square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+static void crc32_init(void)
+{
+	unsigned int op[32], tmp[32];
+	int i, k;
+
+	for (i = 0; i < 256; i++)
+		crctab32_slice[0][i] = crctab32[i];
+	for (k = 1; k < 8; k++)
+		for (i = 0; i < 256; i++) {
+			unsigned int c = crctab32_slice[k - 1][i];
+
+			crctab32_slice[k][i] = crctab32[c & 0xff] ^ (c >> 8);
+		}
+
+	/* Operator for a single zero bit, squared up to a whole byte */
+	op[0] = 0xedb88320U;
+	for (i = 1; i < 32; i++)
+		op[i] = 1U << (i - 1);
+	gf2_matrix_square(tmp, op);
+	gf2_matrix_square(op, tmp);
+	gf2_matrix_square(crc32_zeros[0], op);
+	for (k = 1; k < 32; k++)
+		gf2_matrix_square(crc32_zeros[k], crc32_zeros[k - 1]);
+}
+
+/* The CRC state after feeding @len zero bytes to @crc */
+static unsigned long crc32_shift(unsigned long crc, unsigned long len)
+{
+	int k;
+
+	for (k = 0; len && k < 32; k++, len >>= 1)
+		if (len & 1)
+			crc = gf2_matrix_times(crc32_zeros[k], crc);
+	return crc;
+}
+
 static unsigned long partial_crc32_one(unsigned char c, unsigned long crc)
 {
 	return crctab32[(crc ^ c) & 0xff] ^ (crc >> 8);
 }
 
+static unsigned long partial_crc32_len(const char *s, size_t len,
+				       unsigned long crc)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	unsigned int c = crc, hi;
+
+	for (; len >= 8; p += 8, len -= 8) {
+		c ^= p[0] | p[1] << 8 | p[2] << 16 | (unsigned int)p[3] << 24;
+		hi = p[4] | p[5] << 8 | p[6] << 16 | (unsigned int)p[7] << 24;
+		c = crctab32_slice[7][c & 0xff] ^
+		    crctab32_slice[6][(c >> 8) & 0xff] ^
+		    crctab32_slice[5][(c >> 16) & 0xff] ^
+		    crctab32_slice[4][c >> 24] ^
+		    crctab32_slice[3][hi & 0xff] ^
+		    crctab32_slice[2][(hi >> 8) & 0xff] ^
+		    crctab32_slice[1][(hi >> 16) & 0xff] ^
+		    crctab32_slice[0][hi >> 24];
+	}
+	while (len--)
+		c = partial_crc32_one(*p++, c);
+	return c;
+}
+
 static unsigned long partial_crc32(const char *s, unsigned long crc)
 {
-	while (*s)
-		crc = partial_crc32_one(*s++, crc);
-	return crc;
+	return partial_crc32_len(s, strlen(s), crc);
 }
 
 static unsigned long crc32(const char *s)
@@ -240,6 +357,8 @@ static struct symbol *__add_symbol(const char *name, enum symbol_type type,
 					fprintf(stderr, " modversion is "
 						"unchanged\n");
 				}
+				if (!sym->is_declared)
+					symbol_generation++;
 				sym->is_declared = 1;
 				return sym;
 			} else if (!sym->is_declared) {
@@ -248,6 +367,7 @@ static struct symbol *__add_symbol(const char *name, enum symbol_type type,
 					fprintf(stderr, "ignoring ");
 					print_type_name(type, name);
 					fprintf(stderr, " modversion change\n");
+					symbol_generation++;
 					sym->is_declared = 1;
 					return sym;
 				} else {
@@ -272,6 +392,7 @@ static struct symbol *__add_symbol(const char *name, enum symbol_type type,
 			}
 		}
 		--nsyms;
+		symbol_generation++;
 	}
 
 	sym = xmalloc(sizeof(*sym));
@@ -279,6 +400,8 @@ static struct symbol *__add_symbol(const char *name, enum symbol_type type,
 	sym->type = type;
 	sym->defn = defn;
 	sym->expansion_trail = NULL;
+	sym->expansion_index = 0;
+	sym->crc_memo = NULL;
 	sym->visited = NULL;
 	sym->is_extern = is_extern;
 
@@ -405,87 +528,143 @@ static int equal_list(struct string_list *a, struct string_list *b)
 
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
-static struct string_list *read_node(FILE *f)
+/*
+ * Reference files run to many megabytes and every token in them becomes a
+ * node that lives as long as the symbol table.  So the file is read in
+ * one go, tokens are terminated in place and used as the node strings,
+ * and the nodes are carved out of large blocks instead of being malloc'd
+ * one by one.  Such nodes must never be passed to free_node().
+ */
+#define REF_NODE_BLOCK	4096
+
+static struct string_list *alloc_ref_node(void)
 {
-	char buffer[256];
-	struct string_list node = {
-		.string = buffer,
-		.tag = SYM_NORMAL };
-	int c, in_string = 0;
+	static struct string_list *block;
+	static int left;
 
-	while ((c = fgetc(f)) != EOF) {
-		if (!in_string && c == ' ') {
-			if (node.string == buffer)
-				continue;
-			break;
-		} else if (c == '"') {
-			in_string = !in_string;
-		} else if (c == '\n') {
-			if (node.string == buffer)
-				return NULL;
-			ungetc(c, f);
-			break;
-		}
-		if (node.string >= buffer + sizeof(buffer) - 1) {
-			fprintf(stderr, "Token too long\n");
-			exit(1);
+	if (!left) {
+		block = xmalloc(REF_NODE_BLOCK * sizeof(*block));
+		left = REF_NODE_BLOCK;
+	}
+	left--;
+	return block++;
+}
+
+static char *read_whole_file(FILE *f)
+{
+	size_t size = 1 << 16, len = 0, n;
+	char *buf = xmalloc(size);
+
+	while ((n = fread(buf + len, 1, size - len - 1, f)) > 0) {
+		len += n;
+		if (size - len == 1) {
+			size *= 2;
+			buf = realloc(buf, size);
+			if (!buf) {
+				fprintf(stderr, "out of memory\n");
+				exit(1);
+			}
 		}
-		*node.string++ = c;
 	}
-	if (node.string == buffer)
+	if (ferror(f)) {
+		perror("reference file");
+		exit(1);
+	}
+	buf[len] = '\0';
+	return buf;
+}
+
+/* Take the next token from a NUL-terminated line, or NULL at its end */
+static struct string_list *read_node(char **pos)
+{
+	struct string_list *node;
+	char *p = *pos, *start;
+	int in_string = 0;
+
+	while (*p == ' ')
+		p++;
+	if (!*p) {
+		*pos = p;
 		return NULL;
-	*node.string = 0;
-	node.string = buffer;
+	}
 
-	if (node.string[1] == '#') {
+	for (start = p; *p; p++) {
+		if (!in_string && *p == ' ')
+			break;
+		else if (*p == '"')
+			in_string = !in_string;
+	}
+	if (p - start > 255) {
+		fprintf(stderr, "Token too long\n");
+		exit(1);
+	}
+	if (*p)
+		*p++ = '\0';
+	*pos = p;
+
+	node = alloc_ref_node();
+	node->string = start;
+	node->tag = SYM_NORMAL;
+	node->in_source_file = 0;
+	node->next = NULL;
+
+	if (start[1] == '#') {
 		size_t n;
 
 		for (n = 0; n < ARRAY_SIZE(symbol_types); n++) {
-			if (node.string[0] == symbol_types[n].n) {
-				node.tag = n;
-				node.string += 2;
-				return copy_node(&node);
+			if (start[0] == symbol_types[n].n) {
+				node->tag = n;
+				node->string += 2;
+				return node;
 			}
 		}
-		fprintf(stderr, "Unknown type %c\n", node.string[0]);
+		fprintf(stderr, "Unknown type %c\n", start[0]);
 		exit(1);
 	}
-	return copy_node(&node);
+	return node;
 }
 
 static void read_reference(FILE *f)
 {
-	while (!feof(f)) {
+	char *line, *next = read_whole_file(f);
+
+	while (*next) {
 		struct string_list *defn = NULL;
 		struct string_list *sym, *def;
 		int is_extern = 0, is_override = 0;
 		struct symbol *subsym;
+		char *pos;
 
-		sym = read_node(f);
+		line = next;
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		else
+			next = line + strlen(line);
+		pos = line;
+
+		sym = read_node(&pos);
 		if (sym && sym->tag == SYM_NORMAL &&
 		    !strcmp(sym->string, "override")) {
 			is_override = 1;
-			free_node(sym);
-			sym = read_node(f);
+			sym = read_node(&pos);
 		}
 		if (!sym)
 			continue;
-		def = read_node(f);
+		def = read_node(&pos);
 		if (def && def->tag == SYM_NORMAL &&
 		    !strcmp(def->string, "extern")) {
 			is_extern = 1;
-			free_node(def);
-			def = read_node(f);
+			def = read_node(&pos);
 		}
 		while (def) {
 			def->next = defn;
 			defn = def;
-			def = read_node(f);
+			def = read_node(&pos);
 		}
-		subsym = add_reference_symbol(xstrdup(sym->string), sym->tag,
+		subsym = add_reference_symbol(sym->string, sym->tag,
 					      defn, is_extern);
 		subsym->is_override = is_override;
-		free_node(sym);
 	}
 }
 
@@ -527,6 +706,24 @@ static void print_list(FILE * f, struct string_list *list)
 	}
 }
 
+static unsigned long expand_subsym(struct symbol *sym, unsigned long crc);
+
+static unsigned long crc_token(const char *s, unsigned long crc)
+{
+	size_t len = strlen(s);
+
+	expansion_len += len + 1;
+	crc = partial_crc32_len(s, len, crc);
+	return partial_crc32_one(' ', crc);
+}
+
+/* Note that @sym was abbreviated because it is already on the trail */
+static void expansion_hit(struct symbol *sym)
+{
+	if (sym->expansion_index < expansion_min_hit)
+		expansion_min_hit = sym->expansion_index;
+}
+
 static unsigned long expand_and_crc_sym(struct symbol *sym, unsigned long crc)
 {
 	struct string_list *list = sym->defn;
@@ -558,8 +755,7 @@ static unsigned long expand_and_crc_sym(struct symbol *sym, unsigned long crc)
 		case SYM_NORMAL:
 			if (flag_dump_defs)
 				fprintf(debugfile, "%s ", cur->string);
-			crc = partial_crc32(cur->string, crc);
-			crc = partial_crc32_one(' ', crc);
+			crc = crc_token(cur->string, crc);
 			break;
 
 		case SYM_ENUM_CONST:
@@ -569,12 +765,10 @@ static unsigned long expand_and_crc_sym(struct symbol *sym, unsigned long crc)
 			if (subsym->expansion_trail) {
 				if (flag_dump_defs)
 					fprintf(debugfile, "%s ", cur->string);
-				crc = partial_crc32(cur->string, crc);
-				crc = partial_crc32_one(' ', crc);
+				crc = crc_token(cur->string, crc);
+				expansion_hit(subsym);
 			} else {
-				subsym->expansion_trail = expansion_trail;
-				expansion_trail = subsym;
-				crc = expand_and_crc_sym(subsym, crc);
+				crc = expand_subsym(subsym, crc);
 			}
 			break;
 
@@ -604,15 +798,12 @@ static unsigned long expand_and_crc_sym(struct symbol *sym, unsigned long crc)
 						cur->string);
 				}
 
-				crc = partial_crc32(symbol_types[cur->tag].name,
-						    crc);
-				crc = partial_crc32_one(' ', crc);
-				crc = partial_crc32(cur->string, crc);
-				crc = partial_crc32_one(' ', crc);
+				crc = crc_token(symbol_types[cur->tag].name,
+						crc);
+				crc = crc_token(cur->string, crc);
+				expansion_hit(subsym);
 			} else {
-				subsym->expansion_trail = expansion_trail;
-				expansion_trail = subsym;
-				crc = expand_and_crc_sym(subsym, crc);
+				crc = expand_subsym(subsym, crc);
 			}
 			break;
 		}
@@ -631,6 +822,106 @@ static unsigned long expand_and_crc_sym(struct symbol *sym, unsigned long crc)
 	return crc;
 }
 
+static void expansion_log_add(struct symbol *sym, struct crc_memo *memo)
+{
+	if (expansion_log_len == expansion_log_size) {
+		expansion_log_size = expansion_log_size ?
+				     expansion_log_size * 2 : 256;
+		expansion_log = realloc(expansion_log, expansion_log_size *
+					sizeof(*expansion_log));
+		if (!expansion_log) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	expansion_log[expansion_log_len].sym = sym;
+	expansion_log[expansion_log_len].memo = memo;
+	expansion_log_len++;
+}
+
+static void expansion_push(struct symbol *sym)
+{
+	sym->expansion_trail = expansion_trail;
+	expansion_trail = sym;
+	sym->expansion_index = expansion_count++;
+}
+
+/* Put the symbols of a remembered expansion on the trail */
+static int crc_memo_replay(const struct crc_memo *memo)
+{
+	int i;
+
+	for (i = 0; i < memo->nentries; i++) {
+		const struct crc_memo_entry *e = &memo->entries[i];
+
+		if (!e->sym) {
+			if (!crc_memo_replay(e->memo))
+				return 0;
+		} else if (e->sym->expansion_trail) {
+			/* Already expanded, so the result would differ */
+			return 0;
+		} else {
+			expansion_push(e->sym);
+		}
+	}
+	return 1;
+}
+
+static unsigned long expand_subsym(struct symbol *sym, unsigned long crc)
+{
+	struct crc_memo *memo = sym->crc_memo;
+	unsigned long generation = symbol_generation;
+	unsigned long start_crc = crc, start_len = expansion_len;
+	int start_log = expansion_log_len;
+	int outer_min_hit = expansion_min_hit;
+
+	if (memo && memo->generation == generation) {
+		struct symbol *head = expansion_trail;
+		int count = expansion_count;
+
+		if (crc_memo_replay(memo)) {
+			expansion_log_add(NULL, memo);
+			expansion_len += memo->len;
+			return crc32_shift(crc, memo->len) ^ memo->crc;
+		}
+
+		while (expansion_trail != head) {
+			struct symbol *n = expansion_trail->expansion_trail;
+
+			expansion_trail->expansion_trail = NULL;
+			expansion_trail = n;
+		}
+		expansion_count = count;
+	}
+
+	expansion_push(sym);
+	expansion_log_add(sym, NULL);
+	expansion_min_hit = INT_MAX;
+	crc = expand_and_crc_sym(sym, crc);
+
+	if (expansion_min_hit >= sym->expansion_index &&
+	    generation == symbol_generation && !flag_dump_defs) {
+		int n = expansion_log_len - start_log;
+
+		memo = xmalloc(sizeof(*memo) + n * sizeof(memo->entries[0]));
+		memo->generation = generation;
+		memo->len = expansion_len - start_len;
+		memo->crc = crc ^ crc32_shift(start_crc, memo->len);
+		memo->nentries = n;
+		memcpy(memo->entries, &expansion_log[start_log],
+		       n * sizeof(memo->entries[0]));
+		free(sym->crc_memo);
+		sym->crc_memo = memo;
+
+		expansion_log_len = start_log;
+		expansion_log_add(NULL, memo);
+	}
+
+	if (outer_min_hit < expansion_min_hit)
+		expansion_min_hit = outer_min_hit;
+	return crc;
+}
+
 void export_symbol(const char *name)
 {
 	struct symbol *sym;
@@ -646,10 +937,12 @@ void export_symbol(const char *name)
 			fprintf(debugfile, "Export %s == <", name);
 
 		expansion_trail = (struct symbol *)-1L;
+		expansion_len = 0;
+		expansion_count = 0;
+		expansion_min_hit = INT_MAX;
+		expansion_log_len = 0;
 
-		sym->expansion_trail = expansion_trail;
-		expansion_trail = sym;
-		crc = expand_and_crc_sym(sym, 0xffffffff) ^ 0xffffffff;
+		crc = expand_subsym(sym, 0xffffffff) ^ 0xffffffff;
 
 		sym = expansion_trail;
 		while (sym != (struct symbol *)-1L) {
@@ -831,6 +1124,8 @@ int main(int argc, char **argv)
 		/* setlinebuf(debugfile); */
 	}
 
+	crc32_init();
+
 	if (flag_reference) {
 		read_reference(ref_file);
 		fclose(ref_file);
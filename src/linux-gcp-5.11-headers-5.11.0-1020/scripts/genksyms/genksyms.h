@@ -36,6 +36,8 @@ struct symbol {
 	enum symbol_type type;
 	struct string_list *defn;
 	struct symbol *expansion_trail;
+	int expansion_index;
+	struct crc_memo *crc_memo;
 	struct symbol *visited;
 	int is_extern;
 	int is_declared;
@@ -355,7 +355,7 @@ int conf_read_simple(const char *name, int def)
 	size_t  line_asize = 0;
 	char *p, *p2;
 	struct symbol *sym;
-	int i, def_flags;
+	int i, def_flags, valid_flags = 0;
 
 	if (name) {
 		in = zconf_fopen(name);
@@ -393,9 +393,16 @@ load:
 	conf_warnings = 0;
 
 	def_flags = SYMBOL_DEF << def;
+	/*
+	 * Only user values feed into sym_calc_value(), so loading another set
+	 * (e.g. auto.conf into S_DEF_AUTO) keeps the calculated values valid
+	 * and spares conf_write_autoconf() a full recalculation.
+	 */
+	if (def == S_DEF_USER)
+		valid_flags = SYMBOL_VALID;
 	for_all_symbols(i, sym) {
 		sym->flags |= SYMBOL_CHANGED;
-		sym->flags &= ~(def_flags|SYMBOL_VALID);
+		sym->flags &= ~(def_flags|valid_flags);
 		if (sym_is_choice(sym))
 			sym->flags |= def_flags;
 		switch (sym->type) {
@@ -431,8 +438,10 @@ load:
 				}
 			} else {
 				sym = sym_lookup(line + 2 + strlen(CONFIG_), 0);
-				if (sym->type == S_UNKNOWN)
+				if (sym->type == S_UNKNOWN) {
 					sym->type = S_BOOLEAN;
+					sym->flags &= ~SYMBOL_VALID;
+				}
 			}
 			if (sym->flags & def_flags) {
 				conf_warning("override: reassigning to symbol %s", sym->name);
@@ -155,6 +155,9 @@ struct elf_info {
 	 * take shndx from symtab_shndx_start[N] instead */
 	Elf32_Word   *symtab_shndx_start;
 	Elf32_Word   *symtab_shndx_stop;
+
+	/* Address index of the symbol table, built on first use */
+	struct symsearch *symsearch;
 };
 
 static inline int is_shndx_special(unsigned int i)
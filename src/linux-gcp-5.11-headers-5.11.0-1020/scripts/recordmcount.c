@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #ifndef EM_AARCH64
 #define EM_AARCH64	183
@@ -44,19 +45,23 @@
 
 #define R_AARCH64_CALL26	283
 
-static int fd_map;	/* File descriptor for file being modified. */
-static int mmap_failed; /* Boolean flag. */
-static char gpfx;	/* prefix for global symbol name (sometimes '_') */
-static struct stat sb;	/* Remember .st_size, etc. */
-static const char *altmcount;	/* alternate mcount symbol name */
+/*
+ * State for the file being processed.  It is thread-local so that, with -j,
+ * each worker thread can process a different file.
+ */
+static __thread int fd_map;	/* File descriptor for file being modified. */
+static __thread int mmap_failed; /* Boolean flag. */
+static __thread char gpfx;	/* prefix for global symbol name (sometimes '_') */
+static __thread struct stat sb;	/* Remember .st_size, etc. */
+static __thread const char *altmcount;	/* alternate mcount symbol name */
 static int warn_on_notrace_sect; /* warn when section has mcount not being recorded */
-static void *file_map;	/* pointer of the mapped file */
-static void *file_end;	/* pointer to the end of the mapped file */
-static int file_updated; /* flag to state file was changed */
-static void *file_ptr;	/* current file pointer location */
+static __thread void *file_map;	/* pointer of the mapped file */
+static __thread void *file_end;	/* pointer to the end of the mapped file */
+static __thread int file_updated; /* flag to state file was changed */
+static __thread void *file_ptr;	/* current file pointer location */
 
-static void *file_append; /* added to the end of the file */
-static size_t file_append_size; /* how much is added to end of file */
+static __thread void *file_append; /* added to the end of the file */
+static __thread size_t file_append_size; /* how much is added to end of file */
 
 /* Per-file resource cleanup when multiple files. */
 static void file_append_cleanup(void)
@@ -213,11 +218,11 @@ out:
 
 static unsigned char ideal_nop5_x86_64[5] = { 0x0f, 0x1f, 0x44, 0x00, 0x00 };
 static unsigned char ideal_nop5_x86_32[5] = { 0x3e, 0x8d, 0x74, 0x26, 0x00 };
-static unsigned char *ideal_nop;
+static __thread unsigned char *ideal_nop;
 
-static char rel_type_nop;
+static __thread char rel_type_nop;
 
-static int (*make_nop)(void *map, size_t const offset);
+static __thread int (*make_nop)(void *map, size_t const offset);
 
 static int make_nop_x86(void *map, size_t const offset)
 {
@@ -243,23 +248,23 @@ static int make_nop_x86(void *map, size_t const offset)
 
 static unsigned char ideal_nop4_arm_le[4] = { 0x00, 0x00, 0xa0, 0xe1 }; /* mov r0, r0 */
 static unsigned char ideal_nop4_arm_be[4] = { 0xe1, 0xa0, 0x00, 0x00 }; /* mov r0, r0 */
-static unsigned char *ideal_nop4_arm;
+static __thread unsigned char *ideal_nop4_arm;
 
 static unsigned char bl_mcount_arm_le[4] = { 0xfe, 0xff, 0xff, 0xeb }; /* bl */
 static unsigned char bl_mcount_arm_be[4] = { 0xeb, 0xff, 0xff, 0xfe }; /* bl */
-static unsigned char *bl_mcount_arm;
+static __thread unsigned char *bl_mcount_arm;
 
 static unsigned char push_arm_le[4] = { 0x04, 0xe0, 0x2d, 0xe5 }; /* push {lr} */
 static unsigned char push_arm_be[4] = { 0xe5, 0x2d, 0xe0, 0x04 }; /* push {lr} */
-static unsigned char *push_arm;
+static __thread unsigned char *push_arm;
 
 static unsigned char ideal_nop2_thumb_le[2] = { 0x00, 0xbf }; /* nop */
 static unsigned char ideal_nop2_thumb_be[2] = { 0xbf, 0x00 }; /* nop */
-static unsigned char *ideal_nop2_thumb;
+static __thread unsigned char *ideal_nop2_thumb;
 
 static unsigned char push_bl_mcount_thumb_le[6] = { 0x00, 0xb5, 0xff, 0xf7, 0xfe, 0xff }; /* push {lr}, bl */
 static unsigned char push_bl_mcount_thumb_be[6] = { 0xb5, 0x00, 0xf7, 0xff, 0xff, 0xfe }; /* push {lr}, bl */
-static unsigned char *push_bl_mcount_thumb;
+static __thread unsigned char *push_bl_mcount_thumb;
 
 static int make_nop_arm(void *map, size_t const offset)
 {
@@ -399,9 +404,9 @@ static uint32_t w2nat(uint16_t const x)
 	return x;
 }
 
-static uint64_t (*w8)(uint64_t);
-static uint32_t (*w)(uint32_t);
-static uint32_t (*w2)(uint16_t);
+static __thread uint64_t (*w8)(uint64_t);
+static __thread uint32_t (*w)(uint32_t);
+static __thread uint32_t (*w2)(uint16_t);
 
 /* Names of the sections that could contain calls to mcount. */
 static int is_mcounted_section_name(char const *const txtname)
@@ -623,49 +628,93 @@ out:
 	return rc;
 }
 
-int main(int argc, char *argv[])
+static int process_file(char *file)
 {
 	const char ftrace[] = "/ftrace.o";
 	int ftrace_size = sizeof(ftrace) - 1;
-	int n_error = 0;  /* gcc-4.3.0 false positive complaint */
+	int len;
+
+	/*
+	 * The file kernel/trace/ftrace.o references the mcount
+	 * function but does not call it. Since ftrace.o should
+	 * not be traced anyway, we just skip it.
+	 */
+	len = strlen(file);
+	if (len >= ftrace_size &&
+	    strcmp(file + (len - ftrace_size), ftrace) == 0)
+		return 0;
+
+	if (do_file(file)) {
+		fprintf(stderr, "%s: failed\n", file);
+		return 1;
+	}
+	return 0;
+}
+
+/* Files shared out between the worker threads for -j */
+static char **work_files;
+static int work_count, work_next, work_errors;
+
+static void *process_worker(void *arg)
+{
+	int i;
+
+	while ((i = __sync_fetch_and_add(&work_next, 1)) < work_count)
+		if (process_file(work_files[i]))
+			__sync_fetch_and_add(&work_errors, 1);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t *threads;
+	long jobs = 1;
 	int c;
 	int i;
 
-	while ((c = getopt(argc, argv, "w")) >= 0) {
+	while ((c = getopt(argc, argv, "wj:")) >= 0) {
 		switch (c) {
 		case 'w':
 			warn_on_notrace_sect = 1;
 			break;
+		case 'j':
+			jobs = atoi(optarg);
+			if (jobs <= 0)
+				jobs = sysconf(_SC_NPROCESSORS_ONLN);
+			break;
 		default:
-			fprintf(stderr, "usage: recordmcount [-w] file.o...\n");
+			fprintf(stderr, "usage: recordmcount [-w] [-j jobs] file.o...\n");
 			return 0;
 		}
 	}
 
 	if ((argc - optind) < 1) {
-		fprintf(stderr, "usage: recordmcount [-w] file.o...\n");
+		fprintf(stderr, "usage: recordmcount [-w] [-j jobs] file.o...\n");
 		return 0;
 	}
 
-	/* Process each file in turn, allowing deep failure. */
-	for (i = optind; i < argc; i++) {
-		char *file = argv[i];
-		int len;
-
-		/*
-		 * The file kernel/trace/ftrace.o references the mcount
-		 * function but does not call it. Since ftrace.o should
-		 * not be traced anyway, we just skip it.
-		 */
-		len = strlen(file);
-		if (len >= ftrace_size &&
-		    strcmp(file + (len - ftrace_size), ftrace) == 0)
-			continue;
-
-		if (do_file(file)) {
-			fprintf(stderr, "%s: failed\n", file);
-			++n_error;
-		}
-	}
-	return !!n_error;
+	/* Process the files, allowing deep failure. */
+	work_files = argv + optind;
+	work_count = argc - optind;
+	if (jobs > work_count)
+		jobs = work_count;
+
+	threads = calloc(jobs, sizeof(*threads));
+	if (!threads)
+		jobs = 1;
+
+	/* The main thread is a worker too; carry on with fewer if need be */
+	for (i = 1; i < jobs; i++)
+		if (pthread_create(&threads[i], NULL, process_worker, NULL))
+			break;
+	jobs = i;
+
+	process_worker(NULL);
+
+	for (i = 1; i < jobs; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	return !!work_errors;
 }
@@ -21,6 +21,8 @@
 #include <string.h>
 #include <getopt.h>
 #include <err.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <openssl/opensslv.h>
 #include <openssl/bio.h>
@@ -73,6 +75,8 @@ void format(void)
 		"Usage: scripts/sign-file [-dp] <hash algo> <key> <x509> <module> [<dest>]\n");
 	fprintf(stderr,
 		"       scripts/sign-file -s <raw sig> <hash algo> <x509> <module> [<dest>]\n");
+	fprintf(stderr,
+		"       scripts/sign-file -b [-dp] <hash algo> <key> <x509> <module>...\n");
 	exit(2);
 }
 
@@ -206,103 +210,49 @@ static X509 *read_x509(const char *x509_name)
 	return x509;
 }
 
-int main(int argc, char **argv)
+/*
+ * Signing state shared by all modules of a run.  It is set up once in main()
+ * and only read afterwards, so batch workers can share it.
+ */
+static bool save_sig, sign_only, raw_sig;
+static char *raw_sig_name;
+static unsigned int use_signed_attrs;
+#ifndef USE_PKCS7
+static unsigned int use_keyid;
+#endif
+static const EVP_MD *digest_algo;
+static EVP_PKEY *private_key;
+static X509 *x509;
+
+/*
+ * Sign @module_name, writing the result to @dest_name, or in place if
+ * @dest_name is NULL.
+ */
+static void sign_module(const char *module_name, const char *dest_name)
 {
 	struct module_signature sig_info = { .id_type = PKEY_ID_PKCS7 };
-	char *hash_algo = NULL;
-	char *private_key_name = NULL, *raw_sig_name = NULL;
-	char *x509_name, *module_name, *dest_name;
-	bool save_sig = false, replace_orig;
-	bool sign_only = false;
-	bool raw_sig = false;
+	char *tmp_name = NULL;
 	unsigned char buf[4096];
 	unsigned long module_size, sig_size;
-	unsigned int use_signed_attrs;
-	const EVP_MD *digest_algo;
-	EVP_PKEY *private_key;
 #ifndef USE_PKCS7
 	CMS_ContentInfo *cms = NULL;
-	unsigned int use_keyid = 0;
 #else
 	PKCS7 *pkcs7 = NULL;
 #endif
-	X509 *x509;
 	BIO *bd, *bm;
-	int opt, n;
-	OpenSSL_add_all_algorithms();
-	ERR_load_crypto_strings();
-	ERR_clear_error();
-
-	key_pass = getenv("KBUILD_SIGN_PIN");
-
-#ifndef USE_PKCS7
-	use_signed_attrs = CMS_NOATTR;
-#else
-	use_signed_attrs = PKCS7_NOATTR;
-#endif
-
-	do {
-		opt = getopt(argc, argv, "sdpk");
-		switch (opt) {
-		case 's': raw_sig = true; break;
-		case 'p': save_sig = true; break;
-		case 'd': sign_only = true; save_sig = true; break;
-#ifndef USE_PKCS7
-		case 'k': use_keyid = CMS_USE_KEYID; break;
-#endif
-		case -1: break;
-		default: format();
-		}
-	} while (opt != -1);
-
-	argc -= optind;
-	argv += optind;
-	if (argc < 4 || argc > 5)
-		format();
+	int n;
 
-	if (raw_sig) {
-		raw_sig_name = argv[0];
-		hash_algo = argv[1];
-	} else {
-		hash_algo = argv[0];
-		private_key_name = argv[1];
-	}
-	x509_name = argv[2];
-	module_name = argv[3];
-	if (argc == 5 && strcmp(argv[3], argv[4]) != 0) {
-		dest_name = argv[4];
-		replace_orig = false;
-	} else {
-		ERR(asprintf(&dest_name, "%s.~signed~", module_name) < 0,
+	if (!dest_name) {
+		ERR(asprintf(&tmp_name, "%s.~signed~", module_name) < 0,
 		    "asprintf");
-		replace_orig = true;
-	}
-
-#ifdef USE_PKCS7
-	if (strcmp(hash_algo, "sha1") != 0) {
-		fprintf(stderr, "sign-file: %s only supports SHA1 signing\n",
-			OPENSSL_VERSION_TEXT);
-		exit(3);
+		dest_name = tmp_name;
 	}
-#endif
 
 	/* Open the module file */
 	bm = BIO_new_file(module_name, "rb");
 	ERR(!bm, "%s", module_name);
 
 	if (!raw_sig) {
-		/* Read the private key and the X.509 cert the PKCS#7 message
-		 * will point to.
-		 */
-		private_key = read_private_key(private_key_name);
-		x509 = read_x509(x509_name);
-
-		/* Digest the module data. */
-		OpenSSL_add_all_digests();
-		display_openssl_errors(__LINE__);
-		digest_algo = EVP_get_digestbyname(hash_algo);
-		ERR(!digest_algo, "EVP_get_digestbyname");
-
 #ifndef USE_PKCS7
 		/* Load the signature message from the digest buffer. */
 		cms = CMS_sign(NULL, NULL, NULL, NULL,
@@ -341,11 +291,12 @@ int main(int argc, char **argv)
 			    "%s", sig_file_name);
 #endif
 			BIO_free(b);
+			free(sig_file_name);
 		}
 
 		if (sign_only) {
 			BIO_free(bm);
-			return 0;
+			goto out;
 		}
 	}
 
@@ -392,8 +343,155 @@ int main(int argc, char **argv)
 	ERR(BIO_free(bd) < 0, "%s", dest_name);
 
 	/* Finally, if we're signing in place, replace the original. */
-	if (replace_orig)
-		ERR(rename(dest_name, module_name) < 0, "%s", dest_name);
+	if (tmp_name)
+		ERR(rename(tmp_name, module_name) < 0, "%s", tmp_name);
+
+out:
+#ifndef USE_PKCS7
+	CMS_ContentInfo_free(cms);
+#else
+	PKCS7_free(pkcs7);
+#endif
+	free(tmp_name);
+}
+
+/*
+ * Batch mode: the modules named on the command line are signed in place by
+ * a pool of workers, each taking the next unsigned module from the list.
+ */
+static char **batch_modules;
+static int batch_count, batch_next;
+
+static void *sign_worker(void *arg)
+{
+	int i;
+
+	while ((i = __sync_fetch_and_add(&batch_next, 1)) < batch_count)
+		sign_module(batch_modules[i], NULL);
+
+	return NULL;
+}
+
+static void sign_batch(char **modules, int count, bool threaded)
+{
+	pthread_t *threads;
+	long nr_threads = 1;
+	int i;
+
+	batch_modules = modules;
+	batch_count = count;
+
+	if (threaded)
+		nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nr_threads > count)
+		nr_threads = count;
+	if (nr_threads < 1)
+		nr_threads = 1;
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	ERR(!threads, "calloc");
+
+	/* The main thread is a worker too; carry on with fewer if need be */
+	for (i = 1; i < nr_threads; i++)
+		if (pthread_create(&threads[i], NULL, sign_worker, NULL))
+			break;
+	nr_threads = i;
+
+	sign_worker(NULL);
+
+	for (i = 1; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+int main(int argc, char **argv)
+{
+	char *hash_algo = NULL;
+	char *private_key_name = NULL;
+	char *x509_name, *module_name, *dest_name = NULL;
+	bool batch = false, threaded;
+	int opt;
+	OpenSSL_add_all_algorithms();
+	ERR_load_crypto_strings();
+	ERR_clear_error();
+
+	key_pass = getenv("KBUILD_SIGN_PIN");
+
+#ifndef USE_PKCS7
+	use_signed_attrs = CMS_NOATTR;
+#else
+	use_signed_attrs = PKCS7_NOATTR;
+#endif
+
+	do {
+		opt = getopt(argc, argv, "sdpkb");
+		switch (opt) {
+		case 's': raw_sig = true; break;
+		case 'p': save_sig = true; break;
+		case 'd': sign_only = true; save_sig = true; break;
+#ifndef USE_PKCS7
+		case 'k': use_keyid = CMS_USE_KEYID; break;
+#endif
+		case 'b': batch = true; break;
+		case -1: break;
+		default: format();
+		}
+	} while (opt != -1);
+
+	argc -= optind;
+	argv += optind;
+	if (batch ? raw_sig || argc < 4 : argc < 4 || argc > 5)
+		format();
+
+	if (raw_sig) {
+		raw_sig_name = argv[0];
+		hash_algo = argv[1];
+	} else {
+		hash_algo = argv[0];
+		private_key_name = argv[1];
+	}
+	x509_name = argv[2];
+	module_name = argv[3];
+	if (!batch && argc == 5 && strcmp(argv[3], argv[4]) != 0)
+		dest_name = argv[4];
+
+#ifdef USE_PKCS7
+	if (strcmp(hash_algo, "sha1") != 0) {
+		fprintf(stderr, "sign-file: %s only supports SHA1 signing\n",
+			OPENSSL_VERSION_TEXT);
+		exit(3);
+	}
+#endif
+
+	if (!raw_sig) {
+		/* Read the private key and the X.509 cert the PKCS#7 message
+		 * will point to.
+		 */
+		private_key = read_private_key(private_key_name);
+		x509 = read_x509(x509_name);
+
+		/* Digest the module data. */
+		OpenSSL_add_all_digests();
+		display_openssl_errors(__LINE__);
+		digest_algo = EVP_get_digestbyname(hash_algo);
+		ERR(!digest_algo, "EVP_get_digestbyname");
+	}
+
+	if (!batch) {
+		sign_module(module_name, dest_name);
+		return 0;
+	}
+
+	/*
+	 * Keys are only shared between threads where OpenSSL does its own
+	 * locking; a PKCS#11 token gets one request at a time.
+	 */
+#if defined(USE_PKCS7) || OPENSSL_VERSION_NUMBER < 0x10100000L
+	threaded = false;
+#else
+	threaded = strncmp(private_key_name, "pkcs11:", 7) != 0;
+#endif
+	sign_batch(argv + 3, argc - 3, threaded);
 
 	return 0;
 }
@@ -96,32 +96,87 @@ struct orc_entry *g_orc_table;
 
 pthread_t orc_sort_thread;
 
-static inline unsigned long orc_ip(const int *ip)
+/*
+ * The ORC entries are sorted by address with an LSD radix sort on a 64-bit
+ * key, rather than with qsort() and a comparator chasing both tables.
+ *
+ * The key is the entry's address relative to the start of the ip table,
+ * biased to be non-negative (i * sizeof(int) < 2^34 and the stored offset is
+ * an int, so it fits in 40 bits), shifted left by one.  The low bit is clear
+ * for the "weak" section terminator entries: they need to always be on the
+ * left to ensure the lookup code skips them in favor of real entries.  These
+ * terminator entries exist to handle any gaps created by whitelisted .o files
+ * which didn't get objtool generation.
+ */
+#define ORC_KEY_BIAS	(1ULL << 40)
+#define ORC_KEY_BYTES	6
+
+struct orc_sort_item {
+	uint64_t key;
+	int idx;
+};
+
+static uint64_t orc_sort_key(int i)
 {
-	return (unsigned long)ip + *ip;
+	int64_t offset = (int64_t)i * sizeof(int) + g_orc_ip_table[i];
+	const struct orc_entry *orc = g_orc_table + i;
+	int weak = orc->sp_reg == ORC_REG_UNDEFINED && !orc->end;
+
+	return ((uint64_t)(offset + ORC_KEY_BIAS) << 1) | !weak;
 }
 
-static int orc_sort_cmp(const void *_a, const void *_b)
+/* Stable, so equal keys keep their original order */
+static int orc_radix_sort(int *idxs, unsigned int num_entries)
 {
-	struct orc_entry *orc_a;
-	const int *a = g_orc_ip_table + *(int *)_a;
-	const int *b = g_orc_ip_table + *(int *)_b;
-	unsigned long a_val = orc_ip(a);
-	unsigned long b_val = orc_ip(b);
-
-	if (a_val > b_val)
-		return 1;
-	if (a_val < b_val)
+	struct orc_sort_item *items, *tmp, *swap;
+	unsigned int count[256];
+	unsigned int i, b, pos;
+
+	items = malloc(num_entries * sizeof(*items));
+	tmp = malloc(num_entries * sizeof(*tmp));
+	if (!items || !tmp) {
+		free(items);
+		free(tmp);
 		return -1;
+	}
+
+	for (i = 0; i < num_entries; i++) {
+		items[i].key = orc_sort_key(i);
+		items[i].idx = i;
+	}
+
+	for (b = 0; b < ORC_KEY_BYTES; b++) {
+		unsigned int shift = b * 8;
 
-	/*
-	 * The "weak" section terminator entries need to always be on the left
-	 * to ensure the lookup code skips them in favor of real entries.
-	 * These terminator entries exist to handle any gaps created by
-	 * whitelisted .o files which didn't get objtool generation.
-	 */
-	orc_a = g_orc_table + (a - g_orc_ip_table);
-	return orc_a->sp_reg == ORC_REG_UNDEFINED && !orc_a->end ? -1 : 1;
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < num_entries; i++)
+			count[(items[i].key >> shift) & 0xff]++;
+
+		/* Nothing to do if every key has the same byte here */
+		if (num_entries && count[(items[0].key >> shift) & 0xff] ==
+				   num_entries)
+			continue;
+
+		for (i = 0, pos = 0; i < 256; i++) {
+			unsigned int n = count[i];
+
+			count[i] = pos;
+			pos += n;
+		}
+		for (i = 0; i < num_entries; i++)
+			tmp[count[(items[i].key >> shift) & 0xff]++] = items[i];
+
+		swap = items;
+		items = tmp;
+		tmp = swap;
+	}
+
+	for (i = 0; i < num_entries; i++)
+		idxs[i] = items[i].idx;
+
+	free(items);
+	free(tmp);
+	return 0;
 }
 
 static void *sort_orctable(void *arg)
@@ -162,7 +217,11 @@ static void *sort_orctable(void *arg)
 	}
 	memcpy(tmp_orc_table, g_orc_table, orc_size);
 
-	qsort(idxs, num_entries, sizeof(int), orc_sort_cmp);
+	if (orc_radix_sort(idxs, num_entries)) {
+		snprintf(g_err, ERRSTR_MAXSZ, "malloc orc sort buffers: %s",
+			 strerror(errno));
+		pthread_exit(g_err);
+	}
 
 	for (i = 0; i < num_entries; i++) {
 		if (idxs[i] == i)
@@ -146,6 +146,7 @@ static char const * const linestate_name[] = {
 #define	MAXDEPTH        64			/* maximum #if nesting */
 #define	MAXLINE         4096			/* maximum length of line */
 #define	MAXSYMS         4096			/* maximum number of symbols */
+#define	SYMHASHSIZE     1024			/* symbol hash buckets */
 
 /*
  * Sometimes when editing a keyword the replacement text is longer, so
@@ -170,6 +171,7 @@ static bool             iocccok;		/* -e: fewer IOCCC errors */
 static bool             strictlogic;		/* -K: keep ambiguous #ifs */
 static bool             killconsts;		/* -k: eval constant #ifs */
 static bool             lnnum;			/* -n: add #line directives */
+static bool             inplace;		/* -m: modify files in place */
 static bool             symlist;		/* -s: output symbol list */
 static bool             symdepth;		/* -S: output symbol depth */
 static bool             text;			/* -t: this is a text file */
@@ -178,6 +180,8 @@ static const char      *symname[MAXSYMS];	/* symbol name */
 static const char      *value[MAXSYMS];		/* -Dsym=value */
 static bool             ignore[MAXSYMS];	/* -iDsym or -iUsym */
 static int              nsyms;			/* number of symbols */
+static int              symhash[SYMHASHSIZE];	/* first symbol in bucket + 1 */
+static int              symnext[MAXSYMS];	/* next symbol in bucket + 1 */
 
 static FILE            *input;			/* input file pointer */
 static const char      *filename;		/* input file name */
@@ -223,11 +227,13 @@ static void             ignoreon(void);
 static void             keywordedit(const char *);
 static void             nest(void);
 static void             process(void);
+static void             processfile(const char *, const char *);
 static const char      *skipargs(const char *);
 static const char      *skipcomment(const char *);
 static const char      *skipsym(const char *);
 static void             state(Ifstate);
 static int              strlcmp(const char *, const char *, size_t);
+static unsigned         strhash(const char *, size_t);
 static void             unnest(void);
 static void             usage(void);
 static void             version(void);
@@ -242,7 +248,7 @@ main(int argc, char *argv[])
 {
 	int opt;
 
-	while ((opt = getopt(argc, argv, "i:D:U:I:o:bBcdeKklnsStV")) != -1)
+	while ((opt = getopt(argc, argv, "i:D:U:I:o:bBcdeKklmnsStV")) != -1)
 		switch (opt) {
 		case 'i': /* treat stuff controlled by these symbols as text */
 			/*
@@ -288,6 +294,9 @@ main(int argc, char *argv[])
 		case 'k': /* process constant #ifs */
 			killconsts = true;
 			break;
+		case 'm': /* modify each input file in place */
+			inplace = true;
+			break;
 		case 'n': /* add #line directive after deleted lines */
 			lnnum = true;
 			break;
@@ -312,10 +321,33 @@ main(int argc, char *argv[])
 	argv += optind;
 	if (compblank && lnblank)
 		errx(2, "-B and -b are mutually exclusive");
-	if (argc > 1) {
+	if (inplace) {
+		if (ofilename != NULL || symlist)
+			errx(2, "-m is incompatible with -o, -s and -S");
+		if (argc == 0)
+			errx(2, "-m needs at least one file");
+		for (; argc > 0; --argc, ++argv)
+			processfile(*argv, *argv);
+	} else if (argc > 1) {
 		errx(2, "can only do one file");
 	} else if (argc == 1 && strcmp(*argv, "-") != 0) {
-		filename = *argv;
+		processfile(*argv, ofilename);
+	} else {
+		processfile(NULL, ofilename);
+	}
+	exit(exitstat);
+}
+
+/*
+ * Open the input and output of one file, reset the per-file parser
+ * state, and run the state machine over it. A NULL name means the
+ * standard input or output.
+ */
+static void
+processfile(const char *iname, const char *oname)
+{
+	if (iname != NULL) {
+		filename = iname;
 		input = fopen(filename, "rb");
 		if (input == NULL)
 			err(2, "can't open %s", filename);
@@ -323,11 +355,13 @@ main(int argc, char *argv[])
 		filename = "[stdin]";
 		input = stdin;
 	}
-	if (ofilename == NULL) {
+	overwriting = false;
+	if (oname == NULL) {
 		ofilename = "[stdout]";
 		output = stdout;
 	} else {
 		struct stat ist, ost;
+		ofilename = oname;
 		if (stat(ofilename, &ost) == 0 &&
 		    fstat(fileno(input), &ist) == 0)
 			overwriting = (ist.st_dev == ost.st_dev
@@ -344,6 +378,7 @@ main(int argc, char *argv[])
 			else
 				snprintf(tempname, sizeof(tempname),
 				    TEMPLATE);
+			output = NULL;
 			ofd = mkstemp(tempname);
 			if (ofd != -1)
 				output = fdopen(ofd, "wb+");
@@ -356,8 +391,17 @@ main(int argc, char *argv[])
 				err(2, "can't open %s", ofilename);
 		}
 	}
+	linenum = 0;
+	newline = NULL;
+	incomment = NO_COMMENT;
+	linestate = LS_START;
+	depth = 0;
+	ifstate[0] = IS_OUTSIDE;
+	ignoring[0] = false;
+	delcount = 0;
 	process();
-	abort(); /* bug */
+	if (input != stdin)
+		fclose(input);
 }
 
 static void
@@ -378,7 +422,9 @@ static void
 usage(void)
 {
 	fprintf(stderr, "usage: unifdef [-bBcdeKknsStV] [-Ipath]"
-	    " [-Dsym[=val]] [-Usym] [-iDsym[=val]] [-iUsym] ... [file]\n");
+	    " [-Dsym[=val]] [-Usym] [-iDsym[=val]] [-iUsym] ... [file]\n"
+	    "       unifdef -m [-bBcdeKknt] [-Ipath]"
+	    " [-Dsym[=val]] [-Usym] [-iDsym[=val]] [-iUsym] ... file ...\n");
 	exit(2);
 }
 
@@ -592,6 +638,8 @@ process(void)
 		debug("process line %d %s -> %s depth %d",
 		    linenum, linetype_name[lineval],
 		    ifstate_name[ifstate[depth]], depth);
+		if (lineval == LT_EOF)
+			break;
 	}
 }
 
@@ -615,7 +663,7 @@ closeout(void)
 }
 
 /*
- * Clean up and exit.
+ * Clean up at the end of a file.
  */
 static void
 done(void)
@@ -628,7 +676,6 @@ done(void)
 		unlink(tempname);
 		errx(2, "%s unchanged", ofilename);
 	}
-	exit(exitstat);
 }
 
 /*
@@ -1137,7 +1184,8 @@ findsym(const char *str)
 		/* we don't care about the value of the symbol */
 		return (0);
 	}
-	for (symind = 0; symind < nsyms; ++symind) {
+	for (symind = symhash[strhash(str, cp-str)] - 1; symind >= 0;
+	    symind = symnext[symind] - 1) {
 		if (strlcmp(symname[symind], str, cp-str) == 0) {
 			debug("findsym %s %s", symname[symind],
 			    value[symind] ? value[symind] : "");
@@ -1158,9 +1206,13 @@ addsym(bool ignorethis, bool definethis, char *sym)
 
 	symind = findsym(sym);
 	if (symind < 0) {
+		unsigned h = strhash(sym, skipsym(sym) - sym);
+
 		if (nsyms >= MAXSYMS)
 			errx(2, "too many symbols");
 		symind = nsyms++;
+		symnext[symind] = symhash[h];
+		symhash[h] = symind + 1;
 	}
 	symname[symind] = sym;
 	ignore[symind] = ignorethis;
@@ -1197,6 +1249,19 @@ strlcmp(const char *s, const char *t, size_t n)
 	return ((unsigned char)*s);
 }
 
+/*
+ * Hash n characters of s into a symbol table bucket.
+ */
+static unsigned
+strhash(const char *s, size_t n)
+{
+	unsigned h = 0;
+
+	while (n--)
+		h = h * 31 + (unsigned char)*s++;
+	return (h % SYMHASHSIZE);
+}
+
 /*
  * Diagnostics.
  */
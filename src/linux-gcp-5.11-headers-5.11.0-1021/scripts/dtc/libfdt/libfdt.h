@@ -1141,6 +1141,118 @@ const char *fdt_stringlist_get(const void *fdt, int nodeoffset,
 			       const char *property, int index,
 			       int *lenp);
 
+/**********************************************************************/
+/* Cached lookup functions                                            */
+/**********************************************************************/
+
+/*
+ * A lookup cache remembers the results of subnode and property
+ * searches so that repeated path and property queries against the
+ * same tree do not rescan the structure block.  The cache and its
+ * entry array are owned by the caller; libfdt never allocates them.
+ * Every structural change made through the read-write functions
+ * invalidates all caches, and each cached result is re-checked
+ * against the tree before it is returned, so a cache never changes
+ * the result of a lookup, only its cost.
+ */
+struct fdt_cache_entry {
+	int key;	/* offset of the node searched, or -1 if unused */
+	int offset;	/* offset of the subnode or property found */
+	int namelen;	/* length of the name that was looked up */
+	uint32_t hash;	/* hash of the key and the name */
+};
+
+struct fdt_cache {
+	const void *fdt;		/* tree the entries describe */
+	uint32_t generation;		/* write generation of the entries */
+	struct fdt_cache_entry *entries;
+	int size;			/* number of entries, a power of two */
+};
+
+/**
+ * fdt_cache_init - prepare a lookup cache
+ * @cache: cache structure to initialize
+ * @entries: array of entries for the cache to use
+ * @size: number of entries in the array, must be a power of two
+ *
+ * fdt_cache_init() sets up cache to use the given entry array and
+ * marks it empty.  The cache binds to a tree on its first lookup, and
+ * is emptied again whenever it is used with a different tree.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_BADVALUE, if size is not a positive power of two
+ */
+int fdt_cache_init(struct fdt_cache *cache, struct fdt_cache_entry *entries,
+		   int size);
+
+/**
+ * fdt_cache_invalidate - discard the contents of a lookup cache
+ * @cache: cache to empty
+ *
+ * Changes made through the libfdt read-write functions invalidate
+ * caches automatically.  fdt_cache_invalidate() is only needed when
+ * the tree has been modified by other means, such as by copying a
+ * different blob into the same buffer.
+ */
+void fdt_cache_invalidate(struct fdt_cache *cache);
+
+/**
+ * fdt_subnode_offset_cached - find a subnode of a given node, using a cache
+ * @fdt: pointer to the device tree blob
+ * @cache: lookup cache to consult and update
+ * @parentoffset: structure block offset of a node
+ * @name: name of the subnode to locate
+ * @namelen: number of characters of name to consider
+ *
+ * Identical to fdt_subnode_offset_namelen(), but consults cache first
+ * and records a successful result in it.
+ */
+int fdt_subnode_offset_cached(const void *fdt, struct fdt_cache *cache,
+			      int parentoffset, const char *name, int namelen);
+
+/**
+ * fdt_path_offset_cached - find a tree node by its full path, using a cache
+ * @fdt: pointer to the device tree blob
+ * @cache: lookup cache to consult and update
+ * @path: full path of the node to locate
+ *
+ * Identical to fdt_path_offset(), but resolves each path component,
+ * and any alias, through cache.
+ */
+int fdt_path_offset_cached(const void *fdt, struct fdt_cache *cache,
+			   const char *path);
+
+/**
+ * fdt_get_property_cached - find a given property in a given node, using a cache
+ * @fdt: pointer to the device tree blob
+ * @cache: lookup cache to consult and update
+ * @nodeoffset: offset of the node whose property to find
+ * @name: name of the property to find
+ * @lenp: pointer to an integer variable (will be overwritten) or NULL
+ *
+ * Identical to fdt_get_property(), but consults cache first and
+ * records a successful result in it.
+ */
+const struct fdt_property *fdt_get_property_cached(const void *fdt,
+						   struct fdt_cache *cache,
+						   int nodeoffset,
+						   const char *name, int *lenp);
+
+/**
+ * fdt_getprop_cached - retrieve the value of a given property, using a cache
+ * @fdt: pointer to the device tree blob
+ * @cache: lookup cache to consult and update
+ * @nodeoffset: offset of the node whose property to find
+ * @name: name of the property to find
+ * @lenp: pointer to an integer variable (will be overwritten) or NULL
+ *
+ * Identical to fdt_getprop(), but consults cache first and records a
+ * successful result in it.
+ */
+const void *fdt_getprop_cached(const void *fdt, struct fdt_cache *cache,
+			       int nodeoffset, const char *name, int *lenp);
+
 /**********************************************************************/
 /* Read-only functions (addressing related)                           */
 /**********************************************************************/
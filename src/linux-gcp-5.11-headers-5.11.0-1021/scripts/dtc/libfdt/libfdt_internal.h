@@ -23,6 +23,12 @@ int fdt_check_prop_offset_(const void *fdt, int offset);
 const char *fdt_find_string_(const char *strtab, int tabsize, const char *s);
 int fdt_node_end_offset_(void *fdt, int nodeoffset);
 
+/*
+ * Bumped by every structural change made through the read-write
+ * functions; lookup caches filled under an older value are stale.
+ */
+extern uint32_t fdt_generation_;
+
 static inline const void *fdt_offset_ptr_(const void *fdt, int offset)
 {
 	return (const char *)fdt + fdt_off_dt_struct(fdt) + offset;
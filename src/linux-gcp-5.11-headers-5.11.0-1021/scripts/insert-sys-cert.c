@@ -9,6 +9,7 @@
  *
  * Usage: insert-sys-cert [-s <System.map>] -b <vmlinux> -c <certfile>
  *                        [-s <System.map>] -z <bzImage> -c <certfile>
+ *                        [-j <jobs>] -c <certfile> {-b <vmlinux> | -z <bzImage>}...
  */
 
 #define _GNU_SOURCE
@@ -25,15 +26,19 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <elf.h>
 
 #define CERT_SYM  "system_extra_cert"
 #define USED_SYM  "system_extra_cert_used"
 #define LSIZE_SYM "system_certificate_list_size"
 
-#define info(format, args...) fprintf(stderr, "INFO:    " format, ## args)
-#define warn(format, args...) fprintf(stdout, "WARNING: " format, ## args)
-#define  err(format, args...) fprintf(stderr, "ERROR:   " format, ## args)
+/* "<image>: " while handling one of several images, so output can be told apart */
+static __thread const char *msg_prefix = "";
+
+#define info(format, args...) fprintf(stderr, "INFO:    %s" format, msg_prefix, ## args)
+#define warn(format, args...) fprintf(stdout, "WARNING: %s" format, msg_prefix, ## args)
+#define  err(format, args...) fprintf(stderr, "ERROR:   %s" format, msg_prefix, ## args)
 
 #if UINTPTR_MAX == 0xffffffff
 #define CURRENT_ELFCLASS ELFCLASS32
@@ -131,13 +136,20 @@ static void get_symbol_from_map(Elf_Ehdr *hdr, FILE *f, char *name,
 	s->content = (void *)hdr + s->offset;
 }
 
-static Elf_Sym *find_elf_symbol(Elf_Ehdr *hdr, Elf_Shdr *symtab, char *name)
+/*
+ * Look up all of names[] in a single walk of the symbol table instead of
+ * walking the whole table once per symbol. As before, the first symbol
+ * of each name wins.
+ */
+static void get_symbols_from_table(Elf_Ehdr *hdr, Elf_Shdr *symtab,
+				   char **names, struct sym **syms, int count)
 {
-	Elf_Sym *sym, *symtab_start;
+	Elf_Sym *symtab_start, *elf_syms[count];
 	char *strtab, *symname;
 	unsigned int link;
-	Elf_Shdr *x;
-	int i, n;
+	Elf_Shdr *x, *sec;
+	int i, j, n, found = 0;
+	int secndx;
 
 	x = (void *)hdr + hdr->e_shoff;
 	link = symtab->sh_link;
@@ -145,41 +157,38 @@ static Elf_Sym *find_elf_symbol(Elf_Ehdr *hdr, Elf_Shdr *symtab, char *name)
 	n = symtab->sh_size / symtab->sh_entsize;
 	strtab = (void *)hdr + x[link].sh_offset;
 
-	for (i = 0; i < n; i++) {
-		sym = &symtab_start[i];
-		symname = strtab + sym->st_name;
-		if (strcmp(symname, name) == 0)
-			return sym;
+	memset(elf_syms, 0, sizeof(elf_syms));
+	for (i = 0; i < n && found < count; i++) {
+		symname = strtab + symtab_start[i].st_name;
+		for (j = 0; j < count; j++) {
+			if (!elf_syms[j] && strcmp(symname, names[j]) == 0) {
+				elf_syms[j] = &symtab_start[i];
+				found++;
+			}
+		}
 	}
-	err("Unable to find symbol: %s\n", name);
-	return NULL;
-}
 
-static void get_symbol_from_table(Elf_Ehdr *hdr, Elf_Shdr *symtab,
-				  char *name, struct sym *s)
-{
-	Elf_Shdr *sec;
-	int secndx;
-	Elf_Sym *elf_sym;
-	Elf_Shdr *x;
+	for (j = 0; j < count; j++) {
+		struct sym *s = syms[j];
 
-	x = (void *)hdr + hdr->e_shoff;
-	s->size = 0;
-	s->address = 0;
-	s->offset = 0;
-	elf_sym = find_elf_symbol(hdr, symtab, name);
-	if (!elf_sym)
-		return;
-	secndx = elf_sym->st_shndx;
-	if (!secndx)
-		return;
-	sec = &x[secndx];
-	s->size = elf_sym->st_size;
-	s->address = elf_sym->st_value;
-	s->offset = s->address - sec->sh_addr
-			       + sec->sh_offset;
-	s->name = name;
-	s->content = (void *)hdr + s->offset;
+		s->size = 0;
+		s->address = 0;
+		s->offset = 0;
+		if (!elf_syms[j]) {
+			err("Unable to find symbol: %s\n", names[j]);
+			continue;
+		}
+		secndx = elf_syms[j]->st_shndx;
+		if (!secndx)
+			continue;
+		sec = &x[secndx];
+		s->size = elf_syms[j]->st_size;
+		s->address = elf_syms[j]->st_value;
+		s->offset = s->address - sec->sh_addr
+				       + sec->sh_offset;
+		s->name = names[j];
+		s->content = (void *)hdr + s->offset;
+	}
 }
 
 static Elf_Shdr *get_symbol_table(Elf_Ehdr *hdr)
@@ -333,8 +342,10 @@ static void extract_vmlinux(char *bzimage, int bzimage_size,
 	}
 
 	r = write(src_fd, bzimage + offset, size);
+	close(src_fd);
 	if (r != size) {
 		perror("Could not write vmlinux");
+		remove(src);
 		return;
 	}
 	dest_fd = mkstemp(dest);
@@ -346,6 +357,7 @@ static void extract_vmlinux(char *bzimage, int bzimage_size,
 	snprintf(cmd, sizeof(cmd), "%s <%s >%s", z->command, src, dest);
 	info("Executing: %s\n", cmd);
 	r = system(cmd);
+	close(dest_fd);
 	if (r!=0)
 		warn("Possible errors when extracting\n");
 
@@ -357,7 +369,7 @@ static void extract_vmlinux(char *bzimage, int bzimage_size,
 	*zipper = z;
 }
 
-static void repack_image(char *bzimage, int bzimage_size,
+static int repack_image(char *bzimage, int bzimage_size,
 			char* vmlinux_file, struct zipper *z)
 {
 	char tmp[15] = "vmlinux-XXXXXX";
@@ -373,7 +385,7 @@ static void repack_image(char *bzimage, int bzimage_size,
 	fd = mkstemp(tmp);
 	if (fd == -1) {
 		perror("Could not create temp file");
-		return;
+		return -1;
 	}
 	snprintf(cmd, sizeof(cmd), "%s <%s >%s",
 			z->compress, vmlinux_file, tmp);
@@ -390,18 +402,22 @@ static void repack_image(char *bzimage, int bzimage_size,
 	if (fstat(fd, &st)) {
 		perror("Could not determine file size");
 		close(fd);
-
+		remove(tmp);
+		return -1;
 	}
 	new_size = st.st_size;
 	if (new_size > size) {
 		err("Increase in compressed size is not supported.\n");
 		err("Old size was %d, new size is %d\n", size, new_size);
-		exit(EXIT_FAILURE);
+		close(fd);
+		remove(tmp);
+		return -1;
 	}
 
 	r = read(fd, bzimage + offset, new_size);
 	if (r != new_size)
 		perror(tmp);
+	close(fd);
 
 	r = remove(tmp);
 	if (r!=0)
@@ -412,13 +428,39 @@ static void repack_image(char *bzimage, int bzimage_size,
 
 	/* TODO: update CRC */
 
+	return 0;
 }
 
-static void fill_random(unsigned char *p, int n) {
-	srand(0);
+/*
+ * The fill is the start of the rand() sequence after srand(0). Keep one
+ * copy, extended as needed, so that concurrent images all get the same
+ * bytes a single-image run would.
+ */
+static unsigned char *random_fill;
+static int random_fill_len;
+static pthread_mutex_t random_fill_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int fill_random(unsigned char *p, int n) {
+	unsigned char *fill;
 	int i;
-	for (i = 0; i < n; i++)
-		p[i] = rand();
+
+	pthread_mutex_lock(&random_fill_lock);
+	if (n > random_fill_len) {
+		fill = realloc(random_fill, n);
+		if (!fill) {
+			pthread_mutex_unlock(&random_fill_lock);
+			perror("Allocating memory failed");
+			return -1;
+		}
+		random_fill = fill;
+		srand(0);
+		for (i = 0; i < n; i++)
+			random_fill[i] = rand();
+		random_fill_len = n;
+	}
+	memcpy(p, random_fill, n);
+	pthread_mutex_unlock(&random_fill_lock);
+	return 0;
 }
 
 static void print_sym(Elf_Ehdr *hdr, struct sym *s)
@@ -433,75 +475,62 @@ static void print_usage(char *e)
 {
 	printf("Usage: %s [-s <System.map>] -b <vmlinux> -c <certfile>\n", e);
 	printf("       %s [-s <System.map>] -z <bzImage> -c <certfile>\n", e);
+	printf("       %s [-j <jobs>] -c <certfile> {-b <vmlinux> | -z <bzImage>}...\n", e);
 }
 
-int main(int argc, char **argv)
+struct image {
+	char *file;
+	bool bzimage;
+};
+
+static char *system_map_file;
+static char *cert_file;
+static char *cert;
+static int cert_size;
+
+/*
+ * Insert the certificate into one vmlinux or bzImage. Returns 0 on
+ * success, including when the certificate was already present.
+ */
+static int insert_cert(struct image *img)
 {
-	char *system_map_file = NULL;
 	char *vmlinux_file = NULL;
-	char *bzimage_file = NULL;
-	char *cert_file = NULL;
 	int vmlinux_size;
 	int bzimage_size;
-	int cert_size;
 	Elf_Ehdr *hdr;
-	char *cert;
 	char *bzimage = NULL;
 	struct zipper *z = NULL;
 	FILE *system_map;
 	unsigned long *lsize;
 	int *used;
-	int opt;
 	Elf_Shdr *symtab = NULL;
 	struct sym cert_sym, lsize_sym, used_sym;
+	char *names[] = { CERT_SYM, USED_SYM, LSIZE_SYM };
+	struct sym *syms[] = { &cert_sym, &used_sym, &lsize_sym };
+	bool inserted = false;
+	int ret = -1;
 
-	while ((opt = getopt(argc, argv, "b:z:c:s:")) != -1) {
-		switch (opt) {
-		case 's':
-			system_map_file = optarg;
-			break;
-		case 'b':
-			vmlinux_file = optarg;
-			break;
-		case 'z':
-			bzimage_file = optarg;
-			break;
-		case 'c':
-			cert_file = optarg;
-			break;
-		default:
-			break;
-		}
-	}
-
-	if (!cert_file ||
-	(!vmlinux_file && !bzimage_file) ||
-	(vmlinux_file && bzimage_file)) {
-		print_usage(argv[0]);
-		exit(EXIT_FAILURE);
-	}
-
-	cert = read_file(cert_file, &cert_size);
-	if (!cert)
-		exit(EXIT_FAILURE);
-
-	if (bzimage_file) {
-		bzimage = map_file(bzimage_file, &bzimage_size);
+	if (img->bzimage) {
+		bzimage = map_file(img->file, &bzimage_size);
 		if (!bzimage)
-			exit(EXIT_FAILURE);
+			return -1;
 
 		extract_vmlinux(bzimage, bzimage_size, &vmlinux_file, &z);
-		if (!vmlinux_file)
-			exit(EXIT_FAILURE);
+		if (!vmlinux_file) {
+			munmap(bzimage, bzimage_size);
+			return -1;
+		}
+	} else {
+		vmlinux_file = img->file;
 	}
 
 	hdr = map_file(vmlinux_file, &vmlinux_size);
 	if (!hdr)
-		exit(EXIT_FAILURE);
+		goto out_bzimage;
 
 	if (vmlinux_size < sizeof(*hdr)) {
 		err("Invalid ELF file.\n");
-		exit(EXIT_FAILURE);
+		goto out_unmap;
 	}
 
 	if ((hdr->e_ident[EI_MAG0] != ELFMAG0) ||
@@ -509,22 +538,22 @@ int main(int argc, char **argv)
 	    (hdr->e_ident[EI_MAG2] != ELFMAG2) ||
 	    (hdr->e_ident[EI_MAG3] != ELFMAG3)) {
 		err("Invalid ELF magic.\n");
-		exit(EXIT_FAILURE);
+		goto out_unmap;
 	}
 
 	if (hdr->e_ident[EI_CLASS] != CURRENT_ELFCLASS) {
 		err("ELF class mismatch.\n");
-		exit(EXIT_FAILURE);
+		goto out_unmap;
 	}
 
 	if (hdr->e_ident[EI_DATA] != endianness()) {
 		err("ELF endian mismatch.\n");
-		exit(EXIT_FAILURE);
+		goto out_unmap;
 	}
 
 	if (hdr->e_shoff > vmlinux_size) {
 		err("Could not find section header.\n");
-		exit(EXIT_FAILURE);
+		goto out_unmap;
 	}
 
 	symtab = get_symbol_table(hdr);
@@ -532,30 +561,28 @@ int main(int argc, char **argv)
 		warn("Could not find the symbol table.\n");
 		if (!system_map_file) {
 			err("Please provide a System.map file.\n");
-			print_usage(argv[0]);
-			exit(EXIT_FAILURE);
+			goto out_unmap;
 		}
 
 		system_map = fopen(system_map_file, "r");
 		if (!system_map) {
 			perror(system_map_file);
-			exit(EXIT_FAILURE);
+			goto out_unmap;
 		}
 		get_symbol_from_map(hdr, system_map, CERT_SYM, &cert_sym);
 		get_symbol_from_map(hdr, system_map, USED_SYM, &used_sym);
 		get_symbol_from_map(hdr, system_map, LSIZE_SYM, &lsize_sym);
 		cert_sym.size = used_sym.address - cert_sym.address;
+		fclose(system_map);
 	} else {
 		info("Symbol table found.\n");
 		if (system_map_file)
 			warn("System.map is ignored.\n");
-		get_symbol_from_table(hdr, symtab, CERT_SYM, &cert_sym);
-		get_symbol_from_table(hdr, symtab, USED_SYM, &used_sym);
-		get_symbol_from_table(hdr, symtab, LSIZE_SYM, &lsize_sym);
+		get_symbols_from_table(hdr, symtab, names, syms, 3);
 	}
 
 	if (!cert_sym.offset || !lsize_sym.offset || !used_sym.offset)
-		exit(EXIT_FAILURE);
+		goto out_unmap;
 
 	print_sym(hdr, &cert_sym);
 	print_sym(hdr, &used_sym);
@@ -566,14 +593,15 @@ int main(int argc, char **argv)
 
 	if (cert_sym.size < cert_size) {
 		err("Certificate is larger than the reserved area!\n");
-		exit(EXIT_FAILURE);
+		goto out_unmap;
 	}
 
 	/* If the existing cert is the same, don't overwrite */
 	if (cert_size > 0 && cert_size == *used &&
 	    strncmp(cert_sym.content, cert, cert_size) == 0) {
 		warn("Certificate was already inserted.\n");
-		exit(EXIT_SUCCESS);
+		ret = 0;
+		goto out_unmap;
 	}
 
 	if (*used > 0)
@@ -583,8 +611,9 @@ int main(int argc, char **argv)
 
 	if (cert_size < cert_sym.size)
 		/* This makes the reserved space incompressable */
-		fill_random(cert_sym.content + cert_size,
-				cert_sym.size - cert_size);
+		if (fill_random(cert_sym.content + cert_size,
+				cert_sym.size - cert_size))
+			goto out_unmap;
 
 	*lsize = *lsize + cert_size - *used;
 	*used = cert_size;
@@ -592,15 +621,119 @@ int main(int argc, char **argv)
 						cert_sym.address);
 	info("Used %d bytes out of %d bytes reserved.\n", *used,
 						 cert_sym.size);
+	inserted = true;
+	ret = 0;
 
+out_unmap:
 	if (munmap(hdr, vmlinux_size) == -1) {
 		perror(vmlinux_file);
-		exit(EXIT_FAILURE);
+		ret = -1;
 	}
 
+out_bzimage:
 	if (bzimage) {
-		repack_image(bzimage, bzimage_size, vmlinux_file, z);
+		if (inserted && ret == 0)
+			ret = repack_image(bzimage, bzimage_size, vmlinux_file, z);
+		else if (remove(vmlinux_file) != 0)
+			perror(vmlinux_file);
+		free(vmlinux_file);
+		munmap(bzimage, bzimage_size);
+	}
+
+	return ret;
+}
+
+/* Images shared out between the worker threads for -j */
+static struct image *work_images;
+static int work_count, work_next, work_errors;
+
+static void *insert_worker(void *arg)
+{
+	char *prefix;
+	int i;
+
+	while ((i = __sync_fetch_and_add(&work_next, 1)) < work_count) {
+		prefix = NULL;
+		if (work_count > 1 &&
+		    asprintf(&prefix, "%s: ", work_images[i].file) >= 0)
+			msg_prefix = prefix;
+		if (insert_cert(&work_images[i]))
+			__sync_fetch_and_add(&work_errors, 1);
+		msg_prefix = "";
+		free(prefix);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *threads;
+	long jobs = 1;
+	int opt;
+	int i;
+
+	work_images = calloc(argc, sizeof(*work_images));
+	if (!work_images) {
+		perror("Allocating memory failed");
+		exit(EXIT_FAILURE);
 	}
 
-	exit(EXIT_SUCCESS);
+	while ((opt = getopt(argc, argv, "b:z:c:s:j:")) != -1) {
+		switch (opt) {
+		case 's':
+			system_map_file = optarg;
+			break;
+		case 'b':
+			work_images[work_count].file = optarg;
+			work_images[work_count++].bzimage = false;
+			break;
+		case 'z':
+			work_images[work_count].file = optarg;
+			work_images[work_count++].bzimage = true;
+			break;
+		case 'c':
+			cert_file = optarg;
+			break;
+		case 'j':
+			jobs = atoi(optarg);
+			if (jobs <= 0)
+				jobs = sysconf(_SC_NPROCESSORS_ONLN);
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* A System.map only describes one kernel */
+	if (!cert_file || !work_count ||
+	    (system_map_file && work_count > 1)) {
+		print_usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	cert = read_file(cert_file, &cert_size);
+	if (!cert)
+		exit(EXIT_FAILURE);
+
+	if (jobs > work_count)
+		jobs = work_count;
+
+	threads = calloc(jobs, sizeof(*threads));
+	if (!threads)
+		jobs = 1;
+
+	/* The main thread is a worker too; carry on with fewer if need be */
+	for (i = 1; i < jobs; i++)
+		if (pthread_create(&threads[i], NULL, insert_worker, NULL))
+			break;
+	jobs = i;
+
+	insert_worker(NULL);
+
+	for (i = 1; i < jobs; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	exit(work_errors ? EXIT_FAILURE : EXIT_SUCCESS);
 }
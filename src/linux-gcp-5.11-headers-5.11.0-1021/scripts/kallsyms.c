@@ -63,6 +63,17 @@ static int base_relative;
 
 static int token_profit[0x10000];
 
+/*
+ * For each token, the indices of the symbols that may contain it, so that
+ * compress_symbols() does not have to search every symbol for every token.
+ * Entries can be stale, because a symbol may have lost the token to an
+ * earlier compression step, and may be duplicated.
+ */
+static struct token_syms {
+	unsigned int *syms;
+	unsigned int cnt, size;
+} token_syms[0x10000];
+
 /* the table that holds the result of the compression */
 static unsigned char best_table[256][2];
 static unsigned char best_table_len[256];
@@ -523,13 +534,38 @@ static void forget_symbol(const unsigned char *symbol, int len)
 		token_profit[ symbol[i] + (symbol[i + 1] << 8) ]--;
 }
 
+static void add_token_sym(int token, unsigned int sym_idx)
+{
+	struct token_syms *ts = &token_syms[token];
+
+	/* symbols are added one at a time, so this catches most duplicates */
+	if (ts->cnt && ts->syms[ts->cnt - 1] == sym_idx)
+		return;
+
+	if (ts->cnt >= ts->size) {
+		ts->size = ts->size ? ts->size * 2 : 16;
+		ts->syms = realloc(ts->syms, sizeof(*ts->syms) * ts->size);
+		if (!ts->syms) {
+			fprintf(stderr, "out of memory\n");
+			exit (1);
+		}
+	}
+	ts->syms[ts->cnt++] = sym_idx;
+}
+
 /* do the initial token count */
 static void build_initial_tok_table(void)
 {
-	unsigned int i;
+	unsigned int i, j;
 
-	for (i = 0; i < table_cnt; i++)
-		learn_symbol(table[i]->sym, table[i]->len);
+	for (i = 0; i < table_cnt; i++) {
+		const unsigned char *symbol = table[i]->sym;
+
+		learn_symbol(symbol, table[i]->len);
+
+		for (j = 0; j + 1 < table[i]->len; j++)
+			add_token_sym(symbol[j] + (symbol[j + 1] << 8), i);
+	}
 }
 
 static unsigned char *find_token(unsigned char *str, int len,
@@ -548,10 +584,19 @@ static unsigned char *find_token(unsigned char *str, int len,
  * to update the counts */
 static void compress_symbols(const unsigned char *str, int idx)
 {
-	unsigned int i, len, size;
+	unsigned int i, j, k, len, size;
 	unsigned char *p1, *p2;
+	struct token_syms ts = token_syms[str[0] + (str[1] << 8)];
 
-	for (i = 0; i < table_cnt; i++) {
+	/*
+	 * Every occurrence of the token is replaced below, so its list is no
+	 * longer needed. It cannot grow meanwhile either: only tokens that
+	 * contain idx, which the token itself cannot, are added to.
+	 */
+	memset(&token_syms[str[0] + (str[1] << 8)], 0, sizeof(ts));
+
+	for (k = 0; k < ts.cnt; k++) {
+		i = ts.syms[k];
 
 		len = table[i]->len;
 		p1 = table[i]->sym;
@@ -584,7 +629,15 @@ static void compress_symbols(const unsigned char *str, int idx)
 
 		/* increase the counts for this symbol's new tokens */
 		learn_symbol(table[i]->sym, len);
+
+		/* the only tokens it did not have before are those with idx */
+		p1 = table[i]->sym;
+		for (j = 0; j + 1 < len; j++)
+			if (p1[j] == idx || p1[j + 1] == idx)
+				add_token_sym(p1[j] + (p1[j + 1] << 8), i);
 	}
+
+	free(ts.syms);
 }
 
 /* search the token with the maximum profit */
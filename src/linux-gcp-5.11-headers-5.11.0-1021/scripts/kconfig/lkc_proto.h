@@ -13,7 +13,8 @@ void conf_set_changed_callback(void (*fn)(void));
 void conf_set_message_callback(void (*fn)(const char *s));
 
 /* symbol.c */
-extern struct symbol * symbol_hash[SYMBOL_HASHSIZE];
+extern struct symbol ** symbol_hash;
+extern int symbol_hash_size;
 
 struct symbol * sym_lookup(const char *name, int flags);
 struct symbol * sym_find(const char *name);
@@ -26,7 +26,8 @@ static void zconf_error(const char *err, ...);
 static bool zconf_endtoken(const char *tokenname,
 			   const char *expected_tokenname);
 
-struct symbol *symbol_hash[SYMBOL_HASHSIZE];
+struct symbol **symbol_hash;
+int symbol_hash_size;
 
 static struct menu *current_menu, *current_entry;
 
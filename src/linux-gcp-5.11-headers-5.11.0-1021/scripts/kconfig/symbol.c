@@ -804,6 +804,32 @@ static unsigned strhash(const char *s)
 	return hash;
 }
 
+static int symbol_count;
+
+/*
+ * Grow the symbol hash table so that chains stay short however many symbols
+ * (including constants) the Kconfig tree defines.
+ */
+static void sym_hash_grow(void)
+{
+	struct symbol **old_hash = symbol_hash, *symbol, *next;
+	int old_size = symbol_hash_size, i, hash;
+
+	symbol_hash_size = old_size ? old_size * 2 + 1 : SYMBOL_HASHSIZE;
+	symbol_hash = xcalloc(symbol_hash_size, sizeof(*symbol_hash));
+
+	for (i = 0; i < old_size; i++) {
+		for (symbol = old_hash[i]; symbol; symbol = next) {
+			next = symbol->next;
+			hash = symbol->name ?
+			       strhash(symbol->name) % symbol_hash_size : 0;
+			symbol->next = symbol_hash[hash];
+			symbol_hash[hash] = symbol;
+		}
+	}
+	free(old_hash);
+}
+
 struct symbol *sym_lookup(const char *name, int flags)
 {
 	struct symbol *symbol;
@@ -818,7 +844,9 @@ struct symbol *sym_lookup(const char *name, int flags)
 			case 'n': return &symbol_no;
 			}
 		}
-		hash = strhash(name) % SYMBOL_HASHSIZE;
+		if (!symbol_hash_size)
+			sym_hash_grow();
+		hash = strhash(name) % symbol_hash_size;
 
 		for (symbol = symbol_hash[hash]; symbol; symbol = symbol->next) {
 			if (symbol->name &&
@@ -839,6 +867,10 @@ struct symbol *sym_lookup(const char *name, int flags)
 	symbol->type = S_UNKNOWN;
 	symbol->flags = flags;
 
+	if (++symbol_count > symbol_hash_size) {
+		sym_hash_grow();
+		hash = name ? strhash(name) % symbol_hash_size : 0;
+	}
 	symbol->next = symbol_hash[hash];
 	symbol_hash[hash] = symbol;
 
@@ -860,7 +892,9 @@ struct symbol *sym_find(const char *name)
 		case 'n': return &symbol_no;
 		}
 	}
-	hash = strhash(name) % SYMBOL_HASHSIZE;
+	if (!symbol_hash_size)
+		return NULL;
+	hash = strhash(name) % symbol_hash_size;
 
 	for (symbol = symbol_hash[hash]; symbol; symbol = symbol->next) {
 		if (symbol->name &&
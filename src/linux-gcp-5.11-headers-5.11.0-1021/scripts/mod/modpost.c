@@ -18,6 +18,8 @@
 #include <string.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <errno.h>
 #include "modpost.h"
 #include "../../include/linux/license.h"
@@ -158,17 +160,125 @@ char *get_line(char **stringp)
 	return orig;
 }
 
+/*
+ * Open-addressing hash table of named objects, used for both the exported
+ * symbols and the modules.  Each slot keeps the full hash next to the entry
+ * pointer, so that probing rarely needs to touch the entries themselves,
+ * and the table doubles whenever it becomes half full.
+ */
+struct hash_slot {
+	unsigned int hash;
+	void *entry;
+};
+
+struct hash_table {
+	struct hash_slot *slots;
+	unsigned int size;		/* always zero or a power of two */
+	unsigned int count;
+	size_t name_offset;		/* offset of the name in an entry */
+};
+
+#define HASH_TABLE_INIT(type)	{ .name_offset = offsetof(type, name) }
+#define HASH_TABLE_MIN_SIZE	1024
+
+/* 32-bit FNV-1a, with the murmur3 finalizer to spread it over the low bits */
+static inline unsigned int name_hash(const char *name)
+{
+	unsigned int value = 2166136261u;
+
+	for (; *name; name++) {
+		value ^= (unsigned char)*name;
+		value *= 16777619u;
+	}
+
+	value ^= value >> 16;
+	value *= 0x85ebca6bu;
+	value ^= value >> 13;
+	value *= 0xc2b2ae35u;
+	value ^= value >> 16;
+
+	return value;
+}
+
+static inline const char *hash_entry_name(const struct hash_table *table,
+					  const void *entry)
+{
+	return (const char *)entry + table->name_offset;
+}
+
+static struct hash_slot *hash_table_slot(const struct hash_table *table,
+					 const char *name, unsigned int hash)
+{
+	unsigned int mask = table->size - 1;
+	unsigned int i;
+
+	for (i = hash & mask; table->slots[i].entry; i = (i + 1) & mask) {
+		if (table->slots[i].hash == hash &&
+		    strcmp(hash_entry_name(table, table->slots[i].entry),
+			   name) == 0)
+			break;
+	}
+	return &table->slots[i];
+}
+
+static void *hash_table_find(const struct hash_table *table, const char *name)
+{
+	if (!table->size)
+		return NULL;
+
+	return hash_table_slot(table, name, name_hash(name))->entry;
+}
+
+static void hash_table_grow(struct hash_table *table)
+{
+	struct hash_table old = *table;
+	unsigned int n;
+
+	table->size = old.size ? old.size * 2 : HASH_TABLE_MIN_SIZE;
+	table->slots = NOFAIL(calloc(table->size, sizeof(*table->slots)));
+
+	/* Names are unique in the table, so only empty slots need finding */
+	for (n = 0; n < old.size; n++) {
+		unsigned int mask = table->size - 1;
+		unsigned int i;
+
+		if (!old.slots[n].entry)
+			continue;
+
+		for (i = old.slots[n].hash & mask; table->slots[i].entry;
+		     i = (i + 1) & mask)
+			;
+		table->slots[i] = old.slots[n];
+	}
+	free(old.slots);
+}
+
+/* Add an entry, replacing any previous one of the same name */
+static void hash_table_add(struct hash_table *table, void *entry)
+{
+	const char *name = hash_entry_name(table, entry);
+	unsigned int hash = name_hash(name);
+	struct hash_slot *slot;
+
+	if ((table->count + 1) * 2 > table->size)
+		hash_table_grow(table);
+
+	slot = hash_table_slot(table, name, hash);
+	if (!slot->entry)
+		table->count++;
+	slot->hash = hash;
+	slot->entry = entry;
+}
+
 /* A list of all modules we processed */
 static struct module *modules;
 
+/* The same modules, for lookup by name */
+static struct hash_table module_table = HASH_TABLE_INIT(struct module);
+
 static struct module *find_module(const char *modname)
 {
-	struct module *mod;
-
-	for (mod = modules; mod; mod = mod->next)
-		if (strcmp(mod->name, modname) == 0)
-			break;
-	return mod;
+	return hash_table_find(&module_table, modname);
 }
 
 static struct module *new_module(const char *modname)
@@ -184,6 +294,7 @@ static struct module *new_module(const char *modname)
 	mod->gpl_compatible = -1;
 	mod->next = modules;
 	modules = mod;
+	hash_table_add(&module_table, mod);
 
 	if (mod->is_vmlinux)
 		have_vmlinux = 1;
@@ -194,8 +305,6 @@ static struct module *new_module(const char *modname)
 /* A hash of all exported symbols,
  * struct symbol is also used for lists of unresolved symbols */
 
-#define SYMBOL_HASH_SIZE 1024
-
 struct symbol {
 	struct symbol *next;
 	struct module *module;
@@ -208,20 +317,7 @@ struct symbol {
 	char name[];
 };
 
-static struct symbol *symbolhash[SYMBOL_HASH_SIZE];
-
-/* This is based on the hash agorithm from gdbm, via tdb */
-static inline unsigned int tdb_hash(const char *name)
-{
-	unsigned value;	/* Used to compute the hash value.  */
-	unsigned   i;	/* Used to cycle through random values. */
-
-	/* Set the initial value from the key size. */
-	for (value = 0x238F13AF * strlen(name), i = 0; name[i]; i++)
-		value = (value + (((unsigned char *)name)[i] << (i*5 % 24)));
-
-	return (1103515243 * value + 12345);
-}
+static struct hash_table symbol_table = HASH_TABLE_INIT(struct symbol);
 
 /**
  * Allocate a new symbols for use in the hash of exported symbols or
@@ -244,27 +340,20 @@ static struct symbol *alloc_symbol(const char *name, unsigned int weak,
 static struct symbol *new_symbol(const char *name, struct module *module,
 				 enum export export)
 {
-	unsigned int hash;
+	struct symbol *s = alloc_symbol(name, 0, NULL);
 
-	hash = tdb_hash(name) % SYMBOL_HASH_SIZE;
-	symbolhash[hash] = alloc_symbol(name, 0, symbolhash[hash]);
+	hash_table_add(&symbol_table, s);
 
-	return symbolhash[hash];
+	return s;
 }
 
 static struct symbol *find_symbol(const char *name)
 {
-	struct symbol *s;
-
 	/* For our purposes, .foo matches foo.  PPC64 needs this. */
 	if (name[0] == '.')
 		name++;
 
-	for (s = symbolhash[tdb_hash(name) % SYMBOL_HASH_SIZE]; s; s = s->next) {
-		if (strcmp(s->name, name) == 0)
-			return s;
-	}
-	return NULL;
+	return hash_table_find(&symbol_table, name);
 }
 
 static bool contains_namespace(struct namespace_list *list,
@@ -646,8 +735,11 @@ static int parse_elf(struct elf_info *info, const char *filename)
 	return 1;
 }
 
+static void symsearch_free(struct elf_info *elf);
+
 static void parse_elf_finish(struct elf_info *info)
 {
+	symsearch_free(info);
 	release_file(info->hdr, info->size);
 }
 
@@ -1297,6 +1389,113 @@ static inline int is_valid_name(struct elf_info *elf, Elf_Sym *sym)
 	return !is_arm_mapping_symbol(name);
 }
 
+/*
+ * Index of the named symbols of an ELF file, sorted by section, then by
+ * address, then by symbol table order, so that the nearest-symbol lookups
+ * done when reporting section mismatches are binary searches rather than
+ * walks of the whole symbol table.  It is only built once the first
+ * mismatch is found in a file, as most files have none.
+ */
+struct symsearch_entry {
+	Elf_Addr value;
+	Elf_Sym *sym;
+};
+
+struct symsearch {
+	struct symsearch_entry *entries;
+	/* Entries of section i are [sec_start[i], sec_start[i + 1]) */
+	unsigned int *sec_start;
+};
+
+static int symsearch_cmp(const void *a, const void *b)
+{
+	const struct symsearch_entry *ea = a, *eb = b;
+
+	if (ea->value != eb->value)
+		return ea->value < eb->value ? -1 : 1;
+	if (ea->sym != eb->sym)
+		return ea->sym < eb->sym ? -1 : 1;
+	return 0;
+}
+
+static struct symsearch *symsearch_get(struct elf_info *elf)
+{
+	struct symsearch *ss = elf->symsearch;
+	unsigned int *fill;
+	unsigned int i, count = 0;
+	Elf_Sym *sym;
+
+	if (ss)
+		return ss;
+
+	ss = NOFAIL(calloc(1, sizeof(*ss)));
+	ss->sec_start = NOFAIL(calloc(elf->num_sections + 1,
+				      sizeof(*ss->sec_start)));
+	fill = NOFAIL(calloc(elf->num_sections, sizeof(*fill)));
+
+	/* Count the symbols of each section, ... */
+	for (sym = elf->symtab_start; sym < elf->symtab_stop; sym++) {
+		if (is_shndx_special(sym->st_shndx) ||
+		    get_secindex(elf, sym) >= elf->num_sections ||
+		    !is_valid_name(elf, sym))
+			continue;
+		ss->sec_start[get_secindex(elf, sym) + 1]++;
+		count++;
+	}
+	for (i = 0; i < elf->num_sections; i++)
+		ss->sec_start[i + 1] += ss->sec_start[i];
+
+	/* ... bucket them by section, and sort each section by address */
+	ss->entries = NOFAIL(malloc((count ? count : 1) *
+				    sizeof(*ss->entries)));
+	for (sym = elf->symtab_start; sym < elf->symtab_stop; sym++) {
+		unsigned int secindex;
+
+		if (is_shndx_special(sym->st_shndx) ||
+		    get_secindex(elf, sym) >= elf->num_sections ||
+		    !is_valid_name(elf, sym))
+			continue;
+		secindex = get_secindex(elf, sym);
+		ss->entries[ss->sec_start[secindex] + fill[secindex]++] =
+			(struct symsearch_entry) { sym->st_value, sym };
+	}
+	for (i = 0; i < elf->num_sections; i++)
+		qsort(&ss->entries[ss->sec_start[i]],
+		      ss->sec_start[i + 1] - ss->sec_start[i],
+		      sizeof(*ss->entries), symsearch_cmp);
+
+	free(fill);
+	elf->symsearch = ss;
+	return ss;
+}
+
+static void symsearch_free(struct elf_info *elf)
+{
+	if (!elf->symsearch)
+		return;
+
+	free(elf->symsearch->entries);
+	free(elf->symsearch->sec_start);
+	free(elf->symsearch);
+	elf->symsearch = NULL;
+}
+
+/* First entry of [lo, hi) with a value above addr, or hi if none */
+static unsigned int symsearch_upper_bound(const struct symsearch *ss,
+					  unsigned int lo, unsigned int hi,
+					  Elf_Addr addr)
+{
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (ss->entries[mid].value <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 /**
  * Find symbol based on relocation record info.
  * In some cases the symbol supplied is a valid symbol so
@@ -1307,30 +1506,41 @@ static inline int is_valid_name(struct elf_info *elf, Elf_Sym *sym)
 static Elf_Sym *find_elf_symbol(struct elf_info *elf, Elf64_Sword addr,
 				Elf_Sym *relsym)
 {
-	Elf_Sym *sym;
+	const struct symsearch *ss;
 	Elf_Sym *near = NULL;
 	Elf64_Sword distance = 20;
 	Elf64_Sword d;
 	unsigned int relsym_secindex;
+	unsigned int i, end;
 
 	if (relsym->st_name != 0)
 		return relsym;
 
+	/* Only symbols in [addr - 19, addr + 19] are close enough */
+	if (addr + 19 < 0)
+		return NULL;
+
+	ss = symsearch_get(elf);
 	relsym_secindex = get_secindex(elf, relsym);
-	for (sym = elf->symtab_start; sym < elf->symtab_stop; sym++) {
-		if (get_secindex(elf, sym) != relsym_secindex)
-			continue;
+	if (relsym_secindex >= elf->num_sections)
+		return NULL;
+
+	end = ss->sec_start[relsym_secindex + 1];
+	i = ss->sec_start[relsym_secindex];
+	if (addr > 19)
+		i = symsearch_upper_bound(ss, i, end, addr - 20);
+
+	for (; i < end && ss->entries[i].value <= (Elf_Addr)(addr + 19); i++) {
+		Elf_Sym *sym = ss->entries[i].sym;
+
 		if (ELF_ST_TYPE(sym->st_info) == STT_SECTION)
 			continue;
-		if (!is_valid_name(elf, sym))
-			continue;
-		if (sym->st_value == addr)
-			return sym;
 		/* Find a symbol nearby - addr are maybe negative */
 		d = sym->st_value - addr;
 		if (d < 0)
 			d = addr - sym->st_value;
-		if (d < distance) {
+		/* On a tie, prefer the symbol that comes first in the table */
+		if (d < distance || (d == distance && near && sym < near)) {
 			distance = d;
 			near = sym;
 		}
@@ -1351,28 +1561,30 @@ static Elf_Sym *find_elf_symbol(struct elf_info *elf, Elf64_Sword addr,
 static Elf_Sym *find_elf_symbol2(struct elf_info *elf, Elf_Addr addr,
 				 const char *sec)
 {
-	Elf_Sym *sym;
+	const struct symsearch *ss = symsearch_get(elf);
 	Elf_Sym *near = NULL;
-	Elf_Addr distance = ~0;
+	unsigned int secindex;
 
-	for (sym = elf->symtab_start; sym < elf->symtab_stop; sym++) {
-		const char *symsec;
+	/* Several sections may share the name */
+	for (secindex = 0; secindex < elf->num_sections; secindex++) {
+		unsigned int start = ss->sec_start[secindex];
+		unsigned int i;
+		Elf_Sym *sym;
 
-		if (is_shndx_special(sym->st_shndx))
-			continue;
-		symsec = sec_name(elf, get_secindex(elf, sym));
-		if (strcmp(symsec, sec) != 0)
+		if (start == ss->sec_start[secindex + 1] ||
+		    strcmp(sec_name(elf, secindex), sec) != 0)
 			continue;
-		if (!is_valid_name(elf, sym))
+
+		/* The last symbol at or below addr, latest in the table */
+		i = symsearch_upper_bound(ss, start,
+					  ss->sec_start[secindex + 1], addr);
+		if (i == start)
 			continue;
-		if (sym->st_value <= addr) {
-			if ((addr - sym->st_value) < distance) {
-				distance = addr - sym->st_value;
-				near = sym;
-			} else if ((addr - sym->st_value) == distance) {
-				near = sym;
-			}
-		}
+		sym = ss->entries[i - 1].sym;
+
+		if (!near || sym->st_value > near->st_value ||
+		    (sym->st_value == near->st_value && sym > near))
+			near = sym;
 	}
 	return near;
 }
@@ -1737,11 +1949,46 @@ static void extable_mismatch_handler(const char* modname, struct elf_info *elf,
 	}
 }
 
+/*
+ * section_mismatch() glob-matches both section names against the whole
+ * sectioncheck table, which is expensive to do for every relocation.  The
+ * result only depends on the target section for a given relocation section,
+ * and the relocations of one section nearly always refer to a handful of
+ * target sections, so remember recent results in a small direct-mapped cache
+ * that is reset for each relocation section.
+ */
+#define MISMATCH_CACHE_SIZE 64
+
+struct mismatch_cache {
+	struct {
+		unsigned int secindex;	/* ~0U if the entry is unused */
+		const struct sectioncheck *mismatch;
+	} entry[MISMATCH_CACHE_SIZE];
+};
+
+static void mismatch_cache_init(struct mismatch_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < MISMATCH_CACHE_SIZE; i++)
+		cache->entry[i].secindex = ~0U;
+}
+
 static void check_section_mismatch(const char *modname, struct elf_info *elf,
-				   Elf_Rela *r, Elf_Sym *sym, const char *fromsec)
+				   Elf_Rela *r, Elf_Sym *sym, const char *fromsec,
+				   struct mismatch_cache *cache)
 {
-	const char *tosec = sec_name(elf, get_secindex(elf, sym));
-	const struct sectioncheck *mismatch = section_mismatch(fromsec, tosec);
+	unsigned int secindex = get_secindex(elf, sym);
+	unsigned int slot = secindex % MISMATCH_CACHE_SIZE;
+	const struct sectioncheck *mismatch;
+
+	if (cache->entry[slot].secindex == secindex) {
+		mismatch = cache->entry[slot].mismatch;
+	} else {
+		mismatch = section_mismatch(fromsec, sec_name(elf, secindex));
+		cache->entry[slot].secindex = secindex;
+		cache->entry[slot].mismatch = mismatch;
+	}
 
 	if (mismatch) {
 		if (mismatch->handler)
@@ -1853,6 +2100,7 @@ static void section_rela(const char *modname, struct elf_info *elf,
 	Elf_Rela r;
 	unsigned int r_sym;
 	const char *fromsec;
+	struct mismatch_cache cache;
 
 	Elf_Rela *start = (void *)elf->hdr + sechdr->sh_offset;
 	Elf_Rela *stop  = (void *)start + sechdr->sh_size;
@@ -1863,6 +2111,8 @@ static void section_rela(const char *modname, struct elf_info *elf,
 	if (match(fromsec, section_white_list))
 		return;
 
+	mismatch_cache_init(&cache);
+
 	for (rela = start; rela < stop; rela++) {
 		r.r_offset = TO_NATIVE(rela->r_offset);
 #if KERNEL_ELFCLASS == ELFCLASS64
@@ -1887,7 +2137,7 @@ static void section_rela(const char *modname, struct elf_info *elf,
 			continue;
 		if (is_second_extable_reloc(start, rela, fromsec))
 			find_extable_entry_size(fromsec, &r);
-		check_section_mismatch(modname, elf, &r, sym, fromsec);
+		check_section_mismatch(modname, elf, &r, sym, fromsec, &cache);
 	}
 }
 
@@ -1899,6 +2149,7 @@ static void section_rel(const char *modname, struct elf_info *elf,
 	Elf_Rela r;
 	unsigned int r_sym;
 	const char *fromsec;
+	struct mismatch_cache cache;
 
 	Elf_Rel *start = (void *)elf->hdr + sechdr->sh_offset;
 	Elf_Rel *stop  = (void *)start + sechdr->sh_size;
@@ -1909,6 +2160,8 @@ static void section_rel(const char *modname, struct elf_info *elf,
 	if (match(fromsec, section_white_list))
 		return;
 
+	mismatch_cache_init(&cache);
+
 	for (rel = start; rel < stop; rel++) {
 		r.r_offset = TO_NATIVE(rel->r_offset);
 #if KERNEL_ELFCLASS == ELFCLASS64
@@ -1947,7 +2200,7 @@ static void section_rel(const char *modname, struct elf_info *elf,
 			continue;
 		if (is_second_extable_reloc(start, rel, fromsec))
 			find_extable_entry_size(fromsec, &r);
-		check_section_mismatch(modname, elf, &r, sym, fromsec);
+		check_section_mismatch(modname, elf, &r, sym, fromsec, &cache);
 	}
 }
 
@@ -2137,7 +2390,7 @@ void buf_write(struct buffer *buf, const char *s, int len)
 		buf->size += len + SZ;
 		buf->p = NOFAIL(realloc(buf->p, buf->size));
 	}
-	strncpy(buf->p + buf->pos, s, len);
+	memcpy(buf->p + buf->pos, s, len);
 	buf->pos += len;
 }
 
@@ -2416,12 +2669,293 @@ static void write_if_changed(struct buffer *b, const char *fname)
 	write_buf(b, fname);
 }
 
+/* Record one exported symbol read from a symbol dump */
+static void add_dump_symbol(const char *symname, struct module *mod,
+			    enum export export, unsigned int crc,
+			    const char *namespace)
+{
+	struct symbol *s;
+
+	s = sym_add_exported(symname, mod, export);
+	s->is_static = 0;
+	sym_set_crc(symname, crc);
+	sym_update_namespace(symname, namespace);
+}
+
+static struct module *find_dump_module(const char *modname)
+{
+	struct module *mod = find_module(modname);
+
+	if (!mod) {
+		mod = new_module(modname);
+		mod->from_dump = 1;
+	}
+	return mod;
+}
+
+/*
+ * External module builds read the whole Module.symvers of the kernel every
+ * time.  To save parsing it again, the parsed records are kept in a binary
+ * <dump>.cache next to it, tagged with the size, mtime and inode of the
+ * dump they came from.  A cache that does not match is ignored and
+ * rewritten; one that cannot be written (e.g. a read-only headers tree)
+ * is simply not used.
+ *
+ * Layout: header, nr_modules module name offsets, nr_symbols symbols,
+ * then the NUL-terminated strings.
+ */
+#define SYMVERS_CACHE_MAGIC	0x4d535643	/* "MSVC" */
+#define SYMVERS_CACHE_VERSION	1
+
+struct symvers_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;
+	uint64_t mtime_sec;
+	uint64_t mtime_nsec;
+	uint64_t ino;
+	uint32_t nr_modules;
+	uint32_t nr_symbols;
+	uint32_t strtab_size;
+	uint32_t pad;
+};
+
+struct symvers_cache_symbol {
+	uint32_t crc;
+	uint32_t name;		/* offset into the strings */
+	uint32_t namespace;	/* offset into the strings */
+	uint32_t module;	/* index into the module names */
+	uint32_t export;
+};
+
+/* A string already in the cache being built, with its offset or index */
+struct symvers_cache_string {
+	uint32_t value;
+	char name[];
+};
+
+struct symvers_cache {
+	struct buffer modules;
+	struct buffer symbols;
+	struct buffer strtab;
+	uint32_t nr_modules;
+	uint32_t nr_symbols;
+	struct hash_table module_index;
+	struct hash_table strings;
+};
+
+#define SYMVERS_CACHE_INIT {						\
+	.module_index = HASH_TABLE_INIT(struct symvers_cache_string),	\
+	.strings = HASH_TABLE_INIT(struct symvers_cache_string),	\
+}
+
+static void symvers_cache_name(char *cname, const char *fname)
+{
+	if (snprintf(cname, PATH_MAX, "%s.cache", fname) >= PATH_MAX)
+		fatal("%s: file name too long\n", fname);
+}
+
+static bool symvers_cache_matches(const struct symvers_cache_header *h,
+				  const struct stat *st)
+{
+	return h->magic == SYMVERS_CACHE_MAGIC &&
+	       h->version == SYMVERS_CACHE_VERSION &&
+	       h->size == (uint64_t)st->st_size &&
+	       h->mtime_sec == (uint64_t)st->st_mtim.tv_sec &&
+	       h->mtime_nsec == (uint64_t)st->st_mtim.tv_nsec &&
+	       h->ino == (uint64_t)st->st_ino;
+}
+
+/* Load the cache of @fname, if there is a valid one; true if it was used */
+static bool read_dump_cache(const char *fname, const struct stat *st)
+{
+	const struct symvers_cache_header *h;
+	const struct symvers_cache_symbol *syms;
+	const uint32_t *modnames;
+	const char *strtab;
+	struct module **mods;
+	char cname[PATH_MAX];
+	uint64_t expected;
+	size_t size;
+	void *map;
+	uint32_t i;
+
+	symvers_cache_name(cname, fname);
+	map = grab_file(cname, &size);
+	if (!map)
+		return false;
+
+	h = map;
+	if (size < sizeof(*h) || !symvers_cache_matches(h, st))
+		goto stale;
+
+	expected = sizeof(*h) + (uint64_t)h->nr_modules * sizeof(*modnames) +
+		   (uint64_t)h->nr_symbols * sizeof(*syms) + h->strtab_size;
+	if (size != expected || !h->strtab_size)
+		goto stale;
+
+	modnames = (const uint32_t *)(h + 1);
+	syms = (const struct symvers_cache_symbol *)(modnames + h->nr_modules);
+	strtab = (const char *)(syms + h->nr_symbols);
+	if (strtab[h->strtab_size - 1] != '\0')
+		goto stale;
+
+	/* Check everything before touching the symbol table */
+	for (i = 0; i < h->nr_modules; i++)
+		if (modnames[i] >= h->strtab_size)
+			goto stale;
+	for (i = 0; i < h->nr_symbols; i++)
+		if (syms[i].name >= h->strtab_size ||
+		    syms[i].namespace >= h->strtab_size ||
+		    syms[i].module >= h->nr_modules ||
+		    syms[i].export > export_unknown)
+			goto stale;
+
+	mods = NOFAIL(calloc(h->nr_modules + 1, sizeof(*mods)));
+	for (i = 0; i < h->nr_modules; i++)
+		mods[i] = find_dump_module(strtab + modnames[i]);
+	for (i = 0; i < h->nr_symbols; i++)
+		add_dump_symbol(strtab + syms[i].name, mods[syms[i].module],
+				syms[i].export, syms[i].crc,
+				strtab + syms[i].namespace);
+	free(mods);
+
+	release_file(map, size);
+	return true;
+
+stale:
+	release_file(map, size);
+	return false;
+}
+
+/* Return the offset or index of @name in @table, adding it if new */
+static uint32_t symvers_cache_intern(struct hash_table *table,
+				     struct buffer *strtab, const char *name,
+				     uint32_t *next)
+{
+	struct symvers_cache_string *str = hash_table_find(table, name);
+	int len;
+
+	if (str)
+		return str->value;
+
+	len = strlen(name) + 1;
+	str = NOFAIL(malloc(sizeof(*str) + len));
+	memcpy(str->name, name, len);
+	if (next) {
+		/* an index: the name is stored once, in the module list */
+		str->value = (*next)++;
+	} else {
+		str->value = strtab->pos;
+		buf_write(strtab, name, len);
+	}
+	hash_table_add(table, str);
+	return str->value;
+}
+
+static void symvers_cache_add(struct symvers_cache *cache,
+			      const char *symname, const char *modname,
+			      enum export export, unsigned int crc,
+			      const char *namespace)
+{
+	struct symvers_cache_symbol sym;
+	uint32_t nr_modules = cache->nr_modules;
+
+	sym.crc = crc;
+	sym.export = export;
+	sym.namespace = symvers_cache_intern(&cache->strings, &cache->strtab,
+					     namespace, NULL);
+	sym.module = symvers_cache_intern(&cache->module_index, NULL, modname,
+					  &cache->nr_modules);
+	if (cache->nr_modules != nr_modules) {
+		uint32_t offset = cache->strtab.pos;
+
+		buf_write(&cache->strtab, modname, strlen(modname) + 1);
+		buf_write(&cache->modules, (char *)&offset, sizeof(offset));
+	}
+	sym.name = cache->strtab.pos;
+	buf_write(&cache->strtab, symname, strlen(symname) + 1);
+
+	buf_write(&cache->symbols, (char *)&sym, sizeof(sym));
+	cache->nr_symbols++;
+}
+
+static void symvers_cache_free_table(struct hash_table *table)
+{
+	unsigned int n;
+
+	for (n = 0; n < table->size; n++)
+		free(table->slots[n].entry);
+	free(table->slots);
+}
+
+static void symvers_cache_free(struct symvers_cache *cache)
+{
+	free(cache->modules.p);
+	free(cache->symbols.p);
+	free(cache->strtab.p);
+	symvers_cache_free_table(&cache->module_index);
+	symvers_cache_free_table(&cache->strings);
+}
+
+/* Write the cache atomically; failing to is not an error */
+static void write_dump_cache(const char *fname, const struct stat *st,
+			     struct symvers_cache *cache)
+{
+	struct symvers_cache_header h = {
+		.magic = SYMVERS_CACHE_MAGIC,
+		.version = SYMVERS_CACHE_VERSION,
+		.size = st->st_size,
+		.mtime_sec = st->st_mtim.tv_sec,
+		.mtime_nsec = st->st_mtim.tv_nsec,
+		.ino = st->st_ino,
+		.nr_modules = cache->nr_modules,
+		.nr_symbols = cache->nr_symbols,
+		.strtab_size = cache->strtab.pos,
+	};
+	char cname[PATH_MAX], tmp[PATH_MAX + 16];
+	FILE *file;
+	bool ok;
+
+	symvers_cache_name(cname, fname);
+	snprintf(tmp, sizeof(tmp), "%s.%d", cname, (int)getpid());
+
+	file = fopen(tmp, "w");
+	if (!file)
+		return;
+
+	ok = fwrite(&h, sizeof(h), 1, file) == 1;
+	if (ok && cache->modules.pos)
+		ok = fwrite(cache->modules.p, cache->modules.pos, 1, file) == 1;
+	if (ok && cache->symbols.pos)
+		ok = fwrite(cache->symbols.p, cache->symbols.pos, 1, file) == 1;
+	if (ok && cache->strtab.pos)
+		ok = fwrite(cache->strtab.p, cache->strtab.pos, 1, file) == 1;
+	if (fclose(file) != 0)
+		ok = false;
+
+	if (!ok || rename(tmp, cname) != 0)
+		unlink(tmp);
+}
+
 /* parse Module.symvers file. line format:
  * 0x12345678<tab>symbol<tab>module<tab>export<tab>namespace
  **/
 static void read_dump(const char *fname)
 {
+	struct symvers_cache cache = SYMVERS_CACHE_INIT;
 	char *buf, *pos, *line;
+	struct stat st;
+	bool use_cache;
+
+	/*
+	 * Only the dumps of an external module build are read over and
+	 * over; the st taken before reading makes a dump that changes
+	 * under us leave a stale cache rather than a wrong one.
+	 */
+	use_cache = external_module && stat(fname, &st) == 0;
+	if (use_cache && read_dump_cache(fname, &st))
+		return;
 
 	buf = read_text_file(fname);
 	if (!buf)
@@ -2430,11 +2964,14 @@ static void read_dump(const char *fname)
 
 	pos = buf;
 
+	/* Also keeps the strings non-empty for an empty dump */
+	if (use_cache)
+		symvers_cache_intern(&cache.strings, &cache.strtab, "", NULL);
+
 	while ((line = get_line(&pos))) {
 		char *symname, *namespace, *modname, *d, *export;
+		enum export ex;
 		unsigned int crc;
-		struct module *mod;
-		struct symbol *s;
 
 		if (!(symname = strchr(line, '\t')))
 			goto fail;
@@ -2452,17 +2989,18 @@ static void read_dump(const char *fname)
 		crc = strtoul(line, &d, 16);
 		if (*symname == '\0' || *modname == '\0' || *d != '\0')
 			goto fail;
-		mod = find_module(modname);
-		if (!mod) {
-			mod = new_module(modname);
-			mod->from_dump = 1;
-		}
-		s = sym_add_exported(symname, mod, export_no(export));
-		s->is_static = 0;
-		sym_set_crc(symname, crc);
-		sym_update_namespace(symname, namespace);
+		ex = export_no(export);
+		add_dump_symbol(symname, find_dump_module(modname), ex, crc,
+				namespace);
+		if (use_cache)
+			symvers_cache_add(&cache, symname, modname, ex, crc,
+					  namespace);
 	}
 	free(buf);
+	if (use_cache) {
+		write_dump_cache(fname, &st, &cache);
+		symvers_cache_free(&cache);
+	}
 	return;
 fail:
 	free(buf);
@@ -2476,18 +3014,15 @@ static void write_dump(const char *fname)
 	const char *namespace;
 	int n;
 
-	for (n = 0; n < SYMBOL_HASH_SIZE ; n++) {
-		symbol = symbolhash[n];
-		while (symbol) {
-			if (!symbol->module->from_dump) {
-				namespace = symbol->namespace;
-				buf_printf(&buf, "0x%08x\t%s\t%s\t%s\t%s\n",
-					   symbol->crc, symbol->name,
-					   symbol->module->name,
-					   export_str(symbol->export),
-					   namespace ? namespace : "");
-			}
-			symbol = symbol->next;
+	for (n = 0; n < symbol_table.size; n++) {
+		symbol = symbol_table.slots[n].entry;
+		if (symbol && !symbol->module->from_dump) {
+			namespace = symbol->namespace;
+			buf_printf(&buf, "0x%08x\t%s\t%s\t%s\t%s\n",
+				   symbol->crc, symbol->name,
+				   symbol->module->name,
+				   export_str(symbol->export),
+				   namespace ? namespace : "");
 		}
 	}
 	write_buf(&buf, fname);
@@ -2630,15 +3165,13 @@ int main(int argc, char **argv)
 	if (sec_mismatch_count && !sec_mismatch_warn_only)
 		error("Section mismatches detected.\n"
 		      "Set CONFIG_SECTION_MISMATCH_WARN_ONLY=y to allow them.\n");
-	for (n = 0; n < SYMBOL_HASH_SIZE; n++) {
-		struct symbol *s;
-
-		for (s = symbolhash[n]; s; s = s->next) {
-			if (s->is_static)
-				error("\"%s\" [%s] is a static %s\n",
-				      s->name, s->module->name,
-				      export_str(s->export));
-		}
+	for (n = 0; n < symbol_table.size; n++) {
+		struct symbol *s = symbol_table.slots[n].entry;
+
+		if (s && s->is_static)
+			error("\"%s\" [%s] is a static %s\n",
+			      s->name, s->module->name,
+			      export_str(s->export));
 	}
 
 	free(buf.p);
@@ -138,21 +138,21 @@ static int fn_is_fake_mcount(Elf_Rel const *rp)
 {
 	return 0;
 }
-static int (*is_fake_mcount)(Elf_Rel const *rp) = fn_is_fake_mcount;
+static __thread int (*is_fake_mcount)(Elf_Rel const *rp) = fn_is_fake_mcount;
 
 static uint_t fn_ELF_R_SYM(Elf_Rel const *rp)
 {
 	return ELF_R_SYM(_w(rp->r_info));
 }
-static uint_t (*Elf_r_sym)(Elf_Rel const *rp) = fn_ELF_R_SYM;
+static __thread uint_t (*Elf_r_sym)(Elf_Rel const *rp) = fn_ELF_R_SYM;
 
 static void fn_ELF_R_INFO(Elf_Rel *const rp, unsigned sym, unsigned type)
 {
 	rp->r_info = _w(ELF_R_INFO(sym, type));
 }
-static void (*Elf_r_info)(Elf_Rel *const rp, unsigned sym, unsigned type) = fn_ELF_R_INFO;
+static __thread void (*Elf_r_info)(Elf_Rel *const rp, unsigned sym, unsigned type) = fn_ELF_R_INFO;
 
-static int mcount_adjust = 0;
+static __thread int mcount_adjust = 0;
 
 /*
  * MIPS mcount long call has 2 _mcount symbols, only the position of the 1st
@@ -177,7 +177,7 @@ static int mcount_adjust = 0;
 
 static int MIPS_is_fake_mcount(Elf_Rel const *rp)
 {
-	static Elf_Addr old_r_offset = ~(Elf_Addr)0;
+	static __thread Elf_Addr old_r_offset = ~(Elf_Addr)0;
 	Elf_Addr current_r_offset = _w(rp->r_offset);
 	int is_fake;
 
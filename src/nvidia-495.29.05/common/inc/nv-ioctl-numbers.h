@@ -38,5 +38,7 @@
 #define NV_ESC_ATTACH_GPUS_TO_FD (NV_IOCTL_BASE + 12)
 #define NV_ESC_QUERY_DEVICE_INTR (NV_IOCTL_BASE + 13)
 #define NV_ESC_SYS_PARAMS        (NV_IOCTL_BASE + 14)
+#define NV_ESC_GPU_STATUS        (NV_IOCTL_BASE + 17)
+#define NV_ESC_GET_EVENTS        (NV_IOCTL_BASE + 18)
 
 #endif
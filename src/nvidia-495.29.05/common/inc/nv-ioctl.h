@@ -126,4 +126,72 @@ typedef struct nv_ioctl_register_fd
     int ctl_fd;
 } nv_ioctl_register_fd_t;
 
+/*
+ * GPU status snapshot, returned for all GPUs by a single NV_ESC_GPU_STATUS
+ * call on the control device (through NV_ESC_IOCTL_XFER_CMD). The
+ * parameter buffer is an nv_ioctl_gpu_status_t header followed by an array
+ * of nv_ioctl_gpu_status_entry_t, sized by the caller.
+ *
+ * version must be set to NV_IOCTL_GPU_STATUS_VERSION; the driver always
+ * returns its own version and entry size, and fails the call if the
+ * version doesn't match. num_gpus is the number of GPUs in the system;
+ * the call fails if the array can't hold them all.
+ */
+#define NV_IOCTL_GPU_STATUS_VERSION 1
+
+/* The GPU is excluded from use */
+#define NV_IOCTL_GPU_STATUS_FLAG_EXCLUDED     0x00000001
+/* The GPU is initialized; NUMA memory and offline pages are valid */
+#define NV_IOCTL_GPU_STATUS_FLAG_INITIALIZED  0x00000002
+/* The GPU was busy (e.g. being opened), NUMA state could not be read */
+#define NV_IOCTL_GPU_STATUS_FLAG_BUSY         0x00000004
+
+typedef struct nv_ioctl_gpu_status_entry
+{
+    nv_pci_info_t pci_info;
+    NvU32         gpu_id;
+    NvU32         minor_number;
+    NvU32         interrupt_line;
+    NvU32         flags;
+    NvS32         numa_node_id;
+    NvS32         numa_status;      /* NV_IOCTL_NUMA_STATUS_* */
+    NvU32         num_offline_pages;
+    NvU64         numa_mem_addr     NV_ALIGN_BYTES(8);
+    NvU64         numa_mem_size     NV_ALIGN_BYTES(8);
+} nv_ioctl_gpu_status_entry_t;
+
+typedef struct nv_ioctl_gpu_status
+{
+    NvU32 version;
+    NvU32 entry_size;
+    NvU32 num_gpus;
+    NvU32 reserved;
+} nv_ioctl_gpu_status_t;
+
+/*
+ * Batched event drain, an alternative to fetching one event per RM
+ * NV_ESC_RM_GET_EVENT call. The parameter buffer is an
+ * nv_ioctl_get_events_t header followed by an array of nv_ioctl_event_t,
+ * sized by the caller, and is passed through NV_ESC_IOCTL_XFER_CMD when it
+ * doesn't fit in the _IOC size field.
+ *
+ * The driver dequeues as many of the file's pending events as fit, in
+ * posting order, and returns their count in num_events. more_events is set
+ * if events are still pending afterwards. Once poll() reports the file as
+ * readable, a burst of events can be drained in a single call.
+ */
+typedef struct nv_ioctl_event
+{
+    NvHandle hObject;
+    NvU32    index;
+    NvU32    info32;
+    NvU16    info16;
+} nv_ioctl_event_t;
+
+typedef struct nv_ioctl_get_events
+{
+    NvU32 num_events;
+    NvU32 more_events;
+} nv_ioctl_get_events_t;
+
 #endif
@@ -41,6 +41,13 @@ static inline void nv_kref_get(nv_kref_t *nv_kref)
     atomic_inc(&nv_kref->refcount);
 }
 
+// Take a reference unless the refcount already dropped to zero. Returns 0 if
+// no reference was taken.
+static inline int nv_kref_get_unless_zero(nv_kref_t *nv_kref)
+{
+    return atomic_add_unless(&nv_kref->refcount, 1, 0);
+}
+
 static inline int nv_kref_put(nv_kref_t *nv_kref,
                               void (*release)(nv_kref_t *nv_kref))
 {
@@ -79,6 +79,17 @@
 //
 //    nv_kthread_q_init_on_node() initializes a queue on a specific NUMA node.
 //
+//    or
+//
+//    nv_kthread_q_init_on_node_flags() initializes a queue on a specific NUMA
+//    node, with optional behavior selected by NV_KTHREAD_Q_FLAGS_* flags.
+//
+//    or
+//
+//    nv_kthread_q_init_with_attrs() initializes a queue with the NUMA node,
+//    flags, CPU affinity and scheduling policy given in an
+//    nv_kthread_q_attrs_t.
+//
 // 3. Scheduling things for the queue to run
 //
 //    The nv_kthread_q_schedule_q_item() routine will schedule a q_item to run.
@@ -106,6 +117,27 @@ struct nv_kthread_q
     atomic_t main_loop_should_exit;
 
     struct task_struct *q_kthread;
+
+    // NV_KTHREAD_Q_FLAGS_* flags the queue was initialized with
+    unsigned flags;
+
+    // Only used in NV_KTHREAD_Q_FLAGS_LOCKLESS mode, instead of q_list_head,
+    // q_lock and q_sem. Producers push items onto this singly-linked stack
+    // with cmpxchg, and the kthread detaches the whole stack at once.
+    nv_kthread_q_item_t *q_lockless_head;
+
+    // Maximum number of items run per wakeup in the default mode
+    unsigned max_batch;
+
+    // Only updated by the kthread, and only if the queue was initialized with
+    // NV_KTHREAD_Q_FLAGS_STATS. See nv_kthread_q_get_stats().
+    struct
+    {
+        u64 items_run;
+        u64 wakeups;
+        u64 total_latency_ns;
+        u64 max_latency_ns;
+    } stats;
 };
 
 struct nv_kthread_q_item
@@ -113,8 +145,79 @@ struct nv_kthread_q_item
     struct list_head q_list_node;
     nv_q_func_t function_to_run;
     void *function_args;
+
+    // Only used by queues in NV_KTHREAD_Q_FLAGS_LOCKLESS mode. Bit 0 of
+    // q_lockless_pending is set while the item is pending in a queue.
+    nv_kthread_q_item_t *q_lockless_next;
+    unsigned long q_lockless_pending;
+
+    // Time at which the item was scheduled, only set by queues initialized
+    // with NV_KTHREAD_Q_FLAGS_STATS.
+    u64 q_schedule_time_ns;
 };
 
+// Items are submitted without taking q_lock, and the kthread is only woken up
+// when the queue goes from empty to non-empty. The kthread runs all of the
+// items that were pending at wakeup time, in submission order, before sleeping
+// again. Under heavy submission load, this removes the spinlock and semaphore
+// operations from both the producers and the kthread.
+//
+// A q_item must not be pending in a lockless queue and in a regular queue at
+// the same time.
+#define NV_KTHREAD_Q_FLAGS_LOCKLESS 0x1
+
+// Collect per-queue statistics: number of items run and wakeups, and the
+// latency from scheduling an item to running it. This adds a timestamp read to
+// every nv_kthread_q_schedule_q_item() call.
+#define NV_KTHREAD_Q_FLAGS_STATS    0x2
+
+// Upper bound of nv_kthread_q_attrs_t::max_batch
+#define NV_KTHREAD_Q_MAX_BATCH 32
+
+typedef enum
+{
+    // SCHED_NORMAL, with the nice level in nv_kthread_q_attrs_t::nice
+    NV_KTHREAD_Q_SCHED_NORMAL = 0,
+
+    // SCHED_FIFO, with the default real-time priority used by the kernel for
+    // in-kernel users (MAX_RT_PRIO / 2)
+    NV_KTHREAD_Q_SCHED_FIFO,
+} nv_kthread_q_sched_policy_t;
+
+typedef struct nv_kthread_q_attrs
+{
+    // NUMA node for the kthread stack, or NV_KTHREAD_NO_NODE. See
+    // nv_kthread_q_init_on_node().
+    int preferred_node;
+
+    // Any combination of the NV_KTHREAD_Q_FLAGS_* values, or 0
+    unsigned flags;
+
+    // CPUs the kthread is allowed to run on, or NULL to leave the affinity
+    // untouched. Requires NV_KTHREAD_Q_SUPPORTS_SCHED_ATTRS().
+    const struct cpumask *cpumask;
+
+    // Scheduling policy of the kthread. NV_KTHREAD_Q_SCHED_FIFO requires
+    // NV_KTHREAD_Q_SUPPORTS_SCHED_ATTRS().
+    nv_kthread_q_sched_policy_t sched_policy;
+
+    // Nice level (-20..19) for NV_KTHREAD_Q_SCHED_NORMAL. Ignored otherwise.
+    int nice;
+
+    // Maximum number of items the kthread runs per wakeup before sleeping
+    // again. 0 is the same as 1. Queues in NV_KTHREAD_Q_FLAGS_LOCKLESS mode
+    // always run all the pending items per wakeup, so this is ignored.
+    unsigned max_batch;
+} nv_kthread_q_attrs_t;
+
+typedef struct nv_kthread_q_stats
+{
+    u64 items_run;
+    u64 wakeups;
+    u64 total_latency_ns;
+    u64 max_latency_ns;
+} nv_kthread_q_stats_t;
+
 #if defined(NV_KTHREAD_CREATE_ON_NODE_PRESENT)
     #define NV_KTHREAD_Q_SUPPORTS_AFFINITY() 1
 #else
@@ -127,6 +230,15 @@ struct nv_kthread_q_item
 
 #define NV_KTHREAD_NO_NODE NUMA_NO_NODE
 
+// Setting the CPU affinity and the real-time scheduling policy of a kthread
+// relies on GPL-only kernel symbols, so it is only available to the modules
+// that are allowed to use them.
+#if defined(NVIDIA_UVM_ENABLED)
+    #define NV_KTHREAD_Q_SUPPORTS_SCHED_ATTRS() 1
+#else
+    #define NV_KTHREAD_Q_SUPPORTS_SCHED_ATTRS() 0
+#endif
+
 //
 // The queue must not be used before calling this routine.
 //
@@ -176,6 +288,38 @@ static inline int nv_kthread_q_init(nv_kthread_q_t *q, const char *qname)
     return nv_kthread_q_init_on_node(q, qname, NV_KTHREAD_NO_NODE);
 }
 
+//
+// This routine is the same as nv_kthread_q_init_on_node(), but flags selects
+// optional queue behavior (any combination of the NV_KTHREAD_Q_FLAGS_* values
+// above, or 0 for the default behavior). The rest of the API works the same
+// way regardless of the flags.
+//
+int nv_kthread_q_init_on_node_flags(nv_kthread_q_t *q,
+                                    const char *qname,
+                                    int preferred_node,
+                                    unsigned flags);
+
+//
+// This routine is the same as nv_kthread_q_init_on_node(), with all the queue
+// properties taken from attrs. The CPU affinity and the scheduling policy are
+// applied before the kthread starts running q_items.
+//
+// Returns -ENOTSUPP if attrs requests a CPU affinity or SCHED_FIFO and
+// NV_KTHREAD_Q_SUPPORTS_SCHED_ATTRS() == 0, and -EINVAL if any of the values
+// in attrs is out of range.
+//
+int nv_kthread_q_init_with_attrs(nv_kthread_q_t *q,
+                                 const char *qname,
+                                 const nv_kthread_q_attrs_t *attrs);
+
+//
+// Returns a snapshot of the queue statistics. All values are 0 unless the
+// queue was initialized with NV_KTHREAD_Q_FLAGS_STATS. The snapshot is not
+// atomic with respect to the kthread, so values may be slightly inconsistent
+// with each other. The mean latency is total_latency_ns / items_run.
+//
+void nv_kthread_q_get_stats(nv_kthread_q_t *q, nv_kthread_q_stats_t *stats);
+
 //
 // The caller is responsible for stopping all queues, by calling this routine
 // before, for example, kernel module unloading. This nv_kthread_q_stop()
@@ -252,4 +396,11 @@ int nv_kthread_q_schedule_q_item(nv_kthread_q_t *q,
 // Built-in test. Returns -1 if any subtest failed, or 0 upon success.
 int nv_kthread_q_run_self_test(void);
 
+// Built-in benchmark. num_producers kthreads schedule q_items concurrently on
+// a queue of each mode, and the percentiles of the latency from scheduling a
+// q_item to running it, plus the throughput in q_items per second, are
+// printed to the kernel log. num_producers must be in [1, 64]. Returns -1 upon
+// failure, or 0 upon success.
+int nv_kthread_q_run_benchmark(unsigned num_producers);
+
 #endif // __NV_KTHREAD_QUEUE_H__
@@ -611,6 +611,13 @@ static NvBool nv_numa_node_has_memory(int node_id)
             NV_MEMDBG_ADD(ptr, size); \
     }
 
+#define NV_KMALLOC_NODE(ptr, size, node) \
+    { \
+        (ptr) = kmalloc_node(size, NV_GFP_KERNEL, node); \
+        if (ptr) \
+            NV_MEMDBG_ADD(ptr, size); \
+    }
+
 #define NV_KMALLOC_ATOMIC(ptr, size) \
     { \
         (ptr) = kmalloc(size, NV_GFP_ATOMIC); \
@@ -641,7 +648,8 @@ static NvBool nv_numa_node_has_memory(int node_id)
 
 #define NV_ALLOC_PAGES_NODE(ptr, nid, order, gfp_mask) \
     { \
-        (ptr) = (unsigned long)page_address(alloc_pages_node(nid, gfp_mask, order)); \
+        struct page *__page = alloc_pages_node(nid, gfp_mask, order); \
+        (ptr) = (__page != NULL) ? (unsigned long)page_address(__page) : 0; \
     }
 
 #define NV_GET_FREE_PAGES(ptr, order, gfp_mask)      \
@@ -1097,6 +1105,8 @@ static inline void nv_kmem_ctor_dummy(void *arg)
 
 #define NV_KMEM_CACHE_ALLOC(kmem_cache)     \
     kmem_cache_alloc(kmem_cache, GFP_KERNEL)
+#define NV_KMEM_CACHE_ALLOC_NODE(kmem_cache, node) \
+    kmem_cache_alloc_node(kmem_cache, GFP_KERNEL, node)
 #define NV_KMEM_CACHE_FREE(ptr, kmem_cache) \
     kmem_cache_free(kmem_cache, ptr)
 
@@ -1171,6 +1181,7 @@ typedef struct nvidia_pte_s {
     unsigned int    guest_pfn;
 #endif
     unsigned int    page_count;
+    unsigned int    coherent_pages;     /* size of the dma_alloc_coherent() chunk this page heads */
 } nvidia_pte_t;
 
 
@@ -1198,6 +1209,7 @@ typedef struct nv_alloc_s {
         NvBool physical    : 1;
         NvBool unencrypted : 1;
         NvBool coherent    : 1;
+        NvBool compound    : 1;
     } flags;
     unsigned int   cache_type;
     unsigned int   num_pages;
@@ -1418,6 +1430,10 @@ typedef enum
 /* Linux version of the opaque type used for os_queue_work_item() */
 struct os_work_queue {
     nv_kthread_q_t nvk;
+
+    // Stack for the RM work items run by nvk. They run one at a time on
+    // nvk's kthread, so they can all share it.
+    nvidia_stack_t *sp;
 };
 
 /* Linux version of the opaque type used for os_wait_*() */
@@ -1530,6 +1546,24 @@ typedef struct nv_linux_state_s {
     /* get a timer callback every second */
     struct nv_timer rc_timer;
 
+    /*
+     * With NVreg_CoalesceRcTimers, the device is on the list of the shared
+     * RC timer instead of using rc_timer. Protected by nv_rc_timer_lock.
+     */
+    struct list_head rc_timer_list_node;
+    NvBool rc_timer_coalesced;
+
+    /*
+     * Keeps the device started for NVreg_GpuIdleLingerTime seconds after
+     * its last close, so that the next open doesn't need to start it again.
+     * Protected by ldata_lock.
+     */
+    struct nv_timer idle_linger_timer;
+    nv_kthread_q_item_t idle_linger_q_item;
+    unsigned long idle_linger_deadline;
+    NvBool idle_lingering;
+    NvBool idle_linger_disabled;
+
     /* lock for linux-specific data, not used by core rm */
     struct semaphore ldata_lock;
 
@@ -1539,6 +1573,9 @@ typedef struct nv_linux_state_s {
     NvU32 minor_num;
     struct nv_linux_state_s *next;
 
+    /* Entry in the gpu_id lookup table, see find_gpu_id() */
+    struct hlist_node gpu_id_node;
+
     /* DRM private information */
     struct drm_device *drm;
 
@@ -1579,7 +1616,7 @@ typedef struct nv_linux_state_s {
     struct os_work_queue queue;
 
     /* GPU user mapping revocation/remapping (only for non-CTL device) */
-    struct semaphore mmap_lock; /* Protects all fields in this category */
+    struct rw_semaphore mmap_lock; /* Protects all fields in this category */
     struct list_head open_files;
     NvBool all_mappings_revoked;
     NvBool safe_to_mmap;
@@ -1726,6 +1763,13 @@ typedef enum
     NV_FOPS_STACK_INDEX_COUNT
 } nvidia_entry_point_index_t;
 
+/*
+ * Maximum number of additional stacks a file can allocate so that ioctls
+ * issued concurrently on it can enter RM in parallel with the one holding
+ * fops_sp[NV_FOPS_STACK_INDEX_IOCTL].
+ */
+#define NV_FOPS_IOCTL_STACK_POOL_SIZE 8
+
 typedef struct
 {
     nv_file_private_t nvfp;
@@ -1733,6 +1777,16 @@ typedef struct
     nvidia_stack_t *sp;
     nvidia_stack_t *fops_sp[NV_FOPS_STACK_INDEX_COUNT];
     struct semaphore fops_sp_lock[NV_FOPS_STACK_INDEX_COUNT];
+    struct
+    {
+        /* Protects all fields in this struct */
+        nv_spinlock_t lock;
+        /* Idle stacks, allocated on demand */
+        nvidia_stack_t *free[NV_FOPS_IOCTL_STACK_POOL_SIZE];
+        unsigned int num_free;
+        /* Stacks allocated so far, idle or in use */
+        unsigned int num_allocated;
+    } ioctl_sp_pool;
     nv_alloc_t *free_list;
     void *nvptr;
     nvidia_event_t *event_data_head, *event_data_tail;
@@ -1836,6 +1890,15 @@ static inline NV_STATUS nv_check_gpu_state(nv_state_t *nv)
 
 extern NvU32 NVreg_EnableUserNUMAManagement;
 extern NvU32 NVreg_RegisterPCIDriver;
+extern NvU32 NVreg_EnableParallelDevicePowerManagement;
+extern NvU32 NVreg_EnableHugeSysmemAllocations;
+extern NvU32 NVreg_UncachedSysmemPoolSize;
+extern NvU32 NVreg_MmapFaultAroundSize;
+extern NvU32 NVreg_SpreadMsixInterrupts;
+extern NvU32 NVreg_EnableOsAllocCaches;
+extern NvU32 NVreg_EnableAsyncProbe;
+extern NvU32 NVreg_GpuIdleLingerTime;
+extern NvU32 NVreg_CoalesceRcTimers;
 
 extern NvU32 num_probed_nv_devices;
 extern NvU32 num_nv_devices;
@@ -57,6 +57,9 @@ static inline void nv_free_msix_irq(nv_linux_state_t *nvl)
 
     for (i = 0; i < nvl->num_intr; i++)
     {
+        // Clear any hint set by nv_request_msix_irq(); free_irq() warns
+        // about vectors that still have one.
+        irq_set_affinity_hint(nvl->msix_entries[i].vector, NULL);
         free_irq(nvl->msix_entries[i].vector, (void *)nvl);
     }
 }
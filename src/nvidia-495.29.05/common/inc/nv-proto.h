@@ -58,6 +58,14 @@ NV_STATUS   nv_alloc_contig_pages       (nv_state_t *, nv_alloc_t *);
 void        nv_free_contig_pages        (nv_alloc_t *);
 NV_STATUS   nv_alloc_system_pages       (nv_state_t *, nv_alloc_t *);
 void        nv_free_system_pages        (nv_alloc_t *);
+void        nv_vm_init                  (void);
+void        nv_vm_exit                  (void);
+
+void        nv_os_alloc_caches_init     (void);
+void        nv_os_alloc_caches_exit     (void);
+NvBool      nv_os_alloc_cache_get_stats (unsigned int, NvU32 *, NvU64 *, NvU64 *);
+int         nv_os_work_queue_init       (struct os_work_queue *, int);
+void        nv_os_work_queue_stop       (struct os_work_queue *);
 
 void        nv_address_space_init_once  (struct address_space *mapping);
 
@@ -90,6 +98,9 @@ NV_STATUS     nv_parse_per_device_option_string(nvidia_stack_t *sp);
 nv_linux_state_t * find_uuid(const NvU8 *uuid);
 void          nv_report_error(struct pci_dev *dev, NvU32 error_number, const char *format, va_list ap);
 void          nv_shutdown_adapter(nvidia_stack_t *, nv_state_t *, nv_linux_state_t *);
+void          nv_idle_linger_init(nv_linux_state_t *);
+void          nv_idle_linger_stop(nv_linux_state_t *, nvidia_stack_t *);
+void          nv_idle_linger_end_locked(nv_linux_state_t *, nvidia_stack_t *);
 void          nv_dev_free_stacks(nv_linux_state_t *);
 NvBool        nv_lock_init_locks(nvidia_stack_t *, nv_state_t *);
 void          nv_lock_destroy_locks(nvidia_stack_t *, nv_state_t *);
@@ -63,4 +63,23 @@ static inline void nv_timer_setup(struct nv_timer *nv_timer,
 #endif
 }
 
+/*
+ * Deferrable timers don't wake up an idle CPU; they run on the next
+ * wakeup after they expire.
+ */
+static inline void nv_timer_setup_deferrable(struct nv_timer *nv_timer,
+                                             void (*callback)(struct nv_timer *nv_timer))
+{
+    nv_timer->nv_timer_callback = callback;
+
+#if defined(NV_TIMER_SETUP_PRESENT)
+    timer_setup(&nv_timer->kernel_timer, nv_timer_callback_typed_data,
+                TIMER_DEFERRABLE);
+#else
+    init_timer_deferrable(&nv_timer->kernel_timer);
+    nv_timer->kernel_timer.function = nv_timer_callback_anon_data;
+    nv_timer->kernel_timer.data = (unsigned long)nv_timer;
+#endif
+}
+
 #endif // __NV_TIMER_H__
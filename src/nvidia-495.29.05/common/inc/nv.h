@@ -786,6 +786,7 @@ NV_STATUS NV_API_CALL nv_get_nvlink_line_rate    (nv_state_t *, NvU32 *);
 #endif
 
 NV_STATUS NV_API_CALL nv_revoke_gpu_mappings     (nv_state_t *);
+NV_STATUS NV_API_CALL nv_revoke_gpu_mappings_multiple (nv_state_t **, NvU32);
 void      NV_API_CALL nv_acquire_mmap_lock       (nv_state_t *);
 void      NV_API_CALL nv_release_mmap_lock       (nv_state_t *);
 NvBool    NV_API_CALL nv_get_all_mappings_revoked_locked (nv_state_t *);
@@ -286,6 +286,35 @@ build_cflags() {
     fi
 }
 
+cache_key() {
+    #
+    # Print a key identifying everything the compile test results depend
+    # on: this script, the compiler, the compile test CFLAGS, the build
+    # type and the contents of the kernel's header directories. Results
+    # cached under the same key can be reused by later builds.
+    #
+    # build_cflags embeds the PID of the conftest.sh process that ran it;
+    # strip it so the key is stable from one build to the next.
+    #
+    HEADER_DIRS="$HEADERS $SOURCES/arch/$KERNEL_ARCH/include"
+
+    if [ "$OUTPUT" != "$SOURCES" ]; then
+        HEADER_DIRS="$HEADER_DIRS $OUTPUT/include $OUTPUT/arch/$KERNEL_ARCH/include"
+    fi
+
+    HEADER_FILES=`find -L $HEADER_DIRS -type f -name '*.h' 2> /dev/null | \
+        LC_ALL=C sort`
+
+    {
+        cat conftest.sh
+        $CC --version 2>&1
+        echo "$ARCH $CFLAGS" | sed -e 's/#conftest[0-9]*/#conftest/g'
+        echo "$VGX_BUILD $VGX_KVM_BUILD $GRID_BUILD $GRID_BUILD_CSP"
+        echo "$HEADER_FILES"
+        echo "$HEADER_FILES" | xargs cat 2> /dev/null
+    } | md5sum | cut -d ' ' -f 1
+}
+
 CONFTEST_PREAMBLE="#include \"conftest/headers.h\"
     #if defined(NV_LINUX_KCONFIG_H_PRESENT)
     #include <linux/kconfig.h>
@@ -2561,6 +2590,23 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_PCI_DEV_HAS_ATS_ENABLED" "" "types"
         ;;
 
+        device_driver_has_probe_type)
+            #
+            # Determine if the 'device_driver' structure has a 'probe_type'
+            # member.
+            #
+            # Added by commit 765230b5f084 ("driver-core: add asynchronous
+            # probing support for drivers") in v4.2-rc1 (2015-03-30)
+            #
+            CODE="
+            #include <linux/device.h>
+            int conftest_device_driver_has_probe_type(void) {
+                return offsetof(struct device_driver, probe_type);
+            }"
+
+            compile_check_conftest "$CODE" "NV_DEVICE_DRIVER_HAS_PROBE_TYPE" "" "types"
+        ;;
+
         get_user_pages)
             #
             # Conftest for get_user_pages()
@@ -3239,6 +3285,24 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_KTHREAD_CREATE_ON_NODE_PRESENT" "" "functions"
         ;;
 
+        sched_set_fifo)
+            #
+            # Determine if sched_set_fifo() is present.
+            #
+            # sched_set_fifo() was added by commit 7318d4cc14c8
+            # ("sched: Provide sched_set_fifo()") in v5.9, and
+            # sched_setscheduler() stopped being exported to modules soon
+            # after that.
+            #
+            CODE="
+            #include <linux/sched.h>
+            void conftest_sched_set_fifo(void) {
+                sched_set_fifo();
+            }"
+
+            compile_check_conftest "$CODE" "NV_SCHED_SET_FIFO_PRESENT" "" "functions"
+        ;;
+
         cpumask_of_node)
             #
             # Determine whether cpumask_of_node is available.
@@ -3389,6 +3453,39 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_VMF_INSERT_PFN_PRESENT" "" "functions"
         ;;
 
+        vm_insert_pages)
+            #
+            # Determine if the function vm_insert_pages() is present.
+            #
+            # Added by commit 8cd3984d81d5 ("mm/memory.c: add
+            # vm_insert_pages()") in v5.8 (2020-04-10)
+            #
+            CODE="
+            #include <linux/mm.h>
+            void conftest_vm_insert_pages(void) {
+                vm_insert_pages();
+            }"
+
+            compile_check_conftest "$CODE" "NV_VM_INSERT_PAGES_PRESENT" "" "functions"
+        ;;
+
+        alloc_pages_bulk_array_node)
+            #
+            # Determine if the function alloc_pages_bulk_array_node() is
+            # present.
+            #
+            # Added along with the array-based interface to the bulk page
+            # allocator in v5.13.
+            #
+            CODE="
+            #include <linux/gfp.h>
+            void conftest_alloc_pages_bulk_array_node(void) {
+                alloc_pages_bulk_array_node();
+            }"
+
+            compile_check_conftest "$CODE" "NV_ALLOC_PAGES_BULK_ARRAY_NODE_PRESENT" "" "functions"
+        ;;
+
         drm_framebuffer_get)
             #
             # Determine if the function drm_framebuffer_get() is present.
@@ -5328,7 +5425,37 @@ case "$5" in
         CFLAGS=$1
         shift
 
-        for i in $*; do compile_test $i; done
+        #
+        # If NV_CONFTEST_CACHE names a directory, reuse the results that
+        # an earlier build with the same cache key stored there, and store
+        # the results of any test that had to be compiled. The cache is
+        # only an optimization: failure to write to it is ignored.
+        #
+        if [ -n "$NV_CONFTEST_CACHE" ]; then
+            trap 'rm -f conftest$$.h' 0
+        fi
+
+        for i in $*; do
+            if [ -z "$NV_CONFTEST_CACHE" ]; then
+                compile_test $i
+                continue
+            fi
+
+            CACHE_FILE="$NV_CONFTEST_CACHE/$i.h"
+
+            if [ -f "$CACHE_FILE" ]; then
+                cat "$CACHE_FILE"
+                continue
+            fi
+
+            compile_test $i > conftest$$.h
+            cat conftest$$.h
+
+            mkdir -p "$NV_CONFTEST_CACHE" > /dev/null 2>&1 &&
+                cp conftest$$.h "$CACHE_FILE.$$" > /dev/null 2>&1 &&
+                mv -f "$CACHE_FILE.$$" "$CACHE_FILE" > /dev/null 2>&1
+            rm -f conftest$$.h "$CACHE_FILE.$$" > /dev/null 2>&1
+        done
 
         for file in conftest*.d; do
             rm -f $file > /dev/null 2>&1
@@ -5487,6 +5614,18 @@ case "$5" in
         exit 0
     ;;
 
+    cache_key)
+        #
+        # Print the key under which compile test results for the target
+        # kernel are cached
+        #
+
+        CFLAGS=$6
+
+        cache_key
+        exit 0
+    ;;
+
     module_symvers_sanity_check)
         #
         # Check whether Module.symvers exists and contains at least one
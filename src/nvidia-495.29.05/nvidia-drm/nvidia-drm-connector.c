@@ -139,6 +139,36 @@ __nv_drm_detect_encoder(struct NvKmsKapiDynamicDisplayParams *pDetectParams,
     return false;
 }
 
+/*
+ * Whether the connection status of the last detection can be reused.
+ *
+ * NVKMS sends a DPY_CHANGED event for every change on hotplug capable
+ * connectors, so those only need to be probed again after one. This avoids
+ * waking up the GPU and issuing DPCD/EDID traffic each time userspace
+ * queries the connectors.
+ */
+static bool __nv_drm_connector_detected_status_is_valid(
+    struct drm_connector *connector)
+{
+    struct nv_drm_connector *nv_connector = to_nv_connector(connector);
+
+    if (connector->polled != DRM_CONNECTOR_POLL_HPD ||
+        connector->force != DRM_FORCE_UNSPECIFIED ||
+        connector->override_edid) {
+        /*
+         * Make sure the status detected while forced or with an override
+         * EDID isn't reused once that's undone.
+         */
+        atomic_set(&nv_connector->detected_status_stale, true);
+        return false;
+    }
+
+    return atomic_cmpxchg(
+            &nv_connector->detected_status_stale,
+            true,
+            false) == false;
+}
+
 static enum drm_connector_status __nv_drm_connector_detect_internal(
     struct drm_connector *connector)
 {
@@ -155,6 +185,10 @@ static enum drm_connector_status __nv_drm_connector_detect_internal(
 
     BUG_ON(!mutex_is_locked(&dev->mode_config.mutex));
 
+    if (__nv_drm_connector_detected_status_is_valid(connector)) {
+        return nv_connector->detected_status;
+    }
+
     if (nv_connector->edid != NULL) {
         nv_drm_free(nv_connector->edid);
         nv_connector->edid = NULL;
@@ -195,6 +229,13 @@ static enum drm_connector_status __nv_drm_connector_detect_internal(
 
 done:
 
+    if (pDetectParams == NULL) {
+        /* Don't cache the result of a failed detection */
+        atomic_set(&nv_connector->detected_status_stale, true);
+    }
+
+    nv_connector->detected_status = status;
+
     nv_drm_free(pDetectParams);
 
     return status;
@@ -363,6 +404,9 @@ nv_drm_connector_new(struct drm_device *dev,
     nv_connector->type     = type;
     nv_connector->internal = internal;
 
+    nv_connector->detected_status = connector_status_unknown;
+    atomic_set(&nv_connector->detected_status_stale, true);
+
     strcpy(nv_connector->dpAddress, dpAddress);
 
     ret = drm_connector_init(
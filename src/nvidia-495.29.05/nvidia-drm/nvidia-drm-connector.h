@@ -51,6 +51,14 @@ struct nv_drm_connector {
 
     atomic_t connection_status_dirty;
 
+    /*
+     * Connection status of the last detection, reused by detect() until
+     * NVKMS reports a change on the connector. Protected by
+     * drm_mode_config::mutex.
+     */
+    enum drm_connector_status detected_status;
+    atomic_t detected_status_stale;
+
     struct drm_connector base;
 };
 
@@ -66,6 +74,7 @@ static inline struct nv_drm_connector *to_nv_connector(
 static inline void nv_drm_connector_mark_connection_status_dirty(
     struct nv_drm_connector *nv_connector)
 {
+    atomic_set(&nv_connector->detected_status_stale, true);
     atomic_cmpxchg(&nv_connector->connection_status_dirty, false, true);
 }
 
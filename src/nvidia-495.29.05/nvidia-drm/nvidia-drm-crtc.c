@@ -610,15 +610,16 @@ static inline void nv_drm_crtc_duplicate_req_head_modeset_config(
      * in new configuration with respect to previous/old configuration because
      * there is no change in new configuration yet with respect
      * to older one!
+     *
+     * @new is freshly allocated with nv_drm_calloc(), so the flags are already
+     * zero; copy only the configuration itself rather than building the whole
+     * head and layer structures in temporaries first.
      */
-    *new = (struct NvKmsKapiHeadRequestedConfig) {
-        .modeSetConfig = old->modeSetConfig,
-    };
+    new->modeSetConfig = old->modeSetConfig;
 
     for (i = 0; i < ARRAY_SIZE(old->layerRequestedConfig); i++) {
-        new->layerRequestedConfig[i] = (struct NvKmsKapiLayerRequestedConfig) {
-            .config = old->layerRequestedConfig[i].config,
-        };
+        new->layerRequestedConfig[i].config =
+            old->layerRequestedConfig[i].config;
     }
 }
 
@@ -1036,6 +1037,7 @@ static struct drm_crtc *__nv_drm_crtc_create(struct nv_drm_device *nv_dev,
     nv_crtc->head = head;
     INIT_LIST_HEAD(&nv_crtc->flip_list);
     spin_lock_init(&nv_crtc->flip_list_lock);
+    init_waitqueue_head(&nv_crtc->flip_event_wq);
 
     ret = drm_crtc_init_with_planes(nv_dev->dev,
                                     &nv_crtc->base,
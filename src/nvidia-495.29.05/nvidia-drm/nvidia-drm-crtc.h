@@ -85,6 +85,15 @@ struct nv_drm_crtc {
      */
     spinlock_t flip_list_lock;
 
+    /**
+     * @flip_event_wq:
+     *
+     * The wait queue on which nv_drm_atomic_commit_internal() sleeps until
+     * @flip_list of this crtc drains. Kept per crtc so that a flip event on
+     * one head does not wake committers blocked on other heads.
+     */
+    wait_queue_head_t flip_event_wq;
+
     struct drm_crtc base;
 };
 
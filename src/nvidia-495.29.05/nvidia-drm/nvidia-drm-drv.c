@@ -478,8 +478,6 @@ static int nv_drm_load(struct drm_device *dev, unsigned long flags)
 
     atomic_set(&nv_dev->enable_event_handling, true);
 
-    init_waitqueue_head(&nv_dev->flip_event_wq);
-
     mutex_unlock(&nv_dev->lock);
 
 #endif /* NV_DRM_ATOMIC_MODESET_AVAILABLE */
@@ -57,6 +57,11 @@ static void __nv_drm_gem_nvkms_memory_free(struct nv_drm_gem_object *nv_gem)
                            nv_nvkms_memory->pPhysicalAddress);
     }
 
+    if (nv_nvkms_memory->pages != NULL) {
+        nvKms->freeMemoryPages(nv_nvkms_memory->pages->pages);
+        nv_drm_free(nv_nvkms_memory->pages);
+    }
+
     /* Free NvKmsKapiMemory handle associated with this gem object */
 
     nvKms->freeMemory(nv_dev->pDevice, nv_nvkms_memory->base.pMemory);
@@ -177,31 +182,69 @@ static int __nv_drm_gem_map_nvkms_memory_offset(
     return nv_drm_gem_create_mmap_offset(&nv_nvkms_memory->base, offset);
 }
 
-static struct sg_table *__nv_drm_gem_nvkms_memory_prime_get_sg_table(
-    struct nv_drm_gem_object *nv_gem)
+/*
+ * Return the page list of the memory object, querying NVKMS the first time.
+ * Concurrent first calls may both query it; only one list is kept.
+ */
+static struct nv_drm_gem_nvkms_memory_pages *
+__nv_drm_gem_nvkms_memory_get_pages(
+    struct nv_drm_gem_nvkms_memory *nv_nvkms_memory)
 {
+    struct nv_drm_gem_object *nv_gem = &nv_nvkms_memory->base;
     struct nv_drm_device *nv_dev = nv_gem->nv_dev;
-    struct sg_table *sg_table;
-    NvU64 *pages;
-    NvU32 numPages;
+    struct nv_drm_gem_nvkms_memory_pages *pages;
+    struct nv_drm_gem_nvkms_memory_pages *cached;
+
+    cached = smp_load_acquire(&nv_nvkms_memory->pages);
+    if (cached != NULL) {
+        return cached;
+    }
+
+    if ((pages = nv_drm_calloc(1, sizeof(*pages))) == NULL) {
+        return NULL;
+    }
 
     if (!nvKms->getMemoryPages(nv_dev->pDevice,
                                nv_gem->pMemory,
-                               &pages,
-                               &numPages)) {
+                               &pages->pages,
+                               &pages->numPages)) {
         NV_DRM_DEV_LOG_ERR(
                 nv_dev,
                 "Failed to get memory pages for NvKmsKapiMemory 0x%p",
                 nv_gem->pMemory);
+        nv_drm_free(pages);
         return NULL;
     }
 
-    sg_table = nv_drm_prime_pages_to_sg(nv_dev->dev,
-                                        (struct page **)pages, numPages);
+    /* cmpxchg() is fully ordered, publishing the list initialized above */
+    cached = cmpxchg(&nv_nvkms_memory->pages, NULL, pages);
+    if (cached != NULL) {
+        nvKms->freeMemoryPages(pages->pages);
+        nv_drm_free(pages);
+        return cached;
+    }
 
-    nvKms->freeMemoryPages(pages);
+    return pages;
+}
 
-    return sg_table;
+static struct sg_table *__nv_drm_gem_nvkms_memory_prime_get_sg_table(
+    struct nv_drm_gem_object *nv_gem)
+{
+    struct nv_drm_device *nv_dev = nv_gem->nv_dev;
+    struct nv_drm_gem_nvkms_memory_pages *pages =
+        __nv_drm_gem_nvkms_memory_get_pages(to_nv_nvkms_memory(nv_gem));
+
+    if (pages == NULL) {
+        return NULL;
+    }
+
+    /*
+     * Each attachment needs its own sg_table, as it gets DMA mapped for the
+     * attaching device; the DRM core keeps it for the attachment's lifetime.
+     */
+    return nv_drm_prime_pages_to_sg(nv_dev->dev,
+                                    (struct page **)pages->pages,
+                                    pages->numPages);
 }
 
 const struct nv_drm_gem_object_funcs nv_gem_nvkms_memory_ops = {
@@ -29,6 +29,16 @@
 
 #include "nvidia-drm-gem.h"
 
+/*
+ * Page list of an NvKmsKapiMemory, as returned by getMemoryPages(). The pages
+ * of a memory object don't change during its lifetime, so the list is
+ * queried on the first export and kept with the GEM object.
+ */
+struct nv_drm_gem_nvkms_memory_pages {
+    NvU64 *pages;
+    NvU32 numPages;
+};
+
 struct nv_drm_gem_nvkms_memory {
     struct nv_drm_gem_object base;
 
@@ -36,6 +46,9 @@ struct nv_drm_gem_nvkms_memory {
 
     void *pPhysicalAddress;
     void *pWriteCombinedIORemapAddress;
+
+    /* Set once, see __nv_drm_gem_nvkms_memory_get_pages() */
+    struct nv_drm_gem_nvkms_memory_pages *pages;
 };
 
 extern const struct nv_drm_gem_object_funcs nv_gem_nvkms_memory_ops;
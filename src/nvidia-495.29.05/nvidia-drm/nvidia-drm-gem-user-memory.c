@@ -99,6 +99,53 @@ static int __nv_drm_gem_user_memory_mmap(struct nv_drm_gem_object *nv_gem,
     return 0;
 }
 
+/*
+ * Map the pages around the faulting one, within the aligned window of
+ * nv_drm_fault_around_size_module_param KB containing it, so that
+ * sequential CPU accesses don't take a fault for every page. This is best
+ * effort: pages that are already mapped are skipped, and any error stops
+ * the fault-around without failing the fault itself.
+ */
+static void __nv_drm_gem_user_memory_fault_around(
+    struct nv_drm_gem_user_memory *nv_user_memory,
+    struct vm_area_struct *vma,
+    unsigned long fault_page_offset,
+    unsigned long vma_page_offset)
+{
+    unsigned long window =
+        ((unsigned long)nv_drm_fault_around_size_module_param << 10) >>
+        PAGE_SHIFT;
+    unsigned long vma_pages =
+        (vma->vm_end - vma->vm_start) >> PAGE_SHIFT;
+    unsigned long first, last, page_offset;
+
+    if (window <= 1) {
+        return;
+    }
+
+    first = fault_page_offset - (fault_page_offset % window);
+    last = min(first + window, nv_user_memory->pages_count);
+
+    /* Clamp the window to the part of the object mapped by the VMA */
+    first = max(first, vma_page_offset);
+    last = min(last, vma_page_offset + vma_pages);
+
+    for (page_offset = first; page_offset < last; page_offset++) {
+        unsigned long address = vma->vm_start +
+            ((page_offset - vma_page_offset) << PAGE_SHIFT);
+        int ret;
+
+        if (page_offset == fault_page_offset) {
+            continue;
+        }
+
+        ret = vm_insert_page(vma, address, nv_user_memory->pages[page_offset]);
+        if (ret != 0 && ret != -EBUSY) {
+            break;
+        }
+    }
+}
+
 static vm_fault_t __nv_drm_gem_user_memory_handle_vma_fault(
     struct nv_drm_gem_object *nv_gem,
     struct vm_area_struct *vma,
@@ -115,6 +162,13 @@ static vm_fault_t __nv_drm_gem_user_memory_handle_vma_fault(
     BUG_ON(page_offset > nv_user_memory->pages_count);
 
     ret = vm_insert_page(vma, address, nv_user_memory->pages[page_offset]);
+
+    if (ret == 0) {
+        __nv_drm_gem_user_memory_fault_around(
+            nv_user_memory, vma, page_offset,
+            vma->vm_pgoff - drm_vma_node_start(&gem->vma_node));
+    }
+
     switch (ret) {
         case 0:
         case -EBUSY:
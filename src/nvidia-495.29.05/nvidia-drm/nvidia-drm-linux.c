@@ -45,6 +45,14 @@ MODULE_PARM_DESC(
 bool nv_drm_modeset_module_param = false;
 module_param_named(modeset, nv_drm_modeset_module_param, bool, 0400);
 
+MODULE_PARM_DESC(
+    fault_around_size,
+    "Size in KB of the window of pages mapped by each CPU page fault on "
+    "imported user-memory GEM objects (0 = fault one page at a time (default))");
+unsigned int nv_drm_fault_around_size_module_param = 0;
+module_param_named(fault_around_size, nv_drm_fault_around_size_module_param,
+                   uint, 0400);
+
 void *nv_drm_calloc(size_t nmemb, size_t size)
 {
     return kzalloc(nmemb * size, GFP_KERNEL);
@@ -68,7 +68,15 @@ struct drm_atomic_state *nv_drm_atomic_state_alloc(struct drm_device *dev)
 
 void nv_drm_atomic_state_clear(struct drm_atomic_state *state)
 {
+    struct nv_drm_atomic_state *nv_state = to_nv_atomic_state(state);
+
     drm_atomic_state_default_clear(state);
+
+    /*
+     * The state may be refilled with a different set of crtcs, see
+     * nv_drm_atomic_apply_modeset_config().
+     */
+    memset(&nv_state->config, 0, sizeof(nv_state->config));
 }
 
 void nv_drm_atomic_state_free(struct drm_atomic_state *state)
@@ -237,7 +245,14 @@ nv_drm_atomic_apply_modeset_config(struct drm_device *dev,
     int i;
     int ret;
 
-    memset(requested_config, 0, sizeof(*requested_config));
+    /*
+     * Only the heads of crtcs in @state are written below. Heads outside of
+     * headsMask are either still zero from nv_drm_atomic_state_alloc() or
+     * were cleared by nv_drm_atomic_state_clear(), and the same set of crtcs
+     * is visited at check and commit time, so there is no need to clear the
+     * whole configuration for every call.
+     */
+    requested_config->headsMask = 0;
 
     /* Loop over affected crtcs and construct NvKmsKapiRequestedModeSetConfig */
     nv_drm_for_each_crtc_in_state(state, crtc, crtc_state, i) {
@@ -332,7 +347,6 @@ done:
 static void __nv_drm_handle_flip_event(struct nv_drm_crtc *nv_crtc)
 {
     struct drm_device *dev = nv_crtc->base.dev;
-    struct nv_drm_device *nv_dev = to_nv_device(dev);
     struct nv_drm_flip *nv_flip;
 
     /*
@@ -368,7 +382,13 @@ static void __nv_drm_handle_flip_event(struct nv_drm_crtc *nv_crtc)
     }
     spin_unlock(&dev->event_lock);
 
-    wake_up_all(&nv_dev->flip_event_wq);
+    /*
+     * Only waiters on this crtc can be waiting for its flip_list to drain,
+     * and the list is unchanged unless a flip object was dequeued above.
+     */
+    if (nv_flip != NULL) {
+        wake_up_all(&nv_crtc->flip_event_wq);
+    }
 
     nv_drm_free(nv_flip);
 }
@@ -538,7 +558,7 @@ int nv_drm_atomic_commit(struct drm_device *dev,
              * empty when it isn't.
              */
             if (wait_event_timeout(
-                    nv_dev->flip_event_wq,
+                    nv_crtc->flip_event_wq,
                     list_empty(&nv_crtc->flip_list),
                     3 * HZ /* 3 second */) == 0) {
                 NV_DRM_DEV_LOG_ERR(
@@ -34,6 +34,9 @@ struct page;
 /* Set to true when the atomic modeset feature is enabled. */
 extern bool nv_drm_modeset_module_param;
 
+/* Size in KB of the fault-around window for user-memory GEM objects. */
+extern unsigned int nv_drm_fault_around_size_module_param;
+
 void *nv_drm_calloc(size_t nmemb, size_t size);
 
 void nv_drm_free(void *ptr);
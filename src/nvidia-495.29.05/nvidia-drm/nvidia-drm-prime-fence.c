@@ -152,15 +152,16 @@ static void nv_drm_gem_prime_force_fence_signal(
     }
 }
 
-static void nv_drm_gem_prime_fence_event
-(
-    void *dataPtr,
-    NvU32 dataU32
-)
+/*
+ * Signal every pending fence whose threshold the semaphore has already
+ * reached. Must be called with nv_fence_context->lock held.
+ */
+static void __nv_drm_fence_context_signal_completed(
+    struct nv_drm_fence_context *nv_fence_context)
 {
-    struct nv_drm_fence_context *nv_fence_context = dataPtr;
-
-    spin_lock(&nv_fence_context->lock);
+    /* Index into surface with 16 byte stride */
+    unsigned int seqno = READ_ONCE(*((nv_fence_context->pLinearAddress) +
+                                     (nv_fence_context->fenceSemIndex * 4)));
 
     while (!list_empty(&nv_fence_context->pending)) {
         struct nv_drm_prime_fence *nv_fence = list_first_entry(
@@ -168,10 +169,6 @@ static void nv_drm_gem_prime_fence_event
             typeof(*nv_fence),
             list_entry);
 
-        /* Index into surface with 16 byte stride */
-        unsigned int seqno = *((nv_fence_context->pLinearAddress) +
-                               (nv_fence_context->fenceSemIndex * 4));
-
         if (nv_fence->base.seqno > seqno) {
             /*
              * Fences in list are placed in increasing order of sequence
@@ -183,6 +180,19 @@ static void nv_drm_gem_prime_fence_event
 
         __nv_drm_prime_fence_signal(nv_fence);
     }
+}
+
+static void nv_drm_gem_prime_fence_event
+(
+    void *dataPtr,
+    NvU32 dataU32
+)
+{
+    struct nv_drm_fence_context *nv_fence_context = dataPtr;
+
+    spin_lock(&nv_fence_context->lock);
+
+    __nv_drm_fence_context_signal_completed(nv_fence_context);
 
     spin_unlock(&nv_fence_context->lock);
 }
@@ -347,10 +357,26 @@ static nv_dma_fence_t *__nv_drm_fence_context_create_fence(
                       &nv_fence->lock, nv_fence_context->context,
                       seqno);
 
+    /*
+     * The pending list owns the initial reference and drops it when the fence
+     * is signaled, which may happen right below or from the channel event at
+     * any point after the lock is released. Take another reference for the
+     * caller, who must drop it once done with the fence.
+     */
+    nv_dma_fence_get(&nv_fence->base);
+
     list_add_tail(&nv_fence->list_entry, &nv_fence_context->pending);
 
     nv_fence_context->last_seqno = seqno;
 
+    /*
+     * The semaphore may have already reached the threshold, in which case no
+     * further channel event is going to arrive for it. Signal it now rather
+     * than leaving waiters to run into the timeout in
+     * nv_drm_gem_prime_fence_op_wait().
+     */
+    __nv_drm_fence_context_signal_completed(nv_fence_context);
+
     spin_unlock(&nv_fence_context->lock);
 
 out:
@@ -501,6 +527,8 @@ int nv_drm_gem_fence_attach_ioctl(struct drm_device *dev,
 
     nv_dma_resv_add_excl_fence(&nv_gem->resv, fence);
 
+    nv_dma_fence_put(fence);
+
     ret = 0;
 
 fence_context_create_fence_failed:
@@ -107,14 +107,6 @@ struct nv_drm_device {
 
     atomic_t enable_event_handling;
 
-    /**
-     * @flip_event_wq:
-     *
-     * The wait queue on which nv_drm_atomic_commit_internal() sleeps until
-     * next flip event occurs.
-     */
-    wait_queue_head_t flip_event_wq;
-
 #endif
 
     NvBool hasVideoMemory;
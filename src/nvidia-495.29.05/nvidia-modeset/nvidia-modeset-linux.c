@@ -21,6 +21,7 @@
 #include <linux/file.h>
 #include <linux/list.h>
 #include <linux/rwsem.h>
+#include <linux/hrtimer.h>
 
 #include "nvstatus.h"
 
@@ -188,18 +189,12 @@ NvBool nvkms_syncpt_op(
 #define NVKMS_MINOR_DEVICE_NUMBER 254
 
 /*
- * Convert from microseconds to jiffies.  The conversion is:
- * ((usec) * HZ / 1000000)
- *
- * Use do_div() to avoid gcc-generated references to __udivdi3().
- * Note that the do_div() macro divides the first argument in place.
+ * How late NVKMS timers and sleeps are allowed to fire, so that the kernel
+ * can coalesce their wakeups with other events.  This matches the default
+ * timer slack of a normal task, and is well below a frame at any refresh
+ * rate.
  */
-static inline unsigned long NVKMS_USECS_TO_JIFFIES(NvU64 usec)
-{
-    unsigned long result = usec * HZ;
-    do_div(result, 1000000);
-    return result;
-}
+#define NVKMS_TIMER_SLACK_USEC 50
 
 
 /*************************************************************************
@@ -218,10 +213,22 @@ static struct semaphore nvkms_lock;
 
 static struct rw_semaphore nvkms_pm_lock;
 
+/*
+ * Woken whenever nvkms_pm_lock is released for writing, so that
+ * nvkms_read_lock_pm_lock_interruptible() callers can sleep, rather than
+ * spin, while a suspend/resume cycle is in progress.
+ */
+static DECLARE_WAIT_QUEUE_HEAD(nvkms_pm_lock_wait_queue);
+
 /*************************************************************************
  * NVKMS executes almost all of its queued work items on a single
- * kthread.  The exception are deferred close() handlers, which typically
- * block for long periods of time and stall their queue.
+ * kthread.  The exceptions are deferred close() handlers, which typically
+ * block for long periods of time and stall their queue, and event
+ * delivery to kernel clients: their event callbacks (e.g., nvidia-drm
+ * hotplug processing) can call back into NVKMS repeatedly, and would
+ * otherwise hold up timers and other devices' events while they run.
+ * Each kernel client (one per device) therefore gets its own event
+ * kthread, see nvkms_per_open::u::kernel::events.
  *************************************************************************/
 
 static struct nv_kthread_q nvkms_kthread_q;
@@ -247,6 +254,7 @@ struct nvkms_per_open {
 
         struct {
             struct {
+                nv_kthread_q_t nv_kthread_q;
                 nv_kthread_q_item_t nv_kthread_q_item;
             } events;
         } kernel;
@@ -270,10 +278,26 @@ static inline int nvkms_read_trylock_pm_lock(void)
 static inline int nvkms_read_lock_pm_lock_interruptible(void)
 {
     while (!down_read_trylock(&nvkms_pm_lock)) {
-        if (signal_pending(current)) {
+        /*
+         * The lock is normally only unavailable between nvkms_suspend()
+         * and nvkms_resume(), which can take a long time; every client
+         * ioctl spinning here for that long wastes a CPU each.  Sleep
+         * until the writer releases it instead.  The timeout covers
+         * down_read_trylock() failing spuriously after the wakeup because
+         * of other queued waiters on the rwsem.
+         */
+        long ret = wait_event_interruptible_timeout(
+                       nvkms_pm_lock_wait_queue,
+                       down_read_trylock(&nvkms_pm_lock),
+                       msecs_to_jiffies(10));
+
+        if (ret > 0) {
+            break;
+        }
+
+        if (ret < 0 || signal_pending(current)) {
             return -EINTR;
         }
-        cond_resched();
     }
 
     return 0;
@@ -297,6 +321,8 @@ static inline void nvkms_write_lock_pm_lock(void)
 static inline void nvkms_write_unlock_pm_lock(void)
 {
     up_write(&nvkms_pm_lock);
+
+    wake_up_all(&nvkms_pm_lock_wait_queue);
 }
 
 /*************************************************************************
@@ -304,9 +330,18 @@ static inline void nvkms_write_unlock_pm_lock(void)
  * are called while nvkms_lock is held.
  *************************************************************************/
 
-/* Don't use kmalloc for allocations larger than one page */
+/* Don't rely on kmalloc for allocations larger than one page */
 #define KMALLOC_LIMIT PAGE_SIZE
 
+/*
+ * Several NVKMS ioctl parameter structures are a few pages large, and core
+ * NVKMS allocates and frees one for each request.  vmalloc()/vfree() on
+ * every flip is much more expensive than the copy itself, so for sizes up
+ * to this limit, first try an opportunistic kmalloc() that neither retries
+ * nor warns, and only fall back to vmalloc() under fragmentation.
+ */
+#define KMALLOC_TRY_LIMIT (4 * PAGE_SIZE)
+
 void* nvkms_alloc(size_t size, NvBool zero)
 {
     void *p;
@@ -323,7 +358,15 @@ void* nvkms_alloc(size_t size, NvBool zero)
     if (size <= KMALLOC_LIMIT) {
         p = kmalloc(size, GFP_KERNEL);
     } else {
-        p = vmalloc(size);
+        p = NULL;
+
+        if (size <= KMALLOC_TRY_LIMIT) {
+            p = kmalloc(size, GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN);
+        }
+
+        if (p == NULL) {
+            p = vmalloc(size);
+        }
     }
 
     if (zero && (p != NULL)) {
@@ -335,10 +378,10 @@ void* nvkms_alloc(size_t size, NvBool zero)
 
 void nvkms_free(void *ptr, size_t size)
 {
-    if (size <= KMALLOC_LIMIT) {
-        kfree(ptr);
-    } else {
+    if (is_vmalloc_addr(ptr)) {
         vfree(ptr);
+    } else {
+        kfree(ptr);
     }
 }
 
@@ -385,6 +428,15 @@ void nvkms_usleep(NvU64 usec)
          * using udelay(); note this is a busy wait.
          */
         udelay(usec);
+    } else if (usec < 20000) {
+        /*
+         * msleep() rounds up to whole jiffies, which can be several times
+         * the requested period for short sleeps; use an hrtimer-based
+         * sleep instead.
+         */
+        unsigned long range_usec = (unsigned long) usec;
+
+        usleep_range(range_usec, range_usec + NVKMS_TIMER_SLACK_USEC);
     } else {
         /*
          * Otherwise, sleep with millisecond precision.  Clamp the
@@ -517,7 +569,7 @@ nvkms_event_queue_changed(nvkms_per_open_handle_t *pOpenKernel,
         case NVKMS_CLIENT_KERNEL_SPACE:
             if (eventsAvailable) {
                 nv_kthread_q_schedule_q_item(
-                    &nvkms_kthread_q,
+                    &popen->u.kernel.events.nv_kthread_q,
                     &popen->u.kernel.events.nv_kthread_q_item);
             }
 
@@ -656,15 +708,17 @@ void* nvkms_dec_ref(struct nvkms_ref_ptr *ref_ptr)
  * Core NVKMS needs to be able to schedule work to execute in the
  * future, within process context.
  *
- * To achieve this, use struct timer_list to schedule a timer
- * callback, nvkms_timer_callback().  This will execute in softirq
- * context, so from there schedule an nv_kthread_q item,
- * nvkms_kthread_q_callback(), which will execute in process context.
+ * To achieve this, use struct hrtimer to schedule a timer callback,
+ * nvkms_timer_callback().  Unlike a jiffies-based timer_list, this
+ * doesn't round sub-tick display deadlines (e.g., flip or VRR timing)
+ * to the scheduler tick.  The callback executes in interrupt context, so
+ * from there schedule an nv_kthread_q item, nvkms_kthread_q_callback(),
+ * which will execute in process context.
  *************************************************************************/
 
 struct nvkms_timer_t {
     nv_kthread_q_item_t nv_kthread_q_item;
-    struct timer_list kernel_timer;
+    struct hrtimer kernel_timer;
     NvBool cancel;
     NvBool complete;
     NvBool isRefPtr;
@@ -704,7 +758,7 @@ static void nvkms_kthread_q_callback(void *arg)
      * pending timers and than waiting for workqueue callbacks.
      */
     if (timer->kernel_timer_created) {
-        del_timer_sync(&timer->kernel_timer);
+        hrtimer_cancel(&timer->kernel_timer);
     }
 
     /*
@@ -754,30 +808,15 @@ static void nvkms_queue_work(nv_kthread_q_t *q, nv_kthread_q_item_t *q_item)
     WARN_ON(!ret);
 }
 
-static void _nvkms_timer_callback_internal(struct nvkms_timer_t *nvkms_timer)
-{
-    /* In softirq context, so schedule nvkms_kthread_q_callback(). */
-    nvkms_queue_work(&nvkms_kthread_q, &nvkms_timer->nv_kthread_q_item);
-}
-
-/*
- * Why the "inline" keyword? Because only one of these next two functions will
- * be used, thus leading to a "defined but not used function" warning. The
- * "inline" keyword is redefined in the Kbuild system
- * (see: <kernel>/include/linux/compiler-gcc.h) so as to suppress that warning.
- */
-inline static void nvkms_timer_callback_typed_data(struct timer_list *timer)
+static enum hrtimer_restart nvkms_timer_callback(struct hrtimer *hrtimer)
 {
     struct nvkms_timer_t *nvkms_timer =
-            container_of(timer, struct nvkms_timer_t, kernel_timer);
+            container_of(hrtimer, struct nvkms_timer_t, kernel_timer);
 
-    _nvkms_timer_callback_internal(nvkms_timer);
-}
+    /* In interrupt context, so schedule nvkms_kthread_q_callback(). */
+    nvkms_queue_work(&nvkms_kthread_q, &nvkms_timer->nv_kthread_q_item);
 
-inline static void nvkms_timer_callback_anon_data(unsigned long arg)
-{
-    struct nvkms_timer_t *nvkms_timer = (struct nvkms_timer_t *) arg;
-    _nvkms_timer_callback_internal(nvkms_timer);
+    return HRTIMER_NORESTART;
 }
 
 static void
@@ -812,16 +851,14 @@ nvkms_init_timer(struct nvkms_timer_t *timer, nvkms_timer_proc_t *proc,
         timer->kernel_timer_created = NV_FALSE;
         nvkms_queue_work(&nvkms_kthread_q, &timer->nv_kthread_q_item);
     } else {
-#if defined(NV_TIMER_SETUP_PRESENT)
-        timer_setup(&timer->kernel_timer, nvkms_timer_callback_typed_data, 0);
-#else
-        init_timer(&timer->kernel_timer);
-        timer->kernel_timer.function = nvkms_timer_callback_anon_data;
-        timer->kernel_timer.data = (unsigned long) timer;
-#endif
+        hrtimer_init(&timer->kernel_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+        timer->kernel_timer.function = nvkms_timer_callback;
 
         timer->kernel_timer_created = NV_TRUE;
-        mod_timer(&timer->kernel_timer, jiffies + NVKMS_USECS_TO_JIFFIES(usec));
+        hrtimer_start_range_ns(&timer->kernel_timer,
+                               ns_to_ktime(usec * NSEC_PER_USEC),
+                               NVKMS_TIMER_SLACK_USEC * NSEC_PER_USEC,
+                               HRTIMER_MODE_REL);
     }
     spin_unlock_irqrestore(&nvkms_timers.lock, flags);
 }
@@ -1162,6 +1199,22 @@ struct nvkms_per_open *nvkms_open_common(enum NvKmsClientType type,
 
     popen->type = type;
 
+    if (popen->type == NVKMS_CLIENT_KERNEL_SPACE) {
+        /*
+         * Set up event delivery before nvKmsOpen(), which makes the client
+         * visible to core NVKMS and so may lead to events getting queued.
+         */
+        nv_kthread_q_item_init(&popen->u.kernel.events.nv_kthread_q_item,
+                               nvkms_kapi_event_kthread_q_callback,
+                               device);
+
+        *status = nv_kthread_q_init(&popen->u.kernel.events.nv_kthread_q,
+                                    "nvidia-modeset/kapi_event_q");
+        if (*status != 0) {
+            goto failed;
+        }
+    }
+
     *status = down_interruptible(&nvkms_lock);
 
     if (*status != 0) {
@@ -1182,9 +1235,6 @@ struct nvkms_per_open *nvkms_open_common(enum NvKmsClientType type,
             init_waitqueue_head(&popen->u.user.events.wait_queue);
             break;
         case NVKMS_CLIENT_KERNEL_SPACE:
-            nv_kthread_q_item_init(&popen->u.kernel.events.nv_kthread_q_item,
-                                   nvkms_kapi_event_kthread_q_callback,
-                                   device);
             break;
     }
 
@@ -1194,6 +1244,11 @@ struct nvkms_per_open *nvkms_open_common(enum NvKmsClientType type,
 
 failed:
 
+    if ((popen != NULL) && (popen->type == NVKMS_CLIENT_KERNEL_SPACE)) {
+        /* A no-op if the queue was never successfully initialized. */
+        nv_kthread_q_stop(&popen->u.kernel.events.nv_kthread_q);
+    }
+
     nvkms_free(popen, sizeof(*popen));
 
     return NULL;
@@ -1218,7 +1273,7 @@ void nvkms_close_common(struct nvkms_per_open *popen)
     if (popen->type == NVKMS_CLIENT_KERNEL_SPACE) {
         /*
          * Flush any outstanding nvkms_kapi_event_kthread_q_callback() work
-         * items before freeing popen.
+         * items, and stop the client's event kthread, before freeing popen.
          *
          * Note that this must be done after the above nvKmsClose() call, to
          * guarantee that no more nvkms_kapi_event_kthread_q_callback() work
@@ -1231,7 +1286,7 @@ void nvkms_close_common(struct nvkms_per_open *popen)
          * nvkms_ioctl_common() should reject the request.
          */
 
-        nv_kthread_q_flush(&nvkms_kthread_q);
+        nv_kthread_q_stop(&popen->u.kernel.events.nv_kthread_q);
     }
 
     nvkms_free(popen, sizeof(*popen));
@@ -1714,13 +1769,13 @@ restart:
     list_for_each_entry_safe(timer, tmp_timer, &nvkms_timers.list, timers_list) {
         if (timer->kernel_timer_created) {
             /*
-             * We delete pending timers and check whether it was being executed
+             * We cancel pending timers and check whether it was being executed
              * (returns 0) or we have deactivated it before execution (returns 1).
              * If it began execution, the kthread_q callback will wait for timer
              * completion, and we wait for queue completion with
              * nv_kthread_q_stop below.
              */
-            if (del_timer_sync(&timer->kernel_timer) == 1) {
+            if (hrtimer_cancel(&timer->kernel_timer) == 1) {
                 /*  We've deactivated timer so we need to clean after it */
                 list_del(&timer->timers_list);
 
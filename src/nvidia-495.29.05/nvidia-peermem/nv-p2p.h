@@ -412,8 +412,13 @@ typedef struct nvidia_p2p_rsync_reg_info {
  *   socket-id, cluster-id} to pick the optimal generation registers to issue
  *   RSYNC (NVLink HW flush).
  *
+ *   The information of every supported GPU is returned in a single call.
+ *
  *   The interface allocates structures to return the information, hence
  *   nvidia_p2p_put_rsync_registers() must be called to free the structures.
+ *   The register mappings themselves are shared and refcounted across
+ *   callers, so repeated calls while earlier reg info structures are still
+ *   held don't map the registers again.
  *
  *   Note, cluster-id is hardcoded to zero as early system configurations would
  *   only support cluster mode i.e. all devices would share the same cluster-id
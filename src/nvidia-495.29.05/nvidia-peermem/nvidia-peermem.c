@@ -63,6 +63,14 @@ MODULE_VERSION(DRV_VERSION);
 #define GPU_PAGE_OFFSET  (GPU_PAGE_SIZE-1)
 #define GPU_PAGE_MASK    (~GPU_PAGE_OFFSET)
 
+/*
+ * Largest page size advertised to the IB core, matching the GPU's big page
+ * size, and largest length of a merged scatterlist entry, which is a multiple
+ * of it and fits the entry's unsigned int length.
+ */
+#define NV_MEM_MAX_PAGE_SIZE    ((u64)1 << 21)
+#define NV_MEM_MAX_SEG_SIZE     ((u64)1 << 31)
+
 invalidate_peer_memory mem_invalidate_callback;
 static void *reg_handle;
 
@@ -191,11 +199,54 @@ err:
     return 0;
 }
 
+/*
+ * Count the DMA segments of the mapping once physically contiguous GPU pages
+ * are merged, up to NV_MEM_MAX_SEG_SIZE each.
+ */
+static unsigned long nv_dma_count_segments(struct nvidia_p2p_dma_mapping *dma_mapping)
+{
+    unsigned long i, nsegs = 0;
+    u64 seg_len = 0;
+
+    for (i = 0; i < dma_mapping->entries; i++) {
+        if (seg_len == 0 || seg_len == NV_MEM_MAX_SEG_SIZE ||
+            dma_mapping->dma_addresses[i] !=
+                dma_mapping->dma_addresses[i - 1] + GPU_PAGE_SIZE) {
+            nsegs++;
+            seg_len = 0;
+        }
+        seg_len += GPU_PAGE_SIZE;
+    }
+
+    return nsegs;
+}
+
+/*
+ * The IB core splits each scatterlist entry into pages of the advertised
+ * size, so that size must divide the start and length of every entry, as
+ * well as the start and size of the whole buffer.
+ */
+static unsigned long nv_dma_get_page_size(struct nv_mem_context *nv_mem_context,
+                                          struct sg_table *sg_head, int nmap)
+{
+    struct scatterlist *sg;
+    u64 bits = nv_mem_context->page_virt_start |
+               nv_mem_context->mapped_size |
+               NV_MEM_MAX_PAGE_SIZE;
+    int i;
+
+    for_each_sg(sg_head->sgl, sg, nmap, i)
+        bits |= sg->dma_address | sg->dma_length;
+
+    return (unsigned long)(bits & -bits);
+}
+
 static int nv_dma_map(struct sg_table *sg_head, void *context,
                       struct device *dma_device, int dmasync,
                       int *nmap)
 {
-    int i, ret;
+    unsigned long i, nsegs;
+    int ret;
     struct scatterlist *sg;
     struct nv_mem_context *nv_mem_context =
         (struct nv_mem_context *) context;
@@ -228,8 +279,9 @@ static int nv_dma_map(struct sg_table *sg_head, void *context,
     }
 
     nv_mem_context->npages = dma_mapping->entries;
+    nsegs = nv_dma_count_segments(dma_mapping);
 
-    ret = sg_alloc_table(sg_head, dma_mapping->entries, GFP_KERNEL);
+    ret = sg_alloc_table(sg_head, nsegs, GFP_KERNEL);
     if (ret) {
         nvidia_p2p_dma_unmap_pages(pdev, page_table, dma_mapping);
         return ret;
@@ -237,13 +289,24 @@ static int nv_dma_map(struct sg_table *sg_head, void *context,
 
     nv_mem_context->dma_mapping = dma_mapping;
     nv_mem_context->sg_allocated = 1;
-    for_each_sg(sg_head->sgl, sg, nv_mem_context->npages, i) {
-        sg_set_page(sg, NULL, nv_mem_context->page_size, 0);
-        sg->dma_address = dma_mapping->dma_addresses[i];
-        sg->dma_length = nv_mem_context->page_size;
+
+    /* Merge physically contiguous GPU pages into a single entry */
+    sg = NULL;
+    for (i = 0; i < nv_mem_context->npages; i++) {
+        if (sg == NULL || sg->dma_length == NV_MEM_MAX_SEG_SIZE ||
+            dma_mapping->dma_addresses[i] != sg->dma_address + sg->dma_length) {
+            sg = (sg == NULL) ? sg_head->sgl : sg_next(sg);
+            sg_set_page(sg, NULL, 0, 0);
+            sg->dma_address = dma_mapping->dma_addresses[i];
+            sg->dma_length = 0;
+        }
+        sg->length += GPU_PAGE_SIZE;
+        sg->dma_length += GPU_PAGE_SIZE;
     }
 
-    *nmap = nv_mem_context->npages;
+    *nmap = nsegs;
+
+    nv_mem_context->page_size = nv_dma_get_page_size(nv_mem_context, sg_head, nsegs);
 
     return 0;
 }
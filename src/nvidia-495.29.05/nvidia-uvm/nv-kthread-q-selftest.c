@@ -29,6 +29,9 @@
 #include <linux/module.h>
 #include <linux/cpumask.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/sort.h>
+#include <linux/math64.h>
 
 // If NV_BUILD_MODULE_INSTANCES is not defined, do it here in order to avoid
 // build warnings/errors when including nv-linux.h as it expects the definition
@@ -80,6 +83,9 @@
 #define NUM_TEST_KTHREADS               8
 #define NUM_Q_ITEMS_IN_MULTITHREAD_TEST (NUM_TEST_Q_ITEMS * NUM_TEST_KTHREADS)
 
+#define NUM_BENCHMARK_Q_ITEMS_PER_PRODUCER (10 * 1000)
+#define MAX_BENCHMARK_PRODUCERS            64
+
 // This exists in order to have a function to place a breakpoint on:
 void on_nvq_assert(void)
 {
@@ -102,7 +108,7 @@ static void _basic_start_stop_callback(void *args)
     *start_stop_args->where_to_write = start_stop_args->value_to_write;
 }
 
-static int _basic_start_stop_test(void)
+static int _basic_start_stop_test(unsigned flags)
 {
     int i, was_scheduled;
     int result = 0;
@@ -117,7 +123,7 @@ static int _basic_start_stop_test(void)
     nv_kthread_q_stop(&local_q);
 
     // Do a quick start-stop cycle first:
-    result = nv_kthread_q_init(&local_q, "q_to_stop");
+    result = nv_kthread_q_init_on_node_flags(&local_q, "q_to_stop", NV_KTHREAD_NO_NODE, flags);
     TEST_CHECK_RET(result == 0);
     nv_kthread_q_stop(&local_q);
 
@@ -133,7 +139,7 @@ static int _basic_start_stop_test(void)
         start_stop_args[i].where_to_write = &callback_values_written[i];
     }
 
-    result = nv_kthread_q_init(&local_q, "basic_q");
+    result = nv_kthread_q_init_on_node_flags(&local_q, "basic_q", NV_KTHREAD_NO_NODE, flags);
     TEST_CHECK_RET(result == 0);
 
     // Launch 3 items, then flush the queue.
@@ -249,7 +255,7 @@ done:
     return result;
 }
 
-static int _multithreaded_q_test(void)
+static int _multithreaded_q_test(unsigned flags)
 {
     int i, j;
     int result = 0;
@@ -262,7 +268,7 @@ static int _multithreaded_q_test(void)
     memset(kthreads, 0, sizeof(kthreads));
     atomic_set(&local_accumulator, 0);
 
-    result = nv_kthread_q_init(&local_q, "multithread_test_q");
+    result = nv_kthread_q_init_on_node_flags(&local_q, "multithread_test_q", NV_KTHREAD_NO_NODE, flags);
     TEST_CHECK_RET(result == 0);
 
     for (i = 0; i < NUM_TEST_KTHREADS; ++i) {
@@ -340,7 +346,7 @@ static void _reschedule_callback(void *args)
 
 // Verify that re-scheduling the same q_item, from within its own
 // callback, works.
-static int _reschedule_same_item_from_its_own_callback_test(void)
+static int _reschedule_same_item_from_its_own_callback_test(unsigned flags)
 {
     int was_scheduled;
     int result = 0;
@@ -348,7 +354,7 @@ static int _reschedule_same_item_from_its_own_callback_test(void)
 
     memset(&resched_args, 0, sizeof(resched_args));
 
-    result = nv_kthread_q_init(&resched_args.test_q, "resched_test_q");
+    result = nv_kthread_q_init_on_node_flags(&resched_args.test_q, "resched_test_q", NV_KTHREAD_NO_NODE, flags);
     TEST_CHECK_RET(result == 0);
 
     nv_kthread_q_item_init(&resched_args.q_item,
@@ -391,7 +397,7 @@ static void _same_q_item_callback(void *args)
     atomic_inc(&same_q_item_args->test_accumulator);
 }
 
-static int _same_q_item_test(void)
+static int _same_q_item_test(unsigned flags)
 {
     int result, i;
     int num_scheduled = 0;
@@ -401,7 +407,7 @@ static int _same_q_item_test(void)
 
     memset(&same_q_item_args, 0, sizeof(same_q_item_args));
 
-    result = nv_kthread_q_init(&local_q, "same_q_item_test_q");
+    result = nv_kthread_q_init_on_node_flags(&local_q, "same_q_item_test_q", NV_KTHREAD_NO_NODE, flags);
     TEST_CHECK_RET(result == 0);
 
     nv_kthread_q_item_init(&q_item,
@@ -429,6 +435,139 @@ static int _same_q_item_test(void)
     return 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Submission order test
+
+#define NUM_Q_ITEMS_IN_ORDER_TEST 1000
+
+typedef struct order_args
+{
+    int      index;
+    atomic_t *next_slot;
+    int      *run_order;
+} order_args_t;
+
+static void _order_callback(void *args)
+{
+    order_args_t *order_args = (order_args_t*)args;
+
+    order_args->run_order[atomic_inc_return(order_args->next_slot) - 1] = order_args->index;
+}
+
+// Verify that items submitted by a single thread run in submission order, even
+// when many of them are pending at the same time.
+static int _fifo_order_test(unsigned flags)
+{
+    int i;
+    int result = 0;
+    nv_kthread_q_t local_q;
+    nv_kthread_q_item_t *q_items;
+    order_args_t *order_args;
+    int *run_order;
+    atomic_t next_slot;
+
+    q_items = vmalloc(NUM_Q_ITEMS_IN_ORDER_TEST * sizeof(*q_items));
+    order_args = vmalloc(NUM_Q_ITEMS_IN_ORDER_TEST * sizeof(*order_args));
+    run_order = vmalloc(NUM_Q_ITEMS_IN_ORDER_TEST * sizeof(*run_order));
+    if (!q_items || !order_args || !run_order) {
+        result = -ENOMEM;
+        goto done;
+    }
+
+    atomic_set(&next_slot, 0);
+
+    result = nv_kthread_q_init_on_node_flags(&local_q, "order_test_q", NV_KTHREAD_NO_NODE, flags);
+    if (result != 0)
+        goto done;
+
+    for (i = 0; i < NUM_Q_ITEMS_IN_ORDER_TEST; ++i) {
+        order_args[i].index = i;
+        order_args[i].next_slot = &next_slot;
+        order_args[i].run_order = run_order;
+
+        nv_kthread_q_item_init(&q_items[i], _order_callback, &order_args[i]);
+        result |= !nv_kthread_q_schedule_q_item(&local_q, &q_items[i]);
+    }
+
+    nv_kthread_q_stop(&local_q);
+
+    if (atomic_read(&next_slot) != NUM_Q_ITEMS_IN_ORDER_TEST) {
+        NVQ_TEST_PRINT("Items run: Expected: %d, actual: %d\n",
+                       NUM_Q_ITEMS_IN_ORDER_TEST, atomic_read(&next_slot));
+        result = -EINVAL;
+        goto done;
+    }
+
+    for (i = 0; i < NUM_Q_ITEMS_IN_ORDER_TEST; ++i) {
+        if (run_order[i] != i) {
+            NVQ_TEST_PRINT("Run order: Expected: %d, actual: %d\n", i, run_order[i]);
+            result = -EINVAL;
+            break;
+        }
+    }
+
+done:
+    if (run_order)
+        vfree(run_order);
+    if (order_args)
+        vfree(order_args);
+    if (q_items)
+        vfree(q_items);
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Queue attributes test
+
+// Verify batched draining and statistics collection, and that invalid
+// attributes are rejected.
+static int _attrs_test(unsigned flags)
+{
+    int i;
+    int result = 0;
+    nv_kthread_q_t local_q;
+    nv_kthread_q_item_t q_items[NUM_Q_ITEMS_IN_BASIC_TEST];
+    same_q_item_args_t args;
+    nv_kthread_q_stats_t stats;
+    nv_kthread_q_attrs_t attrs = {
+        .preferred_node = NV_KTHREAD_NO_NODE,
+        .flags          = flags | NV_KTHREAD_Q_FLAGS_STATS,
+        .sched_policy   = NV_KTHREAD_Q_SCHED_NORMAL,
+        .max_batch      = NV_KTHREAD_Q_MAX_BATCH + 1,
+    };
+
+    result = nv_kthread_q_init_with_attrs(&local_q, "attrs_test_q", &attrs);
+    TEST_CHECK_RET(result == -EINVAL);
+
+    attrs.max_batch = 4;
+    attrs.nice = 1;
+    result = nv_kthread_q_init_with_attrs(&local_q, "attrs_test_q", &attrs);
+    TEST_CHECK_RET(result == 0);
+
+    memset(&args, 0, sizeof(args));
+
+    for (i = 0; i < NUM_Q_ITEMS_IN_BASIC_TEST; ++i) {
+        nv_kthread_q_item_init(&q_items[i], _same_q_item_callback, &args);
+        result |= !nv_kthread_q_schedule_q_item(&local_q, &q_items[i]);
+    }
+
+    nv_kthread_q_flush(&local_q);
+
+    nv_kthread_q_get_stats(&local_q, &stats);
+
+    nv_kthread_q_stop(&local_q);
+
+    TEST_CHECK_RET(atomic_read(&args.test_accumulator) == NUM_Q_ITEMS_IN_BASIC_TEST);
+
+    // The flush items are accounted for, too
+    TEST_CHECK_RET(stats.items_run >= NUM_Q_ITEMS_IN_BASIC_TEST);
+    TEST_CHECK_RET(stats.wakeups >= 1 && stats.wakeups <= stats.items_run);
+    TEST_CHECK_RET(stats.max_latency_ns <= stats.total_latency_ns);
+
+    return result;
+}
+
 // Returns true if any of the stack pages are not resident on the indicated node.
 static bool stack_mismatch(const struct task_struct *thread, int preferred_node)
 {
@@ -551,24 +690,224 @@ static int _check_cpu_affinity_test(void)
     return 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Latency and throughput benchmark
+//
+// A set of producer kthreads schedule distinct q_items on the same queue as
+// fast as they can. Each q_item records the time between its scheduling and
+// the start of its callback, and the throughput is measured from the release
+// of the producers until the queue is flushed.
+
+typedef struct benchmark_q_item
+{
+    nv_kthread_q_item_t q_item;
+    u64                 schedule_time_ns;
+    u64                 latency_ns;
+} benchmark_q_item_t;
+
+typedef struct benchmark_producer_args
+{
+    nv_kthread_q_t      *test_q;
+    benchmark_q_item_t  *q_items;
+    struct completion   *start;
+    struct completion   done;
+    struct task_struct  *kthread;
+    int                 result;
+} benchmark_producer_args_t;
+
+static void _benchmark_callback(void *args)
+{
+    benchmark_q_item_t *item = (benchmark_q_item_t*)args;
+
+    item->latency_ns = ktime_to_ns(ktime_get()) - item->schedule_time_ns;
+}
+
+static int _benchmark_producer_kthread_function(void *args)
+{
+    int i;
+    benchmark_producer_args_t *producer_args = (benchmark_producer_args_t*)args;
+
+    wait_for_completion(producer_args->start);
+
+    for (i = 0; i < NUM_BENCHMARK_Q_ITEMS_PER_PRODUCER; ++i) {
+        benchmark_q_item_t *item = &producer_args->q_items[i];
+
+        item->schedule_time_ns = ktime_to_ns(ktime_get());
+        producer_args->result |= !nv_kthread_q_schedule_q_item(producer_args->test_q, &item->q_item);
+    }
+
+    complete(&producer_args->done);
+
+    // Sleep rather than spin until stopped, in order not to compete with the
+    // producers that are still running
+    set_current_state(TASK_INTERRUPTIBLE);
+    while (!kthread_should_stop()) {
+        schedule();
+        set_current_state(TASK_INTERRUPTIBLE);
+    }
+    __set_current_state(TASK_RUNNING);
+
+    return 0;
+}
+
+static int _benchmark_cmp_u64(const void *a, const void *b)
+{
+    u64 val_a = *(const u64 *)a;
+    u64 val_b = *(const u64 *)b;
+
+    if (val_a < val_b)
+        return -1;
+
+    return val_a > val_b;
+}
+
+static int _benchmark_q(unsigned flags, unsigned num_producers)
+{
+    unsigned i;
+    int result = 0;
+    unsigned num_items = num_producers * NUM_BENCHMARK_Q_ITEMS_PER_PRODUCER;
+    benchmark_producer_args_t *producer_args = NULL;
+    benchmark_q_item_t *q_items = NULL;
+    u64 *latencies = NULL;
+    struct completion start;
+    nv_kthread_q_t local_q;
+    u64 begin_ns, elapsed_ns;
+
+    producer_args = vmalloc(num_producers * sizeof(*producer_args));
+    q_items = vmalloc(num_items * sizeof(*q_items));
+    latencies = vmalloc(num_items * sizeof(*latencies));
+    if (!producer_args || !q_items || !latencies) {
+        result = -ENOMEM;
+        goto done;
+    }
+
+    memset(producer_args, 0, num_producers * sizeof(*producer_args));
+    memset(q_items, 0, num_items * sizeof(*q_items));
+
+    for (i = 0; i < num_items; ++i)
+        nv_kthread_q_item_init(&q_items[i].q_item, _benchmark_callback, &q_items[i]);
+
+    result = nv_kthread_q_init_on_node_flags(&local_q, "benchmark_q", NV_KTHREAD_NO_NODE, flags);
+    if (result != 0)
+        goto done;
+
+    init_completion(&start);
+
+    for (i = 0; i < num_producers; ++i) {
+        producer_args[i].test_q  = &local_q;
+        producer_args[i].q_items = &q_items[i * NUM_BENCHMARK_Q_ITEMS_PER_PRODUCER];
+        producer_args[i].start   = &start;
+        init_completion(&producer_args[i].done);
+
+        producer_args[i].kthread = kthread_run(_benchmark_producer_kthread_function,
+                                               &producer_args[i],
+                                               "nvq_bench_kthread");
+        if (IS_ERR(producer_args[i].kthread)) {
+            NVQ_TEST_PRINT("kthread_run[%u] failed: errno: %ld\n",
+                           i, PTR_ERR(producer_args[i].kthread));
+            result = -1;
+            producer_args[i].kthread = NULL;
+            break;
+        }
+    }
+
+    // Release the producers even if not all of them could be created, so the
+    // ones that were can be stopped
+    begin_ns = ktime_to_ns(ktime_get());
+    complete_all(&start);
+
+    for (i = 0; i < num_producers && producer_args[i].kthread; ++i)
+        wait_for_completion(&producer_args[i].done);
+
+    nv_kthread_q_flush(&local_q);
+    elapsed_ns = ktime_to_ns(ktime_get()) - begin_ns;
+
+    for (i = 0; i < num_producers && producer_args[i].kthread; ++i) {
+        kthread_stop(producer_args[i].kthread);
+        result |= producer_args[i].result;
+    }
+
+    nv_kthread_q_stop(&local_q);
+
+    if (result != 0)
+        goto done;
+
+    for (i = 0; i < num_items; ++i)
+        latencies[i] = q_items[i].latency_ns;
+
+    sort(latencies, num_items, sizeof(*latencies), _benchmark_cmp_u64, NULL);
+
+    NVQ_TEST_PRINT("%s queue, %u producers, %u items: "
+                   "latency ns p50 %llu p90 %llu p99 %llu p99.9 %llu max %llu, %llu items/sec\n",
+                   (flags & NV_KTHREAD_Q_FLAGS_LOCKLESS) ? "lockless" : "default",
+                   num_producers,
+                   num_items,
+                   latencies[num_items / 2],
+                   latencies[(u64)num_items * 90 / 100],
+                   latencies[(u64)num_items * 99 / 100],
+                   latencies[(u64)num_items * 999 / 1000],
+                   latencies[num_items - 1],
+                   div64_u64((u64)num_items * NSEC_PER_SEC, max_t(u64, elapsed_ns, 1)));
+
+done:
+    if (latencies)
+        vfree(latencies);
+    if (q_items)
+        vfree(q_items);
+    if (producer_args)
+        vfree(producer_args);
+
+    return result;
+}
+
+int nv_kthread_q_run_benchmark(unsigned num_producers)
+{
+    int result;
+    unsigned i;
+    const unsigned flags[] = { 0, NV_KTHREAD_Q_FLAGS_LOCKLESS };
+
+    if (num_producers == 0 || num_producers > MAX_BENCHMARK_PRODUCERS) {
+        NVQ_TEST_PRINT("Invalid number of producers %u, must be in [1, %u]\n",
+                       num_producers, MAX_BENCHMARK_PRODUCERS);
+        return -1;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(flags); ++i) {
+        result = _benchmark_q(flags[i], num_producers);
+        TEST_CHECK_RET(result == 0);
+    }
+
+    return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Top-level test entry point
 
 int nv_kthread_q_run_self_test(void)
 {
     int result;
+    unsigned i;
+    const unsigned flags[] = { 0, NV_KTHREAD_Q_FLAGS_LOCKLESS };
 
-    result = _basic_start_stop_test();
-    TEST_CHECK_RET(result == 0);
+    for (i = 0; i < ARRAY_SIZE(flags); ++i) {
+        result = _basic_start_stop_test(flags[i]);
+        TEST_CHECK_RET(result == 0);
 
-    result = _reschedule_same_item_from_its_own_callback_test();
-    TEST_CHECK_RET(result == 0);
+        result = _reschedule_same_item_from_its_own_callback_test(flags[i]);
+        TEST_CHECK_RET(result == 0);
 
-    result = _multithreaded_q_test();
-    TEST_CHECK_RET(result == 0);
+        result = _multithreaded_q_test(flags[i]);
+        TEST_CHECK_RET(result == 0);
 
-    result = _same_q_item_test();
-    TEST_CHECK_RET(result == 0);
+        result = _same_q_item_test(flags[i]);
+        TEST_CHECK_RET(result == 0);
+
+        result = _fifo_order_test(flags[i]);
+        TEST_CHECK_RET(result == 0);
+
+        result = _attrs_test(flags[i]);
+        TEST_CHECK_RET(result == 0);
+    }
 
     result = _check_cpu_affinity_test();
     TEST_CHECK_RET(result == 0);
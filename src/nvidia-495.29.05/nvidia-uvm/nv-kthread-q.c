@@ -29,6 +29,7 @@
 #include <linux/completion.h>
 #include <linux/module.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
 
 #if defined(NV_LINUX_BUG_H_PRESENT)
     #include <linux/bug.h>
@@ -43,6 +44,11 @@
 //
 // 2. Each nv_kthread_q instance is serviced by exactly one kthread.
 //
+// 3. Queues in NV_KTHREAD_Q_FLAGS_LOCKLESS mode keep their pending items in a
+//    LIFO stack that producers push to with cmpxchg. The kthread detaches the
+//    whole stack with xchg, and reverses it in order to run the items in
+//    first-in, first-out order.
+//
 // You can create any number of queues, each of which gets its own
 // named kernel thread (kthread). You can then insert arbitrary functions
 // into the queue, and those functions will be run in the context of the
@@ -59,6 +65,14 @@
     })
 #endif
 
+#ifndef MIN_NICE
+#define MIN_NICE (-20)
+#endif
+
+#ifndef MAX_NICE
+#define MAX_NICE 19
+#endif
+
 #define NVQ_WARN(fmt, ...)                                   \
     do {                                                     \
         if (in_interrupt()) {                                \
@@ -72,13 +86,32 @@
         }                                                    \
     } while (0)
 
+static u64 _get_time_ns(void)
+{
+    return ktime_to_ns(ktime_get());
+}
+
+static void _stats_item_run(nv_kthread_q_t *q, u64 schedule_time_ns)
+{
+    u64 latency_ns = _get_time_ns() - schedule_time_ns;
+
+    ++q->stats.items_run;
+    q->stats.total_latency_ns += latency_ns;
+    if (latency_ns > q->stats.max_latency_ns)
+        q->stats.max_latency_ns = latency_ns;
+}
+
 static int _main_loop(void *args)
 {
     nv_kthread_q_t *q = (nv_kthread_q_t *)args;
     nv_kthread_q_item_t *q_item = NULL;
+    nv_kthread_q_item_t *batch[NV_KTHREAD_Q_MAX_BATCH];
     unsigned long flags;
 
     while (1) {
+        unsigned i;
+        unsigned batch_count = 0;
+
         // Normally this thread is never interrupted. However,
         // down_interruptible (instead of down) is called here,
         // in order to avoid being classified as a potentially
@@ -99,17 +132,40 @@ static int _main_loop(void *args)
             continue;
         }
 
-        // Consume one item from the queue
-        q_item = list_first_entry(&q->q_list_head,
-                                   nv_kthread_q_item_t,
-                                   q_list_node);
+        // Consume up to max_batch items from the queue. Once they are removed
+        // from the list, they can be rescheduled, even before they run.
+        do {
+            q_item = list_first_entry(&q->q_list_head,
+                                       nv_kthread_q_item_t,
+                                       q_list_node);
+
+            list_del_init(&q_item->q_list_node);
 
-        list_del_init(&q_item->q_list_node);
+            batch[batch_count++] = q_item;
+        } while (batch_count < q->max_batch && !list_empty(&q->q_list_head));
 
         spin_unlock_irqrestore(&q->q_lock, flags);
 
-        // Run the item
-        q_item->function_to_run(q_item->function_args);
+        // Consume the semaphore count of the additional items. The producer
+        // of each one of them increments it right after releasing q_lock, so
+        // these do not block for long.
+        for (i = 1; i < batch_count; ++i) {
+            while (down_interruptible(&q->q_sem))
+                NVQ_WARN("Interrupted during semaphore wait\n");
+        }
+
+        if (q->flags & NV_KTHREAD_Q_FLAGS_STATS)
+            ++q->stats.wakeups;
+
+        for (i = 0; i < batch_count; ++i) {
+            q_item = batch[i];
+
+            if (q->flags & NV_KTHREAD_Q_FLAGS_STATS)
+                _stats_item_run(q, q_item->q_schedule_time_ns);
+
+            // Run the item
+            q_item->function_to_run(q_item->function_args);
+        }
 
         // Make debugging a little simpler by clearing this between runs:
         q_item = NULL;
@@ -121,6 +177,86 @@ static int _main_loop(void *args)
     return 0;
 }
 
+// Reverse the order of a stack of items detached from q_lockless_head, so that
+// they are run in submission order.
+static nv_kthread_q_item_t *_lockless_reverse(nv_kthread_q_item_t *q_item)
+{
+    nv_kthread_q_item_t *reversed = NULL;
+
+    while (q_item) {
+        nv_kthread_q_item_t *next = q_item->q_lockless_next;
+
+        q_item->q_lockless_next = reversed;
+        reversed = q_item;
+        q_item = next;
+    }
+
+    return reversed;
+}
+
+static int _main_loop_lockless(void *args)
+{
+    nv_kthread_q_t *q = (nv_kthread_q_t *)args;
+    nv_kthread_q_item_t *q_item = NULL;
+
+    while (1) {
+        nv_kthread_q_item_t *pending;
+
+        // set_current_state() implies a full memory barrier, which pairs with
+        // the cmpxchg in _raw_q_schedule_lockless(), so either the producer
+        // sees that the kthread needs to be woken up, or the kthread sees the
+        // new item.
+        //
+        // Sleeping in TASK_INTERRUPTIBLE state also prevents the kthread from
+        // being classified as a potentially hung task, by the kernel watchdog.
+        set_current_state(TASK_INTERRUPTIBLE);
+
+        if (!q->q_lockless_head && !atomic_read(&q->main_loop_should_exit))
+            schedule();
+
+        __set_current_state(TASK_RUNNING);
+
+        if (atomic_read(&q->main_loop_should_exit))
+            break;
+
+        // Consume all of the pending items at once
+        pending = _lockless_reverse(xchg(&q->q_lockless_head, NULL));
+
+        if ((q->flags & NV_KTHREAD_Q_FLAGS_STATS) && pending)
+            ++q->stats.wakeups;
+
+        while (pending) {
+            nv_q_func_t function_to_run;
+            void *function_args;
+
+            q_item = pending;
+            pending = q_item->q_lockless_next;
+
+            function_to_run = q_item->function_to_run;
+            function_args = q_item->function_args;
+
+            if (q->flags & NV_KTHREAD_Q_FLAGS_STATS)
+                _stats_item_run(q, q_item->q_schedule_time_ns);
+
+            // From this point on the q_item can be rescheduled, including from
+            // its own callback. All the fields used by this loop have already
+            // been read.
+            clear_bit_unlock(0, &q_item->q_lockless_pending);
+
+            // Run the item
+            function_to_run(function_args);
+
+            // Make debugging a little simpler by clearing this between runs:
+            q_item = NULL;
+        }
+    }
+
+    while (!kthread_should_stop())
+        schedule();
+
+    return 0;
+}
+
 void nv_kthread_q_stop(nv_kthread_q_t *q)
 {
     // check if queue has been properly initialized
@@ -132,7 +268,7 @@ void nv_kthread_q_stop(nv_kthread_q_t *q)
     // If this assertion fires, then a caller likely either broke the API rules,
     // by adding items after calling nv_kthread_q_stop, or possibly messed up
     // with inadequate flushing of self-rescheduling q_items.
-    if (unlikely(!list_empty(&q->q_list_head)))
+    if (unlikely(!list_empty(&q->q_list_head) || q->q_lockless_head))
         NVQ_WARN("list not empty after flushing\n");
 
     if (likely(!atomic_read(&q->main_loop_should_exit))) {
@@ -140,7 +276,10 @@ void nv_kthread_q_stop(nv_kthread_q_t *q)
         atomic_set(&q->main_loop_should_exit, 1);
 
         // Wake up the kthread so that it can see that it needs to stop:
-        up(&q->q_sem);
+        if (q->flags & NV_KTHREAD_Q_FLAGS_LOCKLESS)
+            wake_up_process(q->q_kthread);
+        else
+            up(&q->q_sem);
 
         kthread_stop(q->q_kthread);
         q->q_kthread = NULL;
@@ -219,20 +358,75 @@ static struct task_struct *thread_create_on_node(int (*threadfn)(void *data),
 }
 #endif
 
-int nv_kthread_q_init_on_node(nv_kthread_q_t *q, const char *q_name, int preferred_node)
+static int _set_sched_attrs(nv_kthread_q_t *q, const nv_kthread_q_attrs_t *attrs)
+{
+#if NV_KTHREAD_Q_SUPPORTS_SCHED_ATTRS() == 1
+    if (attrs->cpumask) {
+        int ret = set_cpus_allowed_ptr(q->q_kthread, attrs->cpumask);
+        if (ret != 0)
+            return ret;
+    }
+
+    if (attrs->sched_policy == NV_KTHREAD_Q_SCHED_FIFO) {
+#if defined(NV_SCHED_SET_FIFO_PRESENT)
+        sched_set_fifo(q->q_kthread);
+#else
+        struct sched_param param = { .sched_priority = MAX_RT_PRIO / 2 };
+        int ret = sched_setscheduler(q->q_kthread, SCHED_FIFO, &param);
+        if (ret != 0)
+            return ret;
+#endif
+        return 0;
+    }
+#endif
+
+    if (attrs->nice != 0)
+        set_user_nice(q->q_kthread, attrs->nice);
+
+    return 0;
+}
+
+int nv_kthread_q_init_with_attrs(nv_kthread_q_t *q,
+                                 const char *q_name,
+                                 const nv_kthread_q_attrs_t *attrs)
 {
+    int (*main_loop)(void *args) = _main_loop;
+    int preferred_node = attrs->preferred_node;
+    int ret;
+
     memset(q, 0, sizeof(*q));
 
     INIT_LIST_HEAD(&q->q_list_head);
     spin_lock_init(&q->q_lock);
     sema_init(&q->q_sem, 0);
 
+#if NV_KTHREAD_Q_SUPPORTS_SCHED_ATTRS() == 0
+    if (attrs->cpumask || attrs->sched_policy != NV_KTHREAD_Q_SCHED_NORMAL)
+        return -ENOTSUPP;
+#endif
+
+    if (attrs->sched_policy != NV_KTHREAD_Q_SCHED_NORMAL &&
+        attrs->sched_policy != NV_KTHREAD_Q_SCHED_FIFO)
+        return -EINVAL;
+
+    if (attrs->nice < MIN_NICE || attrs->nice > MAX_NICE)
+        return -EINVAL;
+
+    if (attrs->max_batch > NV_KTHREAD_Q_MAX_BATCH)
+        return -EINVAL;
+
+    q->flags = attrs->flags;
+    q->max_batch = attrs->max_batch? attrs->max_batch : 1;
+
+    if (q->flags & NV_KTHREAD_Q_FLAGS_LOCKLESS)
+        main_loop = _main_loop_lockless;
+
     if (preferred_node == NV_KTHREAD_NO_NODE) {
-        q->q_kthread = kthread_create(_main_loop, q, q_name);
+        q->q_kthread = kthread_create(main_loop, q, q_name);
     }
     else {
 #if NV_KTHREAD_Q_SUPPORTS_AFFINITY() == 1
-        q->q_kthread = thread_create_on_node(_main_loop, q, preferred_node, q_name);
+        q->q_kthread = thread_create_on_node(main_loop, q, preferred_node, q_name);
 #else
         return -ENOTSUPP;
 #endif
@@ -248,11 +442,48 @@ int nv_kthread_q_init_on_node(nv_kthread_q_t *q, const char *q_name, int preferr
         return err;
     }
 
+    // The kthread has not run yet, so it is stopped directly instead of going
+    // through nv_kthread_q_stop(), which would need it to flush the queue.
+    ret = _set_sched_attrs(q, attrs);
+    if (ret != 0) {
+        kthread_stop(q->q_kthread);
+        q->q_kthread = NULL;
+
+        return ret;
+    }
+
     wake_up_process(q->q_kthread);
 
     return 0;
 }
 
+int nv_kthread_q_init_on_node_flags(nv_kthread_q_t *q,
+                                    const char *q_name,
+                                    int preferred_node,
+                                    unsigned flags)
+{
+    nv_kthread_q_attrs_t attrs = {
+        .preferred_node = preferred_node,
+        .flags          = flags,
+        .sched_policy   = NV_KTHREAD_Q_SCHED_NORMAL,
+    };
+
+    return nv_kthread_q_init_with_attrs(q, q_name, &attrs);
+}
+
+int nv_kthread_q_init_on_node(nv_kthread_q_t *q, const char *q_name, int preferred_node)
+{
+    return nv_kthread_q_init_on_node_flags(q, q_name, preferred_node, 0);
+}
+
+void nv_kthread_q_get_stats(nv_kthread_q_t *q, nv_kthread_q_stats_t *stats)
+{
+    stats->items_run        = q->stats.items_run;
+    stats->wakeups          = q->stats.wakeups;
+    stats->total_latency_ns = q->stats.total_latency_ns;
+    stats->max_latency_ns   = q->stats.max_latency_ns;
+}
+
 // Returns true (non-zero) if the item was actually scheduled, and false if the
 // item was already pending in a queue.
 static int _raw_q_schedule(nv_kthread_q_t *q, nv_kthread_q_item_t *q_item)
@@ -262,10 +493,15 @@ static int _raw_q_schedule(nv_kthread_q_t *q, nv_kthread_q_item_t *q_item)
 
     spin_lock_irqsave(&q->q_lock, flags);
 
-    if (likely(list_empty(&q_item->q_list_node)))
+    if (likely(list_empty(&q_item->q_list_node))) {
+        if (q->flags & NV_KTHREAD_Q_FLAGS_STATS)
+            q_item->q_schedule_time_ns = _get_time_ns();
+
         list_add_tail(&q_item->q_list_node, &q->q_list_head);
-    else
+    }
+    else {
         ret = 0;
+    }
 
     spin_unlock_irqrestore(&q->q_lock, flags);
 
@@ -275,6 +511,34 @@ static int _raw_q_schedule(nv_kthread_q_t *q, nv_kthread_q_item_t *q_item)
     return ret;
 }
 
+// Same as _raw_q_schedule(), for queues in NV_KTHREAD_Q_FLAGS_LOCKLESS mode.
+static int _raw_q_schedule_lockless(nv_kthread_q_t *q, nv_kthread_q_item_t *q_item)
+{
+    nv_kthread_q_item_t *head;
+    nv_kthread_q_item_t *old_head;
+
+    if (test_and_set_bit(0, &q_item->q_lockless_pending))
+        return 0;
+
+    if (q->flags & NV_KTHREAD_Q_FLAGS_STATS)
+        q_item->q_schedule_time_ns = _get_time_ns();
+
+    head = q->q_lockless_head;
+    do {
+        old_head = head;
+        q_item->q_lockless_next = old_head;
+        head = cmpxchg(&q->q_lockless_head, old_head, q_item);
+    } while (head != old_head);
+
+    // If the queue was not empty, the kthread has already been woken up by
+    // the producer that pushed the first pending item, and it has not
+    // consumed the pending items yet.
+    if (!old_head)
+        wake_up_process(q->q_kthread);
+
+    return 1;
+}
+
 void nv_kthread_q_item_init(nv_kthread_q_item_t *q_item,
                             nv_q_func_t function_to_run,
                             void *function_args)
@@ -282,6 +546,9 @@ void nv_kthread_q_item_init(nv_kthread_q_item_t *q_item,
     INIT_LIST_HEAD(&q_item->q_list_node);
     q_item->function_to_run = function_to_run;
     q_item->function_args   = function_args;
+    q_item->q_lockless_next = NULL;
+    q_item->q_lockless_pending = 0;
+    q_item->q_schedule_time_ns = 0;
 }
 
 // Returns true (non-zero) if the q_item got scheduled, false otherwise.
@@ -294,6 +561,9 @@ int nv_kthread_q_schedule_q_item(nv_kthread_q_t *q,
         return 0;
     }
 
+    if (q->flags & NV_KTHREAD_Q_FLAGS_LOCKLESS)
+        return _raw_q_schedule_lockless(q, q_item);
+
     return _raw_q_schedule(q, q_item);
 }
 
@@ -311,7 +581,10 @@ static void _raw_q_flush(nv_kthread_q_t *q)
 
     nv_kthread_q_item_init(&q_item, _q_flush_function, &completion);
 
-    _raw_q_schedule(q, &q_item);
+    if (q->flags & NV_KTHREAD_Q_FLAGS_LOCKLESS)
+        _raw_q_schedule_lockless(q, &q_item);
+    else
+        _raw_q_schedule(q, &q_item);
 
     // Wait for the flush item to run. Once it has run, then all of the
     // previously queued items in front of it will have run, so that means
@@ -46,12 +46,54 @@ static LIST_HEAD(g_cpu_service_block_context_list);
 
 static uvm_spinlock_t g_cpu_service_block_context_list_lock;
 
+// Per-CPU stacks of free fault service contexts for CPU faults, checked before
+// the global list so that CPU faults on different cores don't contend on its
+// lock. The caches are only accessed with preemption disabled and never from
+// interrupt context, so they don't need a lock.
+#define UVM_CPU_SERVICE_CONTEXT_CACHE_DEPTH_MAX 8
+
+typedef struct
+{
+    unsigned count;
+    uvm_service_block_context_t *contexts[UVM_CPU_SERVICE_CONTEXT_CACHE_DEPTH_MAX];
+} uvm_cpu_service_context_cache_t;
+
+static DEFINE_PER_CPU(uvm_cpu_service_context_cache_t, g_cpu_service_context_cache);
+
+static unsigned uvm_cpu_service_context_cache_depth = 1;
+module_param(uvm_cpu_service_context_cache_depth, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_cpu_service_context_cache_depth,
+                 "Number of CPU fault service contexts preallocated and cached per CPU. "
+                 "0 = disabled, max 8. Default: 1.");
+
 NV_STATUS uvm_service_block_context_init(void)
 {
     unsigned num_preallocated_contexts = 4;
+    int cpu;
 
     uvm_spin_lock_init(&g_cpu_service_block_context_list_lock, UVM_LOCK_ORDER_LEAF);
 
+    if (uvm_cpu_service_context_cache_depth > UVM_CPU_SERVICE_CONTEXT_CACHE_DEPTH_MAX) {
+        pr_info("Invalid value %u for uvm_cpu_service_context_cache_depth. Using %u instead\n",
+                uvm_cpu_service_context_cache_depth,
+                UVM_CPU_SERVICE_CONTEXT_CACHE_DEPTH_MAX);
+        uvm_cpu_service_context_cache_depth = UVM_CPU_SERVICE_CONTEXT_CACHE_DEPTH_MAX;
+    }
+
+    // Fill the caches of the online CPUs. CPUs brought online later fill
+    // their caches as contexts are freed on them.
+    for_each_online_cpu(cpu) {
+        uvm_cpu_service_context_cache_t *cache = &per_cpu(g_cpu_service_context_cache, cpu);
+
+        while (cache->count < uvm_cpu_service_context_cache_depth) {
+            uvm_service_block_context_t *service_context = uvm_kvmalloc(sizeof(*service_context));
+            if (!service_context)
+                return NV_ERR_NO_MEMORY;
+
+            cache->contexts[cache->count++] = service_context;
+        }
+    }
+
     // Pre-allocate some fault service contexts for the CPU and add them to the global list
     while (num_preallocated_contexts-- > 0) {
         uvm_service_block_context_t *service_context = uvm_kvmalloc(sizeof(*service_context));
@@ -67,6 +109,14 @@ NV_STATUS uvm_service_block_context_init(void)
 void uvm_service_block_context_exit(void)
 {
     uvm_service_block_context_t *service_context, *service_context_tmp;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        uvm_cpu_service_context_cache_t *cache = &per_cpu(g_cpu_service_context_cache, cpu);
+
+        while (cache->count > 0)
+            uvm_kvfree(cache->contexts[--cache->count]);
+    }
 
     // Free fault service contexts for the CPU and add clear the global list
     list_for_each_entry_safe(service_context, service_context_tmp, &g_cpu_service_block_context_list,
@@ -76,11 +126,20 @@ void uvm_service_block_context_exit(void)
     INIT_LIST_HEAD(&g_cpu_service_block_context_list);
 }
 
-// Get a fault service context from the global list or allocate a new one if there are no
-// available entries
+// Get a fault service context from the per-CPU cache or the global list, or
+// allocate a new one if there are no available entries
 static uvm_service_block_context_t *uvm_service_block_context_cpu_alloc(void)
 {
-    uvm_service_block_context_t *service_context;
+    uvm_service_block_context_t *service_context = NULL;
+    uvm_cpu_service_context_cache_t *cache;
+
+    cache = &get_cpu_var(g_cpu_service_context_cache);
+    if (cache->count > 0)
+        service_context = cache->contexts[--cache->count];
+    put_cpu_var(g_cpu_service_context_cache);
+
+    if (service_context)
+        return service_context;
 
     uvm_spin_lock(&g_cpu_service_block_context_list_lock);
 
@@ -98,9 +157,23 @@ static uvm_service_block_context_t *uvm_service_block_context_cpu_alloc(void)
     return service_context;
 }
 
-// Put a fault service context in the global list
+// Put a fault service context in the per-CPU cache, or in the global list if
+// the cache is full
 static void uvm_service_block_context_cpu_free(uvm_service_block_context_t *service_context)
 {
+    uvm_cpu_service_context_cache_t *cache;
+    bool cached = false;
+
+    cache = &get_cpu_var(g_cpu_service_context_cache);
+    if (cache->count < uvm_cpu_service_context_cache_depth) {
+        cache->contexts[cache->count++] = service_context;
+        cached = true;
+    }
+    put_cpu_var(g_cpu_service_context_cache);
+
+    if (cached)
+        return;
+
     uvm_spin_lock(&g_cpu_service_block_context_list_lock);
 
     list_add(&service_context->cpu_fault.service_context_list, &g_cpu_service_block_context_list);
@@ -108,6 +181,88 @@ static void uvm_service_block_context_cpu_free(uvm_service_block_context_t *serv
     uvm_spin_unlock(&g_cpu_service_block_context_list_lock);
 }
 
+// Per-CPU stacks of free parameter buffers for the ioctls routed through
+// UVM_ROUTE_CMD_ALLOC_*. The buffers can't be owned by a CPU for the whole
+// ioctl, as the ioctl may sleep and migrate, so they are only taken from and
+// returned to the cache of the current CPU, with preemption disabled. All the
+// buffers have the same size, larger parameters bypass the cache.
+#define UVM_IOCTL_PARAM_BUFFER_SIZE PAGE_SIZE
+#define UVM_IOCTL_PARAM_CACHE_DEPTH_MAX 4
+
+typedef struct
+{
+    unsigned count;
+    void *buffers[UVM_IOCTL_PARAM_CACHE_DEPTH_MAX];
+} uvm_ioctl_param_cache_t;
+
+static DEFINE_PER_CPU(uvm_ioctl_param_cache_t, g_ioctl_param_cache);
+
+static unsigned uvm_ioctl_param_cache_depth = 1;
+module_param(uvm_ioctl_param_cache_depth, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_ioctl_param_cache_depth,
+                 "Number of free ioctl parameter buffers cached per CPU. "
+                 "0 = disabled, max 4. Default: 1.");
+
+static void uvm_ioctl_param_cache_init(void)
+{
+    if (uvm_ioctl_param_cache_depth > UVM_IOCTL_PARAM_CACHE_DEPTH_MAX) {
+        pr_info("Invalid value %u for uvm_ioctl_param_cache_depth. Using %u instead\n",
+                uvm_ioctl_param_cache_depth,
+                UVM_IOCTL_PARAM_CACHE_DEPTH_MAX);
+        uvm_ioctl_param_cache_depth = UVM_IOCTL_PARAM_CACHE_DEPTH_MAX;
+    }
+}
+
+// Must be called before uvm_global_exit(), which tears down uvm_kvmalloc
+static void uvm_ioctl_param_cache_exit(void)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        uvm_ioctl_param_cache_t *cache = &per_cpu(g_ioctl_param_cache, cpu);
+
+        while (cache->count > 0)
+            uvm_kvfree(cache->buffers[--cache->count]);
+    }
+}
+
+void *uvm_ioctl_param_buffer_alloc(size_t size)
+{
+    uvm_ioctl_param_cache_t *cache;
+    void *buffer = NULL;
+
+    if (size > UVM_IOCTL_PARAM_BUFFER_SIZE)
+        return uvm_kvmalloc(size);
+
+    cache = &get_cpu_var(g_ioctl_param_cache);
+    if (cache->count > 0)
+        buffer = cache->buffers[--cache->count];
+    put_cpu_var(g_ioctl_param_cache);
+
+    if (!buffer)
+        buffer = uvm_kvmalloc(UVM_IOCTL_PARAM_BUFFER_SIZE);
+
+    return buffer;
+}
+
+void uvm_ioctl_param_buffer_free(void *buffer, size_t size)
+{
+    uvm_ioctl_param_cache_t *cache;
+    bool cached = false;
+
+    if (size <= UVM_IOCTL_PARAM_BUFFER_SIZE) {
+        cache = &get_cpu_var(g_ioctl_param_cache);
+        if (cache->count < uvm_ioctl_param_cache_depth) {
+            cache->buffers[cache->count++] = buffer;
+            cached = true;
+        }
+        put_cpu_var(g_ioctl_param_cache);
+    }
+
+    if (!cached)
+        uvm_kvfree(buffer);
+}
+
 static int uvm_open(struct inode *inode, struct file *filp)
 {
     NV_STATUS status = uvm_global_get_status();
@@ -187,7 +342,7 @@ static void uvm_destroy_vma_managed(struct vm_area_struct *vma, bool make_zombie
     uvm_va_range_t *va_range, *va_range_next;
     NvU64 size = 0;
 
-    uvm_assert_rwsem_locked_write(&uvm_va_space_get(vma->vm_file)->lock);
+    uvm_assert_percpu_rwsem_locked_write(&uvm_va_space_get(vma->vm_file)->lock);
     uvm_for_each_va_range_in_vma_safe(va_range, va_range_next, vma) {
         // On exit_mmap (process teardown), current->mm is cleared so
         // uvm_va_range_vma_current would return NULL.
@@ -214,7 +369,7 @@ static void uvm_destroy_vma_semaphore_pool(struct vm_area_struct *vma)
     uvm_va_range_t *va_range;
 
     va_space = uvm_va_space_get(vma->vm_file);
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
     va_range = uvm_va_range_find(va_space, vma->vm_start);
     UVM_ASSERT(va_range &&
                va_range->node.start   == vma->vm_start &&
@@ -305,7 +460,7 @@ static void uvm_vm_open_failure(struct vm_area_struct *original,
     static const bool make_zombie = false;
 
     UVM_ASSERT(va_space == uvm_va_space_get(original->vm_file));
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     uvm_destroy_vma_managed(original, make_zombie);
     uvm_disable_vma(original);
@@ -569,6 +724,9 @@ static vm_fault_t uvm_vm_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
         status = uvm_va_block_cpu_fault(va_block, fault_addr, is_write, service_context);
     } while (status == NV_WARN_MORE_PROCESSING_REQUIRED);
 
+    if (status == NV_OK && service_context->cpu_fault.did_migrate)
+        uvm_va_block_cpu_fault_readahead(va_block, service_context);
+
     if (status != NV_OK) {
         UvmEventFatalReason reason;
 
@@ -591,7 +749,7 @@ static vm_fault_t uvm_vm_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
     uvm_record_unlock_mmap_lock_read(vma->vm_mm);
 
     if (status == NV_OK) {
-        status = uvm_global_mask_check_ecc_error(&gpus_to_check_for_ecc);
+        status = uvm_global_mask_check_ecc_error_aggregated(&gpus_to_check_for_ecc);
         uvm_global_mask_release(&gpus_to_check_for_ecc);
     }
 
@@ -937,6 +1095,11 @@ static long uvm_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
         UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_CLEAN_UP_ZOMBIE_RESOURCES,      uvm_api_clean_up_zombie_resources);
         UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_POPULATE_PAGEABLE,              uvm_api_populate_pageable);
         UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_VALIDATE_VA_RANGE,              uvm_api_validate_va_range);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_GET_RESIDENCY_INFO,             uvm_api_get_residency_info);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_SET_FAULT_SERVICE_WEIGHT,       uvm_api_set_fault_service_weight);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_SET_ACCESS_COUNTER_POLICY,      uvm_api_set_access_counter_policy);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_SET_RESIDENCY_PINNED,           uvm_api_set_residency_pinned);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TOOLS_GET_GPU_TIME_CALIBRATION, uvm_api_tools_get_gpu_time_calibration);
     }
 
     // Try the test ioctls if none of the above matched
@@ -1060,13 +1223,23 @@ static void uvm_chardev_exit(void)
     unregister_chrdev_region(g_uvm_base_dev, NVIDIA_UVM_NUM_MINOR_DEVICES);
 }
 
+static unsigned uvm_nv_kthread_q_benchmark_producers = 0;
+module_param(uvm_nv_kthread_q_benchmark_producers, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_nv_kthread_q_benchmark_producers,
+                 "Number of producer threads of the nv_kthread_q latency and throughput "
+                 "benchmark run at load time, with results printed to the kernel log. "
+                 "0 = disabled, max 64. Default: 0.");
+
 static int uvm_init(void)
 {
     bool initialized_globals = false;
     bool added_device = false;
     int ret;
+    NV_STATUS status;
+
+    uvm_ioctl_param_cache_init();
 
-    NV_STATUS status = uvm_global_init();
+    status = uvm_global_init();
     if (status != NV_OK) {
         UVM_ERR_PRINT("uvm_global_init() failed: %s\n", nvstatusToString(status));
         ret = -ENODEV;
@@ -1092,6 +1265,11 @@ static int uvm_init(void)
     if (uvm_enable_builtin_tests)
         pr_info("Built-in UVM tests are enabled. This is a security risk.\n");
 
+    // The benchmark is informational, so a failure doesn't fail the load
+    if (uvm_nv_kthread_q_benchmark_producers != 0 &&
+        nv_kthread_q_run_benchmark(uvm_nv_kthread_q_benchmark_producers) != 0)
+        pr_info("nv_kthread_q benchmark failed\n");
+
 
 
 
@@ -1109,6 +1287,8 @@ error:
     if (added_device)
         uvm_chardev_exit();
 
+    uvm_ioctl_param_cache_exit();
+
     if (initialized_globals)
         uvm_global_exit();
 
@@ -1127,6 +1307,8 @@ static void uvm_exit(void)
     uvm_tools_exit();
     uvm_chardev_exit();
 
+    uvm_ioctl_param_cache_exit();
+
     uvm_global_exit();
 
     uvm_test_unload_state_exit();
@@ -72,17 +72,23 @@
 #define UVM_ROUTE_CMD_STACK_INIT_CHECK(cmd, function_name) \
     __UVM_ROUTE_CMD_STACK(cmd, cmd##_PARAMS, function_name, true)
 
+// Allocate and free the parameters of the ioctls routed through
+// UVM_ROUTE_CMD_ALLOC_*. Small enough buffers are recycled through per-CPU
+// caches instead of going through uvm_kvmalloc on every ioctl.
+void *uvm_ioctl_param_buffer_alloc(size_t size);
+void uvm_ioctl_param_buffer_free(void *buffer, size_t size);
+
 // If the BUILD_BUG_ON fires, use __UVM_ROUTE_CMD_STACK instead
 #define __UVM_ROUTE_CMD_ALLOC(cmd, params_type, function_name, do_init_check)           \
     case cmd:                                                                           \
     {                                                                                   \
         int ret = 0;                                                                    \
-        params_type *params = uvm_kvmalloc(sizeof(*params));                            \
+        params_type *params = uvm_ioctl_param_buffer_alloc(sizeof(*params));            \
         if (!params)                                                                    \
             return -ENOMEM;                                                             \
         BUILD_BUG_ON(sizeof(*params) <= UVM_MAX_IOCTL_PARAM_STACK_SIZE);                \
         if (nv_copy_from_user(params, (void __user*)arg, sizeof(*params))) {            \
-            uvm_kvfree(params);                                                         \
+            uvm_ioctl_param_buffer_free(params, sizeof(*params));                       \
             return -EFAULT;                                                             \
         }                                                                               \
                                                                                         \
@@ -97,7 +103,7 @@
         if (nv_copy_to_user((void __user*)arg, params, sizeof(*params)))                \
             ret = -EFAULT;                                                              \
                                                                                         \
-        uvm_kvfree(params);                                                             \
+        uvm_ioctl_param_buffer_free(params, sizeof(*params));                           \
         return ret;                                                                     \
     }
 
@@ -240,9 +246,13 @@ NV_STATUS uvm_api_migrate(UVM_MIGRATE_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_enable_system_wide_atomics(UVM_ENABLE_SYSTEM_WIDE_ATOMICS_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_disable_system_wide_atomics(UVM_DISABLE_SYSTEM_WIDE_ATOMICS_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_tools_init_event_tracker(UVM_TOOLS_INIT_EVENT_TRACKER_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_tools_init_event_tracker_per_cpu(UVM_TOOLS_INIT_EVENT_TRACKER_PER_CPU_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_tools_init_histogram_tracker(UVM_TOOLS_INIT_HISTOGRAM_TRACKER_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_tools_get_histograms(UVM_TOOLS_GET_HISTOGRAMS_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_tools_set_notification_threshold(UVM_TOOLS_SET_NOTIFICATION_THRESHOLD_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_tools_event_queue_enable_events(UVM_TOOLS_EVENT_QUEUE_ENABLE_EVENTS_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_tools_event_queue_disable_events(UVM_TOOLS_EVENT_QUEUE_DISABLE_EVENTS_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_tools_event_queue_set_sampling(UVM_TOOLS_EVENT_QUEUE_SET_SAMPLING_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_tools_enable_counters(UVM_TOOLS_ENABLE_COUNTERS_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_tools_disable_counters(UVM_TOOLS_DISABLE_COUNTERS_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_tools_read_process_memory(UVM_TOOLS_READ_PROCESS_MEMORY_PARAMS *params, struct file *filp);
@@ -252,5 +262,10 @@ NV_STATUS uvm_api_unmap_external(UVM_UNMAP_EXTERNAL_PARAMS *params, struct file
 NV_STATUS uvm_api_migrate_range_group(UVM_MIGRATE_RANGE_GROUP_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_alloc_semaphore_pool(UVM_ALLOC_SEMAPHORE_POOL_PARAMS *params, struct file *filp);
 NV_STATUS uvm_api_populate_pageable(const UVM_POPULATE_PAGEABLE_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_get_residency_info(UVM_GET_RESIDENCY_INFO_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_set_fault_service_weight(UVM_SET_FAULT_SERVICE_WEIGHT_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_set_access_counter_policy(const UVM_SET_ACCESS_COUNTER_POLICY_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_set_residency_pinned(const UVM_SET_RESIDENCY_PINNED_PARAMS *params, struct file *filp);
+NV_STATUS uvm_api_tools_get_gpu_time_calibration(UVM_TOOLS_GET_GPU_TIME_CALIBRATION_PARAMS *params, struct file *filp);
 
 #endif // __UVM_API_H__
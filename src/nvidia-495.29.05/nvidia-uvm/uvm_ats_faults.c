@@ -25,8 +25,90 @@
 #include "uvm_ats_ibm.h"
 #include "uvm_ats_faults.h"
 
+// Return the number of pages in the run of contiguous faulting pages that
+// starts with the page of current_entry and continues with the pages of
+// next_entries. The run doesn't extend past end (inclusive).
+static NvU32 ats_fault_run_pages(uvm_fault_buffer_entry_t *current_entry,
+                                 uvm_fault_buffer_entry_t **next_entries,
+                                 NvU32 num_next_entries,
+                                 NvU64 end)
+{
+    NvU64 run_end = UVM_ALIGN_DOWN(current_entry->fault_address, PAGE_SIZE) + PAGE_SIZE;
+    NvU32 num_pages = 1;
+    NvU32 i;
+
+    for (i = 0; i < num_next_entries && num_pages < UVM_ATS_SERVICE_FAULTS_MAX_PAGES; ++i) {
+        uvm_fault_buffer_entry_t *entry = next_entries[i];
+        NvU64 page_addr = UVM_ALIGN_DOWN(entry->fault_address, PAGE_SIZE);
+
+        if (entry->va_space != current_entry->va_space)
+            break;
+
+        // Another fault on a page already in the run
+        if (page_addr < run_end)
+            continue;
+
+        if (page_addr != run_end || page_addr + PAGE_SIZE - 1 > end)
+            break;
+
+        run_end += PAGE_SIZE;
+        ++num_pages;
+    }
+
+    return num_pages;
+}
+
+// Make the page of current_entry resident, together with the run of faulting
+// pages following it in the batch. end (inclusive) bounds the run to the range
+// checked to have no GMMU mappings.
+static NV_STATUS ats_service_fault_run(uvm_gpu_va_space_t *gpu_va_space,
+                                       uvm_fault_buffer_entry_t *current_entry,
+                                       uvm_fault_buffer_entry_t **next_entries,
+                                       NvU32 num_next_entries,
+                                       NvU64 end,
+                                       uvm_fault_access_type_t access_type,
+                                       uvm_ats_fault_invalidate_t *ats_invalidate)
+{
+    struct mm_struct *mm = gpu_va_space->va_space->va_space_mm.mm;
+    NvU64 start = UVM_ALIGN_DOWN(current_entry->fault_address, PAGE_SIZE);
+    bool write = (access_type >= UVM_FAULT_ACCESS_TYPE_WRITE);
+    struct vm_area_struct *vma;
+    NvU32 num_pages = 1;
+    NvU32 num_serviced;
+    NV_STATUS status;
+
+    // The page was already made resident by the run of an earlier fault
+    if (ats_invalidate->populated.gpu_va_space == gpu_va_space &&
+        start >= ats_invalidate->populated.start &&
+        start + PAGE_SIZE - 1 <= ats_invalidate->populated.end &&
+        (ats_invalidate->populated.write || !write))
+        return NV_OK;
+
+    // Only group the faults within the VMA of the first one, which share its
+    // permissions. If there's no VMA, the kernel reports the invalid address
+    // for the single page.
+    vma = find_vma(mm, start);
+    if (vma && vma->vm_start <= start) {
+        end = min(end, (NvU64)vma->vm_end - 1);
+        num_pages = ats_fault_run_pages(current_entry, next_entries, num_next_entries, end);
+    }
+
+    status = uvm_ats_ibm_service_faults(gpu_va_space, start, num_pages, access_type, &num_serviced);
+    if (status != NV_OK)
+        return status;
+
+    ats_invalidate->populated.gpu_va_space = gpu_va_space;
+    ats_invalidate->populated.start = start;
+    ats_invalidate->populated.end = start + num_serviced * PAGE_SIZE - 1;
+    ats_invalidate->populated.write = write;
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_ats_service_fault_entry(uvm_gpu_va_space_t *gpu_va_space,
                                       uvm_fault_buffer_entry_t *current_entry,
+                                      uvm_fault_buffer_entry_t **next_entries,
+                                      NvU32 num_next_entries,
                                       uvm_ats_fault_invalidate_t *ats_invalidate)
 {
     NvU64 gmmu_region_base;
@@ -40,6 +122,7 @@ NV_STATUS uvm_ats_service_fault_entry(uvm_gpu_va_space_t *gpu_va_space,
 
     UVM_ASSERT(current_entry->fault_access_type ==
                uvm_fault_access_type_mask_highest(current_entry->access_type_mask));
+    UVM_ASSERT(num_next_entries == 0 || next_entries);
 
     service_access_type = current_entry->fault_access_type;
 
@@ -60,8 +143,13 @@ NV_STATUS uvm_ats_service_fault_entry(uvm_gpu_va_space_t *gpu_va_space,
         status = NV_ERR_INVALID_ADDRESS;
     }
     else {
-        // TODO: Bug 2103669: Service more than a single fault at a time
-        status = uvm_ats_ibm_service_fault(gpu_va_space, current_entry->fault_address, service_access_type);
+        status = ats_service_fault_run(gpu_va_space,
+                                       current_entry,
+                                       next_entries,
+                                       num_next_entries,
+                                       gmmu_region_base + UVM_GMMU_ATS_GRANULARITY - 1,
+                                       service_access_type,
+                                       ats_invalidate);
     }
 
     // Do not flag prefetch faults as fatal unless something fatal happened
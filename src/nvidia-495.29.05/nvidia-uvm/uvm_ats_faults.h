@@ -26,8 +26,15 @@
 #include "uvm_global.h"
 #include "uvm_va_space.h"
 
+// Service the ATS fault in current_entry. next_entries are the faults that
+// follow it in the batch, sorted by VA space and address, and can be NULL if
+// num_next_entries is 0. The pages of the following faults that extend the
+// faulting page into a contiguous run within the same VMA are made resident
+// with the same call into the kernel, and their faults then don't need one.
 NV_STATUS uvm_ats_service_fault_entry(uvm_gpu_va_space_t *gpu_va_space,
                                       uvm_fault_buffer_entry_t *current_entry,
+                                      uvm_fault_buffer_entry_t **next_entries,
+                                      NvU32 num_next_entries,
                                       uvm_ats_fault_invalidate_t *ats_invalidate);
 
 // This function performs pending TLB invalidations for ATS and clears the
@@ -36,6 +43,13 @@ NV_STATUS uvm_ats_invalidate_tlbs(uvm_gpu_va_space_t *gpu_va_space,
                                   uvm_ats_fault_invalidate_t *ats_invalidate,
                                   uvm_tracker_t *out_tracker);
 
+// Reset the ATS state of ats_invalidate at the beginning of a fault batch
+static void uvm_ats_fault_batch_begin(uvm_ats_fault_invalidate_t *ats_invalidate)
+{
+    ats_invalidate->write_faults_in_batch = false;
+    ats_invalidate->populated.gpu_va_space = NULL;
+}
+
 static bool uvm_can_ats_service_faults(uvm_gpu_va_space_t *gpu_va_space, struct mm_struct *mm)
 {
     if (mm)
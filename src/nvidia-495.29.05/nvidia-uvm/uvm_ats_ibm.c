@@ -432,7 +432,7 @@ NV_STATUS uvm_ats_ibm_register_gpu_va_space(uvm_gpu_va_space_t *gpu_va_space)
     UVM_ASSERT(g_uvm_global.ats.enabled);
     UVM_ASSERT(uvm_gpu_va_space_state(gpu_va_space) == UVM_GPU_VA_SPACE_STATE_ACTIVE);
     UVM_ASSERT(va_space->va_space_mm.mm);
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
 #if UVM_ATS_IBM_SUPPORTED_IN_KERNEL()
     status = uvm_ats_ibm_register_gpu_va_space_kernel(gpu_va_space);
@@ -455,26 +455,46 @@ void uvm_ats_ibm_unregister_gpu_va_space(uvm_gpu_va_space_t *gpu_va_space)
 NV_STATUS uvm_ats_ibm_service_fault(uvm_gpu_va_space_t *gpu_va_space,
                                     NvU64 fault_addr,
                                     uvm_fault_access_type_t access_type)
+{
+    NvU32 num_serviced;
+
+    return uvm_ats_ibm_service_faults(gpu_va_space,
+                                      UVM_ALIGN_DOWN(fault_addr, PAGE_SIZE),
+                                      1,
+                                      access_type,
+                                      &num_serviced);
+}
+
+NV_STATUS uvm_ats_ibm_service_faults(uvm_gpu_va_space_t *gpu_va_space,
+                                     NvU64 start,
+                                     NvU32 num_pages,
+                                     uvm_fault_access_type_t access_type,
+                                     NvU32 *num_serviced)
 {
     uvm_va_space_t *va_space = gpu_va_space->va_space;
     struct mm_struct *mm = va_space->va_space_mm.mm;
     int write = (access_type >= UVM_FAULT_ACCESS_TYPE_WRITE);
     int force = 0;
-    struct page *page;
-    char *mapping;
+    struct page *pages[UVM_ATS_SERVICE_FAULTS_MAX_PAGES];
     int ret;
+    int i;
 
     UVM_ASSERT(g_uvm_global.ats.enabled);
     UVM_ASSERT(gpu_va_space->ats.enabled);
     UVM_ASSERT(mm);
+    UVM_ASSERT(IS_ALIGNED(start, PAGE_SIZE));
+    UVM_ASSERT(num_pages > 0 && num_pages <= UVM_ATS_SERVICE_FAULTS_MAX_PAGES);
     uvm_assert_mmap_lock_locked(mm);
 
-    // TODO: Bug 2103669: Service more than a single fault at a time
-    ret = NV_GET_USER_PAGES_REMOTE(NULL, mm, (unsigned long)fault_addr, 1, write, force, &page, NULL);
+    *num_serviced = 0;
+
+    // get_user_pages() stops at the first page it can't fault in, and only
+    // fails if that's the first one
+    ret = NV_GET_USER_PAGES_REMOTE(NULL, mm, (unsigned long)start, num_pages, write, force, pages, NULL);
     if (ret < 0)
         return errno_to_nv_status(ret);
 
-    UVM_ASSERT(ret == 1);
+    UVM_ASSERT(ret > 0 && ret <= num_pages);
 
     // Under virtualization ATS provides two translations:
     // 1) guest virtual -> guest physical
@@ -493,10 +513,15 @@ NV_STATUS uvm_ats_ibm_service_fault(uvm_gpu_va_space_t *gpu_va_space,
     // drivers/vfio/pci/vfio_pci_nvlink2.c enforces this. Thus we can assume
     // that a read fault is always sufficient to also enable write access on the
     // guest translation.
-    mapping = (char *)kmap(page);
-    (void)UVM_READ_ONCE(*mapping);
-    kunmap(page);
-    put_page(page);
+    for (i = 0; i < ret; ++i) {
+        char *mapping = (char *)kmap(pages[i]);
+
+        (void)UVM_READ_ONCE(*mapping);
+        kunmap(pages[i]);
+        put_page(pages[i]);
+    }
+
+    *num_serviced = ret;
 
     return NV_OK;
 }
@@ -102,6 +102,10 @@
 // Maximum number of parallel ATSD register sets per NPU
 #define UVM_MAX_ATSD_REGS 16
 
+// Maximum number of pages serviced by a single uvm_ats_ibm_service_faults()
+// call
+#define UVM_ATS_SERVICE_FAULTS_MAX_PAGES 16
+
 typedef struct
 {
 #if UVM_IBM_NPU_SUPPORTED()
@@ -213,6 +217,20 @@ typedef struct
                                         NvU64 fault_addr,
                                         uvm_fault_access_type_t access_type);
 
+    // Request the kernel to handle faults on num_pages consecutive pages
+    // starting at the page-aligned address start, with a single call. The
+    // number of pages made resident is returned in num_serviced, which can be
+    // lower than num_pages if the range runs into an invalid page. An error is
+    // only returned if the first page can't be serviced. num_pages must not be
+    // greater than UVM_ATS_SERVICE_FAULTS_MAX_PAGES.
+    //
+    // LOCKING: mmap_lock must be held.
+    NV_STATUS uvm_ats_ibm_service_faults(uvm_gpu_va_space_t *gpu_va_space,
+                                         NvU64 start,
+                                         NvU32 num_pages,
+                                         uvm_fault_access_type_t access_type,
+                                         NvU32 *num_serviced);
+
     // Synchronously invalidate ATS translations cached by GPU TLBs. The
     // invalidate applies to all GPUs with active GPU VA spaces in va_space, and
     // covers all pages touching any part of the given range. end is inclusive.
@@ -241,6 +259,16 @@ typedef struct
         return NV_ERR_NOT_SUPPORTED;
     }
 
+    static NV_STATUS uvm_ats_ibm_service_faults(uvm_gpu_va_space_t *gpu_va_space,
+                                                NvU64 start,
+                                                NvU32 num_pages,
+                                                uvm_fault_access_type_t access_type,
+                                                NvU32 *num_serviced)
+    {
+        *num_serviced = 0;
+        return NV_ERR_NOT_SUPPORTED;
+    }
+
     static void uvm_ats_ibm_invalidate(uvm_va_space_t *va_space, NvU64 start, NvU64 end)
     {
 
@@ -201,6 +201,78 @@ done:
     return status;
 }
 
+#define MEMCOPY_2D_LINES      8
+#define MEMCOPY_2D_LINE_SIZE  64
+#define MEMCOPY_2D_SRC_PITCH  (3 * MEMCOPY_2D_LINE_SIZE)
+#define MEMCOPY_2D_DST_PITCH  (2 * MEMCOPY_2D_LINE_SIZE)
+
+// Copy every third line of a sysmem buffer to every other line of another one,
+// and check that only the expected bytes were written.
+static NV_STATUS test_memcopy_2d(uvm_gpu_t *gpu)
+{
+    NV_STATUS status;
+    uvm_rm_mem_t *src_mem = NULL;
+    uvm_rm_mem_t *dst_mem = NULL;
+    NvU8 *src_ptr;
+    NvU8 *dst_ptr;
+    uvm_push_t push;
+    NvU64 src_va;
+    NvU64 dst_va;
+    size_t i;
+    const size_t src_size = MEMCOPY_2D_LINES * MEMCOPY_2D_SRC_PITCH;
+    const size_t dst_size = MEMCOPY_2D_LINES * MEMCOPY_2D_DST_PITCH;
+
+    status = uvm_rm_mem_alloc_and_map_cpu(gpu, UVM_RM_MEM_TYPE_SYS, src_size, &src_mem);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    status = uvm_rm_mem_alloc_and_map_cpu(gpu, UVM_RM_MEM_TYPE_SYS, dst_size, &dst_mem);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    src_ptr = (NvU8 *)uvm_rm_mem_get_cpu_va(src_mem);
+    dst_ptr = (NvU8 *)uvm_rm_mem_get_cpu_va(dst_mem);
+
+    for (i = 0; i < src_size; ++i)
+        src_ptr[i] = (NvU8)(i + 1);
+    memset(dst_ptr, 0, dst_size);
+
+    status = uvm_push_begin(gpu->channel_manager, UVM_CHANNEL_TYPE_GPU_TO_CPU, &push, "Memcopy 2D test");
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    src_va = uvm_rm_mem_get_gpu_va(src_mem, gpu, uvm_channel_is_proxy(push.channel));
+    dst_va = uvm_rm_mem_get_gpu_va(dst_mem, gpu, uvm_channel_is_proxy(push.channel));
+
+    gpu->parent->ce_hal->memcopy_2d(&push,
+                                    uvm_gpu_address_virtual(dst_va),
+                                    MEMCOPY_2D_DST_PITCH,
+                                    uvm_gpu_address_virtual(src_va),
+                                    MEMCOPY_2D_SRC_PITCH,
+                                    MEMCOPY_2D_LINE_SIZE,
+                                    MEMCOPY_2D_LINES);
+
+    status = uvm_push_end_and_wait(&push);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    for (i = 0; i < dst_size; ++i) {
+        size_t line = i / MEMCOPY_2D_DST_PITCH;
+        size_t offset = i % MEMCOPY_2D_DST_PITCH;
+        NvU8 expected = 0;
+
+        if (offset < MEMCOPY_2D_LINE_SIZE)
+            expected = src_ptr[line * MEMCOPY_2D_SRC_PITCH + offset];
+
+        if (dst_ptr[i] != expected) {
+            UVM_TEST_PRINT("Byte %zu = 0x%x instead of 0x%x, GPU %s\n", i, dst_ptr[i], expected, uvm_gpu_name(gpu));
+            status = NV_ERR_INVALID_STATE;
+            goto done;
+        }
+    }
+
+done:
+    uvm_rm_mem_free(dst_mem);
+    uvm_rm_mem_free(src_mem);
+
+    return status;
+}
+
 static void push_memset(uvm_push_t *push, uvm_gpu_address_t dst, NvU64 value, size_t element_size, size_t size)
 {
     switch (element_size) {
@@ -661,6 +733,7 @@ static NV_STATUS test_ce(uvm_va_space_t *va_space, bool skipTimestampTest)
         TEST_CHECK_RET(test_non_pipelined(gpu) == NV_OK);
         TEST_CHECK_RET(test_membar(gpu) == NV_OK);
         TEST_CHECK_RET(test_memcpy_and_memset(gpu) == NV_OK);
+        TEST_CHECK_RET(test_memcopy_2d(gpu) == NV_OK);
         TEST_CHECK_RET(test_semaphore_reduction_inc(gpu) == NV_OK);
         TEST_CHECK_RET(test_semaphore_release(gpu) == NV_OK);
         if (!skipTimestampTest)
@@ -686,3 +759,311 @@ done:
 
     return status;
 }
+
+#define CE_BANDWIDTH_DEFAULT_MIN_SIZE UVM_CHUNK_SIZE_64K
+#define CE_BANDWIDTH_DEFAULT_MAX_SIZE UVM_CHUNK_SIZE_MAX
+#define CE_BANDWIDTH_DEFAULT_ITERATIONS 16
+
+// Semaphore timestamps are 4 words long (16 bytes), with the timestamp itself
+// in the second 8-byte half. Two of them bracket each measurement.
+#define CE_BANDWIDTH_TIMESTAMP_SIZE 16
+
+typedef struct
+{
+    UVM_TEST_CE_BANDWIDTH_PARAMS *params;
+
+    // GPU doing the copies and the GPU owning the destination of peer copies
+    uvm_gpu_t *gpu;
+    uvm_gpu_t *peer;
+
+    // Sysmem holding the start and end timestamps, mapped on gpu
+    uvm_mem_t *timestamp_mem;
+} ce_bandwidth_t;
+
+static NV_STATUS ce_bandwidth_measure(ce_bandwidth_t *bw,
+                                      uvm_channel_t *channel,
+                                      uvm_gpu_address_t dst,
+                                      uvm_gpu_address_t src,
+                                      size_t size,
+                                      UVM_TEST_CE_BANDWIDTH_OP op,
+                                      NvU64 *elapsed_ns)
+{
+    NV_STATUS status;
+    uvm_push_t push;
+    uvm_gpu_t *gpu = bw->gpu;
+    NvU64 *timestamps = uvm_mem_get_cpu_addr_kernel(bw->timestamp_mem);
+    NvU64 gpu_va = uvm_mem_get_gpu_va_kernel(bw->timestamp_mem, gpu);
+    NvU64 start, end;
+    NvU32 i;
+
+    memset(timestamps, 0, 2 * CE_BANDWIDTH_TIMESTAMP_SIZE);
+
+    status = uvm_push_begin_on_channel(channel,
+                                       &push,
+                                       "CE bandwidth %s of %zu bytes x %u",
+                                       op == UVM_TEST_CE_BANDWIDTH_OP_MEMCOPY ? "memcopy" : "memset",
+                                       size,
+                                       bw->params->iterations);
+    if (status != NV_OK)
+        return status;
+
+    // The operations only touch memory private to this test, so there is no
+    // need to order them against each other. Let the CE pipeline them.
+    gpu->parent->ce_hal->semaphore_timestamp(&push, gpu_va);
+
+    for (i = 0; i < bw->params->iterations; i++) {
+        uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
+        if (op == UVM_TEST_CE_BANDWIDTH_OP_MEMCOPY)
+            gpu->parent->ce_hal->memcopy(&push, dst, src, size);
+        else
+            gpu->parent->ce_hal->memset_8(&push, dst, 0, size);
+    }
+
+    // The release of the end timestamp waits for the operations to complete
+    gpu->parent->ce_hal->semaphore_timestamp(&push, gpu_va + CE_BANDWIDTH_TIMESTAMP_SIZE);
+
+    status = uvm_push_end_and_wait(&push);
+    if (status != NV_OK)
+        return status;
+
+    start = timestamps[1];
+    end = timestamps[3];
+
+    // Some configurations don't support semaphore timestamps, see
+    // UVM_TEST_CE_SANITY_PARAMS::skipTimestampTest
+    if (start == 0 || end < start)
+        return NV_ERR_NOT_SUPPORTED;
+
+    *elapsed_ns = end - start;
+
+    return NV_OK;
+}
+
+// Measure both operations at every size between dst and src, on the first
+// channel of the given pool.
+static NV_STATUS ce_bandwidth_path(ce_bandwidth_t *bw,
+                                   uvm_channel_pool_t *pool,
+                                   uvm_channel_type_t type,
+                                   UVM_TEST_CE_BANDWIDTH_PATH path,
+                                   uvm_gpu_address_t dst,
+                                   uvm_gpu_address_t src)
+{
+    UVM_TEST_CE_BANDWIDTH_PARAMS *params = bw->params;
+    UVM_TEST_CE_BANDWIDTH_OP op;
+    NvU64 size;
+
+    for (size = params->min_size; size <= params->max_size; size *= 2) {
+        for (op = 0; op < UVM_TEST_CE_BANDWIDTH_OP_MAX; op++) {
+            UVM_TEST_CE_BANDWIDTH_RESULT *result;
+            NvU64 elapsed_ns;
+            NV_STATUS status;
+
+            if (params->num_results == UVM_TEST_CE_BANDWIDTH_MAX_RESULTS) {
+                params->truncated = NV_TRUE;
+                return NV_OK;
+            }
+
+            status = ce_bandwidth_measure(bw, pool->channels, dst, src, size, op, &elapsed_ns);
+            if (status != NV_OK)
+                return status;
+
+            result = &params->results[params->num_results++];
+            result->gpu_uuid = *uvm_gpu_uuid(bw->gpu);
+            result->peer_uuid = *uvm_gpu_uuid(bw->peer ? bw->peer : bw->gpu);
+            result->size = size;
+            result->elapsed_ns = elapsed_ns;
+            result->ce_index = pool->ce_index;
+            result->channel_type = type;
+            result->path = path;
+            result->op = op;
+        }
+    }
+
+    return NV_OK;
+}
+
+// Measure the path through every CE that pushes of the given type can use
+static NV_STATUS ce_bandwidth_type(ce_bandwidth_t *bw,
+                                   uvm_channel_type_t type,
+                                   UVM_TEST_CE_BANDWIDTH_PATH path,
+                                   uvm_gpu_address_t dst,
+                                   uvm_gpu_address_t src)
+{
+    uvm_channel_manager_t *manager = bw->gpu->channel_manager;
+    unsigned num_pools = manager->pool_to_use.striping[type].num_pools;
+    unsigned i;
+
+    if (num_pools == 0)
+        return ce_bandwidth_path(bw, manager->pool_to_use.default_for_type[type], type, path, dst, src);
+
+    for (i = 0; i < num_pools; i++) {
+        NV_STATUS status = ce_bandwidth_path(bw,
+                                             manager->pool_to_use.striping[type].pools[i],
+                                             type,
+                                             path,
+                                             dst,
+                                             src);
+        if (status != NV_OK)
+            return status;
+    }
+
+    return NV_OK;
+}
+
+static NV_STATUS ce_bandwidth_peer(ce_bandwidth_t *bw, uvm_gpu_t *peer, uvm_gpu_address_t src)
+{
+    NV_STATUS status;
+    uvm_channel_manager_t *manager = bw->gpu->channel_manager;
+    uvm_channel_pool_t *pool = manager->pool_to_use.gpu_to_gpu[uvm_id_gpu_index(peer->id)];
+    uvm_gpu_chunk_t *peer_chunk = NULL;
+
+    // Same preferred pool as uvm_channel_reserve_gpu_to_gpu(), ignoring striping
+    if (pool == NULL)
+        pool = manager->pool_to_use.default_for_type[UVM_CHANNEL_TYPE_GPU_TO_GPU];
+
+    status = uvm_pmm_gpu_alloc_kernel(&peer->pmm, 1, UVM_CHUNK_SIZE_MAX, UVM_PMM_ALLOC_FLAGS_NONE, &peer_chunk, NULL);
+    if (status != NV_OK)
+        return status;
+
+    bw->peer = peer;
+    status = ce_bandwidth_path(bw,
+                               pool,
+                               UVM_CHANNEL_TYPE_GPU_TO_GPU,
+                               UVM_TEST_CE_BANDWIDTH_PATH_VIDMEM_TO_PEER,
+                               uvm_pmm_gpu_peer_copy_address(&peer->pmm, peer_chunk, bw->gpu),
+                               src);
+    bw->peer = NULL;
+
+    uvm_pmm_gpu_free(&peer->pmm, peer_chunk, NULL);
+
+    return status;
+}
+
+static NV_STATUS ce_bandwidth_gpu(ce_bandwidth_t *bw, uvm_va_space_t *va_space)
+{
+    NV_STATUS status;
+    uvm_gpu_t *gpu = bw->gpu;
+    uvm_gpu_t *peer;
+    uvm_mem_t *sys_mem = NULL;
+    uvm_gpu_chunk_t *vid_chunks[2] = { NULL, NULL };
+    uvm_gpu_address_t sys_addr;
+    uvm_gpu_address_t vid_addr[2];
+    size_t i;
+
+    status = uvm_mem_alloc_sysmem_and_map_cpu_kernel(2 * CE_BANDWIDTH_TIMESTAMP_SIZE, &bw->timestamp_mem);
+    if (status != NV_OK)
+        goto done;
+    status = uvm_mem_map_gpu_kernel(bw->timestamp_mem, gpu);
+    if (status != NV_OK)
+        goto done;
+
+    status = uvm_mem_alloc_sysmem_and_map_cpu_kernel(UVM_CHUNK_SIZE_MAX, &sys_mem);
+    if (status != NV_OK)
+        goto done;
+    status = uvm_mem_map_gpu_kernel(sys_mem, gpu);
+    if (status != NV_OK)
+        goto done;
+    memset(uvm_mem_get_cpu_addr_kernel(sys_mem), 0, UVM_CHUNK_SIZE_MAX);
+    sys_addr = uvm_mem_gpu_address_virtual_kernel(sys_mem, gpu);
+
+    for (i = 0; i < ARRAY_SIZE(vid_chunks); i++) {
+        status = uvm_pmm_gpu_alloc_kernel(&gpu->pmm,
+                                          1,
+                                          UVM_CHUNK_SIZE_MAX,
+                                          UVM_PMM_ALLOC_FLAGS_NONE,
+                                          &vid_chunks[i],
+                                          NULL);
+        if (status != NV_OK)
+            goto done;
+        vid_addr[i] = uvm_gpu_address_physical(UVM_APERTURE_VID, vid_chunks[i]->address);
+    }
+
+    status = ce_bandwidth_type(bw,
+                               UVM_CHANNEL_TYPE_CPU_TO_GPU,
+                               UVM_TEST_CE_BANDWIDTH_PATH_SYSMEM_TO_VIDMEM,
+                               vid_addr[0],
+                               sys_addr);
+    if (status != NV_OK)
+        goto done;
+
+    status = ce_bandwidth_type(bw,
+                               UVM_CHANNEL_TYPE_GPU_TO_CPU,
+                               UVM_TEST_CE_BANDWIDTH_PATH_VIDMEM_TO_SYSMEM,
+                               sys_addr,
+                               vid_addr[0]);
+    if (status != NV_OK)
+        goto done;
+
+    status = ce_bandwidth_type(bw,
+                               UVM_CHANNEL_TYPE_GPU_INTERNAL,
+                               UVM_TEST_CE_BANDWIDTH_PATH_VIDMEM_TO_VIDMEM,
+                               vid_addr[1],
+                               vid_addr[0]);
+    if (status != NV_OK)
+        goto done;
+
+    for_each_va_space_gpu(peer, va_space) {
+        if (peer == gpu || !uvm_va_space_peer_enabled(va_space, gpu, peer))
+            continue;
+
+        // Indirect peers are accessed through sysmem addresses, which needs
+        // the peer chunk to be mapped for the accessing GPU first. Their
+        // bandwidth is covered by the sysmem paths.
+        if (uvm_gpu_peer_caps(gpu, peer)->is_indirect_peer)
+            continue;
+
+        status = ce_bandwidth_peer(bw, peer, vid_addr[0]);
+        if (status != NV_OK)
+            goto done;
+    }
+
+done:
+    for (i = 0; i < ARRAY_SIZE(vid_chunks); i++) {
+        if (vid_chunks[i])
+            uvm_pmm_gpu_free(&gpu->pmm, vid_chunks[i], NULL);
+    }
+
+    uvm_mem_free(sys_mem);
+    uvm_mem_free(bw->timestamp_mem);
+    bw->timestamp_mem = NULL;
+
+    return status;
+}
+
+NV_STATUS uvm_test_ce_bandwidth(UVM_TEST_CE_BANDWIDTH_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    ce_bandwidth_t bw = { 0 };
+    uvm_gpu_t *gpu;
+
+    if (params->min_size == 0)
+        params->min_size = CE_BANDWIDTH_DEFAULT_MIN_SIZE;
+    if (params->max_size == 0)
+        params->max_size = CE_BANDWIDTH_DEFAULT_MAX_SIZE;
+    if (params->iterations == 0)
+        params->iterations = CE_BANDWIDTH_DEFAULT_ITERATIONS;
+
+    if (!IS_ALIGNED(params->min_size, 8) ||
+        !IS_ALIGNED(params->max_size, 8) ||
+        params->min_size > params->max_size ||
+        params->max_size > UVM_CHUNK_SIZE_MAX)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    params->num_results = 0;
+    params->truncated = NV_FALSE;
+    bw.params = params;
+
+    uvm_va_space_down_read_rm(va_space);
+
+    for_each_va_space_gpu(gpu, va_space) {
+        bw.gpu = gpu;
+        status = ce_bandwidth_gpu(&bw, va_space);
+        if (status != NV_OK)
+            break;
+    }
+
+    uvm_va_space_up_read_rm(va_space);
+
+    return status;
+}
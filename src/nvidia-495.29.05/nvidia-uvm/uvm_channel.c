@@ -53,10 +53,31 @@ static char *uvm_channel_gpput_loc = UVM_CHANNEL_GPPUT_LOC_DEFAULT;
 
 static char *uvm_channel_pushbuffer_loc = UVM_CHANNEL_PUSHBUFFER_LOC_DEFAULT;
 
+// Spread the pushes of the copy channel types (CPU_TO_GPU, GPU_TO_CPU and
+// GPU_INTERNAL) across all the CEs usable for the type, picking the CE with the
+// smallest backlog of pending pushes instead of always using the preferred CE.
+// Pushes to NVSwitch-connected peers are also spread across all the NVLink P2P
+// CEs, see uvm_channel_manager_set_p2p_ce().
+static int uvm_channel_ce_striping = 0;
+
+// Blocking waits for pushes busy-wait for at most uvm_channel_wait_spin_max_us
+// and then sleep in slices of up to uvm_channel_wait_sleep_us, see
+// uvm_channel_manager_wait_step(). A sleep slice of 0 disables sleeping.
+#define UVM_CHANNEL_WAIT_SPIN_MAX_US_DEFAULT 50
+#define UVM_CHANNEL_WAIT_SPIN_MAX_US_MAX (1000 * 1000)
+#define UVM_CHANNEL_WAIT_SLEEP_US_DEFAULT 20
+#define UVM_CHANNEL_WAIT_SLEEP_US_MAX (10 * 1000)
+
+static unsigned uvm_channel_wait_spin_max_us = UVM_CHANNEL_WAIT_SPIN_MAX_US_DEFAULT;
+static unsigned uvm_channel_wait_sleep_us = UVM_CHANNEL_WAIT_SLEEP_US_DEFAULT;
+
 module_param(uvm_channel_num_gpfifo_entries, uint, S_IRUGO);
 module_param(uvm_channel_gpfifo_loc, charp, S_IRUGO);
 module_param(uvm_channel_gpput_loc, charp, S_IRUGO);
 module_param(uvm_channel_pushbuffer_loc, charp, S_IRUGO);
+module_param(uvm_channel_ce_striping, int, S_IRUGO);
+module_param(uvm_channel_wait_spin_max_us, uint, S_IRUGO);
+module_param(uvm_channel_wait_sleep_us, uint, S_IRUGO);
 
 static NV_STATUS manager_create_procfs_dirs(uvm_channel_manager_t *manager);
 static NV_STATUS manager_create_procfs(uvm_channel_manager_t *manager);
@@ -72,18 +93,18 @@ typedef enum
     UVM_CHANNEL_UPDATE_MODE_FORCE_ALL
 } uvm_channel_update_mode_t;
 
-// Update channel progress, completing up to max_to_complete entries
-static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
-                                                  NvU32 max_to_complete,
-                                                  uvm_channel_update_mode_t mode)
+// Update channel progress, completing up to max_to_complete entries that are
+// done as of completed_value
+static NvU32 channel_update_progress_with_completed_value(uvm_channel_t *channel,
+                                                          NvU32 max_to_complete,
+                                                          uvm_channel_update_mode_t mode,
+                                                          NvU64 completed_value)
 {
     NvU32 gpu_get;
     NvU32 cpu_put;
     NvU32 completed_count = 0;
     NvU32 pending_gpfifos;
 
-    NvU64 completed_value = uvm_channel_update_completed_value(channel);
-
     uvm_spin_lock(&channel->pool->lock);
 
     cpu_put = channel->cpu_put;
@@ -103,8 +124,21 @@ static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
 
     channel->gpu_get = gpu_get;
 
+    if (completed_count > 0)
+        atomic_sub(completed_count, &channel->pool->backlog);
+
     uvm_spin_unlock(&channel->pool->lock);
 
+    if (completed_count > 0) {
+        uvm_channel_manager_t *manager = channel->pool->manager;
+
+        // Pairs with the barrier implied by prepare_to_wait() in
+        // uvm_channel_manager_wait_step()
+        smp_mb();
+        if (waitqueue_active(&manager->completion_wait.queue))
+            wake_up_all(&manager->completion_wait.queue);
+    }
+
     if (cpu_put >= gpu_get)
         pending_gpfifos = cpu_put - gpu_get;
     else
@@ -113,6 +147,16 @@ static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
     return pending_gpfifos;
 }
 
+// Update channel progress, completing up to max_to_complete entries
+static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
+                                                  NvU32 max_to_complete,
+                                                  uvm_channel_update_mode_t mode)
+{
+    NvU64 completed_value = uvm_channel_update_completed_value(channel);
+
+    return channel_update_progress_with_completed_value(channel, max_to_complete, mode, completed_value);
+}
+
 NvU32 uvm_channel_update_progress(uvm_channel_t *channel)
 {
     // By default, don't complete too many entries at a time to spread the cost
@@ -137,12 +181,26 @@ NvU32 uvm_channel_manager_update_progress(uvm_channel_manager_t *channel_manager
 {
     NvU32 pending_gpfifos = 0;
     uvm_channel_pool_t *pool;
+    uvm_channel_t *channel;
 
+    // Sample the tracking semaphores of all the channels back to back first so
+    // that the GPU-written payloads are read in a single pass, instead of being
+    // interleaved with the pushbuffer and pool lock accesses of each channel.
     uvm_for_each_pool(pool, channel_manager) {
-        uvm_channel_t *channel;
-
         uvm_for_each_channel_in_pool(channel, pool)
-            pending_gpfifos += uvm_channel_update_progress(channel);
+            uvm_channel_update_completed_value(channel);
+    }
+
+    uvm_for_each_pool(pool, channel_manager) {
+        uvm_for_each_channel_in_pool(channel, pool) {
+            NvU64 completed_value = uvm_gpu_tracking_semaphore_get_completed_value(&channel->tracking_sem);
+
+            // Same default as uvm_channel_update_progress()
+            pending_gpfifos += channel_update_progress_with_completed_value(channel,
+                                                                            8,
+                                                                            UVM_CHANNEL_UPDATE_MODE_COMPLETED,
+                                                                            completed_value);
+        }
     }
 
     return pending_gpfifos;
@@ -167,6 +225,7 @@ static bool try_claim_channel(uvm_channel_t *channel)
 
     if (channel_is_available(channel)) {
         ++channel->current_pushes_count;
+        atomic_inc(&channel->pool->backlog);
         claimed = true;
     }
 
@@ -175,6 +234,12 @@ static bool try_claim_channel(uvm_channel_t *channel)
     return claimed;
 }
 
+static void channel_pool_record_reserve_stall(uvm_channel_pool_t *pool, const uvm_spin_loop_t *spin)
+{
+    atomic64_inc(&pool->stats.reserve_stalls);
+    atomic64_add(uvm_spin_loop_elapsed(spin), &pool->stats.reserve_stall_time_ns);
+}
+
 // Reserve a channel in the specified pool
 static NV_STATUS channel_reserve_in_pool(uvm_channel_pool_t *pool, uvm_channel_t **channel_out)
 {
@@ -197,13 +262,16 @@ static NV_STATUS channel_reserve_in_pool(uvm_channel_pool_t *pool, uvm_channel_t
             uvm_channel_update_progress(channel);
 
             if (try_claim_channel(channel)) {
+                channel_pool_record_reserve_stall(pool, &spin);
                 *channel_out = channel;
                 return NV_OK;
             }
 
             status = uvm_channel_check_errors(channel);
-            if (status != NV_OK)
+            if (status != NV_OK) {
+                channel_pool_record_reserve_stall(pool, &spin);
                 return status;
+            }
 
             UVM_SPIN_LOOP(&spin);
         }
@@ -213,9 +281,46 @@ static NV_STATUS channel_reserve_in_pool(uvm_channel_pool_t *pool, uvm_channel_t
     return NV_ERR_GENERIC;
 }
 
+// Pick the pool with the smallest backlog among the pools the given type can be
+// striped across. The preferred pool wins ties, so the preferred CE is used as
+// long as it is not busier than the rest.
+static uvm_channel_pool_t *channel_manager_pick_striping_pool(uvm_channel_manager_t *manager,
+                                                              uvm_channel_type_t type,
+                                                              uvm_channel_pool_t *preferred_pool)
+{
+    unsigned i;
+    uvm_channel_pool_t *best_pool = preferred_pool;
+    int best_backlog = atomic_read(&best_pool->backlog);
+
+    for (i = 0; i < manager->pool_to_use.striping[type].num_pools && best_backlog > 0; i++) {
+        uvm_channel_pool_t *pool = manager->pool_to_use.striping[type].pools[i];
+        int backlog = atomic_read(&pool->backlog);
+
+        if (backlog < best_backlog) {
+            best_pool = pool;
+            best_backlog = backlog;
+        }
+    }
+
+    return best_pool;
+}
+
 NV_STATUS uvm_channel_reserve_type(uvm_channel_manager_t *manager, uvm_channel_type_t type, uvm_channel_t **channel_out)
 {
-    return channel_reserve_in_pool(manager->pool_to_use.default_for_type[type], channel_out);
+    uvm_channel_pool_t *pool;
+
+    UVM_ASSERT(type < UVM_CHANNEL_TYPE_COUNT);
+
+    pool = manager->pool_to_use.default_for_type[type];
+
+    // GPU_TO_GPU pushes are only striped for the peers that allow it, see
+    // uvm_channel_reserve_gpu_to_gpu()
+    if (manager->conf.ce_striping &&
+        type != UVM_CHANNEL_TYPE_GPU_TO_GPU &&
+        manager->pool_to_use.striping[type].num_pools > 1)
+        pool = channel_manager_pick_striping_pool(manager, type, pool);
+
+    return channel_reserve_in_pool(pool, channel_out);
 }
 
 NV_STATUS uvm_channel_reserve_gpu_to_gpu(uvm_channel_manager_t *manager,
@@ -228,6 +333,8 @@ NV_STATUS uvm_channel_reserve_gpu_to_gpu(uvm_channel_manager_t *manager,
     // If there is no recommended pool for the given GPU pair, use default
     if (pool == NULL)
         pool = manager->pool_to_use.default_for_type[UVM_CHANNEL_TYPE_GPU_TO_GPU];
+    else if (manager->conf.ce_striping && test_bit(dst_gpu_index, manager->pool_to_use.gpu_to_gpu_striping))
+        pool = channel_manager_pick_striping_pool(manager, UVM_CHANNEL_TYPE_GPU_TO_GPU, pool);
 
     return channel_reserve_in_pool(pool, channel_out);
 }
@@ -242,13 +349,48 @@ NV_STATUS uvm_channel_manager_wait(uvm_channel_manager_t *manager)
 
     uvm_spin_loop_init(&spin);
     while (uvm_channel_manager_update_progress(manager) > 0 && status == NV_OK) {
-        UVM_SPIN_LOOP(&spin);
+        uvm_channel_manager_wait_step(manager, &spin);
         status = uvm_channel_manager_check_errors(manager);
     }
 
+    uvm_channel_manager_wait_done(manager, &spin);
+
     return status;
 }
 
+static NvU64 manager_wait_spin_window_ns(uvm_channel_manager_t *manager)
+{
+    NvU64 avg_wait_ns = atomic64_read(&manager->completion_wait.avg_wait_ns);
+
+    return min(2 * avg_wait_ns, manager->conf.wait_spin_max_ns);
+}
+
+NV_STATUS uvm_channel_manager_wait_step(uvm_channel_manager_t *manager, uvm_spin_loop_t *spin)
+{
+    if (manager->conf.wait_sleep_ns != 0 &&
+        NV_MAY_SLEEP() &&
+        uvm_spin_loop_elapsed(spin) >= manager_wait_spin_window_ns(manager)) {
+        DEFINE_WAIT(wait);
+        ktime_t timeout = ns_to_ktime(manager->conf.wait_sleep_ns);
+
+        prepare_to_wait(&manager->completion_wait.queue, &wait, TASK_UNINTERRUPTIBLE);
+        schedule_hrtimeout(&timeout, HRTIMER_MODE_REL);
+        finish_wait(&manager->completion_wait.queue, &wait);
+    }
+
+    return UVM_SPIN_LOOP(spin);
+}
+
+void uvm_channel_manager_wait_done(uvm_channel_manager_t *manager, const uvm_spin_loop_t *spin)
+{
+    NvU64 elapsed_ns = min(uvm_spin_loop_elapsed(spin), manager->conf.wait_spin_max_ns);
+    NvU64 avg_wait_ns = atomic64_read(&manager->completion_wait.avg_wait_ns);
+
+    // Racy read-modify-write, concurrent waiters may drop each others'
+    // samples, which is fine for a heuristic.
+    atomic64_set(&manager->completion_wait.avg_wait_ns, (avg_wait_ns * 7 + elapsed_ns) / 8);
+}
+
 static NvU32 channel_get_available_push_info_index(uvm_channel_t *channel)
 {
     uvm_push_info_t *push_info;
@@ -258,6 +400,7 @@ static NvU32 channel_get_available_push_info_index(uvm_channel_t *channel)
     push_info = list_first_entry_or_null(&channel->available_push_infos, uvm_push_info_t, available_list_node);
     UVM_ASSERT(push_info != NULL);
     UVM_ASSERT(push_info->on_complete == NULL && push_info->on_complete_data == NULL);
+    UVM_ASSERT(push_info->replay_latency == NULL);
     list_del(&push_info->available_list_node);
 
     uvm_spin_unlock(&channel->pool->lock);
@@ -375,6 +518,8 @@ NV_STATUS uvm_channel_reserve(uvm_channel_t *channel)
         uvm_channel_update_progress(channel);
     }
 
+    channel_pool_record_reserve_stall(channel->pool, &spin);
+
     return status;
 }
 
@@ -684,6 +829,9 @@ static NV_STATUS channel_pool_create(uvm_channel_manager_t *channel_manager,
     pool->is_proxy = is_proxy;
 
     uvm_spin_lock_init(&pool->lock, UVM_LOCK_ORDER_CHANNEL);
+    atomic_set(&pool->backlog, 0);
+    atomic64_set(&pool->stats.reserve_stalls, 0);
+    atomic64_set(&pool->stats.reserve_stall_time_ns, 0);
 
     num_channels = channel_pool_num_channels(pool);
 
@@ -842,11 +990,23 @@ static int compare_ce_for_channel_type(const UvmGpuCopyEngineCaps *ce_caps,
     return ce_index0 - ce_index1;
 }
 
+static bool channel_type_supports_striping(uvm_channel_type_t type)
+{
+    return type == UVM_CHANNEL_TYPE_CPU_TO_GPU ||
+           type == UVM_CHANNEL_TYPE_GPU_TO_CPU ||
+           type == UVM_CHANNEL_TYPE_GPU_INTERNAL ||
+           type == UVM_CHANNEL_TYPE_GPU_TO_GPU;
+}
+
 // Identify usable CEs, and select the preferred CE for a given channel type.
+//
+// The usable CEs for each type are also recorded in usable_ces, so the
+// corresponding pools can be used for striping once they are created.
 static NV_STATUS pick_ce_for_channel_type(uvm_channel_manager_t *manager,
                                           const UvmGpuCopyEngineCaps *ce_caps,
                                           uvm_channel_type_t type,
-                                          unsigned *preferred_ce)
+                                          unsigned *preferred_ce,
+                                          unsigned long *usable_ces)
 {
     NvU32 i;
     NvU32 best_ce = UVM_COPY_ENGINE_COUNT_MAX;
@@ -861,6 +1021,10 @@ static NV_STATUS pick_ce_for_channel_type(uvm_channel_manager_t *manager,
 
         __set_bit(i, manager->ce_mask);
 
+        // Peer pushes are only striped across CEs that write over NVLink
+        if (type != UVM_CHANNEL_TYPE_GPU_TO_GPU || cap->nvlinkP2p)
+            __set_bit(i, usable_ces);
+
         if (best_ce == UVM_COPY_ENGINE_COUNT_MAX) {
             best_ce = i;
             continue;
@@ -879,7 +1043,9 @@ static NV_STATUS pick_ce_for_channel_type(uvm_channel_manager_t *manager,
     return NV_OK;
 }
 
-static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manager, unsigned *preferred_ce)
+static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manager,
+                                                   unsigned *preferred_ce,
+                                                   unsigned long (*usable_ces)[BITS_TO_LONGS(UVM_COPY_ENGINE_COUNT_MAX)])
 {
     NV_STATUS status;
     unsigned i;
@@ -900,7 +1066,11 @@ static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manage
    // MEMOPS has the least priority as it only cares about low usage of the
    // CE to improve latency
     for (i = 0; i < ARRAY_SIZE(types); ++i) {
-        status = pick_ce_for_channel_type(manager, ces_caps.copyEngineCaps, types[i], preferred_ce);
+        status = pick_ce_for_channel_type(manager,
+                                          ces_caps.copyEngineCaps,
+                                          types[i],
+                                          preferred_ce,
+                                          usable_ces[types[i]]);
         if (status != NV_OK)
             return status;
     }
@@ -927,14 +1097,40 @@ static uvm_channel_pool_t *channel_manager_ce_pool(uvm_channel_manager_t *manage
     return pool;
 }
 
-void uvm_channel_manager_set_p2p_ce(uvm_channel_manager_t *manager, uvm_gpu_t *peer, NvU32 optimal_ce)
+static bool channel_manager_is_striping_pool(uvm_channel_manager_t *manager,
+                                             uvm_channel_type_t type,
+                                             uvm_channel_pool_t *pool)
+{
+    unsigned i;
+
+    for (i = 0; i < manager->pool_to_use.striping[type].num_pools; i++) {
+        if (manager->pool_to_use.striping[type].pools[i] == pool)
+            return true;
+    }
+
+    return false;
+}
+
+void uvm_channel_manager_set_p2p_ce(uvm_channel_manager_t *manager,
+                                    uvm_gpu_t *peer,
+                                    NvU32 optimal_ce,
+                                    bool allow_striping)
 {
     const NvU32 peer_gpu_index = uvm_id_gpu_index(peer->id);
+    uvm_channel_pool_t *pool;
 
     UVM_ASSERT(manager->gpu != peer);
     UVM_ASSERT(optimal_ce < UVM_COPY_ENGINE_COUNT_MAX);
 
-    manager->pool_to_use.gpu_to_gpu[peer_gpu_index] = channel_manager_ce_pool(manager, optimal_ce);
+    pool = channel_manager_ce_pool(manager, optimal_ce);
+    manager->pool_to_use.gpu_to_gpu[peer_gpu_index] = pool;
+
+    // Striping only makes sense if the optimal CE itself writes over NVLink,
+    // otherwise the other NVLink CEs are not interchangeable with it.
+    if (allow_striping && channel_manager_is_striping_pool(manager, UVM_CHANNEL_TYPE_GPU_TO_GPU, pool))
+        set_bit(peer_gpu_index, manager->pool_to_use.gpu_to_gpu_striping);
+    else
+        clear_bit(peer_gpu_index, manager->pool_to_use.gpu_to_gpu_striping);
 }
 
 static bool is_string_valid_location(const char *loc)
@@ -994,7 +1190,30 @@ static void init_channel_manager_conf(uvm_channel_manager_t *manager)
                 manager->conf.num_gpfifo_entries);
     }
 
-    // 2- Allocation locations
+    // 2- CE striping
+    manager->conf.ce_striping = uvm_channel_ce_striping != 0;
+
+    if (uvm_channel_wait_spin_max_us > UVM_CHANNEL_WAIT_SPIN_MAX_US_MAX) {
+        pr_info("Invalid value for uvm_channel_wait_spin_max_us = %u, using %u instead\n",
+                uvm_channel_wait_spin_max_us,
+                UVM_CHANNEL_WAIT_SPIN_MAX_US_MAX);
+        manager->conf.wait_spin_max_ns = UVM_CHANNEL_WAIT_SPIN_MAX_US_MAX * 1000ULL;
+    }
+    else {
+        manager->conf.wait_spin_max_ns = uvm_channel_wait_spin_max_us * 1000ULL;
+    }
+
+    if (uvm_channel_wait_sleep_us > UVM_CHANNEL_WAIT_SLEEP_US_MAX) {
+        pr_info("Invalid value for uvm_channel_wait_sleep_us = %u, using %u instead\n",
+                uvm_channel_wait_sleep_us,
+                UVM_CHANNEL_WAIT_SLEEP_US_MAX);
+        manager->conf.wait_sleep_ns = UVM_CHANNEL_WAIT_SLEEP_US_MAX * 1000ULL;
+    }
+    else {
+        manager->conf.wait_sleep_ns = uvm_channel_wait_sleep_us * 1000ULL;
+    }
+
+    // 3- Allocation locations
 
     // Override if the GPU doesn't have memory
     if (gpu->mem_info.size == 0) {
@@ -1030,7 +1249,7 @@ static void init_channel_manager_conf(uvm_channel_manager_t *manager)
         }
     }
 
-    // 3- GPFIFO/GPPut location
+    // 4- GPFIFO/GPPut location
     // Only support the knobs for GPFIFO/GPPut on Volta+
     if (!gpu->parent->gpfifo_in_vidmem_supported) {
         manager->conf.gpfifo_loc = UVM_BUFFER_LOCATION_DEFAULT;
@@ -1089,11 +1308,14 @@ static NV_STATUS channel_manager_create_pools(uvm_channel_manager_t *manager, bo
     unsigned num_channel_pools;
     bool is_proxy = false;
     unsigned preferred_ce[UVM_CHANNEL_TYPE_COUNT];
+    unsigned long usable_ces[UVM_CHANNEL_TYPE_COUNT][BITS_TO_LONGS(UVM_COPY_ENGINE_COUNT_MAX)];
+
+    memset(usable_ces, 0, sizeof(usable_ces));
 
     for (type = 0; type < ARRAY_SIZE(preferred_ce); type++)
         preferred_ce[type] = UVM_COPY_ENGINE_COUNT_MAX;
 
-    status = channel_manager_pick_copy_engines(manager, preferred_ce);
+    status = channel_manager_pick_copy_engines(manager, preferred_ce, usable_ces);
     if (status != NV_OK)
         return status;
 
@@ -1121,6 +1343,15 @@ static NV_STATUS channel_manager_create_pools(uvm_channel_manager_t *manager, bo
         UVM_ASSERT(test_bit(ce, manager->ce_mask));
 
         manager->pool_to_use.default_for_type[type] = channel_manager_ce_pool(manager, ce);
+
+        if (!channel_type_supports_striping(type))
+            continue;
+
+        for_each_set_bit(ce, usable_ces[type], UVM_COPY_ENGINE_COUNT_MAX) {
+            unsigned num_pools = manager->pool_to_use.striping[type].num_pools++;
+
+            manager->pool_to_use.striping[type].pools[num_pools] = channel_manager_ce_pool(manager, ce);
+        }
     }
 
     // In SR-IOV heavy, add an additional, single-channel, pool that is
@@ -1151,6 +1382,11 @@ NV_STATUS uvm_channel_manager_create_common(uvm_gpu_t *gpu, bool with_procfs, uv
 
     channel_manager->gpu = gpu;
     init_channel_manager_conf(channel_manager);
+
+    init_waitqueue_head(&channel_manager->completion_wait.queue);
+
+    // Start with the largest spin window until waits have been observed
+    atomic64_set(&channel_manager->completion_wait.avg_wait_ns, channel_manager->conf.wait_spin_max_ns / 2);
     status = uvm_pushbuffer_create_common(channel_manager, with_procfs, &channel_manager->pushbuffer);
     if (status != NV_OK)
         goto error;
@@ -1232,6 +1468,11 @@ static void uvm_channel_print_info(uvm_channel_t *channel, struct seq_file *s)
     UVM_SEQ_OR_DBG_PRINT(s, "GPPUT location     %s\n", buffer_location_to_string(manager->conf.gpput_loc));
     UVM_SEQ_OR_DBG_PRINT(s, "get                %u\n", channel->gpu_get);
     UVM_SEQ_OR_DBG_PRINT(s, "put                %u\n", channel->cpu_put);
+    UVM_SEQ_OR_DBG_PRINT(s, "CE backlog         %d\n", atomic_read(&channel->pool->backlog));
+    UVM_SEQ_OR_DBG_PRINT(s, "CE striping        %s\n", manager->conf.ce_striping ? "enabled" : "disabled");
+    UVM_SEQ_OR_DBG_PRINT(s, "reserve stalls     %lld\n", atomic64_read(&channel->pool->stats.reserve_stalls));
+    UVM_SEQ_OR_DBG_PRINT(s, "reserve stall time %lld us\n",
+                         atomic64_read(&channel->pool->stats.reserve_stall_time_ns) / 1000);
     UVM_SEQ_OR_DBG_PRINT(s, "Semaphore GPU VA   0x%llx\n", uvm_channel_tracking_semaphore_get_gpu_va(channel));
 
     uvm_spin_unlock(&channel->pool->lock);
@@ -109,6 +109,19 @@ typedef struct
 
     // Lock protecting the state of channels in the pool
     uvm_spinlock_t lock;
+
+    // Number of pushes in the pool that have reserved a GPFIFO entry and have
+    // not been completed yet. Used to balance the load across CEs when
+    // striping is enabled, so it can be read without holding the pool lock.
+    atomic_t backlog;
+
+    // Reservations in the pool that had to wait for a GPFIFO entry to free
+    // up, and the total time spent waiting
+    struct
+    {
+        atomic64_t reserve_stalls;
+        atomic64_t reserve_stall_time_ns;
+    } stats;
 } uvm_channel_pool_t;
 
 struct uvm_channel_struct
@@ -218,6 +231,22 @@ struct uvm_channel_manager_struct
         // If there is no optimal pool (the entry is NULL), use default pool
         // default_for_type[UVM_CHANNEL_GPU_TO_GPU] instead.
         uvm_channel_pool_t *gpu_to_gpu[UVM_ID_MAX_GPUS];
+
+        // Peers whose pushes can be striped across the GPU_TO_GPU pools in
+        // striping[], which only contain the CEs that write over NVLink. Set
+        // for peers that are reachable over the aggregate bandwidth of all the
+        // NVLinks, see uvm_channel_manager_set_p2p_ce.
+        DECLARE_BITMAP(gpu_to_gpu_striping, UVM_ID_MAX_GPUS);
+
+        // Pools that pushes of each channel type can be striped across, see
+        // uvm_channel_ce_striping. Always includes default_for_type[type],
+        // except for GPU_TO_GPU, which only includes the NVLink P2P CEs.
+        // Only populated for the copy types, num_pools is 0 otherwise.
+        struct
+        {
+            uvm_channel_pool_t *pools[UVM_COPY_ENGINE_COUNT_MAX];
+            unsigned num_pools;
+        } striping[UVM_CHANNEL_TYPE_COUNT];
     } pool_to_use;
 
     struct
@@ -232,7 +261,23 @@ struct uvm_channel_manager_struct
         UVM_BUFFER_LOCATION gpfifo_loc;
         UVM_BUFFER_LOCATION gpput_loc;
         UVM_BUFFER_LOCATION pushbuffer_loc;
+        bool ce_striping;
+        NvU64 wait_spin_max_ns;
+        NvU64 wait_sleep_ns;
     } conf;
+
+    // State of the hybrid spin-then-sleep waits, see
+    // uvm_channel_manager_wait_step()
+    struct
+    {
+        // Woken up by uvm_channel_update_progress() whenever GPFIFO entries of
+        // any channel in the manager complete
+        wait_queue_head_t queue;
+
+        // Running average of the duration of blocking waits on the manager,
+        // used to size the spin window
+        atomic64_t avg_wait_ns;
+    } completion_wait;
 };
 
 // Create a channel manager for the GPU
@@ -303,6 +348,25 @@ NvU32 uvm_channel_manager_update_progress(uvm_channel_manager_t *channel_manager
 // beginning.
 NV_STATUS uvm_channel_manager_wait(uvm_channel_manager_t *manager);
 
+// Single iteration of a blocking wait for work submitted to the channel
+// manager, to be used in place of UVM_SPIN_LOOP by wait loops that may sleep.
+//
+// Busy-waits while the wait started by uvm_spin_loop_init() is shorter than the
+// adaptive spin window (twice the recent average wait duration, capped by
+// uvm_channel_wait_spin_max_us). Past the window, and if the caller can sleep,
+// sleeps on the manager's completion wait queue until either
+// uvm_channel_update_progress() completes GPFIFO entries or
+// uvm_channel_wait_sleep_us elapses, whichever comes first. The sleep is
+// bounded because nothing may be updating the channel progress while the
+// caller waits.
+//
+// Returns the same values as UVM_SPIN_LOOP.
+NV_STATUS uvm_channel_manager_wait_step(uvm_channel_manager_t *manager, uvm_spin_loop_t *spin);
+
+// Record the end of a wait that used uvm_channel_manager_wait_step() so that
+// the spin window adapts to how long waits on the manager usually take.
+void uvm_channel_manager_wait_done(uvm_channel_manager_t *manager, const uvm_spin_loop_t *spin);
+
 // Get the GPU VA of semaphore_channel's tracking semaphore within the VA space
 // associated with access_channel.
 //
@@ -339,7 +403,15 @@ NV_STATUS uvm_channel_reserve_gpu_to_gpu(uvm_channel_manager_t *channel_manager,
 NV_STATUS uvm_channel_reserve(uvm_channel_t *channel);
 
 // Set optimal CE for P2P transfers between manager->gpu and peer
-void uvm_channel_manager_set_p2p_ce(uvm_channel_manager_t *manager, uvm_gpu_t *peer, NvU32 optimal_ce);
+//
+// If allow_striping is true and the optimal CE writes over NVLink, pushes to
+// the peer may also use the other NVLink CEs when CE striping is enabled. This
+// should only be allowed if all the NVLinks of manager->gpu lead to the peer,
+// as in NVSwitch systems.
+void uvm_channel_manager_set_p2p_ce(uvm_channel_manager_t *manager,
+                                    uvm_gpu_t *peer,
+                                    NvU32 optimal_ce,
+                                    bool allow_striping);
 
 // Begin a push on a previously reserved channel
 // Should be used by uvm_push_*() only.
@@ -372,6 +444,13 @@ static uvm_channel_t *uvm_channel_any(const uvm_channel_manager_t *manager)
     return manager->channel_pools->channels;
 }
 
+// Number of pushes reserved and not yet completed in the pool used by default
+// for the given channel type. This is a snapshot meant for heuristics only.
+static unsigned uvm_channel_manager_type_backlog(uvm_channel_manager_t *manager, uvm_channel_type_t type)
+{
+    return atomic_read(&manager->pool_to_use.default_for_type[type]->backlog);
+}
+
 // Helper to iterate over all the channels in a pool.
 #define uvm_for_each_channel_in_pool(channel, pool)                            \
     for (({UVM_ASSERT(pool->channels);                                         \
@@ -39,6 +39,13 @@
     #define UVM_IS_DEVELOP() 0
 #endif
 
+// Lock contention statistics, available on any build type. See uvm_lock.h.
+#ifdef NVIDIA_UVM_LOCK_STATS
+    #define UVM_IS_LOCK_STATS() 1
+#else
+    #define UVM_IS_LOCK_STATS() 0
+#endif
+
 #include "uvm_types.h"
 #include "uvm_linux.h"
 
@@ -40,6 +40,8 @@ typedef struct uvm_gpu_tracking_semaphore_struct uvm_gpu_tracking_semaphore_t;
 typedef struct uvm_gpu_semaphore_pool_struct uvm_gpu_semaphore_pool_t;
 typedef struct uvm_gpu_semaphore_pool_page_struct uvm_gpu_semaphore_pool_page_t;
 typedef struct uvm_gpu_peer_struct uvm_gpu_peer_t;
+typedef struct uvm_gpu_migration_stats_struct uvm_gpu_migration_stats_t;
+typedef struct uvm_fault_replay_latency_struct uvm_fault_replay_latency_t;
 typedef struct uvm_mmu_mode_hal_struct uvm_mmu_mode_hal_t;
 
 typedef struct uvm_channel_manager_struct uvm_channel_manager_t;
@@ -48,6 +48,14 @@ MODULE_PARM_DESC(uvm_ats_mode, "Set to 0 to disable ATS (Address Translation Ser
                                "Any other value is ignored. Has no effect unless the "
                                "platform supports ATS.");
 
+// Number of workers killing the VA blocks of a VA space in parallel when it's
+// destroyed. 0 kills them on the destroying thread.
+static unsigned uvm_va_space_teardown_threads = 0;
+module_param(uvm_va_space_teardown_threads, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_va_space_teardown_threads, "Number of threads tearing down the VA blocks "
+                                                "of a VA space on process exit. 0 disables "
+                                                "parallel teardown.");
+
 uvm_global_t g_uvm_global;
 static struct UvmOpsUvmEvents g_exported_uvm_ops;
 static bool g_ops_registered = false;
@@ -80,6 +88,35 @@ static void uvm_unregister_callbacks(void)
     }
 }
 
+static NV_STATUS va_space_teardown_init(void)
+{
+    unsigned i;
+
+    if (uvm_va_space_teardown_threads > UVM_VA_SPACE_TEARDOWN_THREADS_MAX) {
+        pr_info("Invalid value %u for uvm_va_space_teardown_threads. Using %u instead\n",
+                uvm_va_space_teardown_threads,
+                UVM_VA_SPACE_TEARDOWN_THREADS_MAX);
+        uvm_va_space_teardown_threads = UVM_VA_SPACE_TEARDOWN_THREADS_MAX;
+    }
+
+    for (i = 0; i < uvm_va_space_teardown_threads; ++i) {
+        NV_STATUS status = errno_to_nv_status(nv_kthread_q_init(&g_uvm_global.va_space_teardown.qs[i],
+                                                                "UVM VA space teardown"));
+        if (status != NV_OK)
+            return status;
+
+        ++g_uvm_global.va_space_teardown.num_qs;
+    }
+
+    return NV_OK;
+}
+
+static void va_space_teardown_exit(void)
+{
+    while (g_uvm_global.va_space_teardown.num_qs > 0)
+        nv_kthread_q_stop(&g_uvm_global.va_space_teardown.qs[--g_uvm_global.va_space_teardown.num_qs]);
+}
+
 static void ats_init(const UvmPlatformInfo *platform_info)
 {
     g_uvm_global.ats.supported = platform_info->atsSupported;
@@ -124,6 +161,12 @@ NV_STATUS uvm_global_init(void)
         goto error;
     }
 
+    status = va_space_teardown_init();
+    if (status != NV_OK) {
+        UVM_DBG_PRINT("va_space_teardown_init() failed: %s\n", nvstatusToString(status));
+        goto error;
+    }
+
     status = uvm_procfs_init();
     if (status != NV_OK) {
         UVM_ERR_PRINT("uvm_procfs_init() failed: %s\n", nvstatusToString(status));
@@ -244,6 +287,7 @@ void uvm_global_exit(void)
 
     uvm_procfs_exit();
 
+    va_space_teardown_exit();
     nv_kthread_q_stop(&g_uvm_global.deferred_release_q);
     nv_kthread_q_stop(&g_uvm_global.global_q);
 
@@ -379,8 +423,11 @@ static NV_STATUS uvm_resume(void)
         gpu = uvm_gpu_get(gpu_id);
 
         // Bring the fault buffer software state back in sync with the
-        // hardware state.
-        uvm_gpu_fault_buffer_resume(gpu->parent);
+        // hardware state. The software state is preserved across the sleep
+        // cycle, so only the cached get/put pointers and the prefetch
+        // configuration need to be refreshed.
+        if (gpu->parent->replayable_faults_supported)
+            uvm_gpu_fault_buffer_resume(gpu->parent);
 
         uvm_gpu_set_isr_suspended(gpu, false);
 
@@ -476,3 +523,16 @@ NV_STATUS uvm_global_mask_check_ecc_error(uvm_global_processor_mask_t *gpus)
 
     return NV_OK;
 }
+
+NV_STATUS uvm_global_mask_check_ecc_error_aggregated(uvm_global_processor_mask_t *gpus)
+{
+    uvm_gpu_t *gpu;
+
+    for_each_global_gpu_in_mask(gpu, gpus) {
+        NV_STATUS status = uvm_gpu_check_ecc_error_aggregated(gpu);
+        if (status != NV_OK)
+            return status;
+    }
+
+    return NV_OK;
+}
@@ -33,6 +33,10 @@
 #include "uvm_lock.h"
 #include "uvm_ats_ibm.h"
 
+// Maximum number of workers killing VA blocks in parallel during VA space
+// teardown, see uvm_va_space_teardown_threads
+#define UVM_VA_SPACE_TEARDOWN_THREADS_MAX 16
+
 
 
 
@@ -66,7 +70,8 @@ struct uvm_global_struct
 
     // peer-to-peer copy mode
     // Pascal+ GPUs support virtual addresses in p2p copies.
-    // Ampere+ GPUs add support for physical addresses in p2p copies.
+    // Ampere+ GPUs add support for physical addresses in p2p copies, and can
+    // select the mode per peer pair with UVM_GPU_PEER_COPY_MODE_AUTO.
     uvm_gpu_peer_copy_mode_t peer_copy_mode;
 
     // Stores an NV_STATUS, once it becomes != NV_OK, the driver should refuse to
@@ -111,6 +116,16 @@ struct uvm_global_struct
     // the queue and preventing any other items from running.
     nv_kthread_q_t deferred_release_q;
 
+    // Queues of the workers killing VA blocks in parallel during VA space
+    // teardown, see uvm_va_space_destroy(). Only the first num_qs queues are
+    // initialized, none if parallel teardown is disabled.
+    struct
+    {
+        nv_kthread_q_t qs[UVM_VA_SPACE_TEARDOWN_THREADS_MAX];
+
+        unsigned num_qs;
+    } va_space_teardown;
+
     struct
     {
         // Indicates whether the system HW supports ATS. This field is set once
@@ -319,6 +334,10 @@ void uvm_global_mask_release(const uvm_global_processor_mask_t *mask);
 // Notably this check cannot be performed where it's not safe to call into RM.
 NV_STATUS uvm_global_mask_check_ecc_error(uvm_global_processor_mask_t *gpus);
 
+// Check for ECC errors for all GPUs in a mask with
+// uvm_gpu_check_ecc_error_aggregated()
+NV_STATUS uvm_global_mask_check_ecc_error_aggregated(uvm_global_processor_mask_t *gpus);
+
 // Pre-allocate fault service contexts.
 NV_STATUS uvm_service_block_context_init(void);
 
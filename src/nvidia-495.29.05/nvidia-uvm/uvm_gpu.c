@@ -28,6 +28,7 @@
 #include "uvm_gpu.h"
 #include "uvm_gpu_semaphore.h"
 #include "uvm_hal.h"
+#include "uvm_mem.h"
 #include "uvm_procfs.h"
 #include "uvm_pmm_gpu.h"
 #include "uvm_pmm_sysmem.h"
@@ -44,16 +45,36 @@
 
 #define UVM_PROC_GPUS_PEER_DIR_NAME "peers"
 
-// The uvm_peer_copy module parameter enables to choose from "phys" or "virt".
-// It determines the addressing mode for P2P copies.
+// The uvm_peer_copy module parameter enables to choose from "phys", "virt" or
+// "auto". It determines the addressing mode for P2P copies. "auto" selects the
+// fastest mode for each pair of peers when peer access is enabled.
 #define UVM_PARAM_PEER_COPY_VIRTUAL "virt"
 #define UVM_PARAM_PEER_COPY_PHYSICAL "phys"
+#define UVM_PARAM_PEER_COPY_AUTO "auto"
 static char *uvm_peer_copy = UVM_PARAM_PEER_COPY_PHYSICAL;
 module_param(uvm_peer_copy, charp, S_IRUGO);
 MODULE_PARM_DESC(uvm_peer_copy, "Choose the addressing mode for peer copying, options: "
-                                UVM_PARAM_PEER_COPY_PHYSICAL " [default] or " UVM_PARAM_PEER_COPY_VIRTUAL ". "
+                                UVM_PARAM_PEER_COPY_PHYSICAL " [default], " UVM_PARAM_PEER_COPY_VIRTUAL " or "
+                                UVM_PARAM_PEER_COPY_AUTO " (selected per peer pair). "
                                 "Valid for Ampere+ GPUs.");
 
+// Minimum time between two polls of a GPU's hw interrupt tree for ECC errors
+// on the CPU fault path, in microseconds. 0 polls on every fault.
+static unsigned uvm_perf_ecc_check_window_us = 0;
+module_param(uvm_perf_ecc_check_window_us, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_perf_ecc_check_window_us,
+                 "Minimum time in microseconds between polls for pending ECC interrupts on "
+                 "the CPU fault path. 0 [default] polls on every fault.");
+
+// Number of rounds of calibration copies run in each mode to select the peer
+// copy mode of a pair with uvm_peer_copy=auto. The copies of both modes are
+// interleaved so they see the same link conditions.
+#define UVM_PEER_COPY_CALIBRATION_ROUNDS 4
+
+// Size of each calibration copy, large enough for the copy to be dominated by
+// the link and address translation rather than by the push overhead.
+#define UVM_PEER_COPY_CALIBRATION_SIZE UVM_CHUNK_SIZE_2M
+
 static void remove_gpu(uvm_gpu_t *gpu);
 static void disable_peer_access(uvm_gpu_t *gpu0, uvm_gpu_t *gpu1);
 static NV_STATUS discover_nvlink_peers(uvm_gpu_t *gpu);
@@ -310,6 +331,91 @@ static const char *uvm_gpu_link_type_string(uvm_gpu_link_type_t link_type)
     }
 }
 
+static const char *uvm_gpu_peer_copy_mode_string(uvm_gpu_peer_copy_mode_t copy_mode)
+{
+    BUILD_BUG_ON(UVM_GPU_PEER_COPY_MODE_COUNT != 4);
+
+    switch (copy_mode) {
+        UVM_ENUM_STRING_CASE(UVM_GPU_PEER_COPY_MODE_UNSUPPORTED);
+        UVM_ENUM_STRING_CASE(UVM_GPU_PEER_COPY_MODE_VIRTUAL);
+        UVM_ENUM_STRING_CASE(UVM_GPU_PEER_COPY_MODE_PHYSICAL);
+        UVM_ENUM_STRING_CASE(UVM_GPU_PEER_COPY_MODE_AUTO);
+        UVM_ENUM_STRING_DEFAULT();
+    }
+}
+
+// Print the current decisions of the adaptive fault batch controller, and the
+// averages they are based on. The fields are updated by the replayable faults
+// bottom half without synchronization, so the values may be slightly stale.
+static void gpu_info_print_kthread_q_stats(struct seq_file *s, const char *name, nv_kthread_q_t *q)
+{
+    nv_kthread_q_stats_t stats;
+
+    nv_kthread_q_get_stats(q, &stats);
+
+    UVM_SEQ_OR_DBG_PRINT(s, "%s\n", name);
+    UVM_SEQ_OR_DBG_PRINT(s, "    items_run                          %llu\n", stats.items_run);
+    UVM_SEQ_OR_DBG_PRINT(s, "    wakeups                            %llu\n", stats.wakeups);
+    UVM_SEQ_OR_DBG_PRINT(s, "    mean_latency_ns                    %llu\n",
+                         stats.items_run? stats.total_latency_ns / stats.items_run : 0);
+    UVM_SEQ_OR_DBG_PRINT(s, "    max_latency_ns                     %llu\n", stats.max_latency_ns);
+}
+
+static void gpu_info_print_adaptive_batching(uvm_parent_gpu_t *parent_gpu, struct seq_file *s)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_adaptive_batch_range [%u:%u]\n",
+                         replayable_faults->adaptive.min_batch_size,
+                         replayable_faults->adaptive.max_batch_size);
+    UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_adaptive_occupancy   %u%%\n",
+                         replayable_faults->adaptive.avg_occupancy >> UVM_PERF_FAULT_BATCH_ADAPTIVE_AVG_SHIFT);
+    UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_adaptive_duplicates  %u%%\n",
+                         replayable_faults->adaptive.avg_duplicate_ratio >> UVM_PERF_FAULT_BATCH_ADAPTIVE_AVG_SHIFT);
+    UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_adaptive_service_us  %llu\n",
+                         replayable_faults->adaptive.avg_service_time_ns / 1000);
+    UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_adaptive_grows       %llu\n",
+                         replayable_faults->adaptive.num_grows);
+    UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_adaptive_shrinks     %llu\n",
+                         replayable_faults->adaptive.num_shrinks);
+    UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_adaptive_policy_sw   %llu\n",
+                         replayable_faults->adaptive.num_replay_policy_changes);
+}
+
+static void gpu_info_print_numa_node(struct seq_file *s, const char *name, void *p)
+{
+    if (!ZERO_OR_NULL_PTR(p))
+        UVM_SEQ_OR_DBG_PRINT(s, "numa_node %-28s %d\n", name, uvm_kvnode(p));
+}
+
+// Print the NUMA nodes the per-GPU hot structures were allocated on
+static void gpu_info_print_numa_placement(uvm_gpu_t *gpu, struct seq_file *s)
+{
+    uvm_parent_gpu_t *parent_gpu = gpu->parent;
+
+    gpu_info_print_numa_node(s, "parent_gpu", parent_gpu);
+
+    if (parent_gpu->replayable_faults_supported) {
+        uvm_fault_service_batch_context_t *batch_context =
+            &parent_gpu->fault_buffer_info.replayable.batch_service_context;
+
+        gpu_info_print_numa_node(s, "replayable_fault_cache", batch_context->fault_cache);
+        gpu_info_print_numa_node(s, "replayable_ordered_cache", batch_context->ordered_fault_cache);
+    }
+
+    if (parent_gpu->non_replayable_faults_supported) {
+        gpu_info_print_numa_node(s,
+                                 "non_replayable_fault_cache",
+                                 parent_gpu->fault_buffer_info.non_replayable.fault_cache);
+    }
+
+    if (parent_gpu->access_counters_supported) {
+        gpu_info_print_numa_node(s,
+                                 "access_counter_cache",
+                                 parent_gpu->access_counter_buffer_info.batch_service_context.notification_cache);
+    }
+}
+
 static void gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
 {
     const UvmGpuInfo *gpu_info = &gpu->parent->rm_info;
@@ -328,6 +434,8 @@ static void gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
     else
         UVM_SEQ_OR_DBG_PRINT(s, "closest_cpu_numa_node                  %d\n", gpu->parent->closest_cpu_numa_node);
 
+    gpu_info_print_numa_placement(gpu, s);
+
     if (!uvm_procfs_is_debug_enabled())
         return;
 
@@ -356,6 +464,12 @@ static void gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
                          gpu->mem_info.max_allocatable_address,
                          gpu->mem_info.max_allocatable_address / (1024 * 1024));
 
+    if (uvm_gpu_supports_eviction(gpu))
+        uvm_pmm_gpu_print_eviction_stats(&gpu->pmm, s);
+
+    uvm_pmm_gpu_print_magazine_stats(&gpu->pmm, s);
+    uvm_pmm_gpu_print_page_table_reserve_stats(&gpu->pmm, s);
+
     if (numa_info->enabled) {
         NvU64 window_size = numa_info->system_memory_window_end - numa_info->system_memory_window_start + 1;
         UVM_SEQ_OR_DBG_PRINT(s, "numa_node_id                           %u\n", numa_info->node_id);
@@ -373,6 +487,12 @@ static void gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
 
     UVM_SEQ_OR_DBG_PRINT(s, "interrupts                             %llu\n", gpu->parent->isr.interrupt_count);
 
+    if (gpu->parent->isr.bottom_half_q.flags & NV_KTHREAD_Q_FLAGS_STATS)
+        gpu_info_print_kthread_q_stats(s, "bottom_half_q", &gpu->parent->isr.bottom_half_q);
+
+    if (gpu->parent->isr.kill_channel_q.flags & NV_KTHREAD_Q_FLAGS_STATS)
+        gpu_info_print_kthread_q_stats(s, "kill_channel_q", &gpu->parent->isr.kill_channel_q);
+
     if (gpu->parent->isr.replayable_faults.handling) {
         UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_bh                   %llu\n",
                              gpu->parent->isr.replayable_faults.stats.bottom_half_count);
@@ -396,6 +516,16 @@ static void gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
                              gpu->parent->fault_buffer_info.max_batch_size);
         UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_replay_policy        %s\n",
                              uvm_perf_fault_replay_policy_string(gpu->parent->fault_buffer_info.replayable.replay_policy));
+        UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_adaptive_batching    %s\n",
+                             gpu->parent->fault_buffer_info.replayable.adaptive.enabled? "on" : "off");
+        if (gpu->parent->fault_buffer_info.replayable.adaptive.enabled)
+            gpu_info_print_adaptive_batching(gpu->parent, s);
+        if (gpu->parent->fault_buffer_info.replayable.service_workers.num_workers > 0) {
+            UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_service_workers      %u\n",
+                                 gpu->parent->fault_buffer_info.replayable.service_workers.num_workers);
+            UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_deferred_blocks      %llu\n",
+                                 (NvU64)atomic64_read(&gpu->parent->fault_buffer_info.replayable.service_workers.num_deferred_groups));
+        }
         UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults_num_faults           %llu\n",
                              gpu->parent->stats.num_replayable_faults);
     }
@@ -465,6 +595,8 @@ gpu_fault_stats_print_common(uvm_parent_gpu_t *parent_gpu, struct seq_file *s)
     UVM_SEQ_OR_DBG_PRINT(s, "replayable_faults      %llu\n", parent_gpu->stats.num_replayable_faults);
     UVM_SEQ_OR_DBG_PRINT(s, "duplicates             %llu\n",
                          parent_gpu->fault_buffer_info.replayable.stats.num_duplicate_faults);
+    UVM_SEQ_OR_DBG_PRINT(s, "deferred               %llu\n",
+                         parent_gpu->fault_buffer_info.replayable.stats.num_deferred_faults);
     UVM_SEQ_OR_DBG_PRINT(s, "faults_by_access_type:\n");
     UVM_SEQ_OR_DBG_PRINT(s, "  prefetch             %llu\n",
                          parent_gpu->fault_buffer_info.replayable.stats.num_prefetch_faults);
@@ -509,6 +641,91 @@ gpu_fault_stats_print_common(uvm_parent_gpu_t *parent_gpu, struct seq_file *s)
                          (num_pages_out * (NvU64)PAGE_SIZE) / (1024u * 1024u));
 }
 
+// Upper bound in ns of the bucket that contains the given percentile
+static NvU64 stage_latency_percentile(const NvU64 *buckets, NvU64 count, NvU32 percentile)
+{
+    NvU64 threshold = DIV_ROUND_UP(count * percentile, 100);
+    NvU64 sum = 0;
+    NvU32 i;
+
+    for (i = 0; i < UVM_FAULT_SERVICE_LATENCY_BUCKETS - 1; i++) {
+        sum += buckets[i];
+        if (sum >= threshold)
+            break;
+    }
+
+    return 1ULL << (i + 1);
+}
+
+static void gpu_fault_service_latency_print_common(uvm_parent_gpu_t *parent_gpu, struct seq_file *s)
+{
+    static const char *stage_names[UVM_FAULT_SERVICE_STAGE_COUNT] = {
+        [UVM_FAULT_SERVICE_STAGE_FETCH]     = "fetch",
+        [UVM_FAULT_SERVICE_STAGE_SORT]      = "sort",
+        [UVM_FAULT_SERVICE_STAGE_TRANSLATE] = "translate",
+        [UVM_FAULT_SERVICE_STAGE_SERVICE]   = "service",
+        [UVM_FAULT_SERVICE_STAGE_REPLAY]    = "replay",
+    };
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+    uvm_fault_replay_latency_t *replay_latency = &replayable_faults->replay_latency;
+    NvU64 total_ns = 0;
+    NvU32 stage;
+
+    UVM_ASSERT(uvm_procfs_is_debug_enabled());
+
+    for (stage = 0; stage < UVM_FAULT_SERVICE_STAGE_COUNT; stage++)
+        total_ns += replayable_faults->stage_latency.total_ns[stage];
+
+    // Percentiles are reported as the upper bound of their power of two bucket
+    UVM_SEQ_OR_DBG_PRINT(s, "%-10s %12s %14s %4s %10s %10s %10s %12s\n",
+                         "stage", "batches", "total_us", "%", "p50_ns", "p90_ns", "p99_ns", "max_ns");
+
+    for (stage = 0; stage < UVM_FAULT_SERVICE_STAGE_COUNT; stage++) {
+        const NvU64 *buckets = replayable_faults->stage_latency.buckets[stage];
+        NvU64 stage_ns = replayable_faults->stage_latency.total_ns[stage];
+        NvU64 count = 0;
+        NvU32 i;
+
+        for (i = 0; i < UVM_FAULT_SERVICE_LATENCY_BUCKETS; i++)
+            count += buckets[i];
+
+        if (count == 0) {
+            UVM_SEQ_OR_DBG_PRINT(s, "%-10s %12u\n", stage_names[stage], 0);
+            continue;
+        }
+
+        UVM_SEQ_OR_DBG_PRINT(s, "%-10s %12llu %14llu %4llu %10llu %10llu %10llu %12llu\n",
+                             stage_names[stage],
+                             count,
+                             stage_ns / 1000,
+                             total_ns ? stage_ns * 100 / total_ns : 0,
+                             stage_latency_percentile(buckets, count, 50),
+                             stage_latency_percentile(buckets, count, 90),
+                             stage_latency_percentile(buckets, count, 99),
+                             replayable_faults->stage_latency.max_ns[stage]);
+    }
+
+    // Time from the GPU timestamp of each fault to the replay that followed
+    // its servicing, over the sampled replays
+    UVM_SEQ_OR_DBG_PRINT(s, "\n%-10s %12s %14s %4s %10s %10s %10s %12s\n",
+                         "latency", "faults", "avg_ns", "", "p50_ns", "p90_ns", "p99_ns", "max_ns");
+
+    if (replay_latency->count == 0) {
+        UVM_SEQ_OR_DBG_PRINT(s, "%-10s %12u\n", "replay", 0);
+        return;
+    }
+
+    UVM_SEQ_OR_DBG_PRINT(s, "%-10s %12llu %14llu %4s %10llu %10llu %10llu %12llu\n",
+                         "replay",
+                         replay_latency->count,
+                         replay_latency->total_ns / replay_latency->count,
+                         "",
+                         stage_latency_percentile(replay_latency->buckets, replay_latency->count, 50),
+                         stage_latency_percentile(replay_latency->buckets, replay_latency->count, 90),
+                         stage_latency_percentile(replay_latency->buckets, replay_latency->count, 99),
+                         replay_latency->max_ns);
+}
+
 static void gpu_access_counters_print_common(uvm_parent_gpu_t *parent_gpu, struct seq_file *s)
 {
     NvU64 num_pages_in;
@@ -523,6 +740,21 @@ static void gpu_access_counters_print_common(uvm_parent_gpu_t *parent_gpu, struc
                          (num_pages_in * (NvU64)PAGE_SIZE) / (1024u * 1024u));
     UVM_SEQ_OR_DBG_PRINT(s, "  num_pages_out        %llu (%llu MB)\n", num_pages_out,
                          (num_pages_out * (NvU64)PAGE_SIZE) / (1024u * 1024u));
+
+    if (!parent_gpu->access_counter_buffer_info.pipeline.regions)
+        return;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "pipeline:\n");
+    UVM_SEQ_OR_DBG_PRINT(s, "  pending_regions      %u\n",
+                         UVM_READ_ONCE(parent_gpu->access_counter_buffer_info.pipeline.num_regions));
+    UVM_SEQ_OR_DBG_PRINT(s, "  num_aggregated       %llu\n",
+                         (NvU64)atomic64_read(&parent_gpu->access_counter_buffer_info.pipeline.stats.num_aggregated));
+    UVM_SEQ_OR_DBG_PRINT(s, "  regions_serviced     %llu\n",
+                         (NvU64)atomic64_read(&parent_gpu->access_counter_buffer_info.pipeline.stats.num_regions_serviced));
+    UVM_SEQ_OR_DBG_PRINT(s, "  regions_expanded     %llu\n",
+                         (NvU64)atomic64_read(&parent_gpu->access_counter_buffer_info.pipeline.stats.num_regions_expanded));
+    UVM_SEQ_OR_DBG_PRINT(s, "  sync_fallbacks       %llu\n",
+                         (NvU64)atomic64_read(&parent_gpu->access_counter_buffer_info.pipeline.stats.num_sync_fallbacks));
 }
 
 void uvm_gpu_print(uvm_gpu_t *gpu)
@@ -549,6 +781,10 @@ static void gpu_peer_caps_print(uvm_gpu_t **gpu_pair, struct seq_file *s)
     UVM_SEQ_OR_DBG_PRINT(s, "Bandwidth                      %uMBps\n", peer_caps->total_link_line_rate_mbyte_per_s);
     UVM_SEQ_OR_DBG_PRINT(s, "Aperture                       %s\n", uvm_aperture_string(aperture));
     UVM_SEQ_OR_DBG_PRINT(s, "Connected through NVSWITCH     %s\n", nvswitch_connected ? "True" : "False");
+    if (!peer_caps->is_indirect_peer) {
+        UVM_SEQ_OR_DBG_PRINT(s, "Copy mode                      %s\n",
+                             uvm_gpu_peer_copy_mode_string(uvm_gpu_peer_copy_mode(local, remote)));
+    }
     UVM_SEQ_OR_DBG_PRINT(s, "Refcount                       %llu\n", UVM_READ_ONCE(peer_caps->ref_count));
 }
 
@@ -571,6 +807,62 @@ static int nv_procfs_read_gpu_info_entry(struct seq_file *s, void *v)
     UVM_ENTRY_RET(nv_procfs_read_gpu_info(s, v));
 }
 
+static void gpu_migration_stats_print(uvm_gpu_migration_stats_t *stats, const char *direction, struct seq_file *s)
+{
+    NvU64 bytes = atomic64_read(&stats->bytes);
+    NvU64 copy_ns = atomic64_read(&stats->copy_ns);
+    NvU64 pushes = atomic64_read(&stats->pushes);
+
+    if (pushes == 0)
+        return;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "%s:\n", direction);
+    UVM_SEQ_OR_DBG_PRINT(s, "  bytes                %llu (%llu MB)\n", bytes, bytes / (1024u * 1024u));
+    UVM_SEQ_OR_DBG_PRINT(s, "  copy_time            %llu us\n", copy_ns / 1000);
+    UVM_SEQ_OR_DBG_PRINT(s, "  bandwidth            %llu MBps\n", copy_ns ? (bytes * 1000) / copy_ns : 0);
+    UVM_SEQ_OR_DBG_PRINT(s, "  pushes               %llu\n", pushes);
+    UVM_SEQ_OR_DBG_PRINT(s, "  avg_push_size        %llu\n", bytes / pushes);
+    UVM_SEQ_OR_DBG_PRINT(s, "  evictions            %llu\n", (NvU64)atomic64_read(&stats->evictions));
+}
+
+// Print the migrations accounted on the GPU, see uvm_gpu_t::migration_stats.
+// Peers are identified by their processor id.
+static void gpu_migration_stats_print_common(uvm_gpu_t *gpu, struct seq_file *s)
+{
+    uvm_processor_id_t id;
+    char direction[32];
+
+    gpu_migration_stats_print(&gpu->migration_stats.from_cpu, "from CPU", s);
+
+    for_each_processor_id(id) {
+        if (UVM_ID_IS_CPU(id))
+            snprintf(direction, sizeof(direction), "to CPU");
+        else
+            snprintf(direction, sizeof(direction), "to GPU %u", uvm_id_value(id));
+
+        gpu_migration_stats_print(&gpu->migration_stats.to[uvm_id_value(id)], direction, s);
+    }
+}
+
+static int nv_procfs_read_gpu_migration_stats(struct seq_file *s, void *v)
+{
+    uvm_gpu_t *gpu = (uvm_gpu_t *)s->private;
+
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+            return -EAGAIN;
+
+    gpu_migration_stats_print_common(gpu, s);
+
+    uvm_up_read(&g_uvm_global.pm.lock);
+
+    return 0;
+}
+
+static int nv_procfs_read_gpu_migration_stats_entry(struct seq_file *s, void *v)
+{
+    UVM_ENTRY_RET(nv_procfs_read_gpu_migration_stats(s, v));
+}
+
 static int nv_procfs_read_gpu_fault_stats(struct seq_file *s, void *v)
 {
     uvm_parent_gpu_t *parent_gpu = (uvm_parent_gpu_t *)s->private;
@@ -590,6 +882,25 @@ static int nv_procfs_read_gpu_fault_stats_entry(struct seq_file *s, void *v)
     UVM_ENTRY_RET(nv_procfs_read_gpu_fault_stats(s, v));
 }
 
+static int nv_procfs_read_gpu_fault_service_latency(struct seq_file *s, void *v)
+{
+    uvm_parent_gpu_t *parent_gpu = (uvm_parent_gpu_t *)s->private;
+
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+            return -EAGAIN;
+
+    gpu_fault_service_latency_print_common(parent_gpu, s);
+
+    uvm_up_read(&g_uvm_global.pm.lock);
+
+    return 0;
+}
+
+static int nv_procfs_read_gpu_fault_service_latency_entry(struct seq_file *s, void *v)
+{
+    UVM_ENTRY_RET(nv_procfs_read_gpu_fault_service_latency(s, v));
+}
+
 static int nv_procfs_read_gpu_access_counters(struct seq_file *s, void *v)
 {
     uvm_parent_gpu_t *parent_gpu = (uvm_parent_gpu_t *)s->private;
@@ -610,7 +921,9 @@ static int nv_procfs_read_gpu_access_counters_entry(struct seq_file *s, void *v)
 }
 
 UVM_DEFINE_SINGLE_PROCFS_FILE(gpu_info_entry);
+UVM_DEFINE_SINGLE_PROCFS_FILE(gpu_migration_stats_entry);
 UVM_DEFINE_SINGLE_PROCFS_FILE(gpu_fault_stats_entry);
+UVM_DEFINE_SINGLE_PROCFS_FILE(gpu_fault_service_latency_entry);
 UVM_DEFINE_SINGLE_PROCFS_FILE(gpu_access_counters_entry);
 
 static NV_STATUS init_parent_procfs_dir(uvm_parent_gpu_t *parent_gpu)
@@ -654,6 +967,13 @@ static NV_STATUS init_parent_procfs_files(uvm_parent_gpu_t *parent_gpu)
     if (parent_gpu->procfs.fault_stats_file == NULL)
         return NV_ERR_OPERATING_SYSTEM;
 
+    parent_gpu->procfs.fault_service_latency_file = NV_CREATE_PROC_FILE("fault_service_latency",
+                                                                        parent_gpu->procfs.dir,
+                                                                        gpu_fault_service_latency_entry,
+                                                                        parent_gpu);
+    if (parent_gpu->procfs.fault_service_latency_file == NULL)
+        return NV_ERR_OPERATING_SYSTEM;
+
     parent_gpu->procfs.access_counters_file = NV_CREATE_PROC_FILE("access_counters",
                                                                   parent_gpu->procfs.dir,
                                                                   gpu_access_counters_entry,
@@ -667,6 +987,7 @@ static NV_STATUS init_parent_procfs_files(uvm_parent_gpu_t *parent_gpu)
 static void deinit_parent_procfs_files(uvm_parent_gpu_t *parent_gpu)
 {
     uvm_procfs_destroy_entry(parent_gpu->procfs.access_counters_file);
+    uvm_procfs_destroy_entry(parent_gpu->procfs.fault_service_latency_file);
     uvm_procfs_destroy_entry(parent_gpu->procfs.fault_stats_file);
 }
 
@@ -724,11 +1045,19 @@ static NV_STATUS init_procfs_files(uvm_gpu_t *gpu)
     if (gpu->procfs.info_file == NULL)
         return NV_ERR_OPERATING_SYSTEM;
 
+    gpu->procfs.migration_stats_file = NV_CREATE_PROC_FILE("migration_stats",
+                                                           gpu->procfs.dir,
+                                                           gpu_migration_stats_entry,
+                                                           gpu);
+    if (gpu->procfs.migration_stats_file == NULL)
+        return NV_ERR_OPERATING_SYSTEM;
+
     return NV_OK;
 }
 
 static void deinit_procfs_files(uvm_gpu_t *gpu)
 {
+    uvm_procfs_destroy_entry(gpu->procfs.migration_stats_file);
     uvm_procfs_destroy_entry(gpu->procfs.info_file);
 }
 
@@ -818,13 +1147,17 @@ static NV_STATUS find_unused_global_gpu_id(uvm_gpu_id_t gpu_id, uvm_global_gpu_i
 
 // Allocates a uvm_parent_gpu_t, assigns the GPU ID, and sets up basic data
 // structures, but leaves all other initialization up to the caller.
+//
+// The structure, which also embeds the uvm_gpu_t of all the sub-processors and
+// the fault service contexts, is allocated on the NUMA node closest to the GPU.
 static NV_STATUS alloc_parent_gpu(const NvProcessorUuid *gpu_uuid,
                                   uvm_gpu_id_t gpu_id,
+                                  int node,
                                   uvm_parent_gpu_t **parent_gpu_out)
 {
     uvm_parent_gpu_t *parent_gpu;
 
-    parent_gpu = uvm_kvmalloc_zero(sizeof(*parent_gpu));
+    parent_gpu = uvm_kvmalloc_zero_node(sizeof(*parent_gpu), node);
     if (!parent_gpu)
         return NV_ERR_NO_MEMORY;
 
@@ -956,6 +1289,36 @@ NV_STATUS uvm_gpu_check_ecc_error(uvm_gpu_t *gpu)
     return NV_OK;
 }
 
+NV_STATUS uvm_gpu_check_ecc_error_aggregated(uvm_gpu_t *gpu)
+{
+    NV_STATUS status;
+    NvU64 now;
+
+    if (!gpu->ecc.enabled || uvm_perf_ecc_check_window_us == 0)
+        return uvm_gpu_check_ecc_error(gpu);
+
+    if (uvm_global_get_status() == NV_ERR_ECC_ERROR)
+        return NV_ERR_ECC_ERROR;
+
+    // RM sets the notifier when it services an ECC interrupt, and reading it
+    // doesn't touch the GPU.
+    if (*gpu->ecc.error_notifier) {
+        UVM_ERR_PRINT("ECC error encountered, GPU %s\n", uvm_gpu_name(gpu));
+        uvm_global_set_fatal_error(NV_ERR_ECC_ERROR);
+        return NV_ERR_ECC_ERROR;
+    }
+
+    now = NV_GETTIME();
+    if (now - atomic64_read(&gpu->ecc.last_clean_check) < uvm_perf_ecc_check_window_us * 1000ULL)
+        return NV_OK;
+
+    status = uvm_gpu_check_ecc_error(gpu);
+    if (status == NV_OK)
+        atomic64_set(&gpu->ecc.last_clean_check, now);
+
+    return status;
+}
+
 static NV_STATUS init_parent_gpu(uvm_parent_gpu_t *parent_gpu,
                                  const NvProcessorUuid *gpu_uuid,
                                  const UvmGpuInfo *gpu_info,
@@ -1172,7 +1535,10 @@ static NV_STATUS add_gpu(const NvProcessorUuid *gpu_uuid,
     uvm_assert_mutex_locked(&g_uvm_global.global_lock);
 
     if (alloc_parent) {
-        status = alloc_parent_gpu(gpu_uuid, uvm_gpu_id_from_global_gpu_id(global_gpu_id), &parent_gpu);
+        status = alloc_parent_gpu(gpu_uuid,
+                                  uvm_gpu_id_from_global_gpu_id(global_gpu_id),
+                                  dev_to_node(&gpu_platform_info->pci_dev->dev),
+                                  &parent_gpu);
         if (status != NV_OK)
             return status;
     }
@@ -1372,6 +1738,10 @@ static void deinit_gpu(uvm_gpu_t *gpu)
 
     deinit_procfs_files(gpu);
 
+    // The PMM background threads push work, stop them before the channels go
+    // away.
+    uvm_pmm_gpu_stop_background_threads(&gpu->pmm);
+
     // Wait for any deferred frees and their associated trackers to be finished
     // before tearing down channels.
     uvm_pmm_gpu_sync(&gpu->pmm);
@@ -1622,11 +1992,14 @@ static void update_stats_migration_cb(uvm_perf_event_t event_id, uvm_perf_event_
 // Override the UVM driver and GPU settings from the module loader
 static void uvm_param_conf(void)
 {
-    // uvm_peer_copy: Valid entries are "phys" and "virt" for Ampere+ GPUs.
-    // No effect in pre-Ampere GPUs
+    // uvm_peer_copy: Valid entries are "phys", "virt" and "auto" for Ampere+
+    // GPUs. No effect in pre-Ampere GPUs
     if (strcmp(uvm_peer_copy, UVM_PARAM_PEER_COPY_VIRTUAL) == 0) {
         g_uvm_global.peer_copy_mode = UVM_GPU_PEER_COPY_MODE_VIRTUAL;
     }
+    else if (strcmp(uvm_peer_copy, UVM_PARAM_PEER_COPY_AUTO) == 0) {
+        g_uvm_global.peer_copy_mode = UVM_GPU_PEER_COPY_MODE_AUTO;
+    }
     else {
         if (strcmp(uvm_peer_copy, UVM_PARAM_PEER_COPY_PHYSICAL) != 0) {
             pr_info("Invalid value for uvm_peer_copy = %s, using %s instead.\n",
@@ -2046,6 +2419,7 @@ static void set_optimal_p2p_write_ces(const UvmGpuP2PCapsParams *p2p_caps_params
                                       uvm_gpu_t *gpu1)
 {
     bool sorted;
+    bool allow_striping;
     NvU32 ce0, ce1;
 
     if (peer_caps->link_type < UVM_GPU_LINK_NVLINK_1)
@@ -2067,8 +2441,13 @@ static void set_optimal_p2p_write_ces(const UvmGpuP2PCapsParams *p2p_caps_params
         UVM_ASSERT(ce1 == pool->ce_index);
     }
 
-    uvm_channel_manager_set_p2p_ce(gpu0->channel_manager, gpu1, ce0);
-    uvm_channel_manager_set_p2p_ce(gpu1->channel_manager, gpu0, ce1);
+    // With NVSwitch every NVLink of a GPU leads to every peer, so the copies
+    // can be spread across all the NVLink CEs. In direct connect topologies
+    // the optimal CE is tied to the links connecting the pair.
+    allow_striping = !peer_caps->is_indirect_peer && uvm_gpus_are_nvswitch_connected(gpu0, gpu1);
+
+    uvm_channel_manager_set_p2p_ce(gpu0->channel_manager, gpu1, ce0, allow_striping);
+    uvm_channel_manager_set_p2p_ce(gpu1->channel_manager, gpu0, ce1, allow_striping);
 }
 
 static int nv_procfs_read_gpu_peer_caps(struct seq_file *s, void *v)
@@ -2127,6 +2506,109 @@ static NV_STATUS init_procfs_peer_cap_files(uvm_gpu_t *local, uvm_gpu_t *remote,
     return NV_OK;
 }
 
+static size_t peer_caps_index(uvm_gpu_t *local_gpu, uvm_gpu_t *remote_gpu)
+{
+    return uvm_id_value(local_gpu->id) < uvm_id_value(remote_gpu->id) ? 0 : 1;
+}
+
+// Time a copy of peer_mem into local_mem, both of the same size, using the
+// current copy mode of the pair
+static NV_STATUS peer_copy_time(uvm_gpu_t *gpu, uvm_gpu_t *peer, uvm_mem_t *local_mem, uvm_mem_t *peer_mem, NvU64 *time_ns)
+{
+    NV_STATUS status;
+    uvm_push_t push;
+    NvU64 offset;
+    NvU64 start_time;
+    NvU32 copy_size = min(local_mem->chunk_size, peer_mem->chunk_size);
+
+    start_time = NV_GETTIME();
+
+    status = uvm_push_begin_gpu_to_gpu(gpu->channel_manager,
+                                       peer,
+                                       &push,
+                                       "Peer copy calibration %s",
+                                       uvm_gpu_peer_copy_mode_string(uvm_gpu_peer_copy_mode(gpu, peer)));
+    if (status != NV_OK)
+        return status;
+
+    for (offset = 0; offset < local_mem->size; offset += copy_size) {
+        uvm_gpu_address_t dst = uvm_mem_gpu_address_copy(local_mem, gpu, offset, copy_size);
+        uvm_gpu_address_t src = uvm_mem_gpu_address_copy(peer_mem, gpu, offset, copy_size);
+
+        if (offset != 0)
+            uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
+
+        gpu->parent->ce_hal->memcopy(&push, dst, src, copy_size);
+    }
+
+    status = uvm_push_end_and_wait(&push);
+
+    *time_ns = NV_GETTIME() - start_time;
+
+    return status;
+}
+
+// Select the fastest copy mode for gpu to access the memory of peer. Both
+// identity mappings and physical peer addresses are available on GPUs with
+// UVM_GPU_PEER_COPY_MODE_AUTO, so each mode is timed with the same copy.
+static NV_STATUS calibrate_peer_copy_mode(uvm_gpu_t *gpu, uvm_gpu_t *peer)
+{
+    NV_STATUS status;
+    NvU32 round;
+    uvm_mem_t *local_mem = NULL;
+    uvm_mem_t *peer_mem = NULL;
+    NvU64 virtual_time_ns = 0;
+    NvU64 physical_time_ns = 0;
+    uvm_gpu_peer_t *peer_caps = uvm_gpu_peer_caps(gpu, peer);
+    uvm_gpu_peer_copy_mode_t *copy_mode = &peer_caps->copy_modes[peer_caps_index(gpu, peer)];
+
+    UVM_ASSERT(gpu->parent->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_AUTO);
+    UVM_ASSERT(!peer_caps->is_indirect_peer);
+
+    // ZeroFB testing mode, there is nothing to copy
+    if (gpu->mem_info.size == 0 || peer->mem_info.size == 0)
+        return NV_OK;
+
+    status = uvm_mem_alloc_vidmem(UVM_PEER_COPY_CALIBRATION_SIZE, gpu, &local_mem);
+    if (status != NV_OK)
+        goto done;
+
+    status = uvm_mem_alloc_vidmem(UVM_PEER_COPY_CALIBRATION_SIZE, peer, &peer_mem);
+    if (status != NV_OK)
+        goto done;
+
+    for (round = 0; round < UVM_PEER_COPY_CALIBRATION_ROUNDS; ++round) {
+        NvU64 time_ns;
+
+        *copy_mode = UVM_GPU_PEER_COPY_MODE_VIRTUAL;
+        status = peer_copy_time(gpu, peer, local_mem, peer_mem, &time_ns);
+        if (status != NV_OK)
+            goto done;
+
+        virtual_time_ns += time_ns;
+
+        *copy_mode = UVM_GPU_PEER_COPY_MODE_PHYSICAL;
+        status = peer_copy_time(gpu, peer, local_mem, peer_mem, &time_ns);
+        if (status != NV_OK)
+            goto done;
+
+        physical_time_ns += time_ns;
+    }
+
+done:
+    // Physical copies do not depend on the identity mappings, so they are
+    // preferred on ties and if the calibration could not complete
+    if (status == NV_OK && virtual_time_ns < physical_time_ns)
+        *copy_mode = UVM_GPU_PEER_COPY_MODE_VIRTUAL;
+    else
+        *copy_mode = UVM_GPU_PEER_COPY_MODE_PHYSICAL;
+
+    uvm_mem_free(peer_mem);
+    uvm_mem_free(local_mem);
+
+    return status;
+}
+
 static NV_STATUS init_peer_access(uvm_gpu_t *gpu0,
                                   uvm_gpu_t *gpu1,
                                   const UvmGpuP2PCapsParams *p2p_caps_params,
@@ -2149,6 +2631,17 @@ static NV_STATUS init_peer_access(uvm_gpu_t *gpu0,
 
     peer_caps->total_link_line_rate_mbyte_per_s = p2p_caps_params->totalLinkLineRateMBps;
 
+    UVM_ASSERT(gpu0->parent->peer_copy_mode == gpu1->parent->peer_copy_mode);
+    if (gpu0->parent->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_AUTO) {
+        // Selected below for direct peers
+        peer_caps->copy_modes[0] = UVM_GPU_PEER_COPY_MODE_PHYSICAL;
+        peer_caps->copy_modes[1] = UVM_GPU_PEER_COPY_MODE_PHYSICAL;
+    }
+    else {
+        peer_caps->copy_modes[0] = gpu0->parent->peer_copy_mode;
+        peer_caps->copy_modes[1] = gpu0->parent->peer_copy_mode;
+    }
+
     // Initialize peer ids and establish peer mappings
     peer_caps->is_indirect_peer = (p2p_caps_params->indirectAccess == NV_TRUE);
 
@@ -2187,6 +2680,16 @@ static NV_STATUS init_peer_access(uvm_gpu_t *gpu0,
 
         set_optimal_p2p_write_ces(p2p_caps_params, peer_caps, gpu0, gpu1);
 
+        if (gpu0->parent->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_AUTO) {
+            status = calibrate_peer_copy_mode(gpu0, gpu1);
+            if (status != NV_OK)
+                return status;
+
+            status = calibrate_peer_copy_mode(gpu1, gpu0);
+            if (status != NV_OK)
+                return status;
+        }
+
         UVM_ASSERT(uvm_gpu_get(gpu0->global_id) == gpu0);
         UVM_ASSERT(uvm_gpu_get(gpu1->global_id) == gpu1);
 
@@ -2501,19 +3004,23 @@ void uvm_gpu_release_pcie_peer_access(uvm_gpu_t *gpu0, uvm_gpu_t *gpu1)
 
 static uvm_aperture_t uvm_gpu_peer_caps_aperture(uvm_gpu_peer_t *peer_caps, uvm_gpu_t *local_gpu, uvm_gpu_t *remote_gpu)
 {
-    size_t peer_index;
     UVM_ASSERT(peer_caps->link_type != UVM_GPU_LINK_INVALID);
 
     // Indirect peers are accessed as sysmem addresses
     if (peer_caps->is_indirect_peer)
         return UVM_APERTURE_SYS;
 
-    if (uvm_id_value(local_gpu->id) < uvm_id_value(remote_gpu->id))
-        peer_index = 0;
-    else
-        peer_index = 1;
+    return UVM_APERTURE_PEER(peer_caps->peer_ids[peer_caps_index(local_gpu, remote_gpu)]);
+}
+
+uvm_gpu_peer_copy_mode_t uvm_gpu_peer_copy_mode(uvm_gpu_t *local_gpu, uvm_gpu_t *remote_gpu)
+{
+    uvm_gpu_peer_t *peer_caps = uvm_gpu_peer_caps(local_gpu, remote_gpu);
+
+    UVM_ASSERT(peer_caps->link_type != UVM_GPU_LINK_INVALID);
+    UVM_ASSERT(!peer_caps->is_indirect_peer);
 
-    return UVM_APERTURE_PEER(peer_caps->peer_ids[peer_index]);
+    return peer_caps->copy_modes[peer_caps_index(local_gpu, remote_gpu)];
 }
 
 uvm_aperture_t uvm_gpu_peer_aperture(uvm_gpu_t *local_gpu, uvm_gpu_t *remote_gpu)
@@ -2813,7 +3320,7 @@ NV_STATUS uvm_gpu_add_user_channel(uvm_gpu_t *gpu, uvm_user_channel_t *user_chan
     UVM_ASSERT(gpu_va_space);
     UVM_ASSERT(uvm_gpu_va_space_state(gpu_va_space) == UVM_GPU_VA_SPACE_STATE_ACTIVE);
     va_space = gpu_va_space->va_space;
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     status = gpu_add_user_channel_subctx_info(gpu, user_channel);
     if (status != NV_OK)
@@ -2984,7 +3491,7 @@ void uvm_gpu_remove_user_channel(uvm_gpu_t *gpu, uvm_user_channel_t *user_channe
     UVM_ASSERT(gpu_va_space);
     UVM_ASSERT(uvm_gpu_va_space_state(gpu_va_space) == UVM_GPU_VA_SPACE_STATE_ACTIVE);
     va_space = gpu_va_space->va_space;
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     uvm_spin_lock(&gpu->parent->instance_ptr_table_lock);
     gpu_remove_user_channel_subctx_info_locked(gpu, user_channel);
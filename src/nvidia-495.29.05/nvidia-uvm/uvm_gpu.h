@@ -41,6 +41,7 @@
 #include "uvm_gpu_isr.h"
 #include "uvm_hal_types.h"
 #include "uvm_hmm.h"
+#include "uvm_va_space_mm.h"
 #include "uvm_va_block_types.h"
 #include "uvm_perf_module.h"
 #include "uvm_ats_ibm.h"
@@ -114,6 +115,16 @@ struct uvm_service_block_context_struct
     // the result of bitmap_weight(read_duplicate_count_mask)
     unsigned read_duplicate_count;
 
+    // Region beyond the VA block predicted by the prefetcher, which the
+    // caller may migrate to residency once the block lock has been dropped.
+    // Bounds are inclusive. end == 0 means that there is no prediction.
+    struct
+    {
+        NvU64 start;
+        NvU64 end;
+        uvm_processor_id_t residency;
+    } prefetch_ahead;
+
     //
     // Fields used by the CPU fault handling routine
     //
@@ -162,6 +173,16 @@ struct uvm_service_block_context_struct
     uvm_va_block_context_t block_context;
 };
 
+// Slot of the hash set used to coalesce duplicate faults within a batch. The
+// slot is only in use if its generation matches the generation of the batch.
+typedef struct
+{
+    NvU32 generation;
+
+    // Index in fault_cache of the representative fault entry
+    NvU32 fault_index;
+} uvm_fault_coalesce_hash_slot_t;
+
 struct uvm_fault_service_batch_context_struct
 {
     // Array of elements fetched from the GPU fault buffer. The number of
@@ -204,10 +225,83 @@ struct uvm_fault_service_batch_context_struct
     // instance_ptr
     bool is_single_instance_ptr;
 
+    // Set for batches generated by the fault servicing benchmark instead of
+    // fetched from the fault buffer. Their entries already point to their VA
+    // space, so their instance pointers are not translated. See
+    // uvm_test_fault_batch_benchmark.
+    bool is_synthetic;
+
     // Last fetched fault. Used for fault filtering.
     uvm_fault_buffer_entry_t *last_fault;
+
+    // Hash set of the representative fault entries fetched in the batch,
+    // indexed by instance pointer and page address. Used to coalesce
+    // duplicates that are not adjacent in the buffer, see
+    // uvm_perf_fault_coalesce_hash.
+    struct
+    {
+        // Power of two number of slots, twice the size of the fault buffer
+        uvm_fault_coalesce_hash_slot_t *slots;
+
+        NvU32 mask;
+
+        // Incremented on every fetch, so slots from previous batches are
+        // implicitly empty
+        NvU32 generation;
+    } coalesce_hash;
+
+    // State of the radix sorts of ordered_fault_cache, see
+    // uvm_perf_fault_radix_sort. The arrays have the same size as
+    // ordered_fault_cache.
+    struct
+    {
+        // Sort key of each element of ordered_fault_cache
+        NvU64 *keys;
+
+        // Scratch arrays used by the sort passes
+        NvU64 *tmp_keys;
+
+        uvm_fault_buffer_entry_t **tmp_entries;
+    } radix_sort;
 };
 
+// Range of faults in the ordered view of a fault batch that fall within the
+// same VA block, and can be serviced independently from other groups.
+typedef struct
+{
+    uvm_va_block_t *va_block;
+
+    NvU32 first_fault_index;
+
+    NvU32 num_faults;
+} uvm_fault_service_block_group_t;
+
+// State of a kthread used to service VA blocks of a replayable fault batch in
+// parallel with the bottom half. See uvm_perf_fault_service_workers.
+typedef struct
+{
+    nv_kthread_q_t q;
+
+    nv_kthread_q_item_t q_item;
+
+    // Signaled when the worker is done with the groups of the current dispatch
+    struct completion done;
+
+    uvm_parent_gpu_t *parent_gpu;
+
+    // Private view of the batch being serviced. The arrays are shared with
+    // the batch context of the bottom half, but counters, flags and the
+    // tracker are accumulated here and merged back once the dispatch
+    // completes.
+    uvm_fault_service_batch_context_t batch_context;
+
+    // Structure used to coalesce fault servicing in a VA block
+    uvm_service_block_context_t block_service_context;
+
+    // First error found by the worker in the current dispatch
+    NV_STATUS status;
+} uvm_fault_service_worker_t;
+
 struct uvm_ats_fault_invalidate_struct
 {
     // Whether the TLB batch contains any information
@@ -215,6 +309,87 @@ struct uvm_ats_fault_invalidate_struct
 
     // Batch of TLB entries to be invalidated
     uvm_tlb_batch_t write_faults_tlb_batch;
+
+    // Pages made resident by the last ATS service call of the batch, which
+    // can cover several faults, see uvm_ats_service_fault_entry(). Later
+    // faults on them in the same batch don't have to go to the kernel again.
+    // Reset by uvm_ats_fault_batch_begin().
+    struct
+    {
+        // GPU VA space of the pages, NULL if there are none
+        uvm_gpu_va_space_t *gpu_va_space;
+
+        NvU64 start;
+
+        NvU64 end;
+
+        // Whether the pages were made resident for writing
+        bool write;
+    } populated;
+};
+
+// Stages of the servicing of a replayable fault batch, see the
+// fault_service_latency procfs file
+typedef enum
+{
+    // fetch_fault_buffer_entries()
+    UVM_FAULT_SERVICE_STAGE_FETCH,
+
+    // Sorting in preprocess_fault_batch()
+    UVM_FAULT_SERVICE_STAGE_SORT,
+
+    // translate_instance_ptrs()
+    UVM_FAULT_SERVICE_STAGE_TRANSLATE,
+
+    // service_fault_batch()
+    UVM_FAULT_SERVICE_STAGE_SERVICE,
+
+    // Replay after the batch, including the flush and wait with
+    // UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH
+    UVM_FAULT_SERVICE_STAGE_REPLAY,
+
+    UVM_FAULT_SERVICE_STAGE_COUNT
+} uvm_fault_service_stage_t;
+
+// Bucket i of the stage histograms counts the batches that spent
+// [2^i, 2^(i + 1)) ns in the stage
+#define UVM_FAULT_SERVICE_LATENCY_BUCKETS 32
+
+// Histogram of the time warps wait between raising a replayable fault and the
+// replay issued once it has been serviced. The fault time is the timestamp of
+// the fault buffer entry and the replay time is a timestamp released by the
+// replay push right after the replay method, so both come from the GPU timer.
+//
+// Only one replay is sampled at a time, and only when procfs debug is enabled.
+// The bottom half captures the fault timestamps of the batch when pushing the
+// replay, and uvm_gpu_fault_replay_latency_complete() adds them to the
+// histogram when the push completes.
+struct uvm_fault_replay_latency_struct
+{
+    // Set while a sampled replay push is in flight. The sample fields are
+    // owned by the completion of that push while set.
+    bool pending;
+
+    // Batch whose faults were last sampled. Its later replays are not sampled
+    // again. Only accessed by the bottom half.
+    NvU32 sampled_batch_id;
+
+    // Timestamps of the faults replayed by the sampled push
+    NvU64 *fault_timestamps;
+    NvU32 num_faults;
+
+    // Location of the replay timestamp in the pushbuffer
+    NvU64 *replay_timestamp;
+
+    // Histogram of the per-fault latencies, using the same buckets as the
+    // stage histograms. Read without synchronization by procfs.
+    NvU64 count;
+
+    NvU64 total_ns;
+
+    NvU64 max_ns;
+
+    NvU64 buckets[UVM_FAULT_SERVICE_LATENCY_BUCKETS];
 };
 
 typedef struct
@@ -254,6 +429,9 @@ typedef struct
 
         // Fault statistics. These fields are per-GPU and most of them are only
         // updated during fault servicing, and can be safely incremented.
+        // When service workers are enabled, the fault counters can be
+        // incremented concurrently from different VA blocks of the same
+        // batch, so they are only approximate in that case.
         // Migrations may be triggered by different GPUs and need to be
         // incremented using atomics
         struct
@@ -268,6 +446,10 @@ typedef struct
 
             NvU64 num_duplicate_faults;
 
+            // Faults left to later batches because their VA space reached
+            // its per-batch limit
+            NvU64 num_deferred_faults;
+
             atomic64_t num_pages_out;
 
             atomic64_t num_pages_in;
@@ -277,6 +459,20 @@ typedef struct
             NvU64 num_replays_ack_all;
         } stats;
 
+        // Time spent per batch in each servicing stage. Only updated with the
+        // replayable faults ISR lock held, and read without synchronization
+        // by procfs.
+        struct
+        {
+            NvU64 total_ns[UVM_FAULT_SERVICE_STAGE_COUNT];
+
+            NvU64 max_ns[UVM_FAULT_SERVICE_STAGE_COUNT];
+
+            NvU64 buckets[UVM_FAULT_SERVICE_STAGE_COUNT][UVM_FAULT_SERVICE_LATENCY_BUCKETS];
+        } stage_latency;
+
+        uvm_fault_replay_latency_t replay_latency;
+
         // Number of uTLBs in the chip
         NvU32 utlb_count;
 
@@ -286,8 +482,91 @@ typedef struct
         // Structure used to coalesce fault servicing in a VA block
         uvm_service_block_context_t block_service_context;
 
+        // mm retention kept across the batches of a bottom half invocation
+        uvm_va_space_mm_retain_cache_t mm_retain_cache;
+
         // Information required to invalidate stale ATS PTEs from the GPU TLBs
         uvm_ats_fault_invalidate_t ats_invalidate;
+
+        // State of the controller that adapts the batch size and the replay
+        // policy to the observed fault traffic. See
+        // uvm_perf_fault_batch_adaptive. All fields are only accessed with
+        // the replayable faults ISR lock held, except for procfs reads.
+        struct
+        {
+            bool enabled;
+
+            // Whether the controller can switch between
+            // UVM_PERF_FAULT_REPLAY_POLICY_BATCH and
+            // UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH. Other policies are
+            // never changed.
+            bool adapt_replay_policy;
+
+            // Range for max_batch_size
+            NvU32 min_batch_size;
+            NvU32 max_batch_size;
+
+            // Maximum number of fault entries fetched per execution of the
+            // bottom half. This replaces the batch count limit, which depends
+            // on the batch size.
+            NvU32 max_faults_per_service;
+
+            // Moving averages of the fault buffer occupancy and the ratio of
+            // duplicate faults in a batch, in percent
+            NvU32 avg_occupancy;
+            NvU32 avg_duplicate_ratio;
+
+            // Moving average of the time taken to service a batch, including
+            // the replay
+            NvU64 avg_service_time_ns;
+
+            // Number of consecutive batches much smaller than max_batch_size
+            NvU32 num_small_batches;
+
+            NvU64 num_grows;
+            NvU64 num_shrinks;
+            NvU64 num_replay_policy_changes;
+        } adaptive;
+
+        // Pool of kthreads that service the VA blocks of a batch in parallel.
+        // All fields are only accessed with the replayable faults ISR lock
+        // held, except for the atomics which are shared with the workers
+        // during a dispatch.
+        struct
+        {
+            // Number of entries in workers. 0 means that faults are serviced
+            // serially by the bottom half.
+            NvU32 num_workers;
+
+            uvm_fault_service_worker_t *workers;
+
+            // Array of VA block groups collected for the current dispatch. The
+            // number of elements in this array is exactly max_faults, since
+            // the batch size may change at runtime
+            uvm_fault_service_block_group_t *groups;
+
+            NvU32 num_groups;
+
+            // Index of the next group to be serviced
+            atomic_t next_group;
+
+            // Set when any of the participants fails, so that the rest stop
+            // picking up new groups
+            atomic_t abort;
+
+            // Number of groups whose VA block lock was contended when first
+            // picked up, and that were serviced later in the dispatch
+            atomic64_t num_deferred_groups;
+
+            // Servicing state of the current dispatch. The VA space lock and
+            // mmap_lock (if mm is not NULL) are held in read mode by the
+            // bottom half for the whole dispatch.
+            uvm_gpu_t *gpu;
+
+            uvm_va_space_t *va_space;
+
+            struct mm_struct *mm;
+        } service_workers;
     } replayable;
 
     struct uvm_non_replayable_fault_buffer_info_struct
@@ -307,6 +586,12 @@ typedef struct
         // elements in this array is exactly max_batch_size
         uvm_fault_buffer_entry_t *fault_cache;
 
+        // Array of pointers to fault_cache entries sorted by instance pointer
+        // and fault address, so faults from the same channel are serviced
+        // together and faults on the same VA block are coalesced. The number
+        // of elements in this array is exactly max_faults.
+        uvm_fault_buffer_entry_t **ordered_fault_cache;
+
         // Fault statistics. See replayable fault stats for more details.
         struct
         {
@@ -329,6 +614,10 @@ typedef struct
         // Structure used to coalesce fault servicing in a VA block
         uvm_service_block_context_t block_service_context;
 
+        // mm retention kept across the channels serviced by a bottom half
+        // invocation
+        uvm_va_space_mm_retain_cache_t mm_retain_cache;
+
         // Unique id (per-GPU) generated for tools events recording
         NvU32 batch_id;
 
@@ -396,6 +685,10 @@ struct uvm_access_counter_service_batch_context_struct
     // Structure used to coalesce access counter servicing in a VA block
     uvm_service_block_context_t block_service_context;
 
+    // mm retention kept across the notifications serviced by a bottom half
+    // invocation or pipeline slice
+    uvm_va_space_mm_retain_cache_t mm_retain_cache;
+
     // Unique id (per-GPU) generated for tools events recording
     NvU32 batch_id;
 };
@@ -421,6 +714,20 @@ typedef struct
     NvU64 sub_granularity_regions_per_translation;
 } uvm_gpu_access_counter_type_config_t;
 
+// Physical region tracked by a single access counter, aggregated across
+// notification batches by the pipelined servicing mode
+typedef struct
+{
+    // Copy of the most recent notification for the region. sub_granularity
+    // accumulates the bits of all the aggregated notifications.
+    uvm_access_counter_buffer_entry_t entry;
+
+    // Sum of the counter values of all the aggregated notifications
+    NvU64 heat;
+
+    NvU32 num_notifications;
+} uvm_access_counter_hot_region_t;
+
 typedef struct
 {
     UvmGpuAccessCntrInfo rm_info;
@@ -469,6 +776,36 @@ typedef struct
     // Context structure used to service a GPU access counter batch
     uvm_access_counter_service_batch_context_t batch_service_context;
 
+    // State of the pipelined servicing mode. See
+    // uvm_perf_access_counter_pipeline in uvm_gpu_access_counters.c.
+    struct
+    {
+        // Table of hot regions pending migration, sorted by counter type,
+        // aperture and address.
+        //
+        // Locking: the access counters ISR lock
+        uvm_access_counter_hot_region_t *regions;
+
+        NvU32 num_regions;
+
+        NvU32 max_regions;
+
+        struct
+        {
+            // Notifications merged into an already pending region
+            atomic64_t num_aggregated;
+
+            atomic64_t num_regions_serviced;
+
+            // Regions migrated at the full counter granularity because of
+            // their sub-region density
+            atomic64_t num_regions_expanded;
+
+            // Notifications serviced synchronously because the table was full
+            atomic64_t num_sync_fallbacks;
+        } stats;
+    } pipeline;
+
     // VA space that reconfigured the access counters configuration, if any.
     // Used in builtin tests only, to avoid reconfigurations from different
     // processes
@@ -506,14 +843,35 @@ typedef enum
 // needs to be created.
 // Ampere+ GPUs support physical peer copies, too, so identity mappings are not
 // needed
+// With UVM_GPU_PEER_COPY_MODE_AUTO, Ampere+ GPUs create the identity mappings
+// and choose between virtual and physical copies for each pair of peers, see
+// uvm_gpu_peer_t::copy_modes. AUTO is never the mode of a peer pair.
 typedef enum
 {
     UVM_GPU_PEER_COPY_MODE_UNSUPPORTED,
     UVM_GPU_PEER_COPY_MODE_VIRTUAL,
     UVM_GPU_PEER_COPY_MODE_PHYSICAL,
+    UVM_GPU_PEER_COPY_MODE_AUTO,
     UVM_GPU_PEER_COPY_MODE_COUNT
 } uvm_gpu_peer_copy_mode_t;
 
+// Running totals of the migrations between a pair of processors
+struct uvm_gpu_migration_stats_struct
+{
+    // Bytes copied
+    atomic64_t bytes;
+
+    // Time between the end of the copying pushes and the moment their
+    // completion was noticed, in nanoseconds
+    atomic64_t copy_ns;
+
+    // Number of copying pushes
+    atomic64_t pushes;
+
+    // Number of copying pushes issued to evict GPU memory
+    atomic64_t evictions;
+};
+
 struct uvm_gpu_struct
 {
     uvm_parent_gpu_t *parent;
@@ -573,7 +931,7 @@ struct uvm_gpu_struct
     } time;
 
     // Identity peer mappings are only defined when
-    // peer_copy_mode == UVM_GPU_PEER_COPY_MODE_VIRTUAL
+    // uvm_parent_gpu_needs_peer_identity_mappings() is true
     uvm_gpu_identity_mapping_t peer_mappings[UVM_ID_MAX_GPUS];
 
     struct
@@ -624,6 +982,17 @@ struct uvm_gpu_struct
 
     uvm_pmm_sysmem_mappings_t pmm_sysmem_mappings;
 
+    // Always-on migration counters, updated on completion of the pushes that
+    // copy pages between VA block residencies. A migration is accounted on its
+    // source GPU, indexed by the destination processor, except for migrations
+    // from the CPU, which are accounted on their destination GPU.
+    struct
+    {
+        uvm_gpu_migration_stats_t to[UVM_ID_MAX_PROCESSORS];
+
+        uvm_gpu_migration_stats_t from_cpu;
+    } migration_stats;
+
     // ECC handling
     // In order to trap ECC errors as soon as possible the driver has the hw
     // interrupt register mapped directly. If an ECC interrupt is ever noticed
@@ -651,6 +1020,10 @@ struct uvm_gpu_struct
         // Set to true by RM when a fatal ECC error is encountered (requires
         // asking RM to service pending interrupts to be current).
         NvBool *error_notifier;
+
+        // Time in ns of the last full check that found no ECC error, used by
+        // uvm_gpu_check_ecc_error_aggregated().
+        atomic64_t last_clean_check;
     } ecc;
 
     struct
@@ -673,6 +1046,8 @@ struct uvm_gpu_struct
 
         struct proc_dir_entry *info_file;
 
+        struct proc_dir_entry *migration_stats_file;
+
         struct proc_dir_entry *dir_peers;
     } procfs;
 
@@ -868,6 +1243,8 @@ struct uvm_parent_gpu_struct
 
         struct proc_dir_entry *fault_stats_file;
 
+        struct proc_dir_entry *fault_service_latency_file;
+
         struct proc_dir_entry *access_counters_file;
     } procfs;
 
@@ -1017,6 +1394,13 @@ struct uvm_gpu_peer_struct
     // peer_id[1] from max(gpu_id_1, gpu_id_2) -> min(gpu_id_1, gpu_id_2)
     NvU8 peer_ids[2];
 
+    // Addressing mode used by CEs to access the memory of the peer GPU,
+    // indexed like peer_ids. It is the peer_copy_mode of the parent GPUs
+    // unless that is UVM_GPU_PEER_COPY_MODE_AUTO, in which case it is selected
+    // at peer enablement by timing a short copy in each mode. Meaningless for
+    // indirect peers.
+    uvm_gpu_peer_copy_mode_t copy_modes[2];
+
     // Indirect peers are GPUs which can coherently access each others' memory
     // over NVLINK, but are routed through the CPU using the SYS aperture rather
     // than a PEER aperture
@@ -1161,6 +1545,10 @@ void uvm_gpu_release_pcie_peer_access(uvm_gpu_t *gpu0, uvm_gpu_t *gpu1);
 // They must not be the same gpu.
 uvm_aperture_t uvm_gpu_peer_aperture(uvm_gpu_t *local_gpu, uvm_gpu_t *remote_gpu);
 
+// Get the addressing mode for local_gpu to use in CE copies to/from memory
+// resident on remote_gpu. They must be direct peers.
+uvm_gpu_peer_copy_mode_t uvm_gpu_peer_copy_mode(uvm_gpu_t *local_gpu, uvm_gpu_t *remote_gpu);
+
 // Get the processor id accessible by the given GPU for the given physical address
 uvm_processor_id_t uvm_gpu_get_processor_id_by_address(uvm_gpu_t *gpu, uvm_gpu_phys_address_t addr);
 
@@ -1198,6 +1586,14 @@ static bool uvm_gpus_are_indirect_peers(uvm_gpu_t *gpu0, uvm_gpu_t *gpu1)
     return false;
 }
 
+// Whether the GPU creates identity mappings of the memory of its peers, which
+// virtual peer copies require
+static bool uvm_parent_gpu_needs_peer_identity_mappings(uvm_parent_gpu_t *parent_gpu)
+{
+    return parent_gpu->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_VIRTUAL ||
+           parent_gpu->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_AUTO;
+}
+
 static uvm_gpu_identity_mapping_t *uvm_gpu_get_peer_mapping(uvm_gpu_t *gpu, uvm_gpu_id_t peer_id)
 {
     return &gpu->peer_mappings[uvm_id_gpu_index(peer_id)];
@@ -1208,6 +1604,17 @@ static uvm_gpu_identity_mapping_t *uvm_gpu_get_peer_mapping(uvm_gpu_t *gpu, uvm_
 // Notably this check cannot be performed where it's not safe to call into RM.
 NV_STATUS uvm_gpu_check_ecc_error(uvm_gpu_t *gpu);
 
+// Check for ECC errors on a latency-sensitive path
+//
+// Like uvm_gpu_check_ecc_error(), except that if uvm_perf_ecc_check_window_us
+// is set, the hw interrupt tree is only polled once per window. Concurrent
+// callers within the window share the result of the last poll. The ECC error
+// notifier is still read on every call, so errors RM has already handled
+// through its interrupt handler are always reported.
+//
+// Notably this check cannot be performed where it's not safe to call into RM.
+NV_STATUS uvm_gpu_check_ecc_error_aggregated(uvm_gpu_t *gpu);
+
 // Check for ECC errors without calling into RM
 //
 // Calling into RM is problematic in many places, this check is always safe to do.
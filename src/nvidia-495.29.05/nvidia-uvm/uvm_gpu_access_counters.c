@@ -41,6 +41,12 @@
 #define UVM_PERF_ACCESS_COUNTER_THRESHOLD_MAX       ((1 << 16) - 1)
 #define UVM_PERF_ACCESS_COUNTER_THRESHOLD_DEFAULT   256
 
+#define UVM_PERF_ACCESS_COUNTER_PIPELINE_DENSITY_MIN     1
+#define UVM_PERF_ACCESS_COUNTER_PIPELINE_DENSITY_DEFAULT 16
+
+// Capacity of the hot region table in pipelined mode, in number of batches
+#define UVM_ACCESS_COUNTER_PIPELINE_BATCHES 4
+
 // Each page in a tracked physical range may belong to a different VA Block. We
 // preallocate an array of reverse map translations. However, access counter
 // granularity can be set to up to 16G, which would require an array too large
@@ -57,6 +63,7 @@
 // normal operation, and tests override these values.
 static UVM_ACCESS_COUNTER_GRANULARITY g_uvm_access_counter_granularity;
 static unsigned g_uvm_access_counter_threshold;
+static unsigned g_uvm_access_counter_pipeline_density;
 
 // Per-VA space access counters information
 typedef struct
@@ -86,6 +93,17 @@ static unsigned uvm_perf_access_counter_batch_count = UVM_PERF_ACCESS_COUNTER_BA
 static char *uvm_perf_access_counter_granularity = UVM_PERF_ACCESS_COUNTER_GRANULARITY_DEFAULT;
 static unsigned uvm_perf_access_counter_threshold = UVM_PERF_ACCESS_COUNTER_THRESHOLD_DEFAULT;
 
+// Pipelined servicing of physical notifications. Instead of migrating each
+// notification synchronously in the bottom half, notifications are aggregated
+// across batches into a table of hot regions, which is serviced in order of
+// decreasing heat by a separate work item, one batch of regions at a time.
+static unsigned uvm_perf_access_counter_pipeline = 0;
+
+// In pipelined mode, number of accessed sub-regions (out of
+// UVM_SUB_GRANULARITY_REGIONS) from which the whole region tracked by the
+// counter is migrated, instead of only the accessed sub-regions.
+static unsigned uvm_perf_access_counter_pipeline_density = UVM_PERF_ACCESS_COUNTER_PIPELINE_DENSITY_DEFAULT;
+
 // Module parameters for the tunables
 module_param(uvm_perf_access_counter_mimc_migration_enable, int, S_IRUGO);
 MODULE_PARM_DESC(uvm_perf_access_counter_mimc_migration_enable,
@@ -104,6 +122,14 @@ module_param(uvm_perf_access_counter_threshold, uint, S_IRUGO);
 MODULE_PARM_DESC(uvm_perf_access_counter_threshold,
                  "Number of remote accesses on a region required to trigger a notification."
                  "Valid values: [1, 65535]");
+module_param(uvm_perf_access_counter_pipeline, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_perf_access_counter_pipeline,
+                 "Aggregate physical access counter notifications into hot regions and "
+                 "migrate them asynchronously, hottest first. Valid values: 0 (off), 1 (on)");
+module_param(uvm_perf_access_counter_pipeline_density, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_perf_access_counter_pipeline_density,
+                 "In pipelined mode, number of accessed sub-regions from which the whole "
+                 "tracked region is migrated. Valid values: [1, 32]");
 
 static void access_counter_buffer_flush_locked(uvm_gpu_t *gpu, uvm_gpu_buffer_flush_mode_t flush_mode);
 
@@ -164,7 +190,7 @@ static bool is_migration_enabled(uvm_access_counter_type_t type)
 static va_space_access_counters_info_t *va_space_access_counters_info_create(uvm_va_space_t *va_space)
 {
     va_space_access_counters_info_t *va_space_access_counters;
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     UVM_ASSERT(va_space_access_counters_info_get_or_null(va_space) == NULL);
 
@@ -191,7 +217,7 @@ static va_space_access_counters_info_t *va_space_access_counters_info_create(uvm
 static void va_space_access_counters_info_destroy(uvm_va_space_t *va_space)
 {
     va_space_access_counters_info_t *va_space_access_counters = va_space_access_counters_info_get_or_null(va_space);
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     if (va_space_access_counters) {
         uvm_perf_module_type_unset_data(va_space->perf_modules_data, UVM_PERF_MODULE_TYPE_ACCESS_COUNTERS);
@@ -377,6 +403,17 @@ NV_STATUS uvm_gpu_init_access_counters(uvm_parent_gpu_t *parent_gpu)
         g_uvm_access_counter_threshold = uvm_perf_access_counter_threshold;
     }
 
+    if (uvm_perf_access_counter_pipeline_density < UVM_PERF_ACCESS_COUNTER_PIPELINE_DENSITY_MIN ||
+        uvm_perf_access_counter_pipeline_density > UVM_SUB_GRANULARITY_REGIONS) {
+        g_uvm_access_counter_pipeline_density = UVM_PERF_ACCESS_COUNTER_PIPELINE_DENSITY_DEFAULT;
+        pr_info("Invalid value %u for uvm_perf_access_counter_pipeline_density, using %u instead\n",
+                uvm_perf_access_counter_pipeline_density,
+                g_uvm_access_counter_pipeline_density);
+    }
+    else {
+        g_uvm_access_counter_pipeline_density = uvm_perf_access_counter_pipeline_density;
+    }
+
     if (strcmp(uvm_perf_access_counter_granularity, "64k") == 0) {
         g_uvm_access_counter_granularity = UVM_ACCESS_COUNTER_GRANULARITY_64K;
     }
@@ -445,34 +482,49 @@ NV_STATUS uvm_gpu_init_access_counters(uvm_parent_gpu_t *parent_gpu)
                 access_counters->max_batch_size);
     }
 
-    batch_context->notification_cache = uvm_kvmalloc_zero(access_counters->max_notifications *
-                                                          sizeof(*batch_context->notification_cache));
+    batch_context->notification_cache = uvm_kvmalloc_zero_node(access_counters->max_notifications *
+                                                               sizeof(*batch_context->notification_cache),
+                                                               parent_gpu->closest_cpu_numa_node);
     if (!batch_context->notification_cache) {
         status = NV_ERR_NO_MEMORY;
         goto fail;
     }
 
-    batch_context->virt.notifications = uvm_kvmalloc_zero(access_counters->max_notifications *
-                                                          sizeof(*batch_context->virt.notifications));
+    batch_context->virt.notifications = uvm_kvmalloc_zero_node(access_counters->max_notifications *
+                                                               sizeof(*batch_context->virt.notifications),
+                                                               parent_gpu->closest_cpu_numa_node);
     if (!batch_context->virt.notifications) {
         status = NV_ERR_NO_MEMORY;
         goto fail;
     }
 
-    batch_context->phys.notifications = uvm_kvmalloc_zero(access_counters->max_notifications *
-                                                          sizeof(*batch_context->phys.notifications));
+    batch_context->phys.notifications = uvm_kvmalloc_zero_node(access_counters->max_notifications *
+                                                               sizeof(*batch_context->phys.notifications),
+                                                               parent_gpu->closest_cpu_numa_node);
     if (!batch_context->phys.notifications) {
         status = NV_ERR_NO_MEMORY;
         goto fail;
     }
 
-    batch_context->phys.translations = uvm_kvmalloc_zero((UVM_MAX_TRANSLATION_SIZE / PAGE_SIZE) *
-                                                         sizeof(*batch_context->phys.translations));
+    batch_context->phys.translations = uvm_kvmalloc_zero_node((UVM_MAX_TRANSLATION_SIZE / PAGE_SIZE) *
+                                                              sizeof(*batch_context->phys.translations),
+                                                              parent_gpu->closest_cpu_numa_node);
     if (!batch_context->phys.translations) {
         status = NV_ERR_NO_MEMORY;
         goto fail;
     }
 
+    if (uvm_perf_access_counter_pipeline) {
+        access_counters->pipeline.max_regions = access_counters->max_batch_size * UVM_ACCESS_COUNTER_PIPELINE_BATCHES;
+        access_counters->pipeline.regions = uvm_kvmalloc_zero_node(access_counters->pipeline.max_regions *
+                                                                   sizeof(*access_counters->pipeline.regions),
+                                                                   parent_gpu->closest_cpu_numa_node);
+        if (!access_counters->pipeline.regions) {
+            status = NV_ERR_NO_MEMORY;
+            goto fail;
+        }
+    }
+
     return NV_OK;
 
 fail:
@@ -505,6 +557,10 @@ void uvm_gpu_deinit_access_counters(uvm_parent_gpu_t *parent_gpu)
     batch_context->virt.notifications = NULL;
     batch_context->phys.notifications = NULL;
     batch_context->phys.translations = NULL;
+
+    uvm_kvfree(access_counters->pipeline.regions);
+    access_counters->pipeline.regions = NULL;
+    access_counters->pipeline.num_regions = 0;
 }
 
 bool uvm_gpu_access_counters_required(const uvm_parent_gpu_t *parent_gpu)
@@ -585,6 +641,10 @@ static void access_counters_yield_ownership(uvm_gpu_t *gpu)
     status = uvm_rm_locked_call(nvUvmInterfaceDisableAccessCntr(gpu->parent->rm_device,
                                                                 &access_counters->rm_info));
     UVM_ASSERT(status == NV_OK);
+
+    // Pending hot regions may refer to GPUs that are about to be unregistered,
+    // and to a configuration that is about to change
+    access_counters->pipeline.num_regions = 0;
 }
 
 // Increment the refcount of access counter enablement. If this is the first
@@ -720,6 +780,9 @@ static void access_counter_buffer_flush_locked(uvm_gpu_t *gpu, uvm_gpu_buffer_fl
     }
 
     write_get(gpu->parent, get);
+
+    // Flushing also drops the notifications aggregated in pipelined mode
+    access_counters->pipeline.num_regions = 0;
 }
 
 void uvm_gpu_access_counter_buffer_flush(uvm_gpu_t *gpu)
@@ -831,7 +894,7 @@ static NvU32 fetch_access_counter_buffer_entries(uvm_gpu_t *gpu,
 
         // We cannot just wait for the last entry (the one pointed by put) to become valid, we have to do it
         // individually since entries can be written out of order
-        UVM_SPIN_WHILE(!gpu->parent->access_counter_buffer_hal->entry_is_valid(gpu->parent, get), &spin) {
+        UVM_SPIN_WHILE(!uvm_hal_access_counter_buffer_entry_is_valid(gpu->parent, get), &spin) {
             // We have some entry to work on. Let's do the rest later.
             if (fetch_mode != NOTIFICATION_FETCH_MODE_ALL && notification_index > 0)
                 goto done;
@@ -841,7 +904,7 @@ static NvU32 fetch_access_counter_buffer_entries(uvm_gpu_t *gpu,
         smp_mb__after_atomic();
 
         // Got valid bit set. Let's cache.
-        gpu->parent->access_counter_buffer_hal->parse_entry(gpu->parent, get, current_entry);
+        uvm_hal_access_counter_buffer_parse_entry(gpu->parent, get, current_entry);
 
         if (current_entry->address.is_virtual) {
             batch_context->virt.notifications[batch_context->virt.num_notifications++] = current_entry;
@@ -1134,6 +1197,40 @@ static void reverse_mappings_to_va_block_page_mask(uvm_va_block_t *va_block,
     }
 }
 
+// Apply the access counter policy of the VA range of the block to a
+// notification on accessed_pages. Returns false if the block has not received
+// enough notifications yet to be serviced. Otherwise, accessed_pages is
+// expanded to the regions of the policy granularity that it touches.
+static bool va_block_apply_access_counter_policy(uvm_va_block_t *va_block, uvm_page_mask_t *accessed_pages)
+{
+    uvm_va_range_t *va_range = va_block->va_range;
+    NvU32 granularity = va_range->access_counter_granularity;
+    NvU64 addr;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    if (va_range->access_counter_notification_threshold > 1) {
+        if (++va_block->access_counter_notifications < va_range->access_counter_notification_threshold)
+            return false;
+
+        va_block->access_counter_notifications = 0;
+    }
+
+    if (granularity <= PAGE_SIZE)
+        return true;
+
+    for (addr = UVM_ALIGN_DOWN(va_block->start, granularity); addr <= va_block->end; addr += granularity) {
+        uvm_va_block_region_t region = uvm_va_block_region_from_start_end(va_block,
+                                                                          max(addr, va_block->start),
+                                                                          min(addr + granularity - 1, va_block->end));
+
+        if (!uvm_page_mask_region_empty(accessed_pages, region))
+            uvm_page_mask_region_fill(accessed_pages, region);
+    }
+
+    return true;
+}
+
 static NV_STATUS service_phys_single_va_block(uvm_gpu_t *gpu,
                                               uvm_access_counter_service_batch_context_t *batch_context,
                                               const uvm_access_counter_buffer_entry_t *current_entry,
@@ -1165,7 +1262,7 @@ static NV_STATUS service_phys_single_va_block(uvm_gpu_t *gpu,
 
         // If an mm is registered with the VA space, we have to retain it
         // in order to lock it before locking the VA space.
-        mm = uvm_va_space_mm_retain_lock(va_space);
+        mm = uvm_va_space_mm_cached_retain_lock(&batch_context->mm_retain_cache, va_space);
 
         uvm_va_space_down_read(va_space);
 
@@ -1188,6 +1285,14 @@ static NV_STATUS service_phys_single_va_block(uvm_gpu_t *gpu,
 
         reverse_mappings_to_va_block_page_mask(va_block, reverse_mappings, num_reverse_mappings, accessed_pages);
 
+        // Notifications below the threshold of the VA range are only counted.
+        // The counter is cleared so the GPU reports the next one.
+        if (!va_block_apply_access_counter_policy(va_block, accessed_pages)) {
+            uvm_mutex_unlock(&va_block->lock);
+            *clear_counter = true;
+            goto done;
+        }
+
         status = UVM_VA_BLOCK_RETRY_LOCKED(va_block, &va_block_retry,
                                            service_va_block_locked(processor,
                                                                    va_block,
@@ -1204,7 +1309,7 @@ static NV_STATUS service_phys_single_va_block(uvm_gpu_t *gpu,
 done:
     if (va_space) {
         uvm_va_space_up_read(va_space);
-        uvm_va_space_mm_release_unlock(va_space, mm);
+        uvm_va_space_mm_cached_unlock(mm);
     }
 
     // Drop the refcounts taken by the reverse map translation routines
@@ -1387,6 +1492,12 @@ static NV_STATUS service_phys_notification(uvm_gpu_t *gpu,
     for (translation_index = 0; translation_index < config->translations_per_counter; ++translation_index) {
         size_t num_reverse_mappings;
         bool clear_counter_local = false;
+
+        // Notifications on vidmem are a direct measure of its use, which PMM
+        // takes into account when picking chunks to evict
+        if (resident_gpu && uvm_gpu_supports_eviction(resident_gpu))
+            uvm_pmm_gpu_mark_root_chunk_referenced_by_address(&resident_gpu->pmm, address);
+
         status = service_phys_notification_translation(gpu,
                                                        resident_gpu,
                                                        batch_context,
@@ -1443,14 +1554,209 @@ static NV_STATUS service_phys_notifications(uvm_gpu_t *gpu,
     return NV_OK;
 }
 
+// Order used by the hot region table: counter type, then aperture, then
+// address
+static int cmp_hot_region_key(const uvm_access_counter_buffer_entry_t *a,
+                              const uvm_access_counter_buffer_entry_t *b)
+{
+    if (a->counter_type != b->counter_type)
+        return a->counter_type < b->counter_type ? -1 : 1;
+
+    if (a->address.aperture != b->address.aperture)
+        return a->address.aperture < b->address.aperture ? -1 : 1;
+
+    return UVM_CMP_DEFAULT(a->address.address, b->address.address);
+}
+
+static int cmp_sort_hot_regions_by_key(const void *_a, const void *_b)
+{
+    const uvm_access_counter_hot_region_t *a = _a;
+    const uvm_access_counter_hot_region_t *b = _b;
+
+    return cmp_hot_region_key(&a->entry, &b->entry);
+}
+
+// Hottest regions first
+static int cmp_sort_hot_regions_by_heat(const void *_a, const void *_b)
+{
+    const uvm_access_counter_hot_region_t *a = _a;
+    const uvm_access_counter_hot_region_t *b = _b;
+
+    return UVM_CMP_DEFAULT(b->heat, a->heat);
+}
+
+// Merge the notification into the hot region table. Returns false if the
+// notification tracks a new region and the table is full.
+static bool pipeline_aggregate_notification(uvm_access_counter_buffer_info_t *access_counters,
+                                            const uvm_access_counter_buffer_entry_t *entry)
+{
+    uvm_access_counter_hot_region_t *regions = access_counters->pipeline.regions;
+    NvU32 first = 0;
+    NvU32 last = access_counters->pipeline.num_regions;
+
+    // Binary search for the region, or for the insertion point
+    while (first < last) {
+        NvU32 mid = first + (last - first) / 2;
+        int cmp = cmp_hot_region_key(&regions[mid].entry, entry);
+
+        if (cmp == 0) {
+            NvU32 sub_granularity = regions[mid].entry.sub_granularity | entry->sub_granularity;
+
+            // Keep the most recent copy for the targeted clear
+            regions[mid].entry = *entry;
+            regions[mid].entry.sub_granularity = sub_granularity;
+            regions[mid].heat += entry->counter_value;
+            ++regions[mid].num_notifications;
+
+            atomic64_inc(&access_counters->pipeline.stats.num_aggregated);
+            return true;
+        }
+
+        if (cmp < 0)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+
+    if (access_counters->pipeline.num_regions == access_counters->pipeline.max_regions)
+        return false;
+
+    memmove(regions + first + 1,
+            regions + first,
+            (access_counters->pipeline.num_regions - first) * sizeof(*regions));
+
+    regions[first].entry = *entry;
+    regions[first].heat = entry->counter_value;
+    regions[first].num_notifications = 1;
+    ++access_counters->pipeline.num_regions;
+
+    return true;
+}
+
+static NV_STATUS pipeline_phys_notifications(uvm_gpu_t *gpu,
+                                             uvm_access_counter_service_batch_context_t *batch_context)
+{
+    NvU32 i;
+    uvm_access_counter_buffer_info_t *access_counters = &gpu->parent->access_counter_buffer_info;
+
+    preprocess_phys_notifications(batch_context);
+
+    for (i = 0; i < batch_context->phys.num_notifications; ++i) {
+        NV_STATUS status;
+        uvm_access_counter_buffer_entry_t *current_entry = batch_context->phys.notifications[i];
+
+        if (!UVM_ID_IS_VALID(current_entry->physical_info.resident_id))
+            continue;
+
+        if (pipeline_aggregate_notification(access_counters, current_entry))
+            continue;
+
+        atomic64_inc(&access_counters->pipeline.stats.num_sync_fallbacks);
+
+        status = service_phys_notification(gpu, batch_context, current_entry);
+        if (status != NV_OK)
+            return status;
+    }
+
+    return NV_OK;
+}
+
+// Pick the migration granularity of the region from the density of accessed
+// sub-regions: dense regions are migrated at the full granularity of the
+// counter, sparse ones only on the accessed sub-regions. 16G counters are
+// never expanded.
+static void pipeline_adapt_granularity(uvm_access_counter_buffer_info_t *access_counters,
+                                       uvm_access_counter_hot_region_t *region)
+{
+    const uvm_gpu_access_counter_type_config_t *config = get_config_for_type(access_counters,
+                                                                             region->entry.counter_type);
+
+    if (config->rm.granularity == UVM_ACCESS_COUNTER_GRANULARITY_64K ||
+        config->rm.granularity == UVM_ACCESS_COUNTER_GRANULARITY_16G)
+        return;
+
+    if (hweight32(region->entry.sub_granularity) < g_uvm_access_counter_pipeline_density)
+        return;
+
+    if (region->entry.sub_granularity != (NvU32)-1)
+        atomic64_inc(&access_counters->pipeline.stats.num_regions_expanded);
+
+    region->entry.sub_granularity = (NvU32)-1;
+}
+
+void uvm_gpu_service_access_counters_pipeline(uvm_gpu_t *gpu)
+{
+    NV_STATUS status = NV_OK;
+    uvm_access_counter_buffer_info_t *access_counters = &gpu->parent->access_counter_buffer_info;
+    uvm_access_counter_service_batch_context_t *batch_context = &access_counters->batch_service_context;
+    uvm_access_counter_hot_region_t *regions = access_counters->pipeline.regions;
+    NvU32 num_serviced;
+    NvU32 i;
+
+    UVM_ASSERT(gpu->parent->access_counters_supported);
+    UVM_ASSERT(uvm_sem_is_locked(&gpu->parent->isr.access_counters.service_lock));
+
+    // The regions are retained while notifications are ignored, and serviced
+    // by the first pipeline slice scheduled after that.
+    if (gpu->parent->isr.access_counters.handling_ref_count == 0 || access_counters->notifications_ignored_count > 0)
+        return;
+
+    if (access_counters->pipeline.num_regions == 0)
+        return;
+
+    sort(regions, access_counters->pipeline.num_regions, sizeof(*regions), cmp_sort_hot_regions_by_heat, NULL);
+
+    num_serviced = min(access_counters->pipeline.num_regions, access_counters->max_batch_size);
+
+    for (i = 0; i < num_serviced; ++i) {
+        uvm_access_counter_hot_region_t *region = &regions[i];
+
+        // The GPU where the region was resident may have been removed since
+        // the notifications were aggregated
+        if (UVM_ID_IS_GPU(region->entry.physical_info.resident_id) &&
+            !uvm_gpu_get_by_processor_id(region->entry.physical_info.resident_id))
+            continue;
+
+        pipeline_adapt_granularity(access_counters, region);
+
+        status = service_phys_notification(gpu, batch_context, &region->entry);
+        if (status != NV_OK)
+            break;
+
+        atomic64_inc(&access_counters->pipeline.stats.num_regions_serviced);
+    }
+
+    uvm_va_space_mm_retain_cache_flush(&batch_context->mm_retain_cache);
+
+    access_counters->pipeline.num_regions -= num_serviced;
+    memmove(regions, regions + num_serviced, access_counters->pipeline.num_regions * sizeof(*regions));
+
+    if (status != NV_OK) {
+        UVM_DBG_PRINT("Error %s servicing access counter hot regions on GPU: %s\n",
+                      nvstatusToString(status),
+                      uvm_gpu_name(gpu));
+
+        access_counters->pipeline.num_regions = 0;
+        return;
+    }
+
+    if (access_counters->pipeline.num_regions == 0)
+        return;
+
+    sort(regions, access_counters->pipeline.num_regions, sizeof(*regions), cmp_sort_hot_regions_by_key, NULL);
+
+    uvm_gpu_schedule_access_counters_pipeline(gpu->parent);
+}
+
 void uvm_gpu_service_access_counters(uvm_gpu_t *gpu)
 {
     NV_STATUS status = NV_OK;
-    uvm_access_counter_service_batch_context_t *batch_context = &gpu->parent->access_counter_buffer_info.batch_service_context;
+    uvm_access_counter_buffer_info_t *access_counters = &gpu->parent->access_counter_buffer_info;
+    uvm_access_counter_service_batch_context_t *batch_context = &access_counters->batch_service_context;
 
     UVM_ASSERT(gpu->parent->access_counters_supported);
 
-    if (gpu->parent->access_counter_buffer_info.notifications_ignored_count > 0)
+    if (access_counters->notifications_ignored_count > 0)
         return;
 
     while (1) {
@@ -1466,11 +1772,21 @@ void uvm_gpu_service_access_counters(uvm_gpu_t *gpu)
         if (status != NV_OK)
             break;
 
-        status = service_phys_notifications(gpu, batch_context);
+        if (access_counters->pipeline.regions)
+            status = pipeline_phys_notifications(gpu, batch_context);
+        else
+            status = service_phys_notifications(gpu, batch_context);
+
         if (status != NV_OK)
             break;
     }
 
+    // Don't keep the mm retained while idle, as that would block its shutdown
+    uvm_va_space_mm_retain_cache_flush(&batch_context->mm_retain_cache);
+
+    if (access_counters->pipeline.num_regions > 0)
+        uvm_gpu_schedule_access_counters_pipeline(gpu->parent);
+
     if (status != NV_OK) {
         UVM_DBG_PRINT("Error %s servicing access counter notifications on GPU: %s\n",
                       nvstatusToString(status),
@@ -33,6 +33,12 @@ bool uvm_gpu_access_counters_pending(uvm_parent_gpu_t *parent_gpu);
 
 void uvm_gpu_service_access_counters(uvm_gpu_t *gpu);
 
+// Service a slice of the hot regions aggregated in pipelined mode, hottest
+// first, and reschedule the pipeline work item if any regions remain.
+//
+// The access counters ISR lock must be held.
+void uvm_gpu_service_access_counters_pipeline(uvm_gpu_t *gpu);
+
 void uvm_gpu_access_counter_buffer_flush(uvm_gpu_t *gpu);
 
 // Ignore or unignore access counters notifications. Ignoring means that the
@@ -51,6 +51,27 @@
 // re-evaluated by writing to GET. Non-replayable faults work the same way, but
 // they are currently owned by RM, so UVM doesn't have to do anything.
 
+// Use lockless nv_kthread_q's (NV_KTHREAD_Q_FLAGS_LOCKLESS) for the bottom
+// halves. Scheduling a bottom half from the top half then does not take the
+// queue spinlock, and the kthread is only woken up when its queue was empty.
+static unsigned uvm_isr_lockless_bottom_half = 0;
+module_param(uvm_isr_lockless_bottom_half, uint, S_IRUGO);
+
+// Run the bottom half kthreads with the SCHED_FIFO policy, so that they are
+// not delayed by CPU-bound user threads.
+static unsigned uvm_isr_bottom_half_sched_fifo = 0;
+module_param(uvm_isr_bottom_half_sched_fifo, uint, S_IRUGO);
+
+// Nice level of the bottom half kthreads, when not using SCHED_FIFO. Valid
+// values are -20..19.
+static int uvm_isr_bottom_half_nice = 0;
+module_param(uvm_isr_bottom_half_nice, int, S_IRUGO);
+
+// Collect scheduling latency statistics for the bottom half queues. They are
+// reported in the GPU info procfs file.
+static unsigned uvm_isr_bottom_half_stats = 0;
+module_param(uvm_isr_bottom_half_stats, uint, S_IRUGO);
+
 // For use by the nv_kthread_q that is servicing the replayable fault bottom
 // half, only.
 static void replayable_faults_isr_bottom_half_entry(void *args);
@@ -63,6 +84,10 @@ static void non_replayable_faults_isr_bottom_half_entry(void *args);
 // half, only.
 static void access_counters_isr_bottom_half_entry(void *args);
 
+// For use by the nv_kthread_q that is servicing the access counters pipeline,
+// only.
+static void access_counters_pipeline_entry(void *args);
+
 // Increments the reference count tracking whether replayable page fault
 // interrupts should be disabled. The caller is guaranteed that replayable page
 // faults are disabled upon return. Interrupts might already be disabled prior
@@ -266,19 +291,35 @@ NV_STATUS uvm_isr_top_half_entry(const NvProcessorUuid *gpu_uuid)
 
 static NV_STATUS init_queue_on_node(nv_kthread_q_t *queue, const char *name, int node)
 {
-#if UVM_THREAD_AFFINITY_SUPPORTED()
-    if (node != -1 && !cpumask_empty(uvm_cpumask_of_node(node))) {
-        NV_STATUS status;
+    nv_kthread_q_attrs_t attrs = {
+        .preferred_node = NV_KTHREAD_NO_NODE,
+        .sched_policy   = NV_KTHREAD_Q_SCHED_NORMAL,
+    };
 
-        status = errno_to_nv_status(nv_kthread_q_init_on_node(queue, name, node));
-        if (status != NV_OK)
-            return status;
+    if (uvm_isr_lockless_bottom_half)
+        attrs.flags |= NV_KTHREAD_Q_FLAGS_LOCKLESS;
+
+    if (uvm_isr_bottom_half_stats)
+        attrs.flags |= NV_KTHREAD_Q_FLAGS_STATS;
+
+    if (uvm_isr_bottom_half_sched_fifo) {
+        attrs.sched_policy = NV_KTHREAD_Q_SCHED_FIFO;
+    }
+    else if (uvm_isr_bottom_half_nice >= -20 && uvm_isr_bottom_half_nice <= 19) {
+        attrs.nice = uvm_isr_bottom_half_nice;
+    }
+    else {
+        pr_info("Invalid value %d for uvm_isr_bottom_half_nice. Using 0 instead\n", uvm_isr_bottom_half_nice);
+    }
 
-        return errno_to_nv_status(set_cpus_allowed_ptr(queue->q_kthread, uvm_cpumask_of_node(node)));
+#if UVM_THREAD_AFFINITY_SUPPORTED()
+    if (node != -1 && !cpumask_empty(uvm_cpumask_of_node(node))) {
+        attrs.preferred_node = node;
+        attrs.cpumask = uvm_cpumask_of_node(node);
     }
 #endif
 
-    return errno_to_nv_status(nv_kthread_q_init(queue, name));
+    return errno_to_nv_status(nv_kthread_q_init_with_attrs(queue, name, &attrs));
 }
 
 NV_STATUS uvm_gpu_init_isr(uvm_parent_gpu_t *parent_gpu)
@@ -353,6 +394,21 @@ NV_STATUS uvm_gpu_init_isr(uvm_parent_gpu_t *parent_gpu)
                                    access_counters_isr_bottom_half_entry,
                                    parent_gpu);
 
+            nv_kthread_q_item_init(&parent_gpu->isr.access_counters_pipeline_q_item,
+                                   access_counters_pipeline_entry,
+                                   parent_gpu);
+
+            snprintf(kthread_name, sizeof(kthread_name), "UVM GPU%u AC", uvm_id_value(parent_gpu->id));
+            status = init_queue_on_node(&parent_gpu->isr.access_counters_pipeline_q,
+                                        kthread_name,
+                                        parent_gpu->closest_cpu_numa_node);
+            if (status != NV_OK) {
+                UVM_ERR_PRINT("Failed in nv_kthread_q_init for access_counters_pipeline_q: %s, GPU %s\n",
+                              nvstatusToString(status),
+                              parent_gpu->name);
+                return status;
+            }
+
             // Access counters interrupts are initially disabled. They are
             // dynamically enabled when the GPU is registered on a VA space.
             parent_gpu->isr.access_counters.handling_ref_count = 0;
@@ -370,6 +426,9 @@ void uvm_gpu_flush_bottom_halves(uvm_parent_gpu_t *parent_gpu)
 {
     nv_kthread_q_flush(&parent_gpu->isr.bottom_half_q);
     nv_kthread_q_flush(&parent_gpu->isr.kill_channel_q);
+
+    if (parent_gpu->access_counters_supported)
+        nv_kthread_q_flush(&parent_gpu->isr.access_counters_pipeline_q);
 }
 
 void uvm_gpu_disable_isr(uvm_parent_gpu_t *parent_gpu)
@@ -399,6 +458,10 @@ void uvm_gpu_disable_isr(uvm_parent_gpu_t *parent_gpu)
     // nv_kthread_q_init() failed in uvm_gpu_init_isr().
     nv_kthread_q_stop(&parent_gpu->isr.bottom_half_q);
     nv_kthread_q_stop(&parent_gpu->isr.kill_channel_q);
+
+    // Stopped after the bottom half queue, since the bottom half schedules the
+    // pipeline work item.
+    nv_kthread_q_stop(&parent_gpu->isr.access_counters_pipeline_q);
 }
 
 void uvm_gpu_deinit_isr(uvm_parent_gpu_t *parent_gpu)
@@ -591,6 +654,49 @@ static void access_counters_isr_bottom_half_entry(void *args)
    UVM_ENTRY_VOID(access_counters_isr_bottom_half(args));
 }
 
+static void access_counters_pipeline(void *args)
+{
+    uvm_parent_gpu_t *parent_gpu = (uvm_parent_gpu_t *)args;
+    uvm_gpu_t *gpu;
+
+    gpu = find_first_valid_gpu(parent_gpu);
+    if (gpu == NULL)
+        goto put_kref;
+
+    UVM_ASSERT(parent_gpu->access_counters_supported);
+
+    // Unlike the bottom half, the pipeline work item is not scheduled with
+    // the ISR lock held. Taking the lock here also disables access counter
+    // interrupts, so the bottom half cannot run concurrently. It also means
+    // that new notifications are fetched in between pipeline slices.
+    uvm_gpu_access_counters_isr_lock(parent_gpu);
+
+    uvm_gpu_service_access_counters_pipeline(gpu);
+
+    uvm_gpu_access_counters_isr_unlock(parent_gpu);
+
+put_kref:
+    uvm_parent_gpu_kref_put(parent_gpu);
+}
+
+static void access_counters_pipeline_entry(void *args)
+{
+   UVM_ENTRY_VOID(access_counters_pipeline(args));
+}
+
+void uvm_gpu_schedule_access_counters_pipeline(uvm_parent_gpu_t *parent_gpu)
+{
+    UVM_ASSERT(nv_kref_read(&parent_gpu->gpu_kref) > 0);
+
+    nv_kref_get(&parent_gpu->gpu_kref);
+
+    // If the q_item is already queued, that instance will service the pending
+    // regions. This also covers the queue being stopped during GPU removal.
+    if (!nv_kthread_q_schedule_q_item(&parent_gpu->isr.access_counters_pipeline_q,
+                                      &parent_gpu->isr.access_counters_pipeline_q_item))
+        uvm_parent_gpu_kref_put(parent_gpu);
+}
+
 void uvm_gpu_replayable_faults_isr_lock(uvm_parent_gpu_t *parent_gpu)
 {
     UVM_ASSERT(nv_kref_read(&parent_gpu->gpu_kref) > 0);
@@ -123,6 +123,13 @@ typedef struct
     // avoid deadlocks.
     nv_kthread_q_t kill_channel_q;
 
+    // Kernel thread used to service the hot regions aggregated by the access
+    // counters bottom half in pipelined mode. The work item takes the access
+    // counters ISR lock, so it cannot run on bottom_half_q: the bottom half
+    // that releases the lock could be queued behind it.
+    nv_kthread_q_t access_counters_pipeline_q;
+    nv_kthread_q_item_t access_counters_pipeline_q_item;
+
     // Number of top-half ISRs called for this GPU over its lifetime
     NvU64 interrupt_count;
 } uvm_isr_info_t;
@@ -170,6 +177,11 @@ void uvm_gpu_non_replayable_faults_isr_unlock(uvm_parent_gpu_t *parent_gpu);
 void uvm_gpu_access_counters_isr_lock(uvm_parent_gpu_t *parent_gpu);
 void uvm_gpu_access_counters_isr_unlock(uvm_parent_gpu_t *parent_gpu);
 
+// Schedule the servicing of the access counter hot regions aggregated in
+// pipelined mode. The work item takes the access counters ISR lock, so it can
+// be scheduled with the lock held.
+void uvm_gpu_schedule_access_counters_pipeline(uvm_parent_gpu_t *parent_gpu);
+
 // Increments the reference count tracking whether access counter interrupts
 // should be disabled. The caller is guaranteed that access counter interrupts
 // are disabled upon return. Interrupts might already be disabled prior to
@@ -20,6 +20,7 @@
     DEALINGS IN THE SOFTWARE.
 *******************************************************************************/
 
+#include "linux/sort.h"
 #include "nv_uvm_interface.h"
 #include "uvm_common.h"
 #include "uvm_api.h"
@@ -112,7 +113,9 @@
 // Once UVM has parsed a non-replayable fault entry corresponding to managed
 // memory, and identified the VA block associated with it, the servicing logic
 // for that block is identical to that of a replayable fault, see
-// uvm_va_block_service_locked. Another similarity between the two types of
+// uvm_va_block_service_locked. The fetched entries are sorted by channel and
+// address, so all the faults of a channel lying in the same VA block are
+// serviced together, and the faulted bit of the channel is cleared once. Another similarity between the two types of
 // faults is that they use the same entry format, uvm_fault_buffer_entry_t.
 
 
@@ -124,22 +127,31 @@ NV_STATUS uvm_gpu_fault_buffer_init_non_replayable_faults(uvm_parent_gpu_t *pare
 
     UVM_ASSERT(parent_gpu->non_replayable_faults_supported);
 
-    non_replayable_faults->shadow_buffer_copy = NULL;
-    non_replayable_faults->fault_cache        = NULL;
+    non_replayable_faults->shadow_buffer_copy  = NULL;
+    non_replayable_faults->fault_cache         = NULL;
+    non_replayable_faults->ordered_fault_cache = NULL;
 
     non_replayable_faults->max_faults = parent_gpu->fault_buffer_info.rm_info.nonReplayable.bufferSize /
                                         parent_gpu->fault_buffer_hal->entry_size(parent_gpu);
 
     non_replayable_faults->shadow_buffer_copy =
-        uvm_kvmalloc_zero(parent_gpu->fault_buffer_info.rm_info.nonReplayable.bufferSize);
+        uvm_kvmalloc_zero_node(parent_gpu->fault_buffer_info.rm_info.nonReplayable.bufferSize,
+                               parent_gpu->closest_cpu_numa_node);
     if (!non_replayable_faults->shadow_buffer_copy)
         return NV_ERR_NO_MEMORY;
 
-    non_replayable_faults->fault_cache = uvm_kvmalloc_zero(non_replayable_faults->max_faults *
-                                                           sizeof(*non_replayable_faults->fault_cache));
+    non_replayable_faults->fault_cache = uvm_kvmalloc_zero_node(non_replayable_faults->max_faults *
+                                                                sizeof(*non_replayable_faults->fault_cache),
+                                                                parent_gpu->closest_cpu_numa_node);
     if (!non_replayable_faults->fault_cache)
         return NV_ERR_NO_MEMORY;
 
+    non_replayable_faults->ordered_fault_cache =
+        uvm_kvmalloc_zero_node(non_replayable_faults->max_faults * sizeof(*non_replayable_faults->ordered_fault_cache),
+                               parent_gpu->closest_cpu_numa_node);
+    if (!non_replayable_faults->ordered_fault_cache)
+        return NV_ERR_NO_MEMORY;
+
     uvm_tracker_init(&non_replayable_faults->clear_faulted_tracker);
     uvm_tracker_init(&non_replayable_faults->fault_service_tracker);
 
@@ -160,8 +172,10 @@ void uvm_gpu_fault_buffer_deinit_non_replayable_faults(uvm_parent_gpu_t *parent_
 
     uvm_kvfree(non_replayable_faults->shadow_buffer_copy);
     uvm_kvfree(non_replayable_faults->fault_cache);
-    non_replayable_faults->shadow_buffer_copy = NULL;
-    non_replayable_faults->fault_cache        = NULL;
+    uvm_kvfree(non_replayable_faults->ordered_fault_cache);
+    non_replayable_faults->shadow_buffer_copy  = NULL;
+    non_replayable_faults->fault_cache         = NULL;
+    non_replayable_faults->ordered_fault_cache = NULL;
 }
 
 bool uvm_gpu_non_replayable_faults_pending(uvm_parent_gpu_t *parent_gpu)
@@ -202,7 +216,7 @@ static NvU32 fetch_non_replayable_fault_buffer_entries(uvm_gpu_t *gpu)
     for (i = 0; i < cached_faults; ++i) {
         uvm_fault_buffer_entry_t *fault_entry = &non_replayable_faults->fault_cache[i];
 
-        gpu->parent->fault_buffer_hal->parse_non_replayable_entry(gpu->parent, current_hw_entry, fault_entry);
+        uvm_hal_fault_buffer_parse_non_replayable_entry(gpu->parent, current_hw_entry, fault_entry);
 
         // The GPU aligns the fault addresses to 4k, but all of our tracking is
         // done in PAGE_SIZE chunks which might be larger.
@@ -245,24 +259,42 @@ static bool use_clear_faulted_channel_sw_method(uvm_gpu_t *gpu)
     return false;
 }
 
+// All the faults serviced for a channel in a batch are cleared together. The
+// faulted bit to clear only depends on the MMU engine type of the fault, so a
+// single clear is issued per engine type.
+static bool needs_clear_faulted(uvm_fault_buffer_entry_t *fault_entry, NvU32 *cleared_engine_types)
+{
+    NvU32 engine_type_bit = 1U << fault_entry->fault_source.mmu_engine_type;
+
+    BUILD_BUG_ON(UVM_MMU_ENGINE_TYPE_COUNT > 32);
+
+    if (*cleared_engine_types & engine_type_bit)
+        return false;
+
+    *cleared_engine_types |= engine_type_bit;
+    return true;
+}
+
 static NV_STATUS clear_faulted_method_on_gpu(uvm_gpu_t *gpu,
                                              uvm_user_channel_t *user_channel,
-                                             const uvm_fault_buffer_entry_t *fault_entry,
+                                             uvm_fault_buffer_entry_t **faults,
+                                             NvU32 num_faults,
                                              NvU32 batch_id,
                                              uvm_tracker_t *tracker)
 {
     NV_STATUS status;
     uvm_push_t push;
+    NvU32 i;
+    NvU32 cleared_engine_types = 0;
     uvm_non_replayable_fault_buffer_info_t *non_replayable_faults = &gpu->parent->fault_buffer_info.non_replayable;
 
-    UVM_ASSERT(!fault_entry->is_fatal);
-
     status = uvm_push_begin_acquire(gpu->channel_manager,
                                     UVM_CHANNEL_TYPE_MEMOPS,
                                     tracker,
                                     &push,
-                                    "Clearing set bit for address 0x%llx",
-                                    fault_entry->fault_address);
+                                    "Clearing set bit for %u faults, first address 0x%llx",
+                                    num_faults,
+                                    faults[0]->fault_address);
     if (status != NV_OK) {
         UVM_ERR_PRINT("Error acquiring tracker before clearing faulted: %s, GPU %s\n",
                       nvstatusToString(status),
@@ -270,12 +302,21 @@ static NV_STATUS clear_faulted_method_on_gpu(uvm_gpu_t *gpu,
         return status;
     }
 
-    if (use_clear_faulted_channel_sw_method(gpu))
-        gpu->parent->host_hal->clear_faulted_channel_sw_method(&push, user_channel, fault_entry);
-    else
-        gpu->parent->host_hal->clear_faulted_channel_method(&push, user_channel, fault_entry);
+    for (i = 0; i < num_faults; ++i) {
+        uvm_fault_buffer_entry_t *fault_entry = faults[i];
+
+        UVM_ASSERT(!fault_entry->is_fatal);
+
+        if (!needs_clear_faulted(fault_entry, &cleared_engine_types))
+            continue;
+
+        if (use_clear_faulted_channel_sw_method(gpu))
+            gpu->parent->host_hal->clear_faulted_channel_sw_method(&push, user_channel, fault_entry);
+        else
+            gpu->parent->host_hal->clear_faulted_channel_method(&push, user_channel, fault_entry);
 
-    uvm_tools_broadcast_replay(gpu, &push, batch_id, fault_entry->fault_source.client_type);
+        uvm_tools_broadcast_replay(gpu, &push, batch_id, fault_entry->fault_source.client_type);
+    }
 
     uvm_push_end(&push);
 
@@ -294,11 +335,14 @@ static NV_STATUS clear_faulted_method_on_gpu(uvm_gpu_t *gpu,
 
 static NV_STATUS clear_faulted_register_on_gpu(uvm_gpu_t *gpu,
                                                uvm_user_channel_t *user_channel,
-                                               const uvm_fault_buffer_entry_t *fault_entry,
+                                               uvm_fault_buffer_entry_t **faults,
+                                               NvU32 num_faults,
                                                NvU32 batch_id,
                                                uvm_tracker_t *tracker)
 {
     NV_STATUS status;
+    NvU32 i;
+    NvU32 cleared_engine_types = 0;
 
     UVM_ASSERT(!gpu->parent->has_clear_faulted_channel_method);
 
@@ -308,120 +352,161 @@ static NV_STATUS clear_faulted_register_on_gpu(uvm_gpu_t *gpu,
     if (status != NV_OK)
         return status;
 
-    gpu->parent->host_hal->clear_faulted_channel_register(user_channel, fault_entry);
+    for (i = 0; i < num_faults; ++i) {
+        uvm_fault_buffer_entry_t *fault_entry = faults[i];
+
+        UVM_ASSERT(!fault_entry->is_fatal);
+
+        if (!needs_clear_faulted(fault_entry, &cleared_engine_types))
+            continue;
 
-    uvm_tools_broadcast_replay_sync(gpu, batch_id, fault_entry->fault_source.client_type);
+        gpu->parent->host_hal->clear_faulted_channel_register(user_channel, fault_entry);
+
+        uvm_tools_broadcast_replay_sync(gpu, batch_id, fault_entry->fault_source.client_type);
+    }
 
     return NV_OK;
 }
 
 static NV_STATUS clear_faulted_on_gpu(uvm_gpu_t *gpu,
                                       uvm_user_channel_t *user_channel,
-                                      const uvm_fault_buffer_entry_t *fault_entry,
+                                      uvm_fault_buffer_entry_t **faults,
+                                      NvU32 num_faults,
                                       NvU32 batch_id,
                                       uvm_tracker_t *tracker)
 {
     if (gpu->parent->has_clear_faulted_channel_method || use_clear_faulted_channel_sw_method(gpu))
-        return clear_faulted_method_on_gpu(gpu, user_channel, fault_entry, batch_id, tracker);
+        return clear_faulted_method_on_gpu(gpu, user_channel, faults, num_faults, batch_id, tracker);
 
-    return clear_faulted_register_on_gpu(gpu, user_channel, fault_entry, batch_id, tracker);
+    return clear_faulted_register_on_gpu(gpu, user_channel, faults, num_faults, batch_id, tracker);
 }
 
-static NV_STATUS service_managed_fault_in_block_locked(uvm_gpu_t *gpu,
-                                                       uvm_va_block_t *va_block,
-                                                       uvm_va_block_retry_t *va_block_retry,
-                                                       uvm_fault_buffer_entry_t *fault_entry,
-                                                       uvm_service_block_context_t *service_context)
+// Service all the faults in faults[0..num_faults), which are sorted by address
+// and fall within va_block, with a single call to uvm_va_block_service_locked.
+static NV_STATUS service_managed_faults_in_block_locked(uvm_gpu_t *gpu,
+                                                        uvm_va_block_t *va_block,
+                                                        uvm_va_block_retry_t *va_block_retry,
+                                                        uvm_fault_buffer_entry_t **faults,
+                                                        NvU32 num_faults,
+                                                        uvm_service_block_context_t *service_context)
 {
     NV_STATUS status = NV_OK;
-    uvm_page_index_t page_index;
-    uvm_perf_thrashing_hint_t thrashing_hint;
-    uvm_processor_id_t new_residency;
-    bool read_duplicate;
+    NvU32 i;
+    uvm_page_index_t first_page_index = PAGES_PER_UVM_VA_BLOCK;
+    uvm_page_index_t last_page_index = 0;
+    NvU32 page_fault_count = 0;
     uvm_va_space_t *va_space = uvm_va_block_get_va_space(va_block);
     uvm_va_range_t *va_range = va_block->va_range;
     uvm_non_replayable_fault_buffer_info_t *non_replayable_faults = &gpu->parent->fault_buffer_info.non_replayable;
 
-    UVM_ASSERT(!fault_entry->is_fatal);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
-    uvm_assert_rwsem_locked(&va_space->lock);
-
-    UVM_ASSERT(fault_entry->va_space == va_space);
-    UVM_ASSERT(fault_entry->fault_address >= va_block->start);
-    UVM_ASSERT(fault_entry->fault_address <= va_block->end);
-
-    if (service_context->num_retries == 0) {
-        // notify event to tools/performance heuristics. For now we use a
-        // unique batch id per fault, since we clear the faulted channel for
-        // each fault.
-        uvm_perf_event_notify_gpu_fault(&va_space->perf_events,
-                                        va_block,
-                                        gpu->id,
-                                        fault_entry,
-                                        ++non_replayable_faults->batch_id,
-                                        false);
-    }
+    // Initialize the minimum necessary state in the fault service context
+    uvm_processor_mask_zero(&service_context->resident_processors);
+    service_context->read_duplicate_count = 0;
+    service_context->thrashing_pin_count = 0;
 
-    // Check logical permissions
-    status = uvm_va_range_check_logical_permissions(va_range,
-                                                    gpu->id,
-                                                    fault_entry->fault_access_type,
-                                                    uvm_range_group_address_migratable(va_space,
-                                                                                       fault_entry->fault_address));
-    if (status != NV_OK) {
-        fault_entry->is_fatal = true;
-        fault_entry->fatal_reason = uvm_tools_status_to_fatal_fault_reason(status);
-        return NV_OK;
-    }
+    for (i = 0; i < num_faults; ++i) {
+        uvm_fault_buffer_entry_t *fault_entry = faults[i];
+        uvm_page_index_t page_index;
+        uvm_perf_thrashing_hint_t thrashing_hint;
+        uvm_processor_id_t new_residency;
+        bool read_duplicate;
+        bool is_duplicate = i > 0 && faults[i - 1]->fault_address == fault_entry->fault_address;
+
+        UVM_ASSERT(fault_entry->va_space == va_space);
+        UVM_ASSERT(fault_entry->fault_address >= va_block->start);
+        UVM_ASSERT(fault_entry->fault_address <= va_block->end);
+
+        // Faults that were fatal on arrival are never serviced, and a failed
+        // permission check cannot change while we hold the VA space lock
+        if (fault_entry->is_fatal)
+            continue;
+
+        if (service_context->num_retries == 0) {
+            // notify event to tools/performance heuristics. All the faults of
+            // the channel share the batch id, since the faulted channel is
+            // cleared once for all of them.
+            uvm_perf_event_notify_gpu_fault(&va_space->perf_events,
+                                            va_block,
+                                            gpu->id,
+                                            fault_entry,
+                                            non_replayable_faults->batch_id,
+                                            is_duplicate);
+        }
 
-    // TODO: Bug 1880194: Revisit thrashing detection
-    thrashing_hint.type = UVM_PERF_THRASHING_HINT_TYPE_NONE;
+        // Faults on the same page are sorted by decreasing access type, so
+        // the page has already been serviced with enough permissions if the
+        // previous fault was not fatal
+        if (is_duplicate && !faults[i - 1]->is_fatal)
+            continue;
+
+        // Check logical permissions
+        status = uvm_va_range_check_logical_permissions(va_range,
+                                                        gpu->id,
+                                                        fault_entry->fault_access_type,
+                                                        uvm_range_group_address_migratable(va_space,
+                                                                                           fault_entry->fault_address));
+        if (status != NV_OK) {
+            fault_entry->is_fatal = true;
+            fault_entry->fatal_reason = uvm_tools_status_to_fatal_fault_reason(status);
+            status = NV_OK;
+            continue;
+        }
 
-    service_context->read_duplicate_count = 0;
-    service_context->thrashing_pin_count = 0;
+        // TODO: Bug 1880194: Revisit thrashing detection
+        thrashing_hint.type = UVM_PERF_THRASHING_HINT_TYPE_NONE;
 
-    page_index = uvm_va_block_cpu_page_index(va_block, fault_entry->fault_address);
+        page_index = uvm_va_block_cpu_page_index(va_block, fault_entry->fault_address);
 
-    // Compute new residency and update the masks
-    new_residency = uvm_va_block_select_residency(va_block,
-                                                  page_index,
-                                                  gpu->id,
-                                                  fault_entry->access_type_mask,
-                                                  &thrashing_hint,
-                                                  UVM_SERVICE_OPERATION_NON_REPLAYABLE_FAULTS,
-                                                  &read_duplicate);
+        // Compute new residency and update the masks
+        new_residency = uvm_va_block_select_residency(va_block,
+                                                      page_index,
+                                                      gpu->id,
+                                                      fault_entry->access_type_mask,
+                                                      &thrashing_hint,
+                                                      UVM_SERVICE_OPERATION_NON_REPLAYABLE_FAULTS,
+                                                      &read_duplicate);
 
-    // Initialize the minimum necessary state in the fault service context
-    uvm_processor_mask_zero(&service_context->resident_processors);
+        // The masks need to be fully zeroed as the fault region may grow due
+        // to prefetching
+        if (!uvm_processor_mask_test_and_set(&service_context->resident_processors, new_residency))
+            uvm_page_mask_zero(&service_context->per_processor_masks[uvm_id_value(new_residency)].new_residency);
 
-    // Set new residency and update the masks
-    uvm_processor_mask_set(&service_context->resident_processors, new_residency);
+        uvm_page_mask_set(&service_context->per_processor_masks[uvm_id_value(new_residency)].new_residency, page_index);
 
-    // The masks need to be fully zeroed as the fault region may grow due to prefetching
-    uvm_page_mask_zero(&service_context->per_processor_masks[uvm_id_value(new_residency)].new_residency);
-    uvm_page_mask_set(&service_context->per_processor_masks[uvm_id_value(new_residency)].new_residency, page_index);
+        if (read_duplicate) {
+            if (service_context->read_duplicate_count++ == 0)
+                uvm_page_mask_zero(&service_context->read_duplicate_mask);
 
-    if (read_duplicate) {
-        uvm_page_mask_zero(&service_context->read_duplicate_mask);
-        uvm_page_mask_set(&service_context->read_duplicate_mask, page_index);
-        service_context->read_duplicate_count = 1;
-    }
+            uvm_page_mask_set(&service_context->read_duplicate_mask, page_index);
+        }
 
-    service_context->access_type[page_index] = fault_entry->fault_access_type;
+        service_context->access_type[page_index] = fault_entry->fault_access_type;
 
-    service_context->region = uvm_va_block_region_for_page(page_index);
+        ++page_fault_count;
 
-    status = uvm_va_block_service_locked(gpu->id, va_block, va_block_retry, service_context);
+        if (page_index < first_page_index)
+            first_page_index = page_index;
+        if (page_index > last_page_index)
+            last_page_index = page_index;
+    }
+
+    if (page_fault_count > 0) {
+        service_context->region = uvm_va_block_region(first_page_index, last_page_index + 1);
+        status = uvm_va_block_service_locked(gpu->id, va_block, va_block_retry, service_context);
+    }
 
     ++service_context->num_retries;
 
     return status;
 }
 
-static NV_STATUS service_managed_fault_in_block(uvm_gpu_t *gpu,
-                                                struct mm_struct *mm,
-                                                uvm_va_block_t *va_block,
-                                                uvm_fault_buffer_entry_t *fault_entry)
+static NV_STATUS service_managed_faults_in_block(uvm_gpu_t *gpu,
+                                                 struct mm_struct *mm,
+                                                 uvm_va_block_t *va_block,
+                                                 uvm_fault_buffer_entry_t **faults,
+                                                 NvU32 num_faults)
 {
     NV_STATUS status, tracker_status;
     uvm_va_block_retry_t va_block_retry;
@@ -434,11 +519,12 @@ static NV_STATUS service_managed_fault_in_block(uvm_gpu_t *gpu,
     uvm_mutex_lock(&va_block->lock);
 
     status = UVM_VA_BLOCK_RETRY_LOCKED(va_block, &va_block_retry,
-                                       service_managed_fault_in_block_locked(gpu,
-                                                                             va_block,
-                                                                             &va_block_retry,
-                                                                             fault_entry,
-                                                                             service_context));
+                                       service_managed_faults_in_block_locked(gpu,
+                                                                              va_block,
+                                                                              &va_block_retry,
+                                                                              faults,
+                                                                              num_faults,
+                                                                              service_context));
 
     tracker_status = uvm_tracker_add_tracker_safe(&gpu->parent->fault_buffer_info.non_replayable.fault_service_tracker,
                                                   &va_block->tracker);
@@ -527,17 +613,17 @@ static NV_STATUS service_non_managed_fault(uvm_gpu_va_space_t *gpu_va_space,
                                     NULL,
                                     gpu->id,
                                     fault_entry,
-                                    ++non_replayable_faults->batch_id,
+                                    non_replayable_faults->batch_id,
                                     false);
 
     if (status != NV_ERR_INVALID_ADDRESS)
         return status;
 
     if (uvm_can_ats_service_faults(gpu_va_space, mm)) {
-        ats_invalidate->write_faults_in_batch = false;
+        uvm_ats_fault_batch_begin(ats_invalidate);
 
         // The VA isn't managed. See if ATS knows about it.
-        status = uvm_ats_service_fault_entry(gpu_va_space, fault_entry, ats_invalidate);
+        status = uvm_ats_service_fault_entry(gpu_va_space, fault_entry, NULL, 0, ats_invalidate);
 
         // Invalidate ATS TLB entries if needed
         if (status == NV_OK) {
@@ -558,25 +644,30 @@ static NV_STATUS service_non_managed_fault(uvm_gpu_va_space_t *gpu_va_space,
     return status;
 }
 
-static NV_STATUS service_fault(uvm_gpu_t *gpu, uvm_fault_buffer_entry_t *fault_entry)
+// Service the faults in faults[0..num_faults), which share the instance
+// pointer and are sorted by address. The VA space lock is taken and the
+// channel is looked up once for all of them, and the faulted bit of the
+// channel is cleared once they have all been serviced.
+static NV_STATUS service_channel_faults(uvm_gpu_t *gpu, uvm_fault_buffer_entry_t **faults, NvU32 num_faults)
 {
     NV_STATUS status;
+    NvU32 i;
     uvm_user_channel_t *user_channel;
-    uvm_va_block_t *va_block;
     uvm_va_space_t *va_space = NULL;
     struct mm_struct *mm;
     uvm_gpu_va_space_t *gpu_va_space;
+    uvm_fault_buffer_entry_t *kill_fault_entry = NULL;
     uvm_non_replayable_fault_buffer_info_t *non_replayable_faults = &gpu->parent->fault_buffer_info.non_replayable;
 
-    status = uvm_gpu_fault_entry_to_va_space(gpu, fault_entry, &va_space);
+    status = uvm_gpu_fault_entry_to_va_space(gpu, faults[0], &va_space);
     if (status != NV_OK) {
         // The VA space lookup will fail if we're running concurrently with
         // removal of the channel from the VA space (channel unregister, GPU VA
         // space unregister, VA space destroy, etc). The other thread will stop
         // the channel and remove the channel from the table, so the faulting
         // condition will be gone. In the case of replayable faults we need to
-        // flush the buffer, but here we can just ignore the entry and proceed
-        // on.
+        // flush the buffer, but here we can just ignore the entries and
+        // proceed on.
         //
         // Note that we can't have any subcontext issues here, since non-
         // replayable faults only use the address space of their channel.
@@ -589,9 +680,10 @@ static NV_STATUS service_fault(uvm_gpu_t *gpu, uvm_fault_buffer_entry_t *fault_e
 
     // If an mm is registered with the VA space, we have to retain it
     // in order to lock it before locking the VA space. It is guaranteed
-    // to remain valid until we release. If no mm is registered, we
-    // can only service managed faults, not ATS/HMM faults.
-    mm = uvm_va_space_mm_retain_lock(va_space);
+    // to remain valid until the retention cache is flushed at the end of the
+    // bottom half. If no mm is registered, we can only service managed faults,
+    // not ATS/HMM faults.
+    mm = uvm_va_space_mm_cached_retain_lock(&non_replayable_faults->mm_retain_cache, va_space);
 
     uvm_va_space_down_read(va_space);
 
@@ -603,53 +695,120 @@ static NV_STATUS service_fault(uvm_gpu_t *gpu, uvm_fault_buffer_entry_t *fault_e
         goto exit_no_channel;
     }
 
-    fault_entry->va_space = va_space;
-
-    user_channel = uvm_gpu_va_space_get_user_channel(gpu_va_space, fault_entry->instance_ptr);
+    user_channel = uvm_gpu_va_space_get_user_channel(gpu_va_space, faults[0]->instance_ptr);
     if (!user_channel) {
         // The channel might have gone away. See the comment above.
         status = NV_OK;
         goto exit_no_channel;
     }
 
-    fault_entry->fault_source.channel_id = user_channel->hw_channel_id;
+    for (i = 0; i < num_faults; ++i) {
+        faults[i]->va_space = va_space;
+        faults[i]->fault_source.channel_id = user_channel->hw_channel_id;
+    }
 
-    if (!fault_entry->is_fatal) {
-        status = uvm_va_block_find_create(fault_entry->va_space, mm, fault_entry->fault_address, &va_block);
-        if (status == NV_OK)
-            status = service_managed_fault_in_block(gpu_va_space->gpu, mm, va_block, fault_entry);
-        else
+    // A unique batch id per channel, since the faulted channel is cleared
+    // once for all its faults
+    ++non_replayable_faults->batch_id;
+
+    i = 0;
+    while (i < num_faults) {
+        uvm_fault_buffer_entry_t *fault_entry = faults[i];
+        uvm_va_block_t *va_block;
+        NvU32 block_faults;
+
+        if (fault_entry->is_fatal) {
+            ++i;
+            continue;
+        }
+
+        status = uvm_va_block_find_create(va_space, mm, fault_entry->fault_address, &va_block);
+        if (status == NV_OK) {
+            // Faults are sorted by address, so all the faults in the block
+            // are contiguous
+            for (block_faults = 1;
+                 i + block_faults < num_faults && faults[i + block_faults]->fault_address <= va_block->end;
+                 ++block_faults)
+                ;
+
+            status = service_managed_faults_in_block(gpu_va_space->gpu, mm, va_block, faults + i, block_faults);
+        }
+        else {
+            block_faults = 1;
             status = service_non_managed_fault(gpu_va_space, mm, fault_entry, status);
+        }
 
-        // We are done, we clear the faulted bit on the channel, so it can be
-        // re-scheduled again
-        if (status == NV_OK && !fault_entry->is_fatal) {
-            status = clear_faulted_on_gpu(gpu,
-                                          user_channel,
-                                          fault_entry,
-                                          non_replayable_faults->batch_id,
-                                          &non_replayable_faults->fault_service_tracker);
-            uvm_tracker_clear(&non_replayable_faults->fault_service_tracker);
+        if (status != NV_OK) {
+            kill_fault_entry = fault_entry;
+            break;
         }
+
+        i += block_faults;
+    }
+
+    for (i = 0; i < num_faults; ++i) {
+        uvm_fault_buffer_entry_t *fault_entry = faults[i];
+
+        if (!fault_entry->is_fatal)
+            continue;
+
+        uvm_tools_record_gpu_fatal_fault(gpu->parent->id, va_space, fault_entry, fault_entry->fatal_reason);
+
+        if (!kill_fault_entry)
+            kill_fault_entry = fault_entry;
     }
 
-    if (fault_entry->is_fatal)
-        uvm_tools_record_gpu_fatal_fault(gpu->parent->id, fault_entry->va_space, fault_entry, fault_entry->fatal_reason);
+    // We are done, we clear the faulted bit on the channel, so it can be
+    // re-scheduled again. Channels with fatal faults are killed instead.
+    if (!kill_fault_entry) {
+        status = clear_faulted_on_gpu(gpu,
+                                      user_channel,
+                                      faults,
+                                      num_faults,
+                                      non_replayable_faults->batch_id,
+                                      &non_replayable_faults->fault_service_tracker);
+        uvm_tracker_clear(&non_replayable_faults->fault_service_tracker);
+
+        if (status != NV_OK)
+            kill_fault_entry = faults[0];
+    }
 
-    if (status != NV_OK || fault_entry->is_fatal)
-        schedule_kill_channel(gpu, fault_entry, user_channel);
+    if (kill_fault_entry)
+        schedule_kill_channel(gpu, kill_fault_entry, user_channel);
 
 exit_no_channel:
     uvm_va_space_up_read(va_space);
-    uvm_va_space_mm_release_unlock(va_space, mm);
+    uvm_va_space_mm_cached_unlock(mm);
 
     return status;
 }
 
+static int cmp_sort_fault_entry_by_instance_ptr_addr(const void *_a, const void *_b)
+{
+    const uvm_fault_buffer_entry_t *a = *(const uvm_fault_buffer_entry_t **)_a;
+    const uvm_fault_buffer_entry_t *b = *(const uvm_fault_buffer_entry_t **)_b;
+    uvm_fault_access_type_t access_type_a = a->fault_access_type;
+    uvm_fault_access_type_t access_type_b = b->fault_access_type;
+    int result;
+
+    result = uvm_gpu_phys_addr_cmp(a->instance_ptr, b->instance_ptr);
+    if (result != 0)
+        return result;
+
+    result = UVM_CMP_DEFAULT(a->fault_address, b->fault_address);
+    if (result != 0)
+        return result;
+
+    // On the same page, the most intrusive access goes first
+    return UVM_CMP_DEFAULT(access_type_b, access_type_a);
+}
+
 void uvm_gpu_service_non_replayable_fault_buffer(uvm_gpu_t *gpu)
 {
     NV_STATUS status = NV_OK;
     NvU32 cached_faults;
+    uvm_non_replayable_fault_buffer_info_t *non_replayable_faults = &gpu->parent->fault_buffer_info.non_replayable;
+    uvm_fault_buffer_entry_t **ordered_fault_cache = non_replayable_faults->ordered_fault_cache;
 
     // If this handler is modified to handle fewer than all of the outstanding
     // faults, then special handling will need to be added to uvm_suspend()
@@ -657,17 +816,37 @@ void uvm_gpu_service_non_replayable_fault_buffer(uvm_gpu_t *gpu)
     // returned to the RM.
     while ((cached_faults = fetch_non_replayable_fault_buffer_entries(gpu)) > 0) {
         NvU32 i;
-
-        // Differently to replayable faults, we do not batch up and preprocess
-        // non-replayable faults since getting multiple faults on the same
-        // memory region is not very likely
-        for (i = 0; i < cached_faults; ++i) {
-            status = service_fault(gpu, &gpu->parent->fault_buffer_info.non_replayable.fault_cache[i]);
+        NvU32 first;
+
+        // Sort the faults so that all the faults of a channel are serviced
+        // with a single VA space lookup and a single clear of the faulted
+        // bit, and faults on the same VA block are serviced together
+        for (i = 0; i < cached_faults; ++i)
+            ordered_fault_cache[i] = &non_replayable_faults->fault_cache[i];
+
+        sort(ordered_fault_cache,
+             cached_faults,
+             sizeof(*ordered_fault_cache),
+             cmp_sort_fault_entry_by_instance_ptr_addr,
+             NULL);
+
+        for (first = 0; first < cached_faults; first = i) {
+            for (i = first + 1;
+                 i < cached_faults &&
+                 uvm_gpu_phys_addr_cmp(ordered_fault_cache[i]->instance_ptr,
+                                       ordered_fault_cache[first]->instance_ptr) == 0;
+                 ++i)
+                ;
+
+            status = service_channel_faults(gpu, ordered_fault_cache + first, i - first);
             if (status != NV_OK)
                 break;
         }
     }
 
+    // Don't keep the mm retained while idle, as that would block its shutdown
+    uvm_va_space_mm_retain_cache_flush(&non_replayable_faults->mm_retain_cache);
+
     if (status != NV_OK)
         UVM_DBG_PRINT("Error servicing non-replayable faults on GPU: %s\n", uvm_gpu_name(gpu));
 }
@@ -22,13 +22,16 @@
 *******************************************************************************/
 
 #include "linux/sort.h"
+#include "linux/hash.h"
 #include "nv_uvm_interface.h"
 #include "uvm_linux.h"
+#include "uvm_api.h"
 #include "uvm_global.h"
 #include "uvm_gpu_replayable_faults.h"
 #include "uvm_hal.h"
 #include "uvm_kvmalloc.h"
 #include "uvm_tools.h"
+#include "uvm_trace.h"
 #include "uvm_va_block.h"
 #include "uvm_va_range.h"
 #include "uvm_va_space.h"
@@ -39,6 +42,7 @@
 #include "uvm_ats_ibm.h"
 #include "uvm_ats_faults.h"
 #include "uvm_test.h"
+#include "uvm_test_rng.h"
 
 // The documentation at the beginning of uvm_gpu_non_replayable_faults.c
 // provides some background for understanding replayable faults, non-replayable
@@ -97,6 +101,189 @@ module_param(uvm_perf_fault_max_throttle_per_service, uint, S_IRUGO);
 static unsigned uvm_perf_fault_coalesce = 1;
 module_param(uvm_perf_fault_coalesce, uint, S_IRUGO);
 
+// Coalesce duplicate faults that are not adjacent in the fault buffer, by
+// looking up every fetched fault in a hash set of the faults already fetched
+// in the batch. Only used if uvm_perf_fault_coalesce is enabled.
+static unsigned uvm_perf_fault_coalesce_hash = 1;
+module_param(uvm_perf_fault_coalesce_hash, uint, S_IRUGO);
+
+// Number of slots probed in the coalescing hash set. Faults that do not find
+// a slot are not coalesced with later duplicates.
+#define UVM_FAULT_COALESCE_HASH_MAX_PROBES 8
+
+// Sort the fault batch with a LSD radix sort over packed integer keys instead
+// of comparator-based sort() calls. Batches smaller than
+// UVM_FAULT_RADIX_SORT_MIN_FAULTS, or whose keys do not fit in 64 bits, are
+// still sorted with sort().
+static unsigned uvm_perf_fault_radix_sort = 1;
+module_param(uvm_perf_fault_radix_sort, uint, S_IRUGO);
+
+#define UVM_FAULT_RADIX_SORT_MIN_FAULTS 32
+
+// Digits of the radix sort
+#define UVM_FAULT_RADIX_SORT_DIGIT_BITS 8
+#define UVM_FAULT_RADIX_SORT_DIGIT_COUNT (1 << UVM_FAULT_RADIX_SORT_DIGIT_BITS)
+
+// Maximum number of distinct VA spaces in a batch sorted by
+// (VA space, address, access type) keys. The rank of the VA space takes the
+// top bits of the key.
+#define UVM_FAULT_RADIX_SORT_VA_SPACE_BITS 4
+#define UVM_FAULT_RADIX_SORT_MAX_VA_SPACES (1 << UVM_FAULT_RADIX_SORT_VA_SPACE_BITS)
+
+// Maximum number of faults serviced per batch from a VA space, per unit of its
+// fault service weight, when the batch contains faults from several VA spaces.
+// The limit is checked before each VA block, so it can be exceeded by the
+// faults of one block. 0 disables the limit.
+static unsigned uvm_perf_fault_batch_faults_per_weight = 0;
+module_param(uvm_perf_fault_batch_faults_per_weight, uint, S_IRUGO);
+
+#define UVM_PERF_FAULT_SERVICE_WORKERS_DEFAULT 0
+#define UVM_PERF_FAULT_SERVICE_WORKERS_MAX 16
+
+// Number of additional kthreads per GPU used to service the VA blocks of a
+// fault batch in parallel with the bottom half. Faults in different VA blocks
+// only contend on the VA space lock, which is held in read mode during
+// servicing, so each block can be serviced independently. 0 means that all
+// the blocks in the batch are serviced serially by the bottom half. Parallel
+// servicing is not used with UVM_PERF_FAULT_REPLAY_POLICY_BLOCK, since that
+// policy requires a replay after each VA block.
+static unsigned uvm_perf_fault_service_workers = UVM_PERF_FAULT_SERVICE_WORKERS_DEFAULT;
+module_param(uvm_perf_fault_service_workers, uint, S_IRUGO);
+
+// Maximum number of VA block groups that each participant of a parallel
+// dispatch can set aside because their block lock is held by somebody else
+// (i.e. the bottom half of another GPU faulting on the same block). Deferred
+// groups are serviced once there are no more groups left to pick up.
+#define UVM_FAULT_SERVICE_MAX_DEFERRED_GROUPS 16
+
+#define UVM_PERF_FAULT_BATCH_ADAPTIVE_DEFAULT 0
+#define UVM_PERF_FAULT_BATCH_ADAPTIVE_TARGET_USEC_DEFAULT 1000
+
+// Adapt the number of faults fetched per batch to the observed fault traffic,
+// between uvm_perf_fault_batch_count / 4 and the size of the fault buffer. The
+// batch size grows when batches are full and the fault buffer still contains
+// at least another batch worth of faults, and shrinks when bursts are much
+// smaller than the batch or batches take longer than
+// uvm_perf_fault_batch_adaptive_target_usec to be serviced. The controller
+// also switches between the BATCH and BATCH_FLUSH replay policies depending on
+// the ratio of duplicate faults, if one of those policies is selected.
+// uvm_perf_fault_max_batches_per_service becomes a limit on the number of
+// faults fetched per service, in units of uvm_perf_fault_batch_count.
+static unsigned uvm_perf_fault_batch_adaptive = UVM_PERF_FAULT_BATCH_ADAPTIVE_DEFAULT;
+module_param(uvm_perf_fault_batch_adaptive, uint, S_IRUGO);
+
+static unsigned uvm_perf_fault_batch_adaptive_target_usec = UVM_PERF_FAULT_BATCH_ADAPTIVE_TARGET_USEC_DEFAULT;
+module_param(uvm_perf_fault_batch_adaptive_target_usec, uint, S_IRUGO);
+
+// Number of consecutive batches below 1/4 of the batch size that trigger a
+// shrink
+#define UVM_PERF_FAULT_BATCH_ADAPTIVE_SMALL_BATCHES 8
+
+// Hysteresis thresholds on the average ratio of duplicate faults to switch
+// between BATCH_FLUSH and BATCH. Flushing the buffer before the replay
+// discards duplicates that would otherwise show up again after the replay.
+#define UVM_PERF_FAULT_BATCH_ADAPTIVE_FLUSH_DUPLICATE_RATIO 25
+#define UVM_PERF_FAULT_BATCH_ADAPTIVE_NO_FLUSH_DUPLICATE_RATIO 10
+
+static void fault_service_worker_entry(void *args);
+
+static NV_STATUS init_service_worker_queue(nv_kthread_q_t *queue, const char *name, int node)
+{
+#if UVM_THREAD_AFFINITY_SUPPORTED()
+    if (node != -1 && !cpumask_empty(uvm_cpumask_of_node(node))) {
+        NV_STATUS status;
+
+        status = errno_to_nv_status(nv_kthread_q_init_on_node(queue, name, node));
+        if (status != NV_OK)
+            return status;
+
+        return errno_to_nv_status(set_cpus_allowed_ptr(queue->q_kthread, uvm_cpumask_of_node(node)));
+    }
+#endif
+
+    return errno_to_nv_status(nv_kthread_q_init(queue, name));
+}
+
+// There is no error handling in this function. The caller is in charge of
+// calling fault_service_workers_deinit on failure.
+static NV_STATUS fault_service_workers_init(uvm_parent_gpu_t *parent_gpu)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+    NvU32 num_workers = min(uvm_perf_fault_service_workers, (unsigned)UVM_PERF_FAULT_SERVICE_WORKERS_MAX);
+    NvU32 i;
+
+    if (num_workers != uvm_perf_fault_service_workers) {
+        pr_info("Invalid uvm_perf_fault_service_workers value on GPU %s: %u. Valid range [0:%u] Using %u instead\n",
+                parent_gpu->name,
+                uvm_perf_fault_service_workers,
+                UVM_PERF_FAULT_SERVICE_WORKERS_MAX,
+                num_workers);
+    }
+
+    if (num_workers == 0)
+        return NV_OK;
+
+    replayable_faults->service_workers.groups =
+        uvm_kvmalloc_zero_node(replayable_faults->max_faults * sizeof(*replayable_faults->service_workers.groups),
+                               parent_gpu->closest_cpu_numa_node);
+    if (!replayable_faults->service_workers.groups)
+        return NV_ERR_NO_MEMORY;
+
+    replayable_faults->service_workers.workers =
+        uvm_kvmalloc_zero_node(num_workers * sizeof(*replayable_faults->service_workers.workers),
+                               parent_gpu->closest_cpu_numa_node);
+    if (!replayable_faults->service_workers.workers)
+        return NV_ERR_NO_MEMORY;
+
+    for (i = 0; i < num_workers; ++i) {
+        uvm_fault_service_worker_t *worker = &replayable_faults->service_workers.workers[i];
+        char kthread_name[TASK_COMM_LEN + 1];
+        NV_STATUS status;
+
+        worker->parent_gpu = parent_gpu;
+        uvm_tracker_init(&worker->batch_context.tracker);
+        init_completion(&worker->done);
+        nv_kthread_q_item_init(&worker->q_item, fault_service_worker_entry, worker);
+
+        // Count the worker before initializing the queue so that deinit stops
+        // it on failure. nv_kthread_q_stop ignores uninitialized queues.
+        replayable_faults->service_workers.num_workers = i + 1;
+
+        snprintf(kthread_name, sizeof(kthread_name), "UVM GPU%u FW%u", uvm_id_value(parent_gpu->id), i);
+        status = init_service_worker_queue(&worker->q, kthread_name, parent_gpu->closest_cpu_numa_node);
+        if (status != NV_OK) {
+            UVM_ERR_PRINT("Failed in nv_kthread_q_init for fault service worker %u: %s, GPU %s\n",
+                          i,
+                          nvstatusToString(status),
+                          parent_gpu->name);
+            return status;
+        }
+    }
+
+    return NV_OK;
+}
+
+static void fault_service_workers_deinit(uvm_parent_gpu_t *parent_gpu)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+    NvU32 i;
+
+    for (i = 0; i < replayable_faults->service_workers.num_workers; ++i) {
+        uvm_fault_service_worker_t *worker = &replayable_faults->service_workers.workers[i];
+
+        nv_kthread_q_stop(&worker->q);
+
+        UVM_ASSERT(uvm_tracker_is_empty(&worker->batch_context.tracker));
+        uvm_tracker_deinit(&worker->batch_context.tracker);
+    }
+
+    uvm_kvfree(replayable_faults->service_workers.workers);
+    uvm_kvfree(replayable_faults->service_workers.groups);
+    replayable_faults->service_workers.workers     = NULL;
+    replayable_faults->service_workers.groups      = NULL;
+    replayable_faults->service_workers.num_workers = 0;
+}
+
 // This function is used for both the initial fault buffer initialization and
 // the power management resume path.
 static void fault_buffer_reinit_replayable_faults(uvm_parent_gpu_t *parent_gpu)
@@ -117,6 +304,120 @@ static void fault_buffer_reinit_replayable_faults(uvm_parent_gpu_t *parent_gpu)
         parent_gpu->arch_hal->disable_prefetch_faults(parent_gpu);
 }
 
+static void fault_batch_adaptive_init(uvm_parent_gpu_t *parent_gpu)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+    NvU32 batch_size = parent_gpu->fault_buffer_info.max_batch_size;
+
+    memset(&replayable_faults->adaptive, 0, sizeof(replayable_faults->adaptive));
+
+    replayable_faults->adaptive.enabled = uvm_perf_fault_batch_adaptive != 0;
+    if (!replayable_faults->adaptive.enabled)
+        return;
+
+    replayable_faults->adaptive.adapt_replay_policy =
+        replayable_faults->replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH ||
+        replayable_faults->replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH;
+
+    replayable_faults->adaptive.min_batch_size = max(batch_size / 4, (NvU32)UVM_PERF_FAULT_BATCH_COUNT_MIN);
+    replayable_faults->adaptive.max_batch_size = replayable_faults->max_faults;
+
+    replayable_faults->adaptive.max_faults_per_service = batch_size * max(uvm_perf_fault_max_batches_per_service, 1u);
+}
+
+static NvU64 fault_batch_adaptive_avg(NvU64 avg, NvU64 sample)
+{
+    return avg - (avg >> UVM_PERF_FAULT_BATCH_ADAPTIVE_AVG_SHIFT) + (sample >> UVM_PERF_FAULT_BATCH_ADAPTIVE_AVG_SHIFT);
+}
+
+// Update the moving averages with the samples from the last serviced batch, and
+// adjust the batch size and the replay policy for the next batches.
+static void fault_batch_adaptive_update(uvm_parent_gpu_t *parent_gpu,
+                                        uvm_fault_service_batch_context_t *batch_context,
+                                        NvU64 service_time_ns)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+    NvU32 batch_size = parent_gpu->fault_buffer_info.max_batch_size;
+    NvU64 target_ns = (NvU64)uvm_perf_fault_batch_adaptive_target_usec * 1000;
+    NvU32 num_pending;
+    NvU32 occupancy;
+    NvU32 duplicate_ratio;
+
+    if (!replayable_faults->adaptive.enabled || batch_context->num_cached_faults == 0)
+        return;
+
+    // Entries that were left in the buffer by the last fetch. The cached PUT
+    // is used to avoid reading the register, so this is a lower bound.
+    if (replayable_faults->cached_put >= replayable_faults->cached_get)
+        num_pending = replayable_faults->cached_put - replayable_faults->cached_get;
+    else
+        num_pending = replayable_faults->max_faults - replayable_faults->cached_get + replayable_faults->cached_put;
+
+    occupancy = ((batch_context->num_cached_faults + num_pending) * 100) / replayable_faults->max_faults;
+    duplicate_ratio = (batch_context->num_duplicate_faults * 100) / batch_context->num_cached_faults;
+
+    // Percentages are kept scaled by 2^shift to not lose precision on small
+    // samples. The averages are seeded with the first sample.
+    occupancy <<= UVM_PERF_FAULT_BATCH_ADAPTIVE_AVG_SHIFT;
+    duplicate_ratio <<= UVM_PERF_FAULT_BATCH_ADAPTIVE_AVG_SHIFT;
+    if (replayable_faults->adaptive.avg_service_time_ns == 0) {
+        replayable_faults->adaptive.avg_occupancy       = occupancy;
+        replayable_faults->adaptive.avg_duplicate_ratio = duplicate_ratio;
+        replayable_faults->adaptive.avg_service_time_ns = service_time_ns;
+    }
+    else {
+        replayable_faults->adaptive.avg_occupancy =
+            (NvU32)fault_batch_adaptive_avg(replayable_faults->adaptive.avg_occupancy, occupancy);
+        replayable_faults->adaptive.avg_duplicate_ratio =
+            (NvU32)fault_batch_adaptive_avg(replayable_faults->adaptive.avg_duplicate_ratio, duplicate_ratio);
+        replayable_faults->adaptive.avg_service_time_ns =
+            fault_batch_adaptive_avg(replayable_faults->adaptive.avg_service_time_ns, service_time_ns);
+    }
+
+    // 0 is used to detect the first sample
+    replayable_faults->adaptive.avg_service_time_ns = max(replayable_faults->adaptive.avg_service_time_ns, 1ull);
+
+    if (batch_context->num_cached_faults < batch_size / 4)
+        ++replayable_faults->adaptive.num_small_batches;
+    else
+        replayable_faults->adaptive.num_small_batches = 0;
+
+    if (batch_context->num_cached_faults >= batch_size &&
+        num_pending >= batch_size &&
+        replayable_faults->adaptive.avg_service_time_ns <= target_ns &&
+        batch_size < replayable_faults->adaptive.max_batch_size) {
+        // Streaming burst: fetch more faults per batch to amortize the replay
+        batch_size = min(batch_size * 2, replayable_faults->adaptive.max_batch_size);
+        ++replayable_faults->adaptive.num_grows;
+    }
+    else if ((replayable_faults->adaptive.avg_service_time_ns > 2 * target_ns ||
+              replayable_faults->adaptive.num_small_batches >= UVM_PERF_FAULT_BATCH_ADAPTIVE_SMALL_BATCHES) &&
+             batch_size > replayable_faults->adaptive.min_batch_size) {
+        // Batches take too long, or bursts are small: replay sooner
+        batch_size = max(batch_size / 2, replayable_faults->adaptive.min_batch_size);
+        replayable_faults->adaptive.num_small_batches = 0;
+        ++replayable_faults->adaptive.num_shrinks;
+    }
+
+    parent_gpu->fault_buffer_info.max_batch_size = batch_size;
+
+    if (replayable_faults->adaptive.adapt_replay_policy) {
+        NvU32 avg_duplicate_ratio = replayable_faults->adaptive.avg_duplicate_ratio >>
+                                    UVM_PERF_FAULT_BATCH_ADAPTIVE_AVG_SHIFT;
+        uvm_perf_fault_replay_policy_t replay_policy = replayable_faults->replay_policy;
+
+        if (avg_duplicate_ratio >= UVM_PERF_FAULT_BATCH_ADAPTIVE_FLUSH_DUPLICATE_RATIO)
+            replay_policy = UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH;
+        else if (avg_duplicate_ratio < UVM_PERF_FAULT_BATCH_ADAPTIVE_NO_FLUSH_DUPLICATE_RATIO)
+            replay_policy = UVM_PERF_FAULT_REPLAY_POLICY_BATCH;
+
+        if (replay_policy != replayable_faults->replay_policy) {
+            replayable_faults->replay_policy = replay_policy;
+            ++replayable_faults->adaptive.num_replay_policy_changes;
+        }
+    }
+}
+
 // There is no error handling in this function. The caller is in charge of
 // calling fault_buffer_deinit_replayable_faults on failure.
 static NV_STATUS fault_buffer_init_replayable_faults(uvm_parent_gpu_t *parent_gpu)
@@ -146,27 +447,64 @@ static NV_STATUS fault_buffer_init_replayable_faults(uvm_parent_gpu_t *parent_gp
                 parent_gpu->fault_buffer_info.max_batch_size);
     }
 
-    batch_context->fault_cache = uvm_kvmalloc_zero(replayable_faults->max_faults * sizeof(*batch_context->fault_cache));
+    batch_context->fault_cache = uvm_kvmalloc_zero_node(replayable_faults->max_faults * sizeof(*batch_context->fault_cache),
+                                                        parent_gpu->closest_cpu_numa_node);
     if (!batch_context->fault_cache)
         return NV_ERR_NO_MEMORY;
 
     // fault_cache is used to signal that the tracker was initialized.
     uvm_tracker_init(&replayable_faults->replay_tracker);
 
-    batch_context->ordered_fault_cache = uvm_kvmalloc_zero(replayable_faults->max_faults *
-                                                           sizeof(*batch_context->ordered_fault_cache));
+    batch_context->ordered_fault_cache = uvm_kvmalloc_zero_node(replayable_faults->max_faults *
+                                                                sizeof(*batch_context->ordered_fault_cache),
+                                                                parent_gpu->closest_cpu_numa_node);
     if (!batch_context->ordered_fault_cache)
         return NV_ERR_NO_MEMORY;
 
+    replayable_faults->replay_latency.fault_timestamps =
+        uvm_kvmalloc_node(replayable_faults->max_faults * sizeof(*replayable_faults->replay_latency.fault_timestamps),
+                          parent_gpu->closest_cpu_numa_node);
+    if (!replayable_faults->replay_latency.fault_timestamps)
+        return NV_ERR_NO_MEMORY;
+
     // This value must be initialized by HAL
     UVM_ASSERT(replayable_faults->utlb_count > 0);
 
-    batch_context->utlbs = uvm_kvmalloc_zero(replayable_faults->utlb_count * sizeof(*batch_context->utlbs));
+    batch_context->utlbs = uvm_kvmalloc_zero_node(replayable_faults->utlb_count * sizeof(*batch_context->utlbs),
+                                                  parent_gpu->closest_cpu_numa_node);
     if (!batch_context->utlbs)
         return NV_ERR_NO_MEMORY;
 
     batch_context->max_utlb_id = 0;
 
+    batch_context->coalesce_hash.mask = roundup_pow_of_two(2 * replayable_faults->max_faults) - 1;
+    batch_context->coalesce_hash.slots = uvm_kvmalloc_zero_node((batch_context->coalesce_hash.mask + 1) *
+                                                                sizeof(*batch_context->coalesce_hash.slots),
+                                                                parent_gpu->closest_cpu_numa_node);
+    if (!batch_context->coalesce_hash.slots)
+        return NV_ERR_NO_MEMORY;
+
+    // Zeroed slots belong to generation 0
+    batch_context->coalesce_hash.generation = 0;
+
+    batch_context->radix_sort.keys = uvm_kvmalloc_node(2 * replayable_faults->max_faults *
+                                                       sizeof(*batch_context->radix_sort.keys),
+                                                       parent_gpu->closest_cpu_numa_node);
+    if (!batch_context->radix_sort.keys)
+        return NV_ERR_NO_MEMORY;
+
+    batch_context->radix_sort.tmp_keys = batch_context->radix_sort.keys + replayable_faults->max_faults;
+
+    batch_context->radix_sort.tmp_entries = uvm_kvmalloc_node(replayable_faults->max_faults *
+                                                              sizeof(*batch_context->radix_sort.tmp_entries),
+                                                              parent_gpu->closest_cpu_numa_node);
+    if (!batch_context->radix_sort.tmp_entries)
+        return NV_ERR_NO_MEMORY;
+
+    status = fault_service_workers_init(parent_gpu);
+    if (status != NV_OK)
+        return status;
+
     status = uvm_rm_locked_call(nvUvmInterfaceOwnPageFaultIntr(parent_gpu->rm_device, NV_TRUE));
     if (status != NV_OK) {
         UVM_ERR_PRINT("Failed to take page fault ownership from RM: %s, GPU %s\n",
@@ -186,6 +524,8 @@ static NV_STATUS fault_buffer_init_replayable_faults(uvm_parent_gpu_t *parent_gp
                 replayable_faults->replay_policy);
     }
 
+    fault_batch_adaptive_init(parent_gpu);
+
     replayable_faults->replay_update_put_ratio = min(uvm_perf_fault_replay_update_put_ratio, 100u);
     if (replayable_faults->replay_update_put_ratio != uvm_perf_fault_replay_update_put_ratio) {
         pr_info("Invalid uvm_perf_fault_replay_update_put_ratio value on GPU %s: %u. Using %u instead\n",
@@ -207,6 +547,8 @@ static void fault_buffer_deinit_replayable_faults(uvm_parent_gpu_t *parent_gpu)
     uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
     uvm_fault_service_batch_context_t *batch_context = &replayable_faults->batch_service_context;
 
+    fault_service_workers_deinit(parent_gpu);
+
     if (batch_context->fault_cache) {
         UVM_ASSERT(uvm_tracker_is_empty(&replayable_faults->replay_tracker));
         uvm_tracker_deinit(&replayable_faults->replay_tracker);
@@ -218,12 +560,23 @@ static void fault_buffer_deinit_replayable_faults(uvm_parent_gpu_t *parent_gpu)
             parent_gpu->arch_hal->enable_prefetch_faults(parent_gpu);
     }
 
+    UVM_ASSERT(!replayable_faults->replay_latency.pending);
+    uvm_kvfree(replayable_faults->replay_latency.fault_timestamps);
+    replayable_faults->replay_latency.fault_timestamps = NULL;
+
     uvm_kvfree(batch_context->fault_cache);
     uvm_kvfree(batch_context->ordered_fault_cache);
     uvm_kvfree(batch_context->utlbs);
-    batch_context->fault_cache         = NULL;
-    batch_context->ordered_fault_cache = NULL;
-    batch_context->utlbs               = NULL;
+    uvm_kvfree(batch_context->coalesce_hash.slots);
+    uvm_kvfree(batch_context->radix_sort.keys);
+    uvm_kvfree(batch_context->radix_sort.tmp_entries);
+    batch_context->fault_cache            = NULL;
+    batch_context->ordered_fault_cache    = NULL;
+    batch_context->utlbs                  = NULL;
+    batch_context->coalesce_hash.slots    = NULL;
+    batch_context->radix_sort.keys        = NULL;
+    batch_context->radix_sort.tmp_keys    = NULL;
+    batch_context->radix_sort.tmp_entries = NULL;
 }
 
 NV_STATUS uvm_gpu_fault_buffer_init(uvm_parent_gpu_t *parent_gpu)
@@ -473,6 +826,62 @@ static NV_STATUS cancel_fault_precise_va(uvm_gpu_t *gpu,
     return status;
 }
 
+void uvm_gpu_fault_replay_latency_complete(uvm_fault_replay_latency_t *replay_latency)
+{
+    NvU64 replay_time = *replay_latency->replay_timestamp;
+    NvU32 i;
+
+    UVM_ASSERT(replay_latency->pending);
+
+    for (i = 0; i < replay_latency->num_faults; ++i) {
+        NvU64 fault_time = replay_latency->fault_timestamps[i];
+        NvU64 latency_ns = replay_time > fault_time ? replay_time - fault_time : 0;
+        NvU32 bucket = latency_ns ? min((NvU32)ilog2(latency_ns), (NvU32)(UVM_FAULT_SERVICE_LATENCY_BUCKETS - 1)) : 0;
+
+        replay_latency->total_ns += latency_ns;
+        replay_latency->max_ns = max(replay_latency->max_ns, latency_ns);
+        ++replay_latency->buckets[bucket];
+    }
+
+    replay_latency->count += replay_latency->num_faults;
+
+    // Hand the sample fields back to the bottom half
+    smp_store_release(&replay_latency->pending, false);
+}
+
+// Sample the latency between the faults of the batch and the replay being
+// pushed. The faults of a batch are attributed to its first sampled replay,
+// and the replay is not sampled if the previous sample is still in flight.
+static void fault_replay_latency_sample(uvm_push_t *push, uvm_fault_service_batch_context_t *batch_context)
+{
+    uvm_gpu_t *gpu = uvm_push_get_gpu(push);
+    uvm_fault_replay_latency_t *replay_latency = &gpu->parent->fault_buffer_info.replayable.replay_latency;
+    NvU32 i;
+
+    if (!uvm_procfs_is_debug_enabled())
+        return;
+
+    // Synthetic faults don't carry GPU timestamps
+    if (batch_context->is_synthetic || batch_context->num_cached_faults == 0)
+        return;
+
+    if (replay_latency->sampled_batch_id == batch_context->batch_id)
+        return;
+
+    if (smp_load_acquire(&replay_latency->pending))
+        return;
+
+    for (i = 0; i < batch_context->num_cached_faults; ++i)
+        replay_latency->fault_timestamps[i] = batch_context->fault_cache[i].timestamp;
+
+    replay_latency->num_faults = batch_context->num_cached_faults;
+    replay_latency->sampled_batch_id = batch_context->batch_id;
+    replay_latency->replay_timestamp = uvm_push_timestamp(push);
+    replay_latency->pending = true;
+
+    uvm_push_info_from_push(push)->replay_latency = replay_latency;
+}
+
 static NV_STATUS push_replay_on_gpu(uvm_gpu_t *gpu, uvm_fault_replay_type_t type, uvm_fault_service_batch_context_t *batch_context)
 {
     NV_STATUS status;
@@ -497,6 +906,8 @@ static NV_STATUS push_replay_on_gpu(uvm_gpu_t *gpu, uvm_fault_replay_type_t type
     if (batch_context && type != UVM_FAULT_REPLAY_TYPE_START_ACK_ALL) {
         uvm_tools_broadcast_replay(gpu, &push, batch_context->batch_id, UVM_FAULT_CLIENT_TYPE_GPC);
         ++batch_context->num_replays;
+
+        fault_replay_latency_sample(&push, batch_context);
     }
 
     uvm_push_end(&push);
@@ -597,9 +1008,14 @@ static inline int cmp_fault_instance_ptr(const uvm_fault_buffer_entry_t *a,
     return UVM_CMP_DEFAULT(a->fault_source.ve_id, b->fault_source.ve_id);
 }
 
-// Compare two VA spaces
-static inline int cmp_va_space(const uvm_va_space_t *a, const uvm_va_space_t *b)
+// Compare two VA spaces given their fault service weights. VA spaces with a
+// higher weight go first.
+static inline int cmp_va_space(const uvm_va_space_t *a, NvU8 weight_a, const uvm_va_space_t *b, NvU8 weight_b)
 {
+    int result = UVM_CMP_DEFAULT(weight_b, weight_a);
+    if (result != 0)
+        return result;
+
     return UVM_CMP_DEFAULT(a, b);
 }
 
@@ -707,6 +1123,82 @@ static bool fetch_fault_buffer_try_merge_entry(uvm_fault_buffer_entry_t *current
     return false;
 }
 
+static void fault_coalesce_hash_reset(uvm_fault_service_batch_context_t *batch_context)
+{
+    // Wrapping around would make stale slots look in use
+    if (++batch_context->coalesce_hash.generation == 0) {
+        memset(batch_context->coalesce_hash.slots,
+               0,
+               (batch_context->coalesce_hash.mask + 1) * sizeof(*batch_context->coalesce_hash.slots));
+        batch_context->coalesce_hash.generation = 1;
+    }
+}
+
+static bool fault_coalesce_hash_slot_in_use(uvm_fault_service_batch_context_t *batch_context,
+                                            const uvm_fault_coalesce_hash_slot_t *slot)
+{
+    return slot->generation == batch_context->coalesce_hash.generation;
+}
+
+// Find the slot of the coalescing hash set that holds the representative of
+// the faults with the same instance pointer and page address as
+// current_entry. If there is none, return a free slot where current_entry can
+// be inserted, or NULL if the probed slots are all in use.
+static uvm_fault_coalesce_hash_slot_t *fault_coalesce_hash_find_slot(uvm_fault_service_batch_context_t *batch_context,
+                                                                     const uvm_fault_buffer_entry_t *current_entry)
+{
+    NvU32 probe;
+    NvU32 hash = hash_64(current_entry->fault_address, 32) ^
+                 hash_64(current_entry->instance_ptr.address + current_entry->fault_source.ve_id, 32);
+
+    for (probe = 0; probe < UVM_FAULT_COALESCE_HASH_MAX_PROBES; ++probe) {
+        uvm_fault_coalesce_hash_slot_t *slot = &batch_context->coalesce_hash.slots[(hash + probe) &
+                                                                                   batch_context->coalesce_hash.mask];
+        const uvm_fault_buffer_entry_t *entry;
+
+        if (!fault_coalesce_hash_slot_in_use(batch_context, slot))
+            return slot;
+
+        entry = &batch_context->fault_cache[slot->fault_index];
+        if (cmp_fault_instance_ptr(current_entry, entry) == 0 && current_entry->fault_address == entry->fault_address)
+            return slot;
+    }
+
+    return NULL;
+}
+
+// Merge current_entry with the representative found in the coalescing hash
+// set. The same rules as in fetch_fault_buffer_try_merge_entry apply: the new
+// fault only becomes the representative if it comes from the same uTLB.
+static bool fetch_fault_buffer_try_merge_hashed_entry(uvm_fault_buffer_entry_t *current_entry,
+                                                      NvU32 fault_index,
+                                                      uvm_fault_service_batch_context_t *batch_context,
+                                                      uvm_fault_utlb_info_t *current_tlb,
+                                                      uvm_fault_coalesce_hash_slot_t *slot)
+{
+    uvm_fault_buffer_entry_t *hashed_entry = &batch_context->fault_cache[slot->fault_index];
+    const bool becomes_representative = current_entry->fault_access_type > hashed_entry->fault_access_type;
+
+    UVM_ASSERT(!hashed_entry->filtered);
+
+    if (becomes_representative && current_entry->fault_source.utlb_id != hashed_entry->fault_source.utlb_id)
+        return false;
+
+    fetch_fault_buffer_merge_entry(current_entry, hashed_entry);
+
+    if (becomes_representative) {
+        slot->fault_index = fault_index;
+
+        if (current_tlb->last_fault == hashed_entry)
+            current_tlb->last_fault = current_entry;
+
+        if (batch_context->last_fault == hashed_entry)
+            batch_context->last_fault = current_entry;
+    }
+
+    return true;
+}
+
 // Fetch entries from the fault buffer, decode them and store them in the batch
 // context. We implement the fetch modes described above.
 //
@@ -726,9 +1218,128 @@ static bool fetch_fault_buffer_try_merge_entry(uvm_fault_buffer_entry_t *current
 // *We only merge faults from different uTLBs if the new fault has an access
 // type with the same or lower level of intrusiveness.
 //
+// Duplicates that are not adjacent in the buffer, like those from warps of
+// different CTAs interleaved with other faults, are found in a hash set of the
+// representatives of the batch, see uvm_perf_fault_coalesce_hash.
+//
 // This optimization cannot be performed during fault cancel on Pascal GPUs
 // (fetch_mode == FAULT_FETCH_MODE_ALL) since we need accurate tracking of all
 // the faults in each uTLB in order to guarantee precise fault attribution.
+// Prepare the batch context for a new batch of faults
+static void fetch_fault_buffer_reset_batch(uvm_fault_service_batch_context_t *batch_context, bool may_filter_hashed)
+{
+    NvU32 utlb_id;
+
+    batch_context->is_single_instance_ptr = true;
+    batch_context->last_fault = NULL;
+
+    if (may_filter_hashed)
+        fault_coalesce_hash_reset(batch_context);
+
+    // Clear uTLB counters
+    for (utlb_id = 0; utlb_id <= batch_context->max_utlb_id; ++utlb_id) {
+        batch_context->utlbs[utlb_id].num_pending_faults = 0;
+        batch_context->utlbs[utlb_id].has_fatal_faults = false;
+    }
+    batch_context->max_utlb_id = 0;
+}
+
+// Add the parsed entry at fault_index in the fault cache to the batch. Returns
+// true if the entry was coalesced with a previously cached entry, in which case
+// it is filtered out from servicing.
+static bool fetch_fault_buffer_cache_entry(uvm_gpu_t *gpu,
+                                           uvm_fault_service_batch_context_t *batch_context,
+                                           NvU32 fault_index,
+                                           bool may_filter,
+                                           bool may_filter_hashed)
+{
+    bool is_same_instance_ptr = true;
+    uvm_fault_buffer_entry_t *current_entry = &batch_context->fault_cache[fault_index];
+    uvm_fault_utlb_info_t *current_tlb;
+    uvm_fault_coalesce_hash_slot_t *hash_slot = NULL;
+
+    // The GPU aligns the fault addresses to 4k, but all of our tracking is
+    // done in PAGE_SIZE chunks which might be larger.
+    current_entry->fault_address = UVM_PAGE_ALIGN_DOWN(current_entry->fault_address);
+
+    // Make sure that all fields in the entry are properly initialized
+    current_entry->is_fatal = (current_entry->fault_type >= UVM_FAULT_TYPE_FATAL);
+
+    if (current_entry->is_fatal) {
+        // Record the fatal fault event later as we need the va_space locked
+        current_entry->fatal_reason = UvmEventFatalReasonInvalidFaultType;
+    }
+    else {
+        current_entry->fatal_reason = UvmEventFatalReasonInvalid;
+    }
+
+    current_entry->va_space = NULL;
+    current_entry->filtered = false;
+
+    if (current_entry->fault_source.utlb_id > batch_context->max_utlb_id) {
+        UVM_ASSERT(current_entry->fault_source.utlb_id < gpu->parent->fault_buffer_info.replayable.utlb_count);
+        batch_context->max_utlb_id = current_entry->fault_source.utlb_id;
+    }
+
+    current_tlb = &batch_context->utlbs[current_entry->fault_source.utlb_id];
+
+    if (fault_index > 0) {
+        UVM_ASSERT(batch_context->last_fault);
+        is_same_instance_ptr = cmp_fault_instance_ptr(current_entry, batch_context->last_fault) == 0;
+
+        // Coalesce duplicate faults when possible
+        if (may_filter && !current_entry->is_fatal) {
+            bool merged = fetch_fault_buffer_try_merge_entry(current_entry,
+                                                             batch_context,
+                                                             current_tlb,
+                                                             is_same_instance_ptr);
+            if (merged) {
+                // Keep the hash set pointing to the representative
+                if (may_filter_hashed && !current_entry->filtered) {
+                    hash_slot = fault_coalesce_hash_find_slot(batch_context, current_entry);
+                    if (hash_slot && fault_coalesce_hash_slot_in_use(batch_context, hash_slot))
+                        hash_slot->fault_index = fault_index;
+                }
+
+                return true;
+            }
+        }
+    }
+
+    if (may_filter_hashed && !current_entry->is_fatal) {
+        hash_slot = fault_coalesce_hash_find_slot(batch_context, current_entry);
+        if (hash_slot && fault_coalesce_hash_slot_in_use(batch_context, hash_slot)) {
+            if (fetch_fault_buffer_try_merge_hashed_entry(current_entry,
+                                                          fault_index,
+                                                          batch_context,
+                                                          current_tlb,
+                                                          hash_slot))
+                return true;
+
+            // The previous representative stays in the hash set
+            hash_slot = NULL;
+        }
+    }
+
+    if (batch_context->is_single_instance_ptr && !is_same_instance_ptr)
+        batch_context->is_single_instance_ptr = false;
+
+    current_entry->num_instances = 1;
+    current_entry->access_type_mask = uvm_fault_access_type_mask_bit(current_entry->fault_access_type);
+    INIT_LIST_HEAD(&current_entry->merged_instances_list);
+
+    ++current_tlb->num_pending_faults;
+    current_tlb->last_fault = current_entry;
+    batch_context->last_fault = current_entry;
+
+    if (hash_slot) {
+        hash_slot->generation = batch_context->coalesce_hash.generation;
+        hash_slot->fault_index = fault_index;
+    }
+
+    return false;
+}
+
 static void fetch_fault_buffer_entries(uvm_gpu_t *gpu,
                                        uvm_fault_service_batch_context_t *batch_context,
                                        fault_fetch_mode_t fetch_mode)
@@ -737,18 +1348,15 @@ static void fetch_fault_buffer_entries(uvm_gpu_t *gpu,
     NvU32 put;
     NvU32 fault_index;
     NvU32 num_coalesced_faults;
-    NvU32 utlb_id;
-    uvm_fault_buffer_entry_t *fault_cache;
     uvm_spin_loop_t spin;
     uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->parent->fault_buffer_info.replayable;
     const bool in_pascal_cancel_path = (!gpu->parent->fault_cancel_va_supported && fetch_mode == FAULT_FETCH_MODE_ALL);
     const bool may_filter = uvm_perf_fault_coalesce && !in_pascal_cancel_path;
+    const bool may_filter_hashed = may_filter && uvm_perf_fault_coalesce_hash;
 
     UVM_ASSERT(uvm_sem_is_locked(&gpu->parent->isr.replayable_faults.service_lock));
     UVM_ASSERT(gpu->parent->replayable_faults_supported);
 
-    fault_cache = batch_context->fault_cache;
-
     get = replayable_faults->cached_get;
 
     // Read put pointer from GPU and cache it
@@ -757,102 +1365,54 @@ static void fetch_fault_buffer_entries(uvm_gpu_t *gpu,
 
     put = replayable_faults->cached_put;
 
-    batch_context->is_single_instance_ptr = true;
-    batch_context->last_fault = NULL;
+    fetch_fault_buffer_reset_batch(batch_context, may_filter_hashed);
 
     fault_index = 0;
     num_coalesced_faults = 0;
 
-    // Clear uTLB counters
-    for (utlb_id = 0; utlb_id <= batch_context->max_utlb_id; ++utlb_id) {
-        batch_context->utlbs[utlb_id].num_pending_faults = 0;
-        batch_context->utlbs[utlb_id].has_fatal_faults = false;
-    }
-    batch_context->max_utlb_id = 0;
-
     if (get == put)
         goto done;
 
     // Parse until get != put and have enough space to cache.
     while ((get != put) &&
            (fetch_mode == FAULT_FETCH_MODE_ALL || fault_index < gpu->parent->fault_buffer_info.max_batch_size)) {
-        bool is_same_instance_ptr = true;
-        uvm_fault_buffer_entry_t *current_entry = &fault_cache[fault_index];
-        uvm_fault_utlb_info_t *current_tlb;
-
-        // We cannot just wait for the last entry (the one pointed by put) to
-        // become valid, we have to do it individually since entries can be
-        // written out of order
-        UVM_SPIN_WHILE(!gpu->parent->fault_buffer_hal->entry_is_valid(gpu->parent, get), &spin) {
-            // We have some entry to work on. Let's do the rest later.
-            if (fetch_mode != FAULT_FETCH_MODE_ALL &&
-                fetch_mode != FAULT_FETCH_MODE_BATCH_ALL &&
-                fault_index > 0)
-                goto done;
-        }
-
-        // Prevent later accesses being moved above the read of the valid bit
-        smp_mb__after_atomic();
-
-        // Got valid bit set. Let's cache.
-        gpu->parent->fault_buffer_hal->parse_entry(gpu->parent, get, current_entry);
-
-        // The GPU aligns the fault addresses to 4k, but all of our tracking is
-        // done in PAGE_SIZE chunks which might be larger.
-        current_entry->fault_address = UVM_PAGE_ALIGN_DOWN(current_entry->fault_address);
-
-        // Make sure that all fields in the entry are properly initialized
-        current_entry->is_fatal = (current_entry->fault_type >= UVM_FAULT_TYPE_FATAL);
-
-        if (current_entry->is_fatal) {
-            // Record the fatal fault event later as we need the va_space locked
-            current_entry->fatal_reason = UvmEventFatalReasonInvalidFaultType;
-        }
-        else {
-            current_entry->fatal_reason = UvmEventFatalReasonInvalid;
-        }
-
-        current_entry->va_space = NULL;
-        current_entry->filtered = false;
+        NvU32 num_entries;
+        NvU32 num_parsed;
+        NvU32 i;
+
+        // Parse the entries up to put or the end of the buffer in bulk, as
+        // long as they are valid and fit in the batch
+        num_entries = (get < put ? put : replayable_faults->max_faults) - get;
+        if (fetch_mode != FAULT_FETCH_MODE_ALL)
+            num_entries = min(num_entries, gpu->parent->fault_buffer_info.max_batch_size - fault_index);
+
+        num_parsed = uvm_hal_fault_buffer_parse_entries(gpu->parent,
+                                                        get,
+                                                        num_entries,
+                                                        &batch_context->fault_cache[fault_index]);
+        if (num_parsed == 0) {
+            // We cannot just wait for the last entry (the one pointed by put)
+            // to become valid, we have to do it individually since entries
+            // can be written out of order
+            UVM_SPIN_WHILE(!uvm_hal_fault_buffer_entry_is_valid(gpu->parent, get), &spin) {
+                // We have some entry to work on. Let's do the rest later.
+                if (fetch_mode != FAULT_FETCH_MODE_ALL &&
+                    fetch_mode != FAULT_FETCH_MODE_BATCH_ALL &&
+                    fault_index > 0)
+                    goto done;
+            }
 
-        if (current_entry->fault_source.utlb_id > batch_context->max_utlb_id) {
-            UVM_ASSERT(current_entry->fault_source.utlb_id < replayable_faults->utlb_count);
-            batch_context->max_utlb_id = current_entry->fault_source.utlb_id;
+            continue;
         }
 
-        current_tlb = &batch_context->utlbs[current_entry->fault_source.utlb_id];
+        for (i = 0; i < num_parsed; ++i) {
+            if (!fetch_fault_buffer_cache_entry(gpu, batch_context, fault_index, may_filter, may_filter_hashed))
+                ++num_coalesced_faults;
 
-        if (fault_index > 0) {
-            UVM_ASSERT(batch_context->last_fault);
-            is_same_instance_ptr = cmp_fault_instance_ptr(current_entry, batch_context->last_fault) == 0;
-
-            // Coalesce duplicate faults when possible
-            if (may_filter && !current_entry->is_fatal) {
-                bool merged = fetch_fault_buffer_try_merge_entry(current_entry,
-                                                                 batch_context,
-                                                                 current_tlb,
-                                                                 is_same_instance_ptr);
-                if (merged)
-                    goto next_fault;
-            }
+            ++fault_index;
         }
 
-        if (batch_context->is_single_instance_ptr && !is_same_instance_ptr)
-            batch_context->is_single_instance_ptr = false;
-
-        current_entry->num_instances = 1;
-        current_entry->access_type_mask = uvm_fault_access_type_mask_bit(current_entry->fault_access_type);
-        INIT_LIST_HEAD(&current_entry->merged_instances_list);
-
-        ++current_tlb->num_pending_faults;
-        current_tlb->last_fault = current_entry;
-        batch_context->last_fault = current_entry;
-
-        ++num_coalesced_faults;
-
-    next_fault:
-        ++fault_index;
-        ++get;
+        get += num_parsed;
         if (get == replayable_faults->max_faults)
             get = 0;
     }
@@ -883,7 +1443,7 @@ static int cmp_sort_fault_entry_by_va_space_address_access_type(const void *_a,
 
     int result;
 
-    result = cmp_va_space((*a)->va_space, (*b)->va_space);
+    result = cmp_va_space((*a)->va_space, (*a)->va_space_weight, (*b)->va_space, (*b)->va_space_weight);
     if (result != 0)
         return result;
 
@@ -894,6 +1454,148 @@ static int cmp_sort_fault_entry_by_va_space_address_access_type(const void *_a,
     return cmp_access_type((*a)->fault_access_type, (*b)->fault_access_type);
 }
 
+// Stable LSD radix sort of the first count elements of ordered_fault_cache by
+// the keys in radix_sort.keys. Digits that are the same in all the keys are
+// skipped, so the number of passes depends on the spread of the keys rather
+// than on their width.
+static void radix_sort_fault_entries(uvm_fault_service_batch_context_t *batch_context, NvU32 count)
+{
+    NvU32 digit_offsets[UVM_FAULT_RADIX_SORT_DIGIT_COUNT];
+    NvU64 *keys = batch_context->radix_sort.keys;
+    NvU64 *tmp_keys = batch_context->radix_sort.tmp_keys;
+    uvm_fault_buffer_entry_t **entries = batch_context->ordered_fault_cache;
+    uvm_fault_buffer_entry_t **tmp_entries = batch_context->radix_sort.tmp_entries;
+    NvU64 keys_or = 0;
+    NvU64 keys_and = ~0ULL;
+    unsigned shift;
+    NvU32 i;
+
+    for (i = 0; i < count; ++i) {
+        keys_or |= keys[i];
+        keys_and &= keys[i];
+    }
+
+    for (shift = 0; shift < 64; shift += UVM_FAULT_RADIX_SORT_DIGIT_BITS) {
+        NvU32 digit;
+        NvU32 offset = 0;
+
+        if ((((keys_or ^ keys_and) >> shift) & (UVM_FAULT_RADIX_SORT_DIGIT_COUNT - 1)) == 0)
+            continue;
+
+        memset(digit_offsets, 0, sizeof(digit_offsets));
+
+        for (i = 0; i < count; ++i)
+            ++digit_offsets[(keys[i] >> shift) & (UVM_FAULT_RADIX_SORT_DIGIT_COUNT - 1)];
+
+        for (digit = 0; digit < UVM_FAULT_RADIX_SORT_DIGIT_COUNT; ++digit) {
+            NvU32 digit_count = digit_offsets[digit];
+
+            digit_offsets[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (i = 0; i < count; ++i) {
+            NvU32 pos = digit_offsets[(keys[i] >> shift) & (UVM_FAULT_RADIX_SORT_DIGIT_COUNT - 1)]++;
+
+            tmp_keys[pos] = keys[i];
+            tmp_entries[pos] = entries[i];
+        }
+
+        swap(keys, tmp_keys);
+        swap(entries, tmp_entries);
+    }
+
+    if (entries != batch_context->ordered_fault_cache)
+        memcpy(batch_context->ordered_fault_cache, entries, count * sizeof(*entries));
+}
+
+// Compute the keys of the faults in ordered_fault_cache that order them like
+// cmp_fault_instance_ptr: aperture, address and VEID. Returns false if the
+// keys do not fit in 64 bits.
+static bool compute_instance_ptr_sort_keys(uvm_fault_service_batch_context_t *batch_context, NvU32 count)
+{
+    NvU32 i;
+
+    BUILD_BUG_ON(UVM_APERTURE_MAX > 16);
+    BUILD_BUG_ON(sizeof(((uvm_fault_buffer_entry_t *)0)->fault_source.ve_id) != 1);
+
+    for (i = 0; i < count; ++i) {
+        const uvm_fault_buffer_entry_t *entry = batch_context->ordered_fault_cache[i];
+
+        if (entry->instance_ptr.address >= (1ULL << 52))
+            return false;
+
+        batch_context->radix_sort.keys[i] = ((NvU64)entry->instance_ptr.aperture << 60) |
+                                            (entry->instance_ptr.address << 8) |
+                                            entry->fault_source.ve_id;
+    }
+
+    return true;
+}
+
+// Compute the keys of the faults in ordered_fault_cache that order them like
+// cmp_sort_fault_entry_by_va_space_address_access_type. The VA spaces of the
+// batch are ranked by address, and the access type is inverted so the most
+// intrusive access goes first. Returns false if the batch has too many VA
+// spaces.
+static bool compute_va_space_address_access_type_sort_keys(uvm_fault_service_batch_context_t *batch_context,
+                                                           NvU32 count)
+{
+    uvm_va_space_t *va_spaces[UVM_FAULT_RADIX_SORT_MAX_VA_SPACES];
+    NvU8 weights[UVM_FAULT_RADIX_SORT_MAX_VA_SPACES];
+    NvU32 num_va_spaces = 0;
+    NvU32 last_rank = 0;
+    NvU32 i;
+
+    BUILD_BUG_ON(UVM_FAULT_ACCESS_TYPE_COUNT > 8);
+
+    // Faults are sorted by instance pointer, so VA spaces come in runs and
+    // there are only a few of them. Keep the distinct VA spaces sorted by
+    // weight and address.
+    for (i = 0; i < count; ++i) {
+        uvm_va_space_t *va_space = batch_context->ordered_fault_cache[i]->va_space;
+        NvU8 weight = batch_context->ordered_fault_cache[i]->va_space_weight;
+        NvU32 pos;
+
+        if (num_va_spaces > 0 && va_spaces[last_rank] == va_space)
+            continue;
+
+        for (pos = 0; pos < num_va_spaces && cmp_va_space(va_spaces[pos], weights[pos], va_space, weight) < 0; ++pos)
+            ;
+
+        if (pos < num_va_spaces && va_spaces[pos] == va_space) {
+            last_rank = pos;
+            continue;
+        }
+
+        if (num_va_spaces == UVM_FAULT_RADIX_SORT_MAX_VA_SPACES)
+            return false;
+
+        memmove(&va_spaces[pos + 1], &va_spaces[pos], (num_va_spaces - pos) * sizeof(va_spaces[0]));
+        memmove(&weights[pos + 1], &weights[pos], (num_va_spaces - pos) * sizeof(weights[0]));
+        va_spaces[pos] = va_space;
+        weights[pos] = weight;
+        ++num_va_spaces;
+        last_rank = pos;
+    }
+
+    last_rank = 0;
+    for (i = 0; i < count; ++i) {
+        const uvm_fault_buffer_entry_t *entry = batch_context->ordered_fault_cache[i];
+
+        if (va_spaces[last_rank] != entry->va_space) {
+            for (last_rank = 0; va_spaces[last_rank] != entry->va_space; ++last_rank)
+                ;
+        }
+
+        batch_context->radix_sort.keys[i] = ((NvU64)last_rank << (64 - UVM_FAULT_RADIX_SORT_VA_SPACE_BITS)) |
+                                            ((entry->fault_address >> 12) << 3) |
+                                            (UVM_FAULT_ACCESS_TYPE_COUNT - 1 - entry->fault_access_type);
+    }
+
+    return true;
+}
+
 // Translate all instance pointers to VA spaces. Since the buffer is ordered by
 // instance_ptr, we minimize the number of translations
 //
@@ -915,6 +1617,7 @@ static NV_STATUS translate_instance_ptrs(uvm_gpu_t *gpu,
         // copy over the already-translated va_space and move on.
         if (i != 0 && cmp_fault_instance_ptr(current_entry, batch_context->ordered_fault_cache[i - 1]) == 0) {
             current_entry->va_space = batch_context->ordered_fault_cache[i - 1]->va_space;
+            current_entry->va_space_weight = batch_context->ordered_fault_cache[i - 1]->va_space_weight;
             continue;
         }
 
@@ -968,6 +1671,7 @@ static NV_STATUS translate_instance_ptrs(uvm_gpu_t *gpu,
         }
         else {
             UVM_ASSERT(current_entry->va_space);
+            current_entry->va_space_weight = READ_ONCE(current_entry->va_space->fault_service_weight);
         }
     }
 
@@ -990,10 +1694,23 @@ static NV_STATUS translate_instance_ptrs(uvm_gpu_t *gpu,
 // 2) translate all instance_ptrs to VA spaces
 // 3) sort by va_space, fault address (fault_address is page-aligned at this
 //    point) and access type
+static void record_stage_latency(uvm_parent_gpu_t *parent_gpu, uvm_fault_service_stage_t stage, NvU64 time_ns)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+    NvU32 bucket = time_ns ? min((NvU32)ilog2(time_ns), (NvU32)(UVM_FAULT_SERVICE_LATENCY_BUCKETS - 1)) : 0;
+
+    replayable_faults->stage_latency.total_ns[stage] += time_ns;
+    replayable_faults->stage_latency.max_ns[stage] = max(replayable_faults->stage_latency.max_ns[stage], time_ns);
+    ++replayable_faults->stage_latency.buckets[stage][bucket];
+}
+
 static NV_STATUS preprocess_fault_batch(uvm_gpu_t *gpu, uvm_fault_service_batch_context_t *batch_context)
 {
     NV_STATUS status;
     NvU32 i, j;
+    NvU64 start;
+    NvU64 sort_time;
+    bool use_radix_sort;
     uvm_fault_buffer_entry_t **ordered_fault_cache = batch_context->ordered_fault_cache;
 
     UVM_ASSERT(batch_context->num_coalesced_faults > 0);
@@ -1010,27 +1727,49 @@ static NV_STATUS preprocess_fault_batch(uvm_gpu_t *gpu, uvm_fault_service_batch_
     }
     UVM_ASSERT(j == batch_context->num_coalesced_faults);
 
+    use_radix_sort = uvm_perf_fault_radix_sort &&
+                     batch_context->num_coalesced_faults >= UVM_FAULT_RADIX_SORT_MIN_FAULTS;
+
     // 1) if the fault batch contains more than one, sort by instance_ptr
+    start = NV_GETTIME();
     if (!batch_context->is_single_instance_ptr) {
-        sort(ordered_fault_cache,
-             batch_context->num_coalesced_faults,
-             sizeof(*ordered_fault_cache),
-             cmp_sort_fault_entry_by_instance_ptr,
-             NULL);
+        if (use_radix_sort && compute_instance_ptr_sort_keys(batch_context, batch_context->num_coalesced_faults)) {
+            radix_sort_fault_entries(batch_context, batch_context->num_coalesced_faults);
+        }
+        else {
+            sort(ordered_fault_cache,
+                 batch_context->num_coalesced_faults,
+                 sizeof(*ordered_fault_cache),
+                 cmp_sort_fault_entry_by_instance_ptr,
+                 NULL);
+        }
     }
+    sort_time = NV_GETTIME() - start;
 
     // 2) translate all instance_ptrs to VA spaces
-    status = translate_instance_ptrs(gpu, batch_context);
-    if (status != NV_OK)
-        return status;
+    if (!batch_context->is_synthetic) {
+        start = NV_GETTIME();
+        status = translate_instance_ptrs(gpu, batch_context);
+        record_stage_latency(gpu->parent, UVM_FAULT_SERVICE_STAGE_TRANSLATE, NV_GETTIME() - start);
+        if (status != NV_OK)
+            return status;
+    }
 
     // 3) sort by va_space, fault address (GPU already reports 4K-aligned
     // address) and access type
-    sort(ordered_fault_cache,
-         batch_context->num_coalesced_faults,
-         sizeof(*ordered_fault_cache),
-         cmp_sort_fault_entry_by_va_space_address_access_type,
-         NULL);
+    start = NV_GETTIME();
+    if (use_radix_sort &&
+        compute_va_space_address_access_type_sort_keys(batch_context, batch_context->num_coalesced_faults)) {
+        radix_sort_fault_entries(batch_context, batch_context->num_coalesced_faults);
+    }
+    else {
+        sort(ordered_fault_cache,
+             batch_context->num_coalesced_faults,
+             sizeof(*ordered_fault_cache),
+             cmp_sort_fault_entry_by_va_space_address_access_type,
+             NULL);
+    }
+    record_stage_latency(gpu->parent, UVM_FAULT_SERVICE_STAGE_SORT, sort_time + NV_GETTIME() - start);
 
     return NV_OK;
 }
@@ -1121,6 +1860,7 @@ static NV_STATUS service_batch_managed_faults_in_block_locked(uvm_gpu_t *gpu,
                                                               uvm_va_block_retry_t *va_block_retry,
                                                               NvU32 first_fault_index,
                                                               uvm_fault_service_batch_context_t *batch_context,
+                                                              uvm_service_block_context_t *block_context,
                                                               NvU32 *block_faults)
 {
     NV_STATUS status = NV_OK;
@@ -1129,9 +1869,7 @@ static NV_STATUS service_batch_managed_faults_in_block_locked(uvm_gpu_t *gpu,
     uvm_page_index_t last_page_index;
     NvU32 page_fault_count = 0;
     uvm_range_group_range_iter_t iter;
-    uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->parent->fault_buffer_info.replayable;
     uvm_fault_buffer_entry_t **ordered_fault_cache = batch_context->ordered_fault_cache;
-    uvm_service_block_context_t *block_context = &replayable_faults->block_service_context;
     uvm_va_space_t *va_space = uvm_va_block_get_va_space(va_block);
 
     // Check that all uvm_fault_access_type_t values can fit into an NvU8
@@ -1336,23 +2074,107 @@ static NV_STATUS service_batch_managed_faults_in_block_locked(uvm_gpu_t *gpu,
 //
 // See the comments for function service_fault_batch_block_locked for
 // implementation details and error codes.
+//
+// fault_block_context is the block service context where the changes are
+// computed. Callers servicing blocks concurrently must use different contexts.
+static NV_STATUS prefetch_ahead_block_locked(uvm_va_block_t *va_block,
+                                             uvm_va_block_retry_t *va_block_retry,
+                                             uvm_va_block_context_t *va_block_context,
+                                             uvm_va_block_region_t region,
+                                             uvm_processor_id_t dest_id,
+                                             uvm_tracker_t *out_tracker)
+{
+    // Do not prefetch into blocks which are thrashing, the thrashing
+    // mitigation heuristics take care of them
+    if (uvm_perf_thrashing_get_thrashing_pages(va_block))
+        return NV_OK;
+
+    return uvm_va_block_migrate_locked(va_block,
+                                       va_block_retry,
+                                       va_block_context,
+                                       region,
+                                       dest_id,
+                                       UVM_MIGRATE_MODE_MAKE_RESIDENT_AND_MAP,
+                                       out_tracker);
+}
+
+// Migrate the region predicted by the prefetcher beyond the serviced VA block.
+// This is best-effort: running out of memory stops prefetching but it is not
+// reported as an error.
+static NV_STATUS service_prefetch_ahead(uvm_va_range_t *va_range,
+                                        uvm_fault_service_batch_context_t *batch_context,
+                                        uvm_service_block_context_t *fault_block_context)
+{
+    NvU64 start = fault_block_context->prefetch_ahead.start;
+    NvU64 end = fault_block_context->prefetch_ahead.end;
+    size_t i;
+
+    UVM_ASSERT(start >= va_range->node.start);
+    UVM_ASSERT(end <= va_range->node.end);
+
+    for (i = uvm_va_range_block_index(va_range, start); i <= uvm_va_range_block_index(va_range, end); ++i) {
+        uvm_va_block_retry_t va_block_retry;
+        uvm_va_block_region_t region;
+        uvm_va_block_t *va_block;
+        NV_STATUS status = uvm_va_range_block_create(va_range, i, &va_block);
+
+        if (status == NV_OK) {
+            region = uvm_va_block_region_from_start_end(va_block,
+                                                        max(start, va_block->start),
+                                                        min(end, va_block->end));
+
+            status = UVM_VA_BLOCK_LOCK_RETRY(va_block, &va_block_retry,
+                                             prefetch_ahead_block_locked(va_block,
+                                                                         &va_block_retry,
+                                                                         &fault_block_context->block_context,
+                                                                         region,
+                                                                         fault_block_context->prefetch_ahead.residency,
+                                                                         &batch_context->tracker));
+        }
+
+        if (status == NV_ERR_NO_MEMORY)
+            return NV_OK;
+
+        if (status != NV_OK)
+            return status;
+    }
+
+    return NV_OK;
+}
+
+// If try_lock is true and the VA block lock is already held, nothing is
+// serviced and NV_ERR_BUSY_RETRY is returned.
 static NV_STATUS service_batch_managed_faults_in_block(uvm_gpu_t *gpu,
                                                        struct mm_struct *mm,
                                                        uvm_va_block_t *va_block,
                                                        NvU32 first_fault_index,
+                                                       bool try_lock,
                                                        uvm_fault_service_batch_context_t *batch_context,
+                                                       uvm_service_block_context_t *fault_block_context,
                                                        NvU32 *block_faults)
 {
     NV_STATUS status;
     uvm_va_block_retry_t va_block_retry;
     NV_STATUS tracker_status;
-    uvm_service_block_context_t *fault_block_context = &gpu->parent->fault_buffer_info.replayable.block_service_context;
+
+    if (try_lock) {
+        if (!uvm_mutex_trylock(&va_block->lock))
+            return NV_ERR_BUSY_RETRY;
+    }
+    else {
+        uvm_mutex_lock(&va_block->lock);
+    }
 
     fault_block_context->operation = UVM_SERVICE_OPERATION_REPLAYABLE_FAULTS;
     fault_block_context->num_retries = 0;
     fault_block_context->block_context.mm = mm;
+    fault_block_context->prefetch_ahead.end = 0;
 
-    uvm_mutex_lock(&va_block->lock);
+    // TLB invalidates of the permission upgrades done on this GPU are
+    // deferred to its page tree, and flushed by service_fault_batch before
+    // the faults are replayed.
+    fault_block_context->block_context.mapping.deferred_tlb_tree =
+        &uvm_gpu_va_space_get(va_block->va_range->va_space, gpu)->page_tables;
 
     status = UVM_VA_BLOCK_RETRY_LOCKED(va_block, &va_block_retry,
                                        service_batch_managed_faults_in_block_locked(gpu,
@@ -1360,12 +2182,18 @@ static NV_STATUS service_batch_managed_faults_in_block(uvm_gpu_t *gpu,
                                                                                     &va_block_retry,
                                                                                     first_fault_index,
                                                                                     batch_context,
+                                                                                    fault_block_context,
                                                                                     block_faults));
 
     tracker_status = uvm_tracker_add_tracker_safe(&batch_context->tracker, &va_block->tracker);
 
     uvm_mutex_unlock(&va_block->lock);
 
+    if (status == NV_OK && tracker_status == NV_OK && fault_block_context->prefetch_ahead.end != 0)
+        status = service_prefetch_ahead(va_block->va_range, batch_context, fault_block_context);
+
+    fault_block_context->block_context.mapping.deferred_tlb_tree = NULL;
+
     return status == NV_OK? tracker_status: status;
 }
 
@@ -1381,6 +2209,8 @@ typedef enum
 
 static NV_STATUS service_non_managed_fault(uvm_fault_buffer_entry_t *current_entry,
                                            const uvm_fault_buffer_entry_t *previous_entry,
+                                           uvm_fault_buffer_entry_t **next_entries,
+                                           NvU32 num_next_entries,
                                            NV_STATUS lookup_status,
                                            uvm_gpu_va_space_t *gpu_va_space,
                                            struct mm_struct *mm,
@@ -1425,7 +2255,11 @@ static NV_STATUS service_non_managed_fault(uvm_fault_buffer_entry_t *current_ent
         // duplicate and the previous fault was non-fatal so the page has
         // already been serviced
         if (!is_duplicate || previous_entry->is_fatal)
-            status = uvm_ats_service_fault_entry(gpu_va_space, current_entry, ats_invalidate);
+            status = uvm_ats_service_fault_entry(gpu_va_space,
+                                                 current_entry,
+                                                 next_entries,
+                                                 num_next_entries,
+                                                 ats_invalidate);
         else
             status = NV_OK;
     }
@@ -1464,9 +2298,209 @@ static NV_STATUS service_non_managed_fault(uvm_fault_buffer_entry_t *current_ent
     return status;
 }
 
+// Service the VA block groups of the current dispatch until all of them have
+// been picked up or any of the participants fails. This is called both by the
+// bottom half and by the service workers, each using its own batch and block
+// service contexts.
+static NV_STATUS service_block_group(uvm_parent_gpu_t *parent_gpu,
+                                     uvm_fault_service_block_group_t *group,
+                                     bool try_lock,
+                                     uvm_fault_service_batch_context_t *batch_context,
+                                     uvm_service_block_context_t *block_context)
+{
+    NV_STATUS status;
+    NvU32 block_faults;
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+
+    status = service_batch_managed_faults_in_block(replayable_faults->service_workers.gpu,
+                                                   replayable_faults->service_workers.mm,
+                                                   group->va_block,
+                                                   group->first_fault_index,
+                                                   try_lock,
+                                                   batch_context,
+                                                   block_context,
+                                                   &block_faults);
+    if (status == NV_OK)
+        UVM_ASSERT(block_faults == group->num_faults);
+
+    return status;
+}
+
+// Groups are first serviced only if their VA block lock can be taken without
+// waiting. Contended groups are set aside (up to
+// UVM_FAULT_SERVICE_MAX_DEFERRED_GROUPS) and serviced after the rest, so that
+// the participant keeps making progress on uncontended blocks in the meantime.
+static NV_STATUS service_block_groups(uvm_parent_gpu_t *parent_gpu,
+                                      uvm_fault_service_batch_context_t *batch_context,
+                                      uvm_service_block_context_t *block_context)
+{
+    NV_STATUS status = NV_OK;
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+    uvm_fault_service_block_group_t *deferred[UVM_FAULT_SERVICE_MAX_DEFERRED_GROUPS];
+    NvU32 num_deferred = 0;
+    NvU32 i;
+
+    while (!atomic_read(&replayable_faults->service_workers.abort)) {
+        uvm_fault_service_block_group_t *group;
+        bool try_lock = num_deferred < ARRAY_SIZE(deferred);
+        NvU32 index = (NvU32)atomic_inc_return(&replayable_faults->service_workers.next_group) - 1;
+
+        if (index >= replayable_faults->service_workers.num_groups)
+            break;
+
+        group = &replayable_faults->service_workers.groups[index];
+
+        status = service_block_group(parent_gpu, group, try_lock, batch_context, block_context);
+        if (status == NV_ERR_BUSY_RETRY) {
+            atomic64_inc(&replayable_faults->service_workers.num_deferred_groups);
+            deferred[num_deferred++] = group;
+            status = NV_OK;
+            continue;
+        }
+
+        if (status != NV_OK) {
+            atomic_set(&replayable_faults->service_workers.abort, 1);
+            return status;
+        }
+    }
+
+    for (i = 0; i < num_deferred && !atomic_read(&replayable_faults->service_workers.abort); ++i) {
+        status = service_block_group(parent_gpu, deferred[i], false, batch_context, block_context);
+        if (status != NV_OK) {
+            atomic_set(&replayable_faults->service_workers.abort, 1);
+            break;
+        }
+    }
+
+    return status;
+}
+
+static void fault_service_worker(uvm_fault_service_worker_t *worker)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &worker->parent_gpu->fault_buffer_info.replayable;
+    uvm_va_space_t *va_space = replayable_faults->service_workers.va_space;
+    struct mm_struct *mm = replayable_faults->service_workers.mm;
+
+    // Record the lock ownership
+    // mmap_lock and the VA space lock are taken in read mode by the bottom
+    // half, which waits for all the workers before releasing them. The
+    // ownership is recorded here so that the lock tracking assertions in the
+    // servicing code hold on the worker thread, too.
+    if (mm)
+        uvm_record_lock_mmap_lock_read(mm);
+    uvm_record_lock(&va_space->lock, UVM_LOCK_FLAGS_MODE_SHARED);
+
+    worker->status = service_block_groups(worker->parent_gpu,
+                                          &worker->batch_context,
+                                          &worker->block_service_context);
+
+    uvm_record_unlock(&va_space->lock, UVM_LOCK_FLAGS_MODE_SHARED);
+    if (mm)
+        uvm_record_unlock_mmap_lock_read(mm);
+
+    complete(&worker->done);
+}
+
+static void fault_service_worker_entry(void *args)
+{
+   UVM_ENTRY_VOID(fault_service_worker((uvm_fault_service_worker_t *)args));
+}
+
+// Service all the VA block groups collected for the given VA space using the
+// service workers and the calling thread. The function returns after all the
+// groups have been serviced, and the per-worker counters, flags and trackers
+// have been merged into batch_context.
+static NV_STATUS service_block_groups_dispatch(uvm_parent_gpu_t *parent_gpu,
+                                               uvm_gpu_va_space_t *gpu_va_space,
+                                               struct mm_struct *mm,
+                                               uvm_fault_service_batch_context_t *batch_context)
+{
+    NV_STATUS status;
+    NvU32 i;
+    NvU32 num_workers;
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &parent_gpu->fault_buffer_info.replayable;
+    NvU32 num_groups = replayable_faults->service_workers.num_groups;
+
+    // Groups are only collected for VA spaces with a GPU VA space registered
+    // for this GPU
+    if (num_groups == 0)
+        return NV_OK;
+
+    UVM_ASSERT(gpu_va_space);
+    uvm_assert_percpu_rwsem_locked(&gpu_va_space->va_space->lock);
+
+    // The calling thread also services groups, so there is no point in waking
+    // up more workers than the remaining groups
+    num_workers = min(replayable_faults->service_workers.num_workers, num_groups - 1);
+
+    replayable_faults->service_workers.gpu      = gpu_va_space->gpu;
+    replayable_faults->service_workers.va_space = gpu_va_space->va_space;
+    replayable_faults->service_workers.mm       = mm;
+    atomic_set(&replayable_faults->service_workers.next_group, 0);
+    atomic_set(&replayable_faults->service_workers.abort, 0);
+
+    for (i = 0; i < num_workers; ++i) {
+        uvm_fault_service_worker_t *worker = &replayable_faults->service_workers.workers[i];
+        uvm_fault_service_batch_context_t *worker_batch_context = &worker->batch_context;
+
+        UVM_ASSERT(uvm_tracker_is_empty(&worker_batch_context->tracker));
+
+        worker_batch_context->ordered_fault_cache         = batch_context->ordered_fault_cache;
+        worker_batch_context->utlbs                       = batch_context->utlbs;
+        worker_batch_context->num_coalesced_faults        = batch_context->num_coalesced_faults;
+        worker_batch_context->batch_id                    = batch_context->batch_id;
+        worker_batch_context->has_fatal_faults            = batch_context->has_fatal_faults;
+        worker_batch_context->has_throttled_faults        = false;
+        worker_batch_context->num_invalid_prefetch_faults = 0;
+        worker_batch_context->num_duplicate_faults        = 0;
+
+        worker->status = NV_OK;
+        reinit_completion(&worker->done);
+
+        // Scheduling only fails if the queue is shutting down, in which case
+        // the groups are serviced by the rest of participants
+        if (!nv_kthread_q_schedule_q_item(&worker->q, &worker->q_item)) {
+            num_workers = i;
+            break;
+        }
+    }
+
+    status = service_block_groups(parent_gpu, batch_context, &replayable_faults->block_service_context);
+
+    for (i = 0; i < num_workers; ++i) {
+        uvm_fault_service_worker_t *worker = &replayable_faults->service_workers.workers[i];
+        uvm_fault_service_batch_context_t *worker_batch_context = &worker->batch_context;
+        NV_STATUS tracker_status;
+
+        wait_for_completion(&worker->done);
+
+        if (status == NV_OK)
+            status = worker->status;
+
+        batch_context->num_invalid_prefetch_faults += worker_batch_context->num_invalid_prefetch_faults;
+        batch_context->num_duplicate_faults        += worker_batch_context->num_duplicate_faults;
+        batch_context->has_throttled_faults        |= worker_batch_context->has_throttled_faults;
+        batch_context->has_fatal_faults            |= worker_batch_context->has_fatal_faults;
+
+        tracker_status = uvm_tracker_add_tracker_safe(&batch_context->tracker, &worker_batch_context->tracker);
+        uvm_tracker_clear(&worker_batch_context->tracker);
+
+        if (status == NV_OK)
+            status = tracker_status;
+    }
+
+    replayable_faults->service_workers.num_groups = 0;
+
+    return status;
+}
+
 // Scan the ordered view of faults and group them by different va_blocks.
 // Service faults for each va_block, in batch.
 //
+// If service workers are available, the VA blocks of each VA space are
+// collected first and then serviced in parallel, before the VA space lock is
+// dropped. Faults not managed by UVM are serviced while collecting the blocks.
+//
 // This function returns NV_WARN_MORE_PROCESSING_REQUIRED if the fault buffer
 // was flushed because the needs_fault_buffer_flush flag was set on some GPU VA
 // space
@@ -1481,11 +2515,24 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu,
     uvm_ats_fault_invalidate_t *ats_invalidate = &gpu->parent->fault_buffer_info.replayable.ats_invalidate;
     const bool replay_per_va_block = service_mode != FAULT_SERVICE_MODE_CANCEL &&
                                      gpu->parent->fault_buffer_info.replayable.replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BLOCK;
+    const bool use_service_workers = service_mode == FAULT_SERVICE_MODE_REGULAR &&
+                                     !replay_per_va_block &&
+                                     gpu->parent->fault_buffer_info.replayable.service_workers.num_workers > 0;
+    // Faults are sorted by VA space, so the batch has faults from several VA
+    // spaces if the first and last ones differ
+    const bool limit_va_space_faults = service_mode == FAULT_SERVICE_MODE_REGULAR &&
+                                       uvm_perf_fault_batch_faults_per_weight != 0 &&
+                                       batch_context->num_coalesced_faults > 0 &&
+                                       batch_context->ordered_fault_cache[0]->va_space !=
+                                           batch_context->ordered_fault_cache[batch_context->num_coalesced_faults - 1]->va_space;
+    NvU32 va_space_max_faults = 0;
+    NvU32 va_space_num_faults = 0;
     struct mm_struct *mm = NULL;
 
     UVM_ASSERT(gpu->parent->replayable_faults_supported);
+    UVM_ASSERT(gpu->parent->fault_buffer_info.replayable.service_workers.num_groups == 0);
 
-    ats_invalidate->write_faults_in_batch = false;
+    uvm_ats_fault_batch_begin(ats_invalidate);
 
     for (i = 0; i < batch_context->num_coalesced_faults;) {
         uvm_va_block_t *va_block;
@@ -1498,25 +2545,40 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu,
         if (current_entry->va_space != va_space) {
             // Fault on a different va_space, drop the lock of the old one...
             if (va_space != NULL) {
+                // Service the VA blocks collected for the old VA space
+                status = service_block_groups_dispatch(gpu->parent, gpu_va_space, mm, batch_context);
+                if (status != NV_OK)
+                    goto fail;
+
                 // TLB entries are invalidated per GPU VA space
                 status = uvm_ats_invalidate_tlbs(gpu_va_space, ats_invalidate, &batch_context->tracker);
                 if (status != NV_OK)
                     goto fail;
 
+                if (gpu_va_space) {
+                    status = uvm_tlb_batch_flush_deferred(&gpu_va_space->page_tables, &batch_context->tracker);
+                    if (status != NV_OK)
+                        goto fail;
+                }
+
                 uvm_va_space_up_read(va_space);
-                uvm_va_space_mm_release_unlock(va_space, mm);
+                uvm_va_space_mm_cached_unlock(mm);
                 mm = NULL;
             }
 
             va_space = current_entry->va_space;
+            va_space_max_faults = uvm_perf_fault_batch_faults_per_weight * current_entry->va_space_weight;
+            va_space_num_faults = 0;
 
             // ... and take the lock of the new one
 
             // If an mm is registered with the VA space, we have to retain it
             // in order to lock it before locking the VA space. It is guaranteed
-            // to remain valid until we release. If no mm is registered, we
-            // can only service managed faults, not ATS/HMM faults.
-            mm = uvm_va_space_mm_retain_lock(va_space);
+            // to remain valid until the retention cache is flushed at the end
+            // of the bottom half. If no mm is registered, we can only service
+            // managed faults, not ATS/HMM faults.
+            mm = uvm_va_space_mm_cached_retain_lock(&gpu->parent->fault_buffer_info.replayable.mm_retain_cache,
+                                                    va_space);
 
             uvm_va_space_down_read(va_space);
 
@@ -1559,15 +2621,58 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu,
             continue;
         }
 
+        if (limit_va_space_faults && va_space_num_faults >= va_space_max_faults) {
+            // The VA space already got its share of the batch. Its remaining
+            // faults are not serviced, so they are raised again after the
+            // replay and serviced in a later batch.
+            if (uvm_procfs_is_debug_enabled())
+                ++gpu->parent->fault_buffer_info.replayable.stats.num_deferred_faults;
+
+            ++i;
+            continue;
+        }
+
         // TODO: Bug 2103669: Service more than one ATS fault at a time so we
         //       don't do an unconditional VA range lookup for every ATS fault.
-        status = uvm_va_block_find_create(va_space, mm, current_entry->fault_address, &va_block);
-        if (status == NV_OK) {
+        va_block = uvm_gpu_va_space_fault_block_cache_lookup(gpu_va_space, current_entry->fault_address);
+        if (va_block) {
+            status = NV_OK;
+        }
+        else {
+            status = uvm_va_block_find_create(va_space, mm, current_entry->fault_address, &va_block);
+            if (status == NV_OK)
+                uvm_gpu_va_space_fault_block_cache_insert(gpu_va_space, va_block);
+        }
+        if (status == NV_OK && use_service_workers) {
+            uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->parent->fault_buffer_info.replayable;
+            uvm_fault_service_block_group_t *group =
+                &replayable_faults->service_workers.groups[replayable_faults->service_workers.num_groups++];
+
+            // Use the same criteria as service_batch_managed_faults_in_block
+            // to find the faults that belong to the block
+            for (block_faults = 1; i + block_faults < batch_context->num_coalesced_faults; ++block_faults) {
+                uvm_fault_buffer_entry_t *entry = batch_context->ordered_fault_cache[i + block_faults];
+
+                if (entry->va_space != va_space || entry->fault_address > va_block->end)
+                    break;
+            }
+
+            group->va_block          = va_block;
+            group->first_fault_index = i;
+            group->num_faults        = block_faults;
+
+            i += block_faults;
+            va_space_num_faults += block_faults;
+            continue;
+        }
+        else if (status == NV_OK) {
             status = service_batch_managed_faults_in_block(gpu_va_space->gpu,
                                                            mm,
                                                            va_block,
                                                            i,
+                                                           false,
                                                            batch_context,
+                                                           &gpu->parent->fault_buffer_info.replayable.block_service_context,
                                                            &block_faults);
 
             // When service_batch_managed_faults_in_block returns != NV_OK
@@ -1576,12 +2681,15 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu,
                 goto fail;
 
             i += block_faults;
+            va_space_num_faults += block_faults;
         }
         else {
             const uvm_fault_buffer_entry_t *previous_entry = i == 0? NULL : batch_context->ordered_fault_cache[i - 1];
 
             status = service_non_managed_fault(current_entry,
                                                previous_entry,
+                                               batch_context->ordered_fault_cache + i + 1,
+                                               batch_context->num_coalesced_faults - i - 1,
                                                status,
                                                gpu_va_space,
                                                mm,
@@ -1595,11 +2703,16 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu,
                 goto fail;
 
             ++i;
+            ++va_space_num_faults;
             continue;
         }
 
         // Don't issue replays in cancel mode
         if (replay_per_va_block) {
+            status = uvm_tlb_batch_flush_deferred(&gpu_va_space->page_tables, &batch_context->tracker);
+            if (status != NV_OK)
+                goto fail;
+
             status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
             if (status != NV_OK)
                 goto fail;
@@ -1614,15 +2727,37 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu,
     // Only clobber status if invalidate_status != NV_OK, since status may also
     // contain NV_WARN_MORE_PROCESSING_REQUIRED.
     if (va_space != NULL) {
-        NV_STATUS invalidate_status = uvm_ats_invalidate_tlbs(gpu_va_space, ats_invalidate, &batch_context->tracker);
+        NV_STATUS invalidate_status;
+
+        // Nothing is collected after a fault buffer flush, since the flush
+        // happens right after switching to a new VA space
+        NV_STATUS dispatch_status = service_block_groups_dispatch(gpu->parent, gpu_va_space, mm, batch_context);
+        if (dispatch_status != NV_OK) {
+            status = dispatch_status;
+            goto fail;
+        }
+
+        invalidate_status = uvm_ats_invalidate_tlbs(gpu_va_space, ats_invalidate, &batch_context->tracker);
         if (invalidate_status != NV_OK)
             status = invalidate_status;
     }
 
 fail:
+    // Groups which were not dispatched are discarded on error
+    gpu->parent->fault_buffer_info.replayable.service_workers.num_groups = 0;
+
+    // Deferred TLB invalidates must be pushed before the VA space lock is
+    // dropped, since the GPU VA space may go away after that. This is also
+    // done on error, as the PTEs have already been written.
+    if (gpu_va_space != NULL) {
+        NV_STATUS flush_status = uvm_tlb_batch_flush_deferred(&gpu_va_space->page_tables, &batch_context->tracker);
+        if (flush_status != NV_OK && (status == NV_OK || status == NV_WARN_MORE_PROCESSING_REQUIRED))
+            status = flush_status;
+    }
+
     if (va_space != NULL) {
         uvm_va_space_up_read(va_space);
-        uvm_va_space_mm_release_unlock(va_space, mm);
+        uvm_va_space_mm_cached_unlock(mm);
     }
 
     return status;
@@ -2176,6 +3311,8 @@ void uvm_gpu_service_replayable_faults(uvm_gpu_t *gpu)
     NvU32 num_replays = 0;
     NvU32 num_batches = 0;
     NvU32 num_throttled = 0;
+    NvU32 num_fetched_faults = 0;
+    bool batch_in_progress = false;
     NV_STATUS status = NV_OK;
     uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->parent->fault_buffer_info.replayable;
     uvm_fault_service_batch_context_t *batch_context = &replayable_faults->batch_service_context;
@@ -2186,11 +3323,35 @@ void uvm_gpu_service_replayable_faults(uvm_gpu_t *gpu)
 
     // Process all faults in the buffer
     while (1) {
-        if (num_throttled >= uvm_perf_fault_max_throttle_per_service ||
-            num_batches >= uvm_perf_fault_max_batches_per_service) {
+        NvU64 batch_start_time;
+        NvU64 stage_start_time;
+
+        // Batches are closed here rather than at each exit of the loop body,
+        // which has several continue paths
+        if (batch_in_progress) {
+            trace_uvm_fault_batch_end(uvm_id_value(gpu->id),
+                                      batch_context->batch_id,
+                                      batch_context->num_duplicate_faults,
+                                      batch_context->num_replays,
+                                      status);
+            batch_in_progress = false;
+        }
+
+        if (num_throttled >= uvm_perf_fault_max_throttle_per_service)
+            break;
+
+        // The adaptive controller changes the batch size, so the limit is
+        // enforced on the number of fetched faults instead
+        if (replayable_faults->adaptive.enabled) {
+            if (num_fetched_faults >= replayable_faults->adaptive.max_faults_per_service)
+                break;
+        }
+        else if (num_batches >= uvm_perf_fault_max_batches_per_service) {
             break;
         }
 
+        batch_start_time = NV_GETTIME();
+
         batch_context->num_invalid_prefetch_faults = 0;
         batch_context->num_duplicate_faults        = 0;
         batch_context->num_replays                 = 0;
@@ -2201,8 +3362,15 @@ void uvm_gpu_service_replayable_faults(uvm_gpu_t *gpu)
         if (batch_context->num_cached_faults == 0)
             break;
 
+        record_stage_latency(gpu->parent, UVM_FAULT_SERVICE_STAGE_FETCH, NV_GETTIME() - batch_start_time);
+
+        num_fetched_faults += batch_context->num_cached_faults;
+
         ++batch_context->batch_id;
 
+        trace_uvm_fault_batch_begin(uvm_id_value(gpu->id), batch_context->batch_id, batch_context->num_cached_faults);
+        batch_in_progress = true;
+
         status = preprocess_fault_batch(gpu, batch_context);
 
         num_replays += batch_context->num_replays;
@@ -2212,7 +3380,9 @@ void uvm_gpu_service_replayable_faults(uvm_gpu_t *gpu)
         else if (status != NV_OK)
             break;
 
+        stage_start_time = NV_GETTIME();
         status = service_fault_batch(gpu, FAULT_SERVICE_MODE_REGULAR, batch_context);
+        record_stage_latency(gpu->parent, UVM_FAULT_SERVICE_STAGE_SERVICE, NV_GETTIME() - stage_start_time);
 
         // We may have issued replays even if status != NV_OK if
         // UVM_PERF_FAULT_REPLAY_POLICY_BLOCK is being used or the fault buffer
@@ -2243,6 +3413,7 @@ void uvm_gpu_service_replayable_faults(uvm_gpu_t *gpu)
             break;
         }
 
+        stage_start_time = NV_GETTIME();
         if (replayable_faults->replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH) {
             status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
             if (status != NV_OK)
@@ -2265,13 +3436,24 @@ void uvm_gpu_service_replayable_faults(uvm_gpu_t *gpu)
             if (status != NV_OK)
                 break;
         }
+        record_stage_latency(gpu->parent, UVM_FAULT_SERVICE_STAGE_REPLAY, NV_GETTIME() - stage_start_time);
 
         if (batch_context->has_throttled_faults)
             ++num_throttled;
 
+        fault_batch_adaptive_update(gpu->parent, batch_context, NV_GETTIME() - batch_start_time);
+
         ++num_batches;
     }
 
+    if (batch_in_progress) {
+        trace_uvm_fault_batch_end(uvm_id_value(gpu->id),
+                                  batch_context->batch_id,
+                                  batch_context->num_duplicate_faults,
+                                  batch_context->num_replays,
+                                  status);
+    }
+
     if (status == NV_WARN_MORE_PROCESSING_REQUIRED)
         status = NV_OK;
 
@@ -2283,6 +3465,9 @@ void uvm_gpu_service_replayable_faults(uvm_gpu_t *gpu)
 
     uvm_tracker_deinit(&batch_context->tracker);
 
+    // Don't keep the mm retained while idle, as that would block its shutdown
+    uvm_va_space_mm_retain_cache_flush(&replayable_faults->mm_retain_cache);
+
     if (status != NV_OK)
         UVM_DBG_PRINT("Error servicing replayable faults on GPU: %s\n", uvm_gpu_name(gpu));
 }
@@ -2376,3 +3561,218 @@ NV_STATUS uvm_test_drain_replayable_faults(UVM_TEST_DRAIN_REPLAYABLE_FAULTS_PARA
 
     return status;
 }
+
+#define FAULT_BATCH_BENCHMARK_DEFAULT_STRIDE (64 * 1024)
+#define FAULT_BATCH_BENCHMARK_DEFAULT_DUPLICATES 4
+
+// Generate a synthetic batch of faults following the pattern in params, and
+// cache it in the same way fetch_fault_buffer_entries() caches the entries it
+// reads from the fault buffer. next_page is the index of the first page not
+// used by previous batches and is updated for the next one.
+static void fault_batch_benchmark_fill(uvm_gpu_t *gpu,
+                                       uvm_va_space_t *va_space,
+                                       UVM_TEST_FAULT_BATCH_BENCHMARK_PARAMS *params,
+                                       uvm_test_rng_t *rng,
+                                       NvU64 *next_page)
+{
+    uvm_fault_service_batch_context_t *batch_context = &gpu->parent->fault_buffer_info.replayable.batch_service_context;
+    const bool may_filter = uvm_perf_fault_coalesce != 0;
+    const bool may_filter_hashed = may_filter && uvm_perf_fault_coalesce_hash;
+    const NvU64 num_pages = params->length / PAGE_SIZE;
+    const NvU32 num_unique_pages = max(params->batch_size / params->duplicates, 1u);
+    NvU32 num_coalesced_faults = 0;
+    NvU32 i;
+
+    fetch_fault_buffer_reset_batch(batch_context, may_filter_hashed);
+
+    for (i = 0; i < params->batch_size; ++i) {
+        uvm_fault_buffer_entry_t *current_entry = &batch_context->fault_cache[i];
+        NvU64 page_index;
+
+        switch (params->pattern) {
+            case UVM_TEST_FAULT_BATCH_PATTERN_SEQUENTIAL:
+                page_index = *next_page + i;
+                break;
+            case UVM_TEST_FAULT_BATCH_PATTERN_STRIDED:
+                page_index = (*next_page + i) * (params->stride / PAGE_SIZE);
+                break;
+            case UVM_TEST_FAULT_BATCH_PATTERN_RANDOM:
+                page_index = uvm_test_rng_range_64(rng, 0, num_pages - 1);
+                break;
+            default:
+                UVM_ASSERT(params->pattern == UVM_TEST_FAULT_BATCH_PATTERN_DUPLICATE);
+                page_index = *next_page + i % num_unique_pages;
+                break;
+        }
+
+        memset(current_entry, 0, sizeof(*current_entry));
+        current_entry->fault_address = params->base + (page_index % num_pages) * PAGE_SIZE;
+        current_entry->timestamp = NV_GETTIME();
+        current_entry->fault_source.client_type = UVM_FAULT_CLIENT_TYPE_GPC;
+        current_entry->fault_source.mmu_engine_type = UVM_MMU_ENGINE_TYPE_GRAPHICS;
+        current_entry->fault_type = UVM_FAULT_TYPE_INVALID_PTE;
+        current_entry->fault_access_type = params->write ? UVM_FAULT_ACCESS_TYPE_WRITE : UVM_FAULT_ACCESS_TYPE_READ;
+        current_entry->is_replayable = true;
+        current_entry->is_virtual = true;
+        current_entry->replayable.cancel_va_mode = UVM_FAULT_CANCEL_VA_MODE_ALL;
+
+        if (!fetch_fault_buffer_cache_entry(gpu, batch_context, i, may_filter, may_filter_hashed))
+            ++num_coalesced_faults;
+    }
+
+    // All the entries share the same fake instance pointer, which can't be
+    // translated
+    for (i = 0; i < params->batch_size; ++i) {
+        batch_context->fault_cache[i].va_space = va_space;
+        batch_context->fault_cache[i].va_space_weight = READ_ONCE(va_space->fault_service_weight);
+    }
+
+    if (params->pattern == UVM_TEST_FAULT_BATCH_PATTERN_DUPLICATE)
+        *next_page += num_unique_pages;
+    else
+        *next_page += params->batch_size;
+
+    batch_context->num_cached_faults = params->batch_size;
+    batch_context->num_coalesced_faults = num_coalesced_faults;
+}
+
+NV_STATUS uvm_test_fault_batch_benchmark(UVM_TEST_FAULT_BATCH_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    uvm_gpu_t *gpu;
+    uvm_va_range_t *va_range;
+    uvm_fault_service_batch_context_t *batch_context;
+    uvm_test_rng_t rng;
+    NvU64 next_page = 0;
+    NV_STATUS status = NV_OK;
+    NV_STATUS tracker_status;
+    NvU32 i;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+
+    if (params->pattern >= UVM_TEST_FAULT_BATCH_PATTERN_MAX)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->stride == 0)
+        params->stride = FAULT_BATCH_BENCHMARK_DEFAULT_STRIDE;
+    if (params->duplicates == 0)
+        params->duplicates = FAULT_BATCH_BENCHMARK_DEFAULT_DUPLICATES;
+
+    if (!PAGE_ALIGNED(params->base) ||
+        !PAGE_ALIGNED(params->length) ||
+        !PAGE_ALIGNED(params->stride) ||
+        params->length == 0 ||
+        params->base + params->length < params->base)
+        return NV_ERR_INVALID_ADDRESS;
+
+    gpu = uvm_va_space_retain_gpu_by_uuid(va_space, &params->gpu_uuid);
+    if (!gpu)
+        return NV_ERR_INVALID_DEVICE;
+
+    if (!gpu->parent->replayable_faults_supported) {
+        status = NV_ERR_NOT_SUPPORTED;
+        goto out;
+    }
+
+    if (params->batch_size == 0)
+        params->batch_size = gpu->parent->fault_buffer_info.max_batch_size;
+
+    if (params->batch_size > gpu->parent->fault_buffer_info.max_batch_size) {
+        status = NV_ERR_INVALID_ARGUMENT;
+        goto out;
+    }
+
+    // The range could go away once the lock is dropped. Faults on it would
+    // then be fatal, which is reported below.
+    uvm_va_space_down_read(va_space);
+    va_range = uvm_va_range_find(va_space, params->base);
+    if (!va_range ||
+        va_range->type != UVM_VA_RANGE_TYPE_MANAGED ||
+        va_range->node.end < params->base + params->length - 1)
+        status = NV_ERR_INVALID_ADDRESS;
+    else if (!uvm_gpu_va_space_get(va_space, gpu))
+        status = NV_ERR_INVALID_DEVICE;
+    uvm_va_space_up_read(va_space);
+
+    if (status != NV_OK)
+        goto out;
+
+    params->num_faults = 0;
+    params->num_coalesced_faults = 0;
+    memset(params->stage_ns, 0, sizeof(params->stage_ns));
+
+    uvm_test_rng_init(&rng, params->seed);
+
+    // Take the bottom half lock, so the batch context can be used
+    uvm_gpu_replayable_faults_isr_lock(gpu->parent);
+
+    batch_context = &gpu->parent->fault_buffer_info.replayable.batch_service_context;
+    uvm_tracker_init(&batch_context->tracker);
+    batch_context->is_synthetic = true;
+
+    for (i = 0; i < params->num_batches; ++i) {
+        NvU64 start;
+
+        if (fatal_signal_pending(current)) {
+            status = NV_ERR_SIGNAL_PENDING;
+            break;
+        }
+
+        batch_context->num_invalid_prefetch_faults = 0;
+        batch_context->num_duplicate_faults        = 0;
+        batch_context->num_replays                 = 0;
+        batch_context->has_fatal_faults            = false;
+        batch_context->has_throttled_faults        = false;
+
+        start = NV_GETTIME();
+        fault_batch_benchmark_fill(gpu, va_space, params, &rng, &next_page);
+        params->stage_ns[UVM_TEST_FAULT_BATCH_STAGE_FETCH] += NV_GETTIME() - start;
+
+        params->num_faults += batch_context->num_cached_faults;
+        params->num_coalesced_faults += batch_context->num_coalesced_faults;
+
+        ++batch_context->batch_id;
+
+        start = NV_GETTIME();
+        status = preprocess_fault_batch(gpu, batch_context);
+        params->stage_ns[UVM_TEST_FAULT_BATCH_STAGE_SORT] += NV_GETTIME() - start;
+        if (status != NV_OK)
+            break;
+
+        start = NV_GETTIME();
+        status = service_fault_batch(gpu, FAULT_SERVICE_MODE_REGULAR, batch_context);
+        params->stage_ns[UVM_TEST_FAULT_BATCH_STAGE_SERVICE] += NV_GETTIME() - start;
+
+        // A pending flush of the fault buffer requested by a GPU VA space
+        // interrupts the batch, as in the bottom half
+        if (status == NV_WARN_MORE_PROCESSING_REQUIRED)
+            status = NV_OK;
+        if (status != NV_OK)
+            break;
+
+        start = NV_GETTIME();
+        status = uvm_tracker_wait(&batch_context->tracker);
+        params->stage_ns[UVM_TEST_FAULT_BATCH_STAGE_WAIT] += NV_GETTIME() - start;
+        if (status != NV_OK)
+            break;
+
+        // Synthetic faults can't be cancelled, so just report them
+        if (batch_context->has_fatal_faults) {
+            status = NV_ERR_INVALID_ADDRESS;
+            break;
+        }
+    }
+
+    tracker_status = uvm_tracker_wait_deinit(&batch_context->tracker);
+    if (status == NV_OK)
+        status = tracker_status;
+
+    batch_context->is_synthetic = false;
+
+    uvm_va_space_mm_retain_cache_flush(&gpu->parent->fault_buffer_info.replayable.mm_retain_cache);
+
+    uvm_gpu_replayable_faults_isr_unlock(gpu->parent);
+
+out:
+    uvm_gpu_release(gpu);
+
+    return status;
+}
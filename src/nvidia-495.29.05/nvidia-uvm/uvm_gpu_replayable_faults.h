@@ -52,6 +52,10 @@ typedef enum
 
 const char *uvm_perf_fault_replay_policy_string(uvm_perf_fault_replay_policy_t fault_replay);
 
+// Weight of new samples in the moving averages of the adaptive fault batch
+// controller: 1/2^shift. Averages of percentages are stored scaled by 2^shift.
+#define UVM_PERF_FAULT_BATCH_ADAPTIVE_AVG_SHIFT 3
+
 NV_STATUS uvm_gpu_fault_buffer_init(uvm_parent_gpu_t *parent_gpu);
 void uvm_gpu_fault_buffer_deinit(uvm_parent_gpu_t *parent_gpu);
 
@@ -75,4 +79,8 @@ void uvm_gpu_disable_prefetch_faults(uvm_parent_gpu_t *parent_gpu);
 // only called from the ISR bottom half
 void uvm_gpu_service_replayable_faults(uvm_gpu_t *gpu);
 
+// Add the latencies of a sampled fault replay to the histogram once its push
+// has completed. Called from uvm_pushbuffer_mark_completed().
+void uvm_gpu_fault_replay_latency_complete(uvm_fault_replay_latency_t *replay_latency);
+
 #endif // __UVM_GPU_PAGE_FAULT_H__
@@ -30,11 +30,40 @@
 #define UVM_SEMAPHORE_PAGE_SIZE PAGE_SIZE
 #define UVM_SEMAPHORE_COUNT_PER_PAGE (PAGE_SIZE / UVM_SEMAPHORE_SIZE)
 
+// Pool pages are carved out of slabs of this many pages. Each slab is a single
+// RM allocation, mapped once on the CPU and on each GPU, instead of one
+// allocation and set of mappings per page.
+#define UVM_SEMAPHORE_SLAB_PAGE_COUNT 16
+#define UVM_SEMAPHORE_SLAB_SIZE (UVM_SEMAPHORE_SLAB_PAGE_COUNT * UVM_SEMAPHORE_PAGE_SIZE)
+
+// Stride of semaphores allocated with the padded layout. Each payload gets a
+// CPU cache line of its own.
+#define UVM_SEMAPHORE_PADDED_SIZE max_t(NvU32, L1_CACHE_BYTES, UVM_SEMAPHORE_SIZE)
+
 // The top nibble of the canary base is intentionally 0. The rest of the value
 // is arbitrary. See the comments below on make_canary.
 #define UVM_SEMAPHORE_CANARY_BASE     0x0badc0de
 #define UVM_SEMAPHORE_CANARY_MASK     0xf0000000
 
+// Tracking semaphores are polled by the CPU on every channel progress update
+// while the GPU keeps releasing them. When packed, the payloads of unrelated
+// channels share cache lines, so each GPU release invalidates the line the CPU
+// is polling for other channels too. With padding enabled, tracking semaphores
+// are allocated from pages with one semaphore per cache line.
+static int uvm_gpu_tracking_semaphore_padding = 1;
+module_param(uvm_gpu_tracking_semaphore_padding, int, S_IRUGO);
+
+typedef enum
+{
+    // Semaphores are UVM_SEMAPHORE_SIZE apart
+    UVM_GPU_SEMAPHORE_LAYOUT_PACKED,
+
+    // Semaphores are UVM_SEMAPHORE_PADDED_SIZE apart
+    UVM_GPU_SEMAPHORE_LAYOUT_PADDED,
+
+    UVM_GPU_SEMAPHORE_LAYOUT_COUNT
+} uvm_gpu_semaphore_layout_t;
+
 struct uvm_gpu_semaphore_pool_struct
 {
     // The GPU owning the pool
@@ -43,41 +72,93 @@ struct uvm_gpu_semaphore_pool_struct
     // List of all the semaphore pages belonging to the pool
     struct list_head pages;
 
-    // Count of free semaphores among all the pages
-    NvU32 free_semaphores_count;
+    // List of all the slabs backing the pages of the pool. Pages are taken
+    // from the first slab, which is the most recently allocated one.
+    struct list_head slabs;
+
+    // Count of free semaphores among all the pages of each layout
+    NvU32 free_semaphores_count[UVM_GPU_SEMAPHORE_LAYOUT_COUNT];
 
     // Lock protecting the state of the pool
     uvm_mutex_t mutex;
 };
 
-struct uvm_gpu_semaphore_pool_page_struct
+typedef struct
 {
-    // Allocation backing the page
+    // Allocation backing the slab
     uvm_rm_mem_t *memory;
 
+    // Number of pages of the slab handed out to the pool. Pages are only
+    // returned to the slab when the pool is destroyed.
+    NvU32 num_used_pages;
+
+    // Node in the list of all slabs in a semaphore pool
+    struct list_head slabs_node;
+} uvm_gpu_semaphore_pool_slab_t;
+
+struct uvm_gpu_semaphore_pool_page_struct
+{
+    // Slab backing the page
+    uvm_gpu_semaphore_pool_slab_t *slab;
+
+    // Offset of the page within the slab
+    NvU32 slab_offset;
+
     // Pool the page is part of
     uvm_gpu_semaphore_pool_t *pool;
 
     // Node in the list of all pages in a semaphore pool
     struct list_head all_pages_node;
 
-    // Mask indicating free semaphore indices within the page
+    // Layout of all the semaphores within the page
+    uvm_gpu_semaphore_layout_t layout;
+
+    // Mask indicating free semaphore indices within the page. Only the first
+    // page_semaphore_count() bits are used.
     DECLARE_BITMAP(free_semaphores, UVM_SEMAPHORE_COUNT_PER_PAGE);
 };
 
+static NvU32 page_semaphore_stride(uvm_gpu_semaphore_pool_page_t *page)
+{
+    if (page->layout == UVM_GPU_SEMAPHORE_LAYOUT_PADDED)
+        return UVM_SEMAPHORE_PADDED_SIZE;
+
+    return UVM_SEMAPHORE_SIZE;
+}
+
+static NvU32 page_semaphore_count(uvm_gpu_semaphore_pool_page_t *page)
+{
+    return UVM_SEMAPHORE_PAGE_SIZE / page_semaphore_stride(page);
+}
+
+static void *page_get_cpu_va(uvm_gpu_semaphore_pool_page_t *page)
+{
+    return (char*)uvm_rm_mem_get_cpu_va(page->slab->memory) + page->slab_offset;
+}
+
+static NvU32 *page_get_payload(uvm_gpu_semaphore_pool_page_t *page, NvU32 index)
+{
+    UVM_ASSERT(index < page_semaphore_count(page));
+
+    return (NvU32*)((char*)page_get_cpu_va(page) + index * page_semaphore_stride(page));
+}
+
 static NvU32 get_index(uvm_gpu_semaphore_t *semaphore)
 {
     NvU32 offset;
     NvU32 index;
+    NvU32 stride;
 
     UVM_ASSERT(semaphore->payload != NULL);
     UVM_ASSERT(semaphore->page != NULL);
 
-    offset = (char*)semaphore->payload - (char*)uvm_rm_mem_get_cpu_va(semaphore->page->memory);
-    UVM_ASSERT(offset % UVM_SEMAPHORE_SIZE == 0);
+    stride = page_semaphore_stride(semaphore->page);
 
-    index = offset / UVM_SEMAPHORE_SIZE;
-    UVM_ASSERT(index < UVM_SEMAPHORE_COUNT_PER_PAGE);
+    offset = (char*)semaphore->payload - (char*)page_get_cpu_va(semaphore->page);
+    UVM_ASSERT(offset % stride == 0);
+
+    index = offset / stride;
+    UVM_ASSERT(index < page_semaphore_count(semaphore->page));
 
     return index;
 }
@@ -117,12 +198,42 @@ static bool is_canary(NvU32 val)
     return (val & ~UVM_SEMAPHORE_CANARY_MASK) == UVM_SEMAPHORE_CANARY_BASE;
 }
 
-static NV_STATUS pool_alloc_page(uvm_gpu_semaphore_pool_t *pool)
+static NV_STATUS pool_alloc_slab(uvm_gpu_semaphore_pool_t *pool)
+{
+    NV_STATUS status;
+    uvm_gpu_semaphore_pool_slab_t *slab;
+
+    uvm_assert_mutex_locked(&pool->mutex);
+
+    slab = uvm_kvmalloc_zero(sizeof(*slab));
+    if (!slab)
+        return NV_ERR_NO_MEMORY;
+
+    status = uvm_rm_mem_alloc_and_map_all(pool->gpu, UVM_RM_MEM_TYPE_SYS, UVM_SEMAPHORE_SLAB_SIZE, &slab->memory);
+    if (status != NV_OK) {
+        uvm_kvfree(slab);
+        return status;
+    }
+
+    list_add(&slab->slabs_node, &pool->slabs);
+
+    return NV_OK;
+}
+
+static void pool_free_slab(uvm_gpu_semaphore_pool_slab_t *slab)
+{
+    list_del(&slab->slabs_node);
+    uvm_rm_mem_free(slab->memory);
+    uvm_kvfree(slab);
+}
+
+static NV_STATUS pool_alloc_page(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_layout_t layout)
 {
     NV_STATUS status;
     uvm_gpu_semaphore_pool_page_t *pool_page;
-    NvU32 *payloads;
-    size_t i;
+    uvm_gpu_semaphore_pool_slab_t *slab;
+    NvU32 count;
+    NvU32 i;
 
     uvm_assert_mutex_locked(&pool->mutex);
 
@@ -132,22 +243,32 @@ static NV_STATUS pool_alloc_page(uvm_gpu_semaphore_pool_t *pool)
         return NV_ERR_NO_MEMORY;
 
     pool_page->pool = pool;
+    pool_page->layout = layout;
+    count = page_semaphore_count(pool_page);
 
-    status = uvm_rm_mem_alloc_and_map_all(pool->gpu, UVM_RM_MEM_TYPE_SYS, UVM_SEMAPHORE_PAGE_SIZE, &pool_page->memory);
-    if (status != NV_OK)
-        goto error;
+    slab = list_first_entry_or_null(&pool->slabs, uvm_gpu_semaphore_pool_slab_t, slabs_node);
+    if (!slab || slab->num_used_pages == UVM_SEMAPHORE_SLAB_PAGE_COUNT) {
+        status = pool_alloc_slab(pool);
+        if (status != NV_OK)
+            goto error;
+
+        slab = list_first_entry(&pool->slabs, uvm_gpu_semaphore_pool_slab_t, slabs_node);
+    }
+
+    pool_page->slab = slab;
+    pool_page->slab_offset = slab->num_used_pages * UVM_SEMAPHORE_PAGE_SIZE;
+    ++slab->num_used_pages;
 
     // All semaphores are initially free
-    bitmap_fill(pool_page->free_semaphores, UVM_SEMAPHORE_COUNT_PER_PAGE);
+    bitmap_fill(pool_page->free_semaphores, count);
 
     list_add(&pool_page->all_pages_node, &pool->pages);
-    pool->free_semaphores_count += UVM_SEMAPHORE_COUNT_PER_PAGE;
+    pool->free_semaphores_count[layout] += count;
 
     // Initialize the semaphore payloads to known values
     if (UVM_IS_DEBUG()) {
-        payloads = uvm_rm_mem_get_cpu_va(pool_page->memory);
-        for (i = 0; i < UVM_SEMAPHORE_COUNT_PER_PAGE; i++)
-            payloads[i] = make_canary(0);
+        for (i = 0; i < count; i++)
+            *page_get_payload(pool_page, i) = make_canary(0);
     }
 
     return NV_OK;
@@ -160,31 +281,39 @@ error:
 static void pool_free_page(uvm_gpu_semaphore_pool_page_t *page)
 {
     uvm_gpu_semaphore_pool_t *pool = page->pool;
-    NvU32 *payloads;
-    size_t i;
+    NvU32 count = page_semaphore_count(page);
+    NvU32 i;
 
     UVM_ASSERT(page);
 
     uvm_assert_mutex_locked(&pool->mutex);
 
     // Assert that no semaphores are still allocated
-    UVM_ASSERT(find_first_zero_bit(page->free_semaphores, UVM_SEMAPHORE_COUNT_PER_PAGE) == UVM_SEMAPHORE_COUNT_PER_PAGE);
-    UVM_ASSERT_MSG(pool->free_semaphores_count >= UVM_SEMAPHORE_COUNT_PER_PAGE, "count: %u\n", pool->free_semaphores_count);
+    UVM_ASSERT(find_first_zero_bit(page->free_semaphores, count) == count);
+    UVM_ASSERT_MSG(pool->free_semaphores_count[page->layout] >= count,
+                   "count: %u\n",
+                   pool->free_semaphores_count[page->layout]);
 
     // Check for semaphore release-after-free
     if (UVM_IS_DEBUG()) {
-        payloads = uvm_rm_mem_get_cpu_va(page->memory);
-        for (i = 0; i < UVM_SEMAPHORE_COUNT_PER_PAGE; i++)
-            UVM_ASSERT(is_canary(payloads[i]));
+        for (i = 0; i < count; i++)
+            UVM_ASSERT(is_canary(*page_get_payload(page, i)));
     }
 
-    pool->free_semaphores_count -= UVM_SEMAPHORE_COUNT_PER_PAGE;
+    pool->free_semaphores_count[page->layout] -= count;
     list_del(&page->all_pages_node);
-    uvm_rm_mem_free(page->memory);
+
+    // The slab is freed with its last page
+    UVM_ASSERT(page->slab->num_used_pages > 0);
+    if (--page->slab->num_used_pages == 0)
+        pool_free_slab(page->slab);
+
     uvm_kvfree(page);
 }
 
-NV_STATUS uvm_gpu_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_t *semaphore)
+static NV_STATUS semaphore_alloc(uvm_gpu_semaphore_pool_t *pool,
+                                 uvm_gpu_semaphore_layout_t layout,
+                                 uvm_gpu_semaphore_t *semaphore)
 {
     NV_STATUS status = NV_OK;
     uvm_gpu_semaphore_pool_page_t *page;
@@ -193,18 +322,24 @@ NV_STATUS uvm_gpu_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaph
 
     uvm_mutex_lock(&pool->mutex);
 
-    if (pool->free_semaphores_count == 0)
-        status = pool_alloc_page(pool);
+    if (pool->free_semaphores_count[layout] == 0)
+        status = pool_alloc_page(pool, layout);
 
     if (status != NV_OK)
         goto done;
 
     list_for_each_entry(page, &pool->pages, all_pages_node) {
-        NvU32 semaphore_index = find_first_bit(page->free_semaphores, UVM_SEMAPHORE_COUNT_PER_PAGE);
-        if (semaphore_index == UVM_SEMAPHORE_COUNT_PER_PAGE)
+        NvU32 count = page_semaphore_count(page);
+        NvU32 semaphore_index;
+
+        if (page->layout != layout)
+            continue;
+
+        semaphore_index = find_first_bit(page->free_semaphores, count);
+        if (semaphore_index == count)
             continue;
 
-        semaphore->payload = (NvU32*)((char*)uvm_rm_mem_get_cpu_va(page->memory) + semaphore_index * UVM_SEMAPHORE_SIZE);
+        semaphore->payload = page_get_payload(page, semaphore_index);
         semaphore->page = page;
 
         // Check for semaphore release-after-free
@@ -213,7 +348,7 @@ NV_STATUS uvm_gpu_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaph
         uvm_gpu_semaphore_set_payload(semaphore, 0);
 
         __clear_bit(semaphore_index, page->free_semaphores);
-        --pool->free_semaphores_count;
+        --pool->free_semaphores_count[layout];
 
         goto done;
     }
@@ -227,6 +362,11 @@ done:
     return status;
 }
 
+NV_STATUS uvm_gpu_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_t *semaphore)
+{
+    return semaphore_alloc(pool, UVM_GPU_SEMAPHORE_LAYOUT_PACKED, semaphore);
+}
+
 void uvm_gpu_semaphore_free(uvm_gpu_semaphore_t *semaphore)
 {
     uvm_gpu_semaphore_pool_page_t *page;
@@ -255,7 +395,7 @@ void uvm_gpu_semaphore_free(uvm_gpu_semaphore_t *semaphore)
     semaphore->page = NULL;
     semaphore->payload = NULL;
 
-    ++pool->free_semaphores_count;
+    ++pool->free_semaphores_count[page->layout];
     __set_bit(index, page->free_semaphores);
 
     uvm_mutex_unlock(&pool->mutex);
@@ -272,8 +412,8 @@ NV_STATUS uvm_gpu_semaphore_pool_create(uvm_gpu_t *gpu, uvm_gpu_semaphore_pool_t
     uvm_mutex_init(&pool->mutex, UVM_LOCK_ORDER_GPU_SEMAPHORE_POOL);
 
     INIT_LIST_HEAD(&pool->pages);
+    INIT_LIST_HEAD(&pool->slabs);
 
-    pool->free_semaphores_count = 0;
     pool->gpu = gpu;
 
     *pool_out = pool;
@@ -285,6 +425,7 @@ void uvm_gpu_semaphore_pool_destroy(uvm_gpu_semaphore_pool_t *pool)
 {
     uvm_gpu_semaphore_pool_page_t *page;
     uvm_gpu_semaphore_pool_page_t *next_page;
+    uvm_gpu_semaphore_layout_t layout;
 
     if (!pool)
         return;
@@ -298,8 +439,10 @@ void uvm_gpu_semaphore_pool_destroy(uvm_gpu_semaphore_pool_t *pool)
     list_for_each_entry_safe(page, next_page, &pool->pages, all_pages_node)
         pool_free_page(page);
 
-    UVM_ASSERT_MSG(pool->free_semaphores_count == 0, "unused: %u", pool->free_semaphores_count);
+    for (layout = 0; layout < UVM_GPU_SEMAPHORE_LAYOUT_COUNT; layout++)
+        UVM_ASSERT_MSG(pool->free_semaphores_count[layout] == 0, "unused: %u", pool->free_semaphores_count[layout]);
     UVM_ASSERT(list_empty(&pool->pages));
+    UVM_ASSERT(list_empty(&pool->slabs));
 
     uvm_mutex_unlock(&pool->mutex);
 
@@ -309,15 +452,15 @@ void uvm_gpu_semaphore_pool_destroy(uvm_gpu_semaphore_pool_t *pool)
 NV_STATUS uvm_gpu_semaphore_pool_map_gpu(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_t *gpu)
 {
     NV_STATUS status = NV_OK;
-    uvm_gpu_semaphore_pool_page_t *page;
+    uvm_gpu_semaphore_pool_slab_t *slab;
 
     UVM_ASSERT(pool);
     UVM_ASSERT(gpu);
 
     uvm_mutex_lock(&pool->mutex);
 
-    list_for_each_entry(page, &pool->pages, all_pages_node) {
-        status = uvm_rm_mem_map_gpu(page->memory, gpu);
+    list_for_each_entry(slab, &pool->slabs, slabs_node) {
+        status = uvm_rm_mem_map_gpu(slab->memory, gpu);
         if (status != NV_OK)
             goto done;
     }
@@ -330,15 +473,15 @@ done:
 
 void uvm_gpu_semaphore_pool_unmap_gpu(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_t *gpu)
 {
-    uvm_gpu_semaphore_pool_page_t *page;
+    uvm_gpu_semaphore_pool_slab_t *slab;
 
     UVM_ASSERT(pool);
     UVM_ASSERT(gpu);
 
     uvm_mutex_lock(&pool->mutex);
 
-    list_for_each_entry(page, &pool->pages, all_pages_node)
-        uvm_rm_mem_unmap_gpu(page->memory, gpu);
+    list_for_each_entry(slab, &pool->slabs, slabs_node)
+        uvm_rm_mem_unmap_gpu(slab->memory, gpu);
 
     uvm_mutex_unlock(&pool->mutex);
 }
@@ -356,9 +499,10 @@ NvU64 uvm_gpu_semaphore_get_gpu_proxy_va(uvm_gpu_semaphore_t *semaphore, uvm_gpu
 NvU64 uvm_gpu_semaphore_get_gpu_va(uvm_gpu_semaphore_t *semaphore, uvm_gpu_t *gpu, bool is_proxy_va_space)
 {
     NvU32 index = get_index(semaphore);
-    NvU64 base_va = uvm_rm_mem_get_gpu_va(semaphore->page->memory, gpu, is_proxy_va_space);
+    NvU64 base_va = uvm_rm_mem_get_gpu_va(semaphore->page->slab->memory, gpu, is_proxy_va_space) +
+                    semaphore->page->slab_offset;
 
-    return base_va + UVM_SEMAPHORE_SIZE * index;
+    return base_va + page_semaphore_stride(semaphore->page) * index;
 }
 
 NvU32 uvm_gpu_semaphore_get_payload(uvm_gpu_semaphore_t *semaphore)
@@ -412,7 +556,11 @@ NV_STATUS uvm_gpu_tracking_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_g
 
     memset(tracking_sem, 0, sizeof(*tracking_sem));
 
-    status = uvm_gpu_semaphore_alloc(pool, &tracking_sem->semaphore);
+    if (uvm_gpu_tracking_semaphore_padding)
+        status = semaphore_alloc(pool, UVM_GPU_SEMAPHORE_LAYOUT_PADDED, &tracking_sem->semaphore);
+    else
+        status = semaphore_alloc(pool, UVM_GPU_SEMAPHORE_LAYOUT_PACKED, &tracking_sem->semaphore);
+
     if (status != NV_OK)
         return status;
 
@@ -523,6 +671,19 @@ NvU64 uvm_gpu_tracking_semaphore_update_completed_value(uvm_gpu_tracking_semapho
     return completed;
 }
 
+NvU64 uvm_gpu_tracking_semaphore_get_completed_value(uvm_gpu_tracking_semaphore_t *tracking_sem)
+{
+    NvU64 completed = atomic64_read(&tracking_sem->completed_value);
+
+    // Check that the GPU which owns the semaphore is still present
+    UVM_ASSERT(tracking_semaphore_check_gpu(tracking_sem));
+
+    // See the comment in uvm_gpu_tracking_semaphore_is_value_completed()
+    smp_mb__after_atomic();
+
+    return completed;
+}
+
 bool uvm_gpu_tracking_semaphore_is_value_completed(uvm_gpu_tracking_semaphore_t *tracking_sem, NvU64 value)
 {
     NvU64 completed = atomic64_read(&tracking_sem->completed_value);
@@ -172,6 +172,16 @@ bool uvm_gpu_tracking_semaphore_is_value_completed(uvm_gpu_tracking_semaphore_t
 // called from multiple threads.
 NvU64 uvm_gpu_tracking_semaphore_update_completed_value(uvm_gpu_tracking_semaphore_t *tracking_sem);
 
+// Return the completed value as of the last update, without reading the GPU
+// semaphore.
+//
+// Provides the same guarantees as uvm_gpu_tracking_semaphore_update_completed_value()
+// for the returned value, but it may lag behind the semaphore payload.
+//
+// Locking: this operation is internally synchronized and hence safe to be
+// called from multiple threads.
+NvU64 uvm_gpu_tracking_semaphore_get_completed_value(uvm_gpu_tracking_semaphore_t *tracking_sem);
+
 // See the comments for uvm_gpu_tracking_semaphore_is_value_completed
 static bool uvm_gpu_tracking_semaphore_is_completed(uvm_gpu_tracking_semaphore_t *tracking_sem)
 {
@@ -72,6 +72,7 @@ static uvm_hal_class_ops_t ce_table[] =
             .plc_mode = uvm_hal_maxwell_ce_plc_mode,
             .memcopy = uvm_hal_maxwell_ce_memcopy,
             .memcopy_v_to_v = uvm_hal_maxwell_ce_memcopy_v_to_v,
+            .memcopy_2d = uvm_hal_maxwell_ce_memcopy_2d,
             .memset_1 = uvm_hal_maxwell_ce_memset_1,
             .memset_4 = uvm_hal_maxwell_ce_memset_4,
             .memset_8 = uvm_hal_maxwell_ce_memset_8,
@@ -351,6 +352,7 @@ static uvm_hal_class_ops_t fault_buffer_table[] =
             .write_get = uvm_hal_maxwell_fault_buffer_write_get_unsupported,
             .get_ve_id = uvm_hal_maxwell_fault_buffer_get_ve_id_unsupported,
             .parse_entry = uvm_hal_maxwell_fault_buffer_parse_entry_unsupported,
+            .parse_entries = uvm_hal_maxwell_fault_buffer_parse_entries_unsupported,
             .entry_is_valid = uvm_hal_maxwell_fault_buffer_entry_is_valid_unsupported,
             .entry_clear_valid = uvm_hal_maxwell_fault_buffer_entry_clear_valid_unsupported,
             .entry_size = uvm_hal_maxwell_fault_buffer_entry_size_unsupported,
@@ -373,6 +375,7 @@ static uvm_hal_class_ops_t fault_buffer_table[] =
             .read_get = uvm_hal_pascal_fault_buffer_read_get,
             .write_get = uvm_hal_pascal_fault_buffer_write_get,
             .parse_entry = uvm_hal_pascal_fault_buffer_parse_entry,
+            .parse_entries = uvm_hal_pascal_fault_buffer_parse_entries,
             .entry_is_valid = uvm_hal_pascal_fault_buffer_entry_is_valid,
             .entry_clear_valid = uvm_hal_pascal_fault_buffer_entry_clear_valid,
             .entry_size = uvm_hal_pascal_fault_buffer_entry_size,
@@ -387,6 +390,7 @@ static uvm_hal_class_ops_t fault_buffer_table[] =
             .write_get = uvm_hal_volta_fault_buffer_write_get,
             .get_ve_id = uvm_hal_volta_fault_buffer_get_ve_id,
             .parse_entry = uvm_hal_volta_fault_buffer_parse_entry,
+            .parse_entries = uvm_hal_volta_fault_buffer_parse_entries,
             .parse_non_replayable_entry = uvm_hal_volta_fault_buffer_parse_non_replayable_entry,
         }
     },
@@ -32,6 +32,22 @@
 #include "uvm_gpu.h"
 #include "uvm_test_ioctl.h"
 
+// Call a HAL function pointer, first comparing it against the implementations
+// most likely to be installed so that those are called directly. When
+// retpolines are enabled an indirect call is much more expensive than a compare
+// and a well-predicted branch, which matters for the HAL ops called for each
+// fault entry, PTE or copy in the servicing loops. See the uvm_hal_*()
+// wrappers at the end of this file.
+#if defined(CONFIG_RETPOLINE)
+    #define UVM_HAL_CALL_1(f, f1, ...)                                          \
+        (likely((f) == (f1)) ? (f1)(__VA_ARGS__) : (f)(__VA_ARGS__))
+    #define UVM_HAL_CALL_2(f, f2, f1, ...)                                      \
+        (likely((f) == (f2)) ? (f2)(__VA_ARGS__) : UVM_HAL_CALL_1(f, f1, __VA_ARGS__))
+#else
+    #define UVM_HAL_CALL_1(f, f1, ...) (f)(__VA_ARGS__)
+    #define UVM_HAL_CALL_2(f, f2, f1, ...) (f)(__VA_ARGS__)
+#endif
+
 typedef void (*uvm_hal_init_t)(uvm_push_t *push);
 void uvm_hal_maxwell_ce_init(uvm_push_t *push);
 void uvm_hal_maxwell_host_init_noop(uvm_push_t *push);
@@ -275,6 +291,26 @@ void uvm_hal_maxwell_ce_memcopy(uvm_push_t *push, uvm_gpu_address_t dst, uvm_gpu
 typedef void (*uvm_hal_memcopy_v_to_v_t)(uvm_push_t *push, NvU64 dst, NvU64 src, size_t size);
 void uvm_hal_maxwell_ce_memcopy_v_to_v(uvm_push_t *push, NvU64 dst, NvU64 src, size_t size);
 
+// Multi-line memcopy: copy line_count lines of line_length bytes each. Line i
+// starts at src + i * src_pitch and is copied to dst + i * dst_pitch. This
+// lets a single CE method cover a regularly strided set of copies.
+//
+// The same membar and pipelining rules as uvm_hal_memcopy_t apply.
+typedef void (*uvm_hal_memcopy_2d_t)(uvm_push_t *push,
+                                     uvm_gpu_address_t dst,
+                                     NvU32 dst_pitch,
+                                     uvm_gpu_address_t src,
+                                     NvU32 src_pitch,
+                                     NvU32 line_length,
+                                     NvU32 line_count);
+void uvm_hal_maxwell_ce_memcopy_2d(uvm_push_t *push,
+                                   uvm_gpu_address_t dst,
+                                   NvU32 dst_pitch,
+                                   uvm_gpu_address_t src,
+                                   NvU32 src_pitch,
+                                   NvU32 line_length,
+                                   NvU32 line_count);
+
 // Memset size bytes at dst to a given N-byte input value.
 //
 // Size has to be a multiple of the element size. For example, the size passed
@@ -332,6 +368,11 @@ uvm_mmu_mode_hal_t *uvm_hal_mmu_mode_volta(NvU32 big_page_size);
 uvm_mmu_mode_hal_t *uvm_hal_mmu_mode_turing(NvU32 big_page_size);
 uvm_mmu_mode_hal_t *uvm_hal_mmu_mode_ampere(NvU32 big_page_size);
 
+// PTE constructors of the MMU modes, exposed so that uvm_hal_make_pte() can
+// call them directly
+NvU64 uvm_hal_volta_mmu_make_pte(uvm_aperture_t aperture, NvU64 address, uvm_prot_t prot, NvU64 flags);
+NvU64 uvm_hal_turing_mmu_make_pte(uvm_aperture_t aperture, NvU64 address, uvm_prot_t prot, NvU64 flags);
+
 
 
 void uvm_hal_maxwell_mmu_enable_prefetch_faults_unsupported(uvm_parent_gpu_t *parent_gpu);
@@ -374,6 +415,16 @@ typedef NvU8 (*uvm_hal_fault_buffer_get_ve_id_t)(NvU16 mmu_engine_id, uvm_mmu_en
 typedef void (*uvm_hal_fault_buffer_parse_entry_t)(uvm_parent_gpu_t *gpu,
                                                    NvU32 index,
                                                    uvm_fault_buffer_entry_t *buffer_entry);
+
+// Parse the valid entries starting at the given buffer index, stopping at the
+// first entry which is not valid or after count entries, whichever comes
+// first. The range must not wrap around the end of the buffer. The parsed
+// entries are stored in consecutive elements of buffer_entries and their valid
+// bits are cleared in the buffer. Returns the number of parsed entries.
+typedef NvU32 (*uvm_hal_fault_buffer_parse_entries_t)(uvm_parent_gpu_t *parent_gpu,
+                                                      NvU32 index,
+                                                      NvU32 count,
+                                                      uvm_fault_buffer_entry_t *buffer_entries);
 typedef bool (*uvm_hal_fault_buffer_entry_is_valid_t)(uvm_parent_gpu_t *parent_gpu, NvU32 index);
 typedef void (*uvm_hal_fault_buffer_entry_clear_valid_t)(uvm_parent_gpu_t *parent_gpu, NvU32 index);
 typedef NvU32 (*uvm_hal_fault_buffer_entry_size_t)(uvm_parent_gpu_t *parent_gpu);
@@ -394,6 +445,10 @@ NvU8 uvm_hal_maxwell_fault_buffer_get_ve_id_unsupported(NvU16 mmu_engine_id, uvm
 void uvm_hal_maxwell_fault_buffer_parse_entry_unsupported(uvm_parent_gpu_t *parent_gpu,
                                                           NvU32 index,
                                                           uvm_fault_buffer_entry_t *buffer_entry);
+NvU32 uvm_hal_maxwell_fault_buffer_parse_entries_unsupported(uvm_parent_gpu_t *parent_gpu,
+                                                             NvU32 index,
+                                                             NvU32 count,
+                                                             uvm_fault_buffer_entry_t *buffer_entries);
 void uvm_hal_pascal_enable_replayable_faults(uvm_parent_gpu_t *parent_gpu);
 void uvm_hal_pascal_disable_replayable_faults(uvm_parent_gpu_t *parent_gpu);
 void uvm_hal_pascal_clear_replayable_faults(uvm_parent_gpu_t *parent_gpu, NvU32 get);
@@ -403,6 +458,10 @@ void uvm_hal_pascal_fault_buffer_write_get(uvm_parent_gpu_t *parent_gpu, NvU32 i
 void uvm_hal_pascal_fault_buffer_parse_entry(uvm_parent_gpu_t *parent_gpu,
                                              NvU32 index,
                                              uvm_fault_buffer_entry_t *buffer_entry);
+NvU32 uvm_hal_pascal_fault_buffer_parse_entries(uvm_parent_gpu_t *parent_gpu,
+                                                NvU32 index,
+                                                NvU32 count,
+                                                uvm_fault_buffer_entry_t *buffer_entries);
 NvU32 uvm_hal_volta_fault_buffer_read_put(uvm_parent_gpu_t *parent_gpu);
 NvU32 uvm_hal_volta_fault_buffer_read_get(uvm_parent_gpu_t *parent_gpu);
 void uvm_hal_volta_fault_buffer_write_get(uvm_parent_gpu_t *parent_gpu, NvU32 index);
@@ -410,6 +469,10 @@ NvU8 uvm_hal_volta_fault_buffer_get_ve_id(NvU16 mmu_engine_id, uvm_mmu_engine_ty
 void uvm_hal_volta_fault_buffer_parse_entry(uvm_parent_gpu_t *parent_gpu,
                                             NvU32 index,
                                             uvm_fault_buffer_entry_t *buffer_entry);
+NvU32 uvm_hal_volta_fault_buffer_parse_entries(uvm_parent_gpu_t *parent_gpu,
+                                               NvU32 index,
+                                               NvU32 count,
+                                               uvm_fault_buffer_entry_t *buffer_entries);
 void uvm_hal_turing_disable_replayable_faults(uvm_parent_gpu_t *parent_gpu);
 void uvm_hal_turing_clear_replayable_faults(uvm_parent_gpu_t *parent_gpu, NvU32 get);
 
@@ -593,6 +656,7 @@ struct uvm_ce_hal_struct
     uvm_hal_ce_plc_mode_t plc_mode;
     uvm_hal_memcopy_t memcopy;
     uvm_hal_memcopy_v_to_v_t memcopy_v_to_v;
+    uvm_hal_memcopy_2d_t memcopy_2d;
     uvm_hal_memset_1_t memset_1;
     uvm_hal_memset_4_t memset_4;
     uvm_hal_memset_8_t memset_8;
@@ -620,6 +684,7 @@ struct uvm_fault_buffer_hal_struct
     uvm_hal_fault_buffer_write_get_t write_get;
     uvm_hal_fault_buffer_get_ve_id_t get_ve_id;
     uvm_hal_fault_buffer_parse_entry_t parse_entry;
+    uvm_hal_fault_buffer_parse_entries_t parse_entries;
     uvm_hal_fault_buffer_entry_is_valid_t entry_is_valid;
     uvm_hal_fault_buffer_entry_clear_valid_t entry_clear_valid;
     uvm_hal_fault_buffer_entry_size_t entry_size;
@@ -694,4 +759,84 @@ static void uvm_hal_wfi_membar(uvm_push_t *push, uvm_membar_t membar)
 // appropriate Host membar(s) after a TLB invalidate.
 void uvm_hal_tlb_invalidate_membar(uvm_push_t *push, uvm_membar_t membar);
 
+// Wrappers for the HAL ops called in the hot loops of fault and access counter
+// servicing, PTE writes and block copies. They are equivalent to calling the
+// op through the HAL, but call the implementation of the current architectures
+// directly. See UVM_HAL_CALL_1().
+static NvU64 uvm_hal_make_pte(uvm_mmu_mode_hal_t *hal,
+                              uvm_aperture_t aperture,
+                              NvU64 address,
+                              uvm_prot_t prot,
+                              NvU64 flags)
+{
+    return UVM_HAL_CALL_2(hal->make_pte,
+                          uvm_hal_turing_mmu_make_pte,
+                          uvm_hal_volta_mmu_make_pte,
+                          aperture,
+                          address,
+                          prot,
+                          flags);
+}
+
+static bool uvm_hal_fault_buffer_entry_is_valid(uvm_parent_gpu_t *parent_gpu, NvU32 index)
+{
+    return UVM_HAL_CALL_1(parent_gpu->fault_buffer_hal->entry_is_valid,
+                          uvm_hal_pascal_fault_buffer_entry_is_valid,
+                          parent_gpu,
+                          index);
+}
+
+static NvU32 uvm_hal_fault_buffer_parse_entries(uvm_parent_gpu_t *parent_gpu,
+                                                NvU32 index,
+                                                NvU32 count,
+                                                uvm_fault_buffer_entry_t *buffer_entries)
+{
+    return UVM_HAL_CALL_1(parent_gpu->fault_buffer_hal->parse_entries,
+                          uvm_hal_volta_fault_buffer_parse_entries,
+                          parent_gpu,
+                          index,
+                          count,
+                          buffer_entries);
+}
+
+static void uvm_hal_fault_buffer_parse_non_replayable_entry(uvm_parent_gpu_t *parent_gpu,
+                                                            void *fault_packet,
+                                                            uvm_fault_buffer_entry_t *buffer_entry)
+{
+    UVM_HAL_CALL_1(parent_gpu->fault_buffer_hal->parse_non_replayable_entry,
+                   uvm_hal_volta_fault_buffer_parse_non_replayable_entry,
+                   parent_gpu,
+                   fault_packet,
+                   buffer_entry);
+}
+
+static bool uvm_hal_access_counter_buffer_entry_is_valid(uvm_parent_gpu_t *parent_gpu, NvU32 index)
+{
+    return UVM_HAL_CALL_1(parent_gpu->access_counter_buffer_hal->entry_is_valid,
+                          uvm_hal_volta_access_counter_buffer_entry_is_valid,
+                          parent_gpu,
+                          index);
+}
+
+static void uvm_hal_access_counter_buffer_parse_entry(uvm_parent_gpu_t *parent_gpu,
+                                                      NvU32 index,
+                                                      uvm_access_counter_buffer_entry_t *buffer_entry)
+{
+    UVM_HAL_CALL_1(parent_gpu->access_counter_buffer_hal->parse_entry,
+                   uvm_hal_volta_access_counter_buffer_parse_entry,
+                   parent_gpu,
+                   index,
+                   buffer_entry);
+}
+
+static void uvm_hal_ce_memcopy(uvm_push_t *push, uvm_gpu_address_t dst, uvm_gpu_address_t src, size_t size)
+{
+    UVM_HAL_CALL_1(uvm_push_get_gpu(push)->parent->ce_hal->memcopy, uvm_hal_maxwell_ce_memcopy, push, dst, src, size);
+}
+
+static void uvm_hal_ce_memset_8(uvm_push_t *push, uvm_gpu_address_t dst, NvU64 value, size_t size)
+{
+    UVM_HAL_CALL_1(uvm_push_get_gpu(push)->parent->ce_hal->memset_8, uvm_hal_maxwell_ce_memset_8, push, dst, value, size);
+}
+
 #endif // __UVM_HAL_H__
@@ -364,6 +364,10 @@ struct uvm_fault_buffer_entry_struct
 
     uvm_va_space_t                           *va_space;
 
+    // Fault service weight of va_space, sampled when the VA space is
+    // looked up so that it stays constant while the batch is serviced
+    NvU8                              va_space_weight;
+
     // This is set to true when some fault could not be serviced and a
     // cancel command needs to be issued
     bool                                      is_fatal : 1;
@@ -40,6 +40,15 @@
 //        VA bits >= CPU VA bits. Otherwise, the GPU can't address all of
 //        the CPU's virtual address space.
 //
+// Kernels without make_device_exclusive_range(), such as 5.11, build with
+// UVM_IS_CONFIG_HMM() set to 0 even when CONFIG_HMM_MIRROR and
+// CONFIG_DEVICE_PRIVATE are set. GPU atomics to pageable memory can't be
+// supported without device exclusive entries. On those kernels,
+// uvm_hmm_va_block_find_create() returns NV_ERR_INVALID_ADDRESS. GPU faults on
+// pageable memory outside of a uvm_va_range_t are then fatal unless ATS is
+// available. Such memory can still be placed explicitly with UvmMigrate(),
+// which goes through uvm_migrate_pageable().
+//
 static bool disable_hmm = false;
 module_param(disable_hmm, bool, 0444);
 MODULE_PARM_DESC(disable_hmm,
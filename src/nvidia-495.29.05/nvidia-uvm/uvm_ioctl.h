@@ -1048,6 +1048,227 @@ typedef struct
     NV_STATUS               rmStatus;                                          // OUT
 } UVM_MAP_EXTERNAL_SPARSE_PARAMS;
 
+//
+// Initialize an event queue made of one ring per CPU. Ring i is only written
+// by CPU i, so producers never contend with each other. queueBuffer holds
+// ringCount consecutive rings of queueBufferSize UvmEventEntry's each, and
+// controlBuffer holds ringCount consecutive UvmToolsEventControlData, one per
+// ring, each following the same protocol as the single ring of queues created
+// with UVM_TOOLS_INIT_EVENT_TRACKER. ringCount must be at least the number of
+// possible CPUs. Events are ordered within a ring only, consumers have to merge
+// the rings using the event timestamps.
+//
+#define UVM_TOOLS_INIT_EVENT_TRACKER_PER_CPU                          UVM_IOCTL_BASE(75)
+typedef struct
+{
+    NvU64           queueBuffer        NV_ALIGN_BYTES(8); // IN
+    NvU64           queueBufferSize    NV_ALIGN_BYTES(8); // IN
+    NvU64           controlBuffer      NV_ALIGN_BYTES(8); // IN
+    NvU32           ringCount;                            // IN
+    NvU32           uvmFd;                                // IN
+    NV_STATUS       rmStatus;                             // OUT
+} UVM_TOOLS_INIT_EVENT_TRACKER_PER_CPU_PARAMS;
+
+//
+// UvmToolsCreateHistograms
+//
+// Turns the tools file into a histogram tracker, which aggregates the events
+// of the VA space in UvmToolsHistograms instead of streaming them.
+//
+#define UVM_TOOLS_INIT_HISTOGRAM_TRACKER                              UVM_IOCTL_BASE(76)
+typedef struct
+{
+    NvU32           uvmFd;                                // IN
+    NV_STATUS       rmStatus;                             // OUT
+} UVM_TOOLS_INIT_HISTOGRAM_TRACKER_PARAMS;
+
+//
+// UvmToolsGetHistograms
+//
+// Copies a snapshot of the UvmToolsHistograms of a histogram tracker to
+// histogramBuffer. histogramBufferSize must be at least
+// sizeof(UvmToolsHistograms).
+//
+#define UVM_TOOLS_GET_HISTOGRAMS                                      UVM_IOCTL_BASE(77)
+typedef struct
+{
+    NvU64           histogramBuffer     NV_ALIGN_BYTES(8); // IN
+    NvU64           histogramBufferSize NV_ALIGN_BYTES(8); // IN
+    NV_STATUS       rmStatus;                              // OUT
+} UVM_TOOLS_GET_HISTOGRAMS_PARAMS;
+
+//
+// UvmToolsEventQueueSetSampling
+//
+// Only record one out of sampleInterval events, and at most one event every
+// samplePeriodNs, of the given types. 0 disables the corresponding limit.
+// Only UvmEventTypeCpuFault, UvmEventTypeGpuFault and UvmEventTypeMigration
+// can be sampled. Migrations are sampled per VA block migration.
+//
+#define UVM_TOOLS_EVENT_QUEUE_SET_SAMPLING                            UVM_IOCTL_BASE(78)
+typedef struct
+{
+    NvU64           eventTypeFlags      NV_ALIGN_BYTES(8); // IN
+    NvU64           samplePeriodNs      NV_ALIGN_BYTES(8); // IN
+    NvU32           sampleInterval;                        // IN
+    NV_STATUS       rmStatus;                              // OUT
+} UVM_TOOLS_EVENT_QUEUE_SET_SAMPLING_PARAMS;
+
+//
+// UvmGetResidencyInfo
+//
+// Describes the residency, mappings and read duplication of the managed pages
+// in [base, base + length) as runs of pages with the same state, written to
+// the runs array in increasing address order. Pages not covered by any run are
+// neither resident nor mapped anywhere. At most maxRuns runs are returned, and
+// nextAddress is the address to resume from if that wasn't enough to describe
+// the whole range, or base + length otherwise.
+//
+// The runs are gathered in batches and each batch is a consistent snapshot,
+// but the range can change between batches.
+//
+#define UVM_GET_RESIDENCY_INFO                                        UVM_IOCTL_BASE(79)
+typedef struct
+{
+    NvU64           base                NV_ALIGN_BYTES(8); // IN
+    NvU64           length              NV_ALIGN_BYTES(8); // IN
+    NvU64           runs                NV_ALIGN_BYTES(8); // IN, UvmResidencyRun[]
+    NvU64           nextAddress         NV_ALIGN_BYTES(8); // OUT
+    NvU32           maxRuns;                               // IN
+    NvU32           numRuns;                               // OUT
+    NV_STATUS       rmStatus;                              // OUT
+} UVM_GET_RESIDENCY_INFO_PARAMS;
+
+//
+// UvmSetFaultServiceWeight
+//
+// Sets the weight of the VA space in the servicing of replayable faults on
+// GPUs shared with other VA spaces. Within a batch of faults, the faults of the
+// VA spaces with a higher weight are serviced first. If the
+// uvm_perf_fault_batch_faults_per_weight module parameter is not 0, a batch
+// with faults from several VA spaces services at most weight times that many
+// faults from each of them. The rest are serviced in later batches, after the
+// GPU replays them.
+//
+// Error codes:
+//     NV_ERR_INVALID_ARGUMENT:
+//         weight is 0 or greater than UVM_FAULT_SERVICE_WEIGHT_MAX.
+//
+#define UVM_SET_FAULT_SERVICE_WEIGHT                                  UVM_IOCTL_BASE(80)
+
+#define UVM_FAULT_SERVICE_WEIGHT_DEFAULT    4
+#define UVM_FAULT_SERVICE_WEIGHT_MAX        16
+
+typedef struct
+{
+    NvU32           weight;                                // IN
+    NV_STATUS       rmStatus;                              // OUT
+} UVM_SET_FAULT_SERVICE_WEIGHT_PARAMS;
+
+//
+// UvmSetAccessCounterPolicy
+//
+// Sets how access counter notifications on the managed memory in
+// [requestedBase, requestedBase + length) are acted upon.
+//
+// granularity selects the size of the aligned regions migrated when a
+// notification reports accesses within them. It cannot be finer than the
+// granularity the GPU tracks accesses at, in which case the GPU granularity is
+// used. UVM_ACCESS_COUNTER_POLICY_GRANULARITY_DEFAULT migrates the regions
+// reported by the GPU.
+//
+// notificationThreshold is the number of notifications a VA block needs to
+// receive before its pages are migrated, up to
+// UVM_ACCESS_COUNTER_POLICY_NOTIFICATION_THRESHOLD_MAX. Each notification
+// already accounts for the number of accesses configured in the
+// uvm_perf_access_counter_threshold module parameter. 0 and 1 both migrate on
+// every notification.
+//
+// Error codes:
+//     NV_ERR_INVALID_ADDRESS:
+//         requestedBase is not page-aligned, length is 0 or not
+//         page-aligned, or the range is not fully covered by managed
+//         allocations.
+//
+//     NV_ERR_INVALID_ARGUMENT:
+//         granularity or notificationThreshold are not valid.
+//
+#define UVM_SET_ACCESS_COUNTER_POLICY                                 UVM_IOCTL_BASE(81)
+
+#define UVM_ACCESS_COUNTER_POLICY_GRANULARITY_DEFAULT           0
+#define UVM_ACCESS_COUNTER_POLICY_GRANULARITY_64K               1
+#define UVM_ACCESS_COUNTER_POLICY_GRANULARITY_2M                2
+
+#define UVM_ACCESS_COUNTER_POLICY_NOTIFICATION_THRESHOLD_MAX    255
+
+typedef struct
+{
+    NvU64           requestedBase         NV_ALIGN_BYTES(8); // IN
+    NvU64           length                NV_ALIGN_BYTES(8); // IN
+    NvU32           granularity;                             // IN
+    NvU32           notificationThreshold;                   // IN
+    NV_STATUS       rmStatus;                                // OUT
+} UVM_SET_ACCESS_COUNTER_POLICY_PARAMS;
+
+//
+// UvmSetResidencyPinned
+//
+// Sets or clears the pinned residency hint on the managed memory in
+// [requestedBase, requestedBase + length).
+//
+// GPU memory backing VA ranges with pinned residency is skipped when picking
+// memory to evict under memory pressure, and is only evicted when nothing
+// else can be. The amount of memory exempted from eviction on each GPU is
+// capped by the uvm_perf_pmm_residency_pinned_max module parameter, memory
+// over the cap is evicted like any other. Pinned residency doesn't prevent
+// the pages from migrating for other reasons, like faults or explicit
+// migrations, and it only applies to the memory of 2MB aligned VA blocks.
+//
+// Error codes:
+//     NV_ERR_INVALID_ADDRESS:
+//         requestedBase is not page-aligned, length is 0 or not
+//         page-aligned, or the range is not fully covered by managed
+//         allocations.
+//
+#define UVM_SET_RESIDENCY_PINNED                                      UVM_IOCTL_BASE(82)
+
+typedef struct
+{
+    NvU64           requestedBase         NV_ALIGN_BYTES(8); // IN
+    NvU64           length                NV_ALIGN_BYTES(8); // IN
+    NvBool          pinned;                                  // IN
+    NV_STATUS       rmStatus;                                // OUT
+} UVM_SET_RESIDENCY_PINNED_PARAMS;
+
+//
+// UvmToolsGetGpuTimeCalibration
+//
+// Samples the clock of the GPU used for the gpu time stamps of the tools
+// events, together with the CPU clock used for the cpu time stamps.
+// cpuTimeStamp is the midpoint of the CPU readings taken before and after the
+// GPU clock read, and uncertainty is half of the distance between them, so
+// (gpuTimeStamp - cpuTimeStamp) is the offset between both clocks, with an
+// error of at most uncertainty nanoseconds. Sampling periodically allows
+// computing the drift between the clocks too.
+//
+// UvmEventTypeTimeCalibration events provide the same samples, recorded
+// periodically while GPU faults are reported.
+//
+// Error codes:
+//     NV_ERR_INVALID_DEVICE:
+//         The GPU referred to by gpuUuid is not registered in the VA space.
+//
+#define UVM_TOOLS_GET_GPU_TIME_CALIBRATION                            UVM_IOCTL_BASE(83)
+
+typedef struct
+{
+    NvProcessorUuid gpuUuid;                                 // IN
+    NvU64           cpuTimeStamp          NV_ALIGN_BYTES(8); // OUT
+    NvU64           gpuTimeStamp          NV_ALIGN_BYTES(8); // OUT
+    NvU64           uncertainty           NV_ALIGN_BYTES(8); // OUT
+    NV_STATUS       rmStatus;                                // OUT
+} UVM_TOOLS_GET_GPU_TIME_CALIBRATION_PARAMS;
+
 //
 // Temporary ioctls which should be removed before UVM 8 release
 // Number backwards from 2047 - highest custom ioctl function number
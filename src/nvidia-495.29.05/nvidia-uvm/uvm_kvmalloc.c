@@ -90,8 +90,48 @@ MODULE_PARM_DESC(uvm_leak_checker,
                  "Enable uvm memory leak checking. "
                  "0 = disabled, 1 = count total bytes allocated and freed, 2 = per-allocation origin tracking.");
 
+// Small kmalloc-based allocations are rounded up to a power of two size class
+// and served from per-CPU caches of recently freed buffers of that class,
+// before falling back to the kmalloc slabs. This avoids the slab allocator for
+// the common short-lived allocations, like the ones of trackers and fault
+// batches, which are freed and allocated again on the same CPU.
+#define UVM_KVMALLOC_CACHE_MIN_SIZE 32
+#define UVM_KVMALLOC_CACHE_CLASSES  8
+#define UVM_KVMALLOC_CACHE_MAX_SIZE (UVM_KVMALLOC_CACHE_MIN_SIZE << (UVM_KVMALLOC_CACHE_CLASSES - 1))
+
+#define UVM_KVMALLOC_CACHE_DEPTH_MAX 16
+
+typedef struct
+{
+    // LIFO stacks of free buffers per size class
+    unsigned count[UVM_KVMALLOC_CACHE_CLASSES];
+    void *buffers[UVM_KVMALLOC_CACHE_CLASSES][UVM_KVMALLOC_CACHE_DEPTH_MAX];
+
+    // Allocations served from, and missing in, the cache. Kept per CPU to
+    // avoid sharing cache lines in the fast path.
+    unsigned long hits[UVM_KVMALLOC_CACHE_CLASSES];
+    unsigned long misses[UVM_KVMALLOC_CACHE_CLASSES];
+} uvm_kvmalloc_cpu_cache_t;
+
+// The caches are only accessed with preemption disabled and never from
+// interrupt context, so they don't need a lock.
+static DEFINE_PER_CPU(uvm_kvmalloc_cpu_cache_t, g_uvm_kvmalloc_cpu_cache);
+
+static unsigned uvm_kvmalloc_cache_depth = 0;
+module_param(uvm_kvmalloc_cache_depth, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_kvmalloc_cache_depth,
+                 "Number of free buffers cached per CPU for each small uvm_kvmalloc size class. "
+                 "0 = disabled, max 16.");
+
 NV_STATUS uvm_kvmalloc_init(void)
 {
+    if (uvm_kvmalloc_cache_depth > UVM_KVMALLOC_CACHE_DEPTH_MAX) {
+        pr_info("Invalid value %u for uvm_kvmalloc_cache_depth. Using %u instead\n",
+                uvm_kvmalloc_cache_depth,
+                UVM_KVMALLOC_CACHE_DEPTH_MAX);
+        uvm_kvmalloc_cache_depth = UVM_KVMALLOC_CACHE_DEPTH_MAX;
+    }
+
     if (uvm_leak_checker >= UVM_KVMALLOC_LEAK_CHECK_ORIGIN) {
         spin_lock_init(&g_uvm_leak_checker.lock);
         uvm_rb_tree_init(&g_uvm_leak_checker.allocation_info);
@@ -105,11 +145,47 @@ NV_STATUS uvm_kvmalloc_init(void)
     return NV_OK;
 }
 
+// Free all the cached buffers and print the per-class statistics
+static void cache_exit(void)
+{
+    unsigned long hits[UVM_KVMALLOC_CACHE_CLASSES] = {0};
+    unsigned long misses[UVM_KVMALLOC_CACHE_CLASSES] = {0};
+    unsigned class;
+    int cpu;
+
+    if (uvm_kvmalloc_cache_depth == 0)
+        return;
+
+    // Stop caching, the leak checker frees the leaked allocations afterwards
+    uvm_kvmalloc_cache_depth = 0;
+
+    for_each_possible_cpu(cpu) {
+        uvm_kvmalloc_cpu_cache_t *cache = &per_cpu(g_uvm_kvmalloc_cpu_cache, cpu);
+
+        for (class = 0; class < UVM_KVMALLOC_CACHE_CLASSES; class++) {
+            while (cache->count[class] > 0)
+                kfree(cache->buffers[class][--cache->count[class]]);
+
+            hits[class] += cache->hits[class];
+            misses[class] += cache->misses[class];
+        }
+    }
+
+    for (class = 0; class < UVM_KVMALLOC_CACHE_CLASSES; class++) {
+        printk(KERN_INFO NVIDIA_UVM_PRETTY_PRINTING_PREFIX "kvmalloc cache class %u bytes: %lu hits, %lu misses\n",
+               UVM_KVMALLOC_CACHE_MIN_SIZE << class,
+               hits[class],
+               misses[class]);
+    }
+}
+
 void uvm_kvmalloc_exit(void)
 {
     if (!g_malloc_initialized)
         return;
 
+    cache_exit();
+
     if (atomic_long_read(&g_uvm_leak_checker.bytes_allocated) > 0) {
         printk(KERN_ERR NVIDIA_UVM_PRETTY_PRINTING_PREFIX "!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
         printk(KERN_ERR NVIDIA_UVM_PRETTY_PRINTING_PREFIX "Memory leak of %lu bytes detected.%s\n",
@@ -246,7 +322,98 @@ static uvm_vmalloc_hdr_t *get_hdr(void *p)
     return hdr;
 }
 
-static void *alloc_internal(size_t size, bool zero_memory)
+static unsigned cache_class(size_t size)
+{
+    if (size <= UVM_KVMALLOC_CACHE_MIN_SIZE)
+        return 0;
+
+    return ilog2(roundup_pow_of_two(size)) - ilog2(UVM_KVMALLOC_CACHE_MIN_SIZE);
+}
+
+// Allocate a buffer of the size class of size, from the per-CPU cache if
+// possible
+static void *cache_alloc(size_t size)
+{
+    uvm_kvmalloc_cpu_cache_t *cache;
+    unsigned class = cache_class(size);
+    void *p = NULL;
+
+    if (!in_interrupt()) {
+        cache = &get_cpu_var(g_uvm_kvmalloc_cpu_cache);
+
+        if (cache->count[class] > 0) {
+            p = cache->buffers[class][--cache->count[class]];
+            cache->hits[class]++;
+        }
+        else {
+            cache->misses[class]++;
+        }
+
+        put_cpu_var(g_uvm_kvmalloc_cpu_cache);
+    }
+
+    if (!p)
+        p = kmalloc(UVM_KVMALLOC_CACHE_MIN_SIZE << class, NV_UVM_GFP_FLAGS);
+
+    return p;
+}
+
+// Cache the buffer in the per-CPU cache of its size class. Returns false if the
+// buffer has to be freed with kfree().
+static bool cache_free(void *p)
+{
+    uvm_kvmalloc_cpu_cache_t *cache;
+    size_t size;
+    unsigned class;
+    bool cached = false;
+
+    if (uvm_kvmalloc_cache_depth == 0 || in_interrupt())
+        return false;
+
+    // Buffers allocated by krealloc() or before the cache was enabled can also
+    // be cached, as long as their size matches a class exactly.
+    size = ksize(p);
+    if (size < UVM_KVMALLOC_CACHE_MIN_SIZE || size > UVM_KVMALLOC_CACHE_MAX_SIZE || !is_power_of_2(size))
+        return false;
+
+    class = cache_class(size);
+
+    cache = &get_cpu_var(g_uvm_kvmalloc_cpu_cache);
+
+    if (cache->count[class] < uvm_kvmalloc_cache_depth) {
+        cache->buffers[class][cache->count[class]++] = p;
+        cached = true;
+    }
+
+    put_cpu_var(g_uvm_kvmalloc_cpu_cache);
+
+    return cached;
+}
+
+static void *alloc_internal_node(size_t size, bool zero_memory, int node)
+{
+    uvm_vmalloc_hdr_t *hdr;
+
+    // The per-CPU cache is bypassed as its buffers may come from any node
+    if (size <= UVM_KMALLOC_THRESHOLD) {
+        if (zero_memory)
+            return kzalloc_node(size, NV_UVM_GFP_FLAGS, node);
+        return kmalloc_node(size, NV_UVM_GFP_FLAGS, node);
+    }
+
+    if (zero_memory)
+        hdr = vzalloc_node(sizeof(*hdr) + size, node);
+    else
+        hdr = vmalloc_node(sizeof(*hdr) + size, node);
+
+    if (!hdr)
+        return NULL;
+
+    hdr->alloc_size = size;
+    return hdr->ptr;
+}
+
+static void *alloc_internal(size_t size, bool zero_memory, int node)
 {
     uvm_vmalloc_hdr_t *hdr;
 
@@ -257,6 +424,20 @@ static void *alloc_internal(size_t size, bool zero_memory)
     // Make sure that (sizeof(hdr) + size) is what it should be
     BUILD_BUG_ON(sizeof(uvm_vmalloc_hdr_t) != offsetof(uvm_vmalloc_hdr_t, ptr));
 
+    if (node != NUMA_NO_NODE)
+        return alloc_internal_node(size, zero_memory, node);
+
+    if (uvm_kvmalloc_cache_depth > 0 && size != 0 && size <= UVM_KVMALLOC_CACHE_MAX_SIZE) {
+        void *p = cache_alloc(size);
+
+        // Cached buffers may have been used before, zero all of it like
+        // kzalloc() does as callers may use up to uvm_kvsize().
+        if (p && zero_memory)
+            memset(p, 0, ksize(p));
+
+        return p;
+    }
+
     if (size <= UVM_KMALLOC_THRESHOLD) {
         if (zero_memory)
             return kzalloc(size, NV_UVM_GFP_FLAGS);
@@ -277,7 +458,7 @@ static void *alloc_internal(size_t size, bool zero_memory)
 
 void *__uvm_kvmalloc(size_t size, const char *file, int line, const char *function)
 {
-    void *p = alloc_internal(size, false);
+    void *p = alloc_internal(size, false, NUMA_NO_NODE);
 
     if (uvm_leak_checker && p)
         alloc_tracking_add(p, file, line, function);
@@ -287,7 +468,27 @@ void *__uvm_kvmalloc(size_t size, const char *file, int line, const char *functi
 
 void *__uvm_kvmalloc_zero(size_t size, const char *file, int line, const char *function)
 {
-    void *p = alloc_internal(size, true);
+    void *p = alloc_internal(size, true, NUMA_NO_NODE);
+
+    if (uvm_leak_checker && p)
+        alloc_tracking_add(p, file, line, function);
+
+    return p;
+}
+
+void *__uvm_kvmalloc_node(size_t size, int node, const char *file, int line, const char *function)
+{
+    void *p = alloc_internal(size, false, node);
+
+    if (uvm_leak_checker && p)
+        alloc_tracking_add(p, file, line, function);
+
+    return p;
+}
+
+void *__uvm_kvmalloc_zero_node(size_t size, int node, const char *file, int line, const char *function)
+{
+    void *p = alloc_internal(size, true, node);
 
     if (uvm_leak_checker && p)
         alloc_tracking_add(p, file, line, function);
@@ -305,7 +506,7 @@ void uvm_kvfree(void *p)
 
     if (is_vmalloc_addr(p))
         vfree(get_hdr(p));
-    else
+    else if (!cache_free(p))
         kfree(p);
 }
 
@@ -319,7 +520,7 @@ static void *realloc_from_kmalloc(void *p, size_t new_size)
         return krealloc(p, new_size, NV_UVM_GFP_FLAGS);
 
     // kmalloc -> vmalloc
-    new_p = alloc_internal(new_size, false);
+    new_p = alloc_internal(new_size, false, NUMA_NO_NODE);
     if (!new_p)
         return NULL;
     memcpy(new_p, p, min(ksize(p), new_size));
@@ -341,9 +542,17 @@ static void *realloc_from_vmalloc(void *p, size_t new_size)
     if (new_size == old_hdr->alloc_size)
         return p;
 
+    // vmalloc maps whole pages, so as long as the new size needs the same
+    // number of pages the buffer can be grown or shrunk in place.
+    if (new_size > UVM_KMALLOC_THRESHOLD &&
+        PAGE_ALIGN(sizeof(*old_hdr) + new_size) == PAGE_ALIGN(sizeof(*old_hdr) + old_hdr->alloc_size)) {
+        old_hdr->alloc_size = new_size;
+        return p;
+    }
+
     // vmalloc has no realloc functionality so we need to do a separate alloc +
     // copy.
-    new_p = alloc_internal(new_size, false);
+    new_p = alloc_internal(new_size, false, NUMA_NO_NODE);
     if (!new_p)
         return NULL;
 
@@ -410,3 +619,12 @@ size_t uvm_kvsize(void *p)
         return get_hdr(p)->alloc_size;
     return ksize(p);
 }
+
+int uvm_kvnode(void *p)
+{
+    UVM_ASSERT(g_malloc_initialized);
+    UVM_ASSERT(!ZERO_OR_NULL_PTR(p));
+    if (is_vmalloc_addr(p))
+        return page_to_nid(vmalloc_to_page(p));
+    return page_to_nid(virt_to_page(p));
+}
@@ -53,6 +53,18 @@ void *__uvm_kvmalloc_zero(size_t size, const char *file, int line, const char *f
 #define uvm_kvmalloc(__size) __uvm_kvmalloc(__size, __FILE__, __LINE__, __FUNCTION__)
 #define uvm_kvmalloc_zero(__size) __uvm_kvmalloc_zero(__size, __FILE__, __LINE__, __FUNCTION__)
 
+// Same as uvm_kvmalloc and uvm_kvmalloc_zero, but the memory is preferably
+// allocated from the given NUMA node. NUMA_NO_NODE behaves like the versions
+// above. The allocations are freed with uvm_kvfree and can be reallocated with
+// uvm_kvrealloc, although reallocations are not node-aware.
+void *__uvm_kvmalloc_node(size_t size, int node, const char *file, int line, const char *function);
+void *__uvm_kvmalloc_zero_node(size_t size, int node, const char *file, int line, const char *function);
+
+#define uvm_kvmalloc_node(__size, __node) \
+    __uvm_kvmalloc_node(__size, __node, __FILE__, __LINE__, __FUNCTION__)
+#define uvm_kvmalloc_zero_node(__size, __node) \
+    __uvm_kvmalloc_zero_node(__size, __node, __FILE__, __LINE__, __FUNCTION__)
+
 void uvm_kvfree(void *p);
 
 // Follows standard realloc semantics:
@@ -70,6 +82,12 @@ void *__uvm_kvrealloc(void *p, size_t new_size, const char *file, int line, cons
 // p must not be NULL.
 size_t uvm_kvsize(void *p);
 
+// Returns the NUMA node backing the first page of a prior allocation from any
+// of the uvm_kvmalloc APIs.
+//
+// p must not be NULL or ZERO_SIZE_PTR.
+int uvm_kvnode(void *p);
+
 NV_STATUS uvm_test_kvmalloc(UVM_TEST_KVMALLOC_PARAMS *params, struct file *filp);
 
 #endif // __UVM_KVMALLOC_H__
@@ -32,6 +32,8 @@ typedef enum
     ALLOC_TYPE_ZALLOC,
     ALLOC_TYPE_REALLOC_NULL,
     ALLOC_TYPE_REALLOC_ZERO,
+    ALLOC_TYPE_MALLOC_NODE,
+    ALLOC_TYPE_ZALLOC_NODE,
     ALLOC_TYPE_MAX
 } alloc_type_t;
 
@@ -61,7 +63,7 @@ static NV_STATUS check_alloc(void *p, size_t size)
 
 static NV_STATUS test_uvm_kvmalloc(void)
 {
-    static const size_t sizes[] = {0, UVM_KMALLOC_THRESHOLD, UVM_KMALLOC_THRESHOLD + 1};
+    static const size_t sizes[] = {0, 1, 65, PAGE_SIZE, UVM_KMALLOC_THRESHOLD, UVM_KMALLOC_THRESHOLD + 1};
     uint8_t *p;
     uint8_t expected;
     size_t i, j, size;
@@ -83,6 +85,12 @@ static NV_STATUS test_uvm_kvmalloc(void)
                 case ALLOC_TYPE_REALLOC_ZERO:
                     p = uvm_kvrealloc(ZERO_SIZE_PTR, size);
                     break;
+                case ALLOC_TYPE_MALLOC_NODE:
+                    p = uvm_kvmalloc_node(size, numa_node_id());
+                    break;
+                case ALLOC_TYPE_ZALLOC_NODE:
+                    p = uvm_kvmalloc_zero_node(size, numa_node_id());
+                    break;
                 default:
                     UVM_ASSERT(0);
                     p = NULL;
@@ -96,7 +104,7 @@ static NV_STATUS test_uvm_kvmalloc(void)
             MEM_NV_CHECK_RET(check_alloc(p, size), NV_OK);
 
             // Scribble on the allocation to make sure we don't crash
-            if (alloc_type == ALLOC_TYPE_ZALLOC) {
+            if (alloc_type == ALLOC_TYPE_ZALLOC || alloc_type == ALLOC_TYPE_ZALLOC_NODE) {
                 expected = 0;
             }
             else {
@@ -175,10 +183,58 @@ static NV_STATUS test_uvm_kvrealloc(void)
     return NV_OK;
 }
 
+// vmalloc-based allocations which keep the same number of pages are resized in
+// place
+static NV_STATUS test_uvm_kvrealloc_in_place(void)
+{
+    size_t old_size = UVM_KMALLOC_THRESHOLD + 1;
+    size_t new_size = old_size + sizeof(NvU64);
+    uint8_t *old_p, *new_p;
+    uint8_t expected = (uint8_t)current->pid;
+    size_t k;
+
+    old_p = uvm_kvmalloc(old_size);
+    if (!old_p)
+        return NV_ERR_NO_MEMORY;
+
+    memset(old_p, expected, old_size);
+
+    new_p = uvm_kvrealloc(old_p, new_size);
+    if (!new_p) {
+        uvm_kvfree(old_p);
+        return NV_ERR_NO_MEMORY;
+    }
+
+    if (new_p != old_p) {
+        UVM_TEST_PRINT("Realloc from %zu to %zu bytes moved the allocation\n", old_size, new_size);
+        uvm_kvfree(new_p);
+        TEST_CHECK_RET(0);
+    }
+
+    MEM_NV_CHECK_RET(check_alloc(new_p, new_size), NV_OK);
+
+    for (k = 0; k < old_size; k++) {
+        if (new_p[k] != expected) {
+            UVM_TEST_PRINT("new_p[%zu] is 0x%x instead of expected value 0x%x\n", k, new_p[k], expected);
+            uvm_kvfree(new_p);
+            TEST_CHECK_RET(0);
+        }
+    }
+
+    uvm_kvfree(new_p);
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_test_kvmalloc(UVM_TEST_KVMALLOC_PARAMS *params, struct file *filp)
 {
     NV_STATUS status = test_uvm_kvmalloc();
     if (status != NV_OK)
         return status;
-    return test_uvm_kvrealloc();
+
+    status = test_uvm_kvrealloc();
+    if (status != NV_OK)
+        return status;
+
+    return test_uvm_kvrealloc_in_place();
 }
@@ -25,6 +25,8 @@
 #include "uvm_thread_context.h"
 #include "uvm_kvmalloc.h"
 
+#include <linux/seq_file.h>
+
 const char *uvm_lock_order_to_string(uvm_lock_order_t lock_order)
 {
     BUILD_BUG_ON(UVM_LOCK_ORDER_COUNT != 25);
@@ -37,7 +39,6 @@ const char *uvm_lock_order_to_string(uvm_lock_order_t lock_order)
         UVM_ENUM_STRING_CASE(UVM_LOCK_ORDER_MMAP_LOCK);
         UVM_ENUM_STRING_CASE(UVM_LOCK_ORDER_VA_SPACES_LIST);
         UVM_ENUM_STRING_CASE(UVM_LOCK_ORDER_VA_SPACE_SERIALIZE_WRITERS);
-        UVM_ENUM_STRING_CASE(UVM_LOCK_ORDER_VA_SPACE_READ_ACQUIRE_WRITE_RELEASE_LOCK);
         UVM_ENUM_STRING_CASE(UVM_LOCK_ORDER_VA_SPACE);
         UVM_ENUM_STRING_CASE(UVM_LOCK_ORDER_EXT_RANGE_TREE);
         UVM_ENUM_STRING_CASE(UVM_LOCK_ORDER_GPU_SEMAPHORE_POOL);
@@ -338,6 +339,127 @@ bool __uvm_thread_check_all_unlocked()
     return __uvm_check_all_unlocked(uvm_thread_context_lock_get());
 }
 
+NV_STATUS uvm_init_percpu_rwsem(uvm_percpu_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_order)
+{
+    memset(uvm_sem, 0, sizeof(*uvm_sem));
+
+    uvm_sem->read_count = alloc_percpu(int);
+    if (!uvm_sem->read_count)
+        return NV_ERR_NO_MEMORY;
+
+    mutex_init(&uvm_sem->writer_lock);
+    init_waitqueue_head(&uvm_sem->wait_queue);
+
+#if UVM_IS_DEBUG()
+    uvm_locking_assert_initialized();
+#endif
+#if UVM_LOCK_HAS_ORDER()
+    uvm_sem->lock_order = lock_order;
+#endif
+    uvm_assert_percpu_rwsem_unlocked(uvm_sem);
+
+    return NV_OK;
+}
+
+void uvm_deinit_percpu_rwsem(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    if (!uvm_sem->read_count)
+        return;
+
+    uvm_assert_percpu_rwsem_unlocked(uvm_sem);
+
+    free_percpu(uvm_sem->read_count);
+    uvm_sem->read_count = NULL;
+}
+
+static int percpu_rwsem_read_count(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    int count = 0;
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        count += *per_cpu_ptr(uvm_sem->read_count, cpu);
+
+    return count;
+}
+
+bool __uvm_percpu_rwsem_is_locked(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    return READ_ONCE(uvm_sem->writer) || percpu_rwsem_read_count(uvm_sem) != 0;
+}
+
+void __uvm_percpu_down_read_slow(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    do {
+        // The failed fast path attempt may have been observed by a writer
+        // waiting for readers to drain.
+        wake_up_all(&uvm_sem->wait_queue);
+
+        wait_event(uvm_sem->wait_queue, !READ_ONCE(uvm_sem->writer));
+    } while (!__uvm_percpu_down_read_fast(uvm_sem));
+}
+
+void __uvm_percpu_up_read(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    // Order the read section before the release
+    smp_mb();
+
+    this_cpu_dec(*uvm_sem->read_count);
+
+    // Pairs with the barrier in __uvm_percpu_down_write(). Either this reader
+    // observes the writer's flag or the writer observes the updated count.
+    smp_mb();
+
+    if (unlikely(READ_ONCE(uvm_sem->writer)))
+        wake_up_all(&uvm_sem->wait_queue);
+}
+
+bool __uvm_percpu_down_write(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    bool waited = false;
+
+    if (!mutex_trylock(&uvm_sem->writer_lock)) {
+        mutex_lock(&uvm_sem->writer_lock);
+        waited = true;
+    }
+
+    WRITE_ONCE(uvm_sem->writer, 1);
+
+    // Pairs with the barriers in __uvm_percpu_down_read_fast() and
+    // __uvm_percpu_up_read()
+    smp_mb();
+
+    if (percpu_rwsem_read_count(uvm_sem) != 0) {
+        wait_event(uvm_sem->wait_queue, percpu_rwsem_read_count(uvm_sem) == 0);
+        waited = true;
+    }
+
+    // Order the write section after the readers' release
+    smp_mb();
+
+    return waited;
+}
+
+void __uvm_percpu_up_write(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    // Order the write section before the release
+    smp_mb();
+
+    WRITE_ONCE(uvm_sem->writer, 0);
+    mutex_unlock(&uvm_sem->writer_lock);
+
+    wake_up_all(&uvm_sem->wait_queue);
+}
+
+void __uvm_percpu_downgrade_write(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    // Become a reader before letting other readers in. No writer can observe
+    // the count before writer_lock is released.
+    this_cpu_inc(*uvm_sem->read_count);
+
+    __uvm_percpu_up_write(uvm_sem);
+}
+
 NV_STATUS uvm_bit_locks_init(uvm_bit_locks_t *bit_locks, size_t count, uvm_lock_order_t lock_order)
 {
     // TODO: Bug 1772140: Notably bit locks currently do not work on memory
@@ -367,3 +489,87 @@ void uvm_bit_locks_deinit(uvm_bit_locks_t *bit_locks)
     kfree(bit_locks->bits);
     memset(bit_locks, 0, sizeof(*bit_locks));
 }
+
+#if UVM_IS_LOCK_STATS()
+
+typedef struct
+{
+    NvU64 acquisitions;
+    NvU64 contended;
+    NvU64 wait_time_total;
+    NvU64 wait_time_max;
+    NvU64 hold_time_total;
+    NvU64 hold_time_max;
+} uvm_lock_stats_t;
+
+// Kept per CPU so that the statistics don't add cache line bouncing of their
+// own to the locks being measured. The this_cpu operations are safe against
+// interrupts, but the read-compare-write of the maximums is not, which may lose
+// a maximum in rare cases.
+static DEFINE_PER_CPU(uvm_lock_stats_t [UVM_LOCK_ORDER_COUNT], g_uvm_lock_stats);
+
+void __uvm_lock_stats_record_acquire(uvm_lock_order_t lock_order, bool contended, NvU64 wait_time)
+{
+    this_cpu_inc(g_uvm_lock_stats[lock_order].acquisitions);
+
+    if (!contended)
+        return;
+
+    this_cpu_inc(g_uvm_lock_stats[lock_order].contended);
+    this_cpu_add(g_uvm_lock_stats[lock_order].wait_time_total, wait_time);
+    if (wait_time > this_cpu_read(g_uvm_lock_stats[lock_order].wait_time_max))
+        this_cpu_write(g_uvm_lock_stats[lock_order].wait_time_max, wait_time);
+}
+
+void __uvm_lock_stats_record_hold(uvm_lock_order_t lock_order, NvU64 hold_time)
+{
+    this_cpu_add(g_uvm_lock_stats[lock_order].hold_time_total, hold_time);
+    if (hold_time > this_cpu_read(g_uvm_lock_stats[lock_order].hold_time_max))
+        this_cpu_write(g_uvm_lock_stats[lock_order].hold_time_max, hold_time);
+}
+
+void uvm_lock_stats_print(struct seq_file *s)
+{
+    uvm_lock_order_t lock_order;
+
+    seq_printf(s,
+               "%-42s %14s %12s %16s %14s %16s %14s\n",
+               "lock_order",
+               "acquisitions",
+               "contended",
+               "wait_total_ns",
+               "wait_max_ns",
+               "hold_total_ns",
+               "hold_max_ns");
+
+    for (lock_order = UVM_LOCK_ORDER_INVALID + 1; lock_order < UVM_LOCK_ORDER_COUNT; ++lock_order) {
+        uvm_lock_stats_t total = {0};
+        int cpu;
+
+        for_each_possible_cpu(cpu) {
+            uvm_lock_stats_t *stats = &per_cpu(g_uvm_lock_stats, cpu)[lock_order];
+
+            total.acquisitions += stats->acquisitions;
+            total.contended += stats->contended;
+            total.wait_time_total += stats->wait_time_total;
+            total.wait_time_max = max(total.wait_time_max, stats->wait_time_max);
+            total.hold_time_total += stats->hold_time_total;
+            total.hold_time_max = max(total.hold_time_max, stats->hold_time_max);
+        }
+
+        if (total.acquisitions == 0)
+            continue;
+
+        seq_printf(s,
+                   "%-42s %14llu %12llu %16llu %14llu %16llu %14llu\n",
+                   uvm_lock_order_to_string(lock_order),
+                   total.acquisitions,
+                   total.contended,
+                   total.wait_time_total,
+                   total.wait_time_max,
+                   total.hold_time_total,
+                   total.hold_time_max);
+    }
+}
+
+#endif // UVM_IS_LOCK_STATS()
@@ -144,7 +144,8 @@
 //      GPU fault servicing is blocked. We may block GPU fault servicing by:
 //      - Taking the VA space lock in write mode
 //      - Holding the VA space lock in read mode with a writer pending, since
-//        Linux rw_semaphores are fair.
+//        the VA space lock blocks new readers while a writer waits for the
+//        current readers to drain.
 //
 //      Example of the second condition:
 //      Thread A        Thread B        UVM BH          Thread C
@@ -170,60 +171,21 @@
 //            RM calls under the VA space lock at all, but that will take a
 //            larger restructuring.
 //
-// - VA space serialization of down_read with up_write of the VA space lock
-//   (va_space->read_acquire_write_release_lock)
-//      Order: UVM_LOCK_ORDER_VA_SPACE_READ_ACQUIRE_WRITE_RELEASE_LOCK
-//      Exclusive lock (mutex) per uvm_va_space (UVM struct file)
-//
-//      This lock prevents a deadlock between RM and UVM by preventing any
-//      interleaving of down_reads on the VA space lock with concurrent
-//      up_writes/downgrade_writes. The Linux rw_semaphore implementation does
-//      not guarantee that two readers will always run concurrently, as shown by
-//      the following interleaving:
-//
-//      Thread A                Thread B
-//      UVM API call            UVM BH
-//      ------------            ------------
-//      down_write
-//                              down_read
-//                                  // Fails, calls handler
-//      up_write
-//      down_read
-//          // Success
-//                                  // Handler sees the lock still active
-//                                  // Handler waits for lock to be released
-//                                  // Blocked on A
-//      RM GPU lock
-//      // Blocked on GPU fault
-//
-//      Given the above interleaving, the kernel's implementation of the
-//      down_read failure handler running in thread B does not distinguish
-//      between a reader vs writer holding the lock. From the perspective of all
-//      other threads, even those which attempt to take the lock for read while
-//      thread A's reader holds it, a writer is active. Therefore no other
-//      readers can take the lock, and we result in the same deadlock described
-//      in the above comments on the VA space writer serialization lock.
-//
-//      This lock prevents any such interleaving:
-//      - Writers take this lock for the duration of the write lock.
-//
-//      - Readers which do not call into RM only take this lock across the
-//        down_read call. If a writer holds the lock, the reader would be
-//        blocked on the VA space lock anyway. Concurrent readers will serialize
-//        the taking of the VA space lock, but they will not be serialized
-//        across their read sections.
-//
-//      - Readers which call into RM do not need to take this lock. Their
-//        down_read is already serialized with a writer's up_write by the
-//        serialize_writers_lock.
-//
 // - VA space lock (va_space->lock)
 //      Order: UVM_LOCK_ORDER_VA_SPACE
-//      Reader/writer lock (rw_semaphore) per uvm_va_space (UVM struct file)
+//      Reader/writer lock (uvm_percpu_rw_semaphore_t) per uvm_va_space (UVM
+//      struct file)
 //
 //      This is the UVM equivalent of mmap_lock. It protects all state under 
 //      that va_space, such as the VA range tree.
 //
+//      The lock is taken in read mode by every CPU and GPU fault, so readers
+//      only touch per-CPU state. Readers never wait for other readers, only for
+//      a writer holding the lock or waiting for it. This also rules out the
+//      rw_semaphore behavior in which a down_read racing with an up_write
+//      keeps waiting on the readers that got in after the up_write, which
+//      could otherwise deadlock a GPU fault against a reader calling into RM.
+//
 //      Read mode: Faults (CPU and GPU), mapping creation, prefetches. These
 //      will be serialized at the VA block level if necessary. RM calls are
 //      allowed only if the VA space serialize_writers_lock is also taken.
@@ -357,7 +319,6 @@ typedef enum
     UVM_LOCK_ORDER_MMAP_LOCK,
     UVM_LOCK_ORDER_VA_SPACES_LIST,
     UVM_LOCK_ORDER_VA_SPACE_SERIALIZE_WRITERS,
-    UVM_LOCK_ORDER_VA_SPACE_READ_ACQUIRE_WRITE_RELEASE_LOCK,
     UVM_LOCK_ORDER_VA_SPACE,
     UVM_LOCK_ORDER_EXT_RANGE_TREE,
     UVM_LOCK_ORDER_GPU_SEMAPHORE_POOL,
@@ -522,6 +483,70 @@ bool __uvm_locking_initialized(void);
   #define uvm_record_unlock_rm_all()
 #endif
 
+// Lock contention statistics, enabled by building with UVM_LOCK_STATS=1. They
+// are kept per lock order class, so they are available on release builds where
+// the lock order tracking above is compiled out, and are exported through
+// /proc/driver/nvidia-uvm/lock_stats.
+//
+// Only uvm_mutex_t, uvm_rw_semaphore_t, uvm_percpu_rw_semaphore_t and the
+// spinlock types are instrumented. An acquisition is contended if the lock
+// couldn't be taken immediately, and only contended acquisitions are timed.
+// Hold times are only tracked for exclusive acquisitions, as shared holders
+// don't have a single acquisition time.
+#if UVM_IS_LOCK_STATS()
+  void __uvm_lock_stats_record_acquire(uvm_lock_order_t lock_order, bool contended, NvU64 wait_time);
+  void __uvm_lock_stats_record_hold(uvm_lock_order_t lock_order, NvU64 hold_time);
+
+  // Print the statistics of all lock orders which have been acquired at least
+  // once
+  struct seq_file;
+  void uvm_lock_stats_print(struct seq_file *s);
+
+  // Record an acquisition which didn't have to wait
+  #define uvm_lock_stats_acquired(lock) \
+      __uvm_lock_stats_record_acquire((lock)->lock_order, false, 0)
+
+  // Run the blocking lock_stmt and record it as a contended acquisition
+  #define uvm_lock_stats_wait(lock, lock_stmt) ({                                                 \
+          NvU64 _wait_start = NV_GETTIME();                                                       \
+          lock_stmt;                                                                              \
+          __uvm_lock_stats_record_acquire((lock)->lock_order, true, NV_GETTIME() - _wait_start); \
+      })
+
+  // Acquire with try_expr first and fall back to the blocking lock_stmt, so
+  // that only contended acquisitions pay for the timestamps
+  #define uvm_lock_stats_lock(lock, try_expr, lock_stmt) ({ \
+          if (try_expr)                                     \
+              uvm_lock_stats_acquired(lock);                \
+          else                                              \
+              uvm_lock_stats_wait(lock, lock_stmt);         \
+      })
+
+  // Run waited_expr, which returns whether the acquisition had to wait
+  #define uvm_lock_stats_timed(lock, waited_expr) ({                                 \
+          NvU64 _wait_start = NV_GETTIME();                                          \
+          bool _waited = (waited_expr);                                              \
+          __uvm_lock_stats_record_acquire((lock)->lock_order,                        \
+                                          _waited,                                   \
+                                          _waited ? NV_GETTIME() - _wait_start : 0); \
+      })
+
+  #define uvm_lock_stats_hold_begin(lock) ((lock)->stats_acquire_time = NV_GETTIME())
+  #define uvm_lock_stats_hold_end(lock) \
+      __uvm_lock_stats_record_hold((lock)->lock_order, NV_GETTIME() - (lock)->stats_acquire_time)
+#else
+  #define uvm_lock_stats_acquired                       UVM_IGNORE_EXPR
+  #define uvm_lock_stats_wait(lock, lock_stmt)          lock_stmt
+  #define uvm_lock_stats_lock(lock, try_expr, lock_stmt) lock_stmt
+  #define uvm_lock_stats_timed(lock, waited_expr)       ((void)(waited_expr))
+  #define uvm_lock_stats_hold_begin                     UVM_IGNORE_EXPR
+  #define uvm_lock_stats_hold_end                       UVM_IGNORE_EXPR
+#endif
+
+// Lock types carry their lock order when either lock order tracking or lock
+// statistics need it
+#define UVM_LOCK_HAS_ORDER() (UVM_IS_DEBUG() || UVM_IS_LOCK_STATS())
+
 #define uvm_locking_assert_initialized() UVM_ASSERT(__uvm_locking_initialized())
 #define uvm_thread_assert_all_unlocked() UVM_ASSERT(__uvm_thread_check_all_unlocked())
 #define uvm_assert_lockable_order(order) UVM_ASSERT(__uvm_check_lockable_order(order, UVM_LOCK_FLAGS_MODE_ANY))
@@ -590,9 +615,13 @@ bool __uvm_locking_initialized(void);
 typedef struct
 {
     struct rw_semaphore sem;
-#if UVM_IS_DEBUG()
+#if UVM_LOCK_HAS_ORDER()
     uvm_lock_order_t lock_order;
 #endif
+#if UVM_IS_LOCK_STATS()
+    // Time of the last exclusive acquisition
+    NvU64 stats_acquire_time;
+#endif
 } uvm_rw_semaphore_t;
 
 //
@@ -622,6 +651,8 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
     init_rwsem(&uvm_sem->sem);
 #if UVM_IS_DEBUG()
     uvm_locking_assert_initialized();
+#endif
+#if UVM_LOCK_HAS_ORDER()
     uvm_sem->lock_order = lock_order;
 #endif
     uvm_assert_rwsem_unlocked(uvm_sem);
@@ -630,7 +661,9 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
 #define uvm_down_read(uvm_sem) ({                          \
         typeof(uvm_sem) _sem = (uvm_sem);                  \
         uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_SHARED); \
-        down_read(&_sem->sem);                             \
+        uvm_lock_stats_lock(_sem,                          \
+                            down_read_trylock(&_sem->sem), \
+                            down_read(&_sem->sem));        \
         uvm_assert_rwsem_locked_read(_sem);                \
     })
 
@@ -654,7 +687,10 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
 #define uvm_down_write(uvm_sem) ({                            \
         typeof (uvm_sem) _sem = (uvm_sem);                    \
         uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
-        down_write(&_sem->sem);                               \
+        uvm_lock_stats_lock(_sem,                             \
+                            down_write_trylock(&_sem->sem),   \
+                            down_write(&_sem->sem));          \
+        uvm_lock_stats_hold_begin(_sem);                      \
         uvm_assert_rwsem_locked_write(_sem);                  \
     })
 
@@ -668,10 +704,13 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
         int locked;                                                                 \
         uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_SHARED | UVM_LOCK_FLAGS_TRYLOCK); \
         locked = down_read_trylock(&_sem->sem);                                     \
-        if (locked == 0)                                                            \
+        if (locked == 0) {                                                          \
             uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_SHARED);                    \
-        else                                                                        \
+        }                                                                           \
+        else {                                                                      \
+            uvm_lock_stats_acquired(_sem);                                          \
             uvm_assert_rwsem_locked_read(_sem);                                     \
+        }                                                                           \
         locked;                                                                     \
     })
 
@@ -695,16 +734,21 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
         int locked;                                                                    \
         uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE | UVM_LOCK_FLAGS_TRYLOCK); \
         locked = down_write_trylock(&_sem->sem);                                       \
-        if (locked == 0)                                                               \
+        if (locked == 0) {                                                             \
             uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);                    \
-        else                                                                           \
+        }                                                                              \
+        else {                                                                         \
+            uvm_lock_stats_acquired(_sem);                                             \
+            uvm_lock_stats_hold_begin(_sem);                                           \
             uvm_assert_rwsem_locked_write(_sem);                                       \
+        }                                                                              \
         locked;                                                                        \
     })
 
 #define uvm_up_write(uvm_sem) ({                                \
         typeof(uvm_sem) _sem = (uvm_sem);                       \
         uvm_assert_rwsem_locked_write(_sem);                    \
+        uvm_lock_stats_hold_end(_sem);                          \
         up_write(&_sem->sem);                                   \
         uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -712,16 +756,147 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
 #define uvm_downgrade_write(uvm_sem) ({                 \
         typeof(uvm_sem) _sem = (uvm_sem);               \
         uvm_assert_rwsem_locked_write(_sem);            \
+        uvm_lock_stats_hold_end(_sem);                  \
         downgrade_write(&_sem->sem);                    \
         uvm_record_downgrade(_sem);                     \
     })
 
+// Reader-biased reader/writer semaphore, in the spirit of the kernel's
+// percpu_rw_semaphore. Readers only touch a per-CPU counter and a shared flag
+// that is written by writers alone, so concurrent readers on different CPUs
+// don't bounce a shared cache line. Writers are expensive: they have to wait
+// for the per-CPU counts to drain. Use this only for locks which are nearly
+// always taken in read mode.
+//
+// Unlike rw_semaphore, readers never wait for other readers, only for a writer
+// holding the lock or waiting for readers to drain. Downgrading from write to
+// read mode is supported.
+typedef struct
+{
+    // Per-CPU count of readers holding the lock. A reader may release the lock
+    // on a different CPU than the one it took it on, so only the sum across
+    // all CPUs is meaningful.
+    int __percpu *read_count;
+
+    // Set while a writer is holding the lock or waiting for readers to drain
+    int writer;
+
+    // Serializes writers
+    struct mutex writer_lock;
+
+    // Readers waiting on the writer and writers waiting on readers
+    wait_queue_head_t wait_queue;
+
+#if UVM_LOCK_HAS_ORDER()
+    uvm_lock_order_t lock_order;
+#endif
+#if UVM_IS_LOCK_STATS()
+    // Time of the last exclusive acquisition
+    NvU64 stats_acquire_time;
+#endif
+} uvm_percpu_rw_semaphore_t;
+
+NV_STATUS uvm_init_percpu_rwsem(uvm_percpu_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_order);
+void uvm_deinit_percpu_rwsem(uvm_percpu_rw_semaphore_t *uvm_sem);
+
+// Whether any thread holds the lock or a writer is waiting for it
+bool __uvm_percpu_rwsem_is_locked(uvm_percpu_rw_semaphore_t *uvm_sem);
+
+void __uvm_percpu_down_read_slow(uvm_percpu_rw_semaphore_t *uvm_sem);
+void __uvm_percpu_up_read(uvm_percpu_rw_semaphore_t *uvm_sem);
+// Returns whether the writer had to wait for other writers or for readers to
+// drain
+bool __uvm_percpu_down_write(uvm_percpu_rw_semaphore_t *uvm_sem);
+void __uvm_percpu_up_write(uvm_percpu_rw_semaphore_t *uvm_sem);
+void __uvm_percpu_downgrade_write(uvm_percpu_rw_semaphore_t *uvm_sem);
+
+static inline bool __uvm_percpu_down_read_fast(uvm_percpu_rw_semaphore_t *uvm_sem)
+{
+    bool locked;
+
+    preempt_disable();
+
+    __this_cpu_inc(*uvm_sem->read_count);
+
+    // Pairs with the barrier in __uvm_percpu_down_write(). Either the writer
+    // observes this reader's count or this reader observes the writer's flag.
+    smp_mb();
+
+    locked = !READ_ONCE(uvm_sem->writer);
+    if (!locked)
+        __this_cpu_dec(*uvm_sem->read_count);
+
+    preempt_enable();
+
+    return locked;
+}
+
+#define uvm_assert_percpu_rwsem_locked_mode(uvm_sem, flags) ({                                      \
+        typeof(uvm_sem) _sem_ = (uvm_sem);                                                          \
+        UVM_ASSERT(__uvm_percpu_rwsem_is_locked(_sem_) && uvm_check_locked(_sem_, (flags)));        \
+    })
+
+#define uvm_assert_percpu_rwsem_locked(uvm_sem) \
+        uvm_assert_percpu_rwsem_locked_mode(uvm_sem, UVM_LOCK_FLAGS_MODE_ANY)
+#define uvm_assert_percpu_rwsem_locked_read(uvm_sem) \
+        uvm_assert_percpu_rwsem_locked_mode(uvm_sem, UVM_LOCK_FLAGS_MODE_SHARED)
+#define uvm_assert_percpu_rwsem_locked_write(uvm_sem) \
+        uvm_assert_percpu_rwsem_locked_mode(uvm_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE)
+
+#define uvm_assert_percpu_rwsem_unlocked(uvm_sem) UVM_ASSERT(!__uvm_percpu_rwsem_is_locked(uvm_sem))
+
+#define uvm_percpu_down_read(uvm_sem) ({                            \
+        typeof(uvm_sem) _sem = (uvm_sem);                           \
+        uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_SHARED);          \
+        if (__uvm_percpu_down_read_fast(_sem))                      \
+            uvm_lock_stats_acquired(_sem);                          \
+        else                                                        \
+            uvm_lock_stats_wait(_sem,                               \
+                                __uvm_percpu_down_read_slow(_sem)); \
+        uvm_assert_percpu_rwsem_locked_read(_sem);                  \
+    })
+
+#define uvm_percpu_up_read(uvm_sem) ({                       \
+        typeof(uvm_sem) _sem = (uvm_sem);                    \
+        uvm_assert_percpu_rwsem_locked_read(_sem);           \
+        __uvm_percpu_up_read(_sem);                          \
+        uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_SHARED); \
+    })
+
+#define uvm_percpu_down_write(uvm_sem) ({                          \
+        typeof (uvm_sem) _sem = (uvm_sem);                         \
+        uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);      \
+        uvm_lock_stats_timed(_sem, __uvm_percpu_down_write(_sem)); \
+        uvm_lock_stats_hold_begin(_sem);                           \
+        uvm_assert_percpu_rwsem_locked_write(_sem);                \
+    })
+
+#define uvm_percpu_up_write(uvm_sem) ({                         \
+        typeof(uvm_sem) _sem = (uvm_sem);                       \
+        uvm_assert_percpu_rwsem_locked_write(_sem);             \
+        uvm_lock_stats_hold_end(_sem);                          \
+        __uvm_percpu_up_write(_sem);                            \
+        uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
+    })
+
+#define uvm_percpu_downgrade_write(uvm_sem) ({          \
+        typeof(uvm_sem) _sem = (uvm_sem);               \
+        uvm_assert_percpu_rwsem_locked_write(_sem);     \
+        uvm_lock_stats_hold_end(_sem);                  \
+        __uvm_percpu_downgrade_write(_sem);             \
+        uvm_record_downgrade(_sem);                     \
+    })
+
 typedef struct
 {
     struct mutex m;
-#if UVM_IS_DEBUG()
+#if UVM_LOCK_HAS_ORDER()
     uvm_lock_order_t lock_order;
 #endif
+#if UVM_IS_LOCK_STATS()
+    // Time of the last exclusive acquisition
+    NvU64 stats_acquire_time;
+#endif
 } uvm_mutex_t;
 
 //
@@ -758,6 +933,8 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
     mutex_init(&mutex->m);
 #if UVM_IS_DEBUG()
     uvm_locking_assert_initialized();
+#endif
+#if UVM_LOCK_HAS_ORDER()
     mutex->lock_order = lock_order;
 #endif
     uvm_assert_mutex_unlocked(mutex);
@@ -767,10 +944,35 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
         typeof(mutex) _mutex = (mutex);                         \
         uvm_assert_mutex_interrupts();                          \
         uvm_record_lock(_mutex, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
-        mutex_lock(&_mutex->m);                                 \
+        uvm_lock_stats_lock(_mutex,                             \
+                            mutex_trylock(&_mutex->m),          \
+                            mutex_lock(&_mutex->m));            \
+        uvm_lock_stats_hold_begin(_mutex);                      \
         uvm_assert_mutex_locked(_mutex);                        \
     })
 
+// trylock: returns 1 if successful, 0 if not. Out-of-order lock acquisition
+// via this function is legal, i.e. the lock order checker will allow it.
+// However, if an out-of-order lock acquisition attempt fails, it is the
+// caller's responsibility to back off at least to the point where the next
+// held lower-order lock is released.
+#define uvm_mutex_trylock(mutex) ({                                                    \
+        typeof(mutex) _mutex = (mutex);                                                \
+        int locked;                                                                    \
+        uvm_assert_mutex_interrupts();                                                 \
+        uvm_record_lock(_mutex, UVM_LOCK_FLAGS_MODE_EXCLUSIVE | UVM_LOCK_FLAGS_TRYLOCK); \
+        locked = mutex_trylock(&_mutex->m);                                            \
+        if (locked == 0) {                                                             \
+            uvm_record_unlock(_mutex, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);                  \
+        }                                                                              \
+        else {                                                                         \
+            uvm_lock_stats_acquired(_mutex);                                           \
+            uvm_lock_stats_hold_begin(_mutex);                                         \
+            uvm_assert_mutex_locked(_mutex);                                           \
+        }                                                                              \
+        locked;                                                                        \
+    })
+
 // Lock w/o any tracking. This should be extremely rare and *_no_tracking
 // helpers will be added only as needed.
 #define uvm_mutex_lock_no_tracking(mutex)  ({   \
@@ -782,6 +984,7 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
         typeof(mutex) _mutex = (mutex);                           \
         uvm_assert_mutex_interrupts();                            \
         uvm_assert_mutex_locked(_mutex);                          \
+        uvm_lock_stats_hold_end(_mutex);                          \
         mutex_unlock(&_mutex->m);                                 \
         uvm_record_unlock(_mutex, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -789,6 +992,7 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
         typeof(mutex) _mutex = (mutex);                                        \
         uvm_assert_mutex_interrupts();                                         \
         uvm_assert_mutex_locked(_mutex);                                       \
+        uvm_lock_stats_hold_end(_mutex);                                       \
         mutex_unlock(&_mutex->m);                                              \
         uvm_record_unlock_out_of_order(_mutex, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -844,9 +1048,13 @@ static void uvm_sema_init(uvm_semaphore_t *semaphore, int val, uvm_lock_order_t
 typedef struct
 {
     spinlock_t lock;
-#if UVM_IS_DEBUG()
+#if UVM_LOCK_HAS_ORDER()
     uvm_lock_order_t lock_order;
 #endif
+#if UVM_IS_LOCK_STATS()
+    // Time of the last exclusive acquisition
+    NvU64 stats_acquire_time;
+#endif
 } uvm_spinlock_t;
 
 // A separate spinlock type for spinlocks that need to disable interrupts. For
@@ -857,9 +1065,13 @@ typedef struct
 {
     spinlock_t lock;
     unsigned long irq_flags;
-#if UVM_IS_DEBUG()
+#if UVM_LOCK_HAS_ORDER()
     uvm_lock_order_t lock_order;
 #endif
+#if UVM_IS_LOCK_STATS()
+    // Time of the last exclusive acquisition
+    NvU64 stats_acquire_time;
+#endif
 } uvm_spinlock_irqsave_t;
 
 // Asserts that the spinlock is held. Notably the macros below support both
@@ -883,6 +1095,8 @@ static void uvm_spin_lock_init(uvm_spinlock_t *spinlock, uvm_lock_order_t lock_o
     spin_lock_init(&spinlock->lock);
 #if UVM_IS_DEBUG()
     uvm_locking_assert_initialized();
+#endif
+#if UVM_LOCK_HAS_ORDER()
     spinlock->lock_order = lock_order;
 #endif
     uvm_assert_spinlock_unlocked(spinlock);
@@ -891,13 +1105,17 @@ static void uvm_spin_lock_init(uvm_spinlock_t *spinlock, uvm_lock_order_t lock_o
 #define uvm_spin_lock(uvm_lock) ({                             \
         typeof(uvm_lock) _lock = (uvm_lock);                   \
         uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
-        spin_lock(&_lock->lock);                               \
+        uvm_lock_stats_lock(_lock,                             \
+                            spin_trylock(&_lock->lock),        \
+                            spin_lock(&_lock->lock));          \
+        uvm_lock_stats_hold_begin(_lock);                      \
         uvm_assert_spinlock_locked(_lock);                     \
     })
 
 #define uvm_spin_unlock(uvm_lock) ({                             \
         typeof(uvm_lock) _lock = (uvm_lock);                     \
         uvm_assert_spinlock_locked(_lock);                       \
+        uvm_lock_stats_hold_end(_lock);                          \
         spin_unlock(&_lock->lock);                               \
         uvm_record_unlock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -907,19 +1125,24 @@ static void uvm_spin_lock_irqsave_init(uvm_spinlock_irqsave_t *spinlock, uvm_loc
     spin_lock_init(&spinlock->lock);
 #if UVM_IS_DEBUG()
     uvm_locking_assert_initialized();
+#endif
+#if UVM_LOCK_HAS_ORDER()
     spinlock->lock_order = lock_order;
 #endif
     uvm_assert_spinlock_unlocked(spinlock);
 }
 
 // Use a temp to not rely on flags being written after acquiring the lock.
-#define uvm_spin_lock_irqsave(uvm_lock) ({                     \
-        typeof(uvm_lock) _lock = (uvm_lock);                   \
-        unsigned long irq_flags;                               \
-        uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
-        spin_lock_irqsave(&_lock->lock, irq_flags);            \
-        _lock->irq_flags = irq_flags;                          \
-        uvm_assert_spinlock_locked(_lock);                     \
+#define uvm_spin_lock_irqsave(uvm_lock) ({                                 \
+        typeof(uvm_lock) _lock = (uvm_lock);                               \
+        unsigned long irq_flags;                                           \
+        uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);             \
+        uvm_lock_stats_lock(_lock,                                         \
+                            spin_trylock_irqsave(&_lock->lock, irq_flags), \
+                            spin_lock_irqsave(&_lock->lock, irq_flags));   \
+        _lock->irq_flags = irq_flags;                                      \
+        uvm_lock_stats_hold_begin(_lock);                                  \
+        uvm_assert_spinlock_locked(_lock);                                 \
     })
 
 // Use a temp to not rely on flags being read before releasing the lock.
@@ -927,6 +1150,7 @@ static void uvm_spin_lock_irqsave_init(uvm_spinlock_irqsave_t *spinlock, uvm_loc
         typeof(uvm_lock) _lock = (uvm_lock);                     \
         unsigned long irq_flags = _lock->irq_flags;              \
         uvm_assert_spinlock_locked(_lock);                       \
+        uvm_lock_stats_hold_end(_lock);                          \
         spin_unlock_irqrestore(&_lock->lock, irq_flags);         \
         uvm_record_unlock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
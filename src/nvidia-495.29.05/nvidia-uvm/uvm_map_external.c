@@ -45,6 +45,32 @@
 // Assume almost all of the push space can be used for PTEs leaving 1K of margin.
 #define MAX_COPY_SIZE_PER_PUSH ((size_t)(UVM_MAX_PUSH_SIZE - 1024))
 
+// Maximum number of CPU_TO_GPU channels the PTE writes of a single mapping are
+// spread across. The pushes writing PTEs are independent from each other,
+// except for the last one, which issues the TLB invalidate. 0 or 1 serializes
+// all the pushes, which minimizes bus contention but makes the mapping latency
+// of large allocations proportional to their size.
+static unsigned uvm_ext_map_parallel_channels = 4;
+module_param(uvm_ext_map_parallel_channels, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_ext_map_parallel_channels,
+                 "Max number of channels used to write the PTEs of an external mapping");
+
+// State used to spread the PTE writes of a mapping across channels
+typedef struct
+{
+    // Channels to rotate through, in the default CPU_TO_GPU pool
+    uvm_channel_pool_t *pool;
+
+    NvU32 num_channels;
+
+    // Index of the channel used by the next push
+    NvU32 next_channel;
+
+    // Pushes in flight on all the channels. The last push acquires it before
+    // the TLB invalidate.
+    uvm_tracker_t tracker;
+} uvm_pte_copy_channels_t;
+
 typedef struct
 {
     // The VA range the buffer is for
@@ -199,8 +225,29 @@ static NV_STATUS uvm_pte_buffer_get(uvm_pte_buffer_t *pte_buffer,
     return NV_OK;
 }
 
+static void uvm_pte_copy_channels_init(uvm_gpu_t *gpu, uvm_pte_copy_channels_t *copy_channels)
+{
+    copy_channels->pool = gpu->channel_manager->pool_to_use.default_for_type[UVM_CHANNEL_TYPE_CPU_TO_GPU];
+    copy_channels->num_channels = min(uvm_ext_map_parallel_channels, copy_channels->pool->num_channels);
+    copy_channels->next_channel = 0;
+    uvm_tracker_init(&copy_channels->tracker);
+}
+
+static void uvm_pte_copy_channels_deinit(uvm_pte_copy_channels_t *copy_channels)
+{
+    uvm_tracker_deinit(&copy_channels->tracker);
+}
+
+static bool uvm_pte_copy_channels_parallel(uvm_pte_copy_channels_t *copy_channels)
+{
+    return copy_channels->num_channels > 1;
+}
+
 // Copies the input ptes buffer to the given physical address, with an optional
-// TLB invalidate. The copy acquires the input tracker then updates it.
+// TLB invalidate. The copy acquires the input tracker. If copies are spread
+// across channels and this is not the last mapping, the push is added to the
+// copy_channels tracker. Otherwise, all the copies in flight are acquired as
+// well, and the input tracker is updated.
 static NV_STATUS copy_ptes(uvm_page_tree_t *tree,
                            NvU64 page_size,
                            uvm_gpu_phys_address_t pte_addr,
@@ -208,24 +255,53 @@ static NV_STATUS copy_ptes(uvm_page_tree_t *tree,
                            NvU32 num_ptes,
                            bool last_mapping,
                            uvm_range_tree_node_t *range_node,
+                           uvm_pte_copy_channels_t *copy_channels,
                            uvm_tracker_t *tracker)
 {
     uvm_push_t push;
     NV_STATUS status;
     NvU32 pte_size = uvm_mmu_pte_size(tree, page_size);
+    bool parallel = uvm_pte_copy_channels_parallel(copy_channels) && !last_mapping;
 
     UVM_ASSERT(((NvU64)pte_size) * num_ptes == pte_size * num_ptes);
     UVM_ASSERT(pte_size * num_ptes <= MAX_COPY_SIZE_PER_PUSH);
 
-    // CPU_TO_GPU because the data being transferred is within the pushbuffer
-    status = uvm_push_begin_acquire(tree->gpu->channel_manager,
-                                    UVM_CHANNEL_TYPE_CPU_TO_GPU,
-                                    tracker,
-                                    &push,
-                                    "Writing %u bytes of PTEs to {%s, 0x%llx}",
-                                    pte_size * num_ptes,
-                                    uvm_aperture_string(pte_addr.aperture),
-                                    pte_addr.address);
+    if (parallel) {
+        uvm_channel_t *channel = copy_channels->pool->channels + copy_channels->next_channel;
+
+        copy_channels->next_channel = (copy_channels->next_channel + 1) % copy_channels->num_channels;
+
+        // CPU_TO_GPU because the data being transferred is within the
+        // pushbuffer
+        status = uvm_push_begin_acquire_on_channel(channel,
+                                                   tracker,
+                                                   &push,
+                                                   "Writing %u bytes of PTEs to {%s, 0x%llx}",
+                                                   pte_size * num_ptes,
+                                                   uvm_aperture_string(pte_addr.aperture),
+                                                   pte_addr.address);
+    }
+    else {
+        // The TLB invalidate must wait for the PTE writes in flight on all
+        // channels
+        status = uvm_tracker_add_tracker_safe(tracker, &copy_channels->tracker);
+        if (status != NV_OK)
+            return status;
+
+        uvm_tracker_clear(&copy_channels->tracker);
+
+        // CPU_TO_GPU because the data being transferred is within the
+        // pushbuffer
+        status = uvm_push_begin_acquire(tree->gpu->channel_manager,
+                                        UVM_CHANNEL_TYPE_CPU_TO_GPU,
+                                        tracker,
+                                        &push,
+                                        "Writing %u bytes of PTEs to {%s, 0x%llx}",
+                                        pte_size * num_ptes,
+                                        uvm_aperture_string(pte_addr.aperture),
+                                        pte_addr.address);
+    }
+
     if (status != NV_OK)
         return status;
 
@@ -255,6 +331,9 @@ static NV_STATUS copy_ptes(uvm_page_tree_t *tree,
 
     uvm_push_end(&push);
 
+    if (parallel)
+        return uvm_tracker_add_push_safe(&copy_channels->tracker, &push);
+
     // The push acquired the tracker so it's ok to just overwrite it with
     // the entry tracking the push.
     uvm_tracker_overwrite_with_push(tracker, &push);
@@ -264,7 +343,8 @@ static NV_STATUS copy_ptes(uvm_page_tree_t *tree,
 
 // Map all of pt_range, which is contained with the va_range and begins at
 // virtual address map_start. The PTE values are queried from RM and the pushed
-// writes are added to the input tracker.
+// writes are added to the input tracker, or to the copy_channels tracker if
+// they are spread across channels. See copy_ptes.
 //
 // If the mapped range ends on range_node->end, a TLB invalidate for upgrade is
 // also issued.
@@ -275,6 +355,7 @@ static NV_STATUS map_rm_pt_range(uvm_page_tree_t *tree,
                                  NvHandle mem_handle,
                                  NvU64 map_start,
                                  NvU64 map_offset,
+                                 uvm_pte_copy_channels_t *copy_channels,
                                  uvm_tracker_t *tracker)
 {
     uvm_gpu_phys_address_t pte_addr;
@@ -313,10 +394,11 @@ static NV_STATUS map_rm_pt_range(uvm_page_tree_t *tree,
 
         last_mapping = (addr + map_size - 1 == range_node->end);
 
-        // These copies are technically independent, except for the last one
-        // which issues the TLB invalidate and thus must wait for all others.
-        // However, since each copy will saturate the bus anyway we force them
-        // to serialize to avoid bus contention.
+        // These copies are independent, except for the last one which issues
+        // the TLB invalidate and thus must wait for all others. They are
+        // spread across uvm_ext_map_parallel_channels channels, so the GPU
+        // writes PTEs while the CPU queries RM for the next chunk. With a
+        // single channel they serialize, which avoids bus contention.
         status = copy_ptes(tree,
                            page_size,
                            pte_addr,
@@ -324,6 +406,7 @@ static NV_STATUS map_rm_pt_range(uvm_page_tree_t *tree,
                            num_ptes,
                            last_mapping,
                            range_node,
+                           copy_channels,
                            tracker);
         if (status != NV_OK)
             return status;
@@ -369,6 +452,7 @@ NV_STATUS uvm_va_range_map_rm_allocation(uvm_va_range_t *va_range,
     uvm_gpu_va_space_t *gpu_va_space = uvm_gpu_va_space_get(va_range->va_space, mapping_gpu);
     uvm_page_tree_t *page_tree;
     uvm_pte_buffer_t pte_buffer;
+    uvm_pte_copy_channels_t copy_channels;
     uvm_page_table_range_vec_t *pt_range_vec;
     uvm_page_table_range_t *pt_range;
     uvm_range_tree_node_t *node;
@@ -432,6 +516,8 @@ NV_STATUS uvm_va_range_map_rm_allocation(uvm_va_range_t *va_range,
     if (status != NV_OK)
         return status;
 
+    uvm_pte_copy_channels_init(mapping_gpu, &copy_channels);
+
     // Allocate all page tables for this VA range.
     //
     // TODO: Bug 1766649: Benchmark to see if we get any performance improvement
@@ -459,6 +545,7 @@ NV_STATUS uvm_va_range_map_rm_allocation(uvm_va_range_t *va_range,
                                  ext_gpu_map ? ext_gpu_map->mem_handle->rm_handle : 0,
                                  addr,
                                  map_offset,
+                                 &copy_channels,
                                  tracker);
         if (status != NV_OK)
             goto out;
@@ -468,13 +555,16 @@ NV_STATUS uvm_va_range_map_rm_allocation(uvm_va_range_t *va_range,
         map_offset += size;
     }
 
+    // The last copy acquired all the copies in flight on other channels
+    UVM_ASSERT(uvm_tracker_is_empty(&copy_channels.tracker));
+
     status = uvm_tracker_add_tracker(out_tracker, tracker);
 
 out:
     if (status != NV_OK) {
         // We could have any number of mappings in flight to these page tables,
         // so wait for everything before we clear and free them.
-        if (uvm_tracker_wait(tracker) != NV_OK) {
+        if (uvm_tracker_wait(&copy_channels.tracker) != NV_OK || uvm_tracker_wait(tracker) != NV_OK) {
             // System-fatal error. Just leak.
             return status;
         }
@@ -485,6 +575,7 @@ out:
         }
     }
 
+    uvm_pte_copy_channels_deinit(&copy_channels);
     uvm_pte_buffer_deinit(&pte_buffer);
     uvm_tracker_deinit(&local_tracker);
     return status;
@@ -683,7 +774,7 @@ static uvm_ext_gpu_map_t *uvm_va_range_ext_gpu_map(uvm_va_range_t *va_range, uvm
     uvm_ext_gpu_range_tree_t *range_tree;
 
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_EXTERNAL);
-    uvm_assert_rwsem_locked(&va_range->va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_range->va_space->lock);
 
     range_tree = uvm_ext_gpu_range_tree(va_range, mapping_gpu);
 
@@ -851,7 +942,7 @@ static NV_STATUS uvm_map_external_allocation_on_gpu(uvm_va_range_t *va_range,
     UvmGpuMemoryInfo mem_info;
     NV_STATUS status;
 
-    uvm_assert_rwsem_locked_read(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_read(&va_space->lock);
 
     if ((map_rm_params->compression_type == UvmGpuCompressionTypeEnabledNoPlc) && !mapping_gpu->parent->plc_supported)
         return NV_ERR_INVALID_DEVICE;
@@ -1066,7 +1157,7 @@ static NV_STATUS uvm_map_external_sparse_on_gpu(uvm_va_range_t *va_range,
     uvm_page_tree_t *page_tree;
     NV_STATUS status;
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!uvm_gpu_can_address(mapping_gpu, base + length - 1))
         return NV_ERR_OUT_OF_RANGE;
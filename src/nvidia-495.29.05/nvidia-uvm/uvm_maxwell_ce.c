@@ -262,6 +262,51 @@ void uvm_hal_maxwell_ce_memcopy_v_to_v(uvm_push_t *push, NvU64 dst_va, NvU64 src
     uvm_hal_maxwell_ce_memcopy(push, uvm_gpu_address_virtual(dst_va), uvm_gpu_address_virtual(src_va), size);
 }
 
+void uvm_hal_maxwell_ce_memcopy_2d(uvm_push_t *push,
+                                   uvm_gpu_address_t dst,
+                                   NvU32 dst_pitch,
+                                   uvm_gpu_address_t src,
+                                   NvU32 src_pitch,
+                                   NvU32 line_length,
+                                   NvU32 line_count)
+{
+    uvm_gpu_t *gpu = uvm_push_get_gpu(push);
+
+    NvU32 pipelined_value;
+    NvU32 launch_dma_src_dst_type;
+    NvU32 launch_dma_plc_mode;
+
+    UVM_ASSERT(line_length > 0);
+    UVM_ASSERT(line_count > 0);
+
+    launch_dma_src_dst_type = gpu->parent->ce_hal->phys_mode(push, dst, src);
+    launch_dma_plc_mode = gpu->parent->ce_hal->plc_mode();
+
+    if (uvm_push_get_and_reset_flag(push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED))
+        pipelined_value = HWCONST(B0B5, LAUNCH_DMA, DATA_TRANSFER_TYPE, PIPELINED);
+    else
+        pipelined_value = HWCONST(B0B5, LAUNCH_DMA, DATA_TRANSFER_TYPE, NON_PIPELINED);
+
+    gpu->parent->ce_hal->offset_in_out(push, src.address, dst.address);
+
+    NV_PUSH_4U(B0B5, PITCH_IN, src_pitch,
+                     PITCH_OUT, dst_pitch,
+                     LINE_LENGTH_IN, line_length,
+                     LINE_COUNT, line_count);
+
+    NV_PUSH_1U(B0B5, LAUNCH_DMA,
+       HWCONST(B0B5, LAUNCH_DMA, SRC_MEMORY_LAYOUT, PITCH) |
+       HWCONST(B0B5, LAUNCH_DMA, DST_MEMORY_LAYOUT, PITCH) |
+       HWCONST(B0B5, LAUNCH_DMA, MULTI_LINE_ENABLE, TRUE) |
+       HWCONST(B0B5, LAUNCH_DMA, REMAP_ENABLE, FALSE) |
+       HWCONST(B0B5, LAUNCH_DMA, FLUSH_ENABLE, FALSE) |
+       launch_dma_src_dst_type |
+       launch_dma_plc_mode |
+       pipelined_value);
+
+    maxwell_membar_after_transfer(push);
+}
+
 // Push SET_DST_PHYS mode if needed and return LAUNCH_DMA_DST_TYPE flags
 static NvU32 memset_push_phys_mode(uvm_push_t *push, uvm_gpu_address_t dst)
 {
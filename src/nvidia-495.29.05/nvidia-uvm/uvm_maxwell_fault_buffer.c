@@ -69,6 +69,15 @@ void uvm_hal_maxwell_fault_buffer_parse_entry_unsupported(uvm_parent_gpu_t *pare
     UVM_ASSERT_MSG(false, "fault_buffer_parse_entry is not supported on GPU: %s.\n", parent_gpu->name);
 }
 
+NvU32 uvm_hal_maxwell_fault_buffer_parse_entries_unsupported(uvm_parent_gpu_t *parent_gpu,
+                                                             NvU32 index,
+                                                             NvU32 count,
+                                                             uvm_fault_buffer_entry_t *buffer_entries)
+{
+    UVM_ASSERT_MSG(false, "fault_buffer_parse_entries is not supported on GPU: %s.\n", parent_gpu->name);
+    return 0;
+}
+
 bool uvm_hal_maxwell_fault_buffer_entry_is_valid_unsupported(uvm_parent_gpu_t *parent_gpu, NvU32 index)
 {
     UVM_ASSERT_MSG(false, "fault_buffer_entry_is_valid is not supported on GPU: %s.\n", parent_gpu->name);
@@ -202,9 +202,39 @@ static void uvm_mem_free_chunks(uvm_mem_t *mem)
         uvm_mem_free_vidmem_chunks(mem);
 }
 
-static NV_STATUS uvm_mem_alloc_sysmem_chunks(uvm_mem_t *mem, size_t size)
+static struct page *alloc_sysmem_chunk(int node, gfp_t gfp_flags, unsigned order)
+{
+    // Without a preferred node, follow the memory policy of the calling thread
+    if (node == NUMA_NO_NODE)
+        return alloc_pages(gfp_flags, order);
+
+    return alloc_pages_node(node, gfp_flags, order);
+}
+
+// Allocate num_pages order-0 pages on node into pages, which must be zeroed.
+// Returns the number of pages allocated, which may be less than requested.
+static size_t alloc_sysmem_pages_bulk(int node, gfp_t gfp_flags, size_t num_pages, struct page **pages)
+{
+    size_t num_allocated = 0;
+
+#if defined(NV_ALLOC_PAGES_BULK_ARRAY_NODE_PRESENT)
+    // The bulk allocator takes the pages off the per-CPU free lists in one go,
+    // but may return fewer pages than requested. The regular allocator below
+    // takes care of the rest.
+    num_allocated = alloc_pages_bulk_array_node(gfp_flags, node, num_pages, pages);
+#endif
+
+    for (; num_allocated < num_pages; ++num_allocated) {
+        pages[num_allocated] = alloc_sysmem_chunk(node, gfp_flags, 0);
+        if (!pages[num_allocated])
+            break;
+    }
+
+    return num_allocated;
+}
+
+static NV_STATUS alloc_sysmem_chunks(uvm_mem_t *mem, int node)
 {
-    NV_STATUS status = NV_OK;
     size_t i;
     gfp_t gfp_flags = NV_UVM_GFP_FLAGS;
     unsigned order = get_order(mem->chunk_size);
@@ -213,32 +243,57 @@ static NV_STATUS uvm_mem_alloc_sysmem_chunks(uvm_mem_t *mem, size_t size)
     UVM_ASSERT(PAGE_ALIGNED(mem->chunk_size));
 
     mem->sysmem.pages = uvm_kvmalloc_zero(sizeof(*mem->sysmem.pages) * mem->chunks_count);
-    if (!mem->sysmem.pages) {
-        status = NV_ERR_NO_MEMORY;
-        goto error;
-    }
+    if (!mem->sysmem.pages)
+        return NV_ERR_NO_MEMORY;
 
     if (mem->is_user_allocation)
         gfp_flags |= __GFP_ZERO;
 
+    if (order == 0) {
+        if (alloc_sysmem_pages_bulk(node, gfp_flags, mem->chunks_count, mem->sysmem.pages) != mem->chunks_count)
+            goto error;
+
+        return NV_OK;
+    }
+
     // High-order page allocations require the __GFP_COMP flag to work with
-    // vm_insert_page.
-    if (order > 0)
-        gfp_flags |= __GFP_COMP;
+    // vm_insert_page. Failures are handled by the caller falling back to
+    // PAGE_SIZE chunks, so don't warn about them.
+    gfp_flags |= __GFP_COMP | __GFP_NOWARN;
 
     for (i = 0; i < mem->chunks_count; ++i) {
-        mem->sysmem.pages[i] = alloc_pages(gfp_flags, order);
-        if (!mem->sysmem.pages[i]) {
-            status = NV_ERR_NO_MEMORY;
+        mem->sysmem.pages[i] = alloc_sysmem_chunk(node, gfp_flags, order);
+        if (!mem->sysmem.pages[i])
             goto error;
-        }
     }
 
     return NV_OK;
 
 error:
     uvm_mem_free_sysmem_chunks(mem);
-    return status;
+    return NV_ERR_NO_MEMORY;
+}
+
+static NV_STATUS uvm_mem_alloc_sysmem_chunks(uvm_mem_t *mem, uvm_gpu_t *near_gpu)
+{
+    NV_STATUS status;
+    int node = NUMA_NO_NODE;
+
+    // closest_cpu_numa_node is -1 if the GPU has no NUMA affinity
+    if (near_gpu && near_gpu->parent->closest_cpu_numa_node >= 0)
+        node = near_gpu->parent->closest_cpu_numa_node;
+
+    status = alloc_sysmem_chunks(mem, node);
+    if (status == NV_OK || mem->chunk_size == PAGE_SIZE)
+        return status;
+
+    // The kernel can run out of high-order pages long before it runs out of
+    // memory. Fall back to PAGE_SIZE chunks, which only changes the page size
+    // of the GPU mappings.
+    mem->chunk_size = PAGE_SIZE;
+    mem->chunks_count = mem->physical_allocation_size / mem->chunk_size;
+
+    return alloc_sysmem_chunks(mem, node);
 }
 
 static NV_STATUS uvm_mem_alloc_vidmem_chunks(uvm_mem_t *mem, size_t size)
@@ -262,10 +317,10 @@ static NV_STATUS uvm_mem_alloc_vidmem_chunks(uvm_mem_t *mem, size_t size)
     return NV_OK;
 }
 
-static NV_STATUS uvm_mem_alloc_chunks(uvm_mem_t *mem)
+static NV_STATUS uvm_mem_alloc_chunks(uvm_mem_t *mem, uvm_gpu_t *near_gpu)
 {
     if (uvm_mem_is_sysmem(mem))
-        return uvm_mem_alloc_sysmem_chunks(mem, mem->physical_allocation_size);
+        return uvm_mem_alloc_sysmem_chunks(mem, near_gpu);
     else
         return uvm_mem_alloc_vidmem_chunks(mem, mem->physical_allocation_size);
 }
@@ -337,7 +392,7 @@ NV_STATUS uvm_mem_alloc(uvm_mem_alloc_params_t *params, uvm_mem_t **mem_out)
         UVM_ASSERT(IS_ALIGNED((NvU64)mem->user.addr, mem->chunk_size));
     }
 
-    status = uvm_mem_alloc_chunks(mem);
+    status = uvm_mem_alloc_chunks(mem, params->near_gpu);
     if (status != NV_OK) {
         UVM_ERR_PRINT("uvm_mem_alloc_chunks (chunk count %zu, page size %u) failed: %s, %s\n",
                 mem->chunks_count, mem->chunk_size,
@@ -723,10 +778,11 @@ static NvU64 uvm_mem_pte_maker(uvm_page_table_range_vec_t *range_vec, NvU64 offs
     uvm_page_tree_t *tree = range_vec->tree;
     uvm_gpu_t *gpu = tree->gpu;
     uvm_gpu_phys_address_t phys = uvm_mem_gpu_physical(data->mem, gpu, offset, range_vec->page_size);
-    return tree->hal->make_pte(phys.aperture,
-                               phys.address,
-                               data->attrs->protection,
-                               data->attrs->is_cacheable ? UVM_MMU_PTE_FLAGS_CACHED : UVM_MMU_PTE_FLAGS_NONE);
+    return uvm_hal_make_pte(tree->hal,
+                            phys.aperture,
+                            phys.address,
+                            data->attrs->protection,
+                            data->attrs->is_cacheable ? UVM_MMU_PTE_FLAGS_CACHED : UVM_MMU_PTE_FLAGS_NONE);
 }
 
 static void unmap_gpu(uvm_mem_t *mem, uvm_gpu_t *gpu)
@@ -829,7 +885,7 @@ NV_STATUS uvm_mem_map_gpu_user(uvm_mem_t *mem, uvm_gpu_t *gpu, const uvm_mem_gpu
     if (status != NV_OK)
         return status;
 
-    uvm_assert_rwsem_locked(&mem->user.va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&mem->user.va_space->lock);
     gpu_va_space = uvm_gpu_va_space_get(mem->user.va_space, gpu);
     status = map_gpu(mem, gpu, (NvU64)mem->user.addr, &gpu_va_space->page_tables, attrs);
     if (status != NV_OK)
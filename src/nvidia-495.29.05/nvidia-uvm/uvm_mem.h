@@ -99,7 +99,8 @@ typedef struct
     // If this is a CPU allocation, the physical allocation chunk has to be
     // aligned to PAGE_SIZE and the allocation will be mapped with the largest
     // PTEs possible on the GPUs. If set to UVM_PAGE_SIZE_DEFAULT, PAGE_SIZE
-    // size will be used.
+    // size will be used. If the kernel can't provide chunks of the desired
+    // size, the allocation falls back to PAGE_SIZE chunks.
     //
     // For a GPU allocation, if set to UVM_PAGE_SIZE_DEFAULT, GPU mappings will
     // use the largest page size supported by the backing GPU which is not
@@ -114,6 +115,12 @@ typedef struct
 
     // The address to map at for user mappings. Unused for internal mappings.
     void *user_addr;
+
+    // For sysmem, the GPU expected to access the memory the most, or NULL.
+    // The memory is then preferably allocated from the CPU NUMA node closest
+    // to that GPU, instead of the node of the allocating thread. Unused for
+    // vidmem.
+    uvm_gpu_t *near_gpu;
 } uvm_mem_alloc_params_t;
 
 typedef struct
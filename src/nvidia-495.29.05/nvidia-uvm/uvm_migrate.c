@@ -40,6 +40,7 @@
 #include "uvm_migrate_pageable.h"
 #include "uvm_va_space_mm.h"
 #include "nv_speculation_barrier.h"
+#include "linux/sort.h"
 
 typedef enum
 {
@@ -55,10 +56,77 @@ module_param(uvm_perf_migrate_cpu_preunmap_enable, int, S_IRUGO);
 static unsigned uvm_perf_migrate_cpu_preunmap_block_order = UVM_PERF_MIGRATE_CPU_PREUNMAP_BLOCK_ORDER_DEFAULT;
 module_param(uvm_perf_migrate_cpu_preunmap_block_order, uint, S_IRUGO);
 
+#define UVM_PERF_MIGRATE_WORKERS_DEFAULT 0
+#define UVM_PERF_MIGRATE_WORKERS_MAX     16
+
+// Number of kthreads used to migrate the VA blocks of a VA range in parallel
+// with the calling thread. Each participant pushes its copies independently,
+// so they are spread across the channels of the copy engine pool. 0 means
+// that VA blocks are migrated serially by the calling thread.
+static unsigned uvm_perf_migrate_workers = UVM_PERF_MIGRATE_WORKERS_DEFAULT;
+module_param(uvm_perf_migrate_workers, uint, S_IRUGO);
+
+#define UVM_PERF_MIGRATE_WORKERS_MIN_BLOCKS_DEFAULT 4
+
+// Minimum number of VA blocks in a migration for it to be split across the
+// migration workers
+static unsigned uvm_perf_migrate_workers_min_blocks = UVM_PERF_MIGRATE_WORKERS_MIN_BLOCKS_DEFAULT;
+module_param(uvm_perf_migrate_workers_min_blocks, uint, S_IRUGO);
+
 // Global post-processed values of the module parameters
 static bool g_uvm_perf_migrate_cpu_preunmap_enable __read_mostly;
 static NvU64 g_uvm_perf_migrate_cpu_preunmap_size __read_mostly;
 
+typedef struct
+{
+    nv_kthread_q_t q;
+
+    nv_kthread_q_item_t q_item;
+
+    // Signaled when the worker is done with the blocks of the current dispatch
+    struct completion done;
+
+    // The mm of the current dispatch is set before each dispatch
+    uvm_va_block_context_t *va_block_context;
+
+    // Work pushed by the worker for the current dispatch. It is merged into
+    // the tracker of the caller once the dispatch completes.
+    uvm_tracker_t tracker;
+
+    // First error found by the worker in the current dispatch
+    NV_STATUS status;
+} migrate_worker_t;
+
+static struct
+{
+    NvU32 num_workers;
+
+    migrate_worker_t *workers;
+
+    // Set while a migration is using the workers. Concurrent migrations from
+    // other threads are migrated serially instead of waiting for the pool.
+    atomic_t busy;
+
+    // State of the current dispatch. The VA space lock and mmap_lock (if mm is
+    // not NULL) are held in read mode by the caller for the whole dispatch.
+    uvm_va_range_t *va_range;
+    struct mm_struct *mm;
+    NvU64 start;
+    NvU64 end;
+    size_t first_block_index;
+    NvU32 num_blocks;
+    uvm_processor_id_t dest_id;
+    uvm_migrate_mode_t mode;
+    bool use_tracker;
+
+    // Index (relative to first_block_index) of the next block to be migrated
+    atomic_t next_block;
+
+    // Set when any of the participants fails, so that the rest stop picking
+    // up new blocks
+    atomic_t abort;
+} g_migrate_workers;
+
 static bool is_migration_single_block(uvm_va_range_t *first_va_range, NvU64 base, NvU64 length)
 {
     NvU64 end = base + length - 1;
@@ -370,23 +438,21 @@ static bool va_block_should_do_cpu_preunmap(uvm_va_block_t *va_block,
     return num_cpu_unchanged_pages == 0;
 }
 
-static void preunmap_multi_block(uvm_va_range_t *va_range,
+// Count in num_unmap_pages the CPU mappings in [start, end] that migrating to
+// dest_id will remove. Returns false if some CPU mappings in the range need to
+// be kept, in which case the range can't be unmapped ahead of the migration.
+static bool preunmap_count_pages(uvm_va_range_t *va_range,
                                  uvm_va_block_context_t *va_block_context,
                                  NvU64 start,
                                  NvU64 end,
-                                 uvm_processor_id_t dest_id)
+                                 uvm_processor_id_t dest_id,
+                                 NvU64 *num_unmap_pages)
 {
     size_t i;
     const size_t first_block_index = uvm_va_range_block_index(va_range, start);
     const size_t last_block_index = uvm_va_range_block_index(va_range, end);
-    NvU32 num_unmap_pages = 0;
-
-    UVM_ASSERT(start >= va_range->node.start);
-    UVM_ASSERT(end  <= va_range->node.end);
-    UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
-    uvm_assert_rwsem_locked(&va_range->va_space->lock);
 
-    UVM_ASSERT(uvm_range_group_all_migratable(va_range->va_space, start, end));
+    *num_unmap_pages = 0;
 
     for (i = first_block_index; i <= last_block_index; i++) {
         NvU32 num_block_unmap_pages;
@@ -397,14 +463,242 @@ static void preunmap_multi_block(uvm_va_range_t *va_range,
                                              end,
                                              dest_id,
                                              &num_block_unmap_pages)) {
-            return;
+            return false;
         }
 
-        num_unmap_pages += num_block_unmap_pages;
+        *num_unmap_pages += num_block_unmap_pages;
+    }
+
+    return true;
+}
+
+// Percentage of the pages of a pre-unmap group that need their CPU mappings
+// removed for the group to be considered densely mapped
+#define UVM_MIGRATE_CPU_PREUNMAP_DENSE_PERCENT 50
+
+static bool preunmap_is_dense(NvU64 num_unmap_pages, NvU64 start, NvU64 end)
+{
+    NvU64 num_pages = (end - start + 1) / PAGE_SIZE;
+
+    return num_unmap_pages * 100 >= num_pages * UVM_MIGRATE_CPU_PREUNMAP_DENSE_PERCENT;
+}
+
+// Remove the CPU mappings of the next group of VA blocks to migrate, starting
+// at start, and return the end of the group.
+//
+// Groups are g_uvm_perf_migrate_cpu_preunmap_size long. Densely mapped groups
+// are extended by that much at a time for as long as the mappings stay dense,
+// up to UVM_PERF_MIGRATE_CPU_PREUNMAP_BLOCK_ORDER_MAX. Large migrations of
+// mostly CPU-mapped memory then remove the mappings with a single
+// unmap_mapping_range() call, and a single TLB shootdown, instead of one per
+// group. Sparsely mapped groups aren't extended, as that would only delay the
+// start of their copies for little gain.
+static NvU64 preunmap_multi_block(uvm_va_range_t *va_range,
+                                  uvm_va_block_context_t *va_block_context,
+                                  NvU64 start,
+                                  NvU64 end,
+                                  uvm_processor_id_t dest_id)
+{
+    const NvU64 max_size = UVM_VA_BLOCK_SIZE << UVM_PERF_MIGRATE_CPU_PREUNMAP_BLOCK_ORDER_MAX;
+    NvU64 group_end = min(UVM_ALIGN_UP(start + 1, g_uvm_perf_migrate_cpu_preunmap_size) - 1, end);
+    NvU64 num_unmap_pages;
+
+    UVM_ASSERT(start >= va_range->node.start);
+    UVM_ASSERT(end  <= va_range->node.end);
+    UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
+    uvm_assert_percpu_rwsem_locked(&va_range->va_space->lock);
+
+    UVM_ASSERT(uvm_range_group_all_migratable(va_range->va_space, start, end));
+
+    if (!preunmap_count_pages(va_range, va_block_context, start, group_end, dest_id, &num_unmap_pages))
+        return group_end;
+
+    while (group_end < end &&
+           group_end - start + 1 < max_size &&
+           preunmap_is_dense(num_unmap_pages, start, group_end)) {
+        NvU64 next_end = min(group_end + g_uvm_perf_migrate_cpu_preunmap_size, end);
+        NvU64 num_next_unmap_pages;
+
+        if (!preunmap_count_pages(va_range, va_block_context, group_end + 1, next_end, dest_id, &num_next_unmap_pages))
+            break;
+
+        if (!preunmap_is_dense(num_next_unmap_pages, group_end + 1, next_end))
+            break;
+
+        num_unmap_pages += num_next_unmap_pages;
+        group_end = next_end;
     }
 
     if (num_unmap_pages > 0)
-        unmap_mapping_range(&va_range->va_space->mapping, start, end - start + 1, 1);
+        unmap_mapping_range(&va_range->va_space->mapping, start, group_end - start + 1, 1);
+
+    return group_end;
+}
+
+static NV_STATUS va_range_migrate_block(uvm_va_range_t *va_range,
+                                        uvm_va_block_context_t *va_block_context,
+                                        size_t block_index,
+                                        NvU64 start,
+                                        NvU64 end,
+                                        uvm_processor_id_t dest_id,
+                                        uvm_migrate_mode_t mode,
+                                        uvm_tracker_t *out_tracker)
+{
+    uvm_va_block_retry_t va_block_retry;
+    uvm_va_block_region_t region;
+    uvm_va_block_t *va_block;
+    NV_STATUS status = uvm_va_range_block_create(va_range, block_index, &va_block);
+
+    if (status != NV_OK)
+        return status;
+
+    region = uvm_va_block_region_from_start_end(va_block,
+                                                max(start, va_block->start),
+                                                min(end, va_block->end));
+
+    return UVM_VA_BLOCK_LOCK_RETRY(va_block, &va_block_retry,
+                                   uvm_va_block_migrate_locked(va_block,
+                                                               &va_block_retry,
+                                                               va_block_context,
+                                                               region,
+                                                               dest_id,
+                                                               mode,
+                                                               out_tracker));
+}
+
+// Migrate blocks of the current dispatch until there are none left or any of
+// the participants fails.
+static NV_STATUS migrate_workers_migrate_blocks(uvm_va_block_context_t *va_block_context, uvm_tracker_t *out_tracker)
+{
+    NV_STATUS status = NV_OK;
+
+    while (!atomic_read(&g_migrate_workers.abort)) {
+        NvU32 index = (NvU32)atomic_inc_return(&g_migrate_workers.next_block) - 1;
+
+        if (index >= g_migrate_workers.num_blocks)
+            break;
+
+        status = va_range_migrate_block(g_migrate_workers.va_range,
+                                        va_block_context,
+                                        g_migrate_workers.first_block_index + index,
+                                        g_migrate_workers.start,
+                                        g_migrate_workers.end,
+                                        g_migrate_workers.dest_id,
+                                        g_migrate_workers.mode,
+                                        out_tracker);
+        if (status != NV_OK) {
+            atomic_set(&g_migrate_workers.abort, 1);
+            break;
+        }
+    }
+
+    return status;
+}
+
+static void migrate_worker(migrate_worker_t *worker)
+{
+    uvm_va_space_t *va_space = g_migrate_workers.va_range->va_space;
+    struct mm_struct *mm = g_migrate_workers.mm;
+
+    // mmap_lock and the VA space lock are held in read mode by the caller,
+    // which waits for all the workers before releasing them. The ownership is
+    // recorded here so that the lock tracking assertions in the migration code
+    // hold on the worker thread, too.
+    if (mm)
+        uvm_record_lock_mmap_lock_read(mm);
+    uvm_record_lock(&va_space->lock, UVM_LOCK_FLAGS_MODE_SHARED);
+
+    worker->status = migrate_workers_migrate_blocks(worker->va_block_context,
+                                                    g_migrate_workers.use_tracker? &worker->tracker : NULL);
+
+    uvm_record_unlock(&va_space->lock, UVM_LOCK_FLAGS_MODE_SHARED);
+    if (mm)
+        uvm_record_unlock_mmap_lock_read(mm);
+
+    complete(&worker->done);
+}
+
+static void migrate_worker_entry(void *args)
+{
+    UVM_ENTRY_VOID(migrate_worker((migrate_worker_t *)args));
+}
+
+// Migrate the blocks of [start, end] using the migration workers and the
+// calling thread. Returns NV_ERR_BUSY_RETRY without migrating anything if the
+// workers are in use by another migration.
+static NV_STATUS migrate_multi_block_parallel(uvm_va_range_t *va_range,
+                                              uvm_va_block_context_t *va_block_context,
+                                              NvU64 start,
+                                              NvU64 end,
+                                              uvm_processor_id_t dest_id,
+                                              uvm_migrate_mode_t mode,
+                                              uvm_tracker_t *out_tracker)
+{
+    NV_STATUS status;
+    NvU32 i;
+    NvU32 num_workers;
+    const size_t first_block_index = uvm_va_range_block_index(va_range, start);
+    const NvU32 num_blocks = uvm_va_range_block_index(va_range, end) - first_block_index + 1;
+
+    if (atomic_cmpxchg(&g_migrate_workers.busy, 0, 1) != 0)
+        return NV_ERR_BUSY_RETRY;
+
+    g_migrate_workers.va_range          = va_range;
+    g_migrate_workers.mm                = va_block_context->mm;
+    g_migrate_workers.start             = start;
+    g_migrate_workers.end               = end;
+    g_migrate_workers.first_block_index = first_block_index;
+    g_migrate_workers.num_blocks        = num_blocks;
+    g_migrate_workers.dest_id           = dest_id;
+    g_migrate_workers.mode              = mode;
+    g_migrate_workers.use_tracker       = out_tracker != NULL;
+    atomic_set(&g_migrate_workers.next_block, 0);
+    atomic_set(&g_migrate_workers.abort, 0);
+
+    // The calling thread also migrates blocks, so there is no point in waking
+    // up more workers than the remaining blocks
+    num_workers = min(g_migrate_workers.num_workers, num_blocks - 1);
+
+    for (i = 0; i < num_workers; ++i) {
+        migrate_worker_t *worker = &g_migrate_workers.workers[i];
+
+        UVM_ASSERT(uvm_tracker_is_empty(&worker->tracker));
+
+        worker->va_block_context->mm = va_block_context->mm;
+        worker->status = NV_OK;
+        reinit_completion(&worker->done);
+
+        // Scheduling only fails if the queue is shutting down, in which case
+        // the blocks are migrated by the rest of participants
+        if (!nv_kthread_q_schedule_q_item(&worker->q, &worker->q_item)) {
+            num_workers = i;
+            break;
+        }
+    }
+
+    status = migrate_workers_migrate_blocks(va_block_context, out_tracker);
+
+    for (i = 0; i < num_workers; ++i) {
+        migrate_worker_t *worker = &g_migrate_workers.workers[i];
+        NV_STATUS tracker_status = NV_OK;
+
+        wait_for_completion(&worker->done);
+
+        if (status == NV_OK)
+            status = worker->status;
+
+        if (out_tracker)
+            tracker_status = uvm_tracker_add_tracker_safe(out_tracker, &worker->tracker);
+
+        uvm_tracker_clear(&worker->tracker);
+
+        if (status == NV_OK)
+            status = tracker_status;
+    }
+
+    atomic_set(&g_migrate_workers.busy, 0);
+
+    return status;
 }
 
 static NV_STATUS uvm_va_range_migrate_multi_block(uvm_va_range_t *va_range,
@@ -422,32 +716,33 @@ static NV_STATUS uvm_va_range_migrate_multi_block(uvm_va_range_t *va_range,
     UVM_ASSERT(start >= va_range->node.start);
     UVM_ASSERT(end  <= va_range->node.end);
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
-    uvm_assert_rwsem_locked(&va_range->va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_range->va_space->lock);
 
     UVM_ASSERT(uvm_range_group_all_migratable(va_range->va_space, start, end));
 
-    // Iterate over blocks, populating them if necessary
-    for (i = first_block_index; i <= last_block_index; i++) {
-        uvm_va_block_retry_t va_block_retry;
-        uvm_va_block_region_t region;
-        uvm_va_block_t *va_block;
-        NV_STATUS status = uvm_va_range_block_create(va_range, i, &va_block);
-
-        if (status != NV_OK)
+    if (g_migrate_workers.num_workers > 0 &&
+        last_block_index - first_block_index + 1 >= uvm_perf_migrate_workers_min_blocks) {
+        NV_STATUS status = migrate_multi_block_parallel(va_range,
+                                                        va_block_context,
+                                                        start,
+                                                        end,
+                                                        dest_id,
+                                                        mode,
+                                                        out_tracker);
+        if (status != NV_ERR_BUSY_RETRY)
             return status;
+    }
 
-        region = uvm_va_block_region_from_start_end(va_block,
-                                                    max(start, va_block->start),
-                                                    min(end, va_block->end));
-
-        status = UVM_VA_BLOCK_LOCK_RETRY(va_block, &va_block_retry,
-                                         uvm_va_block_migrate_locked(va_block,
-                                                                     &va_block_retry,
-                                                                     va_block_context,
-                                                                     region,
-                                                                     dest_id,
-                                                                     mode,
-                                                                     out_tracker));
+    // Iterate over blocks, populating them if necessary
+    for (i = first_block_index; i <= last_block_index; i++) {
+        NV_STATUS status = va_range_migrate_block(va_range,
+                                                  va_block_context,
+                                                  i,
+                                                  start,
+                                                  end,
+                                                  dest_id,
+                                                  mode,
+                                                  out_tracker);
         if (status != NV_OK)
             return status;
     }
@@ -475,14 +770,11 @@ static NV_STATUS uvm_va_range_migrate(uvm_va_range_t *va_range,
         NvU64 preunmap_range_end;
 
         if (should_do_cpu_preunmap) {
-            preunmap_range_end = UVM_ALIGN_UP(preunmap_range_start + 1, g_uvm_perf_migrate_cpu_preunmap_size);
-            preunmap_range_end = min(preunmap_range_end - 1, end);
-
-            preunmap_multi_block(va_range,
-                                 va_block_context,
-                                 preunmap_range_start,
-                                 preunmap_range_end,
-                                 dest_id);
+            preunmap_range_end = preunmap_multi_block(va_range,
+                                                      va_block_context,
+                                                      preunmap_range_start,
+                                                      end,
+                                                      dest_id);
         }
         else {
             preunmap_range_end = end;
@@ -598,7 +890,7 @@ static NV_STATUS uvm_migrate(uvm_va_space_t *va_space,
     bool is_single_block;
     bool should_do_cpu_preunmap;
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!first_va_range || first_va_range->type != UVM_VA_RANGE_TYPE_MANAGED)
         return NV_ERR_INVALID_ADDRESS;
@@ -793,12 +1085,84 @@ static NV_STATUS uvm_migrate_release_user_sem(const UVM_MIGRATE_PARAMS *params,
     return NV_OK;
 }
 
+static void migrate_workers_deinit(void)
+{
+    NvU32 i;
+
+    for (i = 0; i < g_migrate_workers.num_workers; ++i) {
+        migrate_worker_t *worker = &g_migrate_workers.workers[i];
+
+        nv_kthread_q_stop(&worker->q);
+        uvm_tracker_deinit(&worker->tracker);
+        uvm_va_block_context_free(worker->va_block_context);
+    }
+
+    uvm_kvfree(g_migrate_workers.workers);
+    g_migrate_workers.workers = NULL;
+    g_migrate_workers.num_workers = 0;
+}
+
+static NV_STATUS migrate_workers_init(void)
+{
+    NvU32 i;
+    NvU32 num_workers = min(uvm_perf_migrate_workers, (unsigned)UVM_PERF_MIGRATE_WORKERS_MAX);
+
+    if (num_workers != uvm_perf_migrate_workers) {
+        pr_info("Invalid value %u for uvm_perf_migrate_workers. Using %u instead\n",
+                uvm_perf_migrate_workers,
+                num_workers);
+    }
+
+    if (num_workers == 0)
+        return NV_OK;
+
+    g_migrate_workers.workers = uvm_kvmalloc_zero(num_workers * sizeof(*g_migrate_workers.workers));
+    if (!g_migrate_workers.workers)
+        return NV_ERR_NO_MEMORY;
+
+    for (i = 0; i < num_workers; ++i) {
+        NV_STATUS status;
+        char kthread_name[TASK_COMM_LEN + 1];
+        migrate_worker_t *worker = &g_migrate_workers.workers[i];
+
+        worker->va_block_context = uvm_va_block_context_alloc(NULL);
+        if (!worker->va_block_context) {
+            migrate_workers_deinit();
+            return NV_ERR_NO_MEMORY;
+        }
+
+        uvm_tracker_init(&worker->tracker);
+        init_completion(&worker->done);
+        nv_kthread_q_item_init(&worker->q_item, migrate_worker_entry, worker);
+
+        // Account for the worker before starting its queue, so that it is
+        // cleaned up on failure
+        g_migrate_workers.num_workers = i + 1;
+
+        snprintf(kthread_name, sizeof(kthread_name), "UVM migrate %u", i);
+        status = errno_to_nv_status(nv_kthread_q_init(&worker->q, kthread_name));
+        if (status != NV_OK) {
+            UVM_ERR_PRINT("Failed in nv_kthread_q_init for migration worker %u: %s\n", i, nvstatusToString(status));
+            migrate_workers_deinit();
+            return status;
+        }
+    }
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_migrate_init()
 {
     NV_STATUS status = uvm_migrate_pageable_init();
     if (status != NV_OK)
         return status;
 
+    status = migrate_workers_init();
+    if (status != NV_OK) {
+        uvm_migrate_pageable_exit();
+        return status;
+    }
+
     g_uvm_perf_migrate_cpu_preunmap_enable = uvm_perf_migrate_cpu_preunmap_enable != 0;
 
     BUILD_BUG_ON((UVM_VA_BLOCK_SIZE) & (UVM_VA_BLOCK_SIZE - 1));
@@ -821,6 +1185,7 @@ NV_STATUS uvm_migrate_init()
 
 void uvm_migrate_exit()
 {
+    migrate_workers_deinit();
     uvm_migrate_pageable_exit();
 }
 
@@ -981,6 +1346,90 @@ done:
     return status == NV_OK ? tracker_status : status;
 }
 
+static int cmp_range_group_range_start(const void *_a, const void *_b)
+{
+    const uvm_range_group_range_t *a = *(const uvm_range_group_range_t **)_a;
+    const uvm_range_group_range_t *b = *(const uvm_range_group_range_t **)_b;
+
+    return UVM_CMP_DEFAULT(a->node.start, b->node.start);
+}
+
+// Migrate the [start, end] span, which is covered by ranges of the range group
+static NV_STATUS migrate_range_group_span(uvm_va_space_t *va_space,
+                                          struct mm_struct *mm,
+                                          NvU64 start,
+                                          NvU64 end,
+                                          uvm_processor_id_t dest_id,
+                                          uvm_gpu_t *gpu,
+                                          uvm_tracker_t *out_tracker)
+{
+    if (gpu && !uvm_gpu_can_address(gpu, end))
+        return NV_ERR_OUT_OF_RANGE;
+
+    return uvm_migrate(va_space, mm, start, end - start + 1, dest_id, 0, out_tracker);
+}
+
+// Range groups are often made of many small ranges, some of them adjacent. The
+// ranges are sorted by address and the adjacent ones are migrated with a single
+// uvm_migrate call, so that the per-call setup, the two-pass logic and the CPU
+// pre-unmapping apply to the whole span instead of to each range. Returns
+// NV_WARN_NOTHING_TO_DO without migrating anything if the sorted array cannot
+// be allocated.
+static NV_STATUS migrate_range_group_sorted(uvm_va_space_t *va_space,
+                                            struct mm_struct *mm,
+                                            uvm_range_group_t *range_group,
+                                            uvm_processor_id_t dest_id,
+                                            uvm_gpu_t *gpu,
+                                            uvm_tracker_t *out_tracker)
+{
+    NV_STATUS status = NV_OK;
+    uvm_range_group_range_t **rgrs;
+    uvm_range_group_range_t *rgr;
+    size_t num_rgrs = 0;
+    size_t i;
+    NvU64 span_start;
+    NvU64 span_end;
+
+    list_for_each_entry(rgr, &range_group->ranges, range_group_list_node)
+        ++num_rgrs;
+
+    if (num_rgrs == 0)
+        return NV_OK;
+
+    rgrs = uvm_kvmalloc(num_rgrs * sizeof(*rgrs));
+    if (!rgrs)
+        return NV_WARN_NOTHING_TO_DO;
+
+    i = 0;
+    list_for_each_entry(rgr, &range_group->ranges, range_group_list_node)
+        rgrs[i++] = rgr;
+
+    sort(rgrs, num_rgrs, sizeof(*rgrs), cmp_range_group_range_start, NULL);
+
+    span_start = rgrs[0]->node.start;
+    span_end = rgrs[0]->node.end;
+    for (i = 1; i < num_rgrs; ++i) {
+        if (rgrs[i]->node.start == span_end + 1) {
+            span_end = rgrs[i]->node.end;
+            continue;
+        }
+
+        status = migrate_range_group_span(va_space, mm, span_start, span_end, dest_id, gpu, out_tracker);
+        if (status != NV_OK)
+            break;
+
+        span_start = rgrs[i]->node.start;
+        span_end = rgrs[i]->node.end;
+    }
+
+    if (status == NV_OK)
+        status = migrate_range_group_span(va_space, mm, span_start, span_end, dest_id, gpu, out_tracker);
+
+    uvm_kvfree(rgrs);
+
+    return status;
+}
+
 NV_STATUS uvm_api_migrate_range_group(UVM_MIGRATE_RANGE_GROUP_PARAMS *params, struct file *filp)
 {
     NV_STATUS status = NV_OK;
@@ -1019,6 +1468,12 @@ NV_STATUS uvm_api_migrate_range_group(UVM_MIGRATE_RANGE_GROUP_PARAMS *params, st
 
     // Migrate all VA ranges in the range group. uvm_migrate is used because it performs all
     // VA range validity checks.
+    status = migrate_range_group_sorted(va_space, mm, range_group, dest_id, gpu, &local_tracker);
+    if (status != NV_WARN_NOTHING_TO_DO)
+        goto done;
+
+    // Fall back to migrating the ranges one by one
+    status = NV_OK;
     list_for_each_entry(rgr, &range_group->ranges, range_group_list_node) {
         NvU64 start = rgr->node.start;
         NvU64 end = rgr->node.end;
@@ -40,10 +40,20 @@ static struct kmem_cache *g_uvm_migrate_vma_state_cache __read_mostly;
 
 static const gfp_t g_migrate_vma_gfp_flags = NV_UVM_GFP_FLAGS | GFP_HIGHUSER_MOVABLE | __GFP_THISNODE;
 
-// Compute the address needed for copying_gpu to access the given page,
-// resident on resident_id.
+// Physically contiguous runs of pages, typically coming from split THPs, are
+// copied with a single CE operation into a single high-order allocation of up
+// to this many pages. Higher orders are only opportunistic, so they don't
+// retry nor warn on failure.
+#define MIGRATE_VMA_MAX_RUN_PAGES (UVM_VA_BLOCK_SIZE / PAGE_SIZE)
+
+static const gfp_t g_migrate_vma_run_gfp_flags = __GFP_NORETRY | __GFP_NOWARN;
+
+// Compute the address needed for copying_gpu to access the num_pages
+// physically contiguous pages starting at the given page, resident on
+// resident_id.
 static NV_STATUS migrate_vma_page_copy_address(struct page *page,
                                                unsigned long page_index,
+                                               unsigned long num_pages,
                                                uvm_processor_id_t resident_id,
                                                uvm_gpu_t *copying_gpu,
                                                migrate_vma_state_t *state,
@@ -58,7 +68,7 @@ static NV_STATUS migrate_vma_page_copy_address(struct page *page,
                              can_copy_from &&
                              !uvm_gpu_peer_caps(owning_gpu, copying_gpu)->is_indirect_peer;
 
-    UVM_ASSERT(page_index < state->num_pages);
+    UVM_ASSERT(page_index + num_pages <= state->num_pages);
 
     memset(gpu_addr, 0, sizeof(*gpu_addr));
 
@@ -75,19 +85,28 @@ static NV_STATUS migrate_vma_page_copy_address(struct page *page,
     }
     else {
         // Sysmem/Indirect Peer
-        NV_STATUS status = uvm_gpu_map_cpu_page(copying_gpu, page, &state->dma.addrs[page_index]);
+        NV_STATUS status = uvm_gpu_map_cpu_pages(copying_gpu,
+                                                 page,
+                                                 num_pages * PAGE_SIZE,
+                                                 &state->dma.addrs[page_index]);
 
         if (status != NV_OK)
             return status;
 
         state->dma.addrs_gpus[page_index] = copying_gpu;
 
-        if (state->dma.num_pages++ == 0)
+        if (state->dma.num_pages == 0) {
             bitmap_zero(state->dma.page_mask, state->num_pages);
+            bitmap_zero(state->dma.run_mask, state->num_pages);
+        }
+
+        state->dma.num_pages += num_pages;
 
         UVM_ASSERT(!test_bit(page_index, state->dma.page_mask));
 
         __set_bit(page_index, state->dma.page_mask);
+        if (num_pages > 1)
+            bitmap_set(state->dma.run_mask, page_index + 1, num_pages - 1);
 
         *gpu_addr = uvm_gpu_address_physical(UVM_APERTURE_SYS, state->dma.addrs[page_index]);
     }
@@ -308,17 +327,66 @@ static void migrate_vma_compute_masks(struct vm_area_struct *vma,
     }
 }
 
-static struct page *migrate_vma_alloc_page(migrate_vma_state_t *state)
+// Return the number of consecutive pages starting at page_index which are set
+// in page_mask, and, if src is not NULL, whose source pages are physically
+// contiguous.
+static unsigned long migrate_vma_run_length(const unsigned long *src,
+                                            const unsigned long *page_mask,
+                                            unsigned long page_index,
+                                            migrate_vma_state_t *state)
+{
+    unsigned long max_pages = min(state->num_pages - page_index, (unsigned long)MIGRATE_VMA_MAX_RUN_PAGES);
+    unsigned long num_pages = find_next_zero_bit(page_mask, page_index + max_pages, page_index) - page_index;
+    unsigned long i;
+
+    if (!src)
+        return num_pages;
+
+    for (i = 1; i < num_pages; ++i) {
+        if (page_to_pfn(migrate_pfn_to_page(src[page_index + i])) !=
+            page_to_pfn(migrate_pfn_to_page(src[page_index])) + i)
+            break;
+    }
+
+    return i;
+}
+
+static void migrate_vma_free_pages(struct page *page, unsigned long num_pages)
+{
+    unsigned long i;
+
+    for (i = 0; i < num_pages; ++i)
+        __free_page(page + i);
+}
+
+// Allocate up to *num_pages physically contiguous pages on the destination
+// node. A single high-order allocation is split into base pages, as required
+// by migrate_vma. On return, *num_pages contains the number of pages actually
+// allocated, which is a power of 2.
+static struct page *migrate_vma_alloc_page(migrate_vma_state_t *state, unsigned long *num_pages)
 {
     struct page *dst_page;
     uvm_migrate_args_t *uvm_migrate_args = state->uvm_migrate_args;
     uvm_va_space_t *va_space = uvm_migrate_args->va_space;
+    unsigned order = ilog2(*num_pages);
 
     if (uvm_enable_builtin_tests && atomic_dec_if_positive(&va_space->test.migrate_vma_allocation_fail_nth) == 0) {
         dst_page = NULL;
     }
     else {
-        dst_page = alloc_pages_node(uvm_migrate_args->dst_node_id, g_migrate_vma_gfp_flags, 0);
+        dst_page = NULL;
+        if (order > 0) {
+            dst_page = alloc_pages_node(uvm_migrate_args->dst_node_id,
+                                        g_migrate_vma_gfp_flags | g_migrate_vma_run_gfp_flags,
+                                        order);
+            if (dst_page)
+                split_page(dst_page, order);
+        }
+
+        if (!dst_page) {
+            order = 0;
+            dst_page = alloc_pages_node(uvm_migrate_args->dst_node_id, g_migrate_vma_gfp_flags, 0);
+        }
 
         // TODO: Bug 2399573: Linux commit
         // 183f6371aac2a5496a8ef2b0b0a68562652c3cdb introduced a bug that makes
@@ -328,11 +396,13 @@ static struct page *migrate_vma_alloc_page(migrate_vma_state_t *state)
         // otherwise. Remove this check when the fix is deployed on all
         // production systems.
         if (dst_page && page_to_nid(dst_page) != uvm_migrate_args->dst_node_id) {
-            __free_page(dst_page);
+            migrate_vma_free_pages(dst_page, 1UL << order);
             dst_page = NULL;
         }
     }
 
+    *num_pages = dst_page ? 1UL << order : 0;
+
     return dst_page;
 }
 
@@ -350,6 +420,7 @@ static NV_STATUS migrate_vma_populate_anon_pages(struct vm_area_struct *vma,
     uvm_va_space_t *va_space = uvm_migrate_args->va_space;
     uvm_push_t push;
     unsigned long i;
+    unsigned long num_pages = 0;
 
     // Nothing to do
     if (state->num_populate_anon_pages == 0)
@@ -357,19 +428,25 @@ static NV_STATUS migrate_vma_populate_anon_pages(struct vm_area_struct *vma,
 
     UVM_ASSERT(state->num_populate_anon_pages == bitmap_weight(page_mask, state->num_pages));
 
-    for_each_set_bit(i, page_mask, state->num_pages) {
+    for (i = find_first_bit(page_mask, state->num_pages);
+         i < state->num_pages;
+         i = find_next_bit(page_mask, state->num_pages, i + num_pages)) {
         uvm_gpu_address_t dst_address;
         struct page *dst_page;
+        unsigned long j;
 
-        __clear_bit(i, state->pending_page_mask);
-
-        dst_page = migrate_vma_alloc_page(state);
+        num_pages = migrate_vma_run_length(NULL, page_mask, i, state);
+        dst_page = migrate_vma_alloc_page(state, &num_pages);
         if (!dst_page) {
+            __clear_bit(i, state->pending_page_mask);
             __set_bit(i, state->allocation_failed_mask);
             state->allocation_failed = true;
+            num_pages = 1;
             continue;
         }
 
+        bitmap_clear(state->pending_page_mask, i, num_pages);
+
         if (!copying_gpu) {
             // Try to get a GPU attached to the node being populated. If there
             // is none, use any of the GPUs registered in the VA space.
@@ -386,7 +463,7 @@ static NV_STATUS migrate_vma_populate_anon_pages(struct vm_area_struct *vma,
 
             status = migrate_vma_zero_begin_push(va_space, dst_id, copying_gpu, start, outer - 1, &push);
             if (status != NV_OK) {
-                __free_page(dst_page);
+                migrate_vma_free_pages(dst_page, num_pages);
                 return status;
             }
         }
@@ -394,19 +471,20 @@ static NV_STATUS migrate_vma_populate_anon_pages(struct vm_area_struct *vma,
             uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
         }
 
-        status = migrate_vma_page_copy_address(dst_page, i, dst_id, copying_gpu, state, &dst_address);
+        status = migrate_vma_page_copy_address(dst_page, i, num_pages, dst_id, copying_gpu, state, &dst_address);
         if (status != NV_OK) {
-            __free_page(dst_page);
+            migrate_vma_free_pages(dst_page, num_pages);
             break;
         }
 
-        lock_page(dst_page);
-
         // We'll push one membar later for all memsets in this loop
         uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-        copying_gpu->parent->ce_hal->memset_8(&push, dst_address, 0, PAGE_SIZE);
+        copying_gpu->parent->ce_hal->memset_8(&push, dst_address, 0, num_pages * PAGE_SIZE);
 
-        dst[i] = migrate_pfn(page_to_pfn(dst_page)) | MIGRATE_PFN_LOCKED;
+        for (j = 0; j < num_pages; ++j) {
+            lock_page(dst_page + j);
+            dst[i + j] = migrate_pfn(page_to_pfn(dst_page + j)) | MIGRATE_PFN_LOCKED;
+        }
     }
 
     if (copying_gpu) {
@@ -433,6 +511,7 @@ static NV_STATUS migrate_vma_copy_pages_from(struct vm_area_struct *vma,
     NV_STATUS status = NV_OK;
     uvm_push_t push;
     unsigned long i;
+    unsigned long num_pages = 0;
     uvm_gpu_t *copying_gpu = NULL;
     uvm_migrate_args_t *uvm_migrate_args = state->uvm_migrate_args;
     uvm_processor_id_t dst_id = uvm_migrate_args->dst_id;
@@ -441,29 +520,37 @@ static NV_STATUS migrate_vma_copy_pages_from(struct vm_area_struct *vma,
 
     UVM_ASSERT(!bitmap_empty(page_mask, state->num_pages));
 
-    for_each_set_bit(i, page_mask, state->num_pages) {
+    for (i = find_first_bit(page_mask, state->num_pages);
+         i < state->num_pages;
+         i = find_next_bit(page_mask, state->num_pages, i + num_pages)) {
         uvm_gpu_address_t src_address;
         uvm_gpu_address_t dst_address;
         struct page *src_page = migrate_pfn_to_page(src[i]);
         struct page *dst_page;
+        unsigned long j;
 
         UVM_ASSERT(src[i] & MIGRATE_PFN_VALID);
         UVM_ASSERT(src_page);
         UVM_ASSERT(test_bit(i, state->pending_page_mask));
 
-        __clear_bit(i, state->pending_page_mask);
-
-        dst_page = migrate_vma_alloc_page(state);
+        // Copy physically contiguous source pages, like those of a split THP,
+        // at once
+        num_pages = migrate_vma_run_length(src, page_mask, i, state);
+        dst_page = migrate_vma_alloc_page(state, &num_pages);
         if (!dst_page) {
+            __clear_bit(i, state->pending_page_mask);
             __set_bit(i, state->allocation_failed_mask);
             state->allocation_failed = true;
+            num_pages = 1;
             continue;
         }
 
+        bitmap_clear(state->pending_page_mask, i, num_pages);
+
         if (!copying_gpu) {
             status = migrate_vma_copy_begin_push(va_space, dst_id, src_id, start, outer - 1, &push);
             if (status != NV_OK) {
-                __free_page(dst_page);
+                migrate_vma_free_pages(dst_page, num_pages);
                 return status;
             }
 
@@ -475,22 +562,23 @@ static NV_STATUS migrate_vma_copy_pages_from(struct vm_area_struct *vma,
 
         // We don't have a case where both src and dst use the SYS aperture, so
         // the second call can't overwrite a dma addr set up by the first call.
-        status = migrate_vma_page_copy_address(src_page, i, src_id, copying_gpu, state, &src_address);
+        status = migrate_vma_page_copy_address(src_page, i, num_pages, src_id, copying_gpu, state, &src_address);
         if (status == NV_OK)
-            status = migrate_vma_page_copy_address(dst_page, i, dst_id, copying_gpu, state, &dst_address);
+            status = migrate_vma_page_copy_address(dst_page, i, num_pages, dst_id, copying_gpu, state, &dst_address);
 
         if (status != NV_OK) {
-            __free_page(dst_page);
+            migrate_vma_free_pages(dst_page, num_pages);
             break;
         }
 
-        lock_page(dst_page);
-
         // We'll push one membar later for all copies in this loop
         uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-        copying_gpu->parent->ce_hal->memcopy(&push, dst_address, src_address, PAGE_SIZE);
+        copying_gpu->parent->ce_hal->memcopy(&push, dst_address, src_address, num_pages * PAGE_SIZE);
 
-        dst[i] = migrate_pfn(page_to_pfn(dst_page)) | MIGRATE_PFN_LOCKED;
+        for (j = 0; j < num_pages; ++j) {
+            lock_page(dst_page + j);
+            dst[i + j] = migrate_pfn(page_to_pfn(dst_page + j)) | MIGRATE_PFN_LOCKED;
+        }
     }
 
     // TODO: Bug 1766424: If the destination is a GPU and the copy was done by
@@ -587,8 +675,11 @@ void uvm_migrate_vma_finalize_and_map(struct migrate_vma *args, migrate_vma_stat
     if (state->dma.num_pages > 0) {
         unsigned long i;
 
-        for_each_set_bit(i, state->dma.page_mask, state->num_pages)
-            uvm_gpu_unmap_cpu_page(state->dma.addrs_gpus[i], state->dma.addrs[i]);
+        for_each_set_bit(i, state->dma.page_mask, state->num_pages) {
+            unsigned long num_pages = find_next_zero_bit(state->dma.run_mask, state->num_pages, i + 1) - i;
+
+            uvm_gpu_unmap_cpu_pages(state->dma.addrs_gpus[i], state->dma.addrs[i], num_pages * PAGE_SIZE);
+        }
     }
 
     if (state->unpopulated_pages)
@@ -746,7 +837,7 @@ static NV_STATUS migrate_pageable_vma_region(struct vm_area_struct *vma,
     UVM_ASSERT(outer <= vma->vm_end);
     UVM_ASSERT(outer - start <= UVM_MIGRATE_VMA_MAX_SIZE);
     uvm_assert_mmap_lock_locked(mm);
-    uvm_assert_rwsem_locked(&uvm_migrate_args->va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&uvm_migrate_args->va_space->lock);
 
     status = nv_migrate_vma(&args, migrate_vma_state);
     if (status != NV_OK)
@@ -812,7 +903,7 @@ static NV_STATUS migrate_pageable_vma(struct vm_area_struct *vma,
     UVM_ASSERT(vma->vm_end > start);
     UVM_ASSERT(vma->vm_start < outer);
     uvm_assert_mmap_lock_locked(mm);
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     // Adjust to input range boundaries
     start = max(start, vma->vm_start);
@@ -117,6 +117,10 @@ typedef struct
         // Mask of pages with entries in the dma address arrays above
         DECLARE_BITMAP(page_mask, UVM_MIGRATE_VMA_MAX_PAGES);
 
+        // Mask of pages covered by the IOMMU mapping of a previous page in
+        // page_mask. Physically contiguous runs of pages are mapped at once.
+        DECLARE_BITMAP(run_mask, UVM_MIGRATE_VMA_MAX_PAGES);
+
         // Number of pages for which IOMMU mapping were created
         unsigned  long num_pages;
     } dma;
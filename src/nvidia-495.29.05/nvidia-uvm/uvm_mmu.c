@@ -168,6 +168,14 @@ static void phys_mem_deallocate_vidmem(uvm_page_tree_t *tree, uvm_mmu_page_table
     uvm_pmm_gpu_free(&tree->gpu->pmm, ptr->handle.chunk, &tree->tracker);
 }
 
+static void phys_mem_free_sysmem(uvm_page_tree_t *tree, uvm_mmu_page_table_alloc_t *ptr)
+{
+    UVM_ASSERT(ptr->addr.aperture == UVM_APERTURE_SYS);
+    if (tree->gpu->parent->pci_dev)
+        uvm_gpu_unmap_cpu_pages(tree->gpu, ptr->addr.address, UVM_PAGE_ALIGN_UP(ptr->size));
+    __free_pages(ptr->handle.page, get_order(ptr->size));
+}
+
 static void phys_mem_deallocate_sysmem(uvm_page_tree_t *tree, uvm_mmu_page_table_alloc_t *ptr)
 {
     NV_STATUS status;
@@ -180,10 +188,7 @@ static void phys_mem_deallocate_sysmem(uvm_page_tree_t *tree, uvm_mmu_page_table
     if (status != NV_OK)
         UVM_ASSERT(status == uvm_global_get_status());
 
-    UVM_ASSERT(ptr->addr.aperture == UVM_APERTURE_SYS);
-    if (tree->gpu->parent->pci_dev)
-        uvm_gpu_unmap_cpu_pages(tree->gpu, ptr->addr.address, UVM_PAGE_ALIGN_UP(ptr->size));
-    __free_pages(ptr->handle.page, get_order(ptr->size));
+    phys_mem_free_sysmem(tree, ptr);
 }
 
 static void phys_mem_deallocate(uvm_page_tree_t *tree, uvm_mmu_page_table_alloc_t *ptr)
@@ -196,6 +201,33 @@ static void phys_mem_deallocate(uvm_page_tree_t *tree, uvm_mmu_page_table_alloc_
     memset(ptr, 0, sizeof(*ptr));
 }
 
+// Release the directories on the deferred free list whose PDE clear has
+// completed. With wait set, all of them are released after waiting for their
+// PDE clears.
+static void deferred_free_reclaim(uvm_page_tree_t *tree, bool wait)
+{
+    uvm_page_directory_t *dir, *next;
+
+    uvm_assert_mutex_locked(&tree->lock);
+
+    list_for_each_entry_safe(dir, next, &tree->deferred_free, deferred_free_node) {
+        if (wait) {
+            NV_STATUS status = uvm_tracker_wait_for_entry(&dir->deferred_free_entry);
+            if (status != NV_OK)
+                UVM_ASSERT(status == uvm_global_get_status());
+        }
+        else if (!uvm_tracker_is_entry_completed(&dir->deferred_free_entry)) {
+            // The directories are queued in push order, so the rest are most
+            // likely still pending as well
+            break;
+        }
+
+        list_del(&dir->deferred_free_node);
+        phys_mem_free_sysmem(tree, &dir->phys_alloc);
+        uvm_kvfree(dir);
+    }
+}
+
 static void page_table_range_init(uvm_page_table_range_t *range,
                                  NvU32 page_size,
                                  uvm_page_directory_t *dir,
@@ -714,6 +746,10 @@ NV_STATUS uvm_page_tree_init(uvm_gpu_t *gpu,
     tree->location = location;
 
     uvm_tracker_init(&tree->tracker);
+    INIT_LIST_HEAD(&tree->deferred_free);
+
+    uvm_spin_lock_init(&tree->deferred_tlb.lock, UVM_LOCK_ORDER_LEAF);
+    uvm_tlb_batch_begin(tree, &tree->deferred_tlb.batch);
 
     tree->root = allocate_directory(tree, UVM_PAGE_SIZE_AGNOSTIC, 0, UVM_PMM_ALLOC_FLAGS_EVICT);
 
@@ -737,6 +773,7 @@ NV_STATUS uvm_page_tree_init(uvm_gpu_t *gpu,
 void uvm_page_tree_deinit(uvm_page_tree_t *tree)
 {
     UVM_ASSERT(tree->root->ref_count == 0);
+    UVM_ASSERT(tree->deferred_tlb.batch.count == 0);
 
     // Take the tree lock only to avoid assertions. It is not required for
     // thread safety during deinit.
@@ -768,6 +805,9 @@ void uvm_page_tree_deinit(uvm_page_tree_t *tree)
     }
 
     (void)uvm_tracker_wait(&tree->tracker);
+    deferred_free_reclaim(tree, true);
+    UVM_ASSERT(list_empty(&tree->deferred_free));
+
     phys_mem_deallocate(tree, &tree->root->phys_alloc);
 
     if (tree->gpu->parent->map_remap_larger_page_promotion)
@@ -798,6 +838,8 @@ void uvm_page_tree_put_ptes_async(uvm_page_tree_t *tree, uvm_page_table_range_t
 
     uvm_mutex_lock(&tree->lock);
 
+    deferred_free_reclaim(tree, false);
+
     // release the range
     UVM_ASSERT(dir->ref_count >= range->entry_count);
     dir->ref_count -= range->entry_count;
@@ -871,10 +913,20 @@ void uvm_page_tree_put_ptes_async(uvm_page_tree_t *tree, uvm_page_table_range_t
     page_tree_end(tree, &push);
     page_tree_tracker_overwrite_with_push(tree, &push);
 
-    // now that we've traversed all the way up the tree, free everything
+    // now that we've traversed all the way up the tree, free everything.
+    // Sysmem directories are only queued for freeing, so that the free doesn't
+    // have to wait for the push above.
     for (i = 0; i < free_count; i++) {
-        phys_mem_deallocate(tree, &free_queue[i]->phys_alloc);
-        uvm_kvfree(free_queue[i]);
+        dir = free_queue[i];
+
+        if (dir->phys_alloc.addr.aperture == UVM_APERTURE_SYS && tree->gpu->channel_manager != NULL) {
+            uvm_push_get_tracker_entry(&push, &dir->deferred_free_entry);
+            list_add_tail(&dir->deferred_free_node, &tree->deferred_free);
+        }
+        else {
+            phys_mem_deallocate(tree, &dir->phys_alloc);
+            uvm_kvfree(dir);
+        }
     }
 
     uvm_mutex_unlock(&tree->lock);
@@ -894,6 +946,9 @@ NV_STATUS uvm_page_tree_wait(uvm_page_tree_t *tree)
 
     status = uvm_tracker_wait(&tree->tracker);
 
+    // Everything queued before the wait has completed
+    deferred_free_reclaim(tree, false);
+
     uvm_mutex_unlock(&tree->lock);
 
     return status;
@@ -1560,12 +1615,23 @@ NV_STATUS uvm_page_table_range_vec_write_ptes(uvm_page_table_range_vec_t *range_
     NvU64 offset = 0;
     uvm_tracker_t tracker = UVM_TRACKER_INIT();
     bool last_push = false;
+    NvU64 *pte_bits_staging = NULL;
+    NvU32 max_staged_entries = UVM_PUSH_INLINE_DATA_MAX_SIZE / sizeof(*pte_bits_staging);
 
     // Use as much push space as possible leaving 1K of margin
     static const NvU32 max_total_entry_size_per_push = UVM_MAX_PUSH_SIZE - 1024;
 
     NvU32 max_entries_per_push = max_total_entry_size_per_push / entry_size;
 
+    // When each PTE fits in a single NvU64, stage the PTE bits on the CPU and
+    // hand them over to the PTE batch in bulk. That lets the batch emit one
+    // inline copy (or memset) per run of entries instead of going through
+    // uvm_pte_batch_write_pte() one entry at a time, which dominates the cost
+    // of writing large ranges like the peer identity mappings. Fall back to
+    // the per-PTE path if the staging buffer cannot be allocated.
+    if (entry_size == sizeof(*pte_bits_staging) && range_vec->size / range_vec->page_size > UVM_PTE_BATCH_MAX_PTES)
+        pte_bits_staging = uvm_kvmalloc(max_staged_entries * sizeof(*pte_bits_staging));
+
     for (i = 0; i < range_vec->range_count; ++i) {
         uvm_page_table_range_t *range = &range_vec->ranges[i];
         NvU64 range_start = range_vec_calc_range_start(range_vec, i);
@@ -1593,11 +1659,28 @@ NV_STATUS uvm_page_table_range_vec_write_ptes(uvm_page_table_range_vec_t *range_
 
             uvm_pte_batch_begin(&push, &pte_batch);
 
-            for (; entry < entry_limit_this_push; ++entry) {
-                NvU64 pte_bits = pte_maker(range_vec, offset, caller_data);
-                uvm_pte_batch_write_pte(&pte_batch, entry_addr, pte_bits, entry_size);
-                offset += range_vec->page_size;
-                entry_addr.address += entry_size;
+            if (pte_bits_staging) {
+                while (entry < entry_limit_this_push) {
+                    NvU32 entries_staged = min(entry_limit_this_push - entry, max_staged_entries);
+                    NvU32 j;
+
+                    for (j = 0; j < entries_staged; ++j) {
+                        pte_bits_staging[j] = pte_maker(range_vec, offset, caller_data);
+                        offset += range_vec->page_size;
+                    }
+
+                    uvm_pte_batch_write_ptes(&pte_batch, entry_addr, pte_bits_staging, entry_size, entries_staged);
+                    entry += entries_staged;
+                    entry_addr.address += entries_staged * entry_size;
+                }
+            }
+            else {
+                for (; entry < entry_limit_this_push; ++entry) {
+                    NvU64 pte_bits = pte_maker(range_vec, offset, caller_data);
+                    uvm_pte_batch_write_pte(&pte_batch, entry_addr, pte_bits, entry_size);
+                    offset += range_vec->page_size;
+                    entry_addr.address += entry_size;
+                }
             }
 
             last_push = (i == range_vec->range_count - 1) && entry == range->entry_count;
@@ -1633,6 +1716,9 @@ done:
     tracker_status = uvm_tracker_wait_deinit(&tracker);
     if (status == NV_OK)
         status = tracker_status;
+
+    uvm_kvfree(pte_bits_staging);
+
     return status;
 }
 
@@ -1700,7 +1786,7 @@ NV_STATUS uvm_mmu_create_peer_identity_mappings(uvm_gpu_t *gpu, uvm_gpu_t *peer)
     NvU64 phys_offset;
     uvm_gpu_identity_mapping_t *peer_mapping;
 
-    if (gpu->parent->peer_copy_mode != UVM_GPU_PEER_COPY_MODE_VIRTUAL || peer->mem_info.size == 0)
+    if (!uvm_parent_gpu_needs_peer_identity_mappings(gpu->parent) || peer->mem_info.size == 0)
         return NV_OK;
 
     page_size = uvm_mmu_biggest_page_size(&gpu->address_space_tree);
@@ -1731,7 +1817,7 @@ NV_STATUS uvm_mmu_create_peer_identity_mappings(uvm_gpu_t *gpu, uvm_gpu_t *peer)
 
 void uvm_mmu_destroy_peer_identity_mappings(uvm_gpu_t *gpu, uvm_gpu_t *peer)
 {
-    if (gpu->parent->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_VIRTUAL) {
+    if (uvm_parent_gpu_needs_peer_identity_mappings(gpu->parent)) {
         uvm_gpu_identity_mapping_t *mapping = uvm_gpu_get_peer_mapping(gpu, peer->id);
 
         if (mapping->range_vec)
@@ -1765,7 +1851,7 @@ void uvm_mmu_init_gpu_chunk_sizes(uvm_parent_gpu_t *parent_gpu)
 
 void uvm_mmu_init_gpu_peer_addresses(uvm_gpu_t *gpu)
 {
-    if (gpu->parent->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_VIRTUAL) {
+    if (uvm_parent_gpu_needs_peer_identity_mappings(gpu->parent)) {
         uvm_gpu_id_t gpu_id;
 
         for_each_gpu_id(gpu_id) {
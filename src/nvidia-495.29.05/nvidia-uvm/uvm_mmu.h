@@ -30,6 +30,7 @@
 #include "uvm_types.h"
 #include "uvm_common.h"
 #include "uvm_tracker.h"
+#include "uvm_tlb_batch.h"
 #include "uvm_test_ioctl.h"
 
 // Used when the page size isn't known and should not matter.
@@ -144,6 +145,12 @@ struct uvm_page_directory_struct
     // depth from the root
     NvU32 depth;
 
+    // Node in uvm_page_tree_t::deferred_free, and the tracker entry of the
+    // push that cleared the PDE pointing to the directory. Only used after the
+    // directory is freed by uvm_page_tree_put_ptes_async().
+    struct list_head deferred_free_node;
+    uvm_tracker_entry_t deferred_free_entry;
+
     // pointers to child directories on the host.
     // this array is variable length, so it needs to be last to allow it to
     // take up extra space
@@ -274,6 +281,26 @@ struct uvm_page_tree_struct
 
     // Tracker for all GPU operations on the tree
     uvm_tracker_t tracker;
+
+    // Sysmem directories freed by uvm_page_tree_put_ptes_async(), in the
+    // order they were freed. Their memory is released once the push that
+    // cleared their PDE completes, instead of waiting for the tree's tracker
+    // on every free. Vidmem directories are freed right away, as PMM holds on
+    // to the tracker of freed chunks. Protected by lock.
+    struct list_head deferred_free;
+
+    // TLB invalidates of permission upgrades deferred by replayable fault
+    // servicing, merged across VA blocks and pushes. They are flushed before
+    // the faults are replayed and before the VA space lock is dropped. See
+    // uvm_tlb_batch_defer.
+    struct
+    {
+        // Protects batch. Deferred invalidates may come from concurrent fault
+        // service workers.
+        uvm_spinlock_t lock;
+
+        uvm_tlb_batch_t batch;
+    } deferred_tlb;
 };
 
 // A vector of page table ranges
@@ -267,6 +267,28 @@ void uvm_hal_pascal_fault_buffer_parse_entry(uvm_parent_gpu_t *parent_gpu,
     uvm_hal_pascal_fault_buffer_entry_clear_valid(parent_gpu, index);
 }
 
+NvU32 uvm_hal_pascal_fault_buffer_parse_entries(uvm_parent_gpu_t *parent_gpu,
+                                                NvU32 index,
+                                                NvU32 count,
+                                                uvm_fault_buffer_entry_t *buffer_entries)
+{
+    NvU32 i;
+
+    UVM_ASSERT(index + count <= parent_gpu->fault_buffer_info.replayable.max_faults);
+
+    for (i = 0; i < count; ++i) {
+        if (!uvm_hal_pascal_fault_buffer_entry_is_valid(parent_gpu, index + i))
+            break;
+
+        // Prevent later accesses being moved above the read of the valid bit
+        smp_mb__after_atomic();
+
+        uvm_hal_pascal_fault_buffer_parse_entry(parent_gpu, index + i, &buffer_entries[i]);
+    }
+
+    return i;
+}
+
 bool uvm_hal_pascal_fault_buffer_entry_is_valid(uvm_parent_gpu_t *parent_gpu, NvU32 index)
 {
     NvU32 *fault_entry;
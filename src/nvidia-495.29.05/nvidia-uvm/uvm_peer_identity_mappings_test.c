@@ -147,7 +147,7 @@ NV_STATUS uvm_test_peer_identity_mappings(UVM_TEST_PEER_IDENTITY_MAPPINGS_PARAMS
         goto done;
     }
 
-    if (gpu_a->parent->peer_copy_mode != UVM_GPU_PEER_COPY_MODE_VIRTUAL) {
+    if (!uvm_parent_gpu_needs_peer_identity_mappings(gpu_a->parent)) {
         status = NV_WARN_NOTHING_TO_DO;
         goto done;
     }
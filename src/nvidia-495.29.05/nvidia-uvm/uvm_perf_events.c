@@ -76,6 +76,8 @@ NV_STATUS uvm_perf_register_event_callback_locked(uvm_perf_va_space_events_t *va
     callback_desc->callback = callback;
     list_add_tail(&callback_desc->callback_list_node, callback_list);
 
+    set_bit(event_id, va_space_events->listened_events);
+
     return NV_OK;
 }
 
@@ -110,6 +112,9 @@ void uvm_perf_unregister_event_callback_locked(uvm_perf_va_space_events_t *va_sp
 
     list_del(&callback_desc->callback_list_node);
 
+    if (list_empty(callback_list))
+        clear_bit(event_id, va_space_events->listened_events);
+
     kmem_cache_free(g_callback_desc_cache, callback_desc);
 }
 
@@ -130,6 +135,12 @@ void uvm_perf_event_notify(uvm_perf_va_space_events_t *va_space_events, uvm_perf
     UVM_ASSERT(event_id >= 0 && event_id < UVM_PERF_EVENT_COUNT);
     UVM_ASSERT(event_data);
 
+    // Most events have no listeners unless tools or the perf heuristics are
+    // enabled. Notifications racing with the registration of the first
+    // callback may be missed, just as if they had happened before it.
+    if (!uvm_perf_event_has_listeners(va_space_events, event_id))
+        return;
+
     callback_list = &va_space_events->event_callbacks[event_id];
 
     uvm_down_read(&va_space_events->lock);
@@ -167,6 +178,8 @@ NV_STATUS uvm_perf_init_va_space_events(uvm_va_space_t *va_space, uvm_perf_va_sp
     for (event_id = 0; event_id < UVM_PERF_EVENT_COUNT; ++event_id)
         INIT_LIST_HEAD(&va_space_events->event_callbacks[event_id]);
 
+    bitmap_zero(va_space_events->listened_events, UVM_PERF_EVENT_COUNT);
+
     va_space_events->va_space = va_space;
 
     return NV_OK;
@@ -194,6 +207,8 @@ void uvm_perf_destroy_va_space_events(uvm_perf_va_space_events_t *va_space_event
         }
     }
 
+    bitmap_zero(va_space_events->listened_events, UVM_PERF_EVENT_COUNT);
+
     va_space_events->va_space = NULL;
 }
 
@@ -217,6 +217,12 @@ typedef struct
     // Array of callbacks for event notification
     struct list_head event_callbacks[UVM_PERF_EVENT_COUNT];
 
+    // Bitmap of the events with at least one registered callback. Updated
+    // with the lock held in write mode, but read without the lock by
+    // uvm_perf_event_notify so events without listeners skip the lock
+    // altogether.
+    DECLARE_BITMAP(listened_events, UVM_PERF_EVENT_COUNT);
+
     uvm_va_space_t *va_space;
 } uvm_perf_va_space_events_t;
 
@@ -246,7 +252,8 @@ void uvm_perf_unregister_event_callback_locked(uvm_perf_va_space_events_t *va_sp
                                                uvm_perf_event_callback_t callback);
 
 // Invoke the callbacks registered for the given event. Callbacks cannot fail.
-// Acquires the va_space_events lock internally
+// Acquires the va_space_events lock internally, unless no callback is
+// registered for the event.
 void uvm_perf_event_notify(uvm_perf_va_space_events_t *va_space_events, uvm_perf_event_t event_id,
                            uvm_perf_event_data_t *event_data);
 
@@ -256,6 +263,14 @@ bool uvm_perf_is_event_callback_registered(uvm_perf_va_space_events_t *va_space_
                                            uvm_perf_event_t event_id,
                                            uvm_perf_event_callback_t callback);
 
+// Returns whether any callback is registered for the event. No locking is
+// required, but the result can be stale if callbacks are being registered or
+// unregistered concurrently.
+static inline bool uvm_perf_event_has_listeners(uvm_perf_va_space_events_t *va_space_events, uvm_perf_event_t event_id)
+{
+    return test_bit(event_id, va_space_events->listened_events);
+}
+
 // Initialization/cleanup functions
 NV_STATUS uvm_perf_events_init(void);
 void uvm_perf_events_exit(void);
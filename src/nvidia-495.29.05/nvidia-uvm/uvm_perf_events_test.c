@@ -62,6 +62,8 @@ static NV_STATUS test_events(uvm_va_space_t *va_space)
     status = uvm_perf_register_event_callback(&va_space->perf_events, UVM_PERF_EVENT_FAULT, callback_inc_2);
     TEST_CHECK_GOTO(status == NV_OK, done);
 
+    TEST_CHECK_GOTO(uvm_perf_event_has_listeners(&va_space->perf_events, UVM_PERF_EVENT_FAULT), done);
+
     // va_space read lock is required for page fault event notification
     uvm_va_space_down_read(va_space);
 
@@ -74,6 +76,16 @@ static NV_STATUS test_events(uvm_va_space_t *va_space)
     // test_data was initialized to zero. It should have been incremented by 1 and 2, respectively in the callbacks
     TEST_CHECK_GOTO(test_data == 3, done);
 
+    // Removing one of the callbacks must keep notifying the other one
+    uvm_perf_unregister_event_callback(&va_space->perf_events, UVM_PERF_EVENT_FAULT, callback_inc_1);
+    TEST_CHECK_GOTO(uvm_perf_event_has_listeners(&va_space->perf_events, UVM_PERF_EVENT_FAULT), done);
+
+    uvm_va_space_down_read(va_space);
+    uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
+    uvm_va_space_up_read(va_space);
+
+    TEST_CHECK_GOTO(test_data == 5, done);
+
 done:
     // Unregister all callbacks
     uvm_perf_unregister_event_callback(&va_space->perf_events, UVM_PERF_EVENT_FAULT, callback_inc_1);
@@ -25,6 +25,7 @@
 #include "uvm_perf_heuristics.h"
 #include "uvm_perf_thrashing.h"
 #include "uvm_perf_prefetch.h"
+#include "uvm_perf_read_dup.h"
 #include "uvm_gpu_access_counters.h"
 #include "uvm_va_space.h"
 
@@ -44,11 +45,16 @@ NV_STATUS uvm_perf_heuristics_init()
     if (status != NV_OK)
         return status;
 
+    status = uvm_perf_read_dup_init();
+    if (status != NV_OK)
+        return status;
+
     return NV_OK;
 }
 
 void uvm_perf_heuristics_exit()
 {
+    uvm_perf_read_dup_exit();
     uvm_perf_access_counters_exit();
     uvm_perf_prefetch_exit();
     uvm_perf_thrashing_exit();
@@ -79,6 +85,9 @@ NV_STATUS uvm_perf_heuristics_load(uvm_va_space_t *va_space)
     if (status != NV_OK)
         return status;
     status = uvm_perf_access_counters_load(va_space);
+    if (status != NV_OK)
+        return status;
+    status = uvm_perf_read_dup_load(va_space);
     if (status != NV_OK)
         return status;
 
@@ -87,7 +96,7 @@ NV_STATUS uvm_perf_heuristics_load(uvm_va_space_t *va_space)
 
 NV_STATUS uvm_perf_heuristics_register_gpu(uvm_va_space_t *va_space, uvm_gpu_t *gpu)
 {
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     return uvm_perf_thrashing_register_gpu(va_space, gpu);
 }
@@ -102,8 +111,9 @@ void uvm_perf_heuristics_stop(uvm_va_space_t *va_space)
 
 void uvm_perf_heuristics_unload(uvm_va_space_t *va_space)
 {
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
+    uvm_perf_read_dup_unload(va_space);
     uvm_perf_access_counters_unload(va_space);
     uvm_perf_prefetch_unload(va_space);
     uvm_perf_thrashing_unload(va_space);
@@ -51,7 +51,7 @@ NV_STATUS uvm_perf_module_load(uvm_perf_module_t *module, uvm_va_space_t *va_spa
     NV_STATUS status;
     size_t i, j;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
     UVM_ASSERT(va_space->perf_modules[module->type] == NULL);
 
     for (i = 0; i < UVM_PERF_EVENT_COUNT; ++i) {
@@ -82,7 +82,7 @@ void uvm_perf_module_unload(uvm_perf_module_t *module, uvm_va_space_t *va_space)
     uvm_va_block_t *block;
     size_t i;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     if (!va_space->perf_modules[module->type])
         return;
@@ -120,7 +120,7 @@ void uvm_perf_module_unload(uvm_perf_module_t *module, uvm_va_space_t *va_space)
 
 uvm_perf_module_t *uvm_perf_module_for_type(uvm_va_space_t *va_space, uvm_perf_module_type_t type)
 {
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     return va_space->perf_modules[type];
 }
@@ -48,6 +48,8 @@
 // - UVM_PERF_MODULE_TYPE_PREFETCH: detects memory prefetching opportunities
 // - UVM_PERF_MODULE_TYPE_ACCESS_COUNTERS: migrates memory using access counter
 // notifications
+// - UVM_PERF_MODULE_TYPE_READ_DUP: detects blocks that would benefit from read
+// duplication
 typedef enum
 {
     UVM_PERF_MODULE_FIRST_TYPE     = 0,
@@ -56,6 +58,7 @@ typedef enum
     UVM_PERF_MODULE_TYPE_THRASHING,
     UVM_PERF_MODULE_TYPE_PREFETCH,
     UVM_PERF_MODULE_TYPE_ACCESS_COUNTERS,
+    UVM_PERF_MODULE_TYPE_READ_DUP,
 
     UVM_PERF_MODULE_TYPE_COUNT,
 } uvm_perf_module_type_t;
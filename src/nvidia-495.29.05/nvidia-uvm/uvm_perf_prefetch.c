@@ -53,8 +53,57 @@ typedef struct
     NvU16 pending_prefetch_pages;
 
     NvU16 fault_migrations_to_last_proc;
+
+    // Prediction of the stream detector beyond the block boundaries. See
+    // uvm_perf_prefetch_hint_t.
+    NvU64 ahead_start;
+
+    NvU64 ahead_end;
 } block_prefetch_info_t;
 
+#define UVM_PERF_PREFETCH_STREAM_TABLE_SIZE 16
+
+// Per-VA space stream detection entry. Streams are tracked per VA range and
+// destination processor. The VA range is identified by its bounds, since the
+// entry may outlive the range. A stale entry can only cause a misprediction.
+typedef struct
+{
+    NvU64 range_start;
+
+    NvU64 range_end;
+
+    uvm_processor_id_t residency;
+
+    // Bounds of the pages that faulted the last time the stream was updated
+    NvU64 front_start;
+
+    NvU64 front_end;
+
+    // Distance in bytes between the last two fault fronts. Negative for
+    // descending streams.
+    NvS64 stride;
+
+    // Number of consecutive updates in which the fault front moved in the
+    // direction of stride. 0 means that the entry is not in use.
+    NvU32 confidence;
+
+    // Value of the table clock the last time the entry was updated. Used to
+    // replace the least recently used entry.
+    NvU64 last_use;
+} prefetch_stream_t;
+
+// Per-VA space prefetch detection structure
+typedef struct
+{
+    // Protects the stream table. Faults on different VA blocks of the same VA
+    // space can be serviced concurrently.
+    uvm_spinlock_t lock;
+
+    prefetch_stream_t streams[UVM_PERF_PREFETCH_STREAM_TABLE_SIZE];
+
+    NvU64 clock;
+} va_space_prefetch_info_t;
+
 //
 // Tunables for prefetch detection/prevention (configurable via module parameters)
 //
@@ -79,14 +128,64 @@ static unsigned uvm_perf_prefetch_threshold  = UVM_PREFETCH_THRESHOLD_DEFAULT;
 // logic
 static unsigned uvm_perf_prefetch_min_faults = UVM_PREFETCH_MIN_FAULTS_DEFAULT;
 
+#define UVM_PREFETCH_BLOCKS_AHEAD_DEFAULT 0
+#define UVM_PREFETCH_BLOCKS_AHEAD_MAX     16
+
+// Number of neighbouring VA blocks within the same VA range to prefetch when
+// the bitmap tree heuristics prefetch up to the edge of the faulting VA block.
+// 0 disables cross-block prefetching from the bitmap tree.
+static unsigned uvm_perf_prefetch_blocks_ahead = UVM_PREFETCH_BLOCKS_AHEAD_DEFAULT;
+
+// Enable/disable the stream detector. It runs alongside the bitmap tree
+// heuristics: it looks for fault fronts that move in a consistent direction
+// across consecutive faults on the same VA range (sequential or strided sweeps)
+// and prefetches ahead of the front, even beyond the faulting VA block.
+static unsigned uvm_perf_prefetch_stream_enable = 0;
+
+#define UVM_PREFETCH_STREAM_MIN_CONFIDENCE_MIN     1
+#define UVM_PREFETCH_STREAM_MIN_CONFIDENCE_DEFAULT 2
+#define UVM_PREFETCH_STREAM_MIN_CONFIDENCE_MAX     16
+
+// Number of consecutive fault front moves in the same direction required to
+// start prefetching ahead of a stream
+static unsigned uvm_perf_prefetch_stream_min_confidence = UVM_PREFETCH_STREAM_MIN_CONFIDENCE_DEFAULT;
+
+#define UVM_PREFETCH_STREAM_DISTANCE_KB_MIN     64
+#define UVM_PREFETCH_STREAM_DISTANCE_KB_DEFAULT 4096
+#define UVM_PREFETCH_STREAM_DISTANCE_KB_MAX     (64 * 1024)
+
+// Maximum distance ahead of the fault front that can be prefetched for a
+// stream. The actual distance grows with the confidence on the stream.
+static unsigned uvm_perf_prefetch_stream_distance_kb = UVM_PREFETCH_STREAM_DISTANCE_KB_DEFAULT;
+
+#define UVM_PREFETCH_2M_FIRST_TOUCH_THRESHOLD_DEFAULT 25
+
+// Percentage of the big pages of a VA block that need to be faulted on the
+// first touch from a GPU which backs the block with a single 2M chunk in order
+// to populate the whole block, so that it can be mapped with a 2M PTE from the
+// start. 0 disables the speculative population.
+//
+// Valid values 0-100
+static unsigned uvm_perf_prefetch_2m_first_touch_threshold = UVM_PREFETCH_2M_FIRST_TOUCH_THRESHOLD_DEFAULT;
+
 // Module parameters for the tunables
 module_param(uvm_perf_prefetch_enable, uint, S_IRUGO);
 module_param(uvm_perf_prefetch_threshold, uint, S_IRUGO);
 module_param(uvm_perf_prefetch_min_faults, uint, S_IRUGO);
+module_param(uvm_perf_prefetch_blocks_ahead, uint, S_IRUGO);
+module_param(uvm_perf_prefetch_stream_enable, uint, S_IRUGO);
+module_param(uvm_perf_prefetch_stream_min_confidence, uint, S_IRUGO);
+module_param(uvm_perf_prefetch_stream_distance_kb, uint, S_IRUGO);
+module_param(uvm_perf_prefetch_2m_first_touch_threshold, uint, S_IRUGO);
 
 static bool g_uvm_perf_prefetch_enable;
 static unsigned g_uvm_perf_prefetch_threshold;
 static unsigned g_uvm_perf_prefetch_min_faults;
+static unsigned g_uvm_perf_prefetch_blocks_ahead;
+static bool g_uvm_perf_prefetch_stream_enable;
+static unsigned g_uvm_perf_prefetch_stream_min_confidence;
+static NvU64 g_uvm_perf_prefetch_stream_distance;
+static unsigned g_uvm_perf_prefetch_2m_first_touch_threshold;
 
 // Callback declaration for the performance heuristics events
 static void prefetch_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
@@ -186,6 +285,252 @@ fail:
     return NULL;
 }
 
+static va_space_prefetch_info_t *va_space_prefetch_info_get(uvm_va_space_t *va_space)
+{
+    return uvm_perf_module_type_data(va_space->perf_modules_data, UVM_PERF_MODULE_TYPE_PREFETCH);
+}
+
+// Find the stream that the given fault front belongs to and update it, or
+// replace the least recently used entry with a new stream starting at the
+// front. A copy of the resulting entry is returned in stream.
+static void stream_update(va_space_prefetch_info_t *va_space_prefetch,
+                          uvm_va_range_t *va_range,
+                          uvm_processor_id_t residency,
+                          NvU64 front_start,
+                          NvU64 front_end,
+                          prefetch_stream_t *stream)
+{
+    size_t i;
+    prefetch_stream_t *match = NULL;
+    prefetch_stream_t *lru = &va_space_prefetch->streams[0];
+
+    uvm_spin_lock(&va_space_prefetch->lock);
+
+    ++va_space_prefetch->clock;
+
+    for (i = 0; i < ARRAY_SIZE(va_space_prefetch->streams); ++i) {
+        prefetch_stream_t *entry = &va_space_prefetch->streams[i];
+        NvU64 distance;
+
+        if (entry->last_use < lru->last_use)
+            lru = entry;
+
+        if (entry->last_use == 0 ||
+            entry->range_start != va_range->node.start ||
+            entry->range_end != va_range->node.end ||
+            !uvm_id_equal(entry->residency, residency))
+            continue;
+
+        distance = front_start > entry->front_start? front_start - entry->front_start :
+                                                       entry->front_start - front_start;
+        if (distance <= g_uvm_perf_prefetch_stream_distance) {
+            match = entry;
+            break;
+        }
+    }
+
+    if (match) {
+        NvS64 stride = (NvS64)(front_start - match->front_start);
+
+        // Repeated fronts (i.e. replayed duplicates or service retries) do not
+        // move the stream
+        if (stride != 0) {
+            if (match->stride != 0 && (stride > 0) == (match->stride > 0))
+                match->confidence = min(match->confidence + 1, (NvU32)UVM_PREFETCH_STREAM_MIN_CONFIDENCE_MAX);
+            else
+                match->confidence = 1;
+
+            match->stride      = stride;
+            match->front_start = front_start;
+            match->front_end   = front_end;
+        }
+    }
+    else {
+        match = lru;
+
+        match->range_start = va_range->node.start;
+        match->range_end   = va_range->node.end;
+        match->residency   = residency;
+        match->front_start = front_start;
+        match->front_end   = front_end;
+        match->stride      = 0;
+        match->confidence  = 0;
+    }
+
+    match->last_use = va_space_prefetch->clock;
+    *stream = *match;
+
+    uvm_spin_unlock(&va_space_prefetch->lock);
+}
+
+// Add the pages in [start, end] that fall within the block to the prefetch
+// mask
+static void stream_prefetch_in_block(uvm_va_block_t *va_block,
+                                     block_prefetch_info_t *prefetch_info,
+                                     NvU64 start,
+                                     NvU64 end)
+{
+    start = max(start, va_block->start);
+    end = min(end, va_block->end);
+
+    if (start <= end)
+        uvm_page_mask_region_fill(&prefetch_info->prefetch_pages,
+                                  uvm_va_block_region_from_start_end(va_block, start, end));
+}
+
+// Update the stream detector with the pages faulted within region, and
+// add its predictions to the prefetch mask of the block and to the ahead
+// region. The prefetch mask is expected to be in block page index space.
+static void stream_detect(uvm_va_block_t *va_block,
+                          block_prefetch_info_t *prefetch_info,
+                          uvm_processor_id_t new_residency,
+                          const uvm_page_mask_t *faulted_pages,
+                          uvm_va_block_region_t region)
+{
+    uvm_va_range_t *va_range = va_block->va_range;
+    va_space_prefetch_info_t *va_space_prefetch = va_space_prefetch_info_get(uvm_va_block_get_va_space(va_block));
+    prefetch_stream_t stream;
+    uvm_page_index_t first_page;
+    uvm_page_index_t last_page;
+    NvU64 front_start;
+    NvU64 front_end;
+    NvU64 extent;
+    NvU64 abs_stride;
+    NvU64 distance;
+    NvU32 degree;
+    NvU32 k;
+
+    if (!va_space_prefetch)
+        return;
+
+    first_page = uvm_va_block_first_page_in_mask(region, faulted_pages);
+    if (first_page >= region.outer)
+        return;
+
+    last_page = find_last_bit(faulted_pages->bitmap, region.outer);
+    UVM_ASSERT(last_page >= first_page && last_page < region.outer);
+
+    front_start = uvm_va_block_cpu_page_address(va_block, first_page);
+    front_end = uvm_va_block_cpu_page_address(va_block, last_page) + PAGE_SIZE - 1;
+
+    stream_update(va_space_prefetch, va_range, new_residency, front_start, front_end, &stream);
+
+    if (stream.confidence < g_uvm_perf_prefetch_stream_min_confidence)
+        return;
+
+    extent = front_end - front_start + 1;
+    abs_stride = stream.stride > 0? (NvU64)stream.stride : (NvU64)-stream.stride;
+
+    // Look further ahead as the confidence on the stream grows
+    distance = min(abs_stride * stream.confidence, g_uvm_perf_prefetch_stream_distance);
+    distance = max(distance, (NvU64)PAGE_SIZE);
+
+    if (abs_stride <= 2 * extent) {
+        NvU64 start;
+        NvU64 end;
+
+        // Dense stream: prefetch everything up to distance bytes ahead of the
+        // front, clamped to the VA range
+        if (stream.stride > 0) {
+            if (front_end == va_range->node.end)
+                return;
+
+            start = front_end + 1;
+            end = min(front_end + distance, va_range->node.end);
+        }
+        else {
+            if (front_start == va_range->node.start)
+                return;
+
+            start = max(front_start - min(distance, front_start - va_range->node.start), va_range->node.start);
+            end = front_start - 1;
+        }
+
+        stream_prefetch_in_block(va_block, prefetch_info, start, end);
+
+        if (stream.stride > 0 && end > va_block->end) {
+            prefetch_info->ahead_start = max(start, va_block->end + 1);
+            prefetch_info->ahead_end   = end;
+        }
+        else if (stream.stride < 0 && start < va_block->start) {
+            prefetch_info->ahead_start = start;
+            prefetch_info->ahead_end   = min(end, va_block->start - 1);
+        }
+
+        return;
+    }
+
+    // Strided stream: prefetch the front shifted by multiples of the stride.
+    // Only the first shifted front that falls outside of the block is
+    // reported as the ahead region, so that the gaps are not prefetched.
+    degree = max((NvU32)(distance / abs_stride), 1u);
+    for (k = 1; k <= degree; ++k) {
+        NvU64 start;
+        NvU64 end;
+
+        if (stream.stride > 0) {
+            if (front_start + k * abs_stride > va_range->node.end)
+                break;
+
+            start = front_start + k * abs_stride;
+            end = min(front_end + k * abs_stride, va_range->node.end);
+        }
+        else {
+            if (front_end < va_range->node.start + k * abs_stride)
+                break;
+
+            start = max(front_start - min(k * abs_stride, front_start - va_range->node.start), va_range->node.start);
+            end = front_end - k * abs_stride;
+        }
+
+        if (end < va_block->start || start > va_block->end) {
+            prefetch_info->ahead_start = start;
+            prefetch_info->ahead_end   = end;
+            break;
+        }
+
+        stream_prefetch_in_block(va_block, prefetch_info, start, end);
+    }
+}
+
+static bool page_will_be_resident(block_prefetch_info_t *prefetch_info,
+                                  const uvm_page_mask_t *faulted_pages,
+                                  const uvm_page_mask_t *resident_mask,
+                                  uvm_page_index_t page_index)
+{
+    return uvm_page_mask_test(&prefetch_info->prefetch_pages, page_index) ||
+           uvm_page_mask_test(faulted_pages, page_index) ||
+           (resident_mask && uvm_page_mask_test(resident_mask, page_index));
+}
+
+// If the pages that will be resident on the new residency after servicing the
+// faults reach the edge of the VA block, report the neighbouring blocks in
+// that direction as the ahead region. Predictions from the stream detector
+// take precedence.
+static void blocks_ahead_detect(uvm_va_block_t *va_block,
+                                block_prefetch_info_t *prefetch_info,
+                                const uvm_page_mask_t *faulted_pages,
+                                const uvm_page_mask_t *resident_mask)
+{
+    uvm_va_range_t *va_range = va_block->va_range;
+    uvm_page_index_t last_page_index = uvm_va_block_num_cpu_pages(va_block) - 1;
+    NvU64 size = (NvU64)g_uvm_perf_prefetch_blocks_ahead * UVM_VA_BLOCK_SIZE;
+
+    if (prefetch_info->ahead_end != 0)
+        return;
+
+    if (va_block->end < va_range->node.end &&
+        page_will_be_resident(prefetch_info, faulted_pages, resident_mask, last_page_index)) {
+        prefetch_info->ahead_start = va_block->end + 1;
+        prefetch_info->ahead_end = va_block->end + min(size, va_range->node.end - va_block->end);
+    }
+    else if (va_block->start > va_range->node.start &&
+             page_will_be_resident(prefetch_info, faulted_pages, resident_mask, 0)) {
+        prefetch_info->ahead_start = va_block->start - min(size, va_block->start - va_range->node.start);
+        prefetch_info->ahead_end = va_block->start - 1;
+    }
+}
+
 static void grow_fault_granularity_if_no_thrashing(block_prefetch_info_t *prefetch_info,
                                                    uvm_va_block_region_t region,
                                                    const uvm_page_mask_t *faulted_pages,
@@ -234,6 +579,51 @@ static void grow_fault_granularity(uvm_va_block_t *va_block,
     }
 }
 
+// The GPU chunk backing a VA block is zeroed in its entirety when it is
+// populated, regardless of how many pages are being faulted. Thus, on the first
+// touch from a GPU that backs the block with a single 2M chunk, making the rest
+// of the block resident costs no extra copies or memory. If the faults are
+// spread across enough big pages to predict that the block will fill, populate
+// it in full so that it is mapped with a single 2M PTE instead of being
+// gradually mapped with 4K/big PTEs. If the prediction is wrong, the 2M PTE is
+// split lazily by the regular unmap/migration paths.
+static bool first_touch_should_populate_2m(uvm_va_block_t *va_block,
+                                           uvm_processor_id_t new_residency,
+                                           const uvm_page_mask_t *faulted_pages)
+{
+    uvm_va_space_t *va_space = uvm_va_block_get_va_space(va_block);
+    uvm_gpu_t *gpu;
+    NvU32 big_page_size;
+    size_t num_big_pages;
+    size_t big_page_index;
+    size_t faulted_big_pages = 0;
+
+    if (g_uvm_perf_prefetch_2m_first_touch_threshold == 0)
+        return false;
+
+    if (!uvm_processor_mask_empty(&va_block->resident))
+        return false;
+
+    if (UVM_ID_IS_CPU(new_residency) ||
+        !uvm_processor_mask_test(&va_space->registered_gpu_va_spaces, new_residency))
+        return false;
+
+    gpu = uvm_va_space_get_gpu(va_space, new_residency);
+    if (!uvm_va_block_gpu_supports_2m(va_block, gpu))
+        return false;
+
+    big_page_size = uvm_va_block_gpu_big_page_size(va_block, gpu);
+    num_big_pages = uvm_va_block_num_big_pages(va_block, big_page_size);
+    for (big_page_index = 0; big_page_index < num_big_pages; ++big_page_index) {
+        uvm_va_block_region_t big_region = uvm_va_block_big_page_region(va_block, big_page_index, big_page_size);
+
+        if (!uvm_page_mask_region_empty(faulted_pages, big_region))
+            ++faulted_big_pages;
+    }
+
+    return faulted_big_pages * 100 >= num_big_pages * g_uvm_perf_prefetch_2m_first_touch_threshold;
+}
+
 // Within a block we only allow prefetching to a single processor. Therefore, if two processors
 // are accessing non-overlapping regions within the same block they won't benefit from
 // prefetching.
@@ -252,7 +642,7 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
     uvm_va_range_t *va_range = va_block->va_range;
     uvm_va_space_t *va_space = uvm_va_block_get_va_space(va_block);
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!g_uvm_perf_prefetch_enable)
         return;
@@ -267,6 +657,8 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
     }
 
     prefetch_info->pending_prefetch_pages = 0;
+    prefetch_info->ahead_start = 0;
+    prefetch_info->ahead_end = 0;
 
     if (UVM_ID_IS_CPU(new_residency) || va_block->gpus[uvm_id_gpu_index(new_residency)] != NULL)
         resident_mask = uvm_va_block_resident_mask_get(va_block, new_residency);
@@ -279,6 +671,11 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
         goto done;
     }
 
+    if (first_touch_should_populate_2m(va_block, new_residency, faulted_pages)) {
+        uvm_page_mask_region_fill(&prefetch_info->prefetch_pages, uvm_va_block_region_from_block(va_block));
+        goto done;
+    }
+
     if (resident_mask)
         uvm_page_mask_or(&prefetch_info->bitmap_tree.pages, resident_mask, faulted_pages);
     else
@@ -344,6 +741,9 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
     }
 
 done:
+    if (g_uvm_perf_prefetch_stream_enable)
+        stream_detect(va_block, prefetch_info, new_residency, faulted_pages, region);
+
     // Do not prefetch pages that are going to be migrated/populated due to a
     // fault
     uvm_page_mask_andnot(&prefetch_info->prefetch_pages,
@@ -371,6 +771,12 @@ done:
 
     prefetch_info->fault_migrations_to_last_proc += uvm_page_mask_region_weight(faulted_pages, region);
     prefetch_info->pending_prefetch_pages = uvm_page_mask_weight(&prefetch_info->prefetch_pages);
+
+    if (g_uvm_perf_prefetch_blocks_ahead > 0 &&
+        !thrashing_pages &&
+        prefetch_info->fault_migrations_to_last_proc >= g_uvm_perf_prefetch_min_faults) {
+        blocks_ahead_detect(va_block, prefetch_info, faulted_pages, resident_mask);
+    }
 }
 
 uvm_perf_prefetch_hint_t uvm_perf_prefetch_get_hint(uvm_va_block_t *va_block,
@@ -418,6 +824,14 @@ uvm_perf_prefetch_hint_t uvm_perf_prefetch_get_hint(uvm_va_block_t *va_block,
         }
     }
 
+    // Only report the ahead region if all of it is migratable, since the
+    // caller migrates it as a whole
+    if (prefetch_info->ahead_end != 0 &&
+        uvm_range_group_all_migratable(va_space, prefetch_info->ahead_start, prefetch_info->ahead_end)) {
+        ret.ahead_start = prefetch_info->ahead_start;
+        ret.ahead_end = prefetch_info->ahead_end;
+    }
+
     return ret;
 }
 
@@ -446,18 +860,46 @@ void prefetch_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t
 
 NV_STATUS uvm_perf_prefetch_load(uvm_va_space_t *va_space)
 {
+    NV_STATUS status;
+    va_space_prefetch_info_t *va_space_prefetch;
+
     if (!g_uvm_perf_prefetch_enable)
         return NV_OK;
 
-    return uvm_perf_module_load(&g_module_prefetch, va_space);
+    status = uvm_perf_module_load(&g_module_prefetch, va_space);
+    if (status != NV_OK)
+        return status;
+
+    if (!g_uvm_perf_prefetch_stream_enable)
+        return NV_OK;
+
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
+
+    va_space_prefetch = uvm_kvmalloc_zero(sizeof(*va_space_prefetch));
+    if (!va_space_prefetch)
+        return NV_ERR_NO_MEMORY;
+
+    uvm_spin_lock_init(&va_space_prefetch->lock, UVM_LOCK_ORDER_LEAF);
+
+    uvm_perf_module_type_set_data(va_space->perf_modules_data, va_space_prefetch, UVM_PERF_MODULE_TYPE_PREFETCH);
+
+    return NV_OK;
 }
 
 void uvm_perf_prefetch_unload(uvm_va_space_t *va_space)
 {
+    va_space_prefetch_info_t *va_space_prefetch;
+
     if (!g_uvm_perf_prefetch_enable)
         return;
 
     uvm_perf_module_unload(&g_module_prefetch, va_space);
+
+    va_space_prefetch = va_space_prefetch_info_get(va_space);
+    if (va_space_prefetch) {
+        uvm_perf_module_type_unset_data(va_space->perf_modules_data, UVM_PERF_MODULE_TYPE_PREFETCH);
+        uvm_kvfree(va_space_prefetch);
+    }
 }
 
 NV_STATUS uvm_perf_prefetch_init()
@@ -495,6 +937,50 @@ NV_STATUS uvm_perf_prefetch_init()
         g_uvm_perf_prefetch_min_faults = UVM_PREFETCH_MIN_FAULTS_DEFAULT;
     }
 
+    if (uvm_perf_prefetch_blocks_ahead <= UVM_PREFETCH_BLOCKS_AHEAD_MAX) {
+        g_uvm_perf_prefetch_blocks_ahead = uvm_perf_prefetch_blocks_ahead;
+    }
+    else {
+        pr_info("Invalid value %u for uvm_perf_prefetch_blocks_ahead. Using %u instead\n",
+                uvm_perf_prefetch_blocks_ahead, UVM_PREFETCH_BLOCKS_AHEAD_DEFAULT);
+
+        g_uvm_perf_prefetch_blocks_ahead = UVM_PREFETCH_BLOCKS_AHEAD_DEFAULT;
+    }
+
+    g_uvm_perf_prefetch_stream_enable = uvm_perf_prefetch_stream_enable != 0;
+
+    if (uvm_perf_prefetch_stream_min_confidence >= UVM_PREFETCH_STREAM_MIN_CONFIDENCE_MIN &&
+        uvm_perf_prefetch_stream_min_confidence <= UVM_PREFETCH_STREAM_MIN_CONFIDENCE_MAX) {
+        g_uvm_perf_prefetch_stream_min_confidence = uvm_perf_prefetch_stream_min_confidence;
+    }
+    else {
+        pr_info("Invalid value %u for uvm_perf_prefetch_stream_min_confidence. Using %u instead\n",
+                uvm_perf_prefetch_stream_min_confidence, UVM_PREFETCH_STREAM_MIN_CONFIDENCE_DEFAULT);
+
+        g_uvm_perf_prefetch_stream_min_confidence = UVM_PREFETCH_STREAM_MIN_CONFIDENCE_DEFAULT;
+    }
+
+    if (uvm_perf_prefetch_stream_distance_kb >= UVM_PREFETCH_STREAM_DISTANCE_KB_MIN &&
+        uvm_perf_prefetch_stream_distance_kb <= UVM_PREFETCH_STREAM_DISTANCE_KB_MAX) {
+        g_uvm_perf_prefetch_stream_distance = (NvU64)uvm_perf_prefetch_stream_distance_kb * 1024;
+    }
+    else {
+        pr_info("Invalid value %u for uvm_perf_prefetch_stream_distance_kb. Using %u instead\n",
+                uvm_perf_prefetch_stream_distance_kb, UVM_PREFETCH_STREAM_DISTANCE_KB_DEFAULT);
+
+        g_uvm_perf_prefetch_stream_distance = (NvU64)UVM_PREFETCH_STREAM_DISTANCE_KB_DEFAULT * 1024;
+    }
+
+    if (uvm_perf_prefetch_2m_first_touch_threshold <= 100) {
+        g_uvm_perf_prefetch_2m_first_touch_threshold = uvm_perf_prefetch_2m_first_touch_threshold;
+    }
+    else {
+        pr_info("Invalid value %u for uvm_perf_prefetch_2m_first_touch_threshold. Using %u instead\n",
+                uvm_perf_prefetch_2m_first_touch_threshold, UVM_PREFETCH_2M_FIRST_TOUCH_THRESHOLD_DEFAULT);
+
+        g_uvm_perf_prefetch_2m_first_touch_threshold = UVM_PREFETCH_2M_FIRST_TOUCH_THRESHOLD_DEFAULT;
+    }
+
     return NV_OK;
 }
 
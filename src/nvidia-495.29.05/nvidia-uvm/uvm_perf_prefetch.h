@@ -33,6 +33,15 @@ typedef struct
     const uvm_page_mask_t *prefetch_pages_mask;
 
     uvm_processor_id_t residency;
+
+    // Address range outside of the block, but within the same VA range, that
+    // is predicted to be accessed next by the faulting processor. It spans
+    // one or more neighbouring VA blocks. Both addresses are inclusive, and ahead_end is 0 if there is
+    // no prediction. The block servicing code cannot act on it, since it only
+    // holds the lock of the faulting block, so it is up to the caller to
+    // prefetch it once the block lock has been dropped.
+    NvU64 ahead_start;
+    NvU64 ahead_end;
 } uvm_perf_prefetch_hint_t;
 
 // Global initialization/cleanup functions
@@ -56,6 +65,6 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
                                                   uvm_va_block_region_t region);
 
 #define UVM_PERF_PREFETCH_HINT_NONE()                       \
-    (uvm_perf_prefetch_hint_t){ NULL, UVM_ID_INVALID }
+    (uvm_perf_prefetch_hint_t){ NULL, UVM_ID_INVALID, 0, 0 }
 
 #endif
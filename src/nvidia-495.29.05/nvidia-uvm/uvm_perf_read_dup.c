@@ -0,0 +1,255 @@
+/*******************************************************************************
+    Copyright (c) 2021 NVIDIA Corporation
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal in the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be
+        included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN hint OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+#include "uvm_linux.h"
+#include "uvm_perf_events.h"
+#include "uvm_perf_module.h"
+#include "uvm_perf_read_dup.h"
+#include "uvm_va_block.h"
+#include "uvm_va_range.h"
+
+// Global cache to allocate the per-VA block read duplication detection
+// structures
+static struct kmem_cache *g_read_dup_info_cache __read_mostly;
+
+// Per-VA block read duplication detection structure
+typedef struct
+{
+    // Processors that triggered read faults on the block since the last write
+    // fault
+    uvm_processor_mask_t readers;
+
+    // Whether the block is currently promoted to read duplication
+    bool promoted;
+} block_read_dup_info_t;
+
+// Tunables for read duplication heuristics (configurable via module
+// parameters)
+
+// Whether the read duplication heuristics are enabled
+static unsigned uvm_perf_read_dup_enable = 0;
+
+#define UVM_PERF_READ_DUP_MIN_READERS_MIN     2
+#define UVM_PERF_READ_DUP_MIN_READERS_DEFAULT 2
+#define UVM_PERF_READ_DUP_MIN_READERS_MAX     UVM_ID_MAX_PROCESSORS
+
+// Number of different processors that need to read fault on a block, with no
+// write faults in between, before the block is promoted to read duplication
+static unsigned uvm_perf_read_dup_min_readers = UVM_PERF_READ_DUP_MIN_READERS_DEFAULT;
+
+// Module parameters for the tunables
+module_param(uvm_perf_read_dup_enable, uint, S_IRUGO);
+module_param(uvm_perf_read_dup_min_readers, uint, S_IRUGO);
+
+static bool g_uvm_perf_read_dup_enable;
+static unsigned g_uvm_perf_read_dup_min_readers;
+
+// Callback declarations for the performance heuristics events
+static void read_dup_fault_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
+static void read_dup_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
+
+// Performance heuristics module for read duplication
+static uvm_perf_module_t g_module_read_dup;
+
+static uvm_perf_module_event_callback_desc_t g_callbacks_read_dup[] = {
+    { UVM_PERF_EVENT_FAULT,         read_dup_fault_cb },
+    { UVM_PERF_EVENT_BLOCK_DESTROY, read_dup_block_destroy_cb },
+    { UVM_PERF_EVENT_MODULE_UNLOAD, read_dup_block_destroy_cb },
+    { UVM_PERF_EVENT_BLOCK_SHRINK,  read_dup_block_destroy_cb }
+};
+
+// Get the read duplication detection struct for the given block
+static block_read_dup_info_t *read_dup_info_get(uvm_va_block_t *va_block)
+{
+    return uvm_perf_module_type_data(va_block->perf_modules_data, UVM_PERF_MODULE_TYPE_READ_DUP);
+}
+
+static void read_dup_info_destroy(uvm_va_block_t *va_block)
+{
+    block_read_dup_info_t *read_dup_info = read_dup_info_get(va_block);
+    if (read_dup_info) {
+        kmem_cache_free(g_read_dup_info_cache, read_dup_info);
+        uvm_perf_module_type_unset_data(va_block->perf_modules_data, UVM_PERF_MODULE_TYPE_READ_DUP);
+    }
+}
+
+// Get the read duplication detection struct for the given block or create it
+// if it does not exist
+static block_read_dup_info_t *read_dup_info_get_create(uvm_va_block_t *va_block)
+{
+    block_read_dup_info_t *read_dup_info = read_dup_info_get(va_block);
+    if (!read_dup_info) {
+        read_dup_info = nv_kmem_cache_zalloc(g_read_dup_info_cache, NV_UVM_GFP_FLAGS);
+        if (!read_dup_info)
+            return NULL;
+
+        uvm_perf_module_type_set_data(va_block->perf_modules_data, read_dup_info, UVM_PERF_MODULE_TYPE_READ_DUP);
+    }
+
+    return read_dup_info;
+}
+
+static void read_dup_fault_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
+{
+    uvm_va_block_t *va_block = event_data->fault.block;
+    uvm_processor_id_t proc_id = event_data->fault.proc_id;
+    block_read_dup_info_t *read_dup_info;
+    uvm_fault_access_type_t access_type;
+
+    UVM_ASSERT(g_uvm_perf_read_dup_enable);
+    UVM_ASSERT(event_id == UVM_PERF_EVENT_FAULT);
+
+    // Only managed blocks follow the read duplication policy of their range
+    if (!va_block || !va_block->va_range)
+        return;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    if (UVM_ID_IS_CPU(proc_id)) {
+        access_type = event_data->fault.cpu.is_write ? UVM_FAULT_ACCESS_TYPE_WRITE : UVM_FAULT_ACCESS_TYPE_READ;
+    }
+    else {
+        // Duplicate faults have already been accounted for
+        if (event_data->fault.gpu.is_duplicate)
+            return;
+
+        access_type = event_data->fault.gpu.buffer_entry->fault_access_type;
+    }
+
+    // Any write demotes the block
+    if (access_type > UVM_FAULT_ACCESS_TYPE_READ) {
+        read_dup_info = read_dup_info_get(va_block);
+        if (read_dup_info) {
+            read_dup_info->promoted = false;
+            uvm_processor_mask_zero(&read_dup_info->readers);
+        }
+
+        return;
+    }
+
+    // Prefetch faults are not real accesses
+    if (access_type != UVM_FAULT_ACCESS_TYPE_READ)
+        return;
+
+    // Do not override explicit policies
+    if (va_block->va_range->read_duplication != UVM_READ_DUPLICATION_UNSET ||
+        UVM_ID_IS_VALID(va_block->va_range->preferred_location))
+        return;
+
+    read_dup_info = read_dup_info_get_create(va_block);
+    if (!read_dup_info || read_dup_info->promoted)
+        return;
+
+    uvm_processor_mask_set(&read_dup_info->readers, proc_id);
+    if (uvm_processor_mask_get_count(&read_dup_info->readers) >= g_uvm_perf_read_dup_min_readers)
+        read_dup_info->promoted = true;
+}
+
+static void read_dup_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
+{
+    uvm_va_block_t *va_block;
+
+    UVM_ASSERT(g_uvm_perf_read_dup_enable);
+
+    UVM_ASSERT(event_id == UVM_PERF_EVENT_BLOCK_DESTROY ||
+               event_id == UVM_PERF_EVENT_MODULE_UNLOAD ||
+               event_id == UVM_PERF_EVENT_BLOCK_SHRINK);
+
+    if (event_id == UVM_PERF_EVENT_BLOCK_DESTROY)
+        va_block = event_data->block_destroy.block;
+    else if (event_id == UVM_PERF_EVENT_BLOCK_SHRINK)
+        va_block = event_data->block_shrink.block;
+    else
+        va_block = event_data->module_unload.block;
+
+    if (!va_block)
+        return;
+
+    read_dup_info_destroy(va_block);
+}
+
+bool uvm_perf_read_dup_is_block_promoted(uvm_va_block_t *va_block)
+{
+    block_read_dup_info_t *read_dup_info;
+
+    if (!g_uvm_perf_read_dup_enable)
+        return false;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    read_dup_info = read_dup_info_get(va_block);
+
+    return read_dup_info && read_dup_info->promoted;
+}
+
+NV_STATUS uvm_perf_read_dup_load(uvm_va_space_t *va_space)
+{
+    if (!g_uvm_perf_read_dup_enable)
+        return NV_OK;
+
+    return uvm_perf_module_load(&g_module_read_dup, va_space);
+}
+
+void uvm_perf_read_dup_unload(uvm_va_space_t *va_space)
+{
+    if (!g_uvm_perf_read_dup_enable)
+        return;
+
+    uvm_perf_module_unload(&g_module_read_dup, va_space);
+}
+
+NV_STATUS uvm_perf_read_dup_init()
+{
+    g_uvm_perf_read_dup_enable = uvm_perf_read_dup_enable != 0;
+
+    if (!g_uvm_perf_read_dup_enable)
+        return NV_OK;
+
+    uvm_perf_module_init("perf_read_dup", UVM_PERF_MODULE_TYPE_READ_DUP, g_callbacks_read_dup,
+                         ARRAY_SIZE(g_callbacks_read_dup), &g_module_read_dup);
+
+    g_read_dup_info_cache = NV_KMEM_CACHE_CREATE("block_read_dup_info_t", block_read_dup_info_t);
+    if (!g_read_dup_info_cache)
+        return NV_ERR_NO_MEMORY;
+
+    if (uvm_perf_read_dup_min_readers >= UVM_PERF_READ_DUP_MIN_READERS_MIN &&
+        uvm_perf_read_dup_min_readers <= UVM_PERF_READ_DUP_MIN_READERS_MAX) {
+        g_uvm_perf_read_dup_min_readers = uvm_perf_read_dup_min_readers;
+    }
+    else {
+        pr_info("Invalid value %u for uvm_perf_read_dup_min_readers. Using %u instead\n",
+                uvm_perf_read_dup_min_readers, UVM_PERF_READ_DUP_MIN_READERS_DEFAULT);
+
+        g_uvm_perf_read_dup_min_readers = UVM_PERF_READ_DUP_MIN_READERS_DEFAULT;
+    }
+
+    return NV_OK;
+}
+
+void uvm_perf_read_dup_exit()
+{
+    if (!g_uvm_perf_read_dup_enable)
+        return;
+
+    kmem_cache_destroy_safe(&g_read_dup_info_cache);
+}
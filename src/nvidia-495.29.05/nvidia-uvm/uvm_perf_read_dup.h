@@ -0,0 +1,47 @@
+/*******************************************************************************
+    Copyright (c) 2021 NVIDIA Corporation
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal in the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be
+        included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN hint OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+#ifndef __UVM_PERF_READ_DUP_H__
+#define __UVM_PERF_READ_DUP_H__
+
+#include "uvm_linux.h"
+#include "uvm_va_block_types.h"
+
+// Read duplication heuristics: VA blocks of ranges without an explicit read
+// duplication policy that get read faults from several processors, and no
+// write faults, are promoted to read duplication as if the range had been
+// advised as ReadMostly. The first write fault on the block demotes it again.
+
+// Global initialization/cleanup functions
+NV_STATUS uvm_perf_read_dup_init(void);
+void uvm_perf_read_dup_exit(void);
+
+// VA space Initialization/cleanup functions
+NV_STATUS uvm_perf_read_dup_load(uvm_va_space_t *va_space);
+void uvm_perf_read_dup_unload(uvm_va_space_t *va_space);
+
+// Returns whether the block has been promoted to read duplication by the
+// heuristics. The caller must hold the va_block lock.
+bool uvm_perf_read_dup_is_block_promoted(uvm_va_block_t *va_block);
+
+#endif
@@ -30,6 +30,7 @@
 #include "uvm_va_range.h"
 #include "uvm_kvmalloc.h"
 #include "uvm_tools.h"
+#include "uvm_trace.h"
 #include "uvm_procfs.h"
 #include "uvm_test.h"
 
@@ -87,11 +88,22 @@ typedef struct
     };
 } page_thrashing_info_t;
 
+// Per-page tracking state is allocated in regions of THRASHING_REGION_PAGES
+// pages, only for the regions that take part in migration or revocation events
+// once the block shows potential thrashing.
+#define THRASHING_REGION_PAGES 16
+
 // Per-VA block thrashing detection structure. This state is protected by the
 // VA block lock.
 typedef struct
 {
-    page_thrashing_info_t                     *pages;
+    // Table of per-region page tracking arrays, indexed by page_index /
+    // THRASHING_REGION_PAGES. NULL until the block shows potential thrashing.
+    // Entries are NULL for regions without tracking state. See
+    // page_thrashing_get().
+    page_thrashing_info_t                    **page_regions;
+
+    NvU16                        num_page_regions;
 
     NvU16                        num_thrashing_pages;
 
@@ -106,6 +118,13 @@ typedef struct
     // Stats
     NvU32                           throttling_count;
 
+    // Cost model state, see uvm_perf_thrashing_cost_model. Last time a page
+    // in the block was unpinned by the pin timeout, and log2 of the scaling
+    // factor applied to the pinning duration of the pages in the block.
+    NvU64                      last_unpin_time_stamp;
+
+    NvS8                          pin_duration_shift;
+
     uvm_page_mask_t                  thrashing_pages;
 
     struct
@@ -198,6 +217,8 @@ typedef struct
         unsigned                          max_resets;
 
         NvU64                                 pin_ns;
+
+        bool                              cost_model;
     } params;
 
     uvm_va_space_t                         *va_space;
@@ -219,6 +240,10 @@ typedef struct
 
     // Number of times a page was pinned on a different processor while thrashing
     atomic64_t num_pin_remote;
+
+    // Number of times a page was pinned before reaching the pin threshold
+    // because of the cost model
+    atomic64_t num_pin_early;
 } processor_thrashing_stats_t;
 
 // Pre-allocated thrashing stats structure for the CPU. This is only valid if
@@ -232,6 +257,11 @@ static processor_thrashing_stats_t g_cpu_thrashing_stats;
             atomic64_inc(&_processor_stats->field);                                                  \
     } while (0)
 
+// Global accounting of the per-page tracking state, reported in the
+// thrashing_stats procfs files
+static atomic64_t g_thrashing_num_page_regions;
+static atomic64_t g_thrashing_num_decayed_blocks;
+
 // Global caches for the per-VA block thrashing detection structures
 static struct kmem_cache *g_va_block_thrashing_info_cache __read_mostly;
 static struct kmem_cache *g_pinned_page_cache __read_mostly;
@@ -305,6 +335,26 @@ static unsigned uvm_perf_thrashing_pin = UVM_PERF_THRASHING_PIN_DEFAULT;
 
 static unsigned uvm_perf_thrashing_max_resets = UVM_PERF_THRASHING_MAX_RESETS_DEFAULT;
 
+// Cost-model driven mitigation. When enabled:
+// - The number of throttling periods before pinning a page is scaled down
+//   with the bandwidth of the link used by the thrashing processors to access
+//   the pinned residency remotely, relative to
+//   UVM_PERF_THRASHING_COST_REF_BANDWIDTH. Pages accessed over fast links are
+//   pinned sooner, since remote accesses are cheap compared to migrating the
+//   page back and forth.
+// - The pinning duration adapts per VA block. It doubles when a page thrashes
+//   again right after its pin timeout expired, and halves when pages stay
+//   quiet for a thrashing epoch after the timeout.
+#define UVM_PERF_THRASHING_COST_MODEL_DEFAULT 0
+
+static unsigned uvm_perf_thrashing_cost_model = UVM_PERF_THRASHING_COST_MODEL_DEFAULT;
+
+// PCIe Gen3 x16
+#define UVM_PERF_THRASHING_COST_REF_BANDWIDTH 16000
+
+// Range of the pinning duration scaling, in log2
+#define UVM_PERF_THRASHING_COST_PIN_SHIFT_MAX 4
+
 // Module parameters for the tunables
 module_param(uvm_perf_thrashing_enable,        uint, S_IRUGO);
 module_param(uvm_perf_thrashing_threshold,     uint, S_IRUGO);
@@ -314,6 +364,7 @@ module_param(uvm_perf_thrashing_nap,           uint, S_IRUGO);
 module_param(uvm_perf_thrashing_epoch,         uint, S_IRUGO);
 module_param(uvm_perf_thrashing_pin,           uint, S_IRUGO);
 module_param(uvm_perf_thrashing_max_resets,    uint, S_IRUGO);
+module_param(uvm_perf_thrashing_cost_model,    uint, S_IRUGO);
 
 // See map_remote_on_atomic_fault uvm_va_block.c
 unsigned uvm_perf_map_remote_on_native_atomics_fault = 0;
@@ -329,6 +380,7 @@ static NvU64 g_uvm_perf_thrashing_nap;
 static NvU64 g_uvm_perf_thrashing_epoch;
 static NvU64 g_uvm_perf_thrashing_pin;
 static unsigned g_uvm_perf_thrashing_max_resets;
+static bool g_uvm_perf_thrashing_cost_model;
 
 // Helper macros to initialize thrashing parameters from module parameters
 //
@@ -423,6 +475,14 @@ static int nv_procfs_read_thrashing_stats(struct seq_file *s, void *v)
     UVM_SEQ_OR_DBG_PRINT(s, "throttle      %llu\n", (NvU64)atomic64_read(&processor_stats->num_throttle));
     UVM_SEQ_OR_DBG_PRINT(s, "pin_local     %llu\n", (NvU64)atomic64_read(&processor_stats->num_pin_local));
     UVM_SEQ_OR_DBG_PRINT(s, "pin_remote    %llu\n", (NvU64)atomic64_read(&processor_stats->num_pin_remote));
+    UVM_SEQ_OR_DBG_PRINT(s, "pin_early     %llu\n", (NvU64)atomic64_read(&processor_stats->num_pin_early));
+
+    // Global, the same in all the processor files
+    UVM_SEQ_OR_DBG_PRINT(s, "page_regions  %llu (%llu KB)\n",
+                         (NvU64)atomic64_read(&g_thrashing_num_page_regions),
+                         (NvU64)atomic64_read(&g_thrashing_num_page_regions) *
+                         THRASHING_REGION_PAGES * sizeof(page_thrashing_info_t) / 1024);
+    UVM_SEQ_OR_DBG_PRINT(s, "decayed       %llu\n", (NvU64)atomic64_read(&g_thrashing_num_decayed_blocks));
 
     uvm_up_read(&g_uvm_global.pm.lock);
 
@@ -536,7 +596,7 @@ static void gpu_thrashing_stats_destroy(uvm_gpu_t *gpu)
 // VA space lock needs to be held
 static va_space_thrashing_info_t *va_space_thrashing_info_get_or_null(uvm_va_space_t *va_space)
 {
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     return uvm_perf_module_type_data(va_space->perf_modules_data, UVM_PERF_MODULE_TYPE_THRASHING);
 }
@@ -584,6 +644,7 @@ static void va_space_thrashing_info_init_params(va_space_thrashing_info_t *va_sp
     }
 
     va_space_thrashing->params.max_resets    = g_uvm_perf_thrashing_max_resets;
+    va_space_thrashing->params.cost_model    = g_uvm_perf_thrashing_cost_model;
 }
 
 // Create the thrashing detection struct for the given VA space
@@ -592,7 +653,7 @@ static void va_space_thrashing_info_init_params(va_space_thrashing_info_t *va_sp
 static va_space_thrashing_info_t *va_space_thrashing_info_create(uvm_va_space_t *va_space)
 {
     va_space_thrashing_info_t *va_space_thrashing;
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     UVM_ASSERT(va_space_thrashing_info_get_or_null(va_space) == NULL);
 
@@ -614,7 +675,7 @@ static va_space_thrashing_info_t *va_space_thrashing_info_create(uvm_va_space_t
 static void va_space_thrashing_info_destroy(uvm_va_space_t *va_space)
 {
     va_space_thrashing_info_t *va_space_thrashing = va_space_thrashing_info_get_or_null(va_space);
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     if (va_space_thrashing) {
         uvm_perf_module_type_unset_data(va_space->perf_modules_data, UVM_PERF_MODULE_TYPE_THRASHING);
@@ -653,6 +714,72 @@ done:
     return block_thrashing;
 }
 
+// Get the tracking state of the given page, or NULL if the page's region has
+// no tracking state
+static page_thrashing_info_t *page_thrashing_get(const block_thrashing_info_t *block_thrashing,
+                                                 uvm_page_index_t page_index)
+{
+    page_thrashing_info_t *region;
+
+    if (!block_thrashing->page_regions)
+        return NULL;
+
+    region = block_thrashing->page_regions[page_index / THRASHING_REGION_PAGES];
+    if (!region)
+        return NULL;
+
+    return &region[page_index % THRASHING_REGION_PAGES];
+}
+
+// Get the tracking state of the given page, allocating its region if needed.
+// page_regions must have been allocated.
+static page_thrashing_info_t *page_thrashing_get_create(block_thrashing_info_t *block_thrashing,
+                                                        uvm_page_index_t page_index)
+{
+    page_thrashing_info_t **region = &block_thrashing->page_regions[page_index / THRASHING_REGION_PAGES];
+
+    if (!*region) {
+        NvU32 i;
+
+        *region = uvm_kvmalloc_zero(sizeof(**region) * THRASHING_REGION_PAGES);
+        if (!*region)
+            return NULL;
+
+        for (i = 0; i < THRASHING_REGION_PAGES; ++i) {
+            (*region)[i].pinned_residency_idx = uvm_id_value(UVM_ID_INVALID);
+            (*region)[i].do_not_throttle_processor_idx = uvm_id_value(UVM_ID_INVALID);
+        }
+
+        ++block_thrashing->num_page_regions;
+        atomic64_inc(&g_thrashing_num_page_regions);
+    }
+
+    return &(*region)[page_index % THRASHING_REGION_PAGES];
+}
+
+static NvU32 thrashing_num_page_regions(uvm_va_block_t *va_block)
+{
+    return DIV_ROUND_UP(uvm_va_block_num_cpu_pages(va_block), THRASHING_REGION_PAGES);
+}
+
+// Free all the per-page tracking state of the block
+static void thrashing_free_page_regions(uvm_va_block_t *va_block, block_thrashing_info_t *block_thrashing)
+{
+    NvU32 i;
+
+    if (!block_thrashing->page_regions)
+        return;
+
+    for (i = 0; i < thrashing_num_page_regions(va_block); ++i)
+        uvm_kvfree(block_thrashing->page_regions[i]);
+
+    atomic64_sub(block_thrashing->num_page_regions, &g_thrashing_num_page_regions);
+
+    uvm_kvfree(block_thrashing->page_regions);
+    block_thrashing->page_regions = NULL;
+    block_thrashing->num_page_regions = 0;
+}
+
 static void thrashing_reset_pages_in_region(uvm_va_block_t *va_block, NvU64 address, NvU64 bytes);
 
 // Destroy the thrashing detection struct for the given block
@@ -665,7 +792,7 @@ static void thrashing_info_destroy(uvm_va_block_t *va_block)
 
         uvm_perf_module_type_unset_data(va_block->perf_modules_data, UVM_PERF_MODULE_TYPE_THRASHING);
 
-        uvm_kvfree(block_thrashing->pages);
+        thrashing_free_page_regions(va_block, block_thrashing);
         kmem_cache_free(g_va_block_thrashing_info_cache, block_thrashing);
     }
 }
@@ -710,8 +837,7 @@ static bool thrashing_state_checks(uvm_va_block_t *va_block,
     UVM_ASSERT(uvm_page_mask_subset(&block_thrashing->pinned_pages.mask, &block_thrashing->thrashing_pages));
 
     if (page_thrashing) {
-        UVM_ASSERT(block_thrashing->pages);
-        UVM_ASSERT(page_thrashing == &block_thrashing->pages[page_index]);
+        UVM_ASSERT(page_thrashing == page_thrashing_get(block_thrashing, page_index));
     }
     else {
         UVM_ASSERT(!uvm_page_mask_test(&block_thrashing->thrashing_pages, page_index));
@@ -798,6 +924,10 @@ static void thrashing_throttle_processor(uvm_va_block_t *va_block,
         if (UVM_ID_IS_GPU(processor))
             uvm_tools_record_throttling_start(va_space, address, processor);
 
+        // Unlike the tools events, the tracepoint marks when the processor is
+        // selected for throttling, including the CPU
+        trace_uvm_throttling_start(address, uvm_id_value(processor));
+
         if (!page_thrashing->pinned)
             UVM_PERF_SATURATING_INC(page_thrashing->throttling_count);
 
@@ -833,6 +963,8 @@ static void thrashing_throttle_end_processor(uvm_va_block_t *va_block,
     if (UVM_ID_IS_GPU(processor))
         uvm_tools_record_throttling_end(va_space, address, processor);
 
+    trace_uvm_throttling_end(address, uvm_id_value(processor));
+
     UVM_ASSERT(thrashing_state_checks(va_block, block_thrashing, page_thrashing, page_index));
 }
 
@@ -870,6 +1002,48 @@ static pinned_page_t *find_pinned_page(block_thrashing_info_t *block_thrashing,
     return NULL;
 }
 
+// Pinning duration for the pages in the block
+static NvU64 thrashing_pin_duration(va_space_thrashing_info_t *va_space_thrashing,
+                                    block_thrashing_info_t *block_thrashing)
+{
+    NvU64 pin_ns = va_space_thrashing->params.pin_ns;
+
+    if (!va_space_thrashing->params.cost_model)
+        return pin_ns;
+
+    if (block_thrashing->pin_duration_shift >= 0)
+        return pin_ns << block_thrashing->pin_duration_shift;
+
+    return max(pin_ns >> -block_thrashing->pin_duration_shift, 1ULL);
+}
+
+// Adapt the pinning duration of the block to the time elapsed since a page in
+// the block was last unpinned by the pin timeout. This is called when a page
+// is pinned again, so a short elapsed time means that the page kept thrashing
+// and the pinning was too short.
+static void thrashing_cost_model_update_pin_duration(va_space_thrashing_info_t *va_space_thrashing,
+                                                     block_thrashing_info_t *block_thrashing,
+                                                     NvU64 time_stamp)
+{
+    NvU64 elapsed;
+
+    if (block_thrashing->last_unpin_time_stamp == 0)
+        return;
+
+    elapsed = time_stamp - block_thrashing->last_unpin_time_stamp;
+
+    if (elapsed < thrashing_pin_duration(va_space_thrashing, block_thrashing)) {
+        if (block_thrashing->pin_duration_shift < UVM_PERF_THRASHING_COST_PIN_SHIFT_MAX)
+            ++block_thrashing->pin_duration_shift;
+    }
+    else if (elapsed > va_space_thrashing->params.epoch_ns) {
+        if (block_thrashing->pin_duration_shift > -UVM_PERF_THRASHING_COST_PIN_SHIFT_MAX)
+            --block_thrashing->pin_duration_shift;
+    }
+
+    block_thrashing->last_unpin_time_stamp = 0;
+}
+
 // Pin a page on the specified processor. All thrashing processors will be
 // mapped remotely on this location, when possible
 //
@@ -903,9 +1077,12 @@ static NV_STATUS thrashing_pin_page(va_space_thrashing_info_t *va_space_thrashin
             if (!pinned_page)
                 return NV_ERR_NO_MEMORY;
 
+            if (va_space_thrashing->params.cost_model)
+                thrashing_cost_model_update_pin_duration(va_space_thrashing, block_thrashing, time_stamp);
+
             pinned_page->va_block = va_block;
             pinned_page->page_index = page_index;
-            pinned_page->deadline = time_stamp + va_space_thrashing->params.pin_ns;
+            pinned_page->deadline = time_stamp + thrashing_pin_duration(va_space_thrashing, block_thrashing);
 
             uvm_spin_lock(&va_space_thrashing->pinned_pages.lock);
 
@@ -1022,9 +1199,10 @@ static void thrashing_reset_page(va_space_thrashing_info_t *va_space_thrashing,
                                  block_thrashing_info_t *block_thrashing,
                                  uvm_page_index_t page_index)
 {
-    page_thrashing_info_t *page_thrashing = &block_thrashing->pages[page_index];
+    page_thrashing_info_t *page_thrashing = page_thrashing_get(block_thrashing, page_index);
     uvm_assert_mutex_locked(&va_block->lock);
 
+    UVM_ASSERT(page_thrashing);
     UVM_ASSERT(block_thrashing->num_thrashing_pages > 0);
     UVM_ASSERT(uvm_page_mask_test(&block_thrashing->thrashing_pages, page_index));
     UVM_ASSERT(page_thrashing->num_thrashing_events > 0);
@@ -1058,7 +1236,7 @@ static void thrashing_reset_pages_in_region(uvm_va_block_t *va_block, NvU64 addr
     uvm_va_block_region_t region = uvm_va_block_region_from_start_size(va_block, address, bytes);
 
     block_thrashing = thrashing_info_get(va_block);
-    if (!block_thrashing || !block_thrashing->pages)
+    if (!block_thrashing || !block_thrashing->page_regions)
         return;
 
     // Update all pages in the region
@@ -1132,7 +1310,7 @@ static NV_STATUS unmap_remote_pinned_pages_from_all_processors(uvm_va_block_t *v
     uvm_assert_mutex_locked(&va_block->lock);
 
     block_thrashing = thrashing_info_get(va_block);
-    if (!block_thrashing || !block_thrashing->pages)
+    if (!block_thrashing || !block_thrashing->page_regions)
         return NV_OK;
 
     if (uvm_page_mask_empty(&block_thrashing->pinned_pages.mask))
@@ -1162,12 +1340,17 @@ static bool migrating_wrong_pages(uvm_va_block_t *va_block,
     uvm_va_block_region_t region = uvm_va_block_region_from_start_size(va_block, address, bytes);
 
     block_thrashing = thrashing_info_get(va_block);
-    if (!block_thrashing || !block_thrashing->pages)
+    if (!block_thrashing || !block_thrashing->page_regions)
         return false;
 
     for_each_va_block_page_in_region(page_index, region) {
-        page_thrashing_info_t *page_thrashing = &block_thrashing->pages[page_index];
-        uvm_processor_id_t pinned_residency = uvm_id_from_value(page_thrashing->pinned_residency_idx);
+        page_thrashing_info_t *page_thrashing = page_thrashing_get(block_thrashing, page_index);
+        uvm_processor_id_t pinned_residency;
+
+        if (!page_thrashing)
+            continue;
+
+        pinned_residency = uvm_id_from_value(page_thrashing->pinned_residency_idx);
         UVM_ASSERT_MSG(!page_thrashing->pinned || uvm_id_equal(proc_id, pinned_residency),
                        "Migrating to %u instead of %u\n",
                        uvm_id_value(proc_id),
@@ -1194,15 +1377,18 @@ static bool is_migration_pinned_pages_update(uvm_va_block_t *va_block,
     }
 
     block_thrashing = thrashing_info_get(va_block);
-    if (!block_thrashing || !block_thrashing->pages)
+    if (!block_thrashing || !block_thrashing->page_regions)
         return false;
 
     ret = uvm_page_mask_region_full(&block_thrashing->pinned_pages.mask, region);
     if (ret) {
         uvm_page_index_t page_index;
         for_each_va_block_page_in_region(page_index, region) {
-            page_thrashing_info_t *page_thrashing = &block_thrashing->pages[page_index];
-            uvm_processor_id_t pinned_residency = uvm_id_from_value(page_thrashing->pinned_residency_idx);
+            page_thrashing_info_t *page_thrashing = page_thrashing_get(block_thrashing, page_index);
+            uvm_processor_id_t pinned_residency;
+
+            UVM_ASSERT(page_thrashing);
+            pinned_residency = uvm_id_from_value(page_thrashing->pinned_residency_idx);
             UVM_ASSERT(uvm_id_equal(pinned_residency, event_data->migration.dst));
         }
     }
@@ -1292,34 +1478,42 @@ void thrashing_event_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_
 
     time_stamp = NV_GETTIME();
 
-    if (!block_thrashing->pages) {
-        // Don't create the per-page tracking structure unless there is some potential thrashing within the block
-        NvU16 num_block_pages;
+    // Decay the per-page tracking state of blocks that have been idle for a
+    // whole epoch without any thrashing page left
+    if (block_thrashing->page_regions &&
+        time_stamp - block_thrashing->last_time_stamp > va_space_thrashing->params.epoch_ns &&
+        block_thrashing->num_thrashing_pages == 0) {
+        UVM_ASSERT(block_thrashing->pinned_pages.count == 0);
 
+        thrashing_free_page_regions(va_block, block_thrashing);
+        atomic64_inc(&g_thrashing_num_decayed_blocks);
+    }
+
+    if (!block_thrashing->page_regions) {
+        // Don't create the per-page tracking structure unless there is some potential thrashing within the block
         if (block_thrashing->last_time_stamp == 0 ||
             uvm_id_equal(block_thrashing->last_processor, processor_id) ||
             time_stamp - block_thrashing->last_time_stamp > va_space_thrashing->params.lapse_ns) {
             goto done;
         }
 
-        num_block_pages = uvm_va_block_size(va_block) / PAGE_SIZE;
-
-        block_thrashing->pages = uvm_kvmalloc_zero(sizeof(*block_thrashing->pages) * num_block_pages);
-        if (!block_thrashing->pages)
+        block_thrashing->page_regions = uvm_kvmalloc_zero(sizeof(*block_thrashing->page_regions) *
+                                                          thrashing_num_page_regions(va_block));
+        if (!block_thrashing->page_regions)
             goto done;
-
-        for (page_index = 0; page_index < num_block_pages; ++page_index) {
-            block_thrashing->pages[page_index].pinned_residency_idx = uvm_id_value(UVM_ID_INVALID);
-            block_thrashing->pages[page_index].do_not_throttle_processor_idx = uvm_id_value(UVM_ID_INVALID);
-        }
     }
 
     region = uvm_va_block_region_from_start_size(va_block, address, bytes);
 
     // Update all pages in the region
     for_each_va_block_page_in_region(page_index, region) {
-        page_thrashing_info_t *page_thrashing = &block_thrashing->pages[page_index];
-        NvU64 last_time_stamp = page_thrashing_get_time_stamp(page_thrashing);
+        page_thrashing_info_t *page_thrashing = page_thrashing_get_create(block_thrashing, page_index);
+        NvU64 last_time_stamp;
+
+        if (!page_thrashing)
+            goto done;
+
+        last_time_stamp = page_thrashing_get_time_stamp(page_thrashing);
 
         // It is not possible that a pinned page is migrated here, since the
         // fault that triggered the migration should have unpinned it in its
@@ -1419,6 +1613,68 @@ static bool preferred_location_is_thrashing(uvm_va_range_t *va_range,
     return uvm_processor_mask_test(&page_thrashing->processors, va_range->preferred_location);
 }
 
+// Bandwidth in MB/s of the link used by processor to access memory resident on
+// residency. 0 if residency cannot be accessed directly.
+static NvU32 thrashing_link_bandwidth(uvm_va_space_t *va_space, uvm_processor_id_t processor, uvm_processor_id_t residency)
+{
+    if (uvm_id_equal(processor, residency))
+        return UINT_MAX;
+
+    if (!uvm_processor_mask_test(&va_space->can_access[uvm_id_value(processor)], residency))
+        return 0;
+
+    if (UVM_ID_IS_CPU(processor))
+        return uvm_va_space_get_gpu(va_space, residency)->parent->sysmem_link_rate_mbyte_per_s;
+
+    if (UVM_ID_IS_CPU(residency))
+        return uvm_va_space_get_gpu(va_space, processor)->parent->sysmem_link_rate_mbyte_per_s;
+
+    return uvm_gpu_peer_caps(uvm_va_space_get_gpu(va_space, processor),
+                             uvm_va_space_get_gpu(va_space, residency))->total_link_line_rate_mbyte_per_s;
+}
+
+// Number of throttling periods before pinning the page on residency. See
+// uvm_perf_thrashing_cost_model.
+static unsigned thrashing_pin_threshold(va_space_thrashing_info_t *va_space_thrashing,
+                                        page_thrashing_info_t *page_thrashing,
+                                        uvm_processor_id_t residency)
+{
+    uvm_va_space_t *va_space = va_space_thrashing->va_space;
+    unsigned pin_threshold = va_space_thrashing->params.pin_threshold;
+    NvU32 bandwidth = UINT_MAX;
+    uvm_processor_id_t id;
+
+    if (!va_space_thrashing->params.cost_model)
+        return pin_threshold;
+
+    // The slowest remote access among the thrashing processors determines the
+    // cost of pinning
+    for_each_id_in_mask(id, &page_thrashing->processors)
+        bandwidth = min(bandwidth, thrashing_link_bandwidth(va_space, id, residency));
+
+    if (bandwidth == 0)
+        return pin_threshold;
+
+    return max(min((unsigned)DIV_ROUND_UP((NvU64)pin_threshold * UVM_PERF_THRASHING_COST_REF_BANDWIDTH, bandwidth),
+                   pin_threshold),
+               1u);
+}
+
+static bool thrashing_should_pin(va_space_thrashing_info_t *va_space_thrashing,
+                                 page_thrashing_info_t *page_thrashing,
+                                 uvm_processor_id_t residency)
+{
+    if (page_thrashing->throttling_count >= va_space_thrashing->params.pin_threshold)
+        return true;
+
+    if (page_thrashing->throttling_count >= thrashing_pin_threshold(va_space_thrashing, page_thrashing, residency)) {
+        PROCESSOR_THRASHING_STATS_INC(va_space_thrashing->va_space, residency, num_pin_early);
+        return true;
+    }
+
+    return false;
+}
+
 static uvm_perf_thrashing_hint_t get_hint_for_migration_thrashing(va_space_thrashing_info_t *va_space_thrashing,
                                                                   uvm_va_block_t *va_block,
                                                                   uvm_page_index_t page_index,
@@ -1488,7 +1744,7 @@ static uvm_perf_thrashing_hint_t get_hint_for_migration_thrashing(va_space_thras
         else if (!uvm_id_equal(va_range->preferred_location, do_not_throttle_processor)) {
             hint.type = UVM_PERF_THRASHING_HINT_TYPE_THROTTLE;
         }
-        else if (page_thrashing->throttling_count >= va_space_thrashing->params.pin_threshold) {
+        else if (thrashing_should_pin(va_space_thrashing, page_thrashing, va_range->preferred_location)) {
             hint.type = UVM_PERF_THRASHING_HINT_TYPE_PIN;
             hint.pin.residency = va_range->preferred_location;
         }
@@ -1532,7 +1788,7 @@ static uvm_perf_thrashing_hint_t get_hint_for_migration_thrashing(va_space_thras
     else if (!uvm_id_equal(requester, do_not_throttle_processor)) {
         hint.type = UVM_PERF_THRASHING_HINT_TYPE_THROTTLE;
     }
-    else if (page_thrashing->throttling_count >= va_space_thrashing->params.pin_threshold) {
+    else if (thrashing_should_pin(va_space_thrashing, page_thrashing, requester)) {
         hint.type = UVM_PERF_THRASHING_HINT_TYPE_PIN;
         hint.pin.residency = requester;
     }
@@ -1588,7 +1844,7 @@ uvm_perf_thrashing_hint_t uvm_perf_thrashing_get_hint(uvm_va_block_t *va_block,
 
     // If the per-page tracking structure has not been created yet, we assume
     // no thrashing
-    if (!block_thrashing->pages)
+    if (!block_thrashing->page_regions)
         return hint;
 
     time_stamp = NV_GETTIME();
@@ -1606,15 +1862,14 @@ uvm_perf_thrashing_hint_t uvm_perf_thrashing_get_hint(uvm_va_block_t *va_block,
         for_each_va_block_page_in_mask(reset_page_index, &block_thrashing->thrashing_pages, va_block) {
             thrashing_throttling_reset_page(va_block,
                                             block_thrashing,
-                                            &block_thrashing->pages[reset_page_index],
+                                            page_thrashing_get(block_thrashing, reset_page_index),
                                             reset_page_index);
         }
 
         // Reset per-page tracking structure
         // TODO: Bug 1769904 [uvm] Speculatively unpin pages that were pinned on a specific memory due to thrashing
         UVM_ASSERT(uvm_page_mask_empty(&block_thrashing->pinned_pages.mask));
-        uvm_kvfree(block_thrashing->pages);
-        block_thrashing->pages                     = NULL;
+        thrashing_free_page_regions(va_block, block_thrashing);
         block_thrashing->num_thrashing_pages       = 0;
         block_thrashing->last_processor            = UVM_ID_INVALID;
         block_thrashing->last_time_stamp           = 0;
@@ -1623,10 +1878,10 @@ uvm_perf_thrashing_hint_t uvm_perf_thrashing_get_hint(uvm_va_block_t *va_block,
         goto done;
     }
 
-    page_thrashing = &block_thrashing->pages[page_index];
+    page_thrashing = page_thrashing_get(block_thrashing, page_index);
 
     // Not enough thrashing events yet
-    if (page_thrashing->num_thrashing_events < va_space_thrashing->params.threshold)
+    if (!page_thrashing || page_thrashing->num_thrashing_events < va_space_thrashing->params.threshold)
         goto done;
 
     // If the requesting processor is throttled, check the throttling end time
@@ -1740,9 +1995,8 @@ uvm_processor_mask_t *uvm_perf_thrashing_get_thrashing_processors(uvm_va_block_t
     block_thrashing = thrashing_info_get(va_block);
     UVM_ASSERT(block_thrashing);
 
-    UVM_ASSERT(block_thrashing->pages);
-
-    page_thrashing = &block_thrashing->pages[page_index];
+    page_thrashing = page_thrashing_get(block_thrashing, page_index);
+    UVM_ASSERT(page_thrashing);
 
     return &page_thrashing->processors;
 }
@@ -1853,6 +2107,8 @@ static void thrashing_unpin_pages(struct work_struct *work)
                                                           &va_space_thrashing->pinned_pages.va_block_context,
                                                           uvm_va_block_region_for_page(page_index));
             thrashing_reset_page(va_space_thrashing, va_block, block_thrashing, page_index);
+
+            block_thrashing->last_unpin_time_stamp = NV_GETTIME();
         }
 
         uvm_mutex_unlock(&va_block->lock);
@@ -1973,6 +2229,8 @@ NV_STATUS uvm_perf_thrashing_init()
 
     INIT_THRASHING_PARAMETER(uvm_perf_thrashing_max_resets, UVM_PERF_THRASHING_MAX_RESETS_DEFAULT);
 
+    INIT_THRASHING_PARAMETER_TOGGLE(uvm_perf_thrashing_cost_model, UVM_PERF_THRASHING_COST_MODEL_DEFAULT);
+
     g_va_block_thrashing_info_cache = NV_KMEM_CACHE_CREATE("uvm_block_thrashing_info_t", block_thrashing_info_t);
     if (!g_va_block_thrashing_info_cache) {
         status = NV_ERR_NO_MEMORY;
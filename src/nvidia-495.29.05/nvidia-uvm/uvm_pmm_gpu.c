@@ -100,7 +100,15 @@
 // All allocated user memory root chunks are tracked in an LRU list
 // (root_chunks.va_block_used). A root chunk is moved to the tail of that list
 // whenever any of its subchunks is allocated (unpinned) by a VA block (see
-// uvm_pmm_gpu_unpin_temp()). When a root chunk is selected for eviction, it has
+// uvm_pmm_gpu_unpin_temp()). Root chunks are also marked as referenced when
+// their memory is mapped or migrated to by an already resident VA block, and on
+// access counter notifications (see uvm_pmm_gpu_mark_root_chunk_referenced()).
+// Victims are picked from the head of the list in CLOCK order: referenced root
+// chunks get a second chance and are moved to the tail with the mark cleared.
+// Root chunks backing VA ranges with pinned residency are kept on a separate
+// list (root_chunks.va_block_residency_pinned), which is only used as a last
+// resort.
+// When a root chunk is selected for eviction, it has
 // the eviction flag set (see pick_root_chunk_to_evict()). This flag affects
 // many of the PMM operations on all of the subchunks of the root chunk being
 // evicted. See usage of (root_)chunk_is_in_eviction(), in particular in
@@ -171,6 +179,10 @@
 #include "uvm_va_space.h"
 #include "uvm_va_block.h"
 #include "uvm_test.h"
+#include "uvm_procfs.h"
+#include "uvm_hal.h"
+#include "uvm_push.h"
+#include "uvm_trace.h"
 #include "uvm_linux.h"
 
 static int uvm_global_oversubscription = 1;
@@ -185,6 +197,98 @@ MODULE_PARM_DESC(uvm_global_oversubscription, "Enable (1) or disable (0) global
 static unsigned uvm_perf_pma_batch_nonpinned_order = UVM_PERF_PMA_BATCH_NONPINNED_ORDER_DEFAULT;
 module_param(uvm_perf_pma_batch_nonpinned_order, uint, S_IRUGO);
 
+#define UVM_PERF_PMM_EVICTION_CLOCK_SCAN_DEFAULT 256
+
+// Maximum number of referenced root chunks given a second chance on each pick
+// of a chunk to evict from the used list. The scan runs with the PMM list lock
+// held, so it is bounded. When the limit is reached, the chunk at the head of
+// the list is evicted even if it is referenced. 0 disables the second chances,
+// so chunks are evicted in the order they became used.
+static unsigned uvm_perf_pmm_eviction_clock_scan = UVM_PERF_PMM_EVICTION_CLOCK_SCAN_DEFAULT;
+module_param(uvm_perf_pmm_eviction_clock_scan, uint, S_IRUGO);
+
+#define UVM_PERF_PMM_RESIDENCY_PINNED_MAX_DEFAULT 50
+#define UVM_PERF_PMM_RESIDENCY_PINNED_MAX_MAX     90
+
+// Maximum percentage of the GPU memory that can be exempted from eviction by
+// VA ranges with pinned residency. Root chunks over the quota are evicted like
+// any other.
+static unsigned uvm_perf_pmm_residency_pinned_max = UVM_PERF_PMM_RESIDENCY_PINNED_MAX_DEFAULT;
+module_param(uvm_perf_pmm_residency_pinned_max, uint, S_IRUGO);
+
+#define UVM_PERF_PMM_PRE_EVICTION_WATERMARK_MAX 50
+
+// Free memory watermarks for the background eviction thread, as a percentage of
+// the GPU memory. The thread is woken up when an allocation of user memory
+// finds less free memory than the low watermark, and it evicts until the free
+// memory reaches the high watermark. A low watermark of 0 disables the
+// background eviction.
+static unsigned uvm_perf_pmm_pre_eviction_low_watermark = 0;
+module_param(uvm_perf_pmm_pre_eviction_low_watermark, uint, S_IRUGO);
+
+static unsigned uvm_perf_pmm_pre_eviction_high_watermark = 0;
+module_param(uvm_perf_pmm_pre_eviction_high_watermark, uint, S_IRUGO);
+
+// Enable compaction of sparsely used user root chunks in the background, see
+// uvm_pmm_gpu_t::compaction
+static int uvm_perf_pmm_compaction = 0;
+module_param(uvm_perf_pmm_compaction, int, S_IRUGO);
+
+#define UVM_PERF_PMM_COMPACTION_MAX_USED_DEFAULT 25
+#define UVM_PERF_PMM_COMPACTION_MAX_USED_MAX     50
+
+// Only split root chunks with at most this percentage of their size allocated
+// are compacted
+static unsigned uvm_perf_pmm_compaction_max_used = UVM_PERF_PMM_COMPACTION_MAX_USED_DEFAULT;
+module_param(uvm_perf_pmm_compaction_max_used, uint, S_IRUGO);
+
+// Number of root chunks freed per run of the compaction item
+#define UVM_PMM_COMPACTION_BATCH 4
+
+// Maximum number of root chunks from the head of the used list considered on
+// each pick of a chunk to compact. The scan runs with the PMM list lock held,
+// so it is bounded.
+#define UVM_PMM_COMPACTION_SCAN 64
+
+// Minimum time between the end of a compaction run and the next one
+#define UVM_PMM_COMPACTION_INTERVAL_MS 100
+
+// Enable zeroing of free user root chunks in the background, see
+// uvm_pmm_gpu_t::background_zero
+static int uvm_perf_pmm_background_zero = 0;
+module_param(uvm_perf_pmm_background_zero, int, S_IRUGO);
+
+#define UVM_PERF_PMM_BACKGROUND_ZERO_MAX_BACKLOG_DEFAULT 2
+
+// The background zeroing backs off while there are more pending pushes than
+// this in the default GPU_INTERNAL channel pool, so it doesn't compete with
+// user-driven CE work
+static unsigned uvm_perf_pmm_background_zero_max_backlog = UVM_PERF_PMM_BACKGROUND_ZERO_MAX_BACKLOG_DEFAULT;
+module_param(uvm_perf_pmm_background_zero_max_backlog, uint, S_IRUGO);
+
+// Number of root chunks zeroed per run of the background zeroing item. The item
+// requeues itself after each batch if there is more work left.
+#define UVM_PMM_BACKGROUND_ZERO_BATCH 16
+
+// Maximum number of back offs per run, after which the run is abandoned until
+// the next free
+#define UVM_PMM_BACKGROUND_ZERO_MAX_BACKOFFS 10
+
+#define UVM_PMM_BACKGROUND_ZERO_BACKOFF_US 100
+
+// Number of small kernel chunks cached per chunk size in each per-CPU magazine,
+// see uvm_pmm_gpu_magazine_t. 0 disables the magazines.
+static unsigned uvm_perf_pmm_magazine_depth = 0;
+module_param(uvm_perf_pmm_magazine_depth, uint, S_IRUGO);
+
+// Largest kernel chunk size cached by the magazines
+#define UVM_PMM_MAGAZINE_CHUNK_SIZE_MAX UVM_CHUNK_SIZE_64K
+
+// Number of chunks kept per small kernel chunk size in the page table reserve,
+// see uvm_pmm_gpu_t::page_table_reserve. 0 disables the reserve.
+static unsigned uvm_perf_pmm_page_table_reserve = 0;
+module_param(uvm_perf_pmm_page_table_reserve, uint, S_IRUGO);
+
 // Helper type for refcounting cache
 typedef struct
 {
@@ -313,6 +417,59 @@ static struct list_head *find_free_list(uvm_pmm_gpu_t *pmm,
 static bool check_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
 static struct list_head *find_free_list_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
 static void chunk_free_locked(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
+static size_t magazine_alloc(uvm_pmm_gpu_t *pmm, uvm_chunk_size_t chunk_size, uvm_gpu_chunk_t **chunks, size_t num_chunks);
+static bool magazine_free(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
+static size_t magazines_flush(uvm_pmm_gpu_t *pmm);
+static bool page_table_reserve_alloc(uvm_pmm_gpu_t *pmm,
+                                     uvm_chunk_size_t chunk_size,
+                                     uvm_gpu_chunk_t **chunks,
+                                     size_t num_chunks);
+
+static void lock_stats_acquired(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_lock_stats_t *stats)
+{
+    if (unlikely(READ_ONCE(pmm->lock_stats.enabled)))
+        stats->acquired_ns = NV_GETTIME();
+}
+
+static void lock_stats_releasing(uvm_pmm_gpu_lock_stats_t *stats)
+{
+    NvU64 hold_ns;
+
+    if (likely(stats->acquired_ns == 0))
+        return;
+
+    hold_ns = NV_GETTIME() - stats->acquired_ns;
+    stats->acquired_ns = 0;
+
+    ++stats->count;
+    stats->total_ns += hold_ns;
+    stats->max_ns = max(stats->max_ns, hold_ns);
+    ++stats->buckets[hold_ns ? min((NvU32)ilog2(hold_ns), (NvU32)(UVM_PMM_LOCK_STATS_BUCKETS - 1)) : 0];
+}
+
+static void pmm_lock(uvm_pmm_gpu_t *pmm)
+{
+    uvm_mutex_lock(&pmm->lock);
+    lock_stats_acquired(pmm, &pmm->lock_stats.lock);
+}
+
+static void pmm_unlock(uvm_pmm_gpu_t *pmm)
+{
+    lock_stats_releasing(&pmm->lock_stats.lock);
+    uvm_mutex_unlock(&pmm->lock);
+}
+
+static void pmm_list_lock(uvm_pmm_gpu_t *pmm)
+{
+    uvm_spin_lock(&pmm->list_lock);
+    lock_stats_acquired(pmm, &pmm->lock_stats.list_lock);
+}
+
+static void pmm_list_unlock(uvm_pmm_gpu_t *pmm)
+{
+    lock_stats_releasing(&pmm->lock_stats.list_lock);
+    uvm_spin_unlock(&pmm->list_lock);
+}
 
 static size_t root_chunk_index(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk)
 {
@@ -491,47 +648,27 @@ void uvm_pmm_gpu_sync(uvm_pmm_gpu_t *pmm)
     }
 }
 
-NV_STATUS uvm_pmm_gpu_alloc(uvm_pmm_gpu_t *pmm,
-                            size_t num_chunks,
-                            uvm_chunk_size_t chunk_size,
-                            uvm_pmm_gpu_memory_type_t mem_type,
-                            uvm_pmm_alloc_flags_t flags,
-                            uvm_gpu_chunk_t **chunks,
-                            uvm_tracker_t *out_tracker)
+// Add the work pending on the root chunks of the given chunks to out_tracker,
+// or wait for it if out_tracker is NULL.
+static NV_STATUS chunks_gather_trackers(uvm_pmm_gpu_t *pmm,
+                                        uvm_gpu_chunk_t **chunks,
+                                        size_t num_chunks,
+                                        uvm_tracker_t *out_tracker)
 {
     NV_STATUS status;
     uvm_tracker_t local_tracker = UVM_TRACKER_INIT();
     size_t i;
 
-    UVM_ASSERT((unsigned)mem_type < UVM_PMM_GPU_MEMORY_TYPE_COUNT);
-    UVM_ASSERT_MSG(is_power_of_2(chunk_size), "chunk size %u\n", chunk_size);
-    UVM_ASSERT_MSG(chunk_size & pmm->chunk_sizes[mem_type], "chunk size %u\n", chunk_size);
-    UVM_ASSERT(num_chunks == 0 || chunks);
-    UVM_ASSERT((flags & UVM_PMM_ALLOC_FLAGS_MASK) == flags);
-
-    if (flags & UVM_PMM_ALLOC_FLAGS_EVICT) {
-        // If eviction is requested then VA block locks need to be lockable
-        uvm_assert_lockable_order(UVM_LOCK_ORDER_VA_BLOCK);
-    }
-
     for (i = 0; i < num_chunks; i++) {
-        uvm_gpu_root_chunk_t *root_chunk;
-
-        status = alloc_chunk(pmm, mem_type, chunk_size, flags, &chunks[i]);
-        if (status != NV_OK)
-            goto error;
-
-        root_chunk = root_chunk_from_chunk(pmm, chunks[i]);
+        uvm_gpu_root_chunk_t *root_chunk = root_chunk_from_chunk(pmm, chunks[i]);
 
         root_chunk_lock(pmm, root_chunk);
         uvm_tracker_remove_completed(&root_chunk->tracker);
         status = uvm_tracker_add_tracker_safe(&local_tracker, &root_chunk->tracker);
         root_chunk_unlock(pmm, root_chunk);
 
-        if (status != NV_OK) {
-            i++;
+        if (status != NV_OK)
             goto error;
-        }
     }
 
     // Before we return to the caller, we need to ensure that the tracker only
@@ -554,6 +691,51 @@ NV_STATUS uvm_pmm_gpu_alloc(uvm_pmm_gpu_t *pmm,
 
 error:
     uvm_tracker_deinit(&local_tracker);
+
+    return status;
+}
+
+NV_STATUS uvm_pmm_gpu_alloc(uvm_pmm_gpu_t *pmm,
+                            size_t num_chunks,
+                            uvm_chunk_size_t chunk_size,
+                            uvm_pmm_gpu_memory_type_t mem_type,
+                            uvm_pmm_alloc_flags_t flags,
+                            uvm_gpu_chunk_t **chunks,
+                            uvm_tracker_t *out_tracker)
+{
+    NV_STATUS status;
+    size_t i;
+
+    UVM_ASSERT((unsigned)mem_type < UVM_PMM_GPU_MEMORY_TYPE_COUNT);
+    UVM_ASSERT_MSG(is_power_of_2(chunk_size), "chunk size %u\n", chunk_size);
+    UVM_ASSERT_MSG(chunk_size & pmm->chunk_sizes[mem_type], "chunk size %u\n", chunk_size);
+    UVM_ASSERT(num_chunks == 0 || chunks);
+    UVM_ASSERT((flags & UVM_PMM_ALLOC_FLAGS_MASK) == flags);
+
+    if (flags & UVM_PMM_ALLOC_FLAGS_EVICT) {
+        // If eviction is requested then VA block locks need to be lockable
+        uvm_assert_lockable_order(UVM_LOCK_ORDER_VA_BLOCK);
+    }
+
+    for (i = 0; i < num_chunks; i++) {
+        status = alloc_chunk(pmm, mem_type, chunk_size, flags, &chunks[i]);
+
+        // Chunks cached in the magazines can keep root chunks from being
+        // returned to PMA. Flush them and retry once.
+        if (status == NV_ERR_NO_MEMORY && magazines_flush(pmm) > 0)
+            status = alloc_chunk(pmm, mem_type, chunk_size, flags, &chunks[i]);
+
+        if (status != NV_OK)
+            goto error;
+    }
+
+    status = chunks_gather_trackers(pmm, chunks, num_chunks, out_tracker);
+    if (status != NV_OK)
+        goto error;
+
+    return NV_OK;
+
+error:
     while (i-- > 0)
         free_chunk(pmm, chunks[i]);
 
@@ -572,20 +754,75 @@ NV_STATUS uvm_pmm_gpu_alloc_kernel(uvm_pmm_gpu_t *pmm,
 {
     NV_STATUS status;
     size_t i;
+    size_t num_cached;
+
+    // Chunks from the magazines are already in the allocated state
+    num_cached = magazine_alloc(pmm, chunk_size, chunks, num_chunks);
+
+    if (num_cached < num_chunks) {
+        status = uvm_pmm_gpu_alloc(pmm,
+                                   num_chunks - num_cached,
+                                   chunk_size,
+                                   UVM_PMM_GPU_MEMORY_TYPE_KERNEL,
+                                   flags,
+                                   chunks + num_cached,
+                                   out_tracker);
+        if (status == NV_OK) {
+            for (i = num_cached; i < num_chunks; ++i) {
+                UVM_ASSERT(chunks[i]->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED);
 
-    status = uvm_pmm_gpu_alloc(pmm, num_chunks, chunk_size, UVM_PMM_GPU_MEMORY_TYPE_KERNEL, flags, chunks, out_tracker);
-    if (status != NV_OK)
-        return status;
-
-    for (i = 0; i < num_chunks; ++i) {
-        UVM_ASSERT(chunks[i]->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED);
+                pmm_list_lock(pmm);
+                chunk_unpin(pmm, chunks[i], UVM_PMM_GPU_CHUNK_STATE_ALLOCATED);
+                pmm_list_unlock(pmm);
+            }
+        }
+        else if (status == NV_ERR_NO_MEMORY &&
+                 page_table_reserve_alloc(pmm, chunk_size, chunks + num_cached, num_chunks - num_cached)) {
+            // Chunks from the reserve are already in the allocated state
+            num_cached = num_chunks;
+        }
+        else {
+            goto error;
+        }
+    }
 
-        uvm_spin_lock(&pmm->list_lock);
-        chunk_unpin(pmm, chunks[i], UVM_PMM_GPU_CHUNK_STATE_ALLOCATED);
-        uvm_spin_unlock(&pmm->list_lock);
+    status = chunks_gather_trackers(pmm, chunks, num_cached, out_tracker);
+    if (status != NV_OK) {
+        num_cached = num_chunks;
+        goto error;
     }
 
     return NV_OK;
+
+error:
+    for (i = 0; i < num_cached; ++i)
+        free_chunk(pmm, chunks[i]);
+
+    memset(chunks, 0, sizeof(chunks[0]) * num_chunks);
+
+    return status;
+}
+
+static void root_chunk_clear_residency_pinned_locked(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk)
+{
+    uvm_assert_spinlock_locked(&pmm->list_lock);
+
+    if (!root_chunk->residency_pinned)
+        return;
+
+    UVM_ASSERT(pmm->root_chunks.residency_pinned_count > 0);
+
+    root_chunk->residency_pinned = false;
+    --pmm->root_chunks.residency_pinned_count;
+}
+
+// Eviction list a used root chunk belongs to
+static struct list_head *root_chunk_used_list(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk)
+{
+    if (root_chunk->residency_pinned)
+        return &pmm->root_chunks.va_block_residency_pinned;
+
+    return &pmm->root_chunks.va_block_used;
 }
 
 static void chunk_update_lists_locked(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
@@ -603,7 +840,10 @@ static void chunk_update_lists_locked(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk
         else if (root_chunk->chunk.state != UVM_PMM_GPU_CHUNK_STATE_FREE) {
             UVM_ASSERT(root_chunk->chunk.state == UVM_PMM_GPU_CHUNK_STATE_IS_SPLIT ||
                        root_chunk->chunk.state == UVM_PMM_GPU_CHUNK_STATE_ALLOCATED);
-            list_move_tail(&root_chunk->chunk.list, &pmm->root_chunks.va_block_used);
+            list_move_tail(&root_chunk->chunk.list, root_chunk_used_list(pmm, root_chunk));
+        }
+        else {
+            root_chunk_clear_residency_pinned_locked(pmm, root_chunk);
         }
     }
 
@@ -621,7 +861,7 @@ void uvm_pmm_gpu_unpin_temp(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, uvm_va_b
 
     INIT_LIST_HEAD(&chunk->list);
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     UVM_ASSERT(!chunk->va_block);
     UVM_ASSERT(va_block);
@@ -631,7 +871,7 @@ void uvm_pmm_gpu_unpin_temp(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, uvm_va_b
     chunk->va_block = va_block;
     chunk_update_lists_locked(pmm, chunk);
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 }
 
 void uvm_pmm_gpu_free(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, uvm_tracker_t *tracker)
@@ -663,7 +903,8 @@ void uvm_pmm_gpu_free(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, uvm_tracker_t
         root_chunk_unlock(pmm, root_chunk);
     }
 
-    free_chunk(pmm, chunk);
+    if (!magazine_free(pmm, chunk))
+        free_chunk(pmm, chunk);
 }
 
 static NvU32 num_subchunks(uvm_gpu_chunk_t *parent)
@@ -751,7 +992,7 @@ static void merge_gpu_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 
     // Transition the chunk state under the list lock first and then clean up
     // the subchunk state.
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     child_state = chunk->suballoc->subchunks[0]->state;
 
@@ -777,7 +1018,7 @@ static void merge_gpu_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
     // not to use any of the subchunks later on.
     chunk->is_zero = false;
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     for (i = 0; i < num_sub; i++) {
         subchunk = suballoc->subchunks[i];
@@ -924,9 +1165,9 @@ static NV_STATUS split_walk_func(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, voi
         // testing.
         if (child_size == args->min_size &&
             args->num_subchunks_curr + num_children == args->num_subchunks_total) {
-            uvm_spin_lock(&pmm->list_lock);
+            pmm_list_lock(pmm);
             chunk->inject_split_error = true;
-            uvm_spin_unlock(&pmm->list_lock);
+            pmm_list_unlock(pmm);
         }
     }
 
@@ -996,7 +1237,7 @@ NV_STATUS uvm_pmm_gpu_split_chunk(uvm_pmm_gpu_t *pmm,
     UVM_ASSERT(subchunk_size & pmm->chunk_sizes[chunk->type]);
     UVM_ASSERT(subchunk_size < uvm_gpu_chunk_get_size(chunk));
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_ALLOCATED ||
                chunk->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED);
@@ -1007,9 +1248,9 @@ NV_STATUS uvm_pmm_gpu_split_chunk(uvm_pmm_gpu_t *pmm,
     if (unlikely(walk_args.inject_error)) {
         // inject_split_error is a bitfield, so we must take the lock to modify
         // it. This path is only used in testing.
-        uvm_spin_lock(&pmm->list_lock);
+        pmm_list_lock(pmm);
         chunk->inject_split_error = false;
-        uvm_spin_unlock(&pmm->list_lock);
+        pmm_list_unlock(pmm);
     }
 
     status = chunk_walk_pre_order(pmm, chunk, split_walk_func, &walk_args);
@@ -1021,7 +1262,7 @@ NV_STATUS uvm_pmm_gpu_split_chunk(uvm_pmm_gpu_t *pmm,
         UVM_ASSERT(walk_args.num_subchunks_curr == walk_args.num_subchunks_total);
     }
 
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
     return status;
 }
 
@@ -1083,7 +1324,7 @@ size_t uvm_pmm_gpu_get_subchunks(uvm_pmm_gpu_t *pmm,
                parent->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED ||
                parent->state == UVM_PMM_GPU_CHUNK_STATE_IS_SPLIT);
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     // Either pre- or post-order would work. Pick post-order just because we
     // only care about leaf chunks and we may exit early, so we'd get slightly
@@ -1094,7 +1335,7 @@ size_t uvm_pmm_gpu_get_subchunks(uvm_pmm_gpu_t *pmm,
         UVM_ASSERT(walk_args.num_written == walk_args.num_to_write);
     }
 
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
     return walk_args.num_written;
 }
 
@@ -1105,9 +1346,9 @@ static uvm_gpu_chunk_t *list_first_chunk(struct list_head *list)
 
 void uvm_pmm_gpu_merge_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 {
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
     uvm_pmm_gpu_merge_chunk_locked(pmm, chunk);
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 }
 
 static void root_chunk_unmap_indirect_peer(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, uvm_gpu_t *other_gpu)
@@ -1332,13 +1573,13 @@ uvm_gpu_address_t uvm_pmm_gpu_peer_copy_address(uvm_pmm_gpu_t *pmm,
     UVM_ASSERT(peer_caps->link_type != UVM_GPU_LINK_INVALID);
 
     if (peer_caps->is_indirect_peer ||
-        (accessing_gpu->parent->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_PHYSICAL)) {
+        (uvm_gpu_peer_copy_mode(accessing_gpu, pmm->gpu) == UVM_GPU_PEER_COPY_MODE_PHYSICAL)) {
         // Indirect peers are accessed as sysmem addresses, so they don't need
         // to use identity mappings.
         return uvm_gpu_address_from_phys(uvm_pmm_gpu_peer_phys_address(pmm, chunk, accessing_gpu));
     }
 
-    UVM_ASSERT(accessing_gpu->parent->peer_copy_mode == UVM_GPU_PEER_COPY_MODE_VIRTUAL);
+    UVM_ASSERT(uvm_gpu_peer_copy_mode(accessing_gpu, pmm->gpu) == UVM_GPU_PEER_COPY_MODE_VIRTUAL);
     gpu_peer_mapping = uvm_gpu_get_peer_mapping(accessing_gpu, pmm->gpu->id);
 
     return uvm_gpu_address_virtual(gpu_peer_mapping->base + chunk->address);
@@ -1353,7 +1594,7 @@ static NV_STATUS evict_root_chunk_from_va_block(uvm_pmm_gpu_t *pmm, uvm_gpu_root
 
     // To evict the chunks from the VA block we need to lock it, but we already
     // have the PMM lock held. Unlock it first and re-lock it after.
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     uvm_mutex_lock(&va_block->lock);
 
@@ -1374,14 +1615,14 @@ static NV_STATUS evict_root_chunk_from_va_block(uvm_pmm_gpu_t *pmm, uvm_gpu_root
 
     uvm_tracker_deinit(&tracker);
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     return status;
 }
 
 void uvm_pmm_gpu_mark_chunk_evicted(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 {
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     UVM_ASSERT(chunk_is_in_eviction(pmm, chunk));
     UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_ALLOCATED);
@@ -1391,14 +1632,14 @@ void uvm_pmm_gpu_mark_chunk_evicted(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
     chunk->va_block_page_index = PAGES_PER_UVM_VA_BLOCK;
     chunk_pin(pmm, chunk);
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 }
 
 static NV_STATUS pin_free_chunks_func(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, void *data)
 {
     uvm_assert_mutex_locked(&pmm->lock);
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     UVM_ASSERT(chunk_is_in_eviction(pmm, chunk));
 
@@ -1409,7 +1650,7 @@ static NV_STATUS pin_free_chunks_func(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk
             chunk->parent->suballoc->allocated++;
     }
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     return NV_OK;
 }
@@ -1440,7 +1681,7 @@ static NV_STATUS find_and_retain_va_block_to_evict(uvm_pmm_gpu_t *pmm, uvm_gpu_c
 
     UVM_ASSERT(evict_data->va_block_to_evict_from == NULL);
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     // All free chunks should have been pinned already by pin_free_chunks_func().
     UVM_ASSERT_MSG(chunk->state == UVM_PMM_GPU_CHUNK_STATE_ALLOCATED ||
@@ -1455,7 +1696,7 @@ static NV_STATUS find_and_retain_va_block_to_evict(uvm_pmm_gpu_t *pmm, uvm_gpu_c
         status = NV_ERR_MORE_DATA_AVAILABLE;
     }
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     return status;
 }
@@ -1473,7 +1714,7 @@ static bool root_chunk_has_elevated_page(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_
     return page_count(page) > UVM_CHUNK_SIZE_MAX / PAGE_SIZE;
 }
 
-static NV_STATUS evict_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, uvm_pmm_context_t pmm_context)
+static NV_STATUS evict_root_chunk_locked(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, uvm_pmm_context_t pmm_context)
 {
     NV_STATUS status;
     NV_STATUS free_status;
@@ -1510,14 +1751,14 @@ static NV_STATUS evict_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root
     // pinned root chunk.
     uvm_pmm_gpu_merge_chunk_locked(pmm, chunk);
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED);
     uvm_gpu_chunk_set_in_eviction(chunk, false);
 
     chunk->is_zero = false;
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     // Bug 2085760: Check if there is any page within the evicted chunk with an
     // elevated refcount. In such case there is another holder of the page,
@@ -1543,7 +1784,7 @@ error:
     // actually freed instead of pinned. We need the list lock to make the
     // eviction check and conditional pin in chunk_free_locked atomic with our
     // free-if-pinned loop below.
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     uvm_gpu_chunk_set_in_eviction(chunk, false);
 
@@ -1552,7 +1793,7 @@ error:
     // chunk_update_lists_locked() will do that.
     chunk_update_lists_locked(pmm, chunk);
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     do {
         free_status = chunk_walk_pre_order(pmm, chunk, free_first_pinned_chunk_func, NULL);
@@ -1564,6 +1805,64 @@ error:
     return status;
 }
 
+static NV_STATUS evict_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, uvm_pmm_context_t pmm_context)
+{
+    NV_STATUS status;
+    uvm_gpu_t *gpu = pmm->gpu;
+    NvU64 address = root_chunk->chunk.address;
+
+    trace_uvm_evict_root_chunk_begin(uvm_id_value(gpu->id), address);
+
+    status = evict_root_chunk_locked(pmm, root_chunk, pmm_context);
+
+    trace_uvm_evict_root_chunk_end(uvm_id_value(gpu->id), address, status);
+
+    return status;
+}
+
+// evict_root_chunk() only starts the copy-out of the evicted pages, and the
+// root chunk's tracker holds it until the root chunk is freed. Callers evicting
+// several root chunks in a row collect them in a batch and free them together,
+// so that the copy-outs of the whole batch are in flight at the same time
+// instead of being waited on one root chunk at a time.
+#define EVICTED_ROOT_CHUNKS_BATCH_SIZE 8
+
+typedef struct
+{
+    uvm_gpu_root_chunk_t *root_chunks[EVICTED_ROOT_CHUNKS_BATCH_SIZE];
+    size_t count;
+} evicted_root_chunks_t;
+
+static bool evicted_root_chunks_add(evicted_root_chunks_t *evicted, uvm_gpu_root_chunk_t *root_chunk)
+{
+    UVM_ASSERT(evicted->count < ARRAY_SIZE(evicted->root_chunks));
+
+    evicted->root_chunks[evicted->count++] = root_chunk;
+
+    return evicted->count == ARRAY_SIZE(evicted->root_chunks);
+}
+
+// Free the evicted root chunks of the batch back to PMA, waiting for their
+// copy-outs, or to PMM's free lists if free_to_pmm is set.
+//
+// LOCKING: The PMM lock must not be held
+static void evicted_root_chunks_free(uvm_pmm_gpu_t *pmm,
+                                     evicted_root_chunks_t *evicted,
+                                     bool free_to_pmm,
+                                     free_root_chunk_mode_t free_mode)
+{
+    size_t i;
+
+    for (i = 0; i < evicted->count; i++) {
+        if (free_to_pmm)
+            free_chunk(pmm, &evicted->root_chunks[i]->chunk);
+        else
+            free_root_chunk(pmm, evicted->root_chunks[i], free_mode);
+    }
+
+    evicted->count = 0;
+}
+
 static bool chunk_is_evictable(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 {
     uvm_gpu_root_chunk_t *root_chunk = root_chunk_from_chunk(pmm, chunk);
@@ -1597,239 +1896,1423 @@ static void chunk_start_eviction(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 
     list_del_init(&chunk->list);
     uvm_gpu_chunk_set_in_eviction(chunk, true);
+    atomic_set(&root_chunk->referenced, 0);
+    root_chunk_clear_residency_pinned_locked(pmm, root_chunk);
 }
 
-static void root_chunk_update_eviction_list(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, struct list_head *list)
+static void root_chunk_update_eviction_list(uvm_pmm_gpu_t *pmm,
+                                            uvm_gpu_chunk_t *chunk,
+                                            struct list_head *list,
+                                            bool residency_pinned)
 {
-    uvm_spin_lock(&pmm->list_lock);
+    uvm_gpu_root_chunk_t *root_chunk = root_chunk_from_chunk(pmm, chunk);
+
+    pmm_list_lock(pmm);
 
     UVM_ASSERT(uvm_gpu_chunk_get_size(chunk) == UVM_CHUNK_SIZE_MAX);
     UVM_ASSERT(chunk->type == UVM_PMM_GPU_MEMORY_TYPE_USER);
     UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_ALLOCATED ||
                chunk->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED);
 
+    // Chunks selected for eviction are about to be freed, don't let them take
+    // a slot of the quota.
+    if (!chunk_is_in_eviction(pmm, chunk)) {
+        if (!residency_pinned) {
+            root_chunk_clear_residency_pinned_locked(pmm, root_chunk);
+        }
+        else if (!root_chunk->residency_pinned &&
+                 pmm->root_chunks.residency_pinned_count < pmm->root_chunks.residency_pinned_max) {
+            root_chunk->residency_pinned = true;
+            ++pmm->root_chunks.residency_pinned_count;
+        }
+
+        if (root_chunk->residency_pinned)
+            list = &pmm->root_chunks.va_block_residency_pinned;
+    }
+
     if (!chunk_is_root_chunk_pinned(pmm, chunk) && !chunk_is_in_eviction(pmm, chunk)) {
         // An unpinned chunk not selected for eviction should be on one of the
         // eviction lists.
         UVM_ASSERT(!list_empty(&chunk->list));
 
-        list_move_tail(&chunk->list, list);
+        list_move_tail(&chunk->list, list);
+    }
+
+    pmm_list_unlock(pmm);
+}
+
+void uvm_pmm_gpu_mark_root_chunk_used(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
+{
+    root_chunk_update_eviction_list(pmm, chunk, &pmm->root_chunks.va_block_used, false);
+}
+
+void uvm_pmm_gpu_mark_root_chunk_residency_pinned(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
+{
+    root_chunk_update_eviction_list(pmm, chunk, &pmm->root_chunks.va_block_used, true);
+}
+
+void uvm_pmm_gpu_mark_root_chunk_unused(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
+{
+    root_chunk_update_eviction_list(pmm, chunk, &pmm->root_chunks.va_block_unused, false);
+}
+
+void uvm_pmm_gpu_mark_root_chunk_referenced(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
+{
+    UVM_ASSERT(chunk->type == UVM_PMM_GPU_MEMORY_TYPE_USER);
+
+    uvm_pmm_gpu_mark_root_chunk_referenced_by_address(pmm, chunk->address);
+}
+
+void uvm_pmm_gpu_mark_root_chunk_referenced_by_address(uvm_pmm_gpu_t *pmm, NvU64 address)
+{
+    uvm_gpu_root_chunk_t *root_chunk;
+
+    if (address >= pmm->gpu->mem_info.max_allocatable_address)
+        return;
+
+    root_chunk = root_chunk_from_address(pmm, address);
+
+    // Avoid dirtying the cache line if the chunk is already referenced
+    if (!atomic_read(&root_chunk->referenced))
+        atomic_set(&root_chunk->referenced, 1);
+}
+
+// Pick a chunk to evict from the head of the used list, giving a second chance
+// to up to uvm_perf_pmm_eviction_clock_scan referenced chunks.
+static uvm_gpu_chunk_t *pick_used_root_chunk_to_evict(uvm_pmm_gpu_t *pmm)
+{
+    uvm_gpu_chunk_t *chunk;
+    unsigned num_scanned = 0;
+
+    uvm_assert_spinlock_locked(&pmm->list_lock);
+
+    while ((chunk = list_first_chunk(&pmm->root_chunks.va_block_used))) {
+        uvm_gpu_root_chunk_t *root_chunk = root_chunk_from_chunk(pmm, chunk);
+
+        if (!atomic_read(&root_chunk->referenced)) {
+            ++pmm->eviction_stats.evicted_cold;
+            break;
+        }
+
+        if (num_scanned++ == uvm_perf_pmm_eviction_clock_scan) {
+            ++pmm->eviction_stats.evicted_referenced;
+            break;
+        }
+
+        atomic_set(&root_chunk->referenced, 0);
+        list_move_tail(&chunk->list, &pmm->root_chunks.va_block_used);
+        ++pmm->eviction_stats.second_chances;
+    }
+
+    return chunk;
+}
+
+static uvm_gpu_root_chunk_t *pick_root_chunk_to_evict(uvm_pmm_gpu_t *pmm)
+{
+    uvm_gpu_chunk_t *chunk;
+
+    pmm_list_lock(pmm);
+
+    // Check if there are root chunks sitting in the free lists. Non-zero
+    // chunks are preferred.
+    chunk = list_first_chunk(find_free_list(pmm,
+                                            UVM_PMM_GPU_MEMORY_TYPE_USER,
+                                            UVM_CHUNK_SIZE_MAX,
+                                            UVM_PMM_LIST_NO_ZERO));
+    if (chunk)
+        UVM_ASSERT(!chunk->is_zero);
+
+    if (!chunk) {
+        chunk = list_first_chunk(find_free_list(pmm,
+                                                UVM_PMM_GPU_MEMORY_TYPE_USER,
+                                                UVM_CHUNK_SIZE_MAX,
+                                                UVM_PMM_LIST_ZERO));
+        if (chunk)
+            UVM_ASSERT(chunk->is_zero);
+    }
+
+    if (!chunk) {
+        chunk = list_first_chunk(&pmm->root_chunks.va_block_unused);
+        if (chunk)
+            ++pmm->eviction_stats.evicted_unused;
+    }
+
+    if (!chunk)
+        chunk = pick_used_root_chunk_to_evict(pmm);
+
+    // Chunks with pinned residency are only evicted as a last resort, so that
+    // allocations keep making forward progress
+    if (!chunk) {
+        chunk = list_first_chunk(&pmm->root_chunks.va_block_residency_pinned);
+        if (chunk)
+            ++pmm->eviction_stats.evicted_residency_pinned;
+    }
+
+    if (chunk)
+        chunk_start_eviction(pmm, chunk);
+
+    pmm_list_unlock(pmm);
+
+    if (chunk)
+        return root_chunk_from_chunk(pmm, chunk);
+    return NULL;
+}
+
+void uvm_pmm_gpu_print_eviction_stats(uvm_pmm_gpu_t *pmm, struct seq_file *s)
+{
+    NvU64 evicted_unused, evicted_cold, evicted_referenced, second_chances;
+    NvU64 evicted_used, evicted_residency_pinned;
+    size_t residency_pinned_count;
+
+    pmm_list_lock(pmm);
+
+    evicted_unused = pmm->eviction_stats.evicted_unused;
+    evicted_cold = pmm->eviction_stats.evicted_cold;
+    evicted_referenced = pmm->eviction_stats.evicted_referenced;
+    second_chances = pmm->eviction_stats.second_chances;
+    evicted_residency_pinned = pmm->eviction_stats.evicted_residency_pinned;
+    residency_pinned_count = pmm->root_chunks.residency_pinned_count;
+
+    pmm_list_unlock(pmm);
+
+    evicted_used = evicted_cold + evicted_referenced;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_eviction_clock_scan                %u\n", uvm_perf_pmm_eviction_clock_scan);
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_evicted_unused                     %llu\n", evicted_unused);
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_evicted_cold                       %llu\n", evicted_cold);
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_evicted_referenced                 %llu\n", evicted_referenced);
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_eviction_second_chances            %llu\n", second_chances);
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_residency_pinned_chunks            %zu/%zu\n",
+                         residency_pinned_count,
+                         pmm->root_chunks.residency_pinned_max);
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_evicted_residency_pinned           %llu\n", evicted_residency_pinned);
+
+    // Fraction of the evictions from the used list that found a chunk not
+    // referenced since its last second chance
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_eviction_cold_hit_rate             %llu%%\n",
+                         evicted_used ? (evicted_cold * 100) / evicted_used : 0);
+
+    if (pmm->background_zero.enabled) {
+        UVM_SEQ_OR_DBG_PRINT(s, "pmm_background_zeroed_chunks           %llu\n",
+                             (NvU64)atomic64_read(&pmm->background_zero.stats.zeroed_chunks));
+        UVM_SEQ_OR_DBG_PRINT(s, "pmm_background_zero_backoffs           %llu\n",
+                             (NvU64)atomic64_read(&pmm->background_zero.stats.backoffs));
+    }
+
+    if (pmm->compaction.enabled) {
+        UVM_SEQ_OR_DBG_PRINT(s, "pmm_compaction_max_used                %u%%\n", uvm_perf_pmm_compaction_max_used);
+        UVM_SEQ_OR_DBG_PRINT(s, "pmm_compaction_runs                    %llu\n",
+                             (NvU64)atomic64_read(&pmm->compaction.stats.runs));
+        UVM_SEQ_OR_DBG_PRINT(s, "pmm_compaction_compacted_chunks        %llu\n",
+                             (NvU64)atomic64_read(&pmm->compaction.stats.compacted_chunks));
+        UVM_SEQ_OR_DBG_PRINT(s, "pmm_compaction_evicted                 %llu MBs\n",
+                             (NvU64)atomic64_read(&pmm->compaction.stats.evicted_bytes) / (1024 * 1024));
+        UVM_SEQ_OR_DBG_PRINT(s, "pmm_compaction_failed_passes           %llu\n",
+                             (NvU64)atomic64_read(&pmm->compaction.stats.failed_passes));
+    }
+
+    if (!pmm->pre_eviction.enabled)
+        return;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_pre_eviction_low_watermark         %llu MBs\n",
+                         pmm->pre_eviction.low_watermark / (1024 * 1024));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_pre_eviction_high_watermark        %llu MBs\n",
+                         pmm->pre_eviction.high_watermark / (1024 * 1024));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_pre_eviction_wakeups               %llu\n",
+                         (NvU64)atomic64_read(&pmm->pre_eviction.stats.wakeups));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_pre_eviction_evicted_chunks        %llu\n",
+                         (NvU64)atomic64_read(&pmm->pre_eviction.stats.evicted_chunks));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_pre_eviction_failed_passes         %llu\n",
+                         (NvU64)atomic64_read(&pmm->pre_eviction.stats.failed_passes));
+}
+
+static NV_STATUS pick_and_evict_root_chunk(uvm_pmm_gpu_t *pmm,
+                                           uvm_pmm_gpu_memory_type_t type,
+                                           uvm_pmm_context_t pmm_context,
+                                           uvm_gpu_chunk_t **out_chunk)
+{
+    NV_STATUS status;
+    uvm_gpu_chunk_t *chunk;
+    uvm_gpu_root_chunk_t *root_chunk;
+
+    UVM_ASSERT(uvm_gpu_supports_eviction(pmm->gpu));
+
+    uvm_assert_mutex_locked(&pmm->lock);
+
+    root_chunk = pick_root_chunk_to_evict(pmm);
+    if (!root_chunk)
+        return NV_ERR_NO_MEMORY;
+
+    status = evict_root_chunk(pmm, root_chunk, pmm_context);
+    if (status != NV_OK)
+        return status;
+
+    chunk = &root_chunk->chunk;
+
+    if (type == UVM_PMM_GPU_MEMORY_TYPE_KERNEL) {
+        NvU32 flags = 0;
+        if (pmm_context == PMM_CONTEXT_PMA_EVICTION)
+            flags |= UVM_PMA_CALLED_FROM_PMA_EVICTION;
+
+        // Transitioning user memory type to kernel memory type requires pinning
+        // it so that PMA doesn't pick it for eviction.
+        status = nvUvmInterfacePmaPinPages(pmm->pma,
+                                           &chunk->address,
+                                           1,
+                                           UVM_CHUNK_SIZE_MAX,
+                                           flags);
+        if (status == NV_ERR_IN_USE) {
+            // Pinning can fail if some of the pages have been chosen for
+            // eviction already. In that case free the root chunk back to PMA
+            // and let the caller retry.
+            free_root_chunk(pmm, root_chunk, free_root_chunk_mode_from_pmm_context(pmm_context));
+
+            return status;
+        }
+
+        UVM_ASSERT_MSG(status == NV_OK,
+                       "pmaPinPages(root_chunk=0x%llx) failed unexpectedly: %s\n",
+                       chunk->address,
+                       nvstatusToString(status));
+
+        // Unmap any indirect peer physical mappings for this chunk, since
+        // kernel chunks generally don't need them.
+        root_chunk_lock(pmm, root_chunk);
+        root_chunk_unmap_indirect_peers(pmm, root_chunk);
+        root_chunk_unlock(pmm, root_chunk);
+
+        pmm_list_lock(pmm);
+        chunk->type = UVM_PMM_GPU_MEMORY_TYPE_KERNEL;
+        pmm_list_unlock(pmm);
+    }
+
+    *out_chunk = chunk;
+    return NV_OK;
+}
+
+static NV_STATUS pick_and_evict_root_chunk_retry(uvm_pmm_gpu_t *pmm,
+                                                 uvm_pmm_gpu_memory_type_t type,
+                                                 uvm_pmm_context_t pmm_context,
+                                                 uvm_gpu_chunk_t **out_chunk)
+{
+    NV_STATUS status;
+
+    // Eviction can fail if the chunk gets selected for PMA eviction at
+    // the same time. Keep retrying.
+    do {
+        status = pick_and_evict_root_chunk(pmm, type, pmm_context, out_chunk);
+    } while (status == NV_ERR_IN_USE);
+
+    return status;
+}
+
+static uvm_gpu_chunk_t *find_free_chunk_locked(uvm_pmm_gpu_t *pmm,
+                                               uvm_pmm_gpu_memory_type_t type,
+                                               uvm_chunk_size_t chunk_size,
+                                               uvm_pmm_list_zero_t zero_type)
+{
+    struct list_head *free_list = find_free_list(pmm, type, chunk_size, zero_type);
+    uvm_gpu_chunk_t *tmp, *chunk;
+
+    uvm_assert_spinlock_locked(&pmm->list_lock);
+
+    list_for_each_entry_safe(chunk, tmp, free_list, list) {
+        if (zero_type == UVM_PMM_LIST_ZERO)
+            UVM_ASSERT(chunk->is_zero);
+        else
+            UVM_ASSERT(!chunk->is_zero);
+
+        if (chunk_is_in_eviction(pmm, chunk)) {
+            // Remove chunks that have been picked for eviction from the free
+            // lists. The eviction path does it with pin_free_chunks_func(),
+            // but there is a window between when a root chunk is chosen for
+            // eviction and all of its subchunks are removed from free lists.
+            list_del_init(&chunk->list);
+        }
+        else {
+            // Bug 2085760: When NUMA GPU is enabled, also check that the root
+            // chunk containing the candidate free chunk doesn't have any page
+            // escaped to another driver. If that is the case, just skip such
+            // chunk hoping that the page will eventually lose the extra
+            // reference.
+            // References can only be added when a virtual mapping to the page
+            // exists, so once a chunk in the free list has no elevated pages
+            // the chunk is safe to reuse.
+            if (!root_chunk_has_elevated_page(pmm, root_chunk_from_chunk(pmm, chunk)))
+                return chunk;
+        }
+    }
+
+    return NULL;
+}
+
+static uvm_gpu_chunk_t *claim_free_chunk_locked(uvm_pmm_gpu_t *pmm,
+                                                uvm_pmm_gpu_memory_type_t type,
+                                                uvm_chunk_size_t chunk_size)
+{
+    uvm_gpu_chunk_t *chunk;
+
+    uvm_assert_spinlock_locked(&pmm->list_lock);
+
+    // Prefer zero free chunks as they are likely going to be used for a new
+    // allocation.
+    //
+    // TODO: Bug 2446832: Allow callers to request non-zero chunks in PMM
+    // allocation functions, so we don't waste zero chunks.
+    chunk = find_free_chunk_locked(pmm, type, chunk_size, UVM_PMM_LIST_ZERO);
+
+    if (!chunk)
+        chunk = find_free_chunk_locked(pmm, type, chunk_size, UVM_PMM_LIST_NO_ZERO);
+
+    if (!chunk)
+        return NULL;
+
+    UVM_ASSERT_MSG(uvm_gpu_chunk_get_size(chunk) == chunk_size, "chunk size %u expected %u\n",
+            uvm_gpu_chunk_get_size(chunk), chunk_size);
+    UVM_ASSERT(chunk->type == type);
+    UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_FREE);
+    UVM_ASSERT(!chunk_is_in_eviction(pmm, chunk));
+
+    if (chunk->parent) {
+        UVM_ASSERT(chunk->parent->suballoc);
+        UVM_ASSERT(chunk->parent->type == type);
+        UVM_ASSERT(chunk->parent->suballoc->allocated < num_subchunks(chunk->parent));
+        chunk->parent->suballoc->allocated++;
+    }
+
+    chunk_pin(pmm, chunk);
+    chunk_update_lists_locked(pmm, chunk);
+
+    return chunk;
+}
+
+static uvm_gpu_chunk_t *claim_free_chunk(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type, uvm_chunk_size_t chunk_size)
+{
+    uvm_gpu_chunk_t *chunk;
+
+    pmm_list_lock(pmm);
+    chunk = claim_free_chunk_locked(pmm, type, chunk_size);
+    pmm_list_unlock(pmm);
+
+    return chunk;
+}
+
+// Return the index of the chunk size within the sizes mask, or -1 if it's not
+// part of the mask.
+static int chunk_size_class(uvm_chunk_sizes_mask_t sizes, uvm_chunk_size_t chunk_size)
+{
+    if (!(sizes & chunk_size))
+        return -1;
+
+    return hweight_long(sizes & (chunk_size - 1));
+}
+
+// Return the size class of the chunk size in the magazines, or -1 if chunks of
+// that size are not cached.
+static int magazine_class(uvm_pmm_gpu_t *pmm, uvm_chunk_size_t chunk_size)
+{
+    return chunk_size_class(pmm->magazines.sizes, chunk_size);
+}
+
+static uvm_pmm_gpu_magazine_t *magazine_get(uvm_pmm_gpu_t *pmm)
+{
+    // The magazine lock makes it safe to use the magazine after migrating to
+    // a different CPU, the CPU only selects the magazine.
+    int cpu = get_cpu();
+    put_cpu();
+
+    return &pmm->magazines.array[cpu];
+}
+
+// Claim up to max_chunks free kernel chunks of the given size with a single
+// acquisition of the list lock. The chunks are returned in the allocated state.
+static size_t claim_free_chunks_allocated(uvm_pmm_gpu_t *pmm,
+                                          uvm_chunk_size_t chunk_size,
+                                          uvm_gpu_chunk_t **chunks,
+                                          size_t max_chunks)
+{
+    size_t num_chunks = 0;
+
+    pmm_list_lock(pmm);
+
+    while (num_chunks < max_chunks) {
+        uvm_gpu_chunk_t *chunk = claim_free_chunk_locked(pmm, UVM_PMM_GPU_MEMORY_TYPE_KERNEL, chunk_size);
+        if (!chunk)
+            break;
+
+        chunk_unpin(pmm, chunk, UVM_PMM_GPU_CHUNK_STATE_ALLOCATED);
+        chunks[num_chunks++] = chunk;
+    }
+
+    pmm_list_unlock(pmm);
+
+    return num_chunks;
+}
+
+// Allocate up to num_chunks kernel chunks from the magazine of the current CPU,
+// refilling it from the free lists if needed. The chunks are returned in the
+// allocated state. Returns the number of chunks allocated, the rest have to be
+// allocated with uvm_pmm_gpu_alloc().
+static size_t magazine_alloc(uvm_pmm_gpu_t *pmm, uvm_chunk_size_t chunk_size, uvm_gpu_chunk_t **chunks, size_t num_chunks)
+{
+    uvm_gpu_chunk_t *refill[UVM_PMM_MAGAZINE_DEPTH_MAX];
+    uvm_pmm_gpu_magazine_t *magazine;
+    size_t num_cached = 0;
+    size_t num_refill;
+    size_t i;
+    int class;
+
+    if (!pmm->magazines.array || num_chunks == 0)
+        return 0;
+
+    class = magazine_class(pmm, chunk_size);
+    if (class < 0)
+        return 0;
+
+    magazine = magazine_get(pmm);
+
+    uvm_spin_lock(&magazine->lock);
+
+    while (num_cached < num_chunks && magazine->count[class] > 0)
+        chunks[num_cached++] = magazine->chunks[class][--magazine->count[class]];
+
+    uvm_spin_unlock(&magazine->lock);
+
+    atomic64_add(num_cached, &pmm->magazines.stats.hits);
+
+    if (num_cached == num_chunks)
+        return num_cached;
+
+    // Refill the magazine to half of its depth on top of what's still needed,
+    // so that a few more allocations don't need the list lock.
+    num_refill = min(num_chunks - num_cached + pmm->magazines.depth / 2, (size_t)pmm->magazines.depth);
+    num_refill = claim_free_chunks_allocated(pmm, chunk_size, refill, num_refill);
+
+    for (i = 0; i < num_refill && num_cached < num_chunks; ++i)
+        chunks[num_cached++] = refill[i];
+
+    atomic64_add(i, &pmm->magazines.stats.refills);
+    atomic64_add(num_chunks - num_cached, &pmm->magazines.stats.misses);
+
+    uvm_spin_lock(&magazine->lock);
+
+    while (i < num_refill && magazine->count[class] < pmm->magazines.depth)
+        magazine->chunks[class][magazine->count[class]++] = refill[i++];
+
+    uvm_spin_unlock(&magazine->lock);
+
+    // The magazine could have been refilled concurrently, return what doesn't
+    // fit to the free lists.
+    for (; i < num_refill; ++i)
+        free_chunk(pmm, refill[i]);
+
+    return num_cached;
+}
+
+// Cache the freed kernel chunk in the magazine of the current CPU. If the
+// magazine is full, its older half is returned to the free lists first.
+// Returns false if the chunk can't be cached and has to be freed with
+// free_chunk().
+static bool magazine_free(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
+{
+    uvm_gpu_chunk_t *flush[UVM_PMM_MAGAZINE_DEPTH_MAX];
+    uvm_pmm_gpu_magazine_t *magazine;
+    NvU32 num_flush = 0;
+    NvU32 i;
+    int class;
+
+    if (!pmm->magazines.array)
+        return false;
+
+    if (chunk->type != UVM_PMM_GPU_MEMORY_TYPE_KERNEL || chunk->state != UVM_PMM_GPU_CHUNK_STATE_ALLOCATED)
+        return false;
+
+    class = magazine_class(pmm, uvm_gpu_chunk_get_size(chunk));
+    if (class < 0)
+        return false;
+
+    UVM_ASSERT(check_chunk(pmm, chunk));
+
+    magazine = magazine_get(pmm);
+
+    uvm_spin_lock(&magazine->lock);
+
+    if (magazine->count[class] == pmm->magazines.depth) {
+        num_flush = max(pmm->magazines.depth / 2, 1u);
+
+        memcpy(flush, magazine->chunks[class], num_flush * sizeof(flush[0]));
+        magazine->count[class] -= num_flush;
+        memmove(magazine->chunks[class],
+                magazine->chunks[class] + num_flush,
+                magazine->count[class] * sizeof(flush[0]));
+    }
+
+    magazine->chunks[class][magazine->count[class]++] = chunk;
+
+    uvm_spin_unlock(&magazine->lock);
+
+    for (i = 0; i < num_flush; ++i)
+        free_chunk(pmm, flush[i]);
+
+    atomic64_add(num_flush, &pmm->magazines.stats.flushes);
+
+    return true;
+}
+
+// Return all the chunks cached in the magazines to the free lists. Returns the
+// number of chunks flushed.
+static size_t magazines_flush(uvm_pmm_gpu_t *pmm)
+{
+    size_t num_flushed = 0;
+    unsigned cpu;
+
+    if (!pmm->magazines.array)
+        return 0;
+
+    for (cpu = 0; cpu < nr_cpu_ids; ++cpu) {
+        uvm_pmm_gpu_magazine_t *magazine = &pmm->magazines.array[cpu];
+        int class;
+
+        for (class = 0; class < UVM_PMM_MAGAZINE_CLASSES_MAX; ++class) {
+            uvm_gpu_chunk_t *flush[UVM_PMM_MAGAZINE_DEPTH_MAX];
+            NvU32 num_flush;
+            NvU32 i;
+
+            uvm_spin_lock(&magazine->lock);
+
+            num_flush = magazine->count[class];
+            memcpy(flush, magazine->chunks[class], num_flush * sizeof(flush[0]));
+            magazine->count[class] = 0;
+
+            uvm_spin_unlock(&magazine->lock);
+
+            for (i = 0; i < num_flush; ++i)
+                free_chunk(pmm, flush[i]);
+
+            num_flushed += num_flush;
+        }
+    }
+
+    atomic64_add(num_flushed, &pmm->magazines.stats.flushes);
+
+    return num_flushed;
+}
+
+static NV_STATUS magazines_init(uvm_pmm_gpu_t *pmm)
+{
+    uvm_chunk_sizes_mask_t kernel_sizes = pmm->chunk_sizes[UVM_PMM_GPU_MEMORY_TYPE_KERNEL];
+    uvm_chunk_size_t chunk_size;
+    unsigned cpu;
+
+    if (uvm_perf_pmm_magazine_depth == 0 || pmm->gpu->mem_info.size == 0)
+        return NV_OK;
+
+    if (uvm_perf_pmm_magazine_depth > UVM_PMM_MAGAZINE_DEPTH_MAX) {
+        pr_info("Invalid value %u for uvm_perf_pmm_magazine_depth. Using %u instead\n",
+                uvm_perf_pmm_magazine_depth,
+                UVM_PMM_MAGAZINE_DEPTH_MAX);
+        uvm_perf_pmm_magazine_depth = UVM_PMM_MAGAZINE_DEPTH_MAX;
+    }
+
+    // Cache the smallest kernel chunk sizes, which are the ones used for page
+    // tables
+    for_each_chunk_size(chunk_size, kernel_sizes) {
+        if (chunk_size > UVM_PMM_MAGAZINE_CHUNK_SIZE_MAX ||
+            hweight_long(pmm->magazines.sizes) == UVM_PMM_MAGAZINE_CLASSES_MAX)
+            break;
+
+        pmm->magazines.sizes |= chunk_size;
+    }
+
+    if (pmm->magazines.sizes == 0)
+        return NV_OK;
+
+    pmm->magazines.array = uvm_kvmalloc_zero(sizeof(*pmm->magazines.array) * nr_cpu_ids);
+    if (!pmm->magazines.array)
+        return NV_ERR_NO_MEMORY;
+
+    for (cpu = 0; cpu < nr_cpu_ids; ++cpu)
+        uvm_spin_lock_init(&pmm->magazines.array[cpu].lock, UVM_LOCK_ORDER_LEAF);
+
+    pmm->magazines.depth = uvm_perf_pmm_magazine_depth;
+
+    return NV_OK;
+}
+
+static void magazines_deinit(uvm_pmm_gpu_t *pmm)
+{
+    if (!pmm->magazines.array)
+        return;
+
+    magazines_flush(pmm);
+
+    uvm_kvfree(pmm->magazines.array);
+    pmm->magazines.array = NULL;
+}
+
+void uvm_pmm_gpu_print_magazine_stats(uvm_pmm_gpu_t *pmm, struct seq_file *s)
+{
+    if (!pmm->magazines.array)
+        return;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_magazine_depth                     %u\n", pmm->magazines.depth);
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_magazine_hits                      %llu\n",
+                         (NvU64)atomic64_read(&pmm->magazines.stats.hits));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_magazine_refills                   %llu\n",
+                         (NvU64)atomic64_read(&pmm->magazines.stats.refills));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_magazine_misses                    %llu\n",
+                         (NvU64)atomic64_read(&pmm->magazines.stats.misses));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_magazine_flushes                   %llu\n",
+                         (NvU64)atomic64_read(&pmm->magazines.stats.flushes));
+}
+
+static void page_table_reserve_schedule(uvm_pmm_gpu_t *pmm)
+{
+    if (!pmm->page_table_reserve.enabled)
+        return;
+
+    nv_kthread_q_schedule_q_item(&pmm->page_table_reserve.q, &pmm->page_table_reserve.q_item);
+}
+
+// Take num_chunks kernel chunks from the page table reserve. The chunks are
+// returned in the allocated state. Either all the chunks are allocated or none
+// are, in which case false is returned. Either way the reserve gets refilled in
+// the background.
+static bool page_table_reserve_alloc(uvm_pmm_gpu_t *pmm,
+                                     uvm_chunk_size_t chunk_size,
+                                     uvm_gpu_chunk_t **chunks,
+                                     size_t num_chunks)
+{
+    int class;
+    bool allocated = false;
+
+    if (!pmm->page_table_reserve.enabled || num_chunks == 0)
+        return false;
+
+    class = chunk_size_class(pmm->page_table_reserve.sizes, chunk_size);
+    if (class < 0)
+        return false;
+
+    uvm_spin_lock(&pmm->page_table_reserve.lock);
+
+    if (pmm->page_table_reserve.count[class] >= num_chunks) {
+        size_t i;
+
+        for (i = 0; i < num_chunks; ++i)
+            chunks[i] = pmm->page_table_reserve.chunks[class][--pmm->page_table_reserve.count[class]];
+
+        allocated = true;
+    }
+
+    uvm_spin_unlock(&pmm->page_table_reserve.lock);
+
+    if (allocated)
+        atomic64_add(num_chunks, &pmm->page_table_reserve.stats.hits);
+    else
+        atomic64_inc(&pmm->page_table_reserve.stats.empty);
+
+    page_table_reserve_schedule(pmm);
+
+    return allocated;
+}
+
+static void page_table_reserve_worker(uvm_pmm_gpu_t *pmm)
+{
+    uvm_chunk_size_t chunk_size;
+
+    // Don't race with suspend, the next allocation from the reserve after
+    // resume schedules the item again
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+        return;
+
+    for_each_chunk_size(chunk_size, pmm->page_table_reserve.sizes) {
+        int class = chunk_size_class(pmm->page_table_reserve.sizes, chunk_size);
+
+        while (!atomic_read(&pmm->page_table_reserve.stopping)) {
+            NV_STATUS status;
+            uvm_gpu_chunk_t *chunk;
+            bool full;
+
+            if (uvm_global_get_status() != NV_OK)
+                goto out;
+
+            uvm_spin_lock(&pmm->page_table_reserve.lock);
+            full = pmm->page_table_reserve.count[class] == pmm->page_table_reserve.target;
+            uvm_spin_unlock(&pmm->page_table_reserve.lock);
+
+            if (full)
+                break;
+
+            // The thread is the only one adding chunks to the reserve, so it
+            // can only drain while the chunk is being allocated. The
+            // allocation waits for the chunk's tracker.
+            status = uvm_pmm_gpu_alloc(pmm,
+                                       1,
+                                       chunk_size,
+                                       UVM_PMM_GPU_MEMORY_TYPE_KERNEL,
+                                       UVM_PMM_ALLOC_FLAGS_EVICT,
+                                       &chunk,
+                                       NULL);
+            if (status != NV_OK)
+                goto out;
+
+            pmm_list_lock(pmm);
+            chunk_unpin(pmm, chunk, UVM_PMM_GPU_CHUNK_STATE_ALLOCATED);
+            pmm_list_unlock(pmm);
+
+            uvm_spin_lock(&pmm->page_table_reserve.lock);
+            UVM_ASSERT(pmm->page_table_reserve.count[class] < pmm->page_table_reserve.target);
+            pmm->page_table_reserve.chunks[class][pmm->page_table_reserve.count[class]++] = chunk;
+            uvm_spin_unlock(&pmm->page_table_reserve.lock);
+
+            atomic64_inc(&pmm->page_table_reserve.stats.refills);
+        }
+    }
+
+out:
+    uvm_up_read(&g_uvm_global.pm.lock);
+}
+
+static void page_table_reserve_worker_entry(void *args)
+{
+    UVM_ENTRY_VOID(page_table_reserve_worker((uvm_pmm_gpu_t *)args));
+}
+
+static NV_STATUS page_table_reserve_init(uvm_pmm_gpu_t *pmm)
+{
+    NV_STATUS status;
+    uvm_chunk_sizes_mask_t kernel_sizes = pmm->chunk_sizes[UVM_PMM_GPU_MEMORY_TYPE_KERNEL];
+    uvm_chunk_size_t chunk_size;
+
+    if (uvm_perf_pmm_page_table_reserve == 0 || pmm->gpu->mem_info.size == 0)
+        return NV_OK;
+
+    if (uvm_perf_pmm_page_table_reserve > UVM_PMM_PAGE_TABLE_RESERVE_MAX) {
+        pr_info("Invalid value %u for uvm_perf_pmm_page_table_reserve. Using %u instead\n",
+                uvm_perf_pmm_page_table_reserve,
+                UVM_PMM_PAGE_TABLE_RESERVE_MAX);
+        uvm_perf_pmm_page_table_reserve = UVM_PMM_PAGE_TABLE_RESERVE_MAX;
+    }
+
+    // Reserve the same small kernel chunk sizes as the magazines, page tables
+    // and directories are allocated with those
+    for_each_chunk_size(chunk_size, kernel_sizes) {
+        if (chunk_size > UVM_PMM_MAGAZINE_CHUNK_SIZE_MAX ||
+            hweight_long(pmm->page_table_reserve.sizes) == UVM_PMM_MAGAZINE_CLASSES_MAX)
+            break;
+
+        pmm->page_table_reserve.sizes |= chunk_size;
+    }
+
+    if (pmm->page_table_reserve.sizes == 0)
+        return NV_OK;
+
+    uvm_spin_lock_init(&pmm->page_table_reserve.lock, UVM_LOCK_ORDER_LEAF);
+    pmm->page_table_reserve.target = uvm_perf_pmm_page_table_reserve;
+    atomic_set(&pmm->page_table_reserve.stopping, 0);
+    nv_kthread_q_item_init(&pmm->page_table_reserve.q_item, page_table_reserve_worker_entry, pmm);
+
+    status = errno_to_nv_status(nv_kthread_q_init(&pmm->page_table_reserve.q, "UVM GPU PT reserve"));
+    if (status != NV_OK)
+        return status;
+
+    pmm->page_table_reserve.enabled = true;
+
+    // Fill the reserve right away, before the first faults
+    page_table_reserve_schedule(pmm);
+
+    return NV_OK;
+}
+
+static void page_table_reserve_stop(uvm_pmm_gpu_t *pmm)
+{
+    if (!pmm->page_table_reserve.enabled)
+        return;
+
+    atomic_set(&pmm->page_table_reserve.stopping, 1);
+
+    pmm->page_table_reserve.enabled = false;
+    nv_kthread_q_stop(&pmm->page_table_reserve.q);
+}
+
+// Return the reserved chunks to the free lists. Has to be called after the
+// thread is stopped.
+static void page_table_reserve_deinit(uvm_pmm_gpu_t *pmm)
+{
+    int class;
+
+    UVM_ASSERT(!pmm->page_table_reserve.enabled);
+
+    for (class = 0; class < UVM_PMM_MAGAZINE_CLASSES_MAX; ++class) {
+        while (pmm->page_table_reserve.count[class] > 0)
+            free_chunk(pmm, pmm->page_table_reserve.chunks[class][--pmm->page_table_reserve.count[class]]);
+    }
+}
+
+void uvm_pmm_gpu_print_page_table_reserve_stats(uvm_pmm_gpu_t *pmm, struct seq_file *s)
+{
+    if (!pmm->page_table_reserve.enabled)
+        return;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_page_table_reserve                 %u\n", pmm->page_table_reserve.target);
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_page_table_reserve_hits            %llu\n",
+                         (NvU64)atomic64_read(&pmm->page_table_reserve.stats.hits));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_page_table_reserve_refills         %llu\n",
+                         (NvU64)atomic64_read(&pmm->page_table_reserve.stats.refills));
+    UVM_SEQ_OR_DBG_PRINT(s, "pmm_page_table_reserve_empty           %llu\n",
+                         (NvU64)atomic64_read(&pmm->page_table_reserve.stats.empty));
+}
+
+NV_STATUS uvm_pmm_gpu_lock_stats_start(uvm_pmm_gpu_t *pmm)
+{
+    NV_STATUS status = NV_OK;
+
+    // The statistics are not recorded for these holds, since they are cleared
+    // under the locks
+    uvm_mutex_lock(&pmm->lock);
+    uvm_spin_lock(&pmm->list_lock);
+
+    if (pmm->lock_stats.enabled) {
+        status = NV_ERR_BUSY_RETRY;
+    }
+    else {
+        memset(&pmm->lock_stats.lock, 0, sizeof(pmm->lock_stats.lock));
+        memset(&pmm->lock_stats.list_lock, 0, sizeof(pmm->lock_stats.list_lock));
+        WRITE_ONCE(pmm->lock_stats.enabled, true);
+    }
+
+    uvm_spin_unlock(&pmm->list_lock);
+    uvm_mutex_unlock(&pmm->lock);
+
+    return status;
+}
+
+void uvm_pmm_gpu_lock_stats_stop(uvm_pmm_gpu_t *pmm,
+                                 uvm_pmm_gpu_lock_stats_t *lock_stats,
+                                 uvm_pmm_gpu_lock_stats_t *list_lock_stats)
+{
+    uvm_mutex_lock(&pmm->lock);
+    uvm_spin_lock(&pmm->list_lock);
+
+    UVM_ASSERT(pmm->lock_stats.enabled);
+    WRITE_ONCE(pmm->lock_stats.enabled, false);
+
+    *lock_stats = pmm->lock_stats.lock;
+    *list_lock_stats = pmm->lock_stats.list_lock;
+
+    uvm_spin_unlock(&pmm->list_lock);
+    uvm_mutex_unlock(&pmm->lock);
+}
+
+void uvm_pmm_gpu_count_free_chunks(uvm_pmm_gpu_t *pmm,
+                                   uvm_pmm_gpu_memory_type_t type,
+                                   NvU64 free_chunks[UVM_CHUNK_SIZE_ORDERS])
+{
+    uvm_chunk_size_t chunk_size;
+    uvm_pmm_list_zero_t zero_type;
+    struct list_head *entry;
+
+    BUILD_BUG_ON(UVM_CHUNK_SIZE_ORDERS != ilog2(UVM_CHUNK_SIZE_MAX) + 1);
+
+    memset(free_chunks, 0, UVM_CHUNK_SIZE_ORDERS * sizeof(free_chunks[0]));
+
+    pmm_list_lock(pmm);
+
+    for_each_chunk_size(chunk_size, pmm->chunk_sizes[type]) {
+        for (zero_type = 0; zero_type < UVM_PMM_LIST_ZERO_COUNT; zero_type++) {
+            list_for_each(entry, find_free_list(pmm, type, chunk_size, zero_type))
+                ++free_chunks[ilog2(chunk_size)];
+        }
+    }
+
+    pmm_list_unlock(pmm);
+}
+
+static NvU64 pma_free_memory(uvm_pmm_gpu_t *pmm)
+{
+    return UVM_READ_ONCE(pmm->pma_stats->numFreePages64k) * UVM_PAGE_SIZE_64K;
+}
+
+// Wake up the background eviction thread if the free memory dropped below the
+// low watermark. Scheduling an already pending item is a no-op, so this is
+// cheap enough to be called on every root chunk allocation.
+static void pre_eviction_check(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type)
+{
+    if (!pmm->pre_eviction.enabled || type != UVM_PMM_GPU_MEMORY_TYPE_USER)
+        return;
+
+    if (pma_free_memory(pmm) >= pmm->pre_eviction.low_watermark)
+        return;
+
+    nv_kthread_q_schedule_q_item(&pmm->pre_eviction.q, &pmm->pre_eviction.q_item);
+}
+
+static void pre_eviction_worker(uvm_pmm_gpu_t *pmm)
+{
+    NvU64 free_memory;
+    NvU64 num_chunks;
+    evicted_root_chunks_t evicted = {0};
+
+    // Don't race with suspend, the thread will be woken up again by the next
+    // allocation after resume.
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+        return;
+
+    atomic64_inc(&pmm->pre_eviction.stats.wakeups);
+
+    free_memory = pma_free_memory(pmm);
+    if (free_memory >= pmm->pre_eviction.high_watermark)
+        goto out;
+
+    // Only evict as much as needed to get to the high watermark at the time of
+    // the wakeup. Memory freed up by the thread can be allocated by others
+    // right away, and the thread shouldn't keep evicting on their behalf.
+    num_chunks = DIV_ROUND_UP(pmm->pre_eviction.high_watermark - free_memory, UVM_CHUNK_SIZE_MAX);
+
+    while (num_chunks-- > 0 && pma_free_memory(pmm) < pmm->pre_eviction.high_watermark) {
+        NV_STATUS status;
+        uvm_gpu_root_chunk_t *root_chunk;
+
+        if (uvm_global_get_status() != NV_OK)
+            break;
+
+        root_chunk = pick_root_chunk_to_evict(pmm);
+        if (!root_chunk) {
+            atomic64_inc(&pmm->pre_eviction.stats.failed_passes);
+            break;
+        }
+
+        pmm_lock(pmm);
+        status = evict_root_chunk(pmm, root_chunk, PMM_CONTEXT_DEFAULT);
+        pmm_unlock(pmm);
+
+        if (status != NV_OK) {
+            atomic64_inc(&pmm->pre_eviction.stats.failed_passes);
+            break;
+        }
+
+        atomic64_inc(&pmm->pre_eviction.stats.evicted_chunks);
+
+        // Return the evicted root chunks to PMA once a batch of them has its
+        // copy-outs in flight
+        if (evicted_root_chunks_add(&evicted, root_chunk))
+            evicted_root_chunks_free(pmm, &evicted, true, FREE_ROOT_CHUNK_MODE_DEFAULT);
+    }
+
+    evicted_root_chunks_free(pmm, &evicted, true, FREE_ROOT_CHUNK_MODE_DEFAULT);
+
+out:
+    uvm_up_read(&g_uvm_global.pm.lock);
+}
+
+static void pre_eviction_worker_entry(void *args)
+{
+    UVM_ENTRY_VOID(pre_eviction_worker((uvm_pmm_gpu_t *)args));
+}
+
+static NV_STATUS pre_eviction_init(uvm_pmm_gpu_t *pmm)
+{
+    NV_STATUS status;
+    unsigned low = min(uvm_perf_pmm_pre_eviction_low_watermark, (unsigned)UVM_PERF_PMM_PRE_EVICTION_WATERMARK_MAX);
+    unsigned high = min(uvm_perf_pmm_pre_eviction_high_watermark, (unsigned)UVM_PERF_PMM_PRE_EVICTION_WATERMARK_MAX);
+
+    if (low == 0 || pmm->gpu->mem_info.size == 0 || !uvm_gpu_supports_eviction(pmm->gpu))
+        return NV_OK;
+
+    if (low != uvm_perf_pmm_pre_eviction_low_watermark) {
+        pr_info("Invalid value %u for uvm_perf_pmm_pre_eviction_low_watermark. Using %u instead\n",
+                uvm_perf_pmm_pre_eviction_low_watermark,
+                low);
+    }
+
+    if (high <= low) {
+        unsigned new_high = min(2 * low, (unsigned)UVM_PERF_PMM_PRE_EVICTION_WATERMARK_MAX);
+
+        // With the low watermark at the maximum, the thread evicts up to it
+        if (new_high <= low)
+            new_high = low;
+
+        pr_info("Invalid value %u for uvm_perf_pmm_pre_eviction_high_watermark. Using %u instead\n",
+                uvm_perf_pmm_pre_eviction_high_watermark,
+                new_high);
+        high = new_high;
+    }
+
+    pmm->pre_eviction.low_watermark = (pmm->gpu->mem_info.size / 100) * low;
+    pmm->pre_eviction.high_watermark = (pmm->gpu->mem_info.size / 100) * high;
+
+    nv_kthread_q_item_init(&pmm->pre_eviction.q_item, pre_eviction_worker_entry, pmm);
+
+    status = errno_to_nv_status(nv_kthread_q_init(&pmm->pre_eviction.q, "UVM GPU pre-evict"));
+    if (status != NV_OK)
+        return status;
+
+    pmm->pre_eviction.enabled = true;
+
+    return NV_OK;
+}
+
+static void pre_eviction_deinit(uvm_pmm_gpu_t *pmm)
+{
+    if (!pmm->pre_eviction.enabled)
+        return;
+
+    pmm->pre_eviction.enabled = false;
+    nv_kthread_q_stop(&pmm->pre_eviction.q);
+}
+
+// Schedule the compaction thread after a user root chunk couldn't be allocated
+// from PMA, unless it ran too recently
+static void compaction_schedule(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type)
+{
+    if (!pmm->compaction.enabled || type != UVM_PMM_GPU_MEMORY_TYPE_USER)
+        return;
+
+    if (NV_GETTIME() < (NvU64)atomic64_read(&pmm->compaction.next_run))
+        return;
+
+    nv_kthread_q_schedule_q_item(&pmm->compaction.q, &pmm->compaction.q_item);
+}
+
+static NV_STATUS count_used_chunks_func(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, void *data)
+{
+    NvU64 *used = (NvU64 *)data;
+
+    if (chunk->state == UVM_PMM_GPU_CHUNK_STATE_ALLOCATED || chunk->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED)
+        *used += uvm_gpu_chunk_get_size(chunk);
+
+    return NV_OK;
+}
+
+// Pick the split root chunk with the fewest allocated bytes among the
+// unreferenced ones at the head of the used list, as long as it is below the
+// uvm_perf_pmm_compaction_max_used threshold. The chunk is marked as in
+// eviction and its allocated bytes are returned in out_used.
+static uvm_gpu_root_chunk_t *pick_root_chunk_to_compact(uvm_pmm_gpu_t *pmm, NvU64 *out_used)
+{
+    uvm_gpu_chunk_t *chunk;
+    uvm_gpu_chunk_t *best = NULL;
+    NvU64 best_used = ((NvU64)UVM_CHUNK_SIZE_MAX / 100) * uvm_perf_pmm_compaction_max_used + 1;
+    unsigned num_scanned = 0;
+
+    // Holding the PMM lock prevents chunk splits and merges during the walks
+    uvm_assert_mutex_locked(&pmm->lock);
+
+    pmm_list_lock(pmm);
+
+    list_for_each_entry(chunk, &pmm->root_chunks.va_block_used, list) {
+        uvm_gpu_root_chunk_t *root_chunk = root_chunk_from_chunk(pmm, chunk);
+        NvU64 used = 0;
+
+        if (num_scanned++ == UVM_PMM_COMPACTION_SCAN)
+            break;
+
+        if (chunk->state != UVM_PMM_GPU_CHUNK_STATE_IS_SPLIT || atomic_read(&root_chunk->referenced))
+            continue;
+
+        if (!chunk_is_evictable(pmm, chunk))
+            continue;
+
+        (void)chunk_walk_pre_order(pmm, chunk, count_used_chunks_func, &used);
+        if (used < best_used) {
+            best = chunk;
+            best_used = used;
+        }
+    }
+
+    if (best)
+        chunk_start_eviction(pmm, best);
+
+    pmm_list_unlock(pmm);
+
+    if (!best)
+        return NULL;
+
+    *out_used = best_used;
+    return root_chunk_from_chunk(pmm, best);
+}
+
+static void compaction_worker(uvm_pmm_gpu_t *pmm)
+{
+    unsigned num_chunks;
+
+    // Don't race with suspend, the thread will be scheduled again by the next
+    // allocation failure after resume.
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+        return;
+
+    atomic64_inc(&pmm->compaction.stats.runs);
+
+    for (num_chunks = 0; num_chunks < UVM_PMM_COMPACTION_BATCH; ++num_chunks) {
+        NV_STATUS status;
+        uvm_gpu_root_chunk_t *root_chunk;
+        NvU64 used = 0;
+
+        if (uvm_global_get_status() != NV_OK)
+            break;
+
+        pmm_lock(pmm);
+
+        root_chunk = pick_root_chunk_to_compact(pmm, &used);
+        if (!root_chunk) {
+            pmm_unlock(pmm);
+            break;
+        }
+
+        status = evict_root_chunk(pmm, root_chunk, PMM_CONTEXT_DEFAULT);
+        pmm_unlock(pmm);
+
+        if (status != NV_OK) {
+            atomic64_inc(&pmm->compaction.stats.failed_passes);
+            break;
+        }
+
+        // Return the now fully free root chunk to PMA
+        free_chunk(pmm, &root_chunk->chunk);
+
+        atomic64_inc(&pmm->compaction.stats.compacted_chunks);
+        atomic64_add(used, &pmm->compaction.stats.evicted_bytes);
+    }
+
+    atomic64_set(&pmm->compaction.next_run, NV_GETTIME() + (NvU64)UVM_PMM_COMPACTION_INTERVAL_MS * 1000 * 1000);
+
+    uvm_up_read(&g_uvm_global.pm.lock);
+}
+
+static void compaction_worker_entry(void *args)
+{
+    UVM_ENTRY_VOID(compaction_worker((uvm_pmm_gpu_t *)args));
+}
+
+static NV_STATUS compaction_init(uvm_pmm_gpu_t *pmm)
+{
+    NV_STATUS status;
+
+    if (!uvm_perf_pmm_compaction || pmm->gpu->mem_info.size == 0 || !uvm_gpu_supports_eviction(pmm->gpu))
+        return NV_OK;
+
+    if (uvm_perf_pmm_compaction_max_used == 0 ||
+        uvm_perf_pmm_compaction_max_used > UVM_PERF_PMM_COMPACTION_MAX_USED_MAX) {
+        pr_info("Invalid value %u for uvm_perf_pmm_compaction_max_used. Using %u instead\n",
+                uvm_perf_pmm_compaction_max_used,
+                UVM_PERF_PMM_COMPACTION_MAX_USED_DEFAULT);
+        uvm_perf_pmm_compaction_max_used = UVM_PERF_PMM_COMPACTION_MAX_USED_DEFAULT;
     }
 
-    uvm_spin_unlock(&pmm->list_lock);
+    atomic64_set(&pmm->compaction.next_run, 0);
+    nv_kthread_q_item_init(&pmm->compaction.q_item, compaction_worker_entry, pmm);
+
+    status = errno_to_nv_status(nv_kthread_q_init(&pmm->compaction.q, "UVM GPU compact"));
+    if (status != NV_OK)
+        return status;
+
+    pmm->compaction.enabled = true;
+
+    return NV_OK;
 }
 
-void uvm_pmm_gpu_mark_root_chunk_used(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
+static void compaction_deinit(uvm_pmm_gpu_t *pmm)
 {
-    root_chunk_update_eviction_list(pmm, chunk, &pmm->root_chunks.va_block_used);
+    if (!pmm->compaction.enabled)
+        return;
+
+    pmm->compaction.enabled = false;
+    nv_kthread_q_stop(&pmm->compaction.q);
 }
 
-void uvm_pmm_gpu_mark_root_chunk_unused(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
+static void background_zero_schedule(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type)
 {
-    root_chunk_update_eviction_list(pmm, chunk, &pmm->root_chunks.va_block_unused);
+    if (!pmm->background_zero.enabled || type != UVM_PMM_GPU_MEMORY_TYPE_USER)
+        return;
+
+    nv_kthread_q_schedule_q_item(&pmm->background_zero.q, &pmm->background_zero.q_item);
 }
 
-static uvm_gpu_root_chunk_t *pick_root_chunk_to_evict(uvm_pmm_gpu_t *pmm)
+// Take a root chunk off the non-zero user free list. The chunk is pinned, so it
+// can't be allocated nor targeted by eviction until it is released.
+static uvm_gpu_chunk_t *background_zero_claim_chunk(uvm_pmm_gpu_t *pmm)
 {
     uvm_gpu_chunk_t *chunk;
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
-    // Check if there are root chunks sitting in the free lists. Non-zero
-    // chunks are preferred.
     chunk = list_first_chunk(find_free_list(pmm,
                                             UVM_PMM_GPU_MEMORY_TYPE_USER,
                                             UVM_CHUNK_SIZE_MAX,
                                             UVM_PMM_LIST_NO_ZERO));
-    if (chunk)
+    if (chunk) {
+        UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_FREE);
         UVM_ASSERT(!chunk->is_zero);
 
-    if (!chunk) {
-        chunk = list_first_chunk(find_free_list(pmm,
-                                                UVM_PMM_GPU_MEMORY_TYPE_USER,
-                                                UVM_CHUNK_SIZE_MAX,
-                                                UVM_PMM_LIST_ZERO));
-        if (chunk)
-            UVM_ASSERT(chunk->is_zero);
+        list_del_init(&chunk->list);
+        chunk_pin(pmm, chunk);
     }
 
-    if (!chunk)
-        chunk = list_first_chunk(&pmm->root_chunks.va_block_unused);
+    pmm_list_unlock(pmm);
 
-    // TODO: Bug 1765193: Move the chunks to the tail of the used list whenever
-    // they get mapped.
-    if (!chunk)
-        chunk = list_first_chunk(&pmm->root_chunks.va_block_used);
+    return chunk;
+}
 
-    if (chunk)
-        chunk_start_eviction(pmm, chunk);
+static void background_zero_release_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk, bool is_zero)
+{
+    pmm_list_lock(pmm);
 
-    uvm_spin_unlock(&pmm->list_lock);
+    chunk_unpin(pmm, chunk, UVM_PMM_GPU_CHUNK_STATE_FREE);
+    chunk->is_zero = is_zero;
+    chunk_update_lists_locked(pmm, chunk);
 
-    if (chunk)
-        return root_chunk_from_chunk(pmm, chunk);
-    return NULL;
+    pmm_list_unlock(pmm);
 }
 
-static NV_STATUS pick_and_evict_root_chunk(uvm_pmm_gpu_t *pmm,
-                                           uvm_pmm_gpu_memory_type_t type,
-                                           uvm_pmm_context_t pmm_context,
-                                           uvm_gpu_chunk_t **out_chunk)
+static NV_STATUS background_zero_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 {
     NV_STATUS status;
-    uvm_gpu_chunk_t *chunk;
-    uvm_gpu_root_chunk_t *root_chunk;
-
-    UVM_ASSERT(uvm_gpu_supports_eviction(pmm->gpu));
-
-    uvm_assert_mutex_locked(&pmm->lock);
+    uvm_push_t push;
+    uvm_gpu_t *gpu = pmm->gpu;
+    uvm_gpu_root_chunk_t *root_chunk = root_chunk_from_chunk(pmm, chunk);
+    uvm_tracker_t tracker = UVM_TRACKER_INIT();
 
-    root_chunk = pick_root_chunk_to_evict(pmm);
-    if (!root_chunk)
-        return NV_ERR_NO_MEMORY;
+    // Don't push while holding the root chunk lock, the chunk is pinned so
+    // nobody else adds work to its tracker in the meantime
+    root_chunk_lock(pmm, root_chunk);
+    uvm_tracker_remove_completed(&root_chunk->tracker);
+    status = uvm_tracker_add_tracker_safe(&tracker, &root_chunk->tracker);
+    root_chunk_unlock(pmm, root_chunk);
 
-    status = evict_root_chunk(pmm, root_chunk, pmm_context);
     if (status != NV_OK)
-        return status;
-
-    chunk = &root_chunk->chunk;
+        goto out;
 
-    if (type == UVM_PMM_GPU_MEMORY_TYPE_KERNEL) {
-        NvU32 flags = 0;
-        if (pmm_context == PMM_CONTEXT_PMA_EVICTION)
-            flags |= UVM_PMA_CALLED_FROM_PMA_EVICTION;
+    status = uvm_push_begin_acquire(gpu->channel_manager,
+                                    UVM_CHANNEL_TYPE_GPU_INTERNAL,
+                                    &tracker,
+                                    &push,
+                                    "Background zero of root chunk 0x%llx",
+                                    chunk->address);
+    if (status != NV_OK)
+        goto out;
 
-        // Transitioning user memory type to kernel memory type requires pinning
-        // it so that PMA doesn't pick it for eviction.
-        status = nvUvmInterfacePmaPinPages(pmm->pma,
-                                           &chunk->address,
-                                           1,
-                                           UVM_CHUNK_SIZE_MAX,
-                                           flags);
-        if (status == NV_ERR_IN_USE) {
-            // Pinning can fail if some of the pages have been chosen for
-            // eviction already. In that case free the root chunk back to PMA
-            // and let the caller retry.
-            free_root_chunk(pmm, root_chunk, free_root_chunk_mode_from_pmm_context(pmm_context));
+    gpu->parent->ce_hal->memset_8(&push,
+                                  uvm_gpu_address_physical(UVM_APERTURE_VID, chunk->address),
+                                  0,
+                                  UVM_CHUNK_SIZE_MAX);
 
-            return status;
-        }
+    uvm_push_end(&push);
 
-        UVM_ASSERT_MSG(status == NV_OK,
-                       "pmaPinPages(root_chunk=0x%llx) failed unexpectedly: %s\n",
-                       chunk->address,
-                       nvstatusToString(status));
+    // Users of the chunk wait for the memset through the root chunk tracker,
+    // see uvm_pmm_gpu_alloc()
+    root_chunk_lock(pmm, root_chunk);
+    status = uvm_tracker_add_push_safe(&root_chunk->tracker, &push);
+    root_chunk_unlock(pmm, root_chunk);
 
-        // Unmap any indirect peer physical mappings for this chunk, since
-        // kernel chunks generally don't need them.
-        root_chunk_lock(pmm, root_chunk);
-        root_chunk_unmap_indirect_peers(pmm, root_chunk);
-        root_chunk_unlock(pmm, root_chunk);
+    // The memset is already pushed, so the chunk can't be reported as
+    // non-zero even if the tracker couldn't be updated. Wait for it instead.
+    if (status != NV_OK)
+        status = uvm_push_wait(&push);
 
-        uvm_spin_lock(&pmm->list_lock);
-        chunk->type = UVM_PMM_GPU_MEMORY_TYPE_KERNEL;
-        uvm_spin_unlock(&pmm->list_lock);
-    }
+out:
+    uvm_tracker_deinit(&tracker);
 
-    *out_chunk = chunk;
-    return NV_OK;
+    return status;
 }
 
-static NV_STATUS pick_and_evict_root_chunk_retry(uvm_pmm_gpu_t *pmm,
-                                                 uvm_pmm_gpu_memory_type_t type,
-                                                 uvm_pmm_context_t pmm_context,
-                                                 uvm_gpu_chunk_t **out_chunk)
+static void background_zero_worker(uvm_pmm_gpu_t *pmm)
 {
-    NV_STATUS status;
+    unsigned num_zeroed = 0;
+    unsigned num_backoffs = 0;
+    uvm_channel_manager_t *channel_manager = pmm->gpu->channel_manager;
 
-    // Eviction can fail if the chunk gets selected for PMA eviction at
-    // the same time. Keep retrying.
-    do {
-        status = pick_and_evict_root_chunk(pmm, type, pmm_context, out_chunk);
-    } while (status == NV_ERR_IN_USE);
+    // The channel manager is created after PMM and destroyed after the thread
+    // is stopped
+    if (!channel_manager)
+        return;
 
-    return status;
-}
+    // Don't race with suspend, the next free after resume schedules the item
+    // again
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+        return;
 
-static uvm_gpu_chunk_t *find_free_chunk_locked(uvm_pmm_gpu_t *pmm,
-                                               uvm_pmm_gpu_memory_type_t type,
-                                               uvm_chunk_size_t chunk_size,
-                                               uvm_pmm_list_zero_t zero_type)
-{
-    struct list_head *free_list = find_free_list(pmm, type, chunk_size, zero_type);
-    uvm_gpu_chunk_t *tmp, *chunk;
+    while (num_zeroed < UVM_PMM_BACKGROUND_ZERO_BATCH && !atomic_read(&pmm->background_zero.stopping)) {
+        NV_STATUS status;
+        uvm_gpu_chunk_t *chunk;
 
-    uvm_assert_spinlock_locked(&pmm->list_lock);
+        if (uvm_global_get_status() != NV_OK)
+            break;
 
-    list_for_each_entry_safe(chunk, tmp, free_list, list) {
-        if (zero_type == UVM_PMM_LIST_ZERO)
-            UVM_ASSERT(chunk->is_zero);
-        else
-            UVM_ASSERT(!chunk->is_zero);
+        if (uvm_channel_manager_type_backlog(channel_manager, UVM_CHANNEL_TYPE_GPU_INTERNAL) >
+            uvm_perf_pmm_background_zero_max_backlog) {
+            if (num_backoffs++ == UVM_PMM_BACKGROUND_ZERO_MAX_BACKOFFS)
+                break;
 
-        if (chunk_is_in_eviction(pmm, chunk)) {
-            // Remove chunks that have been picked for eviction from the free
-            // lists. The eviction path does it with pin_free_chunks_func(),
-            // but there is a window between when a root chunk is chosen for
-            // eviction and all of its subchunks are removed from free lists.
-            list_del_init(&chunk->list);
-        }
-        else {
-            // Bug 2085760: When NUMA GPU is enabled, also check that the root
-            // chunk containing the candidate free chunk doesn't have any page
-            // escaped to another driver. If that is the case, just skip such
-            // chunk hoping that the page will eventually lose the extra
-            // reference.
-            // References can only be added when a virtual mapping to the page
-            // exists, so once a chunk in the free list has no elevated pages
-            // the chunk is safe to reuse.
-            if (!root_chunk_has_elevated_page(pmm, root_chunk_from_chunk(pmm, chunk)))
-                return chunk;
+            atomic64_inc(&pmm->background_zero.stats.backoffs);
+            usleep_range(UVM_PMM_BACKGROUND_ZERO_BACKOFF_US, 2 * UVM_PMM_BACKGROUND_ZERO_BACKOFF_US);
+            continue;
         }
+
+        chunk = background_zero_claim_chunk(pmm);
+        if (!chunk)
+            break;
+
+        status = background_zero_chunk(pmm, chunk);
+
+        background_zero_release_chunk(pmm, chunk, status == NV_OK);
+
+        if (status != NV_OK)
+            break;
+
+        atomic64_inc(&pmm->background_zero.stats.zeroed_chunks);
+        ++num_zeroed;
     }
 
-    return NULL;
+    uvm_up_read(&g_uvm_global.pm.lock);
+
+    // Yield to other work between batches, but keep going while there are
+    // chunks left
+    if (num_zeroed == UVM_PMM_BACKGROUND_ZERO_BATCH)
+        background_zero_schedule(pmm, UVM_PMM_GPU_MEMORY_TYPE_USER);
 }
 
-static uvm_gpu_chunk_t *claim_free_chunk(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type, uvm_chunk_size_t chunk_size)
+static void background_zero_worker_entry(void *args)
 {
-    uvm_gpu_chunk_t *chunk;
+    UVM_ENTRY_VOID(background_zero_worker((uvm_pmm_gpu_t *)args));
+}
 
-    uvm_spin_lock(&pmm->list_lock);
+static NV_STATUS background_zero_init(uvm_pmm_gpu_t *pmm)
+{
+    NV_STATUS status;
 
-    // Prefer zero free chunks as they are likely going to be used for a new
-    // allocation.
-    //
-    // TODO: Bug 2446832: Allow callers to request non-zero chunks in PMM
-    // allocation functions, so we don't waste zero chunks.
-    chunk = find_free_chunk_locked(pmm, type, chunk_size, UVM_PMM_LIST_ZERO);
+    if (!uvm_perf_pmm_background_zero || pmm->gpu->mem_info.size == 0)
+        return NV_OK;
 
-    if (!chunk)
-        chunk = find_free_chunk_locked(pmm, type, chunk_size, UVM_PMM_LIST_NO_ZERO);
+    atomic_set(&pmm->background_zero.stopping, 0);
+    nv_kthread_q_item_init(&pmm->background_zero.q_item, background_zero_worker_entry, pmm);
 
-    if (!chunk)
-        goto out;
+    status = errno_to_nv_status(nv_kthread_q_init(&pmm->background_zero.q, "UVM GPU zero"));
+    if (status != NV_OK)
+        return status;
 
-    UVM_ASSERT_MSG(uvm_gpu_chunk_get_size(chunk) == chunk_size, "chunk size %u expected %u\n",
-            uvm_gpu_chunk_get_size(chunk), chunk_size);
-    UVM_ASSERT(chunk->type == type);
-    UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_FREE);
-    UVM_ASSERT(!chunk_is_in_eviction(pmm, chunk));
+    pmm->background_zero.enabled = true;
 
-    if (chunk->parent) {
-        UVM_ASSERT(chunk->parent->suballoc);
-        UVM_ASSERT(chunk->parent->type == type);
-        UVM_ASSERT(chunk->parent->suballoc->allocated < num_subchunks(chunk->parent));
-        chunk->parent->suballoc->allocated++;
-    }
+    return NV_OK;
+}
 
-    chunk_pin(pmm, chunk);
-    chunk_update_lists_locked(pmm, chunk);
+static void background_zero_deinit(uvm_pmm_gpu_t *pmm)
+{
+    if (!pmm->background_zero.enabled)
+        return;
 
-out:
-    uvm_spin_unlock(&pmm->list_lock);
+    // Stop the current run early, the chunks left are simply not zeroed
+    atomic_set(&pmm->background_zero.stopping, 1);
 
-    return chunk;
+    pmm->background_zero.enabled = false;
+    nv_kthread_q_stop(&pmm->background_zero.q);
+}
+
+void uvm_pmm_gpu_stop_background_threads(uvm_pmm_gpu_t *pmm)
+{
+    pre_eviction_deinit(pmm);
+    compaction_deinit(pmm);
+    background_zero_deinit(pmm);
+    page_table_reserve_stop(pmm);
 }
 
 static NV_STATUS alloc_or_evict_root_chunk(uvm_pmm_gpu_t *pmm,
@@ -1840,8 +3323,12 @@ static NV_STATUS alloc_or_evict_root_chunk(uvm_pmm_gpu_t *pmm,
     NV_STATUS status;
     uvm_gpu_chunk_t *chunk;
 
+    pre_eviction_check(pmm, type);
+
     status = alloc_root_chunk(pmm, type, flags, &chunk);
     if (status != NV_OK) {
+        compaction_schedule(pmm, type);
+
         if ((flags & UVM_PMM_ALLOC_FLAGS_EVICT) && uvm_gpu_supports_eviction(pmm->gpu))
             status = pick_and_evict_root_chunk_retry(pmm, type, PMM_CONTEXT_DEFAULT, chunk_out);
 
@@ -1861,12 +3348,16 @@ static NV_STATUS alloc_or_evict_root_chunk_unlocked(uvm_pmm_gpu_t *pmm,
     NV_STATUS status;
     uvm_gpu_chunk_t *chunk;
 
+    pre_eviction_check(pmm, type);
+
     status = alloc_root_chunk(pmm, type, flags, &chunk);
     if (status != NV_OK) {
+        compaction_schedule(pmm, type);
+
         if ((flags & UVM_PMM_ALLOC_FLAGS_EVICT) && uvm_gpu_supports_eviction(pmm->gpu)) {
-            uvm_mutex_lock(&pmm->lock);
+            pmm_lock(pmm);
             status = pick_and_evict_root_chunk_retry(pmm, type, PMM_CONTEXT_DEFAULT, chunk_out);
-            uvm_mutex_unlock(&pmm->lock);
+            pmm_unlock(pmm);
         }
 
         return status;
@@ -1953,12 +3444,12 @@ static NV_STATUS alloc_chunk_with_splits(uvm_pmm_gpu_t *pmm,
         chunk = parent->suballoc->subchunks[0];
 
         // And add the rest to the free list
-        uvm_spin_lock(&pmm->list_lock);
+        pmm_list_lock(pmm);
 
         for (i = 1; i < num_subchunks(parent); ++i)
             chunk_free_locked(pmm, parent->suballoc->subchunks[i]);
 
-        uvm_spin_unlock(&pmm->list_lock);
+        pmm_list_unlock(pmm);
     }
     UVM_PANIC();
 }
@@ -1994,11 +3485,11 @@ NV_STATUS alloc_chunk(uvm_pmm_gpu_t *pmm,
     }
 
     // We didn't find a free chunk and we will require splits so acquire the PMM lock.
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     status = alloc_chunk_with_splits(pmm, type, chunk_size, flags, &chunk);
 
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     if (status != NV_OK) {
         (void)free_next_available_root_chunk(pmm, type);
@@ -2029,7 +3520,7 @@ static void init_root_chunk(uvm_pmm_gpu_t *pmm,
 
     uvm_tracker_init(&root_chunk->tracker);
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     UVM_ASSERT_MSG(chunk->state == UVM_PMM_GPU_CHUNK_STATE_PMA_OWNED,
                    "Address 0x%llx state %s GPU %s\n",
@@ -2054,7 +3545,7 @@ static void init_root_chunk(uvm_pmm_gpu_t *pmm,
 
     chunk_update_lists_locked(pmm, chunk);
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     root_chunk_unlock(pmm, root_chunk);
 }
@@ -2195,7 +3686,7 @@ void free_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, free_
         UVM_ASSERT(uvm_global_get_status() != NV_OK);
     }
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     UVM_ASSERT_MSG(chunk->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED,
                    "Address 0x%llx state %s GPU %s\n",
@@ -2205,8 +3696,9 @@ void free_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, free_
     UVM_ASSERT(list_empty(&chunk->list));
 
     chunk_unpin(pmm, chunk, UVM_PMM_GPU_CHUNK_STATE_PMA_OWNED);
+    atomic_set(&root_chunk->referenced, 0);
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     root_chunk_unlock(pmm, root_chunk);
 
@@ -2301,7 +3793,7 @@ NV_STATUS split_gpu_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 
     // Now that all of the subchunk state has been initialized, transition the
     // parent into the split state under the list lock.
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     chunk->suballoc = suballoc;
 
@@ -2321,7 +3813,7 @@ NV_STATUS split_gpu_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 
     chunk->state = UVM_PMM_GPU_CHUNK_STATE_IS_SPLIT;
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     return NV_OK;
 cleanup:
@@ -2461,7 +3953,7 @@ static bool try_chunk_free(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 {
     bool freed = false;
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     chunk->inject_split_error = false;
 
@@ -2472,7 +3964,7 @@ static bool try_chunk_free(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
         freed = true;
     }
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     return freed;
 }
@@ -2496,7 +3988,7 @@ static uvm_gpu_chunk_t *free_or_prepare_for_merge(uvm_pmm_gpu_t *pmm, uvm_gpu_ch
         return NULL;
     }
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     if (chunk_is_last_allocated_child(pmm, chunk))
         parent = chunk->parent;
@@ -2525,7 +4017,7 @@ static uvm_gpu_chunk_t *free_or_prepare_for_merge(uvm_pmm_gpu_t *pmm, uvm_gpu_ch
     parent = chunk->parent;
 
 done:
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     return parent;
 }
@@ -2567,9 +4059,9 @@ static void free_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
     else {
         // Freeing a chunk can only fail if it requires merging. Take the PMM lock
         // and free it with merges supported.
-        uvm_mutex_lock(&pmm->lock);
+        pmm_lock(pmm);
         free_chunk_with_merges(pmm, chunk);
-        uvm_mutex_unlock(&pmm->lock);
+        pmm_unlock(pmm);
     }
 
     // Once try_chunk_free succeeds or free_chunk_with_merges returns, it's no
@@ -2581,6 +4073,8 @@ static void free_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 
     if (try_free)
         (void)free_next_available_root_chunk(pmm, type);
+
+    background_zero_schedule(pmm, type);
 }
 
 // Finds and frees the next root chunk of the given type (if any) that can be
@@ -2591,7 +4085,7 @@ bool free_next_available_root_chunk(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_
 
     UVM_ASSERT(uvm_chunk_find_last_size(pmm->chunk_sizes[type]) == UVM_CHUNK_SIZE_MAX);
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     // Prefer non-zero free chunk as memory is about to be released to PMA
     result = list_first_chunk(find_free_list(pmm, type, UVM_CHUNK_SIZE_MAX, UVM_PMM_LIST_NO_ZERO));
@@ -2618,7 +4112,7 @@ bool free_next_available_root_chunk(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_
         chunk_pin(pmm, result);
     }
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     if (result != NULL) {
         free_root_chunk(pmm, root_chunk_from_chunk(pmm, result), FREE_ROOT_CHUNK_MODE_DEFAULT);
@@ -2684,7 +4178,7 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_pages(void *void_pmm,
         uvm_page_index_t page_index;
         NvU64 pages_this_time = min(pages_per_chunk, num_pages_left_to_evict);
 
-        uvm_mutex_lock(&pmm->lock);
+        pmm_lock(pmm);
 
         if (uvm_pmm_should_inject_pma_eviction_error(pmm)) {
             status = NV_ERR_NO_MEMORY;
@@ -2695,7 +4189,7 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_pages(void *void_pmm,
                                                      PMM_CONTEXT_PMA_EVICTION,
                                                      &chunk);
         }
-        uvm_mutex_unlock(&pmm->lock);
+        pmm_unlock(pmm);
 
         // TODO: Bug 1795559: Consider waiting for any pinned user allocations
         // to be unpinned.
@@ -2799,6 +4293,7 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_range(void *void_pmm, NvU64 phys_begin, N
     NV_STATUS status;
     uvm_pmm_gpu_t *pmm = (uvm_pmm_gpu_t *)void_pmm;
     NvU64 address = UVM_ALIGN_DOWN(phys_begin, UVM_CHUNK_SIZE_MAX);
+    evicted_root_chunks_t evicted = {0};
 
     UVM_ASSERT_MSG(phys_begin <= phys_end, "range [0x%llx, 0x%llx]\n", phys_begin, phys_end);
     UVM_ASSERT_MSG(phys_end <= pmm->gpu->mem_info.max_allocatable_address,
@@ -2829,7 +4324,7 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_range(void *void_pmm, NvU64 phys_begin, N
 
         // Wait until we can start eviction or the chunk is returned to PMA
         do {
-            uvm_spin_lock(&pmm->list_lock);
+            pmm_list_lock(pmm);
 
             if (chunk->state != UVM_PMM_GPU_CHUNK_STATE_PMA_OWNED) {
                 UVM_ASSERT(chunk->type == UVM_PMM_GPU_MEMORY_TYPE_USER);
@@ -2840,11 +4335,12 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_range(void *void_pmm, NvU64 phys_begin, N
                 }
             }
 
-            uvm_spin_unlock(&pmm->list_lock);
+            pmm_list_unlock(pmm);
 
             // TODO: Bug 1795559: Replace this with a wait queue.
             if (UVM_SPIN_LOOP(&spin) == NV_ERR_TIMEOUT_RETRY) {
                 UVM_ERR_PRINT("Stuck waiting for root chunk 0x%llx to be unpinned, giving up\n", chunk->address);
+                evicted_root_chunks_free(pmm, &evicted, false, FREE_ROOT_CHUNK_MODE_PMA_EVICTION);
                 return NV_ERR_NO_MEMORY;
             }
         } while (!eviction_started && chunk->state != UVM_PMM_GPU_CHUNK_STATE_PMA_OWNED);
@@ -2854,22 +4350,27 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_range(void *void_pmm, NvU64 phys_begin, N
         if (chunk->state == UVM_PMM_GPU_CHUNK_STATE_PMA_OWNED)
             continue;
 
-        uvm_mutex_lock(&pmm->lock);
+        pmm_lock(pmm);
 
         status = evict_root_chunk(pmm, root_chunk, PMM_CONTEXT_PMA_EVICTION);
         should_inject_error = uvm_pmm_should_inject_pma_eviction_error(pmm);
 
-        uvm_mutex_unlock(&pmm->lock);
+        pmm_unlock(pmm);
 
-        if (status != NV_OK)
+        if (status != NV_OK) {
+            evicted_root_chunks_free(pmm, &evicted, false, FREE_ROOT_CHUNK_MODE_PMA_EVICTION);
             return status;
+        }
 
-        free_root_chunk(pmm, root_chunk, FREE_ROOT_CHUNK_MODE_PMA_EVICTION);
+        if (evicted_root_chunks_add(&evicted, root_chunk) || should_inject_error)
+            evicted_root_chunks_free(pmm, &evicted, false, FREE_ROOT_CHUNK_MODE_PMA_EVICTION);
 
         if (should_inject_error)
             return NV_ERR_NO_MEMORY;
     }
 
+    evicted_root_chunks_free(pmm, &evicted, false, FREE_ROOT_CHUNK_MODE_PMA_EVICTION);
+
     // Make sure that all pending frees for chunks that the eviction above could
     // have observed as PMA owned are done. This is required to guarantee that
     // any address that, PMM thinks, is owned by PMA, has been actually freed
@@ -3107,7 +4608,7 @@ static NV_STATUS get_chunk_mappings_in_range(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t
             return NV_ERR_OUT_OF_RANGE;
     }
 
-    uvm_spin_lock(&pmm->list_lock);
+    pmm_list_lock(pmm);
 
     // Return results for allocated leaf chunks, only
     if (chunk->state == UVM_PMM_GPU_CHUNK_STATE_ALLOCATED) {
@@ -3137,7 +4638,7 @@ static NV_STATUS get_chunk_mappings_in_range(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t
         ++get_chunk_mappings_data->num_mappings;
     }
 
-    uvm_spin_unlock(&pmm->list_lock);
+    pmm_list_unlock(pmm);
 
     return NV_OK;
 }
@@ -3151,7 +4652,7 @@ NvU32 uvm_pmm_gpu_phys_to_virt(uvm_pmm_gpu_t *pmm, NvU64 phys_addr, NvU64 region
     UVM_ASSERT(PAGE_ALIGNED(phys_addr));
     UVM_ASSERT(PAGE_ALIGNED(region_size));
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     // Traverse the whole requested region
     do {
@@ -3186,7 +4687,7 @@ NvU32 uvm_pmm_gpu_phys_to_virt(uvm_pmm_gpu_t *pmm, NvU64 phys_addr, NvU64 region
         size_in_chunk = min((NvU64)UVM_CHUNK_SIZE_MAX, region_size);
     } while (region_size > 0);
 
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     return num_mappings;
 }
@@ -3217,6 +4718,7 @@ NV_STATUS uvm_pmm_gpu_init(uvm_gpu_t *gpu, uvm_pmm_gpu_t *pmm)
     }
     INIT_LIST_HEAD(&pmm->root_chunks.va_block_used);
     INIT_LIST_HEAD(&pmm->root_chunks.va_block_unused);
+    INIT_LIST_HEAD(&pmm->root_chunks.va_block_residency_pinned);
 
     uvm_mutex_init(&pmm->lock, UVM_LOCK_ORDER_PMM);
     uvm_init_rwsem(&pmm->pma_lock, UVM_LOCK_ORDER_PMM_PMA);
@@ -3260,6 +4762,10 @@ NV_STATUS uvm_pmm_gpu_init(uvm_gpu_t *gpu, uvm_pmm_gpu_t *pmm)
         goto cleanup;
     }
 
+    pmm->root_chunks.residency_pinned_max = pmm->root_chunks.count *
+                                            min(uvm_perf_pmm_residency_pinned_max,
+                                                (unsigned)UVM_PERF_PMM_RESIDENCY_PINNED_MAX_MAX) / 100;
+
     // Initialize all root chunks to be PMA owned and set their addresses
     for (i = 0; i < pmm->root_chunks.count; ++i) {
         uvm_gpu_chunk_t *chunk = &pmm->root_chunks.array[i].chunk;
@@ -3292,6 +4798,26 @@ NV_STATUS uvm_pmm_gpu_init(uvm_gpu_t *gpu, uvm_pmm_gpu_t *pmm)
         }
     }
 
+    status = pre_eviction_init(pmm);
+    if (status != NV_OK)
+        goto cleanup;
+
+    status = compaction_init(pmm);
+    if (status != NV_OK)
+        goto cleanup;
+
+    status = background_zero_init(pmm);
+    if (status != NV_OK)
+        goto cleanup;
+
+    status = magazines_init(pmm);
+    if (status != NV_OK)
+        goto cleanup;
+
+    status = page_table_reserve_init(pmm);
+    if (status != NV_OK)
+        goto cleanup;
+
     return NV_OK;
 cleanup:
     uvm_pmm_gpu_deinit(pmm);
@@ -3324,6 +4850,13 @@ void uvm_pmm_gpu_deinit(uvm_pmm_gpu_t *pmm)
     if (!pmm || !pmm->gpu)
         return;
 
+    // Normally already stopped by deinit_gpu(), but not on init failures
+    uvm_pmm_gpu_stop_background_threads(pmm);
+
+    page_table_reserve_deinit(pmm);
+
+    magazines_deinit(pmm);
+
     release_free_root_chunks(pmm);
 
     if (pmm->gpu->mem_info.size != 0 && gpu_supports_pma_eviction(pmm->gpu))
@@ -3424,13 +4957,13 @@ NV_STATUS uvm_test_evict_chunk(UVM_TEST_EVICT_CHUNK_PARAMS *params, struct file
             if (params->address >= block->start && params->address <= block->end) {
                 uvm_gpu_chunk_t *chunk = uvm_va_block_lookup_gpu_chunk(block, gpu, params->address);
 
-                uvm_spin_lock(&pmm->list_lock);
+                pmm_list_lock(pmm);
                 if (chunk && chunk_is_evictable(pmm, chunk)) {
                     chunk_start_eviction(pmm, chunk);
                     root_chunk = root_chunk_from_chunk(pmm, chunk);
                     params->chunk_size_backing_virtual = uvm_gpu_chunk_get_size(chunk);
                 }
-                uvm_spin_unlock(&pmm->list_lock);
+                pmm_list_unlock(pmm);
             }
         }
         else {
@@ -3457,14 +4990,14 @@ NV_STATUS uvm_test_evict_chunk(UVM_TEST_EVICT_CHUNK_PARAMS *params, struct file
         root_chunk = &pmm->root_chunks.array[index];
         chunk = &root_chunk->chunk;
 
-        uvm_spin_lock(&pmm->list_lock);
+        pmm_list_lock(pmm);
 
         if (chunk_is_evictable(pmm, chunk))
             chunk_start_eviction(pmm, chunk);
         else
             chunk = NULL;
 
-        uvm_spin_unlock(&pmm->list_lock);
+        pmm_list_unlock(pmm);
 
         if (!chunk)
             root_chunk = NULL;
@@ -3484,9 +5017,9 @@ NV_STATUS uvm_test_evict_chunk(UVM_TEST_EVICT_CHUNK_PARAMS *params, struct file
         goto out;
     }
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
     status = evict_root_chunk(pmm, root_chunk, PMM_CONTEXT_DEFAULT);
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     if (status != NV_OK)
         goto out;
@@ -3523,7 +5056,7 @@ static NV_STATUS test_check_pma_allocated_chunks(uvm_pmm_gpu_t *pmm,
         }
 
         // The chunk should still be in the PMA owned state
-        uvm_spin_lock(&pmm->list_lock);
+        pmm_list_lock(pmm);
         if (root_chunk->chunk.state != UVM_PMM_GPU_CHUNK_STATE_PMA_OWNED) {
             UVM_TEST_PRINT("Root chunk 0x%llx invalid state: %s, allocated [0x%llx, 0x%llx)\n",
                            root_chunk->chunk.address,
@@ -3531,7 +5064,7 @@ static NV_STATUS test_check_pma_allocated_chunks(uvm_pmm_gpu_t *pmm,
                            address, address + params->page_size);
             status = NV_ERR_INVALID_STATE;
         }
-        uvm_spin_unlock(&pmm->list_lock);
+        pmm_list_unlock(pmm);
     }
     return status;
 }
@@ -3652,9 +5185,9 @@ NV_STATUS uvm_test_pmm_inject_pma_evict_error(UVM_TEST_PMM_INJECT_PMA_EVICT_ERRO
 
     pmm = &gpu->pmm;
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
     pmm->inject_pma_evict_error_after_num_chunks = params->error_after_num_chunks;
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     uvm_gpu_release(gpu);
     return NV_OK;
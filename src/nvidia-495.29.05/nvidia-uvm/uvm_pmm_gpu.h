@@ -59,6 +59,7 @@
 #include "uvm_linux.h"
 #include "uvm_types.h"
 #include "nv_uvm_types.h"
+#include "nv-kthread-q.h"
 
 typedef enum
 {
@@ -90,6 +91,9 @@ typedef enum
 
 #define UVM_CHUNK_SIZES_MASK     (uvm_chunk_sizes_mask_t)(UVM_CHUNK_SIZE_MAX | (UVM_CHUNK_SIZE_MAX-1))
 
+// Number of chunk sizes up to UVM_CHUNK_SIZE_MAX, indexed by their log2
+#define UVM_CHUNK_SIZE_ORDERS 22
+
 typedef enum
 {
     // Memory type for backing user pages. On Pascal+ it can be evicted.
@@ -269,6 +273,18 @@ typedef struct uvm_gpu_root_chunk_struct
     // We can use a regular processor id because indirect peers are not allowed
     // between partitioned GPUs when SMC is enabled.
     uvm_processor_mask_t indirect_peers_mapped;
+
+    // Set when the memory of the root chunk is accessed after it has been
+    // allocated by a VA block, see uvm_pmm_gpu_mark_root_chunk_referenced().
+    // Cleared when the chunk gets a second chance during eviction, see
+    // pick_root_chunk_to_evict(). Accessed without any locks held.
+    atomic_t referenced;
+
+    // Whether the root chunk backs a VA range with pinned residency and is
+    // tracked on uvm_pmm_gpu_t::root_chunks.va_block_residency_pinned.
+    //
+    // Protected by the PMM list lock.
+    bool residency_pinned;
 } uvm_gpu_root_chunk_t;
 
 typedef struct
@@ -299,6 +315,53 @@ typedef struct
     atomic64_t map_count;
 } uvm_gpu_root_chunk_indirect_peer_t;
 
+// Maximum number of chunk sizes cached by the magazines
+#define UVM_PMM_MAGAZINE_CLASSES_MAX 4
+
+// Maximum number of chunks cached per chunk size in each magazine
+#define UVM_PMM_MAGAZINE_DEPTH_MAX 32
+
+// Per-CPU cache of allocated small kernel chunks. The chunks in a magazine are
+// in the UVM_PMM_GPU_CHUNK_STATE_ALLOCATED state and not on any list, as far as
+// the rest of PMM is concerned they are allocated. Kernel chunks are never
+// evicted, so caching them doesn't get in the way of eviction.
+typedef struct
+{
+    // Protects the magazine. Mostly uncontended as each CPU uses its own
+    // magazine, except for flushes.
+    uvm_spinlock_t lock;
+
+    // Number of cached chunks per size class
+    NvU32 count[UVM_PMM_MAGAZINE_CLASSES_MAX];
+
+    // LIFO stacks of cached chunks per size class
+    uvm_gpu_chunk_t *chunks[UVM_PMM_MAGAZINE_CLASSES_MAX][UVM_PMM_MAGAZINE_DEPTH_MAX];
+} uvm_pmm_gpu_magazine_t;
+
+// Maximum number of chunks kept per chunk size in the page table reserve
+#define UVM_PMM_PAGE_TABLE_RESERVE_MAX 64
+
+// Bucket i of the lock hold time histograms counts the lock holds that lasted
+// [2^i, 2^(i + 1)) ns
+#define UVM_PMM_LOCK_STATS_BUCKETS 32
+
+// Hold time statistics of a PMM lock, see uvm_pmm_gpu_lock_stats_start(). They
+// are protected by the lock they track.
+typedef struct
+{
+    // Time at which the current holder acquired the lock, 0 if the hold is
+    // not being recorded
+    NvU64 acquired_ns;
+
+    NvU64 count;
+
+    NvU64 total_ns;
+
+    NvU64 max_ns;
+
+    NvU64 buckets[UVM_PMM_LOCK_STATS_BUCKETS];
+} uvm_pmm_gpu_lock_stats_t;
+
 typedef struct
 {
     // TODO: Bug 2008200: Remove this field and use container_of
@@ -339,8 +402,22 @@ typedef struct
         struct list_head va_block_unused;
 
         // List of root chunks used by VA blocks
+        //
+        // The list is scanned in CLOCK order when picking a chunk to evict:
+        // referenced chunks at the head are moved to the tail instead of
+        // being evicted.
         struct list_head va_block_used;
 
+        // List of root chunks used by VA blocks of ranges with pinned
+        // residency (see UVM_SET_RESIDENCY_PINNED). These are only evicted
+        // when no other root chunk can be.
+        //
+        // At most residency_pinned_max root chunks are tracked here, the rest
+        // stay on the regular lists.
+        struct list_head va_block_residency_pinned;
+        size_t residency_pinned_count;
+        size_t residency_pinned_max;
+
         uvm_gpu_root_chunk_indirect_peer_t indirect_peer[UVM_ID_MAX_GPUS];
     } root_chunks;
 
@@ -364,6 +441,203 @@ typedef struct
     DECLARE_BITMAP(chunk_split_cache_initialized, UVM_PMM_CHUNK_SPLIT_CACHE_SIZES);
 
     bool pma_address_cache_initialized;
+
+    // Eviction statistics. Protected by list_lock.
+    struct
+    {
+        // Root chunks picked for eviction from va_block_unused
+        NvU64 evicted_unused;
+
+        // Root chunks picked for eviction from va_block_used that were not
+        // referenced since their last second chance
+        NvU64 evicted_cold;
+
+        // Root chunks picked for eviction from va_block_used while still
+        // referenced, after the scan limit was reached
+        NvU64 evicted_referenced;
+
+        // Referenced root chunks moved to the tail of va_block_used
+        NvU64 second_chances;
+
+        // Root chunks picked for eviction from va_block_residency_pinned
+        // because no other root chunk could be evicted
+        NvU64 evicted_residency_pinned;
+    } eviction_stats;
+
+    // Background eviction of user memory ahead of demand. When the free memory
+    // in PMA drops below low_watermark, a kthread evicts root chunks until it
+    // reaches high_watermark so that allocations in the fault path mostly
+    // find free memory instead of evicting inline. See
+    // uvm_perf_pmm_pre_eviction_low_watermark.
+    struct
+    {
+        bool enabled;
+
+        // Watermarks in bytes of free memory
+        NvU64 low_watermark;
+        NvU64 high_watermark;
+
+        nv_kthread_q_t q;
+
+        nv_kthread_q_item_t q_item;
+
+        struct
+        {
+            // Number of times the thread was woken up
+            atomic64_t wakeups;
+
+            // Number of root chunks evicted by the thread
+            atomic64_t evicted_chunks;
+
+            // Number of passes that stopped because no chunk could be evicted
+            // or the eviction failed
+            atomic64_t failed_passes;
+        } stats;
+    } pre_eviction;
+
+    // Background compaction of user memory. When a user root chunk can't be
+    // allocated from PMA, a kthread evicts cold split root chunks that have
+    // few allocated subchunks, so that a whole free root chunk is created at
+    // the cost of moving only its allocated subchunks. The thread runs at most
+    // once every UVM_PMM_COMPACTION_INTERVAL_MS. See uvm_perf_pmm_compaction.
+    struct
+    {
+        bool enabled;
+
+        // Time in ns before which the thread doesn't get scheduled again
+        atomic64_t next_run;
+
+        nv_kthread_q_t q;
+
+        nv_kthread_q_item_t q_item;
+
+        struct
+        {
+            // Number of times the thread ran
+            atomic64_t runs;
+
+            // Number of root chunks freed by the thread
+            atomic64_t compacted_chunks;
+
+            // Bytes of allocated subchunks evicted to free the root chunks
+            atomic64_t evicted_bytes;
+
+            // Number of runs that stopped because the eviction failed
+            atomic64_t failed_passes;
+        } stats;
+    } compaction;
+
+    // Background zeroing of free user root chunks. Freeing user memory
+    // schedules a kthread that clears free root chunks from the non-zero free
+    // list with CE memsets while the GPU_INTERNAL channels are idle, and moves
+    // them to the zero free list. Allocations that end up with those chunks can
+    // then skip zeroing them. See uvm_perf_pmm_background_zero.
+    struct
+    {
+        bool enabled;
+
+        // Set when the thread has to stop picking up new chunks
+        atomic_t stopping;
+
+        nv_kthread_q_t q;
+
+        nv_kthread_q_item_t q_item;
+
+        struct
+        {
+            // Number of root chunks zeroed by the thread
+            atomic64_t zeroed_chunks;
+
+            // Number of times the thread backed off because of pending CE work
+            atomic64_t backoffs;
+        } stats;
+    } background_zero;
+
+    // Per-CPU magazines of small kernel chunks, see uvm_pmm_gpu_magazine_t.
+    // They take the list_lock off the path of page table allocations and
+    // frees. See uvm_perf_pmm_magazine_depth.
+    struct
+    {
+        // Array of nr_cpu_ids magazines, NULL if the magazines are disabled
+        uvm_pmm_gpu_magazine_t *array;
+
+        // Number of chunks cached per size class
+        NvU32 depth;
+
+        // Kernel chunk sizes cached by the magazines, one per size class
+        uvm_chunk_sizes_mask_t sizes;
+
+        struct
+        {
+            // Chunks allocated straight from a magazine
+            atomic64_t hits;
+
+            // Chunks allocated by refilling a magazine from the free lists
+            atomic64_t refills;
+
+            // Chunks that couldn't be served by a magazine
+            atomic64_t misses;
+
+            // Chunks returned from a magazine to the free lists
+            atomic64_t flushes;
+        } stats;
+    } magazines;
+
+    // Reserve of small kernel chunks for page tables, refilled by a kthread
+    // that allocates with eviction. Kernel allocations that can't be satisfied
+    // without eviction, like the page table allocations on the fault path, are
+    // served from the reserve instead of failing and having the caller drop
+    // its locks to retry with eviction. See uvm_perf_pmm_page_table_reserve.
+    struct
+    {
+        bool enabled;
+
+        // Set when the thread has to stop refilling the reserve
+        atomic_t stopping;
+
+        // Protects count and chunks
+        uvm_spinlock_t lock;
+
+        // Number of chunks the thread keeps in the reserve per size class
+        NvU32 target;
+
+        // Kernel chunk sizes kept in the reserve, one per size class
+        uvm_chunk_sizes_mask_t sizes;
+
+        // Number of reserved chunks per size class
+        NvU32 count[UVM_PMM_MAGAZINE_CLASSES_MAX];
+
+        // Reserved chunks per size class, in the allocated state
+        uvm_gpu_chunk_t *chunks[UVM_PMM_MAGAZINE_CLASSES_MAX][UVM_PMM_PAGE_TABLE_RESERVE_MAX];
+
+        nv_kthread_q_t q;
+
+        nv_kthread_q_item_t q_item;
+
+        struct
+        {
+            // Chunks allocated from the reserve
+            atomic64_t hits;
+
+            // Chunks allocated by the thread to refill the reserve
+            atomic64_t refills;
+
+            // Allocations that found the reserve without enough chunks
+            atomic64_t empty;
+        } stats;
+    } page_table_reserve;
+
+    // Hold times of lock and list_lock. Only recorded between
+    // uvm_pmm_gpu_lock_stats_start() and uvm_pmm_gpu_lock_stats_stop(), which
+    // are used by the PMM benchmark test.
+    struct
+    {
+        bool enabled;
+
+        uvm_pmm_gpu_lock_stats_t lock;
+
+        uvm_pmm_gpu_lock_stats_t list_lock;
+    } lock_stats;
 } uvm_pmm_gpu_t;
 
 // Initialize PMM on GPU
@@ -561,9 +835,54 @@ uvm_gpu_address_t uvm_pmm_gpu_peer_copy_address(uvm_pmm_gpu_t *pmm,
 // Allow that state to make this API easy to use for the caller.
 void uvm_pmm_gpu_mark_root_chunk_used(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
 
+// Mark a user chunk as used by a VA range with pinned residency
+//
+// Like uvm_pmm_gpu_mark_root_chunk_used(), but the root chunk is also exempted
+// from eviction as long as the per-GPU quota of such root chunks allows it.
+// Marking the chunk used or unused drops the exemption.
+void uvm_pmm_gpu_mark_root_chunk_residency_pinned(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
+
 // Mark an allocated user chunk as unused
 void uvm_pmm_gpu_mark_root_chunk_unused(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
 
+// Mark the root chunk containing the given user chunk, or the given physical
+// address, as recently referenced, which gives it a second chance when picking
+// chunks to evict. This is only a hint and it can be called without holding any
+// locks.
+void uvm_pmm_gpu_mark_root_chunk_referenced(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
+void uvm_pmm_gpu_mark_root_chunk_referenced_by_address(uvm_pmm_gpu_t *pmm, NvU64 address);
+
+// Print the eviction statistics of the PMM
+void uvm_pmm_gpu_print_eviction_stats(uvm_pmm_gpu_t *pmm, struct seq_file *s);
+
+// Print the statistics of the per-CPU chunk magazines, if enabled
+void uvm_pmm_gpu_print_magazine_stats(uvm_pmm_gpu_t *pmm, struct seq_file *s);
+
+// Print the statistics of the page table reserve, if enabled
+void uvm_pmm_gpu_print_page_table_reserve_stats(uvm_pmm_gpu_t *pmm, struct seq_file *s);
+
+// Start recording the hold times of the PMM locks, after clearing the
+// previous statistics. Returns NV_ERR_BUSY_RETRY if they are already being
+// recorded.
+NV_STATUS uvm_pmm_gpu_lock_stats_start(uvm_pmm_gpu_t *pmm);
+
+// Stop recording the hold times of the PMM locks and return the statistics
+// recorded since uvm_pmm_gpu_lock_stats_start()
+void uvm_pmm_gpu_lock_stats_stop(uvm_pmm_gpu_t *pmm,
+                                 uvm_pmm_gpu_lock_stats_t *lock_stats,
+                                 uvm_pmm_gpu_lock_stats_t *list_lock_stats);
+
+// Count the chunks in the free lists of the given memory type.
+// free_chunks[order] is set to the number of free chunks of size 2^order.
+// Chunks cached in the magazines are not counted.
+void uvm_pmm_gpu_count_free_chunks(uvm_pmm_gpu_t *pmm,
+                                   uvm_pmm_gpu_memory_type_t type,
+                                   NvU64 free_chunks[UVM_CHUNK_SIZE_ORDERS]);
+
+// Stop the PMM background threads (pre-eviction and zeroing). They push work to
+// the GPU, so this has to be called before the channel manager is destroyed.
+void uvm_pmm_gpu_stop_background_threads(uvm_pmm_gpu_t *pmm);
+
 static bool uvm_gpu_chunk_same_root(uvm_gpu_chunk_t *chunk1, uvm_gpu_chunk_t *chunk2)
 {
     return UVM_ALIGN_DOWN(chunk1->address, UVM_CHUNK_SIZE_MAX) == UVM_ALIGN_DOWN(chunk2->address, UVM_CHUNK_SIZE_MAX);
@@ -26,12 +26,22 @@
 #include "uvm_kvmalloc.h"
 #include "uvm_va_block.h"
 
+// Reverse map descriptors are freed after an RCU grace period since
+// uvm_pmm_sysmem_mappings_dma_to_virt reads them without taking the reverse map
+// lock.
+typedef struct
+{
+    uvm_reverse_map_t reverse_map;
+
+    struct rcu_head rcu_head;
+} pmm_sysmem_reverse_map_t;
+
 static struct kmem_cache *g_reverse_page_map_cache __read_mostly;
 
 NV_STATUS uvm_pmm_sysmem_init(void)
 {
     g_reverse_page_map_cache = NV_KMEM_CACHE_CREATE("uvm_pmm_sysmem_page_reverse_map_t",
-                                                    uvm_reverse_map_t);
+                                                    pmm_sysmem_reverse_map_t);
     if (!g_reverse_page_map_cache)
         return NV_ERR_NO_MEMORY;
 
@@ -40,9 +50,56 @@ NV_STATUS uvm_pmm_sysmem_init(void)
 
 void uvm_pmm_sysmem_exit(void)
 {
+    // Wait for the descriptors freed with call_rcu
+    rcu_barrier();
+
     kmem_cache_destroy_safe(&g_reverse_page_map_cache);
 }
 
+static uvm_reverse_map_t *reverse_map_alloc(void)
+{
+    pmm_sysmem_reverse_map_t *entry = nv_kmem_cache_zalloc(g_reverse_page_map_cache, NV_UVM_GFP_FLAGS);
+
+    return entry ? &entry->reverse_map : NULL;
+}
+
+static void reverse_map_free_rcu(struct rcu_head *rcu_head)
+{
+    kmem_cache_free(g_reverse_page_map_cache, container_of(rcu_head, pmm_sysmem_reverse_map_t, rcu_head));
+}
+
+// Free a descriptor that may have been visible to lock-free lookups
+static void reverse_map_free(uvm_reverse_map_t *reverse_map)
+{
+    pmm_sysmem_reverse_map_t *entry = container_of(reverse_map, pmm_sysmem_reverse_map_t, reverse_map);
+
+    call_rcu(&entry->rcu_head, reverse_map_free_rcu);
+}
+
+// Free a descriptor that was never inserted in the reverse map
+static void reverse_map_free_unpublished(uvm_reverse_map_t *reverse_map)
+{
+    kmem_cache_free(g_reverse_page_map_cache, container_of(reverse_map, pmm_sysmem_reverse_map_t, reverse_map));
+}
+
+// In-place modifications of descriptors already in the reverse map must be
+// enclosed in these calls so that lock-free lookups can retry. They are
+// serialized by reverse_map_lock, which is a mutex, so preemption is disabled
+// explicitly to keep readers from spinning on a preempted writer.
+static void reverse_map_write_begin(uvm_pmm_sysmem_mappings_t *sysmem_mappings)
+{
+    uvm_assert_mutex_locked(&sysmem_mappings->reverse_map_lock);
+
+    preempt_disable();
+    write_seqcount_begin(&sysmem_mappings->reverse_map_seqcount);
+}
+
+static void reverse_map_write_end(uvm_pmm_sysmem_mappings_t *sysmem_mappings)
+{
+    write_seqcount_end(&sysmem_mappings->reverse_map_seqcount);
+    preempt_enable();
+}
+
 NV_STATUS uvm_pmm_sysmem_mappings_init(uvm_gpu_t *gpu, uvm_pmm_sysmem_mappings_t *sysmem_mappings)
 {
     memset(sysmem_mappings, 0, sizeof(*sysmem_mappings));
@@ -51,6 +108,7 @@ NV_STATUS uvm_pmm_sysmem_mappings_init(uvm_gpu_t *gpu, uvm_pmm_sysmem_mappings_t
 
     uvm_mutex_init(&sysmem_mappings->reverse_map_lock, UVM_LOCK_ORDER_LEAF);
     uvm_init_radix_tree_preloadable(&sysmem_mappings->reverse_map_tree);
+    seqcount_init(&sysmem_mappings->reverse_map_seqcount);
 
     return NV_OK;
 }
@@ -95,7 +153,7 @@ NV_STATUS uvm_pmm_sysmem_mappings_add_gpu_mapping(uvm_pmm_sysmem_mappings_t *sys
     if (!sysmem_mappings->gpu->parent->access_counters_supported)
         return NV_OK;
 
-    new_reverse_map = nv_kmem_cache_zalloc(g_reverse_page_map_cache, NV_UVM_GFP_FLAGS);
+    new_reverse_map = reverse_map_alloc();
     if (!new_reverse_map)
         return NV_ERR_NO_MEMORY;
 
@@ -114,7 +172,7 @@ NV_STATUS uvm_pmm_sysmem_mappings_add_gpu_mapping(uvm_pmm_sysmem_mappings_t *sys
             for (remove_key = base_key; remove_key < key; ++remove_key)
                 (void *)radix_tree_delete(&sysmem_mappings->reverse_map_tree, remove_key);
 
-            kmem_cache_free(g_reverse_page_map_cache, new_reverse_map);
+            reverse_map_free(new_reverse_map);
             status = errno_to_nv_status(ret);
             break;
         }
@@ -160,7 +218,7 @@ static void pmm_sysmem_mappings_remove_gpu_mapping(uvm_pmm_sysmem_mappings_t *sy
 
     uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 
-    kmem_cache_free(g_reverse_page_map_cache, reverse_map);
+    reverse_map_free(reverse_map);
 }
 
 void uvm_pmm_sysmem_mappings_remove_gpu_mapping(uvm_pmm_sysmem_mappings_t *sysmem_mappings, NvU64 dma_addr)
@@ -199,9 +257,11 @@ void uvm_pmm_sysmem_mappings_reparent_gpu_mapping(uvm_pmm_sysmem_mappings_t *sys
     virt_addr = reverse_map->va_block->start + reverse_map->region.first * PAGE_SIZE;
     new_start_page = uvm_va_block_cpu_page_index(va_block, virt_addr);
 
+    reverse_map_write_begin(sysmem_mappings);
     reverse_map->region   = uvm_va_block_region(new_start_page,
                                                 new_start_page + uvm_va_block_region_num_pages(reverse_map->region));
     reverse_map->va_block = va_block;
+    reverse_map_write_end(sysmem_mappings);
 
     UVM_ASSERT(uvm_va_block_contains_address(va_block, uvm_reverse_map_start(reverse_map)));
     UVM_ASSERT(uvm_va_block_contains_address(va_block, uvm_reverse_map_end(reverse_map)));
@@ -248,13 +308,13 @@ NV_STATUS uvm_pmm_sysmem_mappings_split_gpu_mappings(uvm_pmm_sysmem_mappings_t *
 
     // Allocate the descriptors for the new subregions
     for (subregion = 1; subregion < num_subregions; ++subregion) {
-        uvm_reverse_map_t *new_reverse_map = nv_kmem_cache_zalloc(g_reverse_page_map_cache, NV_UVM_GFP_FLAGS);
+        uvm_reverse_map_t *new_reverse_map = reverse_map_alloc();
         uvm_page_index_t page_index = orig_reverse_map->region.first + num_pages * subregion;
 
         if (new_reverse_map == NULL) {
             // On error, free the previously-created descriptors
             while (--subregion != 0)
-                kmem_cache_free(g_reverse_page_map_cache, new_reverse_maps[subregion - 1]);
+                reverse_map_free_unpublished(new_reverse_maps[subregion - 1]);
 
             uvm_kvfree(new_reverse_maps);
             return NV_ERR_NO_MEMORY;
@@ -268,6 +328,7 @@ NV_STATUS uvm_pmm_sysmem_mappings_split_gpu_mappings(uvm_pmm_sysmem_mappings_t *
     }
 
     uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
+    reverse_map_write_begin(sysmem_mappings);
 
     for (subregion = 1; subregion < num_subregions; ++subregion) {
         NvU64 key;
@@ -284,6 +345,7 @@ NV_STATUS uvm_pmm_sysmem_mappings_split_gpu_mappings(uvm_pmm_sysmem_mappings_t *
     orig_reverse_map->region = uvm_va_block_region(orig_reverse_map->region.first,
                                                    orig_reverse_map->region.first + num_pages);
 
+    reverse_map_write_end(sysmem_mappings);
     uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 
     uvm_kvfree(new_reverse_maps);
@@ -323,6 +385,8 @@ void uvm_pmm_sysmem_mappings_merge_gpu_mappings(uvm_pmm_sysmem_mappings_t *sysme
 
     // Otherwise update the rest of slots to point at the same reverse map
     // descriptor
+    reverse_map_write_begin(sysmem_mappings);
+
     key = base_key + uvm_va_block_region_num_pages(first_reverse_map->region);
     running_page_index = first_reverse_map->region.outer;
     while (key < base_key + num_pages) {
@@ -355,12 +419,14 @@ void uvm_pmm_sysmem_mappings_merge_gpu_mappings(uvm_pmm_sysmem_mappings_t *sysme
         key += num_mapping_pages;
         running_page_index = reverse_map->region.outer;
 
-        kmem_cache_free(g_reverse_page_map_cache, reverse_map);
+        reverse_map_free(reverse_map);
     }
 
     // Grow the first mapping to cover the whole region
     first_reverse_map->region.outer = first_reverse_map->region.first + num_pages;
 
+    reverse_map_write_end(sysmem_mappings);
+
 unlock_no_update:
     uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 }
@@ -372,48 +438,69 @@ size_t uvm_pmm_sysmem_mappings_dma_to_virt(uvm_pmm_sysmem_mappings_t *sysmem_map
                                            size_t max_out_mappings)
 {
     NvU64 key;
-    size_t num_mappings = 0;
+    size_t num_mappings;
+    size_t index;
+    size_t num_retained = 0;
+    unsigned seq;
     const NvU64 base_key = dma_addr / PAGE_SIZE;
-    NvU32 num_pages = region_size / PAGE_SIZE;
+    NvU32 num_pages;
 
     UVM_ASSERT(region_size >= PAGE_SIZE);
     UVM_ASSERT(PAGE_ALIGNED(region_size));
     UVM_ASSERT(sysmem_mappings->gpu->parent->access_counters_supported);
     UVM_ASSERT(max_out_mappings > 0);
 
-    uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
+    rcu_read_lock();
 
-    key = base_key;
+    // Take a snapshot of the translations, retrying if any descriptor was
+    // modified in place meanwhile.
     do {
-        uvm_reverse_map_t *reverse_map = radix_tree_lookup(&sysmem_mappings->reverse_map_tree, key);
-
-        if (reverse_map) {
-            size_t num_chunk_pages = uvm_va_block_region_num_pages(reverse_map->region);
-            NvU32 page_offset = key & (num_chunk_pages - 1);
-            NvU32 num_mapping_pages = min(num_pages, (NvU32)num_chunk_pages - page_offset);
-
-            // Sysmem mappings are removed during VA block destruction.
-            // Therefore, we can safely retain the VA blocks as long as they
-            // are in the reverse map and we hold the reverse map lock.
-            uvm_va_block_retain(reverse_map->va_block);
-            out_mappings[num_mappings]               = *reverse_map;
-            out_mappings[num_mappings].region.first += page_offset;
-            out_mappings[num_mappings].region.outer  = out_mappings[num_mappings].region.first + num_mapping_pages;
-
-            if (++num_mappings == max_out_mappings)
-                break;
-
-            num_pages -= num_mapping_pages;
-            key       += num_mapping_pages;
-        }
-        else {
-            --num_pages;
-            ++key;
+        seq = read_seqcount_begin(&sysmem_mappings->reverse_map_seqcount);
+
+        num_mappings = 0;
+        num_pages = region_size / PAGE_SIZE;
+        key = base_key;
+        do {
+            uvm_reverse_map_t *reverse_map = radix_tree_lookup(&sysmem_mappings->reverse_map_tree, key);
+
+            if (reverse_map) {
+                size_t num_chunk_pages = uvm_va_block_region_num_pages(reverse_map->region);
+                NvU32 page_offset = key & (num_chunk_pages - 1);
+                NvU32 num_mapping_pages = min(num_pages, (NvU32)num_chunk_pages - page_offset);
+
+                out_mappings[num_mappings]               = *reverse_map;
+                out_mappings[num_mappings].region.first += page_offset;
+                out_mappings[num_mappings].region.outer  = out_mappings[num_mappings].region.first + num_mapping_pages;
+
+                if (++num_mappings == max_out_mappings)
+                    break;
+
+                num_pages -= num_mapping_pages;
+                key       += num_mapping_pages;
+            }
+            else {
+                --num_pages;
+                ++key;
+            }
         }
+        while (num_pages > 0);
+    } while (read_seqcount_retry(&sysmem_mappings->reverse_map_seqcount, seq));
+
+    // Sysmem mappings are removed before the VA block is freed, and VA blocks
+    // are freed after an RCU grace period. Therefore, the VA blocks found in
+    // the reverse map remain valid until the RCU read-side critical section
+    // ends and can be retained unless they are already being destroyed.
+    for (index = 0; index < num_mappings; ++index) {
+        if (!uvm_va_block_retain_unless_dead(out_mappings[index].va_block))
+            continue;
+
+        if (num_retained != index)
+            out_mappings[num_retained] = out_mappings[index];
+
+        ++num_retained;
     }
-    while (num_pages > 0);
 
-    uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
+    rcu_read_unlock();
 
-    return num_mappings;
+    return num_retained;
 }
@@ -38,6 +38,12 @@
 // DMA address. For now, only PAGE_SIZE translations are supported (i.e. no
 // big/huge pages).
 //
+// Updates to the reverse map are serialized by reverse_map_lock, but lookups
+// are lock-free: the radix tree is traversed under RCU, reverse map
+// descriptors and VA blocks are freed after an RCU grace period, and
+// reverse_map_seqcount lets lookups detect descriptors being modified in place
+// by split, merge and reparent operations.
+//
 // TODO: Bug 1995015: add support for physically-contiguous mappings.
 struct uvm_pmm_sysmem_mappings_struct
 {
@@ -46,6 +52,8 @@ struct uvm_pmm_sysmem_mappings_struct
     struct radix_tree_root             reverse_map_tree;
 
     uvm_mutex_t                        reverse_map_lock;
+
+    seqcount_t                         reverse_map_seqcount;
 };
 
 // See comments in uvm_linux.h
@@ -170,7 +178,9 @@ static void uvm_pmm_sysmem_mappings_merge_gpu_chunk_mappings(uvm_pmm_sysmem_mapp
 // provide enough entries in out_mappings.
 //
 // The VA Block in each returned translation entry is retained, and it's up to
-// the caller to release them
+// the caller to release them. This function doesn't take any locks, so it may
+// run concurrently with updates to the reverse map. Translations of VA blocks
+// that are being destroyed are not returned.
 size_t uvm_pmm_sysmem_mappings_dma_to_virt(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
                                            NvU64 dma_addr,
                                            NvU64 region_size,
@@ -21,6 +21,8 @@
 
 *******************************************************************************/
 
+#include "linux/sort.h"
+#include "nv-kthread-q.h"
 #include "uvm_common.h"
 #include "uvm_pmm_gpu.h"
 #include "uvm_global.h"
@@ -935,6 +937,309 @@ out:
     return status == NV_OK ? tracker_status : status;
 }
 
+#define PMM_BENCH_DEFAULT_SNAPSHOT_INTERVAL_MS 100
+
+typedef struct pmm_bench_struct pmm_bench_t;
+
+typedef struct
+{
+    nv_kthread_q_t q;
+
+    nv_kthread_q_item_t q_item;
+
+    pmm_bench_t *bench;
+
+    uvm_test_rng_t rng;
+
+    // Chunks currently allocated by the thread, NULL for free slots
+    uvm_gpu_chunk_t **chunks;
+
+    // Latency of every successful alloc and of every free
+    NvU64 *alloc_ns;
+    NvU32 num_allocs;
+
+    NvU64 *free_ns;
+    NvU32 num_frees;
+
+    NvU64 alloc_failures;
+
+    NV_STATUS status;
+} pmm_bench_thread_t;
+
+struct pmm_bench_struct
+{
+    UVM_TEST_PMM_BENCH_PARAMS *params;
+
+    uvm_pmm_gpu_t *pmm;
+
+    uvm_pmm_gpu_memory_type_t type;
+
+    // Chunk sizes picked from at random
+    uvm_chunk_size_t chunk_sizes[UVM_MAX_CHUNK_SIZES];
+    NvU32 num_chunk_sizes;
+
+    // Completed by the last thread to finish
+    atomic_t num_running;
+    struct completion done;
+
+    pmm_bench_thread_t threads[UVM_TEST_PMM_BENCH_MAX_THREADS];
+};
+
+static NV_STATUS pmm_bench_alloc(pmm_bench_t *bench, uvm_chunk_size_t chunk_size, uvm_gpu_chunk_t **chunk)
+{
+    if (bench->type == UVM_PMM_GPU_MEMORY_TYPE_USER)
+        return uvm_pmm_gpu_alloc_user(bench->pmm, 1, chunk_size, UVM_PMM_ALLOC_FLAGS_NONE, chunk, NULL);
+
+    return uvm_pmm_gpu_alloc_kernel(bench->pmm, 1, chunk_size, UVM_PMM_ALLOC_FLAGS_NONE, chunk, NULL);
+}
+
+static void pmm_bench_thread_entry(void *args)
+{
+    pmm_bench_thread_t *thread = (pmm_bench_thread_t *)args;
+    pmm_bench_t *bench = thread->bench;
+    UVM_TEST_PMM_BENCH_PARAMS *params = bench->params;
+    NvU32 i;
+
+    for (i = 0; i < params->iterations; i++) {
+        NvU32 slot = uvm_test_rng_range_32(&thread->rng, 0, params->max_live_chunks - 1);
+        NvU64 start;
+
+        if (thread->chunks[slot]) {
+            start = NV_GETTIME();
+            uvm_pmm_gpu_free(bench->pmm, thread->chunks[slot], NULL);
+            thread->free_ns[thread->num_frees++] = NV_GETTIME() - start;
+
+            thread->chunks[slot] = NULL;
+        }
+        else {
+            NvU32 size_index = uvm_test_rng_range_32(&thread->rng, 0, bench->num_chunk_sizes - 1);
+            NV_STATUS status;
+
+            start = NV_GETTIME();
+            status = pmm_bench_alloc(bench, bench->chunk_sizes[size_index], &thread->chunks[slot]);
+            if (status == NV_OK) {
+                thread->alloc_ns[thread->num_allocs++] = NV_GETTIME() - start;
+            }
+            else if (status == NV_ERR_NO_MEMORY) {
+                ++thread->alloc_failures;
+            }
+            else {
+                thread->status = status;
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < params->max_live_chunks; i++) {
+        if (thread->chunks[i]) {
+            uvm_pmm_gpu_free(bench->pmm, thread->chunks[i], NULL);
+            thread->chunks[i] = NULL;
+        }
+    }
+
+    if (atomic_dec_and_test(&bench->num_running))
+        complete(&bench->done);
+}
+
+static void pmm_bench_snapshot(pmm_bench_t *bench, NvU64 start_time)
+{
+    UVM_TEST_PMM_BENCH_SNAPSHOT *snapshot = &bench->params->snapshots[bench->params->num_snapshots++];
+
+    BUILD_BUG_ON(UVM_TEST_PMM_BENCH_SIZE_ORDERS != UVM_CHUNK_SIZE_ORDERS);
+
+    snapshot->time_ns = NV_GETTIME() - start_time;
+    uvm_pmm_gpu_count_free_chunks(bench->pmm, bench->type, snapshot->free_chunks);
+}
+
+static int pmm_bench_cmp_ns(const void *_a, const void *_b)
+{
+    NvU64 a = *(const NvU64 *)_a;
+    NvU64 b = *(const NvU64 *)_b;
+
+    return UVM_CMP_DEFAULT(a, b);
+}
+
+// Sort the samples in place and compute their percentiles
+static void pmm_bench_samples_latency(NvU64 *samples, size_t count, UVM_TEST_PMM_BENCH_LATENCY *latency)
+{
+    memset(latency, 0, sizeof(*latency));
+
+    latency->count = count;
+    if (count == 0)
+        return;
+
+    sort(samples, count, sizeof(*samples), pmm_bench_cmp_ns, NULL);
+
+    latency->p50_ns = samples[(count - 1) * 50 / 100];
+    latency->p99_ns = samples[(count - 1) * 99 / 100];
+    latency->max_ns = samples[count - 1];
+}
+
+// Compute the percentiles of the lock holds from their histogram. They are
+// rounded up to the end of their bucket.
+static void pmm_bench_lock_latency(const uvm_pmm_gpu_lock_stats_t *stats, UVM_TEST_PMM_BENCH_LATENCY *latency)
+{
+    NvU64 p50_count = (stats->count * 50 + 99) / 100;
+    NvU64 p99_count = (stats->count * 99 + 99) / 100;
+    NvU64 count = 0;
+    NvU32 i;
+
+    memset(latency, 0, sizeof(*latency));
+
+    latency->count = stats->count;
+    latency->max_ns = stats->max_ns;
+
+    for (i = 0; i < UVM_PMM_LOCK_STATS_BUCKETS && count < p99_count; i++) {
+        count += stats->buckets[i];
+
+        if (latency->p50_ns == 0 && count >= p50_count)
+            latency->p50_ns = min(1ULL << (i + 1), stats->max_ns);
+        if (count >= p99_count)
+            latency->p99_ns = min(1ULL << (i + 1), stats->max_ns);
+    }
+}
+
+// Move the samples of every thread to the start of the array, in which each
+// thread owns iterations entries
+static size_t pmm_bench_gather_samples(pmm_bench_t *bench, NvU64 *samples, bool allocs)
+{
+    size_t count = 0;
+    NvU32 i;
+
+    for (i = 0; i < bench->params->num_threads; i++) {
+        pmm_bench_thread_t *thread = &bench->threads[i];
+        NvU32 thread_count = allocs ? thread->num_allocs : thread->num_frees;
+
+        memmove(samples + count, allocs ? thread->alloc_ns : thread->free_ns, thread_count * sizeof(*samples));
+        count += thread_count;
+    }
+
+    return count;
+}
+
+NV_STATUS uvm_test_pmm_bench(UVM_TEST_PMM_BENCH_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_gpu_t *gpu;
+    pmm_bench_t *bench = NULL;
+    uvm_gpu_chunk_t **chunks = NULL;
+    NvU64 *alloc_ns = NULL;
+    NvU64 *free_ns = NULL;
+    uvm_chunk_size_t chunk_size;
+    uvm_pmm_gpu_lock_stats_t lock_stats;
+    uvm_pmm_gpu_lock_stats_t list_lock_stats;
+    NvU64 start_time;
+    NvU32 num_started = 0;
+    NvU32 i;
+
+    if (params->memory_type >= UVM_PMM_GPU_MEMORY_TYPE_COUNT ||
+        params->num_threads == 0 ||
+        params->num_threads > UVM_TEST_PMM_BENCH_MAX_THREADS ||
+        params->iterations == 0 ||
+        params->iterations > UVM_TEST_PMM_BENCH_MAX_ITERATIONS ||
+        params->max_live_chunks == 0 ||
+        params->max_live_chunks > UVM_TEST_PMM_BENCH_MAX_LIVE_CHUNKS)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->snapshot_interval_ms == 0)
+        params->snapshot_interval_ms = PMM_BENCH_DEFAULT_SNAPSHOT_INTERVAL_MS;
+
+    gpu = uvm_va_space_retain_gpu_by_uuid(va_space, &params->gpu_uuid);
+    if (!gpu)
+        return NV_ERR_INVALID_DEVICE;
+
+    bench = uvm_kvmalloc_zero(sizeof(*bench));
+    chunks = uvm_kvmalloc_zero(params->num_threads * params->max_live_chunks * sizeof(*chunks));
+    alloc_ns = uvm_kvmalloc(params->num_threads * params->iterations * sizeof(*alloc_ns));
+    free_ns = uvm_kvmalloc(params->num_threads * params->iterations * sizeof(*free_ns));
+    if (!bench || !chunks || !alloc_ns || !free_ns) {
+        status = NV_ERR_NO_MEMORY;
+        goto out;
+    }
+
+    bench->params = params;
+    bench->pmm = &gpu->pmm;
+    bench->type = params->memory_type;
+
+    for_each_chunk_size(chunk_size, gpu->pmm.chunk_sizes[bench->type]) {
+        if (params->chunk_sizes == 0 || (params->chunk_sizes & chunk_size))
+            bench->chunk_sizes[bench->num_chunk_sizes++] = chunk_size;
+    }
+
+    if (bench->num_chunk_sizes == 0) {
+        status = NV_ERR_INVALID_ARGUMENT;
+        goto out;
+    }
+
+    for (i = 0; i < params->num_threads; i++) {
+        pmm_bench_thread_t *thread = &bench->threads[i];
+
+        thread->bench = bench;
+        thread->chunks = chunks + i * params->max_live_chunks;
+        thread->alloc_ns = alloc_ns + i * params->iterations;
+        thread->free_ns = free_ns + i * params->iterations;
+        uvm_test_rng_init(&thread->rng, params->seed + i);
+
+        status = errno_to_nv_status(nv_kthread_q_init(&thread->q, "uvm_pmm_bench"));
+        if (status != NV_OK)
+            goto out;
+
+        nv_kthread_q_item_init(&thread->q_item, pmm_bench_thread_entry, thread);
+        ++num_started;
+    }
+
+    status = uvm_pmm_gpu_lock_stats_start(&gpu->pmm);
+    if (status != NV_OK)
+        goto out;
+
+    params->num_snapshots = 0;
+    atomic_set(&bench->num_running, params->num_threads);
+    init_completion(&bench->done);
+
+    start_time = NV_GETTIME();
+    pmm_bench_snapshot(bench, start_time);
+
+    for (i = 0; i < params->num_threads; i++)
+        nv_kthread_q_schedule_q_item(&bench->threads[i].q, &bench->threads[i].q_item);
+
+    // Keep the last snapshot for the end of the benchmark
+    while (!wait_for_completion_timeout(&bench->done, msecs_to_jiffies(params->snapshot_interval_ms))) {
+        if (params->num_snapshots < UVM_TEST_PMM_BENCH_MAX_SNAPSHOTS - 1)
+            pmm_bench_snapshot(bench, start_time);
+    }
+
+    pmm_bench_snapshot(bench, start_time);
+
+    uvm_pmm_gpu_lock_stats_stop(&gpu->pmm, &lock_stats, &list_lock_stats);
+
+    params->alloc_failures = 0;
+    for (i = 0; i < params->num_threads; i++) {
+        params->alloc_failures += bench->threads[i].alloc_failures;
+        if (status == NV_OK)
+            status = bench->threads[i].status;
+    }
+
+    pmm_bench_samples_latency(alloc_ns, pmm_bench_gather_samples(bench, alloc_ns, true), &params->alloc_latency);
+    pmm_bench_samples_latency(free_ns, pmm_bench_gather_samples(bench, free_ns, false), &params->free_latency);
+    pmm_bench_lock_latency(&lock_stats, &params->lock_hold);
+    pmm_bench_lock_latency(&list_lock_stats, &params->list_lock_hold);
+
+out:
+    if (bench) {
+        for (i = 0; i < num_started; i++)
+            nv_kthread_q_stop(&bench->threads[i].q);
+    }
+
+    uvm_kvfree(free_ns);
+    uvm_kvfree(alloc_ns);
+    uvm_kvfree(chunks);
+    uvm_kvfree(bench);
+    uvm_gpu_release(gpu);
+
+    return status;
+}
+
 static uvm_reverse_map_t g_reverse_map_entries[PAGES_PER_UVM_VA_BLOCK * 4];
 
 static NV_STATUS test_pmm_reverse_map_single(uvm_gpu_t *gpu, uvm_va_space_t *va_space, NvU64 addr)
@@ -62,7 +62,7 @@ NV_STATUS uvm_api_range_type_check(uvm_va_space_t *va_space, struct mm_struct *m
     if (mm)
         uvm_assert_mmap_lock_locked(mm);
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (uvm_api_range_invalid(base, length))
         return NV_ERR_INVALID_ADDRESS;
@@ -170,7 +170,7 @@ static NV_STATUS preferred_location_set(uvm_va_space_t *va_space,
     bool preferred_location_is_faultable_gpu = false;
     NV_STATUS status;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     if (UVM_ID_IS_VALID(preferred_location)) {
         UVM_ASSERT(first_va_range_to_migrate != NULL);
@@ -286,10 +286,16 @@ NV_STATUS uvm_api_set_preferred_location(const UVM_SET_PREFERRED_LOCATION_PARAMS
     if (status != NV_OK)
         goto done;
 
+    uvm_va_space_merge_span_as_needed(va_space, start, end + 1);
+
     // No VA range to migrate, early exit
     if (!first_va_range_to_migrate)
         goto done;
 
+    // The merge may have freed first_va_range_to_migrate. VA ranges without
+    // non-migratable intervals are skipped below anyway.
+    first_va_range_to_migrate = uvm_va_space_iter_first(va_space, start, end);
+
     uvm_va_space_downgrade_write(va_space);
     has_va_space_write_lock = false;
 
@@ -336,10 +342,14 @@ NV_STATUS uvm_api_unset_preferred_location(const UVM_UNSET_PREFERRED_LOCATION_PA
 
     status = uvm_api_range_type_check(va_space, mm, params->requestedBase, params->length);
 
-    if (status == NV_OK)
+    if (status == NV_OK) {
         status = preferred_location_set(va_space, mm, params->requestedBase, params->length, UVM_ID_INVALID, NULL, &local_tracker);
-    else if (status == NV_WARN_NOTHING_TO_DO)
+        if (status == NV_OK)
+            uvm_va_space_merge_span_as_needed(va_space, params->requestedBase, params->requestedBase + params->length);
+    }
+    else if (status == NV_WARN_NOTHING_TO_DO) {
         status = NV_OK;
+    }
 
     tracker_status = uvm_tracker_wait_deinit(&local_tracker);
 
@@ -490,6 +500,8 @@ static NV_STATUS accessed_by_set(uvm_va_space_t *va_space,
 
     UVM_ASSERT(va_range_last && va_range_last->node.end >= last_address);
 
+    uvm_va_space_merge_span_as_needed(va_space, base, last_address + 1);
+
 done:
     tracker_status = uvm_tracker_wait_deinit(&local_tracker);
 
@@ -730,6 +742,8 @@ static NV_STATUS read_duplication_set(uvm_va_space_t *va_space, NvU64 base, NvU6
 
     UVM_ASSERT(va_range_last && va_range_last->node.end >= last_address);
 
+    uvm_va_space_merge_span_as_needed(va_space, base, last_address + 1);
+
 done:
     uvm_va_space_up_write(va_space);
     uvm_va_space_mm_or_current_release_unlock(va_space, mm);
@@ -750,6 +764,168 @@ NV_STATUS uvm_api_disable_read_duplication(const UVM_DISABLE_READ_DUPLICATION_PA
     return read_duplication_set(va_space, params->requestedBase, params->length, false);
 }
 
+typedef struct
+{
+    NvU32 granularity;
+    NvU8 notification_threshold;
+} access_counter_policy_t;
+
+static bool access_counter_policy_is_va_range_split_needed(uvm_va_range_t *va_range, void *data)
+{
+    access_counter_policy_t *new_policy;
+
+    UVM_ASSERT(data);
+
+    new_policy = (access_counter_policy_t *)data;
+    return va_range->access_counter_granularity != new_policy->granularity ||
+           va_range->access_counter_notification_threshold != new_policy->notification_threshold;
+}
+
+NV_STATUS uvm_api_set_access_counter_policy(const UVM_SET_ACCESS_COUNTER_POLICY_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_va_range_t *va_range, *va_range_last;
+    struct mm_struct *mm;
+    const NvU64 base = params->requestedBase;
+    const NvU64 last_address = base + params->length - 1;
+    access_counter_policy_t new_policy;
+    NV_STATUS status;
+
+    switch (params->granularity) {
+        case UVM_ACCESS_COUNTER_POLICY_GRANULARITY_DEFAULT:
+            new_policy.granularity = 0;
+            break;
+        case UVM_ACCESS_COUNTER_POLICY_GRANULARITY_64K:
+            new_policy.granularity = UVM_PAGE_SIZE_64K;
+            break;
+        case UVM_ACCESS_COUNTER_POLICY_GRANULARITY_2M:
+            new_policy.granularity = UVM_PAGE_SIZE_2M;
+            break;
+        default:
+            return NV_ERR_INVALID_ARGUMENT;
+    }
+
+    if (params->notificationThreshold > UVM_ACCESS_COUNTER_POLICY_NOTIFICATION_THRESHOLD_MAX)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    new_policy.notification_threshold = params->notificationThreshold;
+
+    mm = uvm_va_space_mm_or_current_retain_lock(va_space);
+    uvm_va_space_down_write(va_space);
+
+    status = uvm_api_range_type_check(va_space, mm, base, params->length);
+    if (status != NV_OK) {
+        if (status == NV_WARN_NOTHING_TO_DO)
+            status = NV_OK;
+
+        goto done;
+    }
+
+    status = uvm_va_space_split_span_as_needed(va_space,
+                                               base,
+                                               last_address + 1,
+                                               access_counter_policy_is_va_range_split_needed,
+                                               &new_policy);
+    if (status != NV_OK)
+        goto done;
+
+    va_range_last = NULL;
+    uvm_for_each_managed_va_range_in_contig(va_range, va_space, base, last_address) {
+        va_range_last = va_range;
+
+        // If we didn't split the ends, check that they match
+        if (va_range->node.start < base || va_range->node.end > last_address)
+            UVM_ASSERT(!access_counter_policy_is_va_range_split_needed(va_range, &new_policy));
+
+        // Blocks keep their notification counts, which are compared against
+        // the new threshold on the next notification
+        va_range->access_counter_granularity = new_policy.granularity;
+        va_range->access_counter_notification_threshold = new_policy.notification_threshold;
+    }
+
+    UVM_ASSERT(va_range_last && va_range_last->node.end >= last_address);
+
+    uvm_va_space_merge_span_as_needed(va_space, base, last_address + 1);
+
+done:
+    uvm_va_space_up_write(va_space);
+    uvm_va_space_mm_or_current_release_unlock(va_space, mm);
+    return status;
+}
+
+static bool residency_pinned_is_va_range_split_needed(uvm_va_range_t *va_range, void *data)
+{
+    bool new_residency_pinned;
+
+    UVM_ASSERT(data);
+
+    new_residency_pinned = *(bool *)data;
+    return va_range->residency_pinned != new_residency_pinned;
+}
+
+NV_STATUS uvm_api_set_residency_pinned(const UVM_SET_RESIDENCY_PINNED_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_va_range_t *va_range, *va_range_last;
+    struct mm_struct *mm;
+    const NvU64 base = params->requestedBase;
+    const NvU64 last_address = base + params->length - 1;
+    bool new_residency_pinned = params->pinned;
+    NV_STATUS status;
+
+    mm = uvm_va_space_mm_or_current_retain_lock(va_space);
+    uvm_va_space_down_write(va_space);
+
+    status = uvm_api_range_type_check(va_space, mm, base, params->length);
+    if (status != NV_OK) {
+        if (status == NV_WARN_NOTHING_TO_DO)
+            status = NV_OK;
+
+        goto done;
+    }
+
+    status = uvm_va_space_split_span_as_needed(va_space,
+                                               base,
+                                               last_address + 1,
+                                               residency_pinned_is_va_range_split_needed,
+                                               &new_residency_pinned);
+    if (status != NV_OK)
+        goto done;
+
+    va_range_last = NULL;
+    uvm_for_each_managed_va_range_in_contig(va_range, va_space, base, last_address) {
+        uvm_va_block_t *va_block;
+
+        va_range_last = va_range;
+
+        // If we didn't split the ends, check that they match
+        if (va_range->node.start < base || va_range->node.end > last_address)
+            UVM_ASSERT(!residency_pinned_is_va_range_split_needed(va_range, &new_residency_pinned));
+
+        if (va_range->residency_pinned == new_residency_pinned)
+            continue;
+
+        va_range->residency_pinned = new_residency_pinned;
+
+        // Move the memory already resident on the GPUs to the matching
+        // eviction list
+        for_each_va_block_in_va_range(va_range, va_block) {
+            uvm_mutex_lock(&va_block->lock);
+            uvm_va_block_mark_memory_used(va_block);
+            uvm_mutex_unlock(&va_block->lock);
+        }
+    }
+
+    UVM_ASSERT(va_range_last && va_range_last->node.end >= last_address);
+
+    uvm_va_space_merge_span_as_needed(va_space, base, last_address + 1);
+
+done:
+    uvm_va_space_up_write(va_space);
+    uvm_va_space_mm_or_current_release_unlock(va_space, mm);
+    return status;
+}
+
 static NV_STATUS system_wide_atomics_set(uvm_va_space_t *va_space, const NvProcessorUuid *gpu_uuid, bool enable)
 {
     NV_STATUS status = NV_OK;
@@ -29,6 +29,55 @@
 #include "uvm_va_range.h"
 #include "uvm_va_space.h"
 #include "uvm_populate_pageable.h"
+#include "uvm_kvmalloc.h"
+#include "uvm_thread_context.h"
+#include "nv-kthread-q.h"
+
+// Large ranges can be populated in parallel: the range is split in chunks,
+// which are populated by the calling thread and by worker threads running on
+// its NUMA node, so that pages land where they would have with a serial
+// population.
+#define UVM_POPULATE_PAGEABLE_THREADS_MAX 32
+
+static unsigned uvm_populate_pageable_threads = 0;
+module_param(uvm_populate_pageable_threads, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_populate_pageable_threads,
+                 "Number of worker threads used to populate large pageable ranges in UVM_POPULATE_PAGEABLE, in "
+                 "addition to the calling thread. 0 disables parallel population.");
+
+static unsigned uvm_populate_pageable_chunk_mb = 256;
+module_param(uvm_populate_pageable_chunk_mb, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_populate_pageable_chunk_mb,
+                 "Size in MB of the chunks populated by each thread in parallel population. Ranges smaller than "
+                 "two chunks are populated serially.");
+
+typedef struct
+{
+    struct mm_struct *mm;
+    unsigned long start;
+    unsigned long outer;
+    unsigned long chunk_size;
+    int min_prot;
+
+    unsigned long num_chunks;
+
+    // Index of the next chunk to be populated
+    atomic_long_t next_chunk;
+
+    // Number of chunks fully populated, for progress reporting
+    atomic_long_t chunks_done;
+
+    // First error found by any thread. No more chunks are started after an
+    // error.
+    atomic_t status;
+} populate_pageable_job_t;
+
+typedef struct
+{
+    nv_kthread_q_t q;
+    nv_kthread_q_item_t q_item;
+    populate_pageable_job_t *job;
+} populate_pageable_worker_t;
 
 NV_STATUS uvm_populate_pageable_vma(struct vm_area_struct *vma,
                                     unsigned long start,
@@ -87,6 +136,157 @@ NV_STATUS uvm_populate_pageable_vma(struct vm_area_struct *vma,
     return NV_OK;
 }
 
+// Populate chunks of the job until there are none left or an error is found.
+// mmap_lock is held in read mode by the thread which started the job for its
+// whole duration.
+static void populate_pageable_job_run(populate_pageable_job_t *job, bool is_caller)
+{
+    while (atomic_read(&job->status) == NV_OK) {
+        NV_STATUS status;
+        unsigned long chunk_start;
+        unsigned long chunk = atomic_long_inc_return(&job->next_chunk) - 1;
+
+        if (chunk >= job->num_chunks)
+            break;
+
+        chunk_start = job->start + chunk * job->chunk_size;
+
+        if (is_caller && fatal_signal_pending(current)) {
+            atomic_cmpxchg(&job->status, NV_OK, NV_ERR_SIGNAL_PENDING);
+            break;
+        }
+
+        status = uvm_populate_pageable(job->mm,
+                                       chunk_start,
+                                       min(job->chunk_size, job->outer - chunk_start),
+                                       job->min_prot);
+        if (status != NV_OK) {
+            atomic_cmpxchg(&job->status, NV_OK, status);
+            break;
+        }
+
+        atomic_long_inc(&job->chunks_done);
+
+        if (is_caller) {
+            UVM_DBG_PRINT_RL("Populated %ld/%lu chunks of [0x%lx, 0x%lx)\n",
+                             atomic_long_read(&job->chunks_done),
+                             job->num_chunks,
+                             job->start,
+                             job->outer);
+        }
+    }
+}
+
+static void populate_pageable_worker(populate_pageable_worker_t *worker)
+{
+    // See fault_service_worker
+    uvm_record_lock_mmap_lock_read(worker->job->mm);
+    populate_pageable_job_run(worker->job, false);
+    uvm_record_unlock_mmap_lock_read(worker->job->mm);
+}
+
+static void populate_pageable_worker_entry(void *args)
+{
+    UVM_ENTRY_VOID(populate_pageable_worker((populate_pageable_worker_t *)args));
+}
+
+static NV_STATUS populate_pageable_worker_init(populate_pageable_worker_t *worker, int node)
+{
+    nv_kthread_q_attrs_t attrs = {
+        .preferred_node = NV_KTHREAD_NO_NODE,
+        .sched_policy   = NV_KTHREAD_Q_SCHED_NORMAL,
+    };
+
+#if UVM_THREAD_AFFINITY_SUPPORTED()
+    if (node != NUMA_NO_NODE && !cpumask_empty(uvm_cpumask_of_node(node))) {
+        attrs.preferred_node = node;
+        attrs.cpumask = uvm_cpumask_of_node(node);
+    }
+#endif
+
+    return errno_to_nv_status(nv_kthread_q_init_with_attrs(&worker->q, "UVM populate", &attrs));
+}
+
+// Number of worker threads to use for populating the given range, or 0 if it
+// must be populated serially.
+static NvU32 populate_pageable_num_workers(unsigned long length, unsigned long chunk_size)
+{
+    NvU32 num_workers = min(uvm_populate_pageable_threads, (unsigned)UVM_POPULATE_PAGEABLE_THREADS_MAX);
+
+    if (num_workers == 0 || chunk_size == 0 || length < 2 * chunk_size)
+        return 0;
+
+#if defined(CONFIG_NUMA)
+    // The workers don't inherit the memory policy of the caller, so their
+    // allocations could land somewhere else
+    if (current->mempolicy)
+        return 0;
+#endif
+
+    return min((unsigned long)num_workers, DIV_ROUND_UP(length, chunk_size) - 1);
+}
+
+// Populate the given range using the calling thread and worker threads.
+// Returns NV_WARN_NOTHING_TO_DO if the range must be populated serially
+// instead.
+static NV_STATUS populate_pageable_parallel(struct mm_struct *mm,
+                                           unsigned long start,
+                                           unsigned long length,
+                                           int min_prot)
+{
+    NV_STATUS status = NV_OK;
+    populate_pageable_job_t job;
+    populate_pageable_worker_t *workers;
+    const unsigned long chunk_size = (unsigned long)uvm_populate_pageable_chunk_mb * 1024 * 1024;
+    NvU32 num_workers = populate_pageable_num_workers(length, chunk_size);
+    NvU32 i;
+
+    if (num_workers == 0)
+        return NV_WARN_NOTHING_TO_DO;
+
+    workers = uvm_kvmalloc_zero(num_workers * sizeof(*workers));
+    if (!workers)
+        return NV_WARN_NOTHING_TO_DO;
+
+    job.mm = mm;
+    job.start = start;
+    job.outer = start + length;
+    job.chunk_size = chunk_size;
+    job.min_prot = min_prot;
+    job.num_chunks = DIV_ROUND_UP(length, chunk_size);
+    atomic_long_set(&job.next_chunk, 0);
+    atomic_long_set(&job.chunks_done, 0);
+    atomic_set(&job.status, NV_OK);
+
+    for (i = 0; i < num_workers; ++i) {
+        populate_pageable_worker_t *worker = &workers[i];
+
+        if (populate_pageable_worker_init(worker, numa_node_id()) != NV_OK)
+            break;
+
+        worker->job = &job;
+        nv_kthread_q_item_init(&worker->q_item, populate_pageable_worker_entry, worker);
+        nv_kthread_q_schedule_q_item(&worker->q, &worker->q_item);
+    }
+
+    // Workers which couldn't be started just make the population slower
+    num_workers = i;
+
+    populate_pageable_job_run(&job, true);
+
+    // Wait for the workers to finish their current chunk
+    for (i = 0; i < num_workers; ++i)
+        nv_kthread_q_stop(&workers[i].q);
+
+    uvm_kvfree(workers);
+
+    status = atomic_read(&job.status);
+    if (status == NV_OK)
+        UVM_ASSERT(atomic_long_read(&job.chunks_done) == job.num_chunks);
+
+    return status;
+}
+
 NV_STATUS uvm_populate_pageable(struct mm_struct *mm,
                                 const unsigned long start,
                                 const unsigned long length,
@@ -162,10 +362,14 @@ NV_STATUS uvm_api_populate_pageable(const UVM_POPULATE_PAGEABLE_PARAMS *params,
     // work on current->mm, not the mm associated with the VA space (if any).
     uvm_down_read_mmap_lock(current->mm);
 
-    if (allow_managed || uvm_va_space_range_empty(va_space, params->base, params->base + params->length - 1))
-        status = uvm_populate_pageable(current->mm, params->base, params->length, min_prot);
-    else
+    if (allow_managed || uvm_va_space_range_empty(va_space, params->base, params->base + params->length - 1)) {
+        status = populate_pageable_parallel(current->mm, params->base, params->length, min_prot);
+        if (status == NV_WARN_NOTHING_TO_DO)
+            status = uvm_populate_pageable(current->mm, params->base, params->length, min_prot);
+    }
+    else {
         status = NV_ERR_INVALID_ADDRESS;
+    }
 
     uvm_up_read_mmap_lock(current->mm);
 
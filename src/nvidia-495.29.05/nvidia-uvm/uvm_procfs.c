@@ -21,6 +21,7 @@
 
 *******************************************************************************/
 
+#include "uvm_api.h"
 #include "uvm_global.h"
 #include "uvm_procfs.h"
 #include "uvm_gpu.h"
@@ -46,6 +47,22 @@ static struct proc_dir_entry *uvm_proc_dir;
 static struct proc_dir_entry *uvm_proc_gpus;
 static struct proc_dir_entry *uvm_proc_cpu;
 
+#if UVM_IS_LOCK_STATS()
+static int nv_procfs_read_lock_stats(struct seq_file *s, void *v)
+{
+    uvm_lock_stats_print(s);
+
+    return 0;
+}
+
+static int nv_procfs_read_lock_stats_entry(struct seq_file *s, void *v)
+{
+    UVM_ENTRY_RET(nv_procfs_read_lock_stats(s, v));
+}
+
+UVM_DEFINE_SINGLE_PROCFS_FILE(lock_stats_entry);
+#endif
+
 NV_STATUS uvm_procfs_init()
 {
     if (!uvm_procfs_is_enabled())
@@ -63,6 +80,12 @@ NV_STATUS uvm_procfs_init()
     if (uvm_proc_cpu == NULL)
         return NV_ERR_OPERATING_SYSTEM;
 
+#if UVM_IS_LOCK_STATS()
+    // Removed along with uvm_proc_dir
+    if (NV_CREATE_PROC_FILE("lock_stats", uvm_proc_dir, lock_stats_entry, NULL) == NULL)
+        return NV_ERR_OPERATING_SYSTEM;
+#endif
+
     return NV_OK;
 }
 
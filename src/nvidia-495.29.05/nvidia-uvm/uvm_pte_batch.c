@@ -40,7 +40,6 @@ void uvm_pte_batch_begin(uvm_push_t *push, uvm_pte_batch_t *batch)
 static void uvm_pte_batch_flush_ptes_inline(uvm_pte_batch_t *batch)
 {
     uvm_gpu_address_t inline_data_addr;
-    uvm_gpu_t *gpu = uvm_push_get_gpu(batch->push);
     size_t ptes_size = batch->pte_count * batch->pte_entry_size;
 
     UVM_ASSERT(batch->pte_count != 0);
@@ -53,15 +52,14 @@ static void uvm_pte_batch_flush_ptes_inline(uvm_pte_batch_t *batch)
 
     uvm_push_set_flag(batch->push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
     uvm_push_set_flag(batch->push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
-    gpu->parent->ce_hal->memcopy(batch->push,
-                                 uvm_gpu_address_from_phys(batch->pte_first_address),
-                                 inline_data_addr,
-                                 ptes_size);
+    uvm_hal_ce_memcopy(batch->push,
+                       uvm_gpu_address_from_phys(batch->pte_first_address),
+                       inline_data_addr,
+                       ptes_size);
 }
 
 static void uvm_pte_batch_flush_ptes_memset(uvm_pte_batch_t *batch)
 {
-    uvm_gpu_t *gpu = uvm_push_get_gpu(batch->push);
     uvm_gpu_address_t addr = uvm_gpu_address_from_phys(batch->pte_first_address);
     NvU32 i;
 
@@ -69,10 +67,20 @@ static void uvm_pte_batch_flush_ptes_memset(uvm_pte_batch_t *batch)
     UVM_ASSERT(!batch->inlining);
 
     for (i = 0; i < batch->pte_count; ++i) {
+        NvU32 run = 1;
+
+        // Consecutive identical PTEs can share a memset, as long as each entry
+        // is fully covered by its PTE bits
+        if (batch->pte_entry_size == sizeof(NvU64)) {
+            while (i + run < batch->pte_count && batch->pte_bits_queue[i + run] == batch->pte_bits_queue[i])
+                ++run;
+        }
+
         uvm_push_set_flag(batch->push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
         uvm_push_set_flag(batch->push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
-        gpu->parent->ce_hal->memset_8(batch->push, addr, batch->pte_bits_queue[i], sizeof(NvU64));
-        addr.address += batch->pte_entry_size;
+        uvm_hal_ce_memset_8(batch->push, addr, batch->pte_bits_queue[i], run * sizeof(NvU64));
+        addr.address += run * batch->pte_entry_size;
+        i += run - 1;
     }
 }
 
@@ -129,6 +137,41 @@ static void pte_batch_begin_inline(uvm_pte_batch_t *batch)
         uvm_pte_batch_write_consecutive_inline(batch, batch->pte_bits_queue[i]);
 }
 
+// Number of consecutive entries identical to the first one, or 1 if the
+// entries are not 8 bytes in size
+static NvU32 pte_run_length(const NvU64 *pte_bits, NvU32 entry_size, NvU32 entry_count)
+{
+    NvU32 run = 1;
+
+    if (entry_size != sizeof(NvU64))
+        return 1;
+
+    while (run < entry_count && pte_bits[run] == pte_bits[0])
+        ++run;
+
+    return run;
+}
+
+// Number of leading entries, up to max_entries, to be written from inline
+// data. The segment ends where a memset-able run starts.
+static NvU32 pte_inline_segment_length(const NvU64 *pte_bits, NvU32 entry_size, NvU32 entry_count, NvU32 max_entries)
+{
+    NvU32 count = min(max_entries, entry_count);
+    NvU32 i = 0;
+
+    while (i < count) {
+        NvU32 run = pte_run_length(pte_bits + i, entry_size, entry_count - i);
+
+        if (run >= UVM_PTE_BATCH_MEMSET_MIN_RUN)
+            break;
+
+        i += run;
+    }
+
+    // Always make progress. Also, a short run can extend past count.
+    return max(min(i, count), 1u);
+}
+
 void uvm_pte_batch_write_ptes(uvm_pte_batch_t *batch, uvm_gpu_phys_address_t first_pte, NvU64 *pte_bits, NvU32 entry_size, NvU32 entry_count)
 {
     NvU32 max_entries = UVM_PUSH_INLINE_DATA_MAX_SIZE / entry_size;
@@ -140,11 +183,26 @@ void uvm_pte_batch_write_ptes(uvm_pte_batch_t *batch, uvm_gpu_phys_address_t fir
 
     while (entry_count > 0) {
         NvU32 entries_this_time;
+        NvU32 run = pte_run_length(pte_bits, entry_size, entry_count);
 
         uvm_pte_batch_flush_ptes(batch);
+
+        // Pick the cheapest encoding for the next entries: a single memset
+        // for long runs of identical PTEs, inline data otherwise.
+        if (run >= UVM_PTE_BATCH_MEMSET_MIN_RUN) {
+            uvm_push_set_flag(batch->push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+            uvm_push_set_flag(batch->push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
+            uvm_hal_ce_memset_8(batch->push, uvm_gpu_address_from_phys(first_pte), pte_bits[0], run * entry_size);
+
+            pte_bits += run;
+            first_pte.address += run * entry_size;
+            entry_count -= run;
+            continue;
+        }
+
         pte_batch_begin_inline(batch);
 
-        entries_this_time = min(max_entries, entry_count);
+        entries_this_time = pte_inline_segment_length(pte_bits, entry_size, entry_count, max_entries);
         uvm_push_inline_data_add(&batch->inline_data, pte_bits, entries_this_time * entry_size);
 
         batch->pte_entry_size = entry_size;
@@ -193,17 +251,16 @@ void uvm_pte_batch_write_pte(uvm_pte_batch_t *batch, uvm_gpu_phys_address_t pte,
 
 void uvm_pte_batch_clear_ptes(uvm_pte_batch_t *batch, uvm_gpu_phys_address_t first_pte, NvU64 empty_pte_bits, NvU32 entry_size, NvU32 entry_count)
 {
-    uvm_gpu_t *gpu = uvm_push_get_gpu(batch->push);
 
     // TODO: Bug 1767241: Allow small clears to batch
     uvm_pte_batch_flush_ptes(batch);
 
     uvm_push_set_flag(batch->push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
     uvm_push_set_flag(batch->push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-    gpu->parent->ce_hal->memset_8(batch->push,
-                                  uvm_gpu_address_from_phys(first_pte),
-                                  empty_pte_bits,
-                                  entry_size * entry_count);
+    uvm_hal_ce_memset_8(batch->push,
+                        uvm_gpu_address_from_phys(first_pte),
+                        empty_pte_bits,
+                        entry_size * entry_count);
 
     if (first_pte.aperture == UVM_APERTURE_SYS)
         batch->membar = UVM_MEMBAR_SYS;
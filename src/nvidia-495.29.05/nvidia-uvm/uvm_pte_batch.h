@@ -42,6 +42,13 @@
 //       change as inline memcopy would have lower latency.
 #define UVM_PTE_BATCH_MAX_PTES 4
 
+// Min number of consecutive identical 8-byte PTEs written with a single CE
+// memset instead of being copied from inline data. A memset takes a handful of
+// methods regardless of its size, while inline data takes 8 bytes of
+// pushbuffer per PTE, so long runs (invalid, sparse or otherwise uniform PTEs)
+// are cheaper to memset.
+#define UVM_PTE_BATCH_MEMSET_MIN_RUN 8
+
 struct uvm_pte_batch_struct
 {
     uvm_push_t *push;
@@ -27,6 +27,7 @@
 #include "uvm_channel.h"
 #include "uvm_hal.h"
 #include "uvm_kvmalloc.h"
+#include "uvm_trace.h"
 #include "uvm_linux.h"
 
 // This parameter enables push description tracking in push info. It's enabled
@@ -179,6 +180,8 @@ static NV_STATUS push_begin_acquire_with_info(uvm_channel_t *channel,
 
     push_fill_info(push, filename, function, line, format, args);
 
+    trace_uvm_push_begin(uvm_id_value(push->gpu->id), channel->name);
+
     uvm_push_acquire_tracker(push, tracker);
 
     return NV_OK;
@@ -253,8 +256,12 @@ bool uvm_push_info_is_tracking_acquires()
 void uvm_push_end(uvm_push_t *push)
 {
     uvm_push_flag_t flag;
+    NvU32 push_size = uvm_push_get_size(push);
+
     uvm_channel_end_push(push);
 
+    trace_uvm_push_end(uvm_id_value(push->gpu->id), push->channel->name, push_size, push->channel_tracking_value);
+
     flag = find_first_bit(push->flags, UVM_PUSH_FLAG_COUNT);
 
     // All flags should be reset by the end of the push
@@ -127,6 +127,19 @@ struct uvm_push_info_struct
     // This procedure is called with the UVM_LOCK_ORDER_CHANNEL spin lock held.
     void (*on_complete)(void *);
     void *on_complete_data;
+
+    // Migration counters to update when the push completes, or NULL if the
+    // push does not migrate pages. See
+    // uvm_tools_record_block_migration_end().
+    uvm_gpu_migration_stats_t *migration_stats;
+    NvU64 migration_bytes;
+    NvU64 migration_end_time;
+    bool migration_is_eviction;
+
+    // Fault replay latency sample to complete when the push completes, or
+    // NULL if the push is not a sampled replay. See
+    // uvm_gpu_fault_replay_latency_complete().
+    uvm_fault_replay_latency_t *replay_latency;
 };
 
 typedef struct
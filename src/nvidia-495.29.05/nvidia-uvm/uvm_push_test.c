@@ -435,7 +435,7 @@ static NvU32 test_count_idle_chunks(uvm_pushbuffer_t *pushbuffer)
     NvU32 i;
     NvU32 count = 0;
     for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
-        count += test_bit(i, pushbuffer->idle_chunks) ? 1 : 0;
+        count += UVM_READ_ONCE(pushbuffer->chunks[i].idle) ? 1 : 0;
     return count;
 }
 
@@ -444,7 +444,7 @@ static NvU32 test_count_available_chunks(uvm_pushbuffer_t *pushbuffer)
     NvU32 i;
     NvU32 count = 0;
     for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
-        count += test_bit(i, pushbuffer->available_chunks) ? 1 : 0;
+        count += UVM_READ_ONCE(pushbuffer->chunks[i].available) ? 1 : 0;
     return count;
 }
 
@@ -28,8 +28,10 @@
 #include "uvm_lock.h"
 #include "uvm_procfs.h"
 #include "uvm_push.h"
+#include "uvm_tools.h"
 #include "uvm_kvmalloc.h"
 #include "uvm_gpu.h"
+#include "uvm_gpu_replayable_faults.h"
 #include "uvm_common.h"
 #include "uvm_linux.h"
 
@@ -87,8 +89,6 @@ NV_STATUS uvm_pushbuffer_create_common(uvm_channel_manager_t *channel_manager, b
 
     pushbuffer->channel_manager = channel_manager;
 
-    uvm_spin_lock_init(&pushbuffer->lock, UVM_LOCK_ORDER_LEAF);
-
     // Currently the pushbuffer supports UVM_PUSHBUFFER_CHUNKS of concurrent
     // pushes.
     uvm_sema_init(&pushbuffer->concurrent_pushes_sema, UVM_PUSHBUFFER_CHUNKS, UVM_LOCK_ORDER_PUSH);
@@ -105,11 +105,14 @@ NV_STATUS uvm_pushbuffer_create_common(uvm_channel_manager_t *channel_manager, b
     if (status != NV_OK)
         goto error;
 
-    bitmap_fill(pushbuffer->idle_chunks, UVM_PUSHBUFFER_CHUNKS);
-    bitmap_fill(pushbuffer->available_chunks, UVM_PUSHBUFFER_CHUNKS);
+    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
+        uvm_pushbuffer_chunk_t *chunk = &pushbuffer->chunks[i];
 
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
-        INIT_LIST_HEAD(&pushbuffer->chunks[i].pending_gpfifos);
+        uvm_spin_lock_init(&chunk->lock, UVM_LOCK_ORDER_LEAF);
+        INIT_LIST_HEAD(&chunk->pending_gpfifos);
+        chunk->idle = true;
+        chunk->available = true;
+    }
 
     if (with_procfs) {
         status = create_procfs(pushbuffer);
@@ -126,28 +129,6 @@ error:
     return status;
 }
 
-static uvm_pushbuffer_chunk_t *get_chunk_in_mask(uvm_pushbuffer_t *pushbuffer, unsigned long *mask)
-{
-    NvU32 index = find_first_bit(mask, UVM_PUSHBUFFER_CHUNKS);
-
-    uvm_assert_spinlock_locked(&pushbuffer->lock);
-
-    if (index == UVM_PUSHBUFFER_CHUNKS)
-        return NULL;
-
-    return &pushbuffer->chunks[index];
-}
-
-static uvm_pushbuffer_chunk_t *get_available_chunk(uvm_pushbuffer_t *pushbuffer)
-{
-    return get_chunk_in_mask(pushbuffer, pushbuffer->available_chunks);
-}
-
-static uvm_pushbuffer_chunk_t *get_idle_chunk(uvm_pushbuffer_t *pushbuffer)
-{
-    return get_chunk_in_mask(pushbuffer, pushbuffer->idle_chunks);
-}
-
 static NvU32 chunk_get_index(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *chunk)
 {
     NvU32 index = chunk - pushbuffer->chunks;
@@ -160,55 +141,59 @@ static NvU32 chunk_get_offset(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk
     return chunk_get_index(pushbuffer, chunk) * UVM_PUSHBUFFER_CHUNK_SIZE;
 }
 
-static void set_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *chunk, unsigned long *mask)
+// Claim the chunk for the push if it is still available
+static bool chunk_try_claim(uvm_pushbuffer_chunk_t *chunk, uvm_push_t *push)
 {
-    NvU32 index = chunk_get_index(pushbuffer, chunk);
-
-    uvm_assert_spinlock_locked(&pushbuffer->lock);
+    bool claimed;
 
-    __set_bit(index, mask);
-}
+    uvm_spin_lock(&chunk->lock);
 
-static void clear_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *chunk, unsigned long *mask)
-{
-    NvU32 index = chunk_get_index(pushbuffer, chunk);
+    claimed = chunk->available;
+    if (claimed) {
+        chunk->current_push = push;
+        UVM_WRITE_ONCE(chunk->idle, false);
+        UVM_WRITE_ONCE(chunk->available, false);
+    }
 
-    uvm_assert_spinlock_locked(&pushbuffer->lock);
+    uvm_spin_unlock(&chunk->lock);
 
-    __clear_bit(index, mask);
+    return claimed;
 }
 
-static uvm_pushbuffer_chunk_t *pick_chunk(uvm_pushbuffer_t *pushbuffer)
+static NvU32 pushbuffer_home_chunk_index(void)
 {
-    uvm_pushbuffer_chunk_t *chunk = get_idle_chunk(pushbuffer);
-
-    uvm_assert_spinlock_locked(&pushbuffer->lock);
-
-    if (chunk == NULL)
-        chunk = get_available_chunk(pushbuffer);
-
-    return chunk;
+    // The CPU can change right after this, which only affects where the scan
+    // for a chunk starts.
+    return raw_smp_processor_id() % UVM_PUSHBUFFER_CHUNKS;
 }
 
 static bool try_claim_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm_pushbuffer_chunk_t **chunk_out)
 {
-    uvm_pushbuffer_chunk_t *chunk;
+    NvU32 home = pushbuffer_home_chunk_index();
+    NvU32 i;
 
-    uvm_spin_lock(&pushbuffer->lock);
+    // Prefer idle chunks, starting with the home chunk of the current CPU
+    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
+        uvm_pushbuffer_chunk_t *chunk = &pushbuffer->chunks[(home + i) % UVM_PUSHBUFFER_CHUNKS];
+
+        if (UVM_READ_ONCE(chunk->idle) && chunk_try_claim(chunk, push)) {
+            *chunk_out = chunk;
+            return true;
+        }
+    }
 
-    chunk = pick_chunk(pushbuffer);
-    if (!chunk)
-        goto done;
+    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
+        uvm_pushbuffer_chunk_t *chunk = &pushbuffer->chunks[(home + i) % UVM_PUSHBUFFER_CHUNKS];
 
-    chunk->current_push = push;
-    clear_chunk(pushbuffer, chunk, pushbuffer->idle_chunks);
-    clear_chunk(pushbuffer, chunk, pushbuffer->available_chunks);
+        if (UVM_READ_ONCE(chunk->available) && chunk_try_claim(chunk, push)) {
+            *chunk_out = chunk;
+            return true;
+        }
+    }
 
-done:
-    uvm_spin_unlock(&pushbuffer->lock);
-    *chunk_out = chunk;
+    *chunk_out = NULL;
 
-    return chunk != NULL;
+    return false;
 }
 
 static NvU32 *chunk_get_next_push_start_addr(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *chunk)
@@ -240,6 +225,9 @@ static NV_STATUS claim_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
         uvm_channel_manager_update_progress(channel_manager);
     }
 
+    atomic64_inc(&pushbuffer->stats.chunk_stalls);
+    atomic64_add(uvm_spin_loop_elapsed(&spin), &pushbuffer->stats.chunk_stall_time_ns);
+
     return status;
 }
 
@@ -283,7 +271,7 @@ static NvU32 chunk_get_cpu_put(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chun
 {
     uvm_gpfifo_entry_t *gpfifo = chunk_get_last_gpfifo(chunk);
 
-    uvm_assert_spinlock_locked(&pushbuffer->lock);
+    uvm_assert_spinlock_locked(&chunk->lock);
 
     if (gpfifo != NULL)
         return gpfifo->pushbuffer_offset + gpfifo->pushbuffer_size - chunk_get_offset(pushbuffer, chunk);
@@ -296,7 +284,7 @@ static NvU32 chunk_get_gpu_get(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chun
 {
     uvm_gpfifo_entry_t *gpfifo = chunk_get_first_gpfifo(chunk);
 
-    uvm_assert_spinlock_locked(&pushbuffer->lock);
+    uvm_assert_spinlock_locked(&chunk->lock);
 
     if (gpfifo != NULL)
         return gpfifo->pushbuffer_offset - chunk_get_offset(pushbuffer, chunk);
@@ -309,7 +297,7 @@ static void update_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *c
     NvU32 gpu_get = chunk_get_gpu_get(pushbuffer, chunk);
     NvU32 cpu_put = chunk_get_cpu_put(pushbuffer, chunk);
 
-    uvm_assert_spinlock_locked(&pushbuffer->lock);
+    uvm_assert_spinlock_locked(&chunk->lock);
 
     if (gpu_get == cpu_put) {
         // cpu_put can be equal to gpu_get both when the chunk is full and empty. We
@@ -319,8 +307,8 @@ static void update_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *c
             return;
 
         // Chunk completely idle
-        set_chunk(pushbuffer, chunk, pushbuffer->idle_chunks);
-        set_chunk(pushbuffer, chunk, pushbuffer->available_chunks);
+        UVM_WRITE_ONCE(chunk->idle, true);
+        UVM_WRITE_ONCE(chunk->available, true);
         UVM_ASSERT_MSG(cpu_put == 0, "cpu put %u\n", cpu_put);
 
         // For a completely idle chunk, always start at the very beginning. This
@@ -331,7 +319,7 @@ static void update_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *c
     else if (gpu_get > cpu_put) {
         if (gpu_get - cpu_put >= UVM_MAX_PUSH_SIZE) {
             // Enough space between put and get
-            set_chunk(pushbuffer, chunk, pushbuffer->available_chunks);
+            UVM_WRITE_ONCE(chunk->available, true);
             chunk->next_push_start = cpu_put;
         }
     }
@@ -339,14 +327,14 @@ static void update_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *c
         UVM_ASSERT_MSG(gpu_get < cpu_put, "gpu_get %u cpu_put %u\n", gpu_get, cpu_put);
 
         // Enough space at the end
-        set_chunk(pushbuffer, chunk, pushbuffer->available_chunks);
+        UVM_WRITE_ONCE(chunk->available, true);
         chunk->next_push_start = cpu_put;
     }
     else if (gpu_get >= UVM_MAX_PUSH_SIZE) {
         UVM_ASSERT_MSG(gpu_get < cpu_put, "gpu_get %u cpu_put %u\n", gpu_get, cpu_put);
 
         // Enough space at the beginning
-        set_chunk(pushbuffer, chunk, pushbuffer->available_chunks);
+        UVM_WRITE_ONCE(chunk->available, true);
         chunk->next_push_start = 0;
     }
 }
@@ -387,7 +375,15 @@ void uvm_pushbuffer_mark_completed(uvm_pushbuffer_t *pushbuffer, uvm_gpfifo_entr
     push_info->on_complete = NULL;
     push_info->on_complete_data = NULL;
 
-    uvm_spin_lock(&pushbuffer->lock);
+    if (push_info->migration_stats != NULL)
+        uvm_tools_record_block_migration_complete(push_info);
+
+    if (push_info->replay_latency != NULL) {
+        uvm_gpu_fault_replay_latency_complete(push_info->replay_latency);
+        push_info->replay_latency = NULL;
+    }
+
+    uvm_spin_lock(&chunk->lock);
 
     if (gpfifo == chunk_get_first_gpfifo(chunk))
         need_to_update_chunk = true;
@@ -401,7 +397,7 @@ void uvm_pushbuffer_mark_completed(uvm_pushbuffer_t *pushbuffer, uvm_gpfifo_entr
     if (need_to_update_chunk && chunk->current_push == NULL)
         update_chunk(pushbuffer, chunk);
 
-    uvm_spin_unlock(&pushbuffer->lock);
+    uvm_spin_unlock(&chunk->lock);
 }
 
 NvU32 uvm_pushbuffer_get_offset_for_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push)
@@ -430,7 +426,7 @@ void uvm_pushbuffer_end_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
 
     uvm_assert_spinlock_locked(&push->channel->pool->lock);
 
-    uvm_spin_lock(&pushbuffer->lock);
+    uvm_spin_lock(&chunk->lock);
 
     list_add_tail(&gpfifo->pending_list_node, &chunk->pending_gpfifos);
 
@@ -439,7 +435,7 @@ void uvm_pushbuffer_end_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
     UVM_ASSERT(chunk->current_push == push);
     chunk->current_push = NULL;
 
-    uvm_spin_unlock(&pushbuffer->lock);
+    uvm_spin_unlock(&chunk->lock);
 
     // uvm_pushbuffer_end_push() needs to be called with the channel lock held
     // while the concurrent pushes sema has a higher lock order. To keep the
@@ -449,15 +445,14 @@ void uvm_pushbuffer_end_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
 
 bool uvm_pushbuffer_has_space(uvm_pushbuffer_t *pushbuffer)
 {
-    bool has_space;
-
-    uvm_spin_lock(&pushbuffer->lock);
-
-    has_space = pick_chunk(pushbuffer) != NULL;
+    NvU32 i;
 
-    uvm_spin_unlock(&pushbuffer->lock);
+    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
+        if (UVM_READ_ONCE(pushbuffer->chunks[i].available))
+            return true;
+    }
 
-    return has_space;
+    return false;
 }
 
 void uvm_pushbuffer_print_common(uvm_pushbuffer_t *pushbuffer, struct seq_file *s)
@@ -466,22 +461,27 @@ void uvm_pushbuffer_print_common(uvm_pushbuffer_t *pushbuffer, struct seq_file *
 
     UVM_SEQ_OR_DBG_PRINT(s, "Pushbuffer for GPU %s\n", uvm_gpu_name(pushbuffer->channel_manager->gpu));
     UVM_SEQ_OR_DBG_PRINT(s, " has space: %d\n", uvm_pushbuffer_has_space(pushbuffer));
-
-    uvm_spin_lock(&pushbuffer->lock);
+    UVM_SEQ_OR_DBG_PRINT(s, " chunk stalls: %lld\n", atomic64_read(&pushbuffer->stats.chunk_stalls));
+    UVM_SEQ_OR_DBG_PRINT(s, " chunk stall time: %lld us\n",
+                         atomic64_read(&pushbuffer->stats.chunk_stall_time_ns) / 1000);
 
     for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
         uvm_pushbuffer_chunk_t *chunk = &pushbuffer->chunks[i];
-        NvU32 cpu_put = chunk_get_cpu_put(pushbuffer, chunk);
-        NvU32 gpu_get = chunk_get_gpu_get(pushbuffer, chunk);
+        NvU32 cpu_put;
+        NvU32 gpu_get;
+
+        uvm_spin_lock(&chunk->lock);
+
+        cpu_put = chunk_get_cpu_put(pushbuffer, chunk);
+        gpu_get = chunk_get_gpu_get(pushbuffer, chunk);
         UVM_SEQ_OR_DBG_PRINT(s, " chunk %u put %u get %u next %u available %d idle %d\n",
                 i,
                 cpu_put, gpu_get, chunk->next_push_start,
-                test_bit(i, pushbuffer->available_chunks) ? 1 : 0,
-                test_bit(i, pushbuffer->idle_chunks) ? 1 : 0);
+                chunk->available ? 1 : 0,
+                chunk->idle ? 1 : 0);
 
+        uvm_spin_unlock(&chunk->lock);
     }
-
-    uvm_spin_unlock(&pushbuffer->lock);
 }
 
 void uvm_pushbuffer_print(uvm_pushbuffer_t *pushbuffer)
@@ -56,13 +56,17 @@
 // The pushbuffer backing store is a single big allocation logically divided
 // into largely independent parts called chunks.
 // Each chunk is roughly a ringbuffer tracking multiple pending pushes being
-// processed by the GPU. The pushbuffer maintains two bitmaps, one tracking
-// completely idle (with no pending pushes) chunks and a second one tracking
-// available (with pending pushes, but still enough space for a new push)
-// chunks. When a new allocation is requested, idle chunks are always used
-// first and after that available chunks are consulted. If none are available,
-// the CPU spin waits on the GPU to complete some of the pending pushes making
-// space for a new one.
+// processed by the GPU. Each chunk has its own lock and tracks whether it is
+// completely idle (with no pending pushes) and whether it is available (with
+// pending pushes, but still enough space for a new push). When a new allocation
+// is requested, idle chunks are always used first and after that available
+// chunks are consulted. If none are available, the CPU spin waits on the GPU to
+// complete some of the pending pushes making space for a new one.
+//
+// The chunks are scanned starting from a home chunk derived from the current
+// CPU, so that pushes begun concurrently on different CPUs tend to claim
+// different chunks and do not contend on the same lock and cache lines. Chunks
+// homed on other CPUs are claimed when the home chunk is not usable.
 //
 // To explain how chunks track pending pushes we will go through an example
 // modifying a chunk's state. Let's start with a few pending pushes in the
@@ -157,6 +161,19 @@
 
 typedef struct
 {
+    // Lock protecting the chunk state below
+    uvm_spinlock_t lock;
+
+    // The chunk does not have an on-going push and has at least
+    // UVM_MAX_PUSH_SIZE space free. Can be read without the lock to pick a
+    // candidate chunk, but needs to be checked again with the lock held before
+    // claiming it.
+    bool available;
+
+    // The chunk does not have an on-going push nor any pending pushes. Same
+    // locking rules as available.
+    bool idle;
+
     // Offset within the chunk of where a next push should begin if there is
     // space for one. Updated in update_chunk().
     NvU32 next_push_start;
@@ -167,7 +184,7 @@ typedef struct
 
     // Currently on-going push in the chunk. There can be only one at a time.
     uvm_push_t *current_push;
-} uvm_pushbuffer_chunk_t;
+} ____cacheline_aligned_in_smp uvm_pushbuffer_chunk_t;
 
 struct uvm_pushbuffer_struct
 {
@@ -179,16 +196,6 @@ struct uvm_pushbuffer_struct
     // Array of the pushbuffer chunks
     uvm_pushbuffer_chunk_t chunks[UVM_PUSHBUFFER_CHUNKS];
 
-    // Chunks that do not have an on-going push and have at least
-    // UVM_MAX_PUSH_SIZE space free.
-    DECLARE_BITMAP(available_chunks, UVM_PUSHBUFFER_CHUNKS);
-
-    // Chunks that do not have an on-going push nor any pending pushes.
-    DECLARE_BITMAP(idle_chunks, UVM_PUSHBUFFER_CHUNKS);
-
-    // Lock protecting chunk state and the bitmaps.
-    uvm_spinlock_t lock;
-
     // Semaphore enforcing a limited number of concurrent pushes.
     // Decremented in uvm_pushbuffer_begin_push(), incremented in
     // uvm_pushbuffer_end_push().
@@ -196,6 +203,14 @@ struct uvm_pushbuffer_struct
     // are supported.
     uvm_semaphore_t concurrent_pushes_sema;
 
+    // Pushes that had to wait for a chunk to become available, and the total
+    // time spent waiting
+    struct
+    {
+        atomic64_t chunk_stalls;
+        atomic64_t chunk_stall_time_ns;
+    } stats;
+
     struct
     {
         struct proc_dir_entry *info_file;
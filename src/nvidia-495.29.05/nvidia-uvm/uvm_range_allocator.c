@@ -24,28 +24,64 @@
 #include "uvm_range_allocator.h"
 #include "uvm_kvmalloc.h"
 
+static uvm_range_allocator_node_t *allocator_node(uvm_range_tree_node_t *node)
+{
+    return container_of(node, uvm_range_allocator_node_t, node);
+}
+
+static NvU32 node_size_class(uvm_range_tree_node_t *node)
+{
+    // Free ranges are at most range_allocator->size big, so the size can't
+    // overflow.
+    return ilog2(uvm_range_tree_node_size(node));
+}
+
+static void free_list_add(uvm_range_allocator_t *range_allocator, uvm_range_tree_node_t *node)
+{
+    NvU32 size_class = node_size_class(node);
+
+    list_add(&allocator_node(node)->free_list_node, &range_allocator->free_lists[size_class]);
+    range_allocator->free_classes_mask |= 1ULL << size_class;
+}
+
+static void free_list_remove(uvm_range_allocator_t *range_allocator, uvm_range_tree_node_t *node)
+{
+    NvU32 size_class = node_size_class(node);
+
+    list_del(&allocator_node(node)->free_list_node);
+    if (list_empty(&range_allocator->free_lists[size_class]))
+        range_allocator->free_classes_mask &= ~(1ULL << size_class);
+}
+
 NV_STATUS uvm_range_allocator_init(NvU64 size, uvm_range_allocator_t *range_allocator)
 {
     NV_STATUS status;
-    uvm_range_tree_node_t *node;
+    uvm_range_allocator_node_t *node;
+    NvU32 i;
 
     uvm_spin_lock_init(&range_allocator->lock, UVM_LOCK_ORDER_LEAF);
     uvm_range_tree_init(&range_allocator->range_tree);
 
+    for (i = 0; i < UVM_RANGE_ALLOCATOR_SIZE_CLASSES; i++)
+        INIT_LIST_HEAD(&range_allocator->free_lists[i]);
+    range_allocator->free_classes_mask = 0;
+
     UVM_ASSERT(size > 0);
 
     node = uvm_kvmalloc(sizeof(*node));
     if (!node)
         return NV_ERR_NO_MEMORY;
 
-    node->start = 0;
-    node->end = size - 1;
+    node->node.start = 0;
+    node->node.end = size - 1;
 
-    status = uvm_range_tree_add(&range_allocator->range_tree, node);
+    status = uvm_range_tree_add(&range_allocator->range_tree, &node->node);
     UVM_ASSERT(status == NV_OK);
 
     range_allocator->size = size;
 
+    free_list_add(range_allocator, &node->node);
+
     return NV_OK;
 }
 
@@ -59,15 +95,33 @@ void uvm_range_allocator_deinit(uvm_range_allocator_t *range_allocator)
 
     // Remove the node for completeness even though after deinit the state of
     // tree doesn't matter anyway.
+    free_list_remove(range_allocator, node);
     uvm_range_tree_remove(&range_allocator->range_tree, node);
+    UVM_ASSERT(range_allocator->free_classes_mask == 0);
+
+    uvm_kvfree(allocator_node(node));
+}
 
-    uvm_kvfree(node);
+// Returns the lowest aligned start of a range of the given size within the
+// node, or 0 with *fits set to false if there is none.
+static NvU64 node_aligned_start(uvm_range_tree_node_t *node, NvU64 size, NvU64 alignment, bool *fits)
+{
+    NvU64 aligned_start = UVM_ALIGN_UP(node->start, alignment);
+    NvU64 aligned_end = aligned_start + size - 1;
+
+    // Check for overflow of aligned_start and aligned_end, and whether it fits
+    *fits = aligned_start >= node->start && aligned_end >= aligned_start && aligned_end <= node->end;
+
+    return *fits ? aligned_start : 0;
 }
 
 NV_STATUS uvm_range_allocator_alloc(uvm_range_allocator_t *range_allocator, NvU64 size, NvU64 alignment, uvm_range_allocation_t *range_alloc)
 {
-    uvm_range_tree_node_t *node;
-    bool found = false;
+    uvm_range_allocator_node_t *alloc_node;
+    uvm_range_tree_node_t *node = NULL;
+    NvU64 aligned_start = 0;
+    NvU64 aligned_end;
+    NvU64 classes_mask;
 
     UVM_ASSERT(size > 0);
 
@@ -81,59 +135,75 @@ NV_STATUS uvm_range_allocator_alloc(uvm_range_allocator_t *range_allocator, NvU6
 
     // Pre-allocate a tree node as part of the allocation so that freeing the
     // range won't require allocating memory and will always succeed.
-    range_alloc->node = uvm_kvmalloc(sizeof(*range_alloc->node));
-    if (!range_alloc->node)
+    alloc_node = uvm_kvmalloc(sizeof(*alloc_node));
+    if (!alloc_node)
         return NV_ERR_NO_MEMORY;
 
     uvm_spin_lock(&range_allocator->lock);
 
-    // This is a very simple brute force going over all the free ranges in
-    // address order and returning the first one that's big enough.
-    // This could be improved by e.g. also maintaining a binary tree of free
-    // ranges ordered by their size.
-    uvm_range_tree_for_each_in(node, &range_allocator->range_tree, 0, range_allocator->size - size) {
-        NvU64 aligned_start = UVM_ALIGN_UP(node->start, alignment);
-        NvU64 aligned_end = aligned_start + size - 1;
-
-        // Check for overflow of aligned_start and aligned_end
-        if (aligned_start < node->start || aligned_end < aligned_start)
-            continue;
-
-        // Check whether it fits
-        if (aligned_end > node->end)
-            continue;
-
-        // The allocation always wastes the [node->start, aligned_start) space,
-        // but it's expected that there will always be plenty of free space to
-        // allocate from and wasting that space should help avoid fragmentation.
-
-        range_alloc->aligned_start = aligned_start;
-        range_alloc->node->start = node->start;
-        range_alloc->node->end = aligned_end;
-
-        if (aligned_end < node->end) {
-            // Shrink the node if the claimed size is smaller than the node.
-            uvm_range_tree_shrink_node(&range_allocator->range_tree, node, aligned_end + 1, node->end);
-        }
-        else {
-            // Otherwise just remove it. The removal is safe to do in the loop
-            // over nodes as a break is following immediately.
-            UVM_ASSERT(node->end == aligned_end);
-            uvm_range_tree_remove(&range_allocator->range_tree, node);
-            uvm_kvfree(node);
+    // Free ranges in classes below the one of size are all too small. Look for
+    // the best fit in the lowest class with any fit. Beyond the class of size,
+    // all the free ranges are big enough and only the alignment can prevent a
+    // fit, so the first class searched usually has one.
+    classes_mask = range_allocator->free_classes_mask & ~((1ULL << ilog2(size)) - 1);
+    while (classes_mask && !node) {
+        NvU32 size_class = __ffs64(classes_mask);
+        uvm_range_allocator_node_t *free_node;
+
+        classes_mask &= ~(1ULL << size_class);
+
+        list_for_each_entry(free_node, &range_allocator->free_lists[size_class], free_list_node) {
+            bool fits;
+            NvU64 start = node_aligned_start(&free_node->node, size, alignment, &fits);
+
+            if (!fits)
+                continue;
+
+            if (!node ||
+                uvm_range_tree_node_size(&free_node->node) < uvm_range_tree_node_size(node) ||
+                (uvm_range_tree_node_size(&free_node->node) == uvm_range_tree_node_size(node) &&
+                 free_node->node.start < node->start)) {
+                node = &free_node->node;
+                aligned_start = start;
+            }
         }
-        found = true;
-        break;
     }
 
-    uvm_spin_unlock(&range_allocator->lock);
-
-    if (!found) {
-        uvm_kvfree(range_alloc->node);
+    if (!node) {
+        uvm_spin_unlock(&range_allocator->lock);
+        uvm_kvfree(alloc_node);
         range_alloc->node = NULL;
         return NV_ERR_UVM_ADDRESS_IN_USE;
     }
 
+    aligned_end = aligned_start + size - 1;
+
+    // The allocation always wastes the [node->start, aligned_start) space,
+    // but it's expected that there will always be plenty of free space to
+    // allocate from and wasting that space should help avoid fragmentation.
+
+    range_alloc->aligned_start = aligned_start;
+    range_alloc->node = &alloc_node->node;
+    range_alloc->node->start = node->start;
+    range_alloc->node->end = aligned_end;
+
+    free_list_remove(range_allocator, node);
+
+    if (aligned_end < node->end) {
+        // Shrink the node if the claimed size is smaller than the node, and
+        // move it to the list of its new size class.
+        uvm_range_tree_shrink_node(&range_allocator->range_tree, node, aligned_end + 1, node->end);
+        free_list_add(range_allocator, node);
+    }
+    else {
+        // Otherwise just remove it
+        UVM_ASSERT(node->end == aligned_end);
+        uvm_range_tree_remove(&range_allocator->range_tree, node);
+        uvm_kvfree(allocator_node(node));
+    }
+
+    uvm_spin_unlock(&range_allocator->lock);
+
     return NV_OK;
 }
 
@@ -141,6 +211,7 @@ void uvm_range_allocator_free(uvm_range_allocator_t *range_allocator, uvm_range_
 {
     NV_STATUS status;
     uvm_range_tree_node_t *adjacent_node;
+    uvm_range_tree_node_t *prev, *next;
 
     if (!range_alloc)
         return;
@@ -153,14 +224,25 @@ void uvm_range_allocator_free(uvm_range_allocator_t *range_allocator, uvm_range_
     status = uvm_range_tree_add(&range_allocator->range_tree, range_alloc->node);
     UVM_ASSERT(status == NV_OK);
 
-    // And try merging it with adjacent nodes
-    adjacent_node = uvm_range_tree_merge_prev(&range_allocator->range_tree, range_alloc->node);
-    if (adjacent_node)
-        uvm_kvfree(adjacent_node);
+    // And try merging it with adjacent nodes. The adjacent nodes are taken out
+    // of their free lists first, as merging changes the size of the nodes.
+    prev = uvm_range_tree_prev(&range_allocator->range_tree, range_alloc->node);
+    if (prev && prev->end + 1 == range_alloc->node->start) {
+        free_list_remove(range_allocator, prev);
+        adjacent_node = uvm_range_tree_merge_prev(&range_allocator->range_tree, range_alloc->node);
+        UVM_ASSERT(adjacent_node == prev);
+        uvm_kvfree(allocator_node(adjacent_node));
+    }
+
+    next = uvm_range_tree_next(&range_allocator->range_tree, range_alloc->node);
+    if (next && range_alloc->node->end + 1 == next->start) {
+        free_list_remove(range_allocator, next);
+        adjacent_node = uvm_range_tree_merge_next(&range_allocator->range_tree, range_alloc->node);
+        UVM_ASSERT(adjacent_node == next);
+        uvm_kvfree(allocator_node(adjacent_node));
+    }
 
-    adjacent_node = uvm_range_tree_merge_next(&range_allocator->range_tree, range_alloc->node);
-    if (adjacent_node)
-        uvm_kvfree(adjacent_node);
+    free_list_add(range_allocator, range_alloc->node);
 
     uvm_spin_unlock(&range_allocator->lock);
 
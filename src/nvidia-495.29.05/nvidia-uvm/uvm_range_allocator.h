@@ -27,6 +27,9 @@
 #include "uvm_range_tree.h"
 #include "uvm_lock.h"
 
+// Free ranges are kept in size classes by the log2 of their size
+#define UVM_RANGE_ALLOCATOR_SIZE_CLASSES 64
+
 typedef struct {
     // Lock protecting the state of the range allocator
     uvm_spinlock_t lock;
@@ -36,8 +39,24 @@ typedef struct {
 
     // Range tree tracking all the free ranges
     uvm_range_tree_t range_tree;
+
+    // Lists of the free ranges in the range tree, by size class. Class i holds
+    // the free ranges with sizes in [2^i, 2^(i + 1)).
+    struct list_head free_lists[UVM_RANGE_ALLOCATOR_SIZE_CLASSES];
+
+    // Mask of the size classes with non-empty free lists
+    NvU64 free_classes_mask;
 } uvm_range_allocator_t;
 
+// Node of the range tree of a range allocator
+typedef struct {
+    uvm_range_tree_node_t node;
+
+    // Entry in the free list of the size class of the node, while the node is
+    // in the range tree
+    struct list_head free_list_node;
+} uvm_range_allocator_node_t;
+
 // A free range allocation
 typedef struct {
     // The allocated start of the range
@@ -45,7 +64,8 @@ typedef struct {
 
     // A tree node allocated at the time of range allocation and used by the
     // range allocator when the range allocation is freed. This allows to
-    // guarantee that uvm_range_allocator_free() always succeeds.
+    // guarantee that uvm_range_allocator_free() always succeeds. The node is
+    // embedded in a uvm_range_allocator_node_t.
     uvm_range_tree_node_t *node;
 } uvm_range_allocation_t;
 
@@ -59,6 +79,10 @@ void uvm_range_allocator_deinit(uvm_range_allocator_t *range_allocator);
 
 // Alloc a free range of the given size and alignment
 //
+// The range is allocated from the smallest free range that can hold it within
+// the lowest size class that has one, at the lowest aligned address in that
+// free range.
+//
 // Size needs to be greater or equal to 1.
 // Alignment needs to be a power of 2 or 0. Alignment of 0 is converted into
 // alignment of 1.
@@ -193,6 +193,61 @@ static NV_STATUS basic_test(void)
     return NV_OK;
 }
 
+#define BEST_FIT_TEST_SIZE 1024
+
+// Check that allocations come from the smallest free range they fit in,
+// rather than from the lowest address.
+static NV_STATUS best_fit_test(void)
+{
+    NV_STATUS status;
+    uvm_range_allocator_t range_allocator;
+    uvm_range_allocation_t range_allocs[6];
+    NvU32 i;
+
+    status = uvm_range_allocator_init(BEST_FIT_TEST_SIZE, &range_allocator);
+    TEST_CHECK_RET(status == NV_OK);
+
+    // [0, 128), [128, 192), [192, 320), [320, 352) and the rest
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 128, 1, &range_allocs[0]) == NV_OK);
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 64, 1, &range_allocs[1]) == NV_OK);
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 128, 1, &range_allocs[2]) == NV_OK);
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 32, 1, &range_allocs[3]) == NV_OK);
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, BEST_FIT_TEST_SIZE - 352, 1, &range_allocs[4]) == NV_OK);
+    TEST_CHECK_RET(range_allocs[3].aligned_start == 320);
+
+    // Leave free ranges [0, 192) and [320, 352)
+    test_free_range(&range_allocator, &range_allocs[0]);
+    test_free_range(&range_allocator, &range_allocs[1]);
+    test_free_range(&range_allocator, &range_allocs[3]);
+    TEST_CHECK_RET(test_check_free_range(&range_allocator, 0, 192) == NV_OK);
+    TEST_CHECK_RET(test_check_free_range(&range_allocator, 320, 32) == NV_OK);
+
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 16, 1, &range_allocs[0]) == NV_OK);
+    TEST_CHECK_RET(range_allocs[0].aligned_start == 320);
+
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 100, 1, &range_allocs[1]) == NV_OK);
+    TEST_CHECK_RET(range_allocs[1].aligned_start == 0);
+
+    // Only the alignment prevents the fit in [336, 352)
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 8, 32, &range_allocs[3]) == NV_OK);
+    TEST_CHECK_RET(range_allocs[3].aligned_start == 128);
+
+    test_free_range(&range_allocator, &range_allocs[0]);
+    test_free_range(&range_allocator, &range_allocs[1]);
+    test_free_range(&range_allocator, &range_allocs[3]);
+    test_free_range(&range_allocator, &range_allocs[2]);
+    test_free_range(&range_allocator, &range_allocs[4]);
+
+    TEST_CHECK_RET(test_check_range_allocator_empty(&range_allocator) == NV_OK);
+
+    for (i = 0; i < UVM_RANGE_ALLOCATOR_SIZE_CLASSES; i++)
+        TEST_CHECK_RET(list_empty(&range_allocator.free_lists[i]) == (i != ilog2(BEST_FIT_TEST_SIZE)));
+
+    uvm_range_allocator_deinit(&range_allocator);
+
+    return NV_OK;
+}
+
 #define RANDOM_TEST_SIZE 1024
 
 typedef struct
@@ -345,6 +400,7 @@ static NV_STATUS random_test(NvU32 iters, NvU32 seed, bool verbose)
 NV_STATUS uvm_test_range_allocator_sanity(UVM_TEST_RANGE_ALLOCATOR_SANITY_PARAMS *params, struct file *filp)
 {
     TEST_CHECK_RET(basic_test() == NV_OK);
+    TEST_CHECK_RET(best_fit_test() == NV_OK);
     TEST_CHECK_RET(random_test(params->iters, params->seed, params->verbose > 0) == NV_OK);
 
     return NV_OK;
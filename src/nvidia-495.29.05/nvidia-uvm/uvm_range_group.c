@@ -263,7 +263,7 @@ NV_STATUS uvm_range_group_va_range_migrate(uvm_va_range_t *va_range,
     if (!va_block_context)
         return NV_ERR_NO_MEMORY;
 
-    uvm_assert_rwsem_locked(&va_range->va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_range->va_space->lock);
 
     // Iterate over blocks, populating them if necessary
     for (i = uvm_va_range_block_index(va_range, start); i <= uvm_va_range_block_index(va_range, end); ++i) {
@@ -386,7 +386,7 @@ static NV_STATUS uvm_range_group_prevent_migration(uvm_range_group_t *range_grou
     UVM_ASSERT(range_group);
     UVM_ASSERT(va_space);
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     // Move the range group's migrated_ranges list to the local_migrated_ranges
     // list and process it from there.
@@ -549,7 +549,7 @@ NV_STATUS uvm_range_group_assign_range(uvm_va_space_t *va_space, uvm_range_group
     uvm_range_group_range_t *new_rgr = NULL;
     LIST_HEAD(internal_nodes);
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     if (range_group != NULL) {
         new_rgr = range_group_range_create(range_group, start, end);
@@ -670,7 +670,7 @@ bool uvm_range_group_all_migratable(uvm_va_space_t *va_space, NvU64 start, NvU64
 uvm_range_group_range_t *uvm_range_group_range_find(uvm_va_space_t *va_space, NvU64 addr)
 {
     uvm_range_tree_node_t *node;
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     node = uvm_range_tree_find(&va_space->range_group_ranges, addr);
     return range_group_range_container(node);
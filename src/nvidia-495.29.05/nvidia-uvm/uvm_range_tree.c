@@ -23,6 +23,41 @@
 
 #include "uvm_common.h"
 #include "uvm_range_tree.h"
+#include "uvm_kvmalloc.h"
+#include "uvm_lock.h"
+
+// Arbitrary initial capacity of the index arrays, doubled as needed
+#define RANGE_TREE_INDEX_MIN_ENTRIES 64
+
+struct uvm_range_tree_index_struct
+{
+    // Serializes rebuilds, which are done by lookups
+    uvm_spinlock_t lock;
+
+    // Lookups which race with a rebuild fall back to the rb tree
+    seqcount_t seq;
+
+    // Whether the arrays below reflect the current state of the tree. Cleared
+    // by every mutation, set by rebuilds.
+    bool valid;
+
+    // Number of nodes in the tree
+    NvU32 num_nodes;
+
+    // Number of entries which fit in the arrays. If it is smaller than
+    // num_nodes because growing failed, the index is not used.
+    NvU32 max_entries;
+
+    // Number of valid entries in the arrays
+    NvU32 count;
+
+    // Starts of the nodes, sorted. Kept separate from the nodes so the binary
+    // search only touches this array.
+    NvU64 *starts;
+
+    // Nodes in the same order as starts
+    uvm_range_tree_node_t **nodes;
+};
 
 static uvm_range_tree_node_t *get_range_node(struct rb_node *rb_node)
 {
@@ -95,6 +130,122 @@ static uvm_range_tree_node_t *range_node_find(uvm_range_tree_t *tree,
     return node;
 }
 
+// Grow the index arrays to fit at least num_entries. Mutations are exclusive
+// with lookups, so the arrays can be replaced without synchronization.
+static void range_tree_index_grow(uvm_range_tree_index_t *index, NvU32 num_entries)
+{
+    NvU32 new_max = max((NvU32)RANGE_TREE_INDEX_MIN_ENTRIES, index->max_entries);
+    NvU64 *new_starts;
+    uvm_range_tree_node_t **new_nodes;
+
+    while (new_max < num_entries)
+        new_max *= 2;
+
+    new_starts = uvm_kvmalloc(new_max * sizeof(*new_starts));
+    new_nodes = uvm_kvmalloc(new_max * sizeof(*new_nodes));
+    if (!new_starts || !new_nodes) {
+        // Keep the old arrays. The index won't be used until the tree shrinks
+        // back.
+        uvm_kvfree(new_starts);
+        uvm_kvfree(new_nodes);
+        return;
+    }
+
+    uvm_kvfree(index->starts);
+    uvm_kvfree(index->nodes);
+    index->starts = new_starts;
+    index->nodes = new_nodes;
+    index->max_entries = new_max;
+    index->valid = false;
+}
+
+// Rebuild the index from the list of nodes if needed. Returns false if the
+// index is too small for the tree.
+static bool range_tree_index_rebuild(uvm_range_tree_t *tree)
+{
+    uvm_range_tree_index_t *index = tree->index;
+    uvm_range_tree_node_t *node;
+    NvU32 i = 0;
+
+    if (index->num_nodes > index->max_entries)
+        return false;
+
+    uvm_spin_lock(&index->lock);
+
+    // Another lookup may have rebuilt the index while we were waiting
+    if (!READ_ONCE(index->valid)) {
+        write_seqcount_begin(&index->seq);
+
+        uvm_range_tree_for_each(node, tree) {
+            index->starts[i] = node->start;
+            index->nodes[i] = node;
+            ++i;
+        }
+
+        UVM_ASSERT(i == index->num_nodes);
+        index->count = i;
+        WRITE_ONCE(index->valid, true);
+
+        write_seqcount_end(&index->seq);
+    }
+
+    uvm_spin_unlock(&index->lock);
+
+    return true;
+}
+
+// Index version of range_node_find, without the parent pointer. Returns false
+// if the index could not be used, in which case the rb tree has to be walked.
+static bool range_tree_index_find(uvm_range_tree_t *tree,
+                                  NvU64 addr,
+                                  uvm_range_tree_node_t **node,
+                                  uvm_range_tree_node_t **next)
+{
+    uvm_range_tree_index_t *index = tree->index;
+    uvm_range_tree_node_t *_node = NULL;
+    uvm_range_tree_node_t *_next = NULL;
+    unsigned seq;
+    NvU32 low, high;
+
+    if (!READ_ONCE(index->valid) && !range_tree_index_rebuild(tree))
+        return false;
+
+    seq = read_seqcount_begin(&index->seq);
+
+    if (!index->valid)
+        return false;
+
+    // Find the first entry with start > addr. The node containing addr, if
+    // any, is the one before it.
+    low = 0;
+    high = index->count;
+    while (low < high) {
+        NvU32 mid = low + (high - low) / 2;
+
+        if (index->starts[mid] <= addr)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (low > 0 && index->nodes[low - 1]->end >= addr) {
+        _node = index->nodes[low - 1];
+        _next = low < index->count ? index->nodes[low] : NULL;
+    }
+    else if (low < index->count) {
+        _next = index->nodes[low];
+    }
+
+    if (read_seqcount_retry(&index->seq, seq))
+        return false;
+
+    *node = _node;
+    if (next)
+        *next = _next;
+
+    return true;
+}
+
 void uvm_range_tree_init(uvm_range_tree_t *tree)
 {
     memset(tree, 0, sizeof(*tree));
@@ -102,6 +253,68 @@ void uvm_range_tree_init(uvm_range_tree_t *tree)
     INIT_LIST_HEAD(&tree->head);
 }
 
+NV_STATUS uvm_range_tree_index_enable(uvm_range_tree_t *tree)
+{
+    uvm_range_tree_index_t *index;
+    uvm_range_tree_node_t *node;
+
+    UVM_ASSERT(!tree->index);
+
+    index = uvm_kvmalloc_zero(sizeof(*index));
+    if (!index)
+        return NV_ERR_NO_MEMORY;
+
+    uvm_spin_lock_init(&index->lock, UVM_LOCK_ORDER_LEAF);
+    seqcount_init(&index->seq);
+
+    uvm_range_tree_for_each(node, tree)
+        ++index->num_nodes;
+
+    range_tree_index_grow(index, index->num_nodes);
+    if (index->max_entries == 0) {
+        uvm_kvfree(index);
+        return NV_ERR_NO_MEMORY;
+    }
+
+    tree->index = index;
+
+    return NV_OK;
+}
+
+void uvm_range_tree_index_disable(uvm_range_tree_t *tree)
+{
+    if (!tree->index)
+        return;
+
+    uvm_kvfree(tree->index->starts);
+    uvm_kvfree(tree->index->nodes);
+    uvm_kvfree(tree->index);
+    tree->index = NULL;
+}
+
+void uvm_range_tree_index_invalidate(uvm_range_tree_t *tree, bool removed)
+{
+    uvm_range_tree_index_t *index = tree->index;
+
+    if (removed) {
+        UVM_ASSERT(index->num_nodes > 0);
+        --index->num_nodes;
+    }
+
+    WRITE_ONCE(index->valid, false);
+}
+
+static void range_tree_index_add(uvm_range_tree_t *tree)
+{
+    uvm_range_tree_index_t *index = tree->index;
+
+    ++index->num_nodes;
+    if (index->num_nodes > index->max_entries)
+        range_tree_index_grow(index, index->num_nodes);
+
+    WRITE_ONCE(index->valid, false);
+}
+
 NV_STATUS uvm_range_tree_add(uvm_range_tree_t *tree, uvm_range_tree_node_t *node)
 {
     uvm_range_tree_node_t *match, *parent, *prev, *next;
@@ -121,6 +334,10 @@ NV_STATUS uvm_range_tree_add(uvm_range_tree_t *tree, uvm_range_tree_node_t *node
         rb_link_node(&node->rb_node, NULL, &tree->rb_root.rb_node);
         rb_insert_color(&node->rb_node, &tree->rb_root);
         list_add(&node->list, &tree->head);
+
+        if (tree->index)
+            range_tree_index_add(tree);
+
         return NV_OK;
     }
 
@@ -150,6 +367,10 @@ NV_STATUS uvm_range_tree_add(uvm_range_tree_t *tree, uvm_range_tree_node_t *node
     }
 
     rb_insert_color(&node->rb_node, &tree->rb_root);
+
+    if (tree->index)
+        range_tree_index_add(tree);
+
     return NV_OK;
 }
 
@@ -159,11 +380,11 @@ void uvm_range_tree_shrink_node(uvm_range_tree_t *tree, uvm_range_tree_node_t *n
     UVM_ASSERT_MSG(node->start <= new_start, "start 0x%llx new_start 0x%llx\n", node->start, new_start);
     UVM_ASSERT_MSG(node->end >= new_end, "end 0x%llx new_end 0x%llx\n", node->end, new_end);
 
-    // The tree is not needed currently, but might be in the future.
-    (void)tree;
-
     node->start = new_start;
     node->end = new_end;
+
+    if (tree->index)
+        uvm_range_tree_index_invalidate(tree, false);
 }
 
 void uvm_range_tree_split(uvm_range_tree_t *tree,
@@ -192,6 +413,7 @@ uvm_range_tree_node_t *uvm_range_tree_merge_prev(uvm_range_tree_t *tree, uvm_ran
     if (!prev || prev->end != node->start - 1)
         return NULL;
 
+    // Removing prev already invalidates the index
     uvm_range_tree_remove(tree, prev);
     node->start = prev->start;
     return prev;
@@ -210,6 +432,11 @@ uvm_range_tree_node_t *uvm_range_tree_merge_next(uvm_range_tree_t *tree, uvm_ran
 
 uvm_range_tree_node_t *uvm_range_tree_find(uvm_range_tree_t *tree, NvU64 addr)
 {
+    uvm_range_tree_node_t *node;
+
+    if (tree->index && range_tree_index_find(tree, addr, &node, NULL))
+        return node;
+
     return range_node_find(tree, addr, NULL, NULL);
 }
 
@@ -219,7 +446,9 @@ uvm_range_tree_node_t *uvm_range_tree_iter_first(uvm_range_tree_t *tree, NvU64 s
 
     UVM_ASSERT(start <= end);
 
-    node = range_node_find(tree, start, NULL, &next);
+    if (!tree->index || !range_tree_index_find(tree, start, &node, &next))
+        node = range_node_find(tree, start, NULL, &next);
+
     if (node)
         return node;
 
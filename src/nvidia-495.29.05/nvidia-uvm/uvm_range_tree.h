@@ -32,6 +32,8 @@
 //
 // All locking is up to the caller.
 
+typedef struct uvm_range_tree_index_struct uvm_range_tree_index_t;
+
 typedef struct uvm_range_tree_struct
 {
     // Tree of uvm_range_tree_node_t's sorted by start.
@@ -41,6 +43,10 @@ typedef struct uvm_range_tree_struct
     // to avoid calling rb_next and rb_prev frequently, particularly while
     // iterating.
     struct list_head head;
+
+    // Optional lookup index. NULL if not enabled. See
+    // uvm_range_tree_index_enable.
+    uvm_range_tree_index_t *index;
 } uvm_range_tree_t;
 
 typedef struct uvm_range_tree_node_struct
@@ -61,10 +67,33 @@ void uvm_range_tree_init(uvm_range_tree_t *tree);
 // NV_ERR_UVM_ADDRESS_IN_USE is returned.
 NV_STATUS uvm_range_tree_add(uvm_range_tree_t *tree, uvm_range_tree_node_t *node);
 
+// Enable a lookup index for read-mostly trees. The index is a sorted array of
+// the node starts, rebuilt lazily by the first lookup following a mutation, so
+// uvm_range_tree_find and uvm_range_tree_iter_first can binary search a
+// contiguous array instead of walking the rb tree.
+//
+// Lookups can be done concurrently, so rebuilds are serialized internally.
+// Mutations must still be exclusive with lookups, and the tree must not be
+// modified in atomic context while the index is enabled, since adding nodes
+// may need to grow the index.
+//
+// If the index cannot be grown or rebuilt, lookups fall back to the rb tree.
+NV_STATUS uvm_range_tree_index_enable(uvm_range_tree_t *tree);
+
+// Free the index, if any. Lookups use the rb tree from then on.
+void uvm_range_tree_index_disable(uvm_range_tree_t *tree);
+
+// Called by the range tree functions whenever a node is removed or its start
+// changes. There is no need to call this directly.
+void uvm_range_tree_index_invalidate(uvm_range_tree_t *tree, bool removed);
+
 static void uvm_range_tree_remove(uvm_range_tree_t *tree, uvm_range_tree_node_t *node)
 {
     rb_erase(&node->rb_node, &tree->rb_root);
     list_del(&node->list);
+
+    if (tree->index)
+        uvm_range_tree_index_invalidate(tree, true);
 }
 
 // Shrink an existing node to [new_start, new_end].
@@ -131,11 +131,12 @@ static void rtt_state_destroy(rtt_state_t *state)
     for (i = 0; i < state->count; i++)
         uvm_kvfree(state->nodes[i]);
 
+    uvm_range_tree_index_disable(&state->tree);
     uvm_kvfree(state->nodes);
     uvm_kvfree(state);
 }
 
-static rtt_state_t *rtt_state_create(void)
+static rtt_state_t *rtt_state_create(bool use_index)
 {
     rtt_state_t *state = uvm_kvmalloc_zero(sizeof(*state));
     if (!state)
@@ -149,6 +150,12 @@ static rtt_state_t *rtt_state_create(void)
     }
 
     uvm_range_tree_init(&state->tree);
+
+    if (use_index && uvm_range_tree_index_enable(&state->tree) != NV_OK) {
+        rtt_state_destroy(state);
+        return NULL;
+    }
+
     return state;
 }
 
@@ -843,12 +850,12 @@ static NV_STATUS rtt_directed(rtt_state_t *state)
     return NV_OK;
 }
 
-NV_STATUS uvm_test_range_tree_directed(UVM_TEST_RANGE_TREE_DIRECTED_PARAMS *params, struct file *filp)
+static NV_STATUS rtt_directed_run(bool use_index)
 {
     rtt_state_t *state;
     NV_STATUS status;
 
-    state = rtt_state_create();
+    state = rtt_state_create(use_index);
     if (!state)
         return NV_ERR_NO_MEMORY;
     status = rtt_directed(state);
@@ -856,6 +863,18 @@ NV_STATUS uvm_test_range_tree_directed(UVM_TEST_RANGE_TREE_DIRECTED_PARAMS *para
     return status;
 }
 
+NV_STATUS uvm_test_range_tree_directed(UVM_TEST_RANGE_TREE_DIRECTED_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+
+    // Test both the rb tree and the index lookup paths
+    status = rtt_directed_run(false);
+    if (status != NV_OK)
+        return status;
+
+    return rtt_directed_run(true);
+}
+
 // ------------------------------ Random Test ------------------------------ //
 
 // Randomly place a block of the given size in the range described by bounds.
@@ -1454,7 +1473,8 @@ NV_STATUS uvm_test_range_tree_random(UVM_TEST_RANGE_TREE_RANDOM_PARAMS *params,
         params->max_batch_count == 0)
         return NV_ERR_INVALID_PARAMETER;
 
-    state = rtt_state_create();
+    // Even seeds use the index for lookups, odd seeds walk the rb tree
+    state = rtt_state_create(params->seed % 2 == 0);
     if (!state)
         return NV_ERR_NO_MEMORY;
 
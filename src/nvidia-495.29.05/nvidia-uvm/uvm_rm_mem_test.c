@@ -127,7 +127,7 @@ static NV_STATUS test_all_gpus_in_va(uvm_va_space_t *va_space)
     // Create allocations of these sizes
     static const size_t sizes[] = {1, 4, 16, 128, 1024, 4096, 1024 * 1024, 4 * 1024 * 1024};
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     TEST_CHECK_RET(!uvm_processor_mask_empty(&va_space->registered_gpus));
 
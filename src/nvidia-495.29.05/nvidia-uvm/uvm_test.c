@@ -211,6 +211,58 @@ static NV_STATUS uvm_test_get_user_space_end_address(UVM_TEST_GET_USER_SPACE_END
     return NV_OK;
 }
 
+static bool uvm_test_ioctl_batchable(NvU32 cmd)
+{
+    switch (cmd) {
+        case UVM_TEST_GET_GPU_REF_COUNT:
+        case UVM_TEST_VA_RANGE_INFO:
+        case UVM_TEST_VA_BLOCK_INFO:
+        case UVM_TEST_VA_RESIDENCY_INFO:
+        case UVM_TEST_RANGE_GROUP_RANGE_INFO:
+        case UVM_TEST_RANGE_GROUP_RANGE_COUNT:
+        case UVM_TEST_GET_USER_SPACE_END_ADDRESS:
+            return true;
+    }
+
+    return false;
+}
+
+static NV_STATUS uvm_test_ioctl_batch(UVM_TEST_IOCTL_BATCH_PARAMS *params, struct file *filp)
+{
+    UVM_TEST_IOCTL_BATCH_ENTRY __user *user_entries = (UVM_TEST_IOCTL_BATCH_ENTRY __user *)params->entries;
+    NvU32 i;
+
+    params->num_completed = 0;
+
+    if (params->num_entries == 0 || params->num_entries > UVM_TEST_IOCTL_BATCH_MAX_ENTRIES)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    for (i = 0; i < params->num_entries; i++) {
+        UVM_TEST_IOCTL_BATCH_ENTRY entry;
+
+        if (nv_copy_from_user(&entry, &user_entries[i], sizeof(entry)))
+            return NV_ERR_INVALID_ADDRESS;
+
+        if (!uvm_test_ioctl_batchable(entry.cmd))
+            return NV_ERR_INVALID_ARGUMENT;
+
+        entry.ret = uvm_test_ioctl(filp, entry.cmd, (unsigned long)entry.params);
+
+        if (nv_copy_to_user(&user_entries[i].ret, &entry.ret, sizeof(entry.ret)))
+            return NV_ERR_INVALID_ADDRESS;
+
+        if (entry.ret != 0)
+            return NV_ERR_GENERIC;
+
+        params->num_completed++;
+
+        if (fatal_signal_pending(current))
+            return NV_ERR_SIGNAL_PENDING;
+    }
+
+    return NV_OK;
+}
+
 long uvm_test_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
     // Disable all test entry points if the module parameter wasn't provided.
@@ -313,6 +365,10 @@ long uvm_test_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
         UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TEST_GET_USER_SPACE_END_ADDRESS, uvm_test_get_user_space_end_address);
         UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_HMM_SANITY,                   uvm_test_hmm_sanity);
+        UVM_ROUTE_CMD_ALLOC_INIT_CHECK(UVM_TEST_CE_BANDWIDTH,                 uvm_test_ce_bandwidth);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_FAULT_BATCH_BENCHMARK,        uvm_test_fault_batch_benchmark);
+        UVM_ROUTE_CMD_ALLOC_INIT_CHECK(UVM_TEST_PMM_BENCH,                    uvm_test_pmm_bench);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_IOCTL_BATCH,                  uvm_test_ioctl_batch);
     }
 
     return -EINVAL;
@@ -1374,6 +1374,243 @@ typedef struct
     NV_STATUS rmStatus;                                  // Out
 } UVM_TEST_HMM_SANITY_PARAMS;
 
+typedef enum
+{
+    UVM_TEST_CE_BANDWIDTH_PATH_SYSMEM_TO_VIDMEM = 0,
+    UVM_TEST_CE_BANDWIDTH_PATH_VIDMEM_TO_SYSMEM,
+    UVM_TEST_CE_BANDWIDTH_PATH_VIDMEM_TO_VIDMEM,
+    UVM_TEST_CE_BANDWIDTH_PATH_VIDMEM_TO_PEER,
+    UVM_TEST_CE_BANDWIDTH_PATH_MAX
+} UVM_TEST_CE_BANDWIDTH_PATH;
+
+typedef enum
+{
+    UVM_TEST_CE_BANDWIDTH_OP_MEMCOPY = 0,
+    UVM_TEST_CE_BANDWIDTH_OP_MEMSET,
+    UVM_TEST_CE_BANDWIDTH_OP_MAX
+} UVM_TEST_CE_BANDWIDTH_OP;
+
+typedef struct
+{
+    // GPU whose CE performed the operation
+    NvProcessorUuid gpu_uuid;
+
+    // Peer GPU written to for UVM_TEST_CE_BANDWIDTH_PATH_VIDMEM_TO_PEER,
+    // gpu_uuid otherwise
+    NvProcessorUuid peer_uuid;
+
+    // Bytes moved by a single operation. Each measurement issues iterations
+    // operations back to back in a single push.
+    NvU64           size       NV_ALIGN_BYTES(8);
+
+    // GPU time between the semaphore timestamps bracketing the operations
+    NvU64           elapsed_ns NV_ALIGN_BYTES(8);
+
+    NvU32           ce_index;
+    NvU32           channel_type; // uvm_channel_type_t
+    NvU32           path;         // UVM_TEST_CE_BANDWIDTH_PATH
+    NvU32           op;           // UVM_TEST_CE_BANDWIDTH_OP
+} UVM_TEST_CE_BANDWIDTH_RESULT;
+
+#define UVM_TEST_CE_BANDWIDTH_MAX_RESULTS 512
+
+#define UVM_TEST_CE_BANDWIDTH                            UVM_TEST_IOCTL_BASE(92)
+typedef struct
+{
+    // Operation sizes go from min_size to max_size, doubling every step. Both
+    // must be multiples of 8 and max_size can't exceed 2MB. Zero picks the
+    // defaults of 64KB and 2MB respectively.
+    NvU64                        min_size   NV_ALIGN_BYTES(8);              // In
+    NvU64                        max_size   NV_ALIGN_BYTES(8);              // In
+
+    // Number of operations per measurement. Zero picks the default of 16.
+    NvU32                        iterations;                                // In
+
+    // Set when more measurements were taken than fit in results
+    NvBool                       truncated;                                 // Out
+    NvU32                        num_results;                               // Out
+    UVM_TEST_CE_BANDWIDTH_RESULT results[UVM_TEST_CE_BANDWIDTH_MAX_RESULTS]; // Out
+    NV_STATUS                    rmStatus;                                  // Out
+} UVM_TEST_CE_BANDWIDTH_PARAMS;
+
+typedef enum
+{
+    // Consecutive pages, wrapping around at the end of the range
+    UVM_TEST_FAULT_BATCH_PATTERN_SEQUENTIAL = 0,
+
+    // One page every stride bytes, wrapping around at the end of the range
+    UVM_TEST_FAULT_BATCH_PATTERN_STRIDED,
+
+    // Uniformly random pages in the range
+    UVM_TEST_FAULT_BATCH_PATTERN_RANDOM,
+
+    // Consecutive pages, each faulted duplicates times in the batch. The
+    // duplicates are interleaved with faults on other pages.
+    UVM_TEST_FAULT_BATCH_PATTERN_DUPLICATE,
+
+    UVM_TEST_FAULT_BATCH_PATTERN_MAX
+} UVM_TEST_FAULT_BATCH_PATTERN;
+
+typedef enum
+{
+    // Caching and coalescing of the synthetic entries, as done at fetch time
+    UVM_TEST_FAULT_BATCH_STAGE_FETCH = 0,
+
+    // Sorting of the batch
+    UVM_TEST_FAULT_BATCH_STAGE_SORT,
+
+    // service_fault_batch()
+    UVM_TEST_FAULT_BATCH_STAGE_SERVICE,
+
+    // Wait for the work pushed while servicing the batch
+    UVM_TEST_FAULT_BATCH_STAGE_WAIT,
+
+    UVM_TEST_FAULT_BATCH_STAGE_MAX
+} UVM_TEST_FAULT_BATCH_STAGE;
+
+// Service synthetic replayable fault batches on the given GPU, without any
+// GPU faults being raised. The faults target [base, base + length), which
+// must be covered by a single managed VA range, and the GPU must have a GPU
+// VA space registered. Faults on pages already resident and mapped on the
+// GPU are cheap to service, so callers wanting to measure first-touch
+// servicing must make the range non-resident on the GPU between calls.
+//
+// Replayable fault servicing on the GPU is blocked while the test runs. No
+// replays are issued unless the replay policy is
+// UVM_PERF_FAULT_REPLAY_POLICY_BLOCK.
+#define UVM_TEST_FAULT_BATCH_BENCHMARK                   UVM_TEST_IOCTL_BASE(93)
+typedef struct
+{
+    NvProcessorUuid gpu_uuid;                                           // In
+    NvU64           base                         NV_ALIGN_BYTES(8);     // In
+    NvU64           length                       NV_ALIGN_BYTES(8);     // In
+
+    // Only used with UVM_TEST_FAULT_BATCH_PATTERN_STRIDED. Zero picks 64KB.
+    NvU64           stride                       NV_ALIGN_BYTES(8);     // In
+    NvU32           pattern;                                            // In (UVM_TEST_FAULT_BATCH_PATTERN)
+    NvU32           num_batches;                                        // In
+
+    // Number of faults per batch. Zero picks the batch size of the GPU.
+    NvU32           batch_size;                                         // In
+
+    // Only used with UVM_TEST_FAULT_BATCH_PATTERN_DUPLICATE. Zero picks 4.
+    NvU32           duplicates;                                         // In
+    NvU32           seed;                                               // In
+    NvBool          write;                                              // In
+
+    // Faults generated and faults left after coalescing
+    NvU64           num_faults                   NV_ALIGN_BYTES(8);     // Out
+    NvU64           num_coalesced_faults         NV_ALIGN_BYTES(8);     // Out
+
+    // Time spent in each stage across all batches
+    NvU64           stage_ns[UVM_TEST_FAULT_BATCH_STAGE_MAX] NV_ALIGN_BYTES(8); // Out
+    NV_STATUS       rmStatus;                                           // Out
+} UVM_TEST_FAULT_BATCH_BENCHMARK_PARAMS;
+
+#define UVM_TEST_PMM_BENCH_MAX_THREADS     16
+#define UVM_TEST_PMM_BENCH_MAX_ITERATIONS  (256 * 1024)
+#define UVM_TEST_PMM_BENCH_MAX_LIVE_CHUNKS 4096
+#define UVM_TEST_PMM_BENCH_MAX_SNAPSHOTS   32
+
+// Number of chunk sizes up to 2MB, indexed by their log2
+#define UVM_TEST_PMM_BENCH_SIZE_ORDERS     22
+
+typedef struct
+{
+    // Number of calls, and their 50th and 99th percentile and maximum latency
+    NvU64 count                      NV_ALIGN_BYTES(8);
+    NvU64 p50_ns                     NV_ALIGN_BYTES(8);
+    NvU64 p99_ns                     NV_ALIGN_BYTES(8);
+    NvU64 max_ns                     NV_ALIGN_BYTES(8);
+} UVM_TEST_PMM_BENCH_LATENCY;
+
+typedef struct
+{
+    // Time since the start of the benchmark
+    NvU64 time_ns                    NV_ALIGN_BYTES(8);
+
+    // Number of chunks in the free lists of the memory type, by log2 of their
+    // size
+    NvU64 free_chunks[UVM_TEST_PMM_BENCH_SIZE_ORDERS] NV_ALIGN_BYTES(8);
+} UVM_TEST_PMM_BENCH_SNAPSHOT;
+
+// Allocate and free chunks of random sizes on the given GPU from num_threads
+// threads at once, through uvm_pmm_gpu_alloc and uvm_pmm_gpu_free. Each thread
+// keeps up to max_live_chunks chunks allocated, and on each iteration frees or
+// allocates a random one of them. Allocations that fail for lack of memory are
+// counted and not retried, as no eviction is requested.
+#define UVM_TEST_PMM_BENCH                               UVM_TEST_IOCTL_BASE(94)
+typedef struct
+{
+    NvProcessorUuid             gpu_uuid;                                           // In
+
+    // Mask of the chunk sizes to allocate. Sizes not supported for the memory
+    // type are ignored and zero picks all the supported sizes.
+    NvU64                       chunk_sizes                     NV_ALIGN_BYTES(8);  // In
+    NvU32                       memory_type;                                        // In (0: user, 1: kernel)
+    NvU32                       num_threads;                                        // In
+    NvU32                       iterations;                                         // In, per thread
+    NvU32                       max_live_chunks;                                    // In, per thread
+    NvU32                       seed;                                               // In
+
+    // Interval between the free list snapshots
+    NvU32                       snapshot_interval_ms;                               // In
+
+    UVM_TEST_PMM_BENCH_LATENCY  alloc_latency;                                      // Out
+    UVM_TEST_PMM_BENCH_LATENCY  free_latency;                                       // Out
+    NvU64                       alloc_failures                  NV_ALIGN_BYTES(8);  // Out
+
+    // Hold times of the PMM lock and list lock. The percentiles are rounded up
+    // to a power of two ns. Holds by other PMM users during the benchmark are
+    // included.
+    UVM_TEST_PMM_BENCH_LATENCY  lock_hold;                                          // Out
+    UVM_TEST_PMM_BENCH_LATENCY  list_lock_hold;                                     // Out
+
+    // The last snapshot is taken after all the threads are done
+    NvU32                       num_snapshots;                                      // Out
+    UVM_TEST_PMM_BENCH_SNAPSHOT snapshots[UVM_TEST_PMM_BENCH_MAX_SNAPSHOTS];        // Out
+    NV_STATUS                   rmStatus;                                           // Out
+} UVM_TEST_PMM_BENCH_PARAMS;
+
+#define UVM_TEST_IOCTL_BATCH_MAX_ENTRIES 1024
+
+typedef struct
+{
+    NvU32                       cmd;                                                // In
+    NvS32                       ret;                                                // Out
+
+    // User pointer to the parameters of cmd
+    NvU64                       params                          NV_ALIGN_BYTES(8);  // In
+} UVM_TEST_IOCTL_BATCH_ENTRY;
+
+// Issue several test ioctls with a single system call, in order. Only the
+// read-only queries, like UVM_TEST_VA_RANGE_INFO and
+// UVM_TEST_VA_RESIDENCY_INFO, can be batched. Each entry gets the return value
+// its own ioctl would have had, and the batch stops at the first non-zero one.
+// The rmStatus of each query is returned in its own parameters.
+//
+// Error returns:
+// NV_ERR_INVALID_ARGUMENT
+//  - num_entries is 0 or greater than UVM_TEST_IOCTL_BATCH_MAX_ENTRIES
+//  - an entry's cmd can't be batched
+//
+// NV_ERR_INVALID_ADDRESS
+//  - entries can't be read, or their return values can't be written
+//
+// NV_ERR_GENERIC
+//  - an entry's ioctl returned a non-zero value
+//
+// NV_ERR_SIGNAL_PENDING
+//  - a fatal signal arrived before all the entries were issued
+#define UVM_TEST_IOCTL_BATCH                             UVM_TEST_IOCTL_BASE(95)
+typedef struct
+{
+    NvU64                       entries                         NV_ALIGN_BYTES(8);  // In, UVM_TEST_IOCTL_BATCH_ENTRY[]
+    NvU32                       num_entries;                                        // In
+    NvU32                       num_completed;                                      // Out
+    NV_STATUS                   rmStatus;                                           // Out
+} UVM_TEST_IOCTL_BATCH_PARAMS;
+
 #ifdef __cplusplus
 }
 #endif
@@ -53,6 +53,11 @@
 // Both the table and array entries are cache aligned to avoid false sharing
 // overheads due to cache thrashing between concurrent operations on separate
 // thread contexts.
+//
+// The tree lock is only taken when the tree of the table entry is not empty
+// (see thread_context_non_interrupt_tree_maybe_present), so adding, finding
+// and removing a thread context that lives in the array never writes to a
+// cache line shared with other threads.
 
 #define UVM_THREAD_CONTEXT_ARRAY_SIZE 8
 
@@ -231,6 +236,19 @@ static bool thread_context_non_interrupt_tree_insert(struct rb_root *root, uvm_t
     return true;
 }
 
+// Returns false if the tree of the given table entry cannot contain a thread
+// context of the given task, without taking the tree lock.
+//
+// Thread contexts of a task are only ever added by that same task, so if one
+// of them is in the tree the task itself made the tree non-empty, and the tree
+// stays non-empty until the task removes it. Concurrent insertions and
+// removals of other tasks' contexts never make the root NULL while the task's
+// node is linked. An empty root read without the lock can thus be trusted.
+static bool thread_context_non_interrupt_tree_maybe_present(uvm_thread_context_table_entry_t *table_entry)
+{
+    return UVM_READ_ONCE(table_entry->tree.rb_node) != NULL;
+}
+
 static void thread_context_lock_interrupt_patch_acquired(uvm_thread_context_lock_t *context_lock)
 {
     uvm_thread_context_lock_acquired_t *thread_context_lock_acquired;
@@ -352,6 +370,9 @@ static uvm_thread_context_t *thread_context_non_interrupt(void)
         }
     }
 
+    if (!thread_context_non_interrupt_tree_maybe_present(table_entry))
+        return NULL;
+
     spin_lock_irqsave(&table_entry->tree_lock, flags);
     thread_context = thread_context_non_interrupt_tree_search(&table_entry->tree, current);
     spin_unlock_irqrestore(&table_entry->tree_lock, flags);
@@ -450,6 +471,16 @@ static bool thread_context_non_interrupt_add(uvm_thread_context_t *thread_contex
         }
     }
 
+    // Common case: the array had room, and the task cannot have a different
+    // thread context in the empty tree. The slot's thread_context is only
+    // read by the owning task (and at global exit), so it can be published
+    // without the tree lock.
+    if (thread_context->array_index != UVM_THREAD_CONTEXT_ARRAY_SIZE &&
+        !thread_context_non_interrupt_tree_maybe_present(table_entry)) {
+        table_entry->array[thread_context->array_index].thread_context = thread_context;
+        return true;
+    }
+
     spin_lock_irqsave(&table_entry->tree_lock, flags);
 
     if (thread_context->array_index == UVM_THREAD_CONTEXT_ARRAY_SIZE) {
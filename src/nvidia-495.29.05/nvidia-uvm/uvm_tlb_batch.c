@@ -23,6 +23,8 @@
 
 #include "uvm_tlb_batch.h"
 #include "uvm_hal.h"
+#include "uvm_mmu.h"
+#include "uvm_push.h"
 
 void uvm_tlb_batch_begin(uvm_page_tree_t *tree, uvm_tlb_batch_t *batch)
 {
@@ -113,12 +115,50 @@ void uvm_tlb_batch_end(uvm_tlb_batch_t *batch, uvm_push_t *push, uvm_membar_t tl
         tlb_batch_flush_invalidate_per_va(batch, push);
 }
 
+// Extend a queued up range with the same page sizes which overlaps or is
+// adjacent to [start, start + size), if any. Blocks remapped back to back, and
+// deferred invalidates in particular, often produce such ranges.
+static bool tlb_batch_try_merge(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, NvU32 page_sizes)
+{
+    NvU32 i;
+
+    for (i = 0; i < batch->count; ++i) {
+        uvm_tlb_batch_range_t *entry = &batch->ranges[i];
+        NvU64 new_start;
+        NvU64 new_end;
+
+        if (entry->page_sizes != page_sizes)
+            continue;
+
+        if (start > entry->start + entry->size || entry->start > start + size)
+            continue;
+
+        new_start = min(entry->start, start);
+        new_end = max(entry->start + entry->size, start + size);
+
+        if (!batch->tree->gpu->parent->tlb_batch.va_range_invalidate_supported)
+            batch->total_pages += uvm_div_pow2_64(new_end - new_start - entry->size, smallest_page_size(page_sizes));
+
+        entry->start = new_start;
+        entry->size = new_end - new_start;
+
+        return true;
+    }
+
+    return false;
+}
+
 void uvm_tlb_batch_invalidate(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, NvU32 page_sizes, uvm_membar_t tlb_membar)
 {
     uvm_tlb_batch_range_t *new_entry;
 
     batch->membar = uvm_membar_max(tlb_membar, batch->membar);
 
+    if (!tlb_batch_should_invalidate_all(batch) && tlb_batch_try_merge(batch, start, size, page_sizes)) {
+        batch->biggest_page_size = max(batch->biggest_page_size, biggest_page_size(page_sizes));
+        return;
+    }
+
     ++batch->count;
 
     if (batch->tree->gpu->parent->tlb_batch.va_range_invalidate_supported)
@@ -136,3 +176,69 @@ void uvm_tlb_batch_invalidate(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, N
     new_entry->size = size;
     new_entry->page_sizes = page_sizes;
 }
+
+bool uvm_tlb_batch_defer(uvm_tlb_batch_t *batch)
+{
+    uvm_page_tree_t *tree = batch->tree;
+    uvm_tlb_batch_t *deferred = &tree->deferred_tlb.batch;
+    NvU32 i;
+
+    if (batch->membar != UVM_MEMBAR_NONE)
+        return false;
+
+    if (batch->count == 0)
+        return true;
+
+    uvm_spin_lock(&tree->deferred_tlb.lock);
+
+    if (tlb_batch_should_invalidate_all(batch)) {
+        // The ranges are no longer tracked once the batch falls back to
+        // invalidate all, so the deferred batch has to fall back, too.
+        deferred->count = max(deferred->count, (NvU32)UVM_TLB_BATCH_MAX_ENTRIES + 1);
+        deferred->biggest_page_size = max(deferred->biggest_page_size, batch->biggest_page_size);
+    }
+    else {
+        for (i = 0; i < batch->count; ++i) {
+            uvm_tlb_batch_range_t *entry = &batch->ranges[i];
+
+            uvm_tlb_batch_invalidate(deferred, entry->start, entry->size, entry->page_sizes, UVM_MEMBAR_NONE);
+        }
+    }
+
+    uvm_spin_unlock(&tree->deferred_tlb.lock);
+
+    return true;
+}
+
+NV_STATUS uvm_tlb_batch_flush_deferred(uvm_page_tree_t *tree, uvm_tracker_t *tracker)
+{
+    NV_STATUS status;
+    uvm_push_t push;
+    uvm_tlb_batch_t batch;
+
+    uvm_spin_lock(&tree->deferred_tlb.lock);
+    batch = tree->deferred_tlb.batch;
+    uvm_tlb_batch_begin(tree, &tree->deferred_tlb.batch);
+    uvm_spin_unlock(&tree->deferred_tlb.lock);
+
+    if (batch.count == 0)
+        return NV_OK;
+
+    status = uvm_push_begin_acquire(tree->gpu->channel_manager,
+                                    UVM_CHANNEL_TYPE_MEMOPS,
+                                    tracker,
+                                    &push,
+                                    "Deferred TLB invalidate");
+    if (status != NV_OK)
+        return status;
+
+    uvm_tlb_batch_end(&batch, &push, UVM_MEMBAR_NONE);
+
+    uvm_push_end(&push);
+
+    // The push acquired the tracker so it's ok to just overwrite it with the
+    // entry tracking the push.
+    uvm_tracker_overwrite_with_push(tracker, &push);
+
+    return NV_OK;
+}
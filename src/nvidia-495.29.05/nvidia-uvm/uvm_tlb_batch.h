@@ -26,6 +26,7 @@
 
 #include "uvm_forward_decl.h"
 #include "uvm_hal_types.h"
+#include "uvm_tracker.h"
 
 // Max number of separate VA ranges to track before falling back to invalidate all.
 // TLB batches take space on the stack so this number should be big enough to
@@ -94,6 +95,21 @@ void uvm_tlb_batch_invalidate(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, N
 // batch.
 void uvm_tlb_batch_end(uvm_tlb_batch_t *batch, uvm_push_t *push, uvm_membar_t tlb_membar);
 
+// End a TLB invalidate batch by merging its queued up ranges into the deferred
+// invalidates of its page tree, instead of pushing them. The deferred
+// invalidates are pushed by uvm_tlb_batch_flush_deferred.
+//
+// Only invalidates which don't require a membar can be deferred, that is,
+// permission upgrades: until the flush, the GPU can keep using stale invalid
+// translations, which only causes replayable faults. Returns false, without
+// ending the batch, if the batch has a membar.
+bool uvm_tlb_batch_defer(uvm_tlb_batch_t *batch);
+
+// Push all the deferred TLB invalidates of the page tree in a single push
+// which acquires the input tracker. The tracker is then overwritten with the
+// push, so it must already track the pushes that wrote the PTEs.
+NV_STATUS uvm_tlb_batch_flush_deferred(uvm_page_tree_t *tree, uvm_tracker_t *tracker);
+
 // Helper for invalidating a single range immediately.
 //
 // Internally begins and ends a TLB batch.
@@ -41,6 +41,15 @@
 // over and over again in an attempt to overflow the refcount.
 #define MAX_PAGE_COUNT (1 << 20)
 
+// Minimum time between two UvmEventTypeTimeCalibration events of the same GPU
+// in a VA space
+#define UVM_TOOLS_TIME_CALIBRATION_PERIOD_MS_DEFAULT 1000
+
+static unsigned uvm_tools_time_calibration_period_ms = UVM_TOOLS_TIME_CALIBRATION_PERIOD_MS_DEFAULT;
+module_param(uvm_tools_time_calibration_period_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_tools_time_calibration_period_ms,
+                 "Minimum time in milliseconds between time calibration events of a GPU.");
+
 typedef struct
 {
     NvU32 get_ahead;
@@ -66,6 +75,21 @@ typedef struct
     wait_queue_head_t wait_queue;
     bool is_wakeup_get_valid;
     NvU32 wakeup_get;
+
+    // Sampling requested with UVM_TOOLS_EVENT_QUEUE_SET_SAMPLING, 0 if not
+    // sampled.
+    NvU32 sample_interval[UvmEventNumTypesAll];
+    NvU64 sample_period_ns[UvmEventNumTypesAll];
+
+    // Per-CPU ring mode, see UVM_TOOLS_INIT_EVENT_TRACKER_PER_CPU. If not 0,
+    // queue and control point to ring_count consecutive rings and control
+    // structures. Ring i is only written by CPU i, with preemption disabled
+    // and without taking the lock.
+    NvU32 ring_count;
+
+    // Per-ring flag set when the ring signaled the wait queue, cleared by
+    // poll. Rate-limits the wakeups in per-CPU ring mode.
+    atomic_t *ring_wakeup_signaled;
 } uvm_tools_queue_t;
 
 typedef struct
@@ -80,15 +104,30 @@ typedef struct
     NvProcessorUuid processor;
 } uvm_tools_counter_t;
 
+typedef struct
+{
+    // Node in va_space->tools.histograms
+    struct list_head histogram_node;
+
+    UvmToolsHistograms *histograms;
+
+    // Number of pages currently throttled on each processor, and the start
+    // of the current throttling period.
+    atomic_t throttled_pages[UVM_ID_MAX_PROCESSORS];
+    atomic64_t throttling_start[UVM_ID_MAX_PROCESSORS];
+} uvm_tools_histogram_t;
+
 // private_data for /dev/nvidia-uvm-tools
 typedef struct
 {
     bool is_queue;
+    bool is_histogram;
     struct file *uvm_file;
     union
     {
         uvm_tools_queue_t queue;
         uvm_tools_counter_t counter;
+        uvm_tools_histogram_t histogram;
     };
 } uvm_tools_event_tracker_t;
 
@@ -120,6 +159,10 @@ typedef struct
     NvU64 *start_timestamp_gpu_addr;
     NvU64 start_timestamp_gpu;
     NvU64 range_group_id;
+
+    // Whether the migrations are reported to the queues, or only to the
+    // histograms because the block migration was not sampled.
+    bool record_events;
 } block_migration_data_t;
 
 // This object represents a specific pending migration within a VA block
@@ -200,7 +243,12 @@ static bool tracker_is_queue(uvm_tools_event_tracker_t *event_tracker)
 
 static bool tracker_is_counter(uvm_tools_event_tracker_t *event_tracker)
 {
-    return event_tracker != NULL && !event_tracker->is_queue;
+    return event_tracker != NULL && !event_tracker->is_queue && !event_tracker->is_histogram;
+}
+
+static bool tracker_is_histogram(uvm_tools_event_tracker_t *event_tracker)
+{
+    return event_tracker != NULL && event_tracker->is_histogram;
 }
 
 static uvm_va_space_t *tools_event_tracker_va_space(uvm_tools_event_tracker_t *event_tracker)
@@ -347,12 +395,50 @@ static void remove_event_tracker(uvm_va_space_t *va_space,
     *subscribed_mask &= ~list_mask;
 }
 
-static bool queue_needs_wakeup(uvm_tools_queue_t *queue, uvm_tools_queue_snapshot_t *sn)
+static bool ring_needs_wakeup(uvm_tools_queue_t *queue, uvm_tools_queue_snapshot_t *sn)
 {
     NvU32 queue_mask = queue->queue_buffer_count - 1;
 
+    return ((queue->queue_buffer_count + sn->put_behind - sn->get_ahead) & queue_mask) >=
+           READ_ONCE(queue->notification_threshold);
+}
+
+static bool queue_needs_wakeup(uvm_tools_queue_t *queue, uvm_tools_queue_snapshot_t *sn)
+{
     uvm_assert_spinlock_locked(&queue->lock);
-    return ((queue->queue_buffer_count + sn->put_behind - sn->get_ahead) & queue_mask) >= queue->notification_threshold;
+    return ring_needs_wakeup(queue, sn);
+}
+
+static NvU32 queue_ring_count(uvm_tools_queue_t *queue)
+{
+    return queue->ring_count ? queue->ring_count : 1;
+}
+
+// Check whether any of the rings of the queue is above the notification
+// threshold. If reset_signaled is set, the rings are allowed to signal the wait
+// queue again.
+static bool queue_any_ring_needs_wakeup(uvm_tools_queue_t *queue, bool reset_signaled)
+{
+    NvU32 i;
+    bool needs_wakeup = false;
+
+    uvm_assert_spinlock_locked(&queue->lock);
+
+    for (i = 0; i < queue_ring_count(queue); i++) {
+        UvmToolsEventControlData *ctrl = queue->control + i;
+        uvm_tools_queue_snapshot_t sn;
+
+        if (reset_signaled && queue->ring_count)
+            atomic_set(&queue->ring_wakeup_signaled[i], 0);
+
+        sn.get_ahead = atomic_read((atomic_t *)&ctrl->get_ahead);
+        sn.put_behind = atomic_read((atomic_t *)&ctrl->put_behind);
+
+        if (queue_needs_wakeup(queue, &sn))
+            needs_wakeup = true;
+    }
+
+    return needs_wakeup;
 }
 
 static void destroy_event_tracker(uvm_tools_event_tracker_t *event_tracker)
@@ -377,14 +463,22 @@ static void destroy_event_tracker(uvm_tools_event_tracker_t *event_tracker)
             if (queue->queue != NULL) {
                 unmap_user_pages(queue->queue_buffer_pages,
                                  queue->queue,
-                                 queue->queue_buffer_count * sizeof(UvmEventEntry));
+                                 (NvU64)queue_ring_count(queue) * queue->queue_buffer_count * sizeof(UvmEventEntry));
             }
 
             if (queue->control != NULL) {
                 unmap_user_pages(queue->control_buffer_pages,
                                  queue->control,
-                                 sizeof(UvmToolsEventControlData));
+                                 queue_ring_count(queue) * sizeof(UvmToolsEventControlData));
             }
+
+            uvm_kvfree(queue->ring_wakeup_signaled);
+        }
+        else if (event_tracker->is_histogram) {
+            uvm_tools_histogram_t *histogram = &event_tracker->histogram;
+
+            list_del_init(&histogram->histogram_node);
+            uvm_kvfree(histogram->histograms);
         }
         else {
             uvm_tools_counter_t *counters = &event_tracker->counter;
@@ -415,12 +509,71 @@ static void destroy_event_tracker(uvm_tools_event_tracker_t *event_tracker)
     kmem_cache_free(g_tools_event_tracker_cache, event_tracker);
 }
 
+// Write the entry to a ring. The caller has to guarantee that there is a single
+// producer for the ring. Returns false if the ring is full, in which case the
+// event is accounted as dropped.
+static bool ring_put_entry(const UvmEventEntry *entry,
+                           UvmEventEntry *ring,
+                           UvmToolsEventControlData *ctrl,
+                           NvU32 queue_size,
+                           uvm_tools_queue_snapshot_t *sn)
+{
+    NvU32 queue_mask = queue_size - 1;
+
+    // ctrl is mapped into user space with read and write permissions,
+    // so its values cannot be trusted.
+    sn->get_behind = atomic_read((atomic_t *)&ctrl->get_behind) & queue_mask;
+    sn->put_behind = atomic_read((atomic_t *)&ctrl->put_behind) & queue_mask;
+    sn->put_ahead = (sn->put_behind + 1) & queue_mask;
+
+    // one free element means that the queue is full
+    if (((queue_size + sn->get_behind - sn->put_behind) & queue_mask) == 1) {
+        atomic64_inc((atomic64_t *)&ctrl->dropped + entry->eventData.eventType);
+        return false;
+    }
+
+    memcpy(ring + sn->put_behind, entry, sizeof(*entry));
+
+    sn->put_behind = sn->put_ahead;
+    // put_ahead and put_behind will always be the same outside of queue->lock
+    // this allows the user-space consumer to choose either a 2 or 4 pointer synchronization approach
+    atomic_set((atomic_t *)&ctrl->put_ahead, sn->put_behind);
+    atomic_set((atomic_t *)&ctrl->put_behind, sn->put_behind);
+
+    sn->get_ahead = atomic_read((atomic_t *)&ctrl->get_ahead);
+
+    return true;
+}
+
+static void enqueue_event_per_cpu(const UvmEventEntry *entry, uvm_tools_queue_t *queue)
+{
+    uvm_tools_queue_snapshot_t sn;
+    bool wakeup = false;
+    int cpu;
+
+    // Disabling preemption makes this CPU the only producer for its ring.
+    // Events are never recorded from interrupt context.
+    cpu = get_cpu();
+    UVM_ASSERT(cpu < queue->ring_count);
+
+    if (ring_put_entry(entry,
+                       queue->queue + (size_t)cpu * queue->queue_buffer_count,
+                       queue->control + cpu,
+                       queue->queue_buffer_count,
+                       &sn)) {
+        // Only signal once until the next poll
+        wakeup = ring_needs_wakeup(queue, &sn) && !atomic_xchg(&queue->ring_wakeup_signaled[cpu], 1);
+    }
+
+    put_cpu();
+
+    if (wakeup)
+        wake_up_all(&queue->wait_queue);
+}
+
 static void enqueue_event(const UvmEventEntry *entry, uvm_tools_queue_t *queue)
 {
-    UvmToolsEventControlData *ctrl = queue->control;
     uvm_tools_queue_snapshot_t sn;
-    NvU32 queue_size = queue->queue_buffer_count;
-    NvU32 queue_mask = queue_size - 1;
 
     // Prevent processor speculation prior to accessing user-mapped memory to
     // avoid leaking information from side-channel attacks. There are many
@@ -430,29 +583,16 @@ static void enqueue_event(const UvmEventEntry *entry, uvm_tools_queue_t *queue)
     // safe side we'll just always block speculation.
     nv_speculation_barrier();
 
-    uvm_spin_lock(&queue->lock);
-
-    // ctrl is mapped into user space with read and write permissions,
-    // so its values cannot be trusted.
-    sn.get_behind = atomic_read((atomic_t *)&ctrl->get_behind) & queue_mask;
-    sn.put_behind = atomic_read((atomic_t *)&ctrl->put_behind) & queue_mask;
-    sn.put_ahead = (sn.put_behind + 1) & queue_mask;
-
-    // one free element means that the queue is full
-    if (((queue_size + sn.get_behind - sn.put_behind) & queue_mask) == 1) {
-        atomic64_inc((atomic64_t *)&ctrl->dropped + entry->eventData.eventType);
-        goto unlock;
+    if (queue->ring_count) {
+        enqueue_event_per_cpu(entry, queue);
+        return;
     }
 
-    memcpy(queue->queue + sn.put_behind, entry, sizeof(*entry));
+    uvm_spin_lock(&queue->lock);
 
-    sn.put_behind = sn.put_ahead;
-    // put_ahead and put_behind will always be the same outside of queue->lock
-    // this allows the user-space consumer to choose either a 2 or 4 pointer synchronization approach
-    atomic_set((atomic_t *)&ctrl->put_ahead, sn.put_behind);
-    atomic_set((atomic_t *)&ctrl->put_behind, sn.put_behind);
+    if (!ring_put_entry(entry, queue->queue, queue->control, queue->queue_buffer_count, &sn))
+        goto unlock;
 
-    sn.get_ahead = atomic_read((atomic_t *)&ctrl->get_ahead);
     // if the queue needs to be woken up, only signal if we haven't signaled before for this value of get_ahead
     if (queue_needs_wakeup(queue, &sn) && !(queue->is_wakeup_get_valid && queue->wakeup_get == sn.get_ahead)) {
         queue->is_wakeup_get_valid = true;
@@ -528,6 +668,83 @@ static void uvm_tools_inc_counter(uvm_va_space_t *va_space,
     }
 }
 
+static NvU32 histogram_bucket(NvU64 value)
+{
+    if (value == 0)
+        return 0;
+
+    return min((NvU32)ilog2(value), (NvU32)(UVM_TOOLS_HISTOGRAM_BUCKETS - 1));
+}
+
+static void histogram_add(NvU64 *buckets, NvU64 value)
+{
+    atomic64_inc((atomic64_t *)(buckets + histogram_bucket(value)));
+}
+
+static bool tools_is_histogram_enabled(uvm_va_space_t *va_space)
+{
+    uvm_assert_rwsem_locked(&va_space->tools.lock);
+
+    return !list_empty(&va_space->tools.histograms);
+}
+
+static void tools_histogram_add_gpu_fault_latency(uvm_va_space_t *va_space, uvm_gpu_id_t gpu_id, NvU64 latency_ns)
+{
+    uvm_tools_histogram_t *histogram;
+
+    list_for_each_entry(histogram, &va_space->tools.histograms, histogram_node)
+        histogram_add(histogram->histograms->gpuFaultLatencyNs[uvm_id_value(gpu_id)], latency_ns);
+}
+
+static void tools_histogram_add_migration(uvm_va_space_t *va_space,
+                                          uvm_processor_id_t src,
+                                          uvm_processor_id_t dst,
+                                          NvU64 bytes,
+                                          NvU64 duration_ns)
+{
+    uvm_tools_histogram_t *histogram;
+
+    // bytes per microsecond is MB/s
+    NvU64 bandwidth = bytes * 1000 / max(duration_ns, 1ULL);
+
+    list_for_each_entry(histogram, &va_space->tools.histograms, histogram_node) {
+        histogram_add(histogram->histograms->migrationBytes[uvm_id_value(src)][uvm_id_value(dst)], bytes);
+        histogram_add(histogram->histograms->migrationBandwidthMBps[uvm_id_value(src)][uvm_id_value(dst)], bandwidth);
+    }
+}
+
+// Throttling start and end are reported per page. The histogram tracks the
+// periods during which any page is throttled on the processor, which does not
+// require storing a timestamp per page.
+static void tools_histogram_throttling_start(uvm_va_space_t *va_space, uvm_processor_id_t processor, NvU64 timestamp)
+{
+    uvm_tools_histogram_t *histogram;
+    NvU32 id = uvm_id_value(processor);
+
+    list_for_each_entry(histogram, &va_space->tools.histograms, histogram_node) {
+        if (atomic_inc_return(&histogram->throttled_pages[id]) == 1)
+            atomic64_set(&histogram->throttling_start[id], timestamp);
+    }
+}
+
+static void tools_histogram_throttling_end(uvm_va_space_t *va_space, uvm_processor_id_t processor, NvU64 timestamp)
+{
+    uvm_tools_histogram_t *histogram;
+    NvU32 id = uvm_id_value(processor);
+
+    list_for_each_entry(histogram, &va_space->tools.histograms, histogram_node) {
+        NvU64 start;
+
+        // Periods that started before the tracker was created are not
+        // accounted.
+        if (atomic_dec_if_positive(&histogram->throttled_pages[id]) != 0)
+            continue;
+
+        start = atomic64_read(&histogram->throttling_start[id]);
+        histogram_add(histogram->histograms->throttlingDurationNs[id], timestamp > start ? timestamp - start : 0);
+    }
+}
+
 static bool tools_is_counter_enabled(uvm_va_space_t *va_space, UvmCounterName counter)
 {
     uvm_assert_rwsem_locked(&va_space->tools.lock);
@@ -544,6 +761,31 @@ static bool tools_is_event_enabled(uvm_va_space_t *va_space, UvmEventType event)
     return !list_empty(va_space->tools.queues + event);
 }
 
+// Returns whether the next event of the given type passes the sampling of the
+// VA space. Every call counts as an event.
+static bool tools_sample_event(uvm_va_space_t *va_space, UvmEventType event)
+{
+    NvU32 interval = va_space->tools.sampling[event].interval;
+    NvU64 period_ns = va_space->tools.sampling[event].period_ns;
+
+    uvm_assert_rwsem_locked(&va_space->tools.lock);
+
+    if (interval > 1 && (atomic_inc_return(&va_space->tools.sampling[event].count) % interval) != 0)
+        return false;
+
+    if (period_ns != 0) {
+        atomic64_t *next_timestamp = &va_space->tools.sampling[event].next_timestamp;
+        NvU64 now = NV_GETTIME();
+        NvU64 next = atomic64_read(next_timestamp);
+
+        // Only one of the concurrent callers wins the period
+        if (now < next || atomic64_cmpxchg(next_timestamp, next, now + period_ns) != next)
+            return false;
+    }
+
+    return true;
+}
+
 static bool tools_is_event_enabled_in_any_va_space(UvmEventType event)
 {
     bool ret = false;
@@ -569,20 +811,29 @@ static bool tools_are_enabled(uvm_va_space_t *va_space)
         if (tools_is_event_enabled(va_space, i))
             return true;
     }
-    return false;
+    return tools_is_histogram_enabled(va_space);
 }
 
 static bool tools_is_fault_callback_needed(uvm_va_space_t *va_space)
 {
-    return tools_is_event_enabled(va_space, UvmEventTypeCpuFault) ||
+    return tools_is_histogram_enabled(va_space) ||
+           tools_is_event_enabled(va_space, UvmEventTypeCpuFault) ||
            tools_is_event_enabled(va_space, UvmEventTypeGpuFault) ||
+           tools_is_event_enabled(va_space, UvmEventTypeTimeCalibration) ||
            tools_is_counter_enabled(va_space, UvmCounterNameCpuPageFaultCount) ||
            tools_is_counter_enabled(va_space, UvmCounterNameGpuPageFaultCount);
 }
 
+// Migrations are tracked with GPU timestamps through the delayed notification
+// mechanism for both the migration events and the histograms.
+static bool tools_is_migration_tracking_needed(uvm_va_space_t *va_space)
+{
+    return tools_is_event_enabled(va_space, UvmEventTypeMigration) || tools_is_histogram_enabled(va_space);
+}
+
 static bool tools_is_migration_callback_needed(uvm_va_space_t *va_space)
 {
-    return tools_is_event_enabled(va_space, UvmEventTypeMigration) ||
+    return tools_is_migration_tracking_needed(va_space) ||
            tools_is_event_enabled(va_space, UvmEventTypeReadDuplicate) ||
            tools_is_counter_enabled(va_space, UvmCounterNameBytesXferDtH) ||
            tools_is_counter_enabled(va_space, UvmCounterNameBytesXferHtD);
@@ -618,9 +869,13 @@ static long uvm_tools_unlocked_ioctl(struct file *filp, unsigned int cmd, unsign
 {
     switch (cmd) {
         UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_INIT_EVENT_TRACKER,         uvm_api_tools_init_event_tracker);
+        UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_INIT_EVENT_TRACKER_PER_CPU, uvm_api_tools_init_event_tracker_per_cpu);
+        UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_INIT_HISTOGRAM_TRACKER,     uvm_api_tools_init_histogram_tracker);
+        UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_GET_HISTOGRAMS,             uvm_api_tools_get_histograms);
         UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_SET_NOTIFICATION_THRESHOLD, uvm_api_tools_set_notification_threshold);
         UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_EVENT_QUEUE_ENABLE_EVENTS,  uvm_api_tools_event_queue_enable_events);
         UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_EVENT_QUEUE_DISABLE_EVENTS, uvm_api_tools_event_queue_disable_events);
+        UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_EVENT_QUEUE_SET_SAMPLING,   uvm_api_tools_event_queue_set_sampling);
         UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_ENABLE_COUNTERS,            uvm_api_tools_enable_counters);
         UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TOOLS_DISABLE_COUNTERS,           uvm_api_tools_disable_counters);
     }
@@ -638,9 +893,7 @@ static long uvm_tools_unlocked_ioctl_entry(struct file *filp, unsigned int cmd,
 static unsigned uvm_tools_poll(struct file *filp, poll_table *wait)
 {
     int flags = 0;
-    uvm_tools_queue_snapshot_t sn;
     uvm_tools_event_tracker_t *event_tracker;
-    UvmToolsEventControlData *ctrl;
 
     if (uvm_global_get_status() != NV_OK)
         return POLLERR;
@@ -652,11 +905,8 @@ static unsigned uvm_tools_poll(struct file *filp, poll_table *wait)
     uvm_spin_lock(&event_tracker->queue.lock);
 
     event_tracker->queue.is_wakeup_get_valid = false;
-    ctrl = event_tracker->queue.control;
-    sn.get_ahead = atomic_read((atomic_t *)&ctrl->get_ahead);
-    sn.put_behind = atomic_read((atomic_t *)&ctrl->put_behind);
 
-    if (queue_needs_wakeup(&event_tracker->queue, &sn))
+    if (queue_any_ring_needs_wakeup(&event_tracker->queue, true))
         flags = POLLIN | POLLRDNORM;
 
     uvm_spin_unlock(&event_tracker->queue.lock);
@@ -743,6 +993,70 @@ static void record_gpu_fault_instance(uvm_gpu_t *gpu,
     uvm_tools_record_event(va_space, &entry);
 }
 
+// Reads the GPU clock bracketed by two reads of the CPU clock. The returned
+// CPU time is the midpoint of both reads, and uncertainty is the maximum
+// distance between it and the instant the GPU clock was read.
+static void tools_sample_gpu_time(uvm_gpu_t *gpu, NvU64 *cpu_time_ns, NvU64 *gpu_time_ns, NvU64 *uncertainty_ns)
+{
+    NvU64 cpu_begin = NV_GETTIME();
+    NvU64 cpu_end;
+
+    *gpu_time_ns = gpu->parent->host_hal->get_time(gpu);
+    cpu_end = NV_GETTIME();
+
+    *uncertainty_ns = (cpu_end - cpu_begin) / 2;
+    *cpu_time_ns = cpu_begin + *uncertainty_ns;
+}
+
+// Records a time calibration event for the GPU if the calibration period has
+// elapsed since the previous one in the VA space. Only one of the concurrent
+// callers records the event.
+static void record_time_calibration(uvm_gpu_t *gpu, uvm_va_space_t *va_space)
+{
+    UvmEventEntry entry;
+    UvmEventTimeCalibrationInfo *info = &entry.eventData.timeCalibration;
+    NvU32 gpu_index = uvm_id_gpu_index(gpu->id);
+    atomic64_t *next_timestamp = &va_space->tools.time_calibration[gpu_index].next_timestamp;
+    NvU64 period_ns = (NvU64)uvm_tools_time_calibration_period_ms * 1000 * 1000;
+    NvU64 now = NV_GETTIME();
+    NvU64 next = atomic64_read(next_timestamp);
+    NvU64 prev_cpu_time_ns;
+    NvU64 prev_gpu_time_ns;
+    NvU64 cpu_time_ns;
+    NvU64 gpu_time_ns;
+    NvU64 uncertainty_ns;
+
+    uvm_assert_rwsem_locked(&va_space->tools.lock);
+
+    if (now < next || atomic64_cmpxchg(next_timestamp, next, now + period_ns) != next)
+        return;
+
+    prev_cpu_time_ns = va_space->tools.time_calibration[gpu_index].cpu_time_ns;
+    prev_gpu_time_ns = va_space->tools.time_calibration[gpu_index].gpu_time_ns;
+
+    tools_sample_gpu_time(gpu, &cpu_time_ns, &gpu_time_ns, &uncertainty_ns);
+
+    memset(&entry, 0, sizeof(entry));
+
+    info->eventType    = UvmEventTypeTimeCalibration;
+    info->gpuIndex     = uvm_id_value(gpu->id);
+    info->timeStamp    = cpu_time_ns;
+    info->timeStampGpu = gpu_time_ns;
+    info->uncertainty  = uncertainty_ns;
+    info->offset       = (NvS64)(gpu_time_ns - cpu_time_ns);
+
+    if (prev_cpu_time_ns != 0 && cpu_time_ns > prev_cpu_time_ns) {
+        NvS64 prev_offset = (NvS64)(prev_gpu_time_ns - prev_cpu_time_ns);
+
+        info->drift = (info->offset - prev_offset) * 1000 * 1000 * 1000 / (NvS64)(cpu_time_ns - prev_cpu_time_ns);
+    }
+
+    va_space->tools.time_calibration[gpu_index].cpu_time_ns = cpu_time_ns;
+    va_space->tools.time_calibration[gpu_index].gpu_time_ns = gpu_time_ns;
+
+    uvm_tools_record_event(va_space, &entry);
+}
+
 static void uvm_tools_record_fault(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
 {
     uvm_va_space_t *va_space = event_data->fault.space;
@@ -750,7 +1064,7 @@ static void uvm_tools_record_fault(uvm_perf_event_t event_id, uvm_perf_event_dat
     UVM_ASSERT(event_id == UVM_PERF_EVENT_FAULT);
     UVM_ASSERT(event_data->fault.space);
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
     uvm_assert_rwsem_locked(&va_space->perf_events.lock);
     UVM_ASSERT(va_space->tools.enabled);
 
@@ -758,7 +1072,8 @@ static void uvm_tools_record_fault(uvm_perf_event_t event_id, uvm_perf_event_dat
     UVM_ASSERT(tools_is_fault_callback_needed(va_space));
 
     if (UVM_ID_IS_CPU(event_data->fault.proc_id)) {
-        if (tools_is_event_enabled(va_space, UvmEventTypeCpuFault)) {
+        if (tools_is_event_enabled(va_space, UvmEventTypeCpuFault) &&
+            tools_sample_event(va_space, UvmEventTypeCpuFault)) {
             UvmEventEntry entry;
             UvmEventCpuFaultInfo *info = &entry.eventData.cpuFault;
             memset(&entry, 0, sizeof(entry));
@@ -800,7 +1115,13 @@ static void uvm_tools_record_fault(uvm_perf_event_t event_id, uvm_perf_event_dat
         uvm_gpu_t *gpu = uvm_va_space_get_gpu(va_space, event_data->fault.proc_id);
         UVM_ASSERT(gpu);
 
-        if (tools_is_event_enabled(va_space, UvmEventTypeGpuFault)) {
+        // Calibration events are recorded ahead of the fault events, so that
+        // tools have a calibration sample for the GPU before they need one
+        if (tools_is_event_enabled(va_space, UvmEventTypeTimeCalibration))
+            record_time_calibration(gpu, va_space);
+
+        if (tools_is_event_enabled(va_space, UvmEventTypeGpuFault) &&
+            tools_sample_event(va_space, UvmEventTypeGpuFault)) {
             NvU64 timestamp = NV_GETTIME();
             uvm_fault_buffer_entry_t *fault_entry = event_data->fault.gpu.buffer_entry;
             uvm_fault_buffer_entry_t *fault_instance;
@@ -813,6 +1134,24 @@ static void uvm_tools_record_fault(uvm_perf_event_t event_id, uvm_perf_event_dat
 
         if (tools_is_counter_enabled(va_space, UvmCounterNameGpuPageFaultCount))
             uvm_tools_inc_counter(va_space, UvmCounterNameGpuPageFaultCount, 1, uvm_gpu_uuid(gpu));
+
+        if (tools_is_histogram_enabled(va_space)) {
+            NvU64 timestamp_gpu = gpu->parent->host_hal->get_time(gpu);
+            uvm_fault_buffer_entry_t *fault_entry = event_data->fault.gpu.buffer_entry;
+            uvm_fault_buffer_entry_t *fault_instance;
+
+            tools_histogram_add_gpu_fault_latency(va_space,
+                                                  gpu->id,
+                                                  timestamp_gpu > fault_entry->timestamp ?
+                                                      timestamp_gpu - fault_entry->timestamp : 0);
+
+            list_for_each_entry(fault_instance, &fault_entry->merged_instances_list, merged_instances_list) {
+                tools_histogram_add_gpu_fault_latency(va_space,
+                                                      gpu->id,
+                                                      timestamp_gpu > fault_instance->timestamp ?
+                                                          timestamp_gpu - fault_instance->timestamp : 0);
+            }
+        }
     }
     uvm_up_read(&va_space->tools.lock);
 }
@@ -867,7 +1206,16 @@ static void record_migration_events(void *args)
         gpu_timestamp = mig->end_timestamp_gpu;
         kmem_cache_free(g_tools_migration_data_cache, mig);
 
-        uvm_tools_record_event(va_space, &entry);
+        if (block_mig->record_events)
+            uvm_tools_record_event(va_space, &entry);
+
+        if (tools_is_histogram_enabled(va_space)) {
+            tools_histogram_add_migration(va_space,
+                                          block_mig->src,
+                                          block_mig->dst,
+                                          info->migratedBytes,
+                                          info->endTimeStampGpu - info->beginTimeStampGpu);
+        }
     }
     uvm_up_read(&va_space->tools.lock);
 
@@ -983,7 +1331,7 @@ static void uvm_tools_record_migration(uvm_perf_event_t event_id, uvm_perf_event
     uvm_down_read(&va_space->tools.lock);
     UVM_ASSERT(tools_is_migration_callback_needed(va_space));
 
-    if (tools_is_event_enabled(va_space, UvmEventTypeMigration)) {
+    if (tools_is_migration_tracking_needed(va_space)) {
         migration_data_t *mig;
         uvm_push_info_t *push_info = uvm_push_info_from_push(event_data->migration.push);
         block_migration_data_t *block_mig = (block_migration_data_t *)push_info->on_complete_data;
@@ -1136,7 +1484,7 @@ void uvm_tools_record_block_migration_begin(uvm_va_block_t *va_block,
 
     // During evictions the va_space lock is not held.
     if (cause != UVM_MAKE_RESIDENT_CAUSE_EVICTION)
-        uvm_assert_rwsem_locked(&va_space->lock);
+        uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!va_space->tools.enabled)
         return;
@@ -1144,13 +1492,18 @@ void uvm_tools_record_block_migration_begin(uvm_va_block_t *va_block,
     uvm_down_read(&va_space->tools.lock);
 
     // Perform delayed notification only if the VA space has signed up for
-    // UvmEventTypeMigration
-    if (tools_is_event_enabled(va_space, UvmEventTypeMigration)) {
+    // UvmEventTypeMigration or for histograms
+    if (tools_is_migration_tracking_needed(va_space)) {
         block_migration_data_t *block_mig;
         uvm_push_info_t *push_info = uvm_push_info_from_push(push);
+        bool record_events = tools_is_event_enabled(va_space, UvmEventTypeMigration) &&
+                             tools_sample_event(va_space, UvmEventTypeMigration);
 
         UVM_ASSERT(push_info->on_complete == NULL && push_info->on_complete_data == NULL);
 
+        if (!record_events && !tools_is_histogram_enabled(va_space))
+            goto done_unlock;
+
         block_mig = kmem_cache_alloc(g_tools_block_migration_data_cache, NV_UVM_GFP_FLAGS);
         if (block_mig == NULL)
             goto done_unlock;
@@ -1161,6 +1514,7 @@ void uvm_tools_record_block_migration_begin(uvm_va_block_t *va_block,
         block_mig->dst = dst_id;
         block_mig->src = src_id;
         block_mig->range_group_id = UVM_RANGE_GROUP_ID_NONE;
+        block_mig->record_events = record_events;
 
         // During evictions, it is not safe to uvm_range_group_range_find() because the va_space lock is not held.
         if (cause != UVM_MAKE_RESIDENT_CAUSE_EVICTION) {
@@ -1183,6 +1537,47 @@ done_unlock:
     uvm_up_read(&va_space->tools.lock);
 }
 
+void uvm_tools_record_block_migration_end(uvm_va_block_t *va_block,
+                                          uvm_push_t *push,
+                                          uvm_processor_id_t dst_id,
+                                          uvm_processor_id_t src_id,
+                                          NvU64 bytes,
+                                          uvm_make_resident_cause_t cause)
+{
+    uvm_va_space_t *va_space = uvm_va_block_get_va_space(va_block);
+    uvm_push_info_t *push_info = uvm_push_info_from_push(push);
+
+    UVM_ASSERT(push_info->migration_stats == NULL);
+
+    if (bytes == 0)
+        return;
+
+    if (UVM_ID_IS_CPU(src_id))
+        push_info->migration_stats = &uvm_va_space_get_gpu(va_space, dst_id)->migration_stats.from_cpu;
+    else
+        push_info->migration_stats = &uvm_va_space_get_gpu(va_space, src_id)->migration_stats.to[uvm_id_value(dst_id)];
+
+    push_info->migration_bytes = bytes;
+    push_info->migration_is_eviction = cause == UVM_MAKE_RESIDENT_CAUSE_EVICTION;
+    push_info->migration_end_time = NV_GETTIME();
+}
+
+void uvm_tools_record_block_migration_complete(uvm_push_info_t *push_info)
+{
+    uvm_gpu_migration_stats_t *stats = push_info->migration_stats;
+    NvU64 now = NV_GETTIME();
+
+    UVM_ASSERT(stats);
+
+    atomic64_add(push_info->migration_bytes, &stats->bytes);
+    atomic64_add(now > push_info->migration_end_time ? now - push_info->migration_end_time : 0, &stats->copy_ns);
+    atomic64_inc(&stats->pushes);
+    if (push_info->migration_is_eviction)
+        atomic64_inc(&stats->evictions);
+
+    push_info->migration_stats = NULL;
+}
+
 void uvm_tools_record_read_duplicate(uvm_va_block_t *va_block,
                                      uvm_processor_id_t dst,
                                      uvm_va_block_region_t region,
@@ -1298,7 +1693,7 @@ void uvm_tools_record_cpu_fatal_fault(uvm_va_space_t *va_space,
                                       bool is_write,
                                       UvmEventFatalReason reason)
 {
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!va_space->tools.enabled)
         return;
@@ -1327,7 +1722,7 @@ void uvm_tools_record_gpu_fatal_fault(uvm_gpu_id_t gpu_id,
                                       const uvm_fault_buffer_entry_t *buffer_entry,
                                       UvmEventFatalReason reason)
 {
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!va_space->tools.enabled)
         return;
@@ -1360,7 +1755,7 @@ void uvm_tools_record_thrashing(uvm_va_space_t *va_space,
     UVM_ASSERT(PAGE_ALIGNED(address));
     UVM_ASSERT(region_size > 0);
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!va_space->tools.enabled)
         return;
@@ -1388,7 +1783,7 @@ void uvm_tools_record_throttling_start(uvm_va_space_t *va_space, NvU64 address,
     UVM_ASSERT(PAGE_ALIGNED(address));
     UVM_ASSERT(UVM_ID_IS_VALID(processor));
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!va_space->tools.enabled)
         return;
@@ -1406,6 +1801,8 @@ void uvm_tools_record_throttling_start(uvm_va_space_t *va_space, NvU64 address,
 
         uvm_tools_record_event(va_space, &entry);
     }
+    if (tools_is_histogram_enabled(va_space))
+        tools_histogram_throttling_start(va_space, processor, NV_GETTIME());
     uvm_up_read(&va_space->tools.lock);
 }
 
@@ -1415,7 +1812,7 @@ void uvm_tools_record_throttling_end(uvm_va_space_t *va_space, NvU64 address, uv
     UVM_ASSERT(PAGE_ALIGNED(address));
     UVM_ASSERT(UVM_ID_IS_VALID(processor));
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!va_space->tools.enabled)
         return;
@@ -1433,6 +1830,8 @@ void uvm_tools_record_throttling_end(uvm_va_space_t *va_space, NvU64 address, uv
 
         uvm_tools_record_event(va_space, &entry);
     }
+    if (tools_is_histogram_enabled(va_space))
+        tools_histogram_throttling_end(va_space, processor, NV_GETTIME());
     uvm_up_read(&va_space->tools.lock);
 }
 
@@ -1505,7 +1904,7 @@ void uvm_tools_record_map_remote(uvm_va_block_t *va_block,
     UVM_ASSERT(UVM_ID_IS_VALID(residency));
     UVM_ASSERT(cause != UvmEventMapRemoteCauseInvalid);
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!va_space->tools.enabled)
         return;
@@ -1579,35 +1978,48 @@ done:
     uvm_up_read(&va_space->tools.lock);
 }
 
-NV_STATUS uvm_api_tools_init_event_tracker(UVM_TOOLS_INIT_EVENT_TRACKER_PARAMS *params, struct file *filp)
+// Common implementation of UVM_TOOLS_INIT_EVENT_TRACKER and
+// UVM_TOOLS_INIT_EVENT_TRACKER_PER_CPU. ring_count is 0 for the former.
+// Take a reference on the UVM file the tracker listens to. On failure,
+// event_tracker->uvm_file is left NULL.
+static NV_STATUS tools_event_tracker_get_uvm_file(uvm_tools_event_tracker_t *event_tracker, NvU32 uvm_fd)
 {
-    NV_STATUS status = NV_OK;
-    uvm_tools_event_tracker_t *event_tracker;
-
-    event_tracker = nv_kmem_cache_zalloc(g_tools_event_tracker_cache, NV_UVM_GFP_FLAGS);
-    if (event_tracker == NULL)
-        return NV_ERR_NO_MEMORY;
+    NV_STATUS status;
 
-    event_tracker->uvm_file = fget(params->uvmFd);
-    if (event_tracker->uvm_file == NULL) {
-        status = NV_ERR_INSUFFICIENT_PERMISSIONS;
-        goto fail;
-    }
+    event_tracker->uvm_file = fget(uvm_fd);
+    if (event_tracker->uvm_file == NULL)
+        return NV_ERR_INSUFFICIENT_PERMISSIONS;
 
     if (!uvm_file_is_nvidia_uvm(event_tracker->uvm_file)) {
         fput(event_tracker->uvm_file);
         event_tracker->uvm_file = NULL;
-        status = NV_ERR_INSUFFICIENT_PERMISSIONS;
-        goto fail;
+        return NV_ERR_INSUFFICIENT_PERMISSIONS;
     }
 
     status = uvm_va_space_initialized(uvm_va_space_get(event_tracker->uvm_file));
     if (status != NV_OK) {
         fput(event_tracker->uvm_file);
         event_tracker->uvm_file = NULL;
-        goto fail;
     }
 
+    return status;
+}
+
+static NV_STATUS tools_init_event_tracker(UVM_TOOLS_INIT_EVENT_TRACKER_PARAMS *params,
+                                          NvU32 ring_count,
+                                          struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    uvm_tools_event_tracker_t *event_tracker;
+
+    event_tracker = nv_kmem_cache_zalloc(g_tools_event_tracker_cache, NV_UVM_GFP_FLAGS);
+    if (event_tracker == NULL)
+        return NV_ERR_NO_MEMORY;
+
+    status = tools_event_tracker_get_uvm_file(event_tracker, params->uvmFd);
+    if (status != NV_OK)
+        goto fail;
+
     event_tracker->is_queue = params->queueBufferSize != 0;
     if (event_tracker->is_queue) {
         uvm_tools_queue_t *queue = &event_tracker->queue;
@@ -1628,15 +2040,31 @@ NV_STATUS uvm_api_tools_init_event_tracker(UVM_TOOLS_INIT_EVENT_TRACKER_PARAMS *
             goto fail;
         }
 
+        if (ring_count) {
+            // Each possible CPU needs its own ring
+            if (ring_count < nr_cpu_ids || (NvU64)ring_count * queue->queue_buffer_count > UINT_MAX) {
+                status = NV_ERR_INVALID_ARGUMENT;
+                goto fail;
+            }
+
+            queue->ring_wakeup_signaled = uvm_kvmalloc_zero(sizeof(*queue->ring_wakeup_signaled) * ring_count);
+            if (!queue->ring_wakeup_signaled) {
+                status = NV_ERR_NO_MEMORY;
+                goto fail;
+            }
+
+            queue->ring_count = ring_count;
+        }
+
         status = map_user_pages(params->queueBuffer,
-                                queue->queue_buffer_count * sizeof(UvmEventEntry),
+                                (NvU64)queue_ring_count(queue) * queue->queue_buffer_count * sizeof(UvmEventEntry),
                                 (void **)&queue->queue,
                                 &queue->queue_buffer_pages);
         if (status != NV_OK)
             goto fail;
 
         status = map_user_pages(params->controlBuffer,
-                                sizeof(UvmToolsEventControlData),
+                                queue_ring_count(queue) * sizeof(UvmToolsEventControlData),
                                 (void **)&queue->control,
                                 &queue->control_buffer_pages);
 
@@ -1667,10 +2095,105 @@ fail:
     return status;
 }
 
+NV_STATUS uvm_api_tools_init_event_tracker(UVM_TOOLS_INIT_EVENT_TRACKER_PARAMS *params, struct file *filp)
+{
+    return tools_init_event_tracker(params, 0, filp);
+}
+
+NV_STATUS uvm_api_tools_init_event_tracker_per_cpu(UVM_TOOLS_INIT_EVENT_TRACKER_PER_CPU_PARAMS *params,
+                                                   struct file *filp)
+{
+    UVM_TOOLS_INIT_EVENT_TRACKER_PARAMS init_params = {0};
+
+    if (params->queueBufferSize == 0 || params->ringCount == 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    init_params.queueBuffer = params->queueBuffer;
+    init_params.queueBufferSize = params->queueBufferSize;
+    init_params.controlBuffer = params->controlBuffer;
+    init_params.uvmFd = params->uvmFd;
+
+    return tools_init_event_tracker(&init_params, params->ringCount, filp);
+}
+
+NV_STATUS uvm_api_tools_init_histogram_tracker(UVM_TOOLS_INIT_HISTOGRAM_TRACKER_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_va_space_t *va_space;
+    uvm_tools_event_tracker_t *event_tracker;
+    uvm_tools_histogram_t *histogram;
+
+    event_tracker = nv_kmem_cache_zalloc(g_tools_event_tracker_cache, NV_UVM_GFP_FLAGS);
+    if (event_tracker == NULL)
+        return NV_ERR_NO_MEMORY;
+
+    event_tracker->is_histogram = true;
+    histogram = &event_tracker->histogram;
+    INIT_LIST_HEAD(&histogram->histogram_node);
+
+    status = tools_event_tracker_get_uvm_file(event_tracker, params->uvmFd);
+    if (status != NV_OK)
+        goto fail;
+
+    histogram->histograms = uvm_kvmalloc_zero(sizeof(*histogram->histograms));
+    if (histogram->histograms == NULL) {
+        status = NV_ERR_NO_MEMORY;
+        goto fail;
+    }
+
+    va_space = tools_event_tracker_va_space(event_tracker);
+
+    uvm_down_write(&g_tools_va_space_list_lock);
+    uvm_down_write(&va_space->perf_events.lock);
+    uvm_down_write(&va_space->tools.lock);
+
+    list_add(&histogram->histogram_node, &va_space->tools.histograms);
+
+    status = tools_update_status(va_space);
+    if (status != NV_OK)
+        list_del_init(&histogram->histogram_node);
+
+    uvm_up_write(&va_space->tools.lock);
+    uvm_up_write(&va_space->perf_events.lock);
+    uvm_up_write(&g_tools_va_space_list_lock);
+
+    if (status != NV_OK)
+        goto fail;
+
+    if (nv_atomic_long_cmpxchg((atomic_long_t *)&filp->private_data, 0, (long)event_tracker) != 0) {
+        status = NV_ERR_INVALID_ARGUMENT;
+        goto fail;
+    }
+
+    return NV_OK;
+
+fail:
+    destroy_event_tracker(event_tracker);
+    return status;
+}
+
+NV_STATUS uvm_api_tools_get_histograms(UVM_TOOLS_GET_HISTOGRAMS_PARAMS *params, struct file *filp)
+{
+    uvm_tools_event_tracker_t *event_tracker = tools_event_tracker(filp);
+
+    if (!tracker_is_histogram(event_tracker))
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->histogramBufferSize < sizeof(UvmToolsHistograms))
+        return NV_ERR_INVALID_ARGUMENT;
+
+    // The buckets are updated concurrently, so this is not an atomic snapshot
+    // across buckets.
+    if (copy_to_user((void __user *)params->histogramBuffer,
+                     event_tracker->histogram.histograms,
+                     sizeof(UvmToolsHistograms)))
+        return NV_ERR_INVALID_ADDRESS;
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_api_tools_set_notification_threshold(UVM_TOOLS_SET_NOTIFICATION_THRESHOLD_PARAMS *params, struct file *filp)
 {
-    UvmToolsEventControlData *ctrl;
-    uvm_tools_queue_snapshot_t sn;
     uvm_tools_event_tracker_t *event_tracker = tools_event_tracker(filp);
 
     if (!tracker_is_queue(event_tracker))
@@ -1678,13 +2201,9 @@ NV_STATUS uvm_api_tools_set_notification_threshold(UVM_TOOLS_SET_NOTIFICATION_TH
 
     uvm_spin_lock(&event_tracker->queue.lock);
 
-    event_tracker->queue.notification_threshold = params->notificationThreshold;
+    WRITE_ONCE(event_tracker->queue.notification_threshold, params->notificationThreshold);
 
-    ctrl = event_tracker->queue.control;
-    sn.put_behind = atomic_read((atomic_t *)&ctrl->put_behind);
-    sn.get_ahead = atomic_read((atomic_t *)&ctrl->get_ahead);
-
-    if (queue_needs_wakeup(&event_tracker->queue, &sn))
+    if (queue_any_ring_needs_wakeup(&event_tracker->queue, false))
         wake_up_all(&event_tracker->queue.wait_queue);
 
     uvm_spin_unlock(&event_tracker->queue.lock);
@@ -1738,6 +2257,35 @@ static NV_STATUS tools_update_perf_events_callbacks(uvm_va_space_t *va_space)
     return NV_OK;
 }
 
+static void tools_update_sampling(uvm_va_space_t *va_space)
+{
+    NvU32 i;
+
+    uvm_assert_rwsem_locked_write(&va_space->tools.lock);
+
+    for (i = 0; i < UvmEventNumTypesAll; i++) {
+        uvm_tools_queue_t *queue;
+        NvU32 interval = 0;
+        NvU64 period_ns = 0;
+        bool first = true;
+
+        list_for_each_entry(queue, va_space->tools.queues + i, queue_nodes[i]) {
+            if (first) {
+                interval = queue->sample_interval[i];
+                period_ns = queue->sample_period_ns[i];
+                first = false;
+            }
+            else {
+                interval = min(interval, queue->sample_interval[i]);
+                period_ns = min(period_ns, queue->sample_period_ns[i]);
+            }
+        }
+
+        va_space->tools.sampling[i].interval = interval;
+        va_space->tools.sampling[i].period_ns = period_ns;
+    }
+}
+
 static NV_STATUS tools_update_status(uvm_va_space_t *va_space)
 {
     NV_STATUS status;
@@ -1751,6 +2299,8 @@ static NV_STATUS tools_update_status(uvm_va_space_t *va_space)
     if (status != NV_OK)
         return status;
 
+    tools_update_sampling(va_space);
+
     should_be_enabled = tools_are_enabled(va_space);
     if (should_be_enabled != va_space->tools.enabled) {
         if (should_be_enabled)
@@ -1878,6 +2428,39 @@ NV_STATUS uvm_api_tools_event_queue_disable_events(UVM_TOOLS_EVENT_QUEUE_DISABLE
     return NV_OK;
 }
 
+NV_STATUS uvm_api_tools_event_queue_set_sampling(UVM_TOOLS_EVENT_QUEUE_SET_SAMPLING_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space;
+    uvm_tools_event_tracker_t *event_tracker = tools_event_tracker(filp);
+    const NvU64 sampled_events = (1ULL << UvmEventTypeCpuFault) |
+                                 (1ULL << UvmEventTypeGpuFault) |
+                                 (1ULL << UvmEventTypeMigration);
+    NvU32 i;
+
+    if (!tracker_is_queue(event_tracker))
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->eventTypeFlags & ~sampled_events)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    va_space = tools_event_tracker_va_space(event_tracker);
+
+    uvm_down_write(&va_space->tools.lock);
+
+    for (i = 0; i < UvmEventNumTypesAll; i++) {
+        if (params->eventTypeFlags & (1ULL << i)) {
+            event_tracker->queue.sample_interval[i] = params->sampleInterval;
+            event_tracker->queue.sample_period_ns[i] = params->samplePeriodNs;
+        }
+    }
+
+    tools_update_sampling(va_space);
+
+    uvm_up_write(&va_space->tools.lock);
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_api_tools_enable_counters(UVM_TOOLS_ENABLE_COUNTERS_PARAMS *params, struct file *filp)
 {
     uvm_va_space_t *va_space;
@@ -1954,20 +2537,78 @@ static NV_STATUS tools_access_va_block(uvm_va_block_t *va_block,
                                        NvU64 target_va,
                                        NvU64 size,
                                        bool is_write,
-                                       void *stage)
+                                       uvm_mem_t *stage_mem,
+                                       uvm_tracker_t *out_tracker)
 {
     NV_STATUS status;
 
     if (is_write)
         status = UVM_VA_BLOCK_LOCK_RETRY(va_block, NULL,
-                     uvm_va_block_write_from_cpu(va_block, target_va, stage, size));
+                     uvm_va_block_write_from_cpu(va_block, target_va, stage_mem, size, out_tracker));
     else
         status = UVM_VA_BLOCK_LOCK_RETRY(va_block, NULL,
-                     uvm_va_block_read_to_cpu(va_block, stage, target_va, size));
+                     uvm_va_block_read_to_cpu(va_block, stage_mem, target_va, size, out_tracker));
 
     return status;
 }
 
+// Staging state of one chunk of a tools_access_process_memory() call
+typedef struct
+{
+    uvm_mem_t *mem;
+
+    // Copies between the staging buffer and the target process' memory
+    uvm_tracker_t tracker;
+
+    // Chunk currently staged in the buffer, if size is not 0
+    NvU64 user_va;
+    NvU64 offset;
+    NvU64 size;
+} tools_access_stage_t;
+
+// Wait for the copies of the chunk staged in stage to complete, then check for
+// ECC errors on all GPUs registered in the VA space. For simplicity, all GPUs
+// are checked as tools read/write is not on a perf critical path.
+//
+// LOCKING: the caller must hold the RM flavor of the va_space lock in read mode
+static NV_STATUS tools_access_stage_wait(uvm_va_space_t *va_space, tools_access_stage_t *stage)
+{
+    NV_STATUS status;
+    uvm_global_processor_mask_t global_gpus;
+
+    status = uvm_tracker_wait(&stage->tracker);
+    if (status != NV_OK)
+        return status;
+
+    uvm_va_space_global_gpus(va_space, &global_gpus);
+
+    return uvm_global_mask_check_ecc_error(&global_gpus);
+}
+
+// Copy a chunk read into stage out to the user buffer
+static NV_STATUS tools_access_stage_copy_out(tools_access_stage_t *stage)
+{
+    void *stage_addr = (char *)uvm_mem_get_cpu_addr_kernel(stage->mem) + stage->offset;
+
+    // Prevent processor speculation prior to accessing user-mapped memory to
+    // avoid leaking information from side-channel attacks. Under speculation,
+    // a valid VA range which does not contain target_va could be used, and the
+    // block index could run off the end of the array. Information about the
+    // state of that kernel memory could be inferred if speculative execution
+    // gets to the point where the data is copied out.
+    nv_speculation_barrier();
+
+    if (nv_copy_to_user((void *)stage->user_va, stage_addr, stage->size) != 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    return NV_OK;
+}
+
+// The memory is accessed in chunks of up to a VA block, staged through two
+// sysmem buffers used in turns. The copies between a chunk and the target
+// memory are only waited on once the next chunk has been started, so the copy
+// engines move one chunk while the CPU copies the other one from or to the
+// user buffer.
 static NV_STATUS tools_access_process_memory(uvm_va_space_t *va_space,
                                              NvU64 target_va,
                                              NvU64 size,
@@ -1976,31 +2617,47 @@ static NV_STATUS tools_access_process_memory(uvm_va_space_t *va_space,
                                              bool is_write)
 {
     NV_STATUS status = NV_OK;
+    NV_STATUS wait_status;
     uvm_va_block_t *block;
-    uvm_mem_t *stage_mem;
-    void *stage_addr;
-
-    status = uvm_mem_alloc_sysmem_and_map_cpu_kernel(PAGE_SIZE, &stage_mem);
-    if (status != NV_OK)
-        return status;
+    tools_access_stage_t stages[2];
+    tools_access_stage_t *cur = &stages[0];
+    tools_access_stage_t *prev = &stages[1];
+    NvU64 stage_size;
+    NvU64 bytes_issued = 0;
+    size_t i;
 
-    stage_addr = uvm_mem_get_cpu_addr_kernel(stage_mem);
     *bytes = 0;
 
-    while (*bytes < size) {
-        NvU64 user_va_start = user_va + *bytes;
-        NvU64 target_va_start = target_va + *bytes;
-        NvU64 bytes_left = size - *bytes;
+    if (size == 0)
+        return NV_OK;
+
+    stage_size = min((NvU64)UVM_VA_BLOCK_SIZE, UVM_ALIGN_UP((target_va & (PAGE_SIZE - 1)) + size, PAGE_SIZE));
+
+    memset(stages, 0, sizeof(stages));
+    for (i = 0; i < ARRAY_SIZE(stages); i++) {
+        uvm_tracker_init(&stages[i].tracker);
+        status = uvm_mem_alloc_sysmem_and_map_cpu_kernel(stage_size, &stages[i].mem);
+        if (status != NV_OK)
+            goto out;
+    }
+
+    while (bytes_issued < size) {
+        NvU64 user_va_start = user_va + bytes_issued;
+        NvU64 target_va_start = target_va + bytes_issued;
+        NvU64 bytes_left = size - bytes_issued;
         NvU64 page_offset = target_va_start & (PAGE_SIZE - 1);
-        NvU64 bytes_now = min(bytes_left, (NvU64)(PAGE_SIZE - page_offset));
+        NvU64 bytes_now = min(bytes_left, stage_size - page_offset);
 
+        // cur's buffer is not in use: its previous chunk was waited on by the
+        // previous iteration. If the chunk ends up cut short at the end of its
+        // block, the rest is copied again with the next one.
         if (is_write) {
-            NvU64 remaining = nv_copy_from_user(stage_addr, (void *)user_va_start, bytes_now);
-            if (remaining != 0)  {
+            void *stage_addr = (char *)uvm_mem_get_cpu_addr_kernel(cur->mem) + page_offset;
+
+            if (nv_copy_from_user(stage_addr, (void *)user_va_start, bytes_now) != 0) {
                 status = NV_ERR_INVALID_ARGUMENT;
                 break;
             }
-
         }
 
         // The RM flavor of the lock is needed to perform ECC checks.
@@ -2010,49 +2667,63 @@ static NV_STATUS tools_access_process_memory(uvm_va_space_t *va_space,
             uvm_va_space_up_read_rm(va_space);
             break;
         }
-        status = tools_access_va_block(block,
-                                       target_va_start,
-                                       bytes_now,
-                                       is_write,
-                                       stage_mem);
-
-        // For simplicity, check for ECC errors on all GPUs registered in the VA
-        // space as tools read/write is not on a perf critical path.
-        if (status == NV_OK) {
-            uvm_global_processor_mask_t global_gpus;
 
-            uvm_va_space_global_gpus(va_space, &global_gpus);
+        bytes_now = min(bytes_now, block->end + 1 - target_va_start);
 
-            status = uvm_global_mask_check_ecc_error(&global_gpus);
+        status = tools_access_va_block(block, target_va_start, bytes_now, is_write, cur->mem, &cur->tracker);
+        if (status == NV_OK) {
+            cur->user_va = user_va_start;
+            cur->offset = page_offset;
+            cur->size = bytes_now;
+            bytes_issued += bytes_now;
         }
 
+        // Let the copies of this chunk run while the previous one completes
+        if (status == NV_OK && prev->size != 0)
+            status = tools_access_stage_wait(va_space, prev);
+
         uvm_va_space_up_read_rm(va_space);
         if (status != NV_OK)
             break;
 
-        if (!is_write) {
-            NvU64 remaining;
-
-            // Prevent processor speculation prior to accessing user-mapped
-            // memory to avoid leaking information from side-channel attacks.
-            // Under speculation, a valid VA range which does not contain
-            // target_va could be used, and the block index could run off the
-            // end of the array. Information about the state of that kernel
-            // memory could be inferred if speculative execution gets to the
-            // point where the data is copied out.
-            nv_speculation_barrier();
-
-            remaining = nv_copy_to_user((void *)user_va_start, stage_addr, bytes_now);
-            if (remaining > 0) {
-                status = NV_ERR_INVALID_ARGUMENT;
-                break;
+        if (prev->size != 0) {
+            if (!is_write) {
+                status = tools_access_stage_copy_out(prev);
+                if (status != NV_OK)
+                    break;
             }
+
+            *bytes += prev->size;
+            prev->size = 0;
         }
 
-        *bytes += bytes_now;
+        swap(cur, prev);
+    }
+
+    // Complete the last chunk. If an error occurred, still wait for all copies
+    // to be done with the buffers before freeing them.
+    uvm_va_space_down_read_rm(va_space);
+    wait_status = NV_OK;
+    if (prev->size != 0)
+        wait_status = tools_access_stage_wait(va_space, prev);
+    uvm_va_space_up_read_rm(va_space);
+
+    if (status == NV_OK)
+        status = wait_status;
+
+    if (status == NV_OK && prev->size != 0) {
+        if (!is_write)
+            status = tools_access_stage_copy_out(prev);
+
+        if (status == NV_OK)
+            *bytes += prev->size;
     }
 
-    uvm_mem_free(stage_mem);
+out:
+    for (i = 0; i < ARRAY_SIZE(stages); i++) {
+        uvm_tracker_wait_deinit(&stages[i].tracker);
+        uvm_mem_free(stages[i].mem);
+    }
 
     return status;
 }
@@ -2152,6 +2823,25 @@ NV_STATUS uvm_api_tools_flush_events(UVM_TOOLS_FLUSH_EVENTS_PARAMS *params, stru
     return NV_OK;
 }
 
+NV_STATUS uvm_api_tools_get_gpu_time_calibration(UVM_TOOLS_GET_GPU_TIME_CALIBRATION_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_gpu_t *gpu;
+    NV_STATUS status = NV_OK;
+
+    uvm_va_space_down_read(va_space);
+
+    gpu = uvm_va_space_get_gpu_by_uuid(va_space, &params->gpuUuid);
+    if (gpu)
+        tools_sample_gpu_time(gpu, &params->cpuTimeStamp, &params->gpuTimeStamp, &params->uncertainty);
+    else
+        status = NV_ERR_INVALID_DEVICE;
+
+    uvm_va_space_up_read(va_space);
+
+    return status;
+}
+
 NV_STATUS uvm_test_tools_flush_replay_events(UVM_TEST_TOOLS_FLUSH_REPLAY_EVENTS_PARAMS *params, struct file *filp)
 {
     NV_STATUS status = NV_OK;
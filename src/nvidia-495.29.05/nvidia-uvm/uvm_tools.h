@@ -92,6 +92,23 @@ void uvm_tools_record_block_migration_begin(uvm_va_block_t *va_block,
                                             NvU64 start,
                                             uvm_make_resident_cause_t cause);
 
+// Account the bytes copied by push in the migration counters of the
+// (src_id, dst_id) pair once the push completes. Must be called right before
+// the push is ended. These counters are always enabled, regardless of the tools
+// sessions, see uvm_gpu_t::migration_stats.
+void uvm_tools_record_block_migration_end(uvm_va_block_t *va_block,
+                                          uvm_push_t *push,
+                                          uvm_processor_id_t dst_id,
+                                          uvm_processor_id_t src_id,
+                                          NvU64 bytes,
+                                          uvm_make_resident_cause_t cause);
+
+// Called from uvm_pushbuffer_mark_completed() when a push with migration
+// counters attached completes.
+//
+// LOCKING: the channel pool lock is held.
+void uvm_tools_record_block_migration_complete(uvm_push_info_t *push_info);
+
 void uvm_tools_record_read_duplicate(uvm_va_block_t *va_block,
                                      uvm_processor_id_t dst,
                                      uvm_va_block_region_t region,
@@ -0,0 +1,213 @@
+/*******************************************************************************
+    Copyright (c) 2021 NVIDIA Corporation
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal in the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be
+        included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+// Linux tracepoints for the fault servicing, migration, eviction, thrashing
+// and push paths. Unlike the UVM tools events, these are visible to ftrace,
+// perf and eBPF, and cost a single static branch each when disabled.
+//
+// This header follows the layout required by <trace/define_trace.h> and is
+// included a second time by uvm_trace.c to create the tracepoints. It must
+// not include other UVM headers, so the tracepoints only take plain values.
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM nvidia_uvm
+
+#if !defined(__UVM_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __UVM_TRACE_H__
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(uvm_fault_batch_begin,
+    TP_PROTO(u32 gpu_id, u32 batch_id, u32 num_faults),
+    TP_ARGS(gpu_id, batch_id, num_faults),
+    TP_STRUCT__entry(
+        __field(u32, gpu_id)
+        __field(u32, batch_id)
+        __field(u32, num_faults)
+    ),
+    TP_fast_assign(
+        __entry->gpu_id = gpu_id;
+        __entry->batch_id = batch_id;
+        __entry->num_faults = num_faults;
+    ),
+    TP_printk("gpu %u batch %u faults %u", __entry->gpu_id, __entry->batch_id, __entry->num_faults)
+);
+
+TRACE_EVENT(uvm_fault_batch_end,
+    TP_PROTO(u32 gpu_id, u32 batch_id, u32 num_duplicate_faults, u32 num_replays, u32 status),
+    TP_ARGS(gpu_id, batch_id, num_duplicate_faults, num_replays, status),
+    TP_STRUCT__entry(
+        __field(u32, gpu_id)
+        __field(u32, batch_id)
+        __field(u32, num_duplicate_faults)
+        __field(u32, num_replays)
+        __field(u32, status)
+    ),
+    TP_fast_assign(
+        __entry->gpu_id = gpu_id;
+        __entry->batch_id = batch_id;
+        __entry->num_duplicate_faults = num_duplicate_faults;
+        __entry->num_replays = num_replays;
+        __entry->status = status;
+    ),
+    TP_printk("gpu %u batch %u duplicates %u replays %u status 0x%x",
+              __entry->gpu_id,
+              __entry->batch_id,
+              __entry->num_duplicate_faults,
+              __entry->num_replays,
+              __entry->status)
+);
+
+// Processors are identified by their UVM id value: 0 is the CPU and GPUs
+// start at 1.
+TRACE_EVENT(uvm_block_make_resident_begin,
+    TP_PROTO(u64 start, u64 end, u32 dst_id, u32 cause),
+    TP_ARGS(start, end, dst_id, cause),
+    TP_STRUCT__entry(
+        __field(u64, start)
+        __field(u64, end)
+        __field(u32, dst_id)
+        __field(u32, cause)
+    ),
+    TP_fast_assign(
+        __entry->start = start;
+        __entry->end = end;
+        __entry->dst_id = dst_id;
+        __entry->cause = cause;
+    ),
+    TP_printk("[0x%llx, 0x%llx] dst %u cause %u", __entry->start, __entry->end, __entry->dst_id, __entry->cause)
+);
+
+TRACE_EVENT(uvm_block_make_resident_end,
+    TP_PROTO(u64 start, u32 dst_id, u32 status),
+    TP_ARGS(start, dst_id, status),
+    TP_STRUCT__entry(
+        __field(u64, start)
+        __field(u32, dst_id)
+        __field(u32, status)
+    ),
+    TP_fast_assign(
+        __entry->start = start;
+        __entry->dst_id = dst_id;
+        __entry->status = status;
+    ),
+    TP_printk("0x%llx dst %u status 0x%x", __entry->start, __entry->dst_id, __entry->status)
+);
+
+TRACE_EVENT(uvm_evict_root_chunk_begin,
+    TP_PROTO(u32 gpu_id, u64 address),
+    TP_ARGS(gpu_id, address),
+    TP_STRUCT__entry(
+        __field(u32, gpu_id)
+        __field(u64, address)
+    ),
+    TP_fast_assign(
+        __entry->gpu_id = gpu_id;
+        __entry->address = address;
+    ),
+    TP_printk("gpu %u chunk 0x%llx", __entry->gpu_id, __entry->address)
+);
+
+TRACE_EVENT(uvm_evict_root_chunk_end,
+    TP_PROTO(u32 gpu_id, u64 address, u32 status),
+    TP_ARGS(gpu_id, address, status),
+    TP_STRUCT__entry(
+        __field(u32, gpu_id)
+        __field(u64, address)
+        __field(u32, status)
+    ),
+    TP_fast_assign(
+        __entry->gpu_id = gpu_id;
+        __entry->address = address;
+        __entry->status = status;
+    ),
+    TP_printk("gpu %u chunk 0x%llx status 0x%x", __entry->gpu_id, __entry->address, __entry->status)
+);
+
+DECLARE_EVENT_CLASS(uvm_throttling,
+    TP_PROTO(u64 address, u32 processor_id),
+    TP_ARGS(address, processor_id),
+    TP_STRUCT__entry(
+        __field(u64, address)
+        __field(u32, processor_id)
+    ),
+    TP_fast_assign(
+        __entry->address = address;
+        __entry->processor_id = processor_id;
+    ),
+    TP_printk("0x%llx processor %u", __entry->address, __entry->processor_id)
+);
+
+DEFINE_EVENT(uvm_throttling, uvm_throttling_start,
+    TP_PROTO(u64 address, u32 processor_id),
+    TP_ARGS(address, processor_id)
+);
+
+DEFINE_EVENT(uvm_throttling, uvm_throttling_end,
+    TP_PROTO(u64 address, u32 processor_id),
+    TP_ARGS(address, processor_id)
+);
+
+TRACE_EVENT(uvm_push_begin,
+    TP_PROTO(u32 gpu_id, const char *channel_name),
+    TP_ARGS(gpu_id, channel_name),
+    TP_STRUCT__entry(
+        __field(u32, gpu_id)
+        __array(char, channel_name, 64)
+    ),
+    TP_fast_assign(
+        __entry->gpu_id = gpu_id;
+        strlcpy(__entry->channel_name, channel_name, sizeof(__entry->channel_name));
+    ),
+    TP_printk("gpu %u channel %s", __entry->gpu_id, __entry->channel_name)
+);
+
+TRACE_EVENT(uvm_push_end,
+    TP_PROTO(u32 gpu_id, const char *channel_name, u32 size, u64 tracker_value),
+    TP_ARGS(gpu_id, channel_name, size, tracker_value),
+    TP_STRUCT__entry(
+        __field(u32, gpu_id)
+        __array(char, channel_name, 64)
+        __field(u32, size)
+        __field(u64, tracker_value)
+    ),
+    TP_fast_assign(
+        __entry->gpu_id = gpu_id;
+        strlcpy(__entry->channel_name, channel_name, sizeof(__entry->channel_name));
+        __entry->size = size;
+        __entry->tracker_value = tracker_value;
+    ),
+    TP_printk("gpu %u channel %s size %u value %llu",
+              __entry->gpu_id,
+              __entry->channel_name,
+              __entry->size,
+              __entry->tracker_value)
+);
+
+#endif // __UVM_TRACE_H__
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE uvm_trace
+#include <trace/define_trace.h>
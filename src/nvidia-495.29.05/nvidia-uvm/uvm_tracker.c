@@ -53,14 +53,29 @@ uvm_tracker_entry_t *uvm_tracker_get_entries(uvm_tracker_t *tracker)
     }
 }
 
-static uvm_tracker_entry_t *get_new_entry(uvm_tracker_t *tracker)
+// Tracker entries are kept sorted by channel, with at most one entry per
+// channel holding the max value tracked for it. That keeps merging trackers
+// linear in the number of entries.
+static bool entry_channel_before(uvm_tracker_entry_t *a, uvm_tracker_entry_t *b)
 {
+    return (uintptr_t)a->channel < (uintptr_t)b->channel;
+}
+
+// Insert a new entry at the given index, shifting the following entries
+static uvm_tracker_entry_t *get_new_entry(uvm_tracker_t *tracker, NvU32 index)
+{
+    uvm_tracker_entry_t *entries;
     NV_STATUS status = uvm_tracker_reserve(tracker, 1);
     if (status != NV_OK)
         return NULL;
     UVM_ASSERT(tracker->size < tracker->max_size);
+    UVM_ASSERT(index <= tracker->size);
 
-    return &uvm_tracker_get_entries(tracker)[tracker->size++];
+    entries = uvm_tracker_get_entries(tracker);
+    memmove(&entries[index + 1], &entries[index], (tracker->size - index) * sizeof(*entries));
+    tracker->size++;
+
+    return &entries[index];
 }
 
 NV_STATUS uvm_tracker_init_from(uvm_tracker_t *dst, uvm_tracker_t *src)
@@ -137,15 +152,21 @@ NV_STATUS uvm_tracker_add_push(uvm_tracker_t *tracker, uvm_push_t *push)
 NV_STATUS uvm_tracker_add_entry(uvm_tracker_t *tracker, uvm_tracker_entry_t *new_entry)
 {
     uvm_tracker_entry_t *tracker_entry;
+    NvU32 index = 0;
 
     for_each_tracker_entry(tracker_entry, tracker) {
         if (tracker_entry->channel == new_entry->channel) {
             tracker_entry->value = max(tracker_entry->value, new_entry->value);
             return NV_OK;
         }
+
+        if (entry_channel_before(new_entry, tracker_entry))
+            break;
+
+        ++index;
     }
 
-    tracker_entry = get_new_entry(tracker);
+    tracker_entry = get_new_entry(tracker, index);
     if (tracker_entry == NULL)
         return NV_ERR_NO_MEMORY;
 
@@ -175,49 +196,83 @@ void uvm_tracker_overwrite_with_push(uvm_tracker_t *tracker, uvm_push_t *push)
     uvm_tracker_overwrite_with_entry(tracker, &entry);
 }
 
-static NV_STATUS reserve_for_entries_from_tracker(uvm_tracker_t *dst, uvm_tracker_t *src)
+// Count the entries of src for channels not tracked by dst
+static NvU32 count_new_entries_from_tracker(uvm_tracker_t *dst, uvm_tracker_t *src)
 {
-    NvU32 needed_free_entries = 0;
-    uvm_tracker_entry_t *src_entry, *dst_entry;
+    uvm_tracker_entry_t *dst_entries = uvm_tracker_get_entries(dst);
+    uvm_tracker_entry_t *src_entries = uvm_tracker_get_entries(src);
+    NvU32 new_entries = 0;
+    NvU32 i = 0;
+    NvU32 j = 0;
 
-    for_each_tracker_entry(src_entry, src) {
-        bool found = false;
-        for_each_tracker_entry(dst_entry, dst) {
-            if (dst_entry->channel == src_entry->channel) {
-                found = true;
-                break;
-            }
+    while (j < src->size) {
+        if (i == dst->size || entry_channel_before(&src_entries[j], &dst_entries[i])) {
+            ++new_entries;
+            ++j;
+        }
+        else if (entry_channel_before(&dst_entries[i], &src_entries[j])) {
+            ++i;
+        }
+        else {
+            ++i;
+            ++j;
         }
-        if (!found)
-            needed_free_entries++;
     }
 
-    return uvm_tracker_reserve(dst, needed_free_entries);
+    return new_entries;
 }
 
 NV_STATUS uvm_tracker_add_tracker(uvm_tracker_t *dst, uvm_tracker_t *src)
 {
     NV_STATUS status;
-    uvm_tracker_entry_t *src_entry;
+    uvm_tracker_entry_t *dst_entries, *src_entries;
+    NvU32 new_entries;
+    NvU32 i, j, out;
 
     if (src == dst)
         return NV_OK;
 
-    status = uvm_tracker_reserve(dst, src->size);
+    new_entries = count_new_entries_from_tracker(dst, src);
+
+    status = uvm_tracker_reserve(dst, new_entries);
     if (status == NV_ERR_NO_MEMORY) {
         uvm_tracker_remove_completed(dst);
         uvm_tracker_remove_completed(src);
-        status = reserve_for_entries_from_tracker(dst, src);
+        new_entries = count_new_entries_from_tracker(dst, src);
+        status = uvm_tracker_reserve(dst, new_entries);
     }
     if (status != NV_OK) {
         return status;
     }
 
-    for_each_tracker_entry(src_entry, src) {
-        status = uvm_tracker_add_entry(dst, src_entry);
-        UVM_ASSERT_MSG(status == NV_OK, "Expected success with reserved memory but got error %d\n", status);
+    // Merge the sorted entries from the back so that dst entries are moved at
+    // most once
+    dst_entries = uvm_tracker_get_entries(dst);
+    src_entries = uvm_tracker_get_entries(src);
+    i = dst->size;
+    j = src->size;
+    out = dst->size + new_entries;
+
+    while (j > 0) {
+        if (i > 0 && entry_channel_before(&src_entries[j - 1], &dst_entries[i - 1])) {
+            dst_entries[--out] = dst_entries[--i];
+        }
+        else if (i > 0 && dst_entries[i - 1].channel == src_entries[j - 1].channel) {
+            --i;
+            --j;
+            dst_entries[--out].channel = dst_entries[i].channel;
+            dst_entries[out].value = max(dst_entries[i].value, src_entries[j].value);
+        }
+        else {
+            dst_entries[--out] = src_entries[--j];
+        }
     }
 
+    // The remaining dst entries are already in place
+    UVM_ASSERT(out == i);
+
+    dst->size += new_entries;
+
     return NV_OK;
 }
 
@@ -293,9 +348,12 @@ static void uvm_tracker_print_pending_pushes(uvm_tracker_t *tracker)
 static NV_STATUS wait_for_entry_with_spin(uvm_tracker_entry_t *tracker_entry, uvm_spin_loop_t *spin)
 {
     NV_STATUS status = NV_OK;
+    uvm_channel_manager_t *manager = NULL;
 
     while (!uvm_tracker_is_entry_completed(tracker_entry) && status == NV_OK) {
-        if (UVM_SPIN_LOOP(spin) == NV_ERR_TIMEOUT_RETRY)
+        manager = tracker_entry->channel->pool->manager;
+
+        if (uvm_channel_manager_wait_step(manager, spin) == NV_ERR_TIMEOUT_RETRY)
             uvm_tracker_entry_print_pending_pushes(tracker_entry);
 
         status = uvm_channel_check_errors(tracker_entry->channel);
@@ -303,6 +361,9 @@ static NV_STATUS wait_for_entry_with_spin(uvm_tracker_entry_t *tracker_entry, uv
             status = uvm_global_get_status();
     }
 
+    if (manager)
+        uvm_channel_manager_wait_done(manager, spin);
+
     if (status != NV_OK) {
         UVM_ASSERT(status == uvm_global_get_status());
         tracker_entry->channel = NULL;
@@ -319,19 +380,44 @@ NV_STATUS uvm_tracker_wait_for_entry(uvm_tracker_entry_t *tracker_entry)
     return wait_for_entry_with_spin(tracker_entry, &spin);
 }
 
+// Get the channel manager of the first pending entry in the tracker, if any
+static uvm_channel_manager_t *tracker_pending_manager(uvm_tracker_t *tracker)
+{
+    uvm_tracker_entry_t *entry;
+
+    for_each_tracker_entry(entry, tracker) {
+        if (!uvm_tracker_is_entry_completed(entry))
+            return entry->channel->pool->manager;
+    }
+
+    return NULL;
+}
+
 NV_STATUS uvm_tracker_wait(uvm_tracker_t *tracker)
 {
     NV_STATUS status = NV_OK;
     uvm_spin_loop_t spin;
+    uvm_channel_manager_t *manager = NULL;
 
     uvm_spin_loop_init(&spin);
     while (!uvm_tracker_is_completed(tracker) && status == NV_OK) {
-        if (UVM_SPIN_LOOP(&spin) == NV_ERR_TIMEOUT_RETRY)
+        NV_STATUS spin_status;
+
+        manager = tracker_pending_manager(tracker);
+        if (manager)
+            spin_status = uvm_channel_manager_wait_step(manager, &spin);
+        else
+            spin_status = UVM_SPIN_LOOP(&spin);
+
+        if (spin_status == NV_ERR_TIMEOUT_RETRY)
             uvm_tracker_print_pending_pushes(tracker);
 
         status = uvm_tracker_check_errors(tracker);
     }
 
+    if (manager)
+        uvm_channel_manager_wait_done(manager, &spin);
+
     if (status != NV_OK) {
         UVM_ASSERT(status == uvm_global_get_status());
 
@@ -407,21 +493,25 @@ NV_STATUS uvm_tracker_query(uvm_tracker_t *tracker)
 
 void uvm_tracker_remove_completed(uvm_tracker_t *tracker)
 {
-    NvU32 i = 0;
+    NvU32 i;
+    NvU32 remaining = 0;
 
     uvm_tracker_entry_t *entries = uvm_tracker_get_entries(tracker);
 
-    // Keep removing completed entries until we run out of entries
-    while (i < tracker->size) {
-        if (uvm_tracker_is_entry_completed(&entries[i])) {
-            --tracker->size;
-            if (i != tracker->size)
-                entries[i] = entries[tracker->size];
-        }
-        else {
-            ++i;
-        }
+    // Query each entry once and compact the pending ones in place, preserving
+    // their order. Each channel is tracked by a single entry, so each tracking
+    // semaphore is read at most once.
+    for (i = 0; i < tracker->size; ++i) {
+        if (uvm_tracker_is_entry_completed(&entries[i]))
+            continue;
+
+        if (remaining != i)
+            entries[remaining] = entries[i];
+
+        ++remaining;
     }
+
+    tracker->size = remaining;
 }
 
 bool uvm_tracker_is_completed(uvm_tracker_t *tracker)
@@ -126,6 +126,9 @@ void uvm_tracker_overwrite_with_push(uvm_tracker_t *tracker, uvm_push_t *push);
 // Add all entries from another tracker
 // This may require allocating memory to fit a new entry in the tracker.
 // On error no entries are added to destination tracker.
+//
+// Entries are kept sorted by channel, so this is linear in the number of
+// entries of both trackers.
 NV_STATUS uvm_tracker_add_tracker(uvm_tracker_t *dst, uvm_tracker_t *src);
 
 // "Safe" versions of the above. If memory cannot be allocated to add the new
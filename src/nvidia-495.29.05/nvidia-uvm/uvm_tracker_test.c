@@ -42,6 +42,18 @@ static NV_STATUS assert_tracker_is_completed(uvm_tracker_t *tracker)
     return NV_OK;
 }
 
+// Entries are expected to be sorted by channel, with a single entry per channel
+static NV_STATUS assert_tracker_is_sorted(uvm_tracker_t *tracker)
+{
+    NvU32 i;
+    uvm_tracker_entry_t *entries = uvm_tracker_get_entries(tracker);
+
+    for (i = 1; i < tracker->size; i++)
+        TEST_CHECK_RET((uintptr_t)entries[i - 1].channel < (uintptr_t)entries[i].channel);
+
+    return NV_OK;
+}
+
 static NV_STATUS assert_tracker_is_not_completed(uvm_tracker_t *tracker)
 {
     uvm_tracker_remove_completed(tracker);
@@ -385,8 +397,11 @@ static NV_STATUS test_tracker_add_tracker(uvm_va_space_t *va_space)
     }
     TEST_CHECK_GOTO(tracker.size == count, done);
 
+    TEST_CHECK_GOTO(assert_tracker_is_sorted(&tracker) == NV_OK, done);
+
     status = uvm_tracker_add_tracker_safe(&dup_tracker, &tracker);
     TEST_CHECK_GOTO(dup_tracker.size == count, done);
+    TEST_CHECK_GOTO(assert_tracker_is_sorted(&dup_tracker) == NV_OK, done);
     for_each_tracker_entry(dup_entry_iter, &dup_tracker) {
         bool found = false;
         for_each_tracker_entry(entry_iter, &tracker) {
@@ -29,10 +29,10 @@
 #include "hwref/turing/tu102/dev_mmu.h"
 #include "hwref/turing/tu102/dev_fault.h"
 
-// This is mainly a copy of make_pte_volta in uvm_volta_mmu. This version
+// This is mainly a copy of uvm_hal_volta_mmu_make_pte in uvm_volta_mmu. This version
 // sets NV_MMU_PTE_KIND_GENERIC_MEMORY, instead, since NV_MMU_PTE_KIND_PITCH
 // no longer exists.
-static NvU64 make_pte_turing(uvm_aperture_t aperture, NvU64 address, uvm_prot_t prot, NvU64 flags)
+NvU64 uvm_hal_turing_mmu_make_pte(uvm_aperture_t aperture, NvU64 address, uvm_prot_t prot, NvU64 flags)
 {
     NvU8 aperture_bits = 0;
     NvU64 pte_bits = 0;
@@ -131,7 +131,10 @@ static NvU64 poisoned_pte_turing(void)
     // be aligned to page_size.
     NvU64 phys_addr = 0x1bad000000ULL;
 
-    NvU64 pte_bits = make_pte_turing(UVM_APERTURE_VID, phys_addr, UVM_PROT_READ_ONLY, UVM_MMU_PTE_FLAGS_NONE);
+    NvU64 pte_bits = uvm_hal_turing_mmu_make_pte(UVM_APERTURE_VID,
+                                                 phys_addr,
+                                                 UVM_PROT_READ_ONLY,
+                                                 UVM_MMU_PTE_FLAGS_NONE);
     return WRITE_HWCONST64(pte_bits, _MMU_VER2, PTE, PRIVILEGE, TRUE);
 }
 
@@ -158,7 +161,7 @@ uvm_mmu_mode_hal_t *uvm_hal_mmu_mode_turing(NvU32 big_page_size)
         uvm_assert_mutex_locked(&g_uvm_global.global_lock);
 
         turing_mmu_mode_hal = *volta_mmu_mode_hal;
-        turing_mmu_mode_hal.make_pte = make_pte_turing;
+        turing_mmu_mode_hal.make_pte = uvm_hal_turing_mmu_make_pte;
         turing_mmu_mode_hal.make_sked_reflected_pte = make_sked_reflected_pte_turing;
         turing_mmu_mode_hal.poisoned_pte = poisoned_pte_turing;
 
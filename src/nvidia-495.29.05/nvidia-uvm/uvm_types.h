@@ -163,6 +163,24 @@ typedef struct
     NvU32           gpuCompressionType; // UvmGpuCompressionType
 } UvmGpuMappingAttributes;
 
+//------------------------------------------------------------------------------
+// Residency run, see UVM_GET_RESIDENCY_INFO
+//
+// Describes the pages in [start, start + length), which all have the same
+// residency, mappings and read duplication. Processors are indexed the same
+// way as in UvmEventEntry, and bit i of residentOn and mappedOn is set if the
+// pages are resident on, or mapped by, processor i.
+//------------------------------------------------------------------------------
+typedef struct
+{
+    NvU64 start       NV_ALIGN_BYTES(8);
+    NvU64 length      NV_ALIGN_BYTES(8);
+    NvU64 residentOn  NV_ALIGN_BYTES(8);
+    NvU64 mappedOn    NV_ALIGN_BYTES(8);
+    NvU32 readDuplicated;
+    NvU32 padding;
+} UvmResidencyRun;
+
 // forward declaration of OS-dependent structure
 struct UvmGlobalState_tag;
 
@@ -354,6 +372,7 @@ typedef enum
     UvmEventTypeThrottlingEnd              = 12,
     UvmEventTypeMapRemote                  = 13,
     UvmEventTypeEviction                   = 14,
+    UvmEventTypeTimeCalibration            = 15,
 
     // ---- Add new values above this line
     UvmEventNumTypes,
@@ -386,6 +405,7 @@ typedef enum
 #define UVM_EVENT_ENABLE_THROTTLING_END               ((NvU64)1 << UvmEventTypeThrottlingEnd)
 #define UVM_EVENT_ENABLE_MAP_REMOTE                   ((NvU64)1 << UvmEventTypeMapRemote)
 #define UVM_EVENT_ENABLE_EVICTION                     ((NvU64)1 << UvmEventTypeEviction)
+#define UVM_EVENT_ENABLE_TIME_CALIBRATION             ((NvU64)1 << UvmEventTypeTimeCalibration)
 #define UVM_EVENT_ENABLE_TEST_ACCESS_COUNTER          ((NvU64)1 << UvmEventTypeTestAccessCounter)
 
 //------------------------------------------------------------------------------
@@ -919,6 +939,38 @@ typedef struct
     NvU64 timeStamp;        // cpu time stamp when eviction starts on the cpu
 } UvmEventEvictionInfo;
 
+//------------------------------------------------------------------------------
+// Information associated with a time calibration event. Calibration events are
+// recorded periodically for each GPU reporting GPU faults, and pair a cpu time
+// stamp with a gpu time stamp read at the same instant, so that the gpu time
+// stamps of other events can be placed on the cpu timeline.
+//------------------------------------------------------------------------------
+typedef struct
+{
+    //
+    // eventType has to be the 1st argument of this structure.
+    // Setting eventType = UvmEventTypeTimeCalibration helps to identify event
+    // data in a queue.
+    //
+    NvU8 eventType;
+    NvU8 gpuIndex;          // index of the gpu whose clock is calibrated
+    //
+    // This structure is shared between UVM kernel and tools.
+    // Manually padding the structure so that compiler options like pragma pack
+    // or malign-double will have no effect on the field offsets
+    //
+    NvU16 padding16bits;
+    NvU32 padding32bits;
+    NvU64 timeStamp;        // cpu time stamp of the calibration sample
+    NvU64 timeStampGpu;     // gpu time stamp of the calibration sample
+    NvU64 uncertainty;      // maximum distance in ns between the instant the
+                            // gpu time stamp was read and timeStamp
+    NvS64 offset;           // timeStampGpu - timeStamp
+    NvS64 drift;            // change of offset since the previous calibration
+                            // event of the gpu, in parts per billion of the
+                            // elapsed cpu time. Zero in the first event.
+} UvmEventTimeCalibrationInfo;
+
 // TODO: Bug 1870362: [uvm] Provide virtual address and processor index in
 // AccessCounter events
 //
@@ -1003,6 +1055,7 @@ typedef struct
             UvmEventThrottlingEndInfo throttlingEnd;
             UvmEventMapRemoteInfo mapRemote;
             UvmEventEvictionInfo eviction;
+            UvmEventTimeCalibrationInfo timeCalibration;
         } eventData;
 
         union
@@ -1063,6 +1116,30 @@ typedef struct UvmEventControlData_tag {
     NvU64 dropped[UvmEventNumTypesAll];
 } UvmToolsEventControlData;
 
+//------------------------------------------------------------------------------
+// Aggregated histograms, see UVM_TOOLS_INIT_HISTOGRAM_TRACKER
+//
+// Bucket i counts the samples in [2^i, 2^(i + 1)). Bucket 0 also counts zero
+// samples and the last bucket also counts all larger samples. Processors are
+// indexed the same way as in UvmEventEntry.
+//------------------------------------------------------------------------------
+#define UVM_TOOLS_HISTOGRAM_BUCKETS 32
+
+typedef struct UvmToolsHistograms_tag {
+    // Time in ns from a GPU fault being written to the fault buffer until
+    // the driver services it, indexed by faulting GPU.
+    NvU64 gpuFaultLatencyNs[UVM_MAX_PROCESSORS][UVM_TOOLS_HISTOGRAM_BUCKETS];
+
+    // Duration in ns of the periods during which at least one page is
+    // throttled on the processor.
+    NvU64 throttlingDurationNs[UVM_MAX_PROCESSORS][UVM_TOOLS_HISTOGRAM_BUCKETS];
+
+    // Size in bytes and bandwidth in MB/s of migrations, indexed by source
+    // and destination processor.
+    NvU64 migrationBytes[UVM_MAX_PROCESSORS][UVM_MAX_PROCESSORS][UVM_TOOLS_HISTOGRAM_BUCKETS];
+    NvU64 migrationBandwidthMBps[UVM_MAX_PROCESSORS][UVM_MAX_PROCESSORS][UVM_TOOLS_HISTOGRAM_BUCKETS];
+} UvmToolsHistograms;
+
 //------------------------------------------------------------------------------
 // UVM Tools forward types (handles) definitions
 //------------------------------------------------------------------------------
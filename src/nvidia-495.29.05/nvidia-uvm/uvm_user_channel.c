@@ -291,11 +291,59 @@ static NvU64 find_va_in_range(uvm_va_space_t *va_space, NvU64 base, NvU64 end, N
     }
 }
 
+// Pick the VA of each channel resource within [base, end] ahead of
+// uvm_register_channel_under_write, so that the VA space lock doesn't need to
+// be held in write mode while searching the VA range tree. Only the VA space
+// lock in read mode is required. The VAs picked don't overlap existing VA
+// ranges nor each other, and are only hints: the VA ranges can change before
+// the lock is taken in write mode, and create_va_range checks the picked VA is
+// still free. Resources which don't fit get a 0 hint.
+static void plan_va_ranges(uvm_user_channel_t *user_channel, NvU64 base, NvU64 end, NvU64 *va_hints)
+{
+    uvm_va_space_t *va_space = user_channel->gpu_va_space->va_space;
+    NvU32 i, j;
+
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
+
+    for (i = 0; i < user_channel->num_resources; i++) {
+        UvmGpuChannelResourceInfo *resource = &user_channel->resources[i];
+        NvU64 size = resource->resourceInfo.size;
+        NvU64 curr_base = base;
+        NvU64 start = 0;
+
+        while (curr_base && curr_base < end) {
+            start = find_va_in_range(va_space, curr_base, end, size, resource->alignment);
+            if (!start)
+                break;
+
+            for (j = 0; j < i; j++) {
+                NvU64 planned_end = va_hints[j] + user_channel->resources[j].resourceInfo.size - 1;
+
+                if (va_hints[j] && start <= planned_end && va_hints[j] <= start + size - 1)
+                    break;
+            }
+
+            if (j == i)
+                break;
+
+            // Overlaps a previous resource, retry past it
+            curr_base = va_hints[j] + user_channel->resources[j].resourceInfo.size;
+            start = 0;
+        }
+
+        va_hints[i] = start;
+    }
+}
+
 // Allocate or reuse a VA range for the given channel resource, but don't map
-// it. If a new VA range is allocated, the VA used is the first unallocated VA
-// in the range [base, end] which has the appropriate alignment and size for the
-// given resource.
-static NV_STATUS create_va_range(uvm_user_channel_t *user_channel, NvU64 base, NvU64 end, NvU32 resource_index)
+// it. If a new VA range is allocated, the VA used is va_hint if that VA is
+// still free, or else the first unallocated VA in the range [base, end] which
+// has the appropriate alignment and size for the given resource.
+static NV_STATUS create_va_range(uvm_user_channel_t *user_channel,
+                                 NvU64 base,
+                                 NvU64 end,
+                                 NvU32 resource_index,
+                                 NvU64 va_hint)
 {
     uvm_gpu_va_space_t *gpu_va_space = user_channel->gpu_va_space;
     UvmGpuChannelResourceInfo *resource = &user_channel->resources[resource_index];
@@ -305,7 +353,7 @@ static NV_STATUS create_va_range(uvm_user_channel_t *user_channel, NvU64 base, N
     uvm_aperture_t aperture;
     NV_STATUS status;
 
-    uvm_assert_rwsem_locked_write(&gpu_va_space->va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&gpu_va_space->va_space->lock);
 
     if (mem_info->sysmem)
         aperture = UVM_APERTURE_SYS;
@@ -327,7 +375,11 @@ static NV_STATUS create_va_range(uvm_user_channel_t *user_channel, NvU64 base, N
 
     // This is a new VA range. Find an available VA in the input region and
     // allocate it there.
-    start = find_va_in_range(gpu_va_space->va_space, base, end, mem_info->size, resource->alignment);
+    if (va_hint && !uvm_va_space_iter_first(gpu_va_space->va_space, va_hint, va_hint + mem_info->size - 1))
+        start = va_hint;
+    else
+        start = find_va_in_range(gpu_va_space->va_space, base, end, mem_info->size, resource->alignment);
+
     if (!start) {
         UVM_DBG_PRINT("Range exceeded: allowed [0x%llx, 0x%llx], align: 0x%llx size: 0x%llx\n",
                       base,
@@ -400,7 +452,7 @@ static void destroy_va_ranges(uvm_user_channel_t *user_channel)
 // Channels need virtual allocations to operate, but we don't know about them.
 // This function carves out a chunk within [base, end] for each allocation for
 // later mapping.
-static NV_STATUS create_va_ranges(uvm_user_channel_t *user_channel, NvU64 base, NvU64 end)
+static NV_STATUS create_va_ranges(uvm_user_channel_t *user_channel, NvU64 base, NvU64 end, const NvU64 *va_hints)
 {
     NvU32 i;
     NV_STATUS status;
@@ -410,7 +462,7 @@ static NV_STATUS create_va_ranges(uvm_user_channel_t *user_channel, NvU64 base,
         return NV_ERR_NO_MEMORY;
 
     for (i = 0; i < user_channel->num_resources; i++) {
-        status = create_va_range(user_channel, base, end, i);
+        status = create_va_range(user_channel, base, end, i, va_hints ? va_hints[i] : 0);
         if (status != NV_OK)
             goto error;
     }
@@ -518,13 +570,16 @@ static NV_STATUS uvm_user_channel_map_resources(uvm_user_channel_t *user_channel
     return status == NV_OK ? tracker_status : status;
 }
 
-static NV_STATUS uvm_register_channel_under_write(uvm_user_channel_t *user_channel, NvU64 base, NvU64 length)
+static NV_STATUS uvm_register_channel_under_write(uvm_user_channel_t *user_channel,
+                                                  NvU64 base,
+                                                  NvU64 length,
+                                                  const NvU64 *va_hints)
 {
     uvm_gpu_va_space_t *gpu_va_space = user_channel->gpu_va_space;
     uvm_va_space_t *va_space = gpu_va_space->va_space;
     NV_STATUS status;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     // Currently all user channels are stopped when any process using the VA
     // space is torn down, unless it passed
@@ -562,7 +617,7 @@ static NV_STATUS uvm_register_channel_under_write(uvm_user_channel_t *user_chann
 
         // Create and insert the VA ranges, but don't map them yet since we
         // can't call RM until we downgrade the lock to read mode.
-        status = create_va_ranges(user_channel, base, end);
+        status = create_va_ranges(user_channel, base, end, va_hints);
         if (status != NV_OK)
             return status;
     }
@@ -582,6 +637,7 @@ static NV_STATUS uvm_register_channel(uvm_va_space_t *va_space,
     uvm_gpu_t *gpu;
     uvm_gpu_va_space_t *gpu_va_space;
     uvm_user_channel_t *user_channel = NULL;
+    NvU64 *va_hints = NULL;
     LIST_HEAD(deferred_free_list);
 
     uvm_va_space_down_read_rm(va_space);
@@ -592,6 +648,15 @@ static NV_STATUS uvm_register_channel(uvm_va_space_t *va_space,
         return status;
     }
 
+    // Search for the VAs of the channel resources while other threads can
+    // still service faults. The hints are optional, so failing to allocate
+    // them just means searching under the write lock.
+    if (user_channel->num_resources > 0) {
+        va_hints = uvm_kvmalloc(user_channel->num_resources * sizeof(va_hints[0]));
+        if (va_hints)
+            plan_va_ranges(user_channel, base, base + length - 1, va_hints);
+    }
+
     // Retain the GPU VA space so our channel's gpu_va_space pointer remains
     // valid after we drop the lock.
     uvm_gpu_va_space_retain(user_channel->gpu_va_space);
@@ -632,7 +697,9 @@ static NV_STATUS uvm_register_channel(uvm_va_space_t *va_space,
 
     // Performs verification checks and inserts the channel's VA ranges into the
     // VA space, but doesn't map them.
-    status = uvm_register_channel_under_write(user_channel, base, length);
+    status = uvm_register_channel_under_write(user_channel, base, length, va_hints);
+    uvm_kvfree(va_hints);
+    va_hints = NULL;
     if (status != NV_OK)
         goto error_under_write;
 
@@ -663,6 +730,7 @@ static NV_STATUS uvm_register_channel(uvm_va_space_t *va_space,
     return NV_OK;
 
 error_under_write:
+    uvm_kvfree(va_hints);
     if (user_channel->gpu_va_space)
         uvm_user_channel_detach(user_channel, &deferred_free_list);
     uvm_va_space_up_write(va_space);
@@ -746,7 +814,7 @@ void uvm_user_channel_stop(uvm_user_channel_t *user_channel)
     // TODO: Bug 1799173: Normal lock tracking should handle this assert once
     //       all RM calls have been moved out from under the VA space lock in
     //       write mode.
-    uvm_assert_rwsem_locked_read(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_read(&va_space->lock);
 
     // TODO: Bug 1737765. This doesn't stop the user from putting the
     //       channel back on the runlist, which could put stale instance
@@ -771,7 +839,7 @@ void uvm_user_channel_detach(uvm_user_channel_t *user_channel, struct list_head
     UVM_ASSERT(gpu_va_space);
     UVM_ASSERT(uvm_gpu_va_space_state(gpu_va_space) == UVM_GPU_VA_SPACE_STATE_ACTIVE);
     va_space = gpu_va_space->va_space;
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     // The caller is required to have already stopped the channel. We can't do
     // it here since we're holding the VA space lock in write mode.
@@ -31,9 +31,11 @@
 #include "uvm_hal_types.h"
 #include "uvm_kvmalloc.h"
 #include "uvm_tools.h"
+#include "uvm_trace.h"
 #include "uvm_push.h"
 #include "uvm_hal.h"
 #include "uvm_perf_thrashing.h"
+#include "uvm_perf_read_dup.h"
 #include "uvm_perf_prefetch.h"
 #include "uvm_mem.h"
 #include "uvm_gpu_access_counters.h"
@@ -78,8 +80,33 @@ MODULE_PARM_DESC(uvm_exp_gpu_cache_sysmem,
                  "Force caching for mappings to system memory. "
                  "This is an experimental parameter that may cause correctness issues if used.");
 
+// Number of VA blocks migrated ahead of a sequential stream of CPU faults. See
+// uvm_va_block_cpu_fault_readahead.
+#define UVM_CPU_FAULT_READAHEAD_BLOCKS_MAX 32
+
+static unsigned uvm_cpu_fault_readahead_blocks __read_mostly = 0;
+module_param(uvm_cpu_fault_readahead_blocks, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_cpu_fault_readahead_blocks,
+                 "Number of VA blocks to migrate asynchronously ahead of sequential CPU faults. "
+                 "Default: 0 (disabled), maximum: 32.");
+
 static void block_deferred_eviction_mappings_entry(void *args);
 
+// Returns whether the block follows the read duplication policy, either
+// because its range has been advised as ReadMostly or because the read
+// duplication heuristics promoted it.
+static bool block_is_read_duplicate(uvm_va_block_t *va_block)
+{
+    uvm_va_range_t *va_range = va_block->va_range;
+
+    if (uvm_va_range_is_read_duplicate(va_range))
+        return true;
+
+    return va_range->read_duplication == UVM_READ_DUPLICATION_UNSET &&
+           uvm_perf_read_dup_is_block_promoted(va_block) &&
+           uvm_va_space_can_read_duplicate(va_range->va_space, NULL);
+}
+
 uvm_va_space_t *uvm_va_block_get_va_space_maybe_dead(uvm_va_block_t *va_block)
 {
 #if UVM_IS_CONFIG_HMM()
@@ -260,6 +287,9 @@ NV_STATUS uvm_va_block_init(void)
 
 void uvm_va_block_exit(void)
 {
+    // Wait for the blocks freed with call_rcu
+    rcu_barrier();
+
     kmem_cache_destroy_safe(&g_uvm_va_block_context_cache);
     kmem_cache_destroy_safe(&g_uvm_page_mask_cache);
     kmem_cache_destroy_safe(&g_uvm_va_block_gpu_state_cache);
@@ -564,11 +594,30 @@ error:
     return status;
 }
 
+// The array of DMA addresses of CPU pages is only allocated once the block has
+// CPU pages to map on the GPU. GPUs which only map memory resident on other
+// GPUs, like read-only peer mappings, never need it.
+static NV_STATUS block_gpu_alloc_cpu_pages_dma_addrs(uvm_va_block_t *block, uvm_va_block_gpu_state_t *gpu_state)
+{
+    if (gpu_state->cpu_pages_dma_addrs)
+        return NV_OK;
+
+    gpu_state->cpu_pages_dma_addrs = uvm_kvmalloc_zero(uvm_va_block_num_cpu_pages(block) *
+                                                       sizeof(gpu_state->cpu_pages_dma_addrs[0]));
+    if (!gpu_state->cpu_pages_dma_addrs)
+        return NV_ERR_NO_MEMORY;
+
+    return NV_OK;
+}
+
 static void block_gpu_unmap_phys_all_cpu_pages(uvm_va_block_t *block, uvm_gpu_t *gpu)
 {
     uvm_page_index_t page_index;
     uvm_va_block_gpu_state_t *gpu_state = block_gpu_state_get(block, gpu->id);
 
+    if (!gpu_state->cpu_pages_dma_addrs)
+        return;
+
     for_each_va_block_page(page_index, block) {
         if (gpu_state->cpu_pages_dma_addrs[page_index] == 0)
             continue;
@@ -591,6 +640,10 @@ static NV_STATUS block_gpu_map_phys_all_cpu_pages(uvm_va_block_t *block, uvm_gpu
         if (!block->cpu.pages[page_index])
             continue;
 
+        status = block_gpu_alloc_cpu_pages_dma_addrs(block, gpu_state);
+        if (status != NV_OK)
+            goto error;
+
         status = uvm_gpu_map_cpu_page(gpu, block->cpu.pages[page_index], &gpu_state->cpu_pages_dma_addrs[page_index]);
         if (status != NV_OK)
             goto error;
@@ -725,10 +778,6 @@ static uvm_va_block_gpu_state_t *block_gpu_state_get_alloc(uvm_va_block_t *block
     if (!gpu_state->chunks)
         goto error;
 
-    gpu_state->cpu_pages_dma_addrs = uvm_kvmalloc_zero(uvm_va_block_num_cpu_pages(block) * sizeof(gpu_state->cpu_pages_dma_addrs[0]));
-    if (!gpu_state->cpu_pages_dma_addrs)
-        goto error;
-
     block->gpus[uvm_id_gpu_index(gpu->id)] = gpu_state;
 
     status = block_gpu_map_phys_all_cpu_pages(block, gpu);
@@ -741,6 +790,8 @@ error:
     if (gpu_state) {
         if (gpu_state->chunks)
             uvm_kvfree(gpu_state->chunks);
+        if (gpu_state->cpu_pages_dma_addrs)
+            uvm_kvfree(gpu_state->cpu_pages_dma_addrs);
         kmem_cache_free(g_uvm_va_block_gpu_state_cache, gpu_state);
     }
     block->gpus[uvm_id_gpu_index(gpu->id)] = NULL;
@@ -755,7 +806,7 @@ static void block_unmap_phys_cpu_page_on_gpus(uvm_va_block_t *block, uvm_page_in
     for_each_gpu_id(id) {
         uvm_gpu_t *gpu;
         uvm_va_block_gpu_state_t *gpu_state = block_gpu_state_get(block, id);
-        if (!gpu_state)
+        if (!gpu_state || !gpu_state->cpu_pages_dma_addrs)
             continue;
 
         if (gpu_state->cpu_pages_dma_addrs[page_index] == 0)
@@ -786,6 +837,10 @@ static NV_STATUS block_map_phys_cpu_page_on_gpus(uvm_va_block_t *block, uvm_page
         if (!gpu_state)
             continue;
 
+        status = block_gpu_alloc_cpu_pages_dma_addrs(block, gpu_state);
+        if (status != NV_OK)
+            goto error;
+
         UVM_ASSERT(gpu_state->cpu_pages_dma_addrs[page_index] == 0);
 
         gpu = block_get_gpu(block, id);
@@ -826,7 +881,7 @@ static NV_STATUS block_map_indirect_peers_to_gpu_chunk(uvm_va_block_t *block, uv
     //       eviction path. That will require making sure that peers can't be
     //       enabled or disabled either in the VA space or globally within this
     //       function.
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
     uvm_assert_mutex_locked(&block->lock);
 
     for_each_va_space_gpu_in_mask(accessing_gpu, va_space, &va_space->indirect_peers[uvm_id_value(gpu->id)]) {
@@ -861,7 +916,7 @@ static void block_unmap_indirect_peers_from_gpu_chunk(uvm_va_block_t *block, uvm
     uvm_va_space_t *va_space = uvm_va_block_get_va_space(block);
     uvm_gpu_t *peer_gpu;
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
     uvm_assert_mutex_locked(&block->lock);
 
     // Indirect peer mappings are removed lazily by PMM, so we only need to
@@ -1001,7 +1056,7 @@ static uvm_gpu_va_space_t *uvm_va_block_get_gpu_va_space(uvm_va_block_t *va_bloc
     UVM_ASSERT(gpu);
 
     if (!block_gpu_has_page_tables(va_block, gpu))
-        uvm_assert_rwsem_locked(&va_space->lock);
+        uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     UVM_ASSERT(uvm_processor_mask_test(&va_space->registered_gpu_va_spaces, gpu->id));
 
@@ -1035,6 +1090,11 @@ NvU32 uvm_va_block_gpu_big_page_size(uvm_va_block_t *va_block, uvm_gpu_t *gpu)
     return gpu_va_space->page_tables.big_page_size;
 }
 
+bool uvm_va_block_gpu_supports_2m(uvm_va_block_t *va_block, uvm_gpu_t *gpu)
+{
+    return block_gpu_supports_2m(va_block, gpu) && block_gpu_chunk_size(va_block, gpu, 0) == UVM_CHUNK_SIZE_2M;
+}
+
 static uvm_va_block_region_t range_big_page_region_all(NvU64 start, NvU64 end, NvU32 big_page_size)
 {
     NvU64 first_addr = UVM_ALIGN_UP(start, big_page_size);
@@ -1944,6 +2004,7 @@ static uvm_gpu_phys_address_t block_phys_page_address(uvm_va_block_t *block,
 
         // The page should be mapped for physical access already as we do that
         // eagerly on CPU page population and GPU state alloc.
+        UVM_ASSERT(accessing_gpu_state->cpu_pages_dma_addrs);
         UVM_ASSERT(dma_addr != 0);
 
         return uvm_gpu_phys_address(UVM_APERTURE_SYS, dma_addr);
@@ -2122,18 +2183,61 @@ static void block_mark_memory_used(uvm_va_block_t *block, uvm_processor_id_t id)
     // If the block is of the max size and the GPU supports eviction, mark the
     // root chunk as used in PMM.
     if (uvm_va_block_size(block) == UVM_CHUNK_SIZE_MAX && uvm_gpu_supports_eviction(gpu)) {
+        uvm_gpu_chunk_t *chunk;
+
         // The chunk has to be there if this GPU is resident
         UVM_ASSERT(uvm_processor_mask_test(&block->resident, id));
-        uvm_pmm_gpu_mark_root_chunk_used(&gpu->pmm, block_gpu_state_get(block, gpu->id)->chunks[0]);
+        chunk = block_gpu_state_get(block, gpu->id)->chunks[0];
+
+        if (block->va_range && block->va_range->residency_pinned)
+            uvm_pmm_gpu_mark_root_chunk_residency_pinned(&gpu->pmm, chunk);
+        else
+            uvm_pmm_gpu_mark_root_chunk_used(&gpu->pmm, chunk);
     }
 }
 
+void uvm_va_block_mark_memory_used(uvm_va_block_t *va_block)
+{
+    uvm_gpu_id_t id;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    for_each_gpu_id_in_mask(id, &va_block->resident)
+        block_mark_memory_used(va_block, id);
+}
+
+// Hint PMM that the memory of the block resident on the given processor has
+// been referenced, so that it is less likely to be picked for eviction.
+static void block_mark_memory_referenced(uvm_va_block_t *block, uvm_processor_id_t id)
+{
+    uvm_gpu_t *gpu;
+    uvm_va_block_gpu_state_t *gpu_state;
+
+    if (UVM_ID_IS_CPU(id))
+        return;
+
+    gpu = block_get_gpu(block, id);
+
+    // Like in block_mark_memory_used(), only root chunk sized blocks are
+    // tracked
+    if (uvm_va_block_size(block) != UVM_CHUNK_SIZE_MAX || !uvm_gpu_supports_eviction(gpu))
+        return;
+
+    gpu_state = block_gpu_state_get(block, gpu->id);
+    if (gpu_state && gpu_state->chunks[0])
+        uvm_pmm_gpu_mark_root_chunk_referenced(&gpu->pmm, gpu_state->chunks[0]);
+}
+
 static void block_set_resident_processor(uvm_va_block_t *block, uvm_processor_id_t id)
 {
     UVM_ASSERT(!uvm_page_mask_empty(uvm_va_block_resident_mask_get(block, id)));
 
-    if (uvm_processor_mask_test_and_set(&block->resident, id))
+    // More pages becoming resident on a processor the block was already
+    // resident on counts as a reference
+    if (uvm_processor_mask_test_and_set(&block->resident, id)) {
+        block_mark_memory_referenced(block, id);
         return;
+    }
 
     block_mark_memory_used(block, id);
 }
@@ -2230,6 +2334,160 @@ static uvm_va_block_region_t block_phys_contig_region(uvm_va_block_t *block,
     }
 }
 
+// Run of pages pending a copy whose source and destination are both
+// physically contiguous. Pages of block storage which is not contiguous as a
+// whole are often still adjacent to their neighbors (consecutive sysmem pages,
+// pages within the same GPU chunk, or adjacent chunks), so copies of such pages
+// are accumulated and issued with a single CE method instead of one per page.
+//
+// Runs of the same size repeating at a fixed source and destination stride,
+// for example every other 64K page of a contiguous block, are further
+// accumulated as the lines of a single multi-line copy.
+typedef struct
+{
+    // Run currently being extended
+    uvm_gpu_address_t src;
+    uvm_gpu_address_t dst;
+    size_t size;
+
+    // Lines of completed runs. The first line starts at lines_src/lines_dst
+    // and the following ones are src_pitch/dst_pitch bytes apart.
+    uvm_gpu_address_t lines_src;
+    uvm_gpu_address_t lines_dst;
+    NvU32 line_size;
+    NvU32 src_pitch;
+    NvU32 dst_pitch;
+    NvU32 line_count;
+} block_copy_run_t;
+
+static void block_copy_run_flush_lines(uvm_push_t *push, block_copy_run_t *run)
+{
+    uvm_gpu_t *gpu = uvm_push_get_gpu(push);
+
+    if (run->line_count == 0)
+        return;
+
+    uvm_push_set_flag(push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+
+    if (run->line_count == 1) {
+        uvm_hal_ce_memcopy(push, run->lines_dst, run->lines_src, run->line_size);
+    }
+    else {
+        gpu->parent->ce_hal->memcopy_2d(push,
+                                        run->lines_dst,
+                                        run->dst_pitch,
+                                        run->lines_src,
+                                        run->src_pitch,
+                                        run->line_size,
+                                        run->line_count);
+    }
+
+    run->line_count = 0;
+}
+
+// Return the offset of b from a if b follows a in the same address space, and
+// 0 otherwise.
+static NvU64 block_copy_run_pitch(uvm_gpu_address_t a, uvm_gpu_address_t b)
+{
+    if (a.is_virtual != b.is_virtual)
+        return 0;
+
+    if (!a.is_virtual && a.aperture != b.aperture)
+        return 0;
+
+    if (b.address <= a.address)
+        return 0;
+
+    return b.address - a.address;
+}
+
+// Add the current run as a new line, flushing the accumulated lines first if
+// it does not extend them
+static void block_copy_run_end_line(uvm_push_t *push, block_copy_run_t *run)
+{
+    if (run->size == 0)
+        return;
+
+    if (run->line_count > 0 && run->size == run->line_size) {
+        uvm_gpu_address_t last_src = run->lines_src;
+        uvm_gpu_address_t last_dst = run->lines_dst;
+        NvU64 src_pitch;
+        NvU64 dst_pitch;
+
+        if (run->line_count > 1) {
+            last_src.address += (NvU64)run->src_pitch * (run->line_count - 1);
+            last_dst.address += (NvU64)run->dst_pitch * (run->line_count - 1);
+        }
+
+        src_pitch = block_copy_run_pitch(last_src, run->src);
+        dst_pitch = block_copy_run_pitch(last_dst, run->dst);
+
+        if (run->line_count == 1 && src_pitch != 0 && dst_pitch != 0 && src_pitch <= U32_MAX && dst_pitch <= U32_MAX) {
+            run->src_pitch = (NvU32)src_pitch;
+            run->dst_pitch = (NvU32)dst_pitch;
+            run->line_count = 2;
+            run->size = 0;
+            return;
+        }
+
+        if (run->line_count > 1 &&
+            src_pitch == run->src_pitch &&
+            dst_pitch == run->dst_pitch &&
+            run->line_count < U32_MAX) {
+            ++run->line_count;
+            run->size = 0;
+            return;
+        }
+    }
+
+    block_copy_run_flush_lines(push, run);
+
+    if (run->size > U32_MAX) {
+        uvm_push_set_flag(push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+        uvm_hal_ce_memcopy(push, run->dst, run->src, run->size);
+    }
+    else {
+        run->lines_src = run->src;
+        run->lines_dst = run->dst;
+        run->line_size = (NvU32)run->size;
+        run->line_count = 1;
+    }
+
+    run->size = 0;
+}
+
+static void block_copy_run_flush(uvm_push_t *push, block_copy_run_t *run)
+{
+    block_copy_run_end_line(push, run);
+    block_copy_run_flush_lines(push, run);
+}
+
+static void block_copy_run_add(uvm_push_t *push,
+                               block_copy_run_t *run,
+                               uvm_gpu_address_t dst_address,
+                               uvm_gpu_address_t src_address,
+                               size_t size)
+{
+    if (run->size != 0) {
+        uvm_gpu_address_t run_src_end = run->src;
+        uvm_gpu_address_t run_dst_end = run->dst;
+
+        run_src_end.address += run->size;
+        run_dst_end.address += run->size;
+
+        if (uvm_gpu_addr_cmp(src_address, run_src_end) == 0 && uvm_gpu_addr_cmp(dst_address, run_dst_end) == 0) {
+            run->size += size;
+            return;
+        }
+
+        block_copy_run_end_line(push, run);
+    }
+
+    run->src = src_address;
+    run->dst = dst_address;
+    run->size = size;
+}
+
 // Copies pages resident on the src_id processor to the dst_id processor
 //
 // The function adds the pages that were successfully copied to the output
@@ -2269,6 +2527,9 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
     const bool is_dst_phys_contig = is_block_phys_contig(block, dst_id);
     uvm_gpu_address_t contig_src_address = {0};
     uvm_gpu_address_t contig_dst_address = {0};
+    block_copy_run_t copy_run = {0};
+    NvU64 copied_bytes = 0;
+    bool defer_copies = false;
     uvm_va_range_t *va_range = block->va_range;
     uvm_va_space_t *va_space = uvm_va_block_get_va_space(block);
     const uvm_va_block_transfer_mode_t block_transfer_mode = get_block_transfer_mode_from_internal(transfer_mode);
@@ -2372,6 +2633,11 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
             // we are in the eviction path). Therefore, we pass cause instead
             // of contig_cause
             uvm_tools_record_block_migration_begin(block, &push, dst_id, src_id, page_start, cause);
+
+            // Copies can be left pending across contiguous regions, so that
+            // regularly strided regions end up in a single multi-line copy,
+            // unless tools are tracking this migration.
+            defer_copies = uvm_push_info_from_push(&push)->on_complete == NULL;
         }
         else {
             uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
@@ -2399,7 +2665,7 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
             UVM_ASSERT(uvm_va_block_region_contains_region(region, contig_region));
 
             // If both src and dst are physically-contiguous, consolidate copies
-            // of contiguous pages into a single method.
+            // of contiguous pages into a single run.
             if (is_src_phys_contig && is_dst_phys_contig) {
                 uvm_gpu_address_t src_address = contig_src_address;
                 uvm_gpu_address_t dst_address = contig_dst_address;
@@ -2407,10 +2673,17 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
                 src_address.address += contig_start_index * PAGE_SIZE;
                 dst_address.address += contig_start_index * PAGE_SIZE;
 
-                uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-                copying_gpu->parent->ce_hal->memcopy(&push, dst_address, src_address, contig_region_size);
+                block_copy_run_add(&push, &copy_run, dst_address, src_address, contig_region_size);
             }
 
+            // Tools record a GPU timestamp per contiguous region when notified
+            // of the migration below, so the region needs to have been copied
+            // by then.
+            if (!defer_copies)
+                block_copy_run_flush(&push, &copy_run);
+
+            copied_bytes += contig_region_size;
+
             uvm_perf_event_notify_migration(&va_space->perf_events,
                                             &push,
                                             block,
@@ -2451,8 +2724,7 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
                 dst_address = block_phys_page_copy_address(block, block_phys_page(dst_id, page_index), copying_gpu);
             }
 
-            uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-            copying_gpu->parent->ce_hal->memcopy(&push, dst_address, src_address, PAGE_SIZE);
+            block_copy_run_add(&push, &copy_run, dst_address, src_address, PAGE_SIZE);
         }
 
         last_index = page_index;
@@ -2471,10 +2743,13 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
             src_address.address += contig_start_index * PAGE_SIZE;
             dst_address.address += contig_start_index * PAGE_SIZE;
 
-            uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-            copying_gpu->parent->ce_hal->memcopy(&push, dst_address, src_address, contig_region_size);
+            block_copy_run_add(&push, &copy_run, dst_address, src_address, contig_region_size);
         }
 
+        block_copy_run_flush(&push, &copy_run);
+
+        copied_bytes += contig_region_size;
+
         uvm_perf_event_notify_migration(&va_space->perf_events,
                                         &push,
                                         block,
@@ -2490,6 +2765,7 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
         //       by that GPU, use a GPU-local membar if no peer can currently
         //       map this page. When peer access gets enabled, do a MEMBAR_SYS
         //       at that point.
+        uvm_tools_record_block_migration_end(block, &push, dst_id, src_id, copied_bytes, cause);
         uvm_push_end(&push);
         tracker_status = uvm_tracker_add_push_safe(copy_tracker, &push);
         if (status == NV_OK)
@@ -2882,7 +3158,7 @@ out:
     return status == NV_OK ? tracker_status : status;
 }
 
-NV_STATUS uvm_va_block_make_resident(uvm_va_block_t *va_block,
+static NV_STATUS block_make_resident(uvm_va_block_t *va_block,
                                      uvm_va_block_retry_t *va_block_retry,
                                      uvm_va_block_context_t *va_block_context,
                                      uvm_processor_id_t dest_id,
@@ -2974,6 +3250,37 @@ NV_STATUS uvm_va_block_make_resident(uvm_va_block_t *va_block,
     return NV_OK;
 }
 
+NV_STATUS uvm_va_block_make_resident(uvm_va_block_t *va_block,
+                                     uvm_va_block_retry_t *va_block_retry,
+                                     uvm_va_block_context_t *va_block_context,
+                                     uvm_processor_id_t dest_id,
+                                     uvm_va_block_region_t region,
+                                     const uvm_page_mask_t *page_mask,
+                                     const uvm_page_mask_t *prefetch_page_mask,
+                                     uvm_make_resident_cause_t cause)
+{
+    NV_STATUS status;
+    NvU64 start = uvm_va_block_region_start(va_block, region);
+
+    trace_uvm_block_make_resident_begin(start,
+                                        uvm_va_block_region_end(va_block, region),
+                                        uvm_id_value(dest_id),
+                                        cause);
+
+    status = block_make_resident(va_block,
+                                 va_block_retry,
+                                 va_block_context,
+                                 dest_id,
+                                 region,
+                                 page_mask,
+                                 prefetch_page_mask,
+                                 cause);
+
+    trace_uvm_block_make_resident_end(start, uvm_id_value(dest_id), status);
+
+    return status;
+}
+
 // Combination function which prepares the input {region, page_mask} for
 // entering read-duplication. It:
 // - Unmaps all processors but revoke_id
@@ -3883,7 +4190,7 @@ static void block_gpu_pte_write_4k(uvm_va_block_t *block,
 
         // Handle PAGE_SIZE > GPU PTE size
         for (i = 0; i < ptes_per_page; i++) {
-            NvU64 pte_val = tree->hal->make_pte(page_addr.aperture, page_addr.address, new_prot, pte_flags);
+            NvU64 pte_val = uvm_hal_make_pte(tree->hal, page_addr.aperture, page_addr.address, new_prot, pte_flags);
             uvm_pte_batch_write_pte(pte_batch, pte_addr, pte_val, pte_size);
             page_addr.address += UVM_PAGE_SIZE_4K;
             pte_addr.address += pte_size;
@@ -4090,7 +4397,7 @@ static void block_gpu_pte_write_big(uvm_va_block_t *block,
         page_addr.address = contig_addr.address + (big_region.first - contig_region.first) * PAGE_SIZE;
 
         pte_addr = uvm_page_table_range_entry_address(tree, &gpu_state->page_table_range_big, big_page_index);
-        pte_val = tree->hal->make_pte(page_addr.aperture, page_addr.address, new_prot, pte_flags);
+        pte_val = uvm_hal_make_pte(tree->hal, page_addr.aperture, page_addr.address, new_prot, pte_flags);
         uvm_pte_batch_write_pte(pte_batch, pte_addr, pte_val, pte_size);
 
         if (tlb_batch) {
@@ -4230,7 +4537,7 @@ static void block_gpu_pte_write_2m(uvm_va_block_t *block,
     UVM_ASSERT(UVM_ID_IS_GPU(resident_id));
 
     page_addr = block_phys_page_address(block, block_phys_page(resident_id, 0), gpu);
-    pte_val = tree->hal->make_pte(page_addr.aperture, page_addr.address, new_prot, pte_flags);
+    pte_val = uvm_hal_make_pte(tree->hal, page_addr.aperture, page_addr.address, new_prot, pte_flags);
     uvm_pte_batch_write_pte(pte_batch, pte_addr, pte_val, pte_size);
 
     if (tlb_batch)
@@ -4406,6 +4713,22 @@ static void block_gpu_pte_merge_2m(uvm_va_block_t *block,
     }
 }
 
+// End the TLB batch of the last step of a mapping operation, deferring it to
+// the page tree if requested by the caller. See
+// block_context->mapping.deferred_tlb_tree.
+static void block_gpu_tlb_batch_end_last(uvm_va_block_context_t *block_context,
+                                         uvm_tlb_batch_t *tlb_batch,
+                                         uvm_push_t *push,
+                                         uvm_membar_t tlb_membar)
+{
+    if (tlb_membar == UVM_MEMBAR_NONE &&
+        block_context->mapping.deferred_tlb_tree == tlb_batch->tree &&
+        uvm_tlb_batch_defer(tlb_batch))
+        return;
+
+    uvm_tlb_batch_end(tlb_batch, push, tlb_membar);
+}
+
 static uvm_membar_t block_pte_op_membar(block_pte_op_t pte_op, uvm_gpu_t *gpu, uvm_processor_id_t resident_id)
 {
     // Permissions upgrades (MAP) don't need membars
@@ -4466,7 +4789,7 @@ static void block_gpu_map_to_2m(uvm_va_block_t *block,
     uvm_pte_batch_end(pte_batch);
 
     tlb_membar = block_pte_op_membar(pte_op, gpu, resident_id);
-    uvm_tlb_batch_end(tlb_batch, push, tlb_membar);
+    block_gpu_tlb_batch_end_last(block_context, tlb_batch, push, tlb_membar);
 }
 
 // Combination split + map operation, called when only part of a 2M PTE mapping
@@ -4897,9 +5220,15 @@ static void block_gpu_map_big_and_4k(uvm_va_block_t *block,
     }
     else {
         // End the batches. We have to commit the membars and TLB invalidates
-        // before we finish splitting formerly-big PTEs.
+        // before we finish splitting formerly-big PTEs. If there is nothing
+        // left to split or activate, this is the last step.
         uvm_pte_batch_end(pte_batch);
-        uvm_tlb_batch_end(tlb_batch, push, tlb_membar);
+
+        if (bitmap_empty(big_ptes_split, MAX_BIG_PAGES_PER_UVM_VA_BLOCK) &&
+            !block_gpu_needs_to_activate_table(block, gpu))
+            block_gpu_tlb_batch_end_last(block_context, tlb_batch, push, tlb_membar);
+        else
+            uvm_tlb_batch_end(tlb_batch, push, tlb_membar);
     }
 
     if (!bitmap_empty(big_ptes_split, MAX_BIG_PAGES_PER_UVM_VA_BLOCK) ||
@@ -4925,7 +5254,7 @@ static void block_gpu_map_big_and_4k(uvm_va_block_t *block,
         if (block_gpu_needs_to_activate_table(block, gpu))
             block_gpu_write_pde(block, gpu, push, tlb_batch);
 
-        uvm_tlb_batch_end(tlb_batch, push, UVM_MEMBAR_NONE);
+        block_gpu_tlb_batch_end_last(block_context, tlb_batch, push, UVM_MEMBAR_NONE);
     }
 
     // Update gpu_state
@@ -5387,7 +5716,7 @@ static NV_STATUS block_alloc_pt_range_with_retry(uvm_va_block_t *va_block,
     // to allocate the lower levels.
     bool use_alloc_table = block_gpu_supports_2m(va_block, gpu) && page_size < UVM_PAGE_SIZE_2M;
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
     UVM_ASSERT(page_table_range->table == NULL);
 
     if (va_block_test && va_block_test->page_table_allocation_retry_force_count > 0) {
@@ -5459,8 +5788,9 @@ static NV_STATUS block_alloc_pt_range_with_retry(uvm_va_block_t *va_block,
 
     if (page_table_range->table) {
         // A different caller allocated the page tables in the meantime, release the
-        // local copy.
-        uvm_page_tree_put_ptes(page_tables, &local_range);
+        // local copy. Nothing was mapped with it, so there's nothing to wait
+        // for.
+        uvm_page_tree_put_ptes_async(page_tables, &local_range);
         return status;
     }
 
@@ -5761,15 +6091,20 @@ NV_STATUS uvm_va_block_unmap(uvm_va_block_t *va_block,
 // each call to vm_insert_page. Multiple faults under one VMA in separate
 // blocks can be serviced concurrently, so the VMA wrapper lock is used
 // to protect access to vma->vm_page_prot.
-static NV_STATUS uvm_cpu_insert_page(struct vm_area_struct *vma,
-                                     NvU64 addr,
-                                     struct page *page,
-                                     uvm_prot_t new_prot)
+// Inserts CPU PTEs for num_pages consecutive virtual pages starting at addr,
+// backed by pages. On return, *num_mapped is the number of leading pages which
+// were mapped, which is num_pages on success.
+static NV_STATUS uvm_cpu_insert_pages(struct vm_area_struct *vma,
+                                      NvU64 addr,
+                                      struct page **pages,
+                                      size_t num_pages,
+                                      uvm_prot_t new_prot,
+                                      size_t *num_mapped)
 {
     uvm_vma_wrapper_t *vma_wrapper;
     unsigned long target_flags;
     pgprot_t target_pgprot;
-    int ret;
+    int ret = 0;
 
     UVM_ASSERT(vma);
     UVM_ASSERT(vma->vm_private_data);
@@ -5797,25 +6132,43 @@ static NV_STATUS uvm_cpu_insert_page(struct vm_area_struct *vma,
         uvm_downgrade_write(&vma_wrapper->lock);
     }
 
-    ret = vm_insert_page(vma, addr, page);
+#if defined(NV_VM_INSERT_PAGES_PRESENT)
+    {
+        // vm_insert_pages() takes the page table lock once per PMD instead of
+        // once per page. On return num_left is the number of pages not mapped.
+        unsigned long num_left = num_pages;
+
+        ret = vm_insert_pages(vma, addr, pages, &num_left);
+        *num_mapped = num_pages - num_left;
+    }
+#else
+    for (*num_mapped = 0; *num_mapped < num_pages; (*num_mapped)++) {
+        ret = vm_insert_page(vma, addr + *num_mapped * PAGE_SIZE, pages[*num_mapped]);
+        if (ret)
+            break;
+    }
+#endif
+
     uvm_up_read(&vma_wrapper->lock);
     if (ret) {
         UVM_ASSERT_MSG(ret == -ENOMEM, "ret: %d\n", ret);
         return errno_to_nv_status(ret);
     }
 
+    UVM_ASSERT(*num_mapped == num_pages);
+
     return NV_OK;
 }
 
-// Creates or upgrades a CPU mapping for the given page, updating the block's
-// mapping and pte_bits bitmaps as appropriate. Upon successful return, the page
-// will be mapped with at least new_prot permissions.
+// Prepares the creation or upgrade of a CPU mapping for the given page and
+// returns the page to be mapped in *out_page. The PTE itself is installed
+// later by block_map_cpu_pages_insert, so neighboring pages can be inserted
+// together. *out_page is NULL if the page is already mapped with at least
+// new_prot permissions.
 //
 // This never downgrades mappings, so new_prot must not be UVM_PROT_NONE. Use
 // block_unmap_cpu or uvm_va_block_revoke_prot instead.
 //
-// If the existing mapping is >= new_prot already, this is a no-op.
-//
 // It is the caller's responsibility to:
 //  - Revoke mappings from other processors as appropriate so the CPU can map
 //    with new_prot permissions
@@ -5826,18 +6179,17 @@ static NV_STATUS uvm_cpu_insert_page(struct vm_area_struct *vma,
 //  - Manage the block's residency bitmap
 //  - Ensure that the block hasn't been killed (block->va_range is present)
 //  - Update the pte/mapping tracking state on success
-static NV_STATUS block_map_cpu_page_to(uvm_va_block_t *block,
-                                       uvm_processor_id_t resident_id,
-                                       uvm_page_index_t page_index,
-                                       uvm_prot_t new_prot)
+static NV_STATUS block_map_cpu_page_prepare(uvm_va_block_t *block,
+                                            uvm_processor_id_t resident_id,
+                                            uvm_page_index_t page_index,
+                                            uvm_prot_t new_prot,
+                                            struct page **out_page)
 {
     uvm_prot_t curr_prot = block_page_prot_cpu(block, page_index);
     uvm_va_range_t *va_range = block->va_range;
     uvm_va_space_t *va_space = uvm_va_block_get_va_space(block);
     struct vm_area_struct *vma;
-    NV_STATUS status;
     NvU64 addr;
-    struct page *page;
 
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
     UVM_ASSERT(new_prot != UVM_PROT_NONE);
@@ -5848,6 +6200,8 @@ static NV_STATUS block_map_cpu_page_to(uvm_va_block_t *block,
     if (UVM_ID_IS_CPU(resident_id))
         UVM_ASSERT(block->cpu.pages[page_index]);
 
+    *out_page = NULL;
+
     // For the CPU, write implies atomic
     if (new_prot == UVM_PROT_READ_WRITE)
         new_prot = UVM_PROT_READ_WRITE_ATOMIC;
@@ -5886,7 +6240,6 @@ static NV_STATUS block_map_cpu_page_to(uvm_va_block_t *block,
     uvm_assert_mmap_lock_locked(vma->vm_mm);
     UVM_ASSERT(!uvm_va_space_mm_enabled(va_space) || va_space->va_space_mm.mm == vma->vm_mm);
 
-    // Add the mapping
     addr = uvm_va_block_cpu_page_address(block, page_index);
 
     // This unmap handles upgrades as vm_insert_page returns -EBUSY when
@@ -5895,14 +6248,8 @@ static NV_STATUS block_map_cpu_page_to(uvm_va_block_t *block,
     if (curr_prot != UVM_PROT_NONE)
         unmap_mapping_range(&va_space->mapping, addr, PAGE_SIZE, 1);
 
-    // Don't map the CPU until prior copies and GPU PTE updates finish,
-    // otherwise we might not stay coherent.
-    status = uvm_tracker_wait(&block->tracker);
-    if (status != NV_OK)
-        return status;
-
     if (UVM_ID_IS_CPU(resident_id)) {
-        page = block->cpu.pages[page_index];
+        *out_page = block->cpu.pages[page_index];
     }
     else {
         uvm_gpu_t *gpu = uvm_va_space_get_gpu(va_space, resident_id);
@@ -5911,10 +6258,47 @@ static NV_STATUS block_map_cpu_page_to(uvm_va_block_t *block,
 
         UVM_ASSERT(gpu->parent->numa_info.enabled);
 
-        page = uvm_gpu_chunk_to_page(&gpu->pmm, chunk) + chunk_offset / PAGE_SIZE;
+        *out_page = uvm_gpu_chunk_to_page(&gpu->pmm, chunk) + chunk_offset / PAGE_SIZE;
     }
 
-    return uvm_cpu_insert_page(vma, addr, page, new_prot);
+    return NV_OK;
+}
+
+// Maps the num_pages consecutive pages starting at first, whose struct pages
+// have been gathered in block_context->mapping.cpu_pages by
+// block_map_cpu_page_prepare. On return, *num_mapped is the number of leading
+// pages which were mapped.
+static NV_STATUS block_map_cpu_pages_insert(uvm_va_block_t *block,
+                                            uvm_va_block_context_t *block_context,
+                                            uvm_page_index_t first,
+                                            size_t num_pages,
+                                            uvm_prot_t new_prot,
+                                            size_t *num_mapped)
+{
+    NV_STATUS status;
+
+    *num_mapped = 0;
+
+    if (num_pages == 0)
+        return NV_OK;
+
+    // Don't map the CPU until prior copies and GPU PTE updates finish,
+    // otherwise we might not stay coherent.
+    status = uvm_tracker_wait(&block->tracker);
+    if (status != NV_OK)
+        return status;
+
+    status = uvm_cpu_insert_pages(uvm_va_range_vma(block->va_range),
+                                  uvm_va_block_cpu_page_address(block, first),
+                                  block_context->mapping.cpu_pages,
+                                  num_pages,
+                                  new_prot,
+                                  num_mapped);
+
+    if (*num_mapped > 0)
+        uvm_processor_mask_set(&block->mapped, UVM_ID_CPU);
+
+    return status;
 }
 
 // Maps the CPU to the given pages which are resident on resident_id.
@@ -5934,16 +6318,18 @@ static NV_STATUS block_map_cpu_to(uvm_va_block_t *block,
 {
     NV_STATUS status = NV_OK;
     uvm_va_space_t *va_space = uvm_va_block_get_va_space(block);
-    uvm_page_index_t page_index;
+    uvm_page_index_t page_index = region.first;
     uvm_page_mask_t *pages_to_map = &block_context->mapping.page_mask;
     const uvm_page_mask_t *resident_mask = uvm_va_block_resident_mask_get(block, resident_id);
     uvm_pte_bits_cpu_t prot_pte_bit = get_cpu_pte_bit_index(new_prot);
     uvm_pte_bits_cpu_t pte_bit;
+    uvm_va_block_region_t subregion;
 
     UVM_ASSERT(uvm_processor_mask_test(&va_space->accessible_from[uvm_id_value(resident_id)], UVM_ID_CPU));
 
     // TODO: Bug 1766424: Check if optimizing the unmap_mapping_range calls
-    //       within block_map_cpu_page_to by doing them once here is helpful.
+    //       within block_map_cpu_page_prepare by doing them once here is
+    //       helpful.
 
     UVM_ASSERT(!uvm_page_mask_and(&block_context->scratch_page_mask,
                                   map_page_mask,
@@ -5960,15 +6346,52 @@ static NV_STATUS block_map_cpu_to(uvm_va_block_t *block,
 
     block->cpu.ever_mapped = true;
 
-    for_each_va_block_page_in_region_mask(page_index, pages_to_map, region) {
-        status = block_map_cpu_page_to(block,
-                                       resident_id,
-                                       page_index,
-                                       new_prot);
+    // Pages are prepared one at a time, but the PTEs of each run of
+    // consecutive pages are inserted together.
+    for_each_va_block_subregion_in_mask(subregion, pages_to_map, region) {
+        uvm_page_index_t batch_first = subregion.first;
+        size_t num_pages = 0;
+        size_t num_mapped;
+        NV_STATUS insert_status;
+
+        for_each_va_block_page_in_region(page_index, subregion) {
+            struct page *page;
+
+            status = block_map_cpu_page_prepare(block, resident_id, page_index, new_prot, &page);
+            if (status == NV_OK && page) {
+                block_context->mapping.cpu_pages[num_pages++] = page;
+                continue;
+            }
+
+            // The run ends here, either because of an error or because the
+            // page is already mapped. The pages gathered so far were already
+            // prepared, so insert them in both cases.
+            insert_status = block_map_cpu_pages_insert(block,
+                                                       block_context,
+                                                       batch_first,
+                                                       num_pages,
+                                                       new_prot,
+                                                       &num_mapped);
+            if (insert_status != NV_OK) {
+                status = insert_status;
+                page_index = batch_first + num_mapped;
+            }
+
+            if (status != NV_OK)
+                break;
+
+            batch_first = page_index + 1;
+            num_pages = 0;
+        }
+
         if (status != NV_OK)
             break;
 
-        uvm_processor_mask_set(&block->mapped, UVM_ID_CPU);
+        status = block_map_cpu_pages_insert(block, block_context, batch_first, num_pages, new_prot, &num_mapped);
+        if (status != NV_OK) {
+            page_index = batch_first + num_mapped;
+            break;
+        }
     }
 
     // If there was some error, shrink the region so that we only update the
@@ -5985,7 +6408,6 @@ static NV_STATUS block_map_cpu_to(uvm_va_block_t *block,
     if (UVM_ID_IS_GPU(resident_id) &&
         va_space->tools.enabled &&
         block_context->mapping.cause != UvmEventMapRemoteCauseInvalid) {
-        uvm_va_block_region_t subregion;
         for_each_va_block_subregion_in_mask(subregion, pages_to_map, region) {
             uvm_tools_record_map_remote(block,
                                         NULL,
@@ -6154,7 +6576,7 @@ static void map_get_allowed_destinations(uvm_va_block_t *block,
         uvm_processor_mask_zero(allowed_mask);
         uvm_processor_mask_set(allowed_mask, va_range->preferred_location);
     }
-    else if ((uvm_va_range_is_read_duplicate(va_range) || uvm_id_equal(va_range->preferred_location, id)) &&
+    else if ((block_is_read_duplicate(block) || uvm_id_equal(va_range->preferred_location, id)) &&
              uvm_va_space_processor_has_memory(va_space, id)) {
         // When operating under read-duplication we should only map the local
         // processor to cause fault-and-duplicate of remote pages.
@@ -6200,7 +6622,7 @@ NV_STATUS uvm_va_block_map(uvm_va_block_t *va_block,
 
     // Mapping is not supported on the eviction path that doesn't hold the VA
     // space lock.
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (UVM_ID_IS_CPU(id)) {
         uvm_pte_bits_cpu_t prot_pte_bit;
@@ -6263,6 +6685,9 @@ NV_STATUS uvm_va_block_map(uvm_va_block_t *va_block,
         if (status != NV_OK)
             return status;
 
+        if (uvm_processor_mask_test(&va_block->resident, resident_id))
+            block_mark_memory_referenced(va_block, resident_id);
+
         // If we've mapped all requested pages, we're done
         if (uvm_page_mask_region_empty(running_page_mask, region))
             break;
@@ -6735,10 +7160,14 @@ static void block_destroy_gpu_state(uvm_va_block_t *block, uvm_gpu_id_t id)
     block->gpus[uvm_id_gpu_index(id)] = NULL;
 }
 
+// The PTEs must have been cleared and the clear waited on already. The PDE
+// clears and TLB invalidates done by the put are tracked by the tree and
+// acquired by its next operations, so they are not waited on here. This keeps
+// tearing down large VA spaces from waiting once per block.
 static void block_put_ptes_safe(uvm_page_tree_t *tree, uvm_page_table_range_t *range)
 {
     if (range->table) {
-        uvm_page_tree_put_ptes(tree, range);
+        uvm_page_tree_put_ptes_async(tree, range);
         memset(range, 0, sizeof(*range));
     }
 }
@@ -6852,7 +7281,7 @@ NV_STATUS uvm_va_block_enable_peer(uvm_va_block_t *va_block, uvm_gpu_t *gpu0, uv
     uvm_va_space_t *va_space = uvm_va_block_get_va_space(va_block);
 
     UVM_ASSERT(uvm_gpu_peer_caps(gpu0, gpu1)->link_type != UVM_GPU_LINK_INVALID);
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
     uvm_assert_mutex_locked(&va_block->lock);
 
     if (uvm_processor_mask_test(&va_space->indirect_peers[uvm_id_value(gpu0->id)], gpu1->id)) {
@@ -7054,7 +7483,10 @@ void uvm_va_block_unregister_gpu(uvm_va_block_t *va_block, uvm_gpu_t *gpu, struc
 // the initial kill itself, then again when the block's ref count is eventually
 // destroyed. block->va_range is used to track whether the block has already
 // been killed.
-static void block_kill(uvm_va_block_t *block)
+//
+// block_context is used for unmapping the block. If NULL, the VA space's block
+// context is used, which requires the VA space lock in write mode.
+static void block_kill(uvm_va_block_t *block, uvm_va_block_context_t *block_context)
 {
     uvm_va_space_t *va_space;
     uvm_perf_event_data_t event_data;
@@ -7073,11 +7505,12 @@ static void block_kill(uvm_va_block_t *block)
     // cause a page table split, so this should only fail if we have a system-
     // fatal error.
     if (!uvm_processor_mask_empty(&block->mapped)) {
-        uvm_va_block_context_t *block_context = uvm_va_space_block_context(va_space, NULL);
-
         // We could only be killed with mapped GPU state by VA range free or VA
         // space teardown, so it's safe to use the va_space's block_context
         // because both of those have the VA space lock held in write mode.
+        if (!block_context)
+            block_context = uvm_va_space_block_context(va_space, NULL);
+
         status = uvm_va_block_unmap_mask(block, block_context, &block->mapped, region, NULL);
         UVM_ASSERT(status == uvm_global_get_status());
     }
@@ -7126,6 +7559,20 @@ static void block_kill(uvm_va_block_t *block)
 #endif
 }
 
+static void block_free_rcu(struct rcu_head *rcu_head)
+{
+    uvm_va_block_t *block = container_of(rcu_head, uvm_va_block_t, rcu_head);
+
+    if (uvm_enable_builtin_tests) {
+        uvm_va_block_wrapper_t *block_wrapper = container_of(block, uvm_va_block_wrapper_t, block);
+
+        kmem_cache_free(g_uvm_va_block_cache, block_wrapper);
+    }
+    else {
+        kmem_cache_free(g_uvm_va_block_cache, block);
+    }
+}
+
 // Called when the block's ref count drops to 0
 void uvm_va_block_destroy(nv_kref_t *nv_kref)
 {
@@ -7135,29 +7582,36 @@ void uvm_va_block_destroy(nv_kref_t *nv_kref)
     uvm_assert_mutex_unlocked(&block->lock);
 
     uvm_mutex_lock(&block->lock);
-    block_kill(block);
+    block_kill(block, NULL);
     uvm_mutex_unlock(&block->lock);
 
-    if (uvm_enable_builtin_tests) {
-        uvm_va_block_wrapper_t *block_wrapper = container_of(block, uvm_va_block_wrapper_t, block);
-
-        kmem_cache_free(g_uvm_va_block_cache, block_wrapper);
-    }
-    else {
-        kmem_cache_free(g_uvm_va_block_cache, block);
-    }
+    call_rcu(&block->rcu_head, block_free_rcu);
 }
 
 void uvm_va_block_kill(uvm_va_block_t *va_block)
 {
+    // Blocks are only killed explicitly by VA range destruction, which holds
+    // the VA space lock in write mode.
+    if (va_block->va_range)
+        uvm_va_space_fault_block_cache_remove(va_block->va_range->va_space, va_block);
+
     uvm_mutex_lock(&va_block->lock);
-    block_kill(va_block);
+    block_kill(va_block, NULL);
     uvm_mutex_unlock(&va_block->lock);
 
     // May call block_kill again
     uvm_va_block_release(va_block);
 }
 
+void uvm_va_block_teardown(uvm_va_block_t *va_block, uvm_va_block_context_t *block_context)
+{
+    UVM_ASSERT(block_context);
+
+    uvm_mutex_lock(&va_block->lock);
+    block_kill(va_block, block_context);
+    uvm_mutex_unlock(&va_block->lock);
+}
+
 static NV_STATUS block_split_presplit_ptes_gpu(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_gpu_t *gpu)
 {
     uvm_va_block_gpu_state_t *existing_gpu_state = block_gpu_state_get(existing, gpu->id);
@@ -7414,6 +7868,7 @@ static NV_STATUS block_split_preallocate_no_retry(uvm_va_block_t *existing, uvm_
     uvm_gpu_id_t id;
     uvm_page_index_t split_page_index;
     uvm_va_range_t *existing_va_range = existing->va_range;
+    uvm_va_block_gpu_state_t *new_gpu_state;
 
     // Blocks don't have any CPU state to pre-allocate
 
@@ -7427,10 +7882,19 @@ static NV_STATUS block_split_preallocate_no_retry(uvm_va_block_t *existing, uvm_
         if (status != NV_OK)
             goto error;
 
-        if (!block_gpu_state_get_alloc(new, gpu)) {
+        new_gpu_state = block_gpu_state_get_alloc(new, gpu);
+        if (!new_gpu_state) {
             status = NV_ERR_NO_MEMORY;
             goto error;
         }
+
+        // The DMA addresses of the CPU pages above the split point are moved to
+        // new without failure later on
+        if (block_gpu_state_get(existing, id)->cpu_pages_dma_addrs) {
+            status = block_gpu_alloc_cpu_pages_dma_addrs(new, new_gpu_state);
+            if (status != NV_OK)
+                goto error;
+        }
     }
 
     if (existing_va_range->inject_split_error) {
@@ -7731,30 +8195,34 @@ static void block_split_gpu(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_g
     UVM_ASSERT(PAGE_ALIGNED(existing->start));
     existing_pages = (new->start - existing->start) / PAGE_SIZE;
 
-    // Move DMA addresses from the top of existing down into new
-    memcpy(&new_gpu_state->cpu_pages_dma_addrs[0],
-           &existing_gpu_state->cpu_pages_dma_addrs[existing_pages],
-           uvm_va_block_num_cpu_pages(new) * sizeof(new_gpu_state->cpu_pages_dma_addrs[0]));
+    if (existing_gpu_state->cpu_pages_dma_addrs) {
+        // Move DMA addresses from the top of existing down into new. The array
+        // of new was pre-allocated by block_split_preallocate_no_retry.
+        UVM_ASSERT(new_gpu_state->cpu_pages_dma_addrs);
+        memcpy(&new_gpu_state->cpu_pages_dma_addrs[0],
+               &existing_gpu_state->cpu_pages_dma_addrs[existing_pages],
+               uvm_va_block_num_cpu_pages(new) * sizeof(new_gpu_state->cpu_pages_dma_addrs[0]));
+
+        // Reparent pages in the new VA block
+        for_each_va_block_page(page_index, new) {
+            if (!new_gpu_state->cpu_pages_dma_addrs[page_index])
+                continue;
 
-    // Reparent pages in the new VA block
-    for_each_va_block_page(page_index, new) {
-        if (!new_gpu_state->cpu_pages_dma_addrs[page_index])
-            continue;
+            // TODO: Bug 1995015: coalesce calls for physically-contiguous sysmem
+            // allocations
+            uvm_pmm_sysmem_mappings_reparent_gpu_mapping(&gpu->pmm_sysmem_mappings,
+                                                         new_gpu_state->cpu_pages_dma_addrs[page_index],
+                                                         new);
+        }
 
-        // TODO: Bug 1995015: coalesce calls for physically-contiguous sysmem
-        // allocations
-        uvm_pmm_sysmem_mappings_reparent_gpu_mapping(&gpu->pmm_sysmem_mappings,
-                                                     new_gpu_state->cpu_pages_dma_addrs[page_index],
-                                                     new);
+        // Attempt to shrink existing's allocation. If the realloc fails, just
+        // keep on using the old larger one.
+        shrunk_dma_addrs = uvm_kvrealloc(existing_gpu_state->cpu_pages_dma_addrs,
+                                         existing_pages * sizeof(existing_gpu_state->cpu_pages_dma_addrs[0]));
+        if (shrunk_dma_addrs)
+            existing_gpu_state->cpu_pages_dma_addrs = shrunk_dma_addrs;
     }
 
-    // Attempt to shrink existing's allocation. If the realloc fails, just keep
-    // on using the old larger one.
-    shrunk_dma_addrs = uvm_kvrealloc(existing_gpu_state->cpu_pages_dma_addrs,
-                                     existing_pages * sizeof(existing_gpu_state->cpu_pages_dma_addrs[0]));
-    if (shrunk_dma_addrs)
-        existing_gpu_state->cpu_pages_dma_addrs = shrunk_dma_addrs;
-
     block_copy_split_gpu_chunks(existing, new, gpu);
 
     num_chunks = block_num_gpu_chunks(new, gpu);
@@ -7881,7 +8349,7 @@ NV_STATUS uvm_va_block_split(uvm_va_block_t *existing_va_block,
     // External range types can't be split
     UVM_ASSERT(existing_va_block->va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
     UVM_ASSERT(new_va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     UVM_ASSERT(new_end > existing_va_block->start);
     UVM_ASSERT(new_end < existing_va_block->end);
@@ -8463,7 +8931,7 @@ static bool can_read_duplicate(uvm_va_block_t *va_block,
                                uvm_page_index_t page_index,
                                const uvm_perf_thrashing_hint_t *thrashing_hint)
 {
-    if (uvm_va_range_is_read_duplicate(va_block->va_range))
+    if (block_is_read_duplicate(va_block))
         return true;
 
     if (va_block->va_range->read_duplication != UVM_READ_DUPLICATION_DISABLED &&
@@ -8690,9 +9158,11 @@ NV_STATUS uvm_va_block_service_locked(uvm_processor_id_t processor_id,
     // we could deadlock because the thread in RM which holds the VA space lock
     // for read wouldn't be able to complete until fault servicing completes.
     if (service_context->operation != UVM_SERVICE_OPERATION_REPLAYABLE_FAULTS || UVM_ID_IS_CPU(processor_id))
-        uvm_assert_rwsem_locked(&va_space->lock);
+        uvm_assert_percpu_rwsem_locked(&va_space->lock);
     else
-        uvm_assert_rwsem_locked_read(&va_space->lock);
+        uvm_assert_percpu_rwsem_locked_read(&va_space->lock);
+
+    service_context->prefetch_ahead.end = 0;
 
     // Performance heuristics policy: we only consider prefetching when there
     // are migrations to a single processor, only.
@@ -8713,7 +9183,13 @@ NV_STATUS uvm_va_block_service_locked(uvm_processor_id_t processor_id,
 
         prefetch_hint = uvm_perf_prefetch_get_hint(va_block, new_residency_mask);
 
-        // Obtain the prefetch hint and give a fake fault access type to the
+        if (prefetch_hint.ahead_end != 0) {
+            service_context->prefetch_ahead.start = prefetch_hint.ahead_start;
+            service_context->prefetch_ahead.end = prefetch_hint.ahead_end;
+            service_context->prefetch_ahead.residency = new_residency;
+        }
+
+        // Obtain the prefetch hint and give a fake fault access type to the
         // prefetched pages
         if (UVM_ID_IS_VALID(prefetch_hint.residency)) {
             UVM_ASSERT(prefetch_hint.prefetch_pages_mask != NULL);
@@ -8723,7 +9199,7 @@ NV_STATUS uvm_va_block_service_locked(uvm_processor_id_t processor_id,
 
                 service_context->access_type[page_index] = UVM_FAULT_ACCESS_TYPE_PREFETCH;
 
-                if (uvm_va_range_is_read_duplicate(va_range) ||
+                if (block_is_read_duplicate(va_block) ||
                     (va_range->read_duplication != UVM_READ_DUPLICATION_DISABLED &&
                      uvm_page_mask_test(&va_block->read_duplicated_pages, page_index))) {
                     if (service_context->read_duplicate_count++ == 0)
@@ -9153,7 +9629,7 @@ static NV_STATUS block_cpu_fault_locked(uvm_va_block_t *va_block,
     uvm_processor_id_t new_residency;
     bool read_duplicate;
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
 
     UVM_ASSERT(fault_addr >= va_block->start);
@@ -9173,6 +9649,7 @@ static NV_STATUS block_cpu_fault_locked(uvm_va_block_t *va_block,
     // (ptrace) path or if another driver is calling get_user_pages.
     service_context->block_context.mm = uvm_va_range_vma(va_range)->vm_mm;
     uvm_assert_mmap_lock_locked(service_context->block_context.mm);
+    service_context->block_context.mapping.deferred_tlb_tree = NULL;
 
     if (service_context->num_retries == 0) {
         // notify event to tools/performance heuristics
@@ -9290,6 +9767,104 @@ NV_STATUS uvm_va_block_cpu_fault(uvm_va_block_t *va_block,
     return status;
 }
 
+static NV_STATUS block_cpu_readahead_locked(uvm_va_block_t *va_block,
+                                            uvm_va_block_retry_t *va_block_retry,
+                                            uvm_va_block_context_t *va_block_context)
+{
+    uvm_va_block_region_t region = uvm_va_block_region_from_block(va_block);
+    uvm_va_space_t *va_space = uvm_va_block_get_va_space(va_block);
+
+    // Nothing to migrate if no GPU has resident pages
+    if (uvm_processor_mask_get_gpu_count(&va_block->resident) == 0)
+        return NV_OK;
+
+    // Do not read ahead into blocks which are thrashing, the thrashing
+    // mitigation heuristics take care of them
+    if (uvm_perf_thrashing_get_thrashing_pages(va_block))
+        return NV_OK;
+
+    if (!uvm_range_group_all_migratable(va_space, va_block->start, va_block->end))
+        return NV_OK;
+
+    // Only start the copies. The CPU mappings are created by the faults on the
+    // pages, which will wait for the block's tracker.
+    return uvm_va_block_migrate_locked(va_block,
+                                       va_block_retry,
+                                       va_block_context,
+                                       region,
+                                       UVM_ID_CPU,
+                                       UVM_MIGRATE_MODE_MAKE_RESIDENT,
+                                       NULL);
+}
+
+void uvm_va_block_cpu_fault_readahead(uvm_va_block_t *va_block, uvm_service_block_context_t *service_context)
+{
+    uvm_va_range_t *va_range = va_block->va_range;
+    uvm_va_space_t *va_space;
+    unsigned num_blocks = min(uvm_cpu_fault_readahead_blocks, (unsigned)UVM_CPU_FAULT_READAHEAD_BLOCKS_MAX);
+    NvU64 window_end;
+    NvU64 start = 0;
+    NvU64 end = 0;
+    size_t index;
+    bool sequential;
+
+    if (num_blocks == 0 || !va_range)
+        return;
+
+    va_space = va_range->va_space;
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
+
+    // Faults on ranges preferring a GPU usually don't migrate to the CPU, don't
+    // pull their data ahead of the faults.
+    if (UVM_ID_IS_VALID(va_range->preferred_location) && !UVM_ID_IS_CPU(va_range->preferred_location))
+        return;
+
+    window_end = min(va_block->end + (NvU64)num_blocks * UVM_VA_BLOCK_SIZE, va_range->node.end);
+
+    uvm_spin_lock(&va_space->cpu_fault_readahead.lock);
+
+    sequential = va_space->cpu_fault_readahead.last_block_end + 1 == va_block->start;
+    va_space->cpu_fault_readahead.last_block_end = va_block->end;
+
+    if (sequential) {
+        // Skip the blocks already read ahead of this stream
+        if (va_space->cpu_fault_readahead.end >= va_block->end && va_space->cpu_fault_readahead.end <= window_end)
+            start = va_space->cpu_fault_readahead.end + 1;
+        else
+            start = va_block->end + 1;
+
+        end = window_end;
+        if (start <= end)
+            va_space->cpu_fault_readahead.end = end;
+    }
+
+    uvm_spin_unlock(&va_space->cpu_fault_readahead.lock);
+
+    if (!sequential || start > end)
+        return;
+
+    service_context->block_context.mm = uvm_va_range_vma(va_range)->vm_mm;
+    service_context->block_context.mapping.deferred_tlb_tree = NULL;
+
+    for (index = uvm_va_range_block_index(va_range, start); index <= uvm_va_range_block_index(va_range, end); ++index) {
+        uvm_va_block_retry_t va_block_retry;
+        uvm_va_block_t *readahead_block;
+        NV_STATUS status;
+
+        status = uvm_va_range_block_create(va_range, index, &readahead_block);
+        if (status != NV_OK)
+            break;
+
+        status = UVM_VA_BLOCK_LOCK_RETRY(readahead_block,
+                                         &va_block_retry,
+                                         block_cpu_readahead_locked(readahead_block,
+                                                                    &va_block_retry,
+                                                                    &service_context->block_context));
+        if (status != NV_OK)
+            break;
+    }
+}
+
 NV_STATUS uvm_va_block_find(uvm_va_space_t *va_space, NvU64 addr, uvm_va_block_t **out_block)
 {
     uvm_va_range_t *va_range;
@@ -9331,150 +9906,210 @@ NV_STATUS uvm_va_block_find_create(uvm_va_space_t *va_space,
     return uvm_va_range_block_create(va_range, index, out_block);
 }
 
-NV_STATUS uvm_va_block_write_from_cpu(uvm_va_block_t *va_block, NvU64 dst, uvm_mem_t *src_mem, size_t size)
+static NV_STATUS block_cpu_access_push_end(uvm_va_block_t *va_block, uvm_push_t *push, uvm_tracker_t *out_tracker)
 {
     NV_STATUS status;
-    uvm_page_index_t page_index = uvm_va_block_cpu_page_index(va_block, dst);
-    NvU64 page_offset = dst & (PAGE_SIZE - 1);
-    uvm_processor_id_t proc = uvm_va_block_page_get_closest_resident(va_block, page_index, UVM_ID_CPU);
-    uvm_va_block_region_t region = uvm_va_block_region_for_page(page_index);
-    uvm_va_block_context_t *block_context;
-    void *src = uvm_mem_get_cpu_addr_kernel(src_mem);
 
-    uvm_gpu_t *gpu;
-    uvm_gpu_address_t src_gpu_address;
-    uvm_gpu_address_t dst_gpu_address;
+    uvm_push_end(push);
+
+    if (!out_tracker)
+        return uvm_push_wait(push);
+
+    status = uvm_tracker_add_push_safe(&va_block->tracker, push);
+    if (status == NV_OK)
+        status = uvm_tracker_add_push_safe(out_tracker, push);
+
+    return status;
+}
+
+// Copy the [start, start + size) range of the block from or to mem, which holds
+// the range at offset (start & (PAGE_SIZE - 1)) so that every page of the block
+// lands in its own page of mem. CPU-resident pages are copied directly. Pages
+// resident on a GPU are copied by that GPU's CE, using one push for all the
+// consecutive pages resident on the same GPU.
+static NV_STATUS block_cpu_access(uvm_va_block_t *va_block,
+                                  uvm_mem_t *mem,
+                                  NvU64 start,
+                                  size_t size,
+                                  bool is_write,
+                                  uvm_tracker_t *out_tracker)
+{
+    NV_STATUS status = NV_OK;
+    uvm_va_block_region_t region = uvm_va_block_region_from_start_size(va_block, start, size);
+    NvU64 mem_base = UVM_ALIGN_DOWN(start, PAGE_SIZE);
+    char *cpu_base = (char *)uvm_mem_get_cpu_addr_kernel(mem);
+    bool tracker_waited = false;
+    uvm_gpu_t *push_gpu = NULL;
+    uvm_page_index_t page_index;
     uvm_push_t push;
 
-    uvm_assert_mutex_locked(&va_block->lock);
-    UVM_ASSERT_MSG(UVM_ALIGN_DOWN(dst, PAGE_SIZE) == UVM_ALIGN_DOWN(dst + size - 1, PAGE_SIZE),
-            "dst 0x%llx size 0x%zx\n", dst, size);
+    for_each_va_block_page_in_region(page_index, region) {
+        NvU64 page_addr = uvm_va_block_cpu_page_address(va_block, page_index);
+        NvU64 copy_start = max(start, page_addr);
+        NvU64 copy_end = min(start + size, page_addr + PAGE_SIZE);
+        NvU64 page_offset = copy_start - page_addr;
+        NvU64 mem_offset = copy_start - mem_base;
+        size_t copy_size = copy_end - copy_start;
+        uvm_processor_id_t proc = uvm_va_block_page_get_closest_resident(va_block, page_index, UVM_ID_CPU);
+        uvm_gpu_address_t block_gpu_address;
+        uvm_gpu_address_t mem_gpu_address;
+        uvm_gpu_t *gpu;
 
-    if (UVM_ID_IS_INVALID(proc))
-        proc = UVM_ID_CPU;
+        if (UVM_ID_IS_INVALID(proc)) {
+            // Writes make all pages resident first
+            UVM_ASSERT(!is_write);
 
-    // While we might populate pages on this path, we never create processor
-    // mappings (CPU or GPU). Thus we don't need to use any mm_struct.
-    block_context = uvm_va_block_context_alloc(NULL);
-    if (!block_context)
-        return NV_ERR_NO_MEMORY;
+            memset(cpu_base + mem_offset, 0, copy_size);
+            continue;
+        }
 
-    // Use make_resident() in all cases to break read-duplication, but
-    // block_retry can be NULL as if the page is not resident yet we will make
-    // it resident on the CPU.
-    // Notably we don't care about coherence with respect to atomics from other
-    // processors.
-    status = uvm_va_block_make_resident(va_block,
-                                        NULL,
-                                        block_context,
-                                        proc,
-                                        region,
-                                        NULL,
-                                        NULL,
-                                        UVM_MAKE_RESIDENT_CAUSE_API_TOOLS);
+        if (UVM_ID_IS_CPU(proc)) {
+            char *mapped_page;
+            struct page *page = va_block->cpu.pages[page_index];
 
-    uvm_va_block_context_free(block_context);
+            if (!tracker_waited) {
+                status = uvm_tracker_wait(&va_block->tracker);
+                if (status != NV_OK)
+                    break;
 
-    if (status != NV_OK)
-        return status;
+                tracker_waited = true;
+            }
 
-    if (UVM_ID_IS_CPU(proc)) {
-        char *mapped_page;
-        struct page *page = va_block->cpu.pages[page_index];
+            mapped_page = (char *)kmap(page);
+            if (is_write)
+                memcpy(mapped_page + page_offset, cpu_base + mem_offset, copy_size);
+            else
+                memcpy(cpu_base + mem_offset, mapped_page + page_offset, copy_size);
+            kunmap(page);
 
-        status = uvm_tracker_wait(&va_block->tracker);
-        if (status != NV_OK)
-            return status;
+            continue;
+        }
 
-        mapped_page = (char *)kmap(page);
-        memcpy(mapped_page + page_offset, src, size);
-        kunmap(page);
+        gpu = block_get_gpu(va_block, proc);
+        if (gpu != push_gpu) {
+            if (push_gpu) {
+                push_gpu = NULL;
+                status = block_cpu_access_push_end(va_block, &push, out_tracker);
+                if (status != NV_OK)
+                    break;
+            }
 
-        return NV_OK;
-    }
+            status = uvm_mem_map_gpu_phys(mem, gpu);
+            if (status != NV_OK)
+                break;
 
-    gpu = block_get_gpu(va_block, proc);
-    status = uvm_mem_map_gpu_phys(src_mem, gpu);
-    if (status != NV_OK)
-        return status;
+            status = uvm_push_begin_acquire(gpu->channel_manager,
+                                            is_write ? UVM_CHANNEL_TYPE_CPU_TO_GPU : UVM_CHANNEL_TYPE_GPU_TO_CPU,
+                                            &va_block->tracker,
+                                            &push,
+                                            "Direct %s [0x%llx, 0x%llx)",
+                                            is_write ? "write to" : "read from",
+                                            start,
+                                            (NvU64)(start + size));
+            if (status != NV_OK)
+                break;
 
-    dst_gpu_address = block_phys_page_copy_address(va_block, block_phys_page(proc, page_index), gpu);
-    dst_gpu_address.address += page_offset;
-    src_gpu_address = uvm_mem_gpu_address_physical(src_mem, gpu, 0, PAGE_SIZE);
+            push_gpu = gpu;
+        }
 
-    status = uvm_push_begin_acquire(gpu->channel_manager,
-                                    UVM_CHANNEL_TYPE_CPU_TO_GPU,
-                                    &va_block->tracker,
-                                    &push,
-                                    "Direct write to [0x%llx, 0x%llx)",
-                                    dst,
-                                    (NvU64)(dst + size));
-    if (status != NV_OK)
-        return status;
+        block_gpu_address = block_phys_page_copy_address(va_block, block_phys_page(proc, page_index), gpu);
+        block_gpu_address.address += page_offset;
+        mem_gpu_address = uvm_mem_gpu_address_physical(mem, gpu, mem_offset, copy_size);
+
+        // The copies never overlap and uvm_push_end() provides the membar for
+        // all of them
+        uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
+        uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+
+        if (is_write)
+            gpu->parent->ce_hal->memcopy(&push, block_gpu_address, mem_gpu_address, copy_size);
+        else
+            gpu->parent->ce_hal->memcopy(&push, mem_gpu_address, block_gpu_address, copy_size);
+    }
 
-    gpu->parent->ce_hal->memcopy(&push, dst_gpu_address, src_gpu_address, size);
-    return uvm_push_end_and_wait(&push);
+    if (push_gpu) {
+        NV_STATUS push_status = block_cpu_access_push_end(va_block, &push, out_tracker);
+        if (status == NV_OK)
+            status = push_status;
+    }
+
+    return status;
 }
 
-NV_STATUS uvm_va_block_read_to_cpu(uvm_va_block_t *va_block, uvm_mem_t *dst_mem, NvU64 src, size_t size)
+NV_STATUS uvm_va_block_write_from_cpu(uvm_va_block_t *va_block,
+                                      NvU64 dst,
+                                      uvm_mem_t *src_mem,
+                                      size_t size,
+                                      uvm_tracker_t *out_tracker)
 {
-    NV_STATUS status;
-    uvm_page_index_t page_index = uvm_va_block_cpu_page_index(va_block, src);
-    NvU64 page_offset = src & (PAGE_SIZE - 1);
-    uvm_processor_id_t proc = uvm_va_block_page_get_closest_resident(va_block, page_index, UVM_ID_CPU);
-    void *dst = uvm_mem_get_cpu_addr_kernel(dst_mem);
-
-    uvm_gpu_t *gpu;
-    uvm_gpu_address_t src_gpu_address;
-    uvm_gpu_address_t dst_gpu_address;
-    uvm_push_t push;
+    NV_STATUS status = NV_OK;
+    uvm_va_block_region_t region = uvm_va_block_region_from_start_size(va_block, dst, size);
+    uvm_va_block_context_t *block_context;
+    uvm_page_index_t page_index;
 
     uvm_assert_mutex_locked(&va_block->lock);
-    UVM_ASSERT_MSG(UVM_ALIGN_DOWN(src, PAGE_SIZE) == UVM_ALIGN_DOWN(src + size - 1, PAGE_SIZE),
-            "src 0x%llx size 0x%zx\n", src, size);
-
-    if (UVM_ID_IS_INVALID(proc)) {
-        memset(dst, 0, size);
-        return NV_OK;
-    }
+    UVM_ASSERT(dst >= va_block->start);
+    UVM_ASSERT(dst + size - 1 <= va_block->end);
 
-    if (UVM_ID_IS_CPU(proc)) {
-        char *mapped_page;
-        struct page *page = va_block->cpu.pages[page_index];
+    // While we might populate pages on this path, we never create processor
+    // mappings (CPU or GPU). Thus we don't need to use any mm_struct.
+    block_context = uvm_va_block_context_alloc(NULL);
+    if (!block_context)
+        return NV_ERR_NO_MEMORY;
 
-        status = uvm_tracker_wait(&va_block->tracker);
+    // Use make_resident() in all cases to break read-duplication, but
+    // block_retry can be NULL as if the page is not resident yet we will make
+    // it resident on the CPU.
+    // Notably we don't care about coherence with respect to atomics from other
+    // processors.
+    //
+    // Pages are kept on their closest resident processor, one call per run of
+    // pages sharing it.
+    page_index = region.first;
+    while (page_index < region.outer) {
+        uvm_processor_id_t proc = uvm_va_block_page_get_closest_resident(va_block, page_index, UVM_ID_CPU);
+        uvm_va_block_region_t run = uvm_va_block_region(page_index, page_index + 1);
+
+        while (run.outer < region.outer &&
+               uvm_id_equal(uvm_va_block_page_get_closest_resident(va_block, run.outer, UVM_ID_CPU), proc))
+            ++run.outer;
+
+        if (UVM_ID_IS_INVALID(proc))
+            proc = UVM_ID_CPU;
+
+        status = uvm_va_block_make_resident(va_block,
+                                            NULL,
+                                            block_context,
+                                            proc,
+                                            run,
+                                            NULL,
+                                            NULL,
+                                            UVM_MAKE_RESIDENT_CAUSE_API_TOOLS);
         if (status != NV_OK)
-            return status;
-
-        mapped_page = (char *)kmap(page);
-        memcpy(dst, mapped_page + page_offset, size);
-        kunmap(page);
+            break;
 
-        return NV_OK;
+        page_index = run.outer;
     }
 
-    gpu = block_get_gpu(va_block, proc);
-    status = uvm_mem_map_gpu_phys(dst_mem, gpu);
-    if (status != NV_OK)
-        return status;
-
-    src_gpu_address = block_phys_page_copy_address(va_block, block_phys_page(proc, page_index), gpu);
-    src_gpu_address.address += page_offset;
-    dst_gpu_address = uvm_mem_gpu_address_physical(dst_mem, gpu, 0, PAGE_SIZE);
+    uvm_va_block_context_free(block_context);
 
-    status = uvm_push_begin_acquire(gpu->channel_manager,
-                                    UVM_CHANNEL_TYPE_GPU_TO_CPU,
-                                    &va_block->tracker,
-                                    &push,
-                                    "Direct read from [0x%llx, 0x%llx)",
-                                    src,
-                                    (NvU64)(src + size));
     if (status != NV_OK)
         return status;
 
-    gpu->parent->ce_hal->memcopy(&push, dst_gpu_address, src_gpu_address, size);
+    return block_cpu_access(va_block, src_mem, dst, size, true, out_tracker);
+}
+
+NV_STATUS uvm_va_block_read_to_cpu(uvm_va_block_t *va_block,
+                                   uvm_mem_t *dst_mem,
+                                   NvU64 src,
+                                   size_t size,
+                                   uvm_tracker_t *out_tracker)
+{
+    uvm_assert_mutex_locked(&va_block->lock);
+    UVM_ASSERT(src >= va_block->start);
+    UVM_ASSERT(src + size - 1 <= va_block->end);
 
-    return uvm_push_end_and_wait(&push);
+    return block_cpu_access(va_block, dst_mem, src, size, false, out_tracker);
 }
 
 // Deferred work item reestablishing accessed by mappings after eviction. On
@@ -9582,6 +10217,55 @@ static void block_deferred_eviction_mappings_entry(void *args)
     UVM_ENTRY_VOID(block_deferred_eviction_mappings(args));
 }
 
+// Drops the copies on the given GPU of the pages in page_mask that are
+// read-duplicated, and removes them from page_mask. Read-duplicated pages are
+// read-only everywhere and have a valid copy on some other processor, so
+// evicting them doesn't need to copy anything back.
+static NV_STATUS block_evict_drop_read_duplicates(uvm_va_block_t *va_block,
+                                                  uvm_va_block_context_t *block_context,
+                                                  uvm_gpu_t *gpu,
+                                                  uvm_page_mask_t *page_mask)
+{
+    NV_STATUS status;
+    uvm_va_range_t *va_range = va_block->va_range;
+    uvm_page_mask_t *resident_mask = uvm_va_block_resident_mask_get(va_block, gpu->id);
+    uvm_page_mask_t *drop_page_mask = &block_context->make_resident.page_mask;
+    uvm_processor_mask_t unmap_processor_mask;
+    uvm_page_index_t page_index;
+
+    // UVM-Lite GPUs keep their mappings, which could point to this GPU's copy
+    if (!uvm_processor_mask_empty(&va_range->uvm_lite_gpus))
+        return NV_OK;
+
+    if (!uvm_page_mask_and(drop_page_mask, page_mask, &va_block->read_duplicated_pages))
+        return NV_OK;
+
+    // Processors without a copy of their own may be mapping the copy being
+    // dropped, so unmap everybody. The remaining copies get mapped again on the
+    // next access without any migration.
+    uvm_processor_mask_copy(&unmap_processor_mask, &va_block->mapped);
+    status = uvm_va_block_unmap_mask(va_block,
+                                     block_context,
+                                     &unmap_processor_mask,
+                                     uvm_va_block_region_from_block(va_block),
+                                     drop_page_mask);
+    if (status != NV_OK)
+        return status;
+
+    if (!uvm_page_mask_andnot(resident_mask, resident_mask, drop_page_mask))
+        block_clear_resident_processor(va_block, gpu->id);
+
+    // Pages left with a single copy are no longer read-duplicated
+    for_each_va_block_page_in_mask(page_index, drop_page_mask, va_block) {
+        if (uvm_va_block_page_resident_processors_count(va_block, page_index) <= 1)
+            uvm_page_mask_clear(&va_block->read_duplicated_pages, page_index);
+    }
+
+    uvm_page_mask_andnot(page_mask, page_mask, drop_page_mask);
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_va_block_evict_chunks(uvm_va_block_t *va_block,
                                     uvm_gpu_t *gpu,
                                     uvm_gpu_chunk_t *root_chunk,
@@ -9648,6 +10332,12 @@ NV_STATUS uvm_va_block_evict_chunks(uvm_va_block_t *va_block,
     // Only move pages resident on the GPU
     uvm_page_mask_and(pages_to_evict, pages_to_evict, uvm_va_block_resident_mask_get(va_block, gpu->id));
 
+    // Clean duplicates are dropped rather than copied back. The remaining
+    // pages are only resident on this GPU and need to be migrated.
+    status = block_evict_drop_read_duplicates(va_block, block_context, gpu, pages_to_evict);
+    if (status != NV_OK)
+        goto out;
+
     // TODO: Bug 1765193: make_resident() breaks read-duplication, but it's not
     // necessary to do so for eviction. Add a version that unmaps only the
     // processors that have mappings to the pages being evicted.
@@ -10172,6 +10862,176 @@ out:
     return status;
 }
 
+// Number of runs gathered by UVM_GET_RESIDENCY_INFO under the VA space lock,
+// before copying them out with the lock dropped.
+#define UVM_RESIDENCY_RUNS_PER_BATCH (PAGE_SIZE / sizeof(UvmResidencyRun))
+
+// Append the state of the pages of the block in region to the runs, extending
+// the last run when possible. Returns the index of the first page which didn't
+// fit, or region.outer.
+static uvm_page_index_t block_residency_runs_get(uvm_va_block_t *block,
+                                                 uvm_va_block_region_t region,
+                                                 UvmResidencyRun *runs,
+                                                 NvU32 max_runs,
+                                                 NvU32 *num_runs)
+{
+    uvm_page_index_t page_index;
+    uvm_processor_id_t id;
+
+    uvm_assert_mutex_locked(&block->lock);
+
+    for_each_va_block_page_in_region(page_index, region) {
+        NvU64 addr = uvm_va_block_cpu_page_address(block, page_index);
+        NvU64 resident_on = 0;
+        NvU64 mapped_on = 0;
+        NvU32 read_duplicated;
+        UvmResidencyRun *run;
+
+        for_each_id_in_mask(id, &block->resident) {
+            if (uvm_page_mask_test(uvm_va_block_resident_mask_get(block, id), page_index))
+                resident_on |= 1ULL << uvm_id_value(id);
+        }
+
+        for_each_id_in_mask(id, &block->mapped) {
+            if (uvm_page_mask_test(uvm_va_block_map_mask_get(block, id), page_index))
+                mapped_on |= 1ULL << uvm_id_value(id);
+        }
+
+        read_duplicated = uvm_page_mask_test(&block->read_duplicated_pages, page_index);
+
+        if (resident_on == 0 && mapped_on == 0)
+            continue;
+
+        if (*num_runs > 0) {
+            run = &runs[*num_runs - 1];
+            if (run->start + run->length == addr &&
+                run->residentOn == resident_on &&
+                run->mappedOn == mapped_on &&
+                run->readDuplicated == read_duplicated) {
+                run->length += PAGE_SIZE;
+                continue;
+            }
+        }
+
+        if (*num_runs == max_runs)
+            return page_index;
+
+        run = &runs[(*num_runs)++];
+        run->start = addr;
+        run->length = PAGE_SIZE;
+        run->residentOn = resident_on;
+        run->mappedOn = mapped_on;
+        run->readDuplicated = read_duplicated;
+        run->padding = 0;
+    }
+
+    return region.outer;
+}
+
+// Gather up to max_runs runs describing [start, end) and return the address
+// the walk stopped at, which is end if all of it was described.
+static NvU64 residency_runs_get(uvm_va_space_t *va_space,
+                                NvU64 start,
+                                NvU64 end,
+                                UvmResidencyRun *runs,
+                                NvU32 max_runs,
+                                NvU32 *num_runs)
+{
+    uvm_va_range_t *va_range;
+
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
+
+    *num_runs = 0;
+
+    uvm_for_each_va_range_in(va_range, va_space, start, end - 1) {
+        size_t index, last_index;
+
+        if (va_range->type != UVM_VA_RANGE_TYPE_MANAGED)
+            continue;
+
+        index = uvm_va_range_block_index(va_range, max(start, va_range->node.start));
+        last_index = uvm_va_range_block_index(va_range, min(end - 1, va_range->node.end));
+
+        for (; index <= last_index; index++) {
+            uvm_va_block_t *block = uvm_va_range_block(va_range, index);
+            uvm_va_block_region_t region;
+            uvm_page_index_t page_index;
+
+            if (!block)
+                continue;
+
+            region = uvm_va_block_region_from_start_end(block,
+                                                        max(start, block->start),
+                                                        min(end - 1, block->end));
+
+            uvm_mutex_lock(&block->lock);
+            page_index = block_residency_runs_get(block, region, runs, max_runs, num_runs);
+            uvm_mutex_unlock(&block->lock);
+
+            if (page_index != region.outer)
+                return uvm_va_block_cpu_page_address(block, page_index);
+
+            cond_resched();
+        }
+    }
+
+    return end;
+}
+
+NV_STATUS uvm_api_get_residency_info(UVM_GET_RESIDENCY_INFO_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    UvmResidencyRun __user *user_runs = (UvmResidencyRun __user *)params->runs;
+    UvmResidencyRun *runs;
+    NvU64 addr = params->base;
+    NvU64 end = params->base + params->length;
+    NV_STATUS status = NV_OK;
+
+    BUILD_BUG_ON(UVM_ID_MAX_PROCESSORS > 64);
+
+    params->numRuns = 0;
+    params->nextAddress = params->base;
+
+    if (uvm_api_range_invalid(params->base, params->length))
+        return NV_ERR_INVALID_ADDRESS;
+
+    if (params->maxRuns == 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    runs = uvm_kvmalloc(UVM_RESIDENCY_RUNS_PER_BATCH * sizeof(*runs));
+    if (!runs)
+        return NV_ERR_NO_MEMORY;
+
+    // The runs are copied out with the VA space lock dropped, as the copy can
+    // fault on managed memory. Batches always end at the start of a run, so
+    // runs are never split between batches.
+    while (addr < end && params->numRuns < params->maxRuns) {
+        NvU32 max_runs = min((NvU32)UVM_RESIDENCY_RUNS_PER_BATCH, params->maxRuns - params->numRuns);
+        NvU32 num_runs;
+
+        uvm_va_space_down_read(va_space);
+        addr = residency_runs_get(va_space, addr, end, runs, max_runs, &num_runs);
+        uvm_va_space_up_read(va_space);
+
+        if (nv_copy_to_user(&user_runs[params->numRuns], runs, num_runs * sizeof(*runs))) {
+            status = NV_ERR_INVALID_ADDRESS;
+            break;
+        }
+
+        params->numRuns += num_runs;
+
+        if (fatal_signal_pending(current)) {
+            status = NV_ERR_SIGNAL_PENDING;
+            break;
+        }
+    }
+
+    params->nextAddress = addr;
+
+    uvm_kvfree(runs);
+    return status;
+}
+
 static void block_mark_region_cpu_dirty(uvm_va_block_t *va_block, uvm_va_block_region_t region)
 {
     uvm_page_index_t page_index;
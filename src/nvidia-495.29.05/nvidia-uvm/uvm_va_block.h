@@ -113,7 +113,8 @@ typedef struct
     // allocated and whenever a new GPU state is allocated.
     //
     // The size of this array is always the same as the uvm_va_block::cpu.pages
-    // array.
+    // array. It is allocated on the first CPU page that needs to be mapped, so
+    // it remains NULL for GPUs that only map memory resident on other GPUs.
     NvU64 *cpu_pages_dma_addrs;
 
     // Array of naturally-aligned chunks. Each chunk has the largest possible
@@ -417,6 +418,11 @@ struct uvm_va_block_struct
     // Mask to keep track of the pages that are read-duplicate
     uvm_page_mask_t read_duplicated_pages;
 
+    // Number of access counter notifications received for this block, from
+    // any processor, since it was last serviced because of them. Only used
+    // if the VA range has an access counter notification threshold.
+    NvU8 access_counter_notifications;
+
     // Mask to keep track of the pages that are not mapped on any non-UVM-Lite
     // processor.
     //     0: Page is definitely not mapped by any processors
@@ -442,6 +448,12 @@ struct uvm_va_block_struct
     // A queue item for establishing eviction mappings in a deferred way
     nv_kthread_q_item_t eviction_mappings_q_item;
 
+    // Used to defer freeing the block after its last reference is dropped.
+    // The sysmem reverse maps are looked up without locks, so a reader may
+    // still be inspecting the block within an RCU read-side critical section.
+    // See uvm_pmm_sysmem_mappings_dma_to_virt.
+    struct rcu_head rcu_head;
+
     uvm_perf_module_data_desc_t perf_modules_data[UVM_PERF_MODULE_TYPE_COUNT];
 
 #if UVM_IS_CONFIG_HMM()
@@ -538,6 +550,15 @@ static inline void uvm_va_block_retain(uvm_va_block_t *va_block)
     nv_kref_get(&va_block->kref);
 }
 
+// Like uvm_va_block_retain, but fails and returns false if the block's ref count
+// already dropped to zero. The caller must guarantee that the block memory
+// remains valid, for example by being within an RCU read-side critical section
+// started while the block was reachable.
+static inline bool uvm_va_block_retain_unless_dead(uvm_va_block_t *va_block)
+{
+    return nv_kref_get_unless_zero(&va_block->kref) != 0;
+}
+
 static inline void uvm_va_block_release(uvm_va_block_t *va_block)
 {
     if (va_block) {
@@ -608,6 +629,7 @@ static void uvm_va_block_context_init(uvm_va_block_context_t *va_block_context,
         uvm_assert_mmap_lock_locked(mm);
 
     va_block_context->mm = mm;
+    va_block_context->mapping.deferred_tlb_tree = NULL;
 }
 
 // TODO: Bug 1766480: Using only page masks instead of a combination of regions
@@ -1010,6 +1032,19 @@ void uvm_va_block_unregister_gpu(uvm_va_block_t *va_block, uvm_gpu_t *gpu, struc
 // This performs a uvm_va_block_release.
 void uvm_va_block_kill(uvm_va_block_t *va_block);
 
+// Tear down everything within the block like uvm_va_block_kill(), but without
+// dropping the VA range's reference. uvm_va_block_kill() still has to be called
+// afterwards, and then only drops the reference. The block has to be removed
+// from the fault block caches before calling this function.
+//
+// This is used by the VA space teardown workers, which run concurrently on
+// different blocks on behalf of the thread destroying the VA space. That
+// thread holds the VA space lock in write mode for the duration, and each
+// worker has its own block_context.
+//
+// The caller should not lock the block before calling this function.
+void uvm_va_block_teardown(uvm_va_block_t *va_block, uvm_va_block_context_t *block_context);
+
 // Exactly the same split semantics as uvm_va_range_split, including error
 // handling. See that function's comments for details.
 //
@@ -1142,6 +1177,19 @@ const uvm_page_mask_t *uvm_va_block_map_mask_get(uvm_va_block_t *block, uvm_proc
 //                          cover it yet
 //
 // NV_OK                    The block was returned successfully
+// Called after a CPU fault in va_block migrated data to the CPU. If the CPU
+// faults follow a sequential stream of VA blocks, start migrating the next
+// blocks in the VA range to the CPU without waiting for the copies, so that the
+// following faults find their data already resident. The number of blocks read
+// ahead is controlled by the uvm_cpu_fault_readahead_blocks module parameter,
+// and the heuristic is disabled if it is 0. Errors are ignored since this is
+// just an optimization.
+//
+// service_context must be the context used to service the fault.
+//
+// Locking: same as uvm_va_block_cpu_fault. The VA block lock must not be held.
+void uvm_va_block_cpu_fault_readahead(uvm_va_block_t *va_block, uvm_service_block_context_t *service_context);
+
 NV_STATUS uvm_va_block_find(uvm_va_space_t *va_space, NvU64 addr, uvm_va_block_t **out_block);
 
 // Same as uvm_va_block_find except that the block is created if not already
@@ -1185,19 +1233,39 @@ NV_STATUS uvm_va_block_migrate_locked(uvm_va_block_t *va_block,
 
 // Write block's data from a CPU buffer
 //
-// The [dst, dst + size) range has to fit within a single PAGE_SIZE page.
+// The [dst, dst + size) range has to fit within the block. src holds the data
+// starting at offset (dst & (PAGE_SIZE - 1)), and must be a sysmem allocation
+// mapped on the CPU.
+//
+// If out_tracker is NULL the function waits for the copies to complete.
+// Otherwise the copies done by GPUs are added to out_tracker, and src must not
+// be modified until they complete.
 //
 // The caller needs to support allocation-retry of page tables.
 //
 // LOCKING: The caller must hold the va_block lock
-NV_STATUS uvm_va_block_write_from_cpu(uvm_va_block_t *va_block, NvU64 dst, uvm_mem_t *src, size_t size);
+NV_STATUS uvm_va_block_write_from_cpu(uvm_va_block_t *va_block,
+                                      NvU64 dst,
+                                      uvm_mem_t *src,
+                                      size_t size,
+                                      uvm_tracker_t *out_tracker);
 
 // Read block's data into a CPU buffer
 //
-// The [src, src + size) range has to fit within a single PAGE_SIZE page.
+// The [src, src + size) range has to fit within the block. The data is stored
+// in dst starting at offset (src & (PAGE_SIZE - 1)), and dst must be a sysmem
+// allocation mapped on the CPU.
+//
+// If out_tracker is NULL the function waits for the copies to complete.
+// Otherwise the copies done by GPUs are added to out_tracker, and dst can only
+// be read once they complete.
 //
 // LOCKING: The caller must hold the va_block lock
-NV_STATUS uvm_va_block_read_to_cpu(uvm_va_block_t *va_block, uvm_mem_t *dst, NvU64 src, size_t size);
+NV_STATUS uvm_va_block_read_to_cpu(uvm_va_block_t *va_block,
+                                   uvm_mem_t *dst,
+                                   NvU64 src,
+                                   size_t size,
+                                   uvm_tracker_t *out_tracker);
 
 // Initialize va block retry tracking
 void uvm_va_block_retry_init(uvm_va_block_retry_t *uvm_va_block_retry);
@@ -1220,6 +1288,12 @@ NV_STATUS uvm_va_block_evict_chunks(uvm_va_block_t *va_block,
                                     uvm_gpu_chunk_t *root_chunk,
                                     uvm_tracker_t *tracker);
 
+// Refresh the eviction hints of the GPU memory the block is resident on, for
+// example after the residency pinned policy of its VA range changed.
+//
+// LOCKING: The caller must hold the va_block lock
+void uvm_va_block_mark_memory_used(uvm_va_block_t *va_block);
+
 NV_STATUS uvm_test_va_block_inject_error(UVM_TEST_VA_BLOCK_INJECT_ERROR_PARAMS *params, struct file *filp);
 NV_STATUS uvm_test_change_pte_mapping(UVM_TEST_CHANGE_PTE_MAPPING_PARAMS *params, struct file *filp);
 NV_STATUS uvm_test_va_block_info(UVM_TEST_VA_BLOCK_INFO_PARAMS *params, struct file *filp);
@@ -1330,6 +1404,19 @@ static uvm_va_block_region_t uvm_va_block_region_from_block(uvm_va_block_t *va_b
     return uvm_va_block_region(0, uvm_va_block_num_cpu_pages(va_block));
 }
 
+// When a page mask spans more than one word (4K pages), the kernel bitmap
+// helpers fall back to out-of-line loops over a runtime length. The mask size
+// is a compile-time constant here, so the whole-mask operations below are
+// open-coded as word loops which the compiler unrolls, and the predicates stop
+// at the first word that decides the result. Single-word masks (64K pages) are
+// already inlined by the bitmap helpers and keep using them.
+#if (PAGES_PER_UVM_VA_BLOCK > BITS_PER_LONG) && ((PAGES_PER_UVM_VA_BLOCK % BITS_PER_LONG) == 0)
+    #define UVM_PAGE_MASK_WORD_OPS 1
+    #define UVM_PAGE_MASK_WORDS (PAGES_PER_UVM_VA_BLOCK / BITS_PER_LONG)
+#else
+    #define UVM_PAGE_MASK_WORD_OPS 0
+#endif
+
 static bool uvm_page_mask_test(const uvm_page_mask_t *mask, uvm_page_index_t page_index)
 {
     UVM_ASSERT(page_index < PAGES_PER_UVM_VA_BLOCK);
@@ -1420,32 +1507,88 @@ static void uvm_page_mask_zero(uvm_page_mask_t *mask)
 
 static bool uvm_page_mask_empty(const uvm_page_mask_t *mask)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++) {
+        if (mask->bitmap[i])
+            return false;
+    }
+
+    return true;
+#else
     return bitmap_empty(mask->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 static bool uvm_page_mask_full(const uvm_page_mask_t *mask)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++) {
+        if (~mask->bitmap[i])
+            return false;
+    }
+
+    return true;
+#else
     return bitmap_full(mask->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 static bool uvm_page_mask_and(uvm_page_mask_t *mask_out, const uvm_page_mask_t *mask_in1, const uvm_page_mask_t *mask_in2)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    unsigned long result = 0;
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++)
+        result |= (mask_out->bitmap[i] = mask_in1->bitmap[i] & mask_in2->bitmap[i]);
+
+    return result != 0;
+#else
     return bitmap_and(mask_out->bitmap, mask_in1->bitmap, mask_in2->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 static bool uvm_page_mask_andnot(uvm_page_mask_t *mask_out, const uvm_page_mask_t *mask_in1, const uvm_page_mask_t *mask_in2)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    unsigned long result = 0;
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++)
+        result |= (mask_out->bitmap[i] = mask_in1->bitmap[i] & ~mask_in2->bitmap[i]);
+
+    return result != 0;
+#else
     return bitmap_andnot(mask_out->bitmap, mask_in1->bitmap, mask_in2->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 static void uvm_page_mask_or(uvm_page_mask_t *mask_out, const uvm_page_mask_t *mask_in1, const uvm_page_mask_t *mask_in2)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++)
+        mask_out->bitmap[i] = mask_in1->bitmap[i] | mask_in2->bitmap[i];
+#else
     bitmap_or(mask_out->bitmap, mask_in1->bitmap, mask_in2->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 static void uvm_page_mask_complement(uvm_page_mask_t *mask_out, const uvm_page_mask_t *mask_in)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++)
+        mask_out->bitmap[i] = ~mask_in->bitmap[i];
+#else
     bitmap_complement(mask_out->bitmap, mask_in->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 static void uvm_page_mask_copy(uvm_page_mask_t *mask_out, const uvm_page_mask_t *mask_in)
@@ -1455,12 +1598,33 @@ static void uvm_page_mask_copy(uvm_page_mask_t *mask_out, const uvm_page_mask_t
 
 static NvU32 uvm_page_mask_weight(const uvm_page_mask_t *mask)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    NvU32 weight = 0;
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++)
+        weight += hweight_long(mask->bitmap[i]);
+
+    return weight;
+#else
     return bitmap_weight(mask->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 static bool uvm_page_mask_subset(const uvm_page_mask_t *subset, const uvm_page_mask_t *mask)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++) {
+        if (subset->bitmap[i] & ~mask->bitmap[i])
+            return false;
+    }
+
+    return true;
+#else
     return bitmap_subset(subset->bitmap, mask->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 static bool uvm_page_mask_init_from_region(uvm_page_mask_t *mask_out,
@@ -1488,7 +1652,18 @@ static void uvm_page_mask_shift_left(uvm_page_mask_t *mask_out, const uvm_page_m
 
 static bool uvm_page_mask_intersects(const uvm_page_mask_t *mask1, const uvm_page_mask_t *mask2)
 {
+#if UVM_PAGE_MASK_WORD_OPS
+    size_t i;
+
+    for (i = 0; i < UVM_PAGE_MASK_WORDS; i++) {
+        if (mask1->bitmap[i] & mask2->bitmap[i])
+            return true;
+    }
+
+    return false;
+#else
     return bitmap_intersects(mask1->bitmap, mask2->bitmap, PAGES_PER_UVM_VA_BLOCK);
+#endif
 }
 
 // Print the given page mask on the given buffer using hex symbols. The
@@ -1798,6 +1973,10 @@ static NvU32 uvm_va_block_page_size_processor(uvm_va_block_t *va_block,
 // Returns the big page size for the GPU VA space of the block
 NvU32 uvm_va_block_gpu_big_page_size(uvm_va_block_t *va_block, uvm_gpu_t *gpu);
 
+// Returns true if the whole block is backed by a single 2M chunk on the GPU
+// and the GPU VA space of the block can map it with a 2M PTE
+bool uvm_va_block_gpu_supports_2m(uvm_va_block_t *va_block, uvm_gpu_t *gpu);
+
 // Returns the number of big pages in the VA block for the given size
 size_t uvm_va_block_num_big_pages(uvm_va_block_t *va_block, NvU32 big_page_size);
 
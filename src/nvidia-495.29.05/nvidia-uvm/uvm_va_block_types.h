@@ -227,11 +227,22 @@ typedef struct
         uvm_page_mask_t filtered_page_mask;
         uvm_page_mask_t migratable_mask;
 
+        // Pages of a run of consecutive CPU PTEs to be inserted together by
+        // block_map_cpu_to.
+        struct page *cpu_pages[PAGES_PER_UVM_VA_BLOCK];
+
         uvm_va_block_new_pte_state_t new_pte_state;
 
         uvm_pte_batch_t pte_batch;
         uvm_tlb_batch_t tlb_batch;
 
+        // If set, the TLB invalidates of permission upgrades on this page
+        // tree are deferred to it instead of being pushed. The caller is
+        // responsible for flushing them with uvm_tlb_batch_flush_deferred
+        // before the mappings are relied upon. Used by replayable fault
+        // servicing.
+        uvm_page_tree_t *deferred_tlb_tree;
+
         // Event that triggered the call to the mapping function
         UvmEventMapRemoteCause cause;
     } mapping;
@@ -73,38 +73,132 @@ static NvU64 block_calc_end(uvm_va_range_t *va_range, size_t index)
     return end;
 }
 
-// Called before the range's bounds have been adjusted. This may not actually
-// shrink the blocks array. For example, if the shrink attempt fails then
-// va_range's old array is left intact. This may waste memory, but it means this
-// function cannot fail.
+static size_t blocks_num_leaves(size_t num_blocks)
+{
+    return DIV_ROUND_UP(num_blocks, UVM_VA_RANGE_BLOCKS_PER_LEAF);
+}
+
+static atomic_long_t *blocks_leaf(uvm_va_range_t *va_range, size_t index)
+{
+    return (atomic_long_t *)atomic_long_read(&va_range->block_leaves[index / UVM_VA_RANGE_BLOCKS_PER_LEAF]);
+}
+
+// Returns the leaf holding the block pointer at index, allocating it if it
+// doesn't exist yet. Returns NULL if the allocation fails.
+static atomic_long_t *blocks_leaf_get_alloc(uvm_va_range_t *va_range, size_t index)
+{
+    atomic_long_t *leaf, *old;
+
+    leaf = blocks_leaf(va_range, index);
+    if (leaf)
+        return leaf;
+
+    leaf = uvm_kvmalloc_zero(UVM_VA_RANGE_BLOCKS_PER_LEAF * sizeof(*leaf));
+    if (!leaf)
+        return NULL;
+
+    // Like blocks in uvm_va_range_block_create(), racing threads may allocate
+    // the same leaf and all but one of them drop theirs
+    old = (atomic_long_t *)nv_atomic_long_cmpxchg(&va_range->block_leaves[index / UVM_VA_RANGE_BLOCKS_PER_LEAF],
+                                                   (long)NULL,
+                                                   (long)leaf);
+    if (old) {
+        uvm_kvfree(leaf);
+        leaf = old;
+    }
+
+    return leaf;
+}
+
+// Set the block pointer at index. The leaf holding it must have been allocated.
+// No memory barrier is needed since callers hold the va_space lock in write
+// mode, so no other thread can access the table.
+static void blocks_set(uvm_va_range_t *va_range, size_t index, uvm_va_block_t *block)
+{
+    atomic_long_t *leaf = blocks_leaf(va_range, index);
+
+    uvm_assert_percpu_rwsem_locked_write(&va_range->va_space->lock);
+    UVM_ASSERT(leaf);
+
+    atomic_long_set(&leaf[index % UVM_VA_RANGE_BLOCKS_PER_LEAF], (long)block);
+}
+
+// Returns the first populated block at or after index, or NULL if none, and
+// sets *out_index to its index. Absent leaves are skipped as a whole.
+static uvm_va_block_t *blocks_find_first(uvm_va_range_t *va_range, size_t index, size_t *out_index)
+{
+    size_t num_blocks = uvm_va_range_num_blocks(va_range);
+
+    while (index < num_blocks) {
+        atomic_long_t *leaf = blocks_leaf(va_range, index);
+        uvm_va_block_t *block;
+
+        if (!leaf) {
+            index = round_down(index, UVM_VA_RANGE_BLOCKS_PER_LEAF) + UVM_VA_RANGE_BLOCKS_PER_LEAF;
+            continue;
+        }
+
+        block = (uvm_va_block_t *)atomic_long_read(&leaf[index % UVM_VA_RANGE_BLOCKS_PER_LEAF]);
+        if (block) {
+            *out_index = index;
+            return block;
+        }
+
+        ++index;
+    }
+
+    return NULL;
+}
+
+static void blocks_free(uvm_va_range_t *va_range)
+{
+    size_t i;
+
+    for (i = 0; i < blocks_num_leaves(uvm_va_range_num_blocks(va_range)); i++)
+        uvm_kvfree((void *)atomic_long_read(&va_range->block_leaves[i]));
+
+    uvm_kvfree(va_range->block_leaves);
+    va_range->block_leaves = NULL;
+}
+
+// Called before the range's bounds have been adjusted, once all block pointers
+// past new_num_blocks have been cleared. Leaves past the new end are freed,
+// but the leaf array may not actually shrink. For example, if the shrink
+// attempt fails then va_range's old array is left intact. This may waste
+// memory, but it means this function cannot fail.
 static void blocks_array_shrink(uvm_va_range_t *va_range, size_t new_num_blocks)
 {
-    size_t new_size = new_num_blocks * sizeof(va_range->blocks[0]);
-    atomic_long_t *new_blocks;
+    size_t num_leaves = blocks_num_leaves(uvm_va_range_num_blocks(va_range));
+    size_t new_num_leaves = blocks_num_leaves(new_num_blocks);
+    atomic_long_t *new_leaves;
+    size_t i;
 
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
-    UVM_ASSERT(va_range->blocks);
-    UVM_ASSERT(uvm_kvsize(va_range->blocks) >= uvm_va_range_num_blocks(va_range) * sizeof(va_range->blocks[0]));
+    UVM_ASSERT(va_range->block_leaves);
+    UVM_ASSERT(uvm_kvsize(va_range->block_leaves) >= num_leaves * sizeof(va_range->block_leaves[0]));
     UVM_ASSERT(new_num_blocks);
     UVM_ASSERT(new_num_blocks <= uvm_va_range_num_blocks(va_range));
 
-    // TODO: Bug 1766579: This could be optimized by only shrinking the array
-    //       when the new size is half of the old size or some similar
-    //       threshold. Need to profile this on real apps to see if that's worth
-    //       doing.
+    for (i = new_num_leaves; i < num_leaves; i++) {
+        uvm_kvfree((void *)atomic_long_read(&va_range->block_leaves[i]));
+        atomic_long_set(&va_range->block_leaves[i], (long)NULL);
+    }
+
+    if (new_num_leaves == num_leaves)
+        return;
 
-    new_blocks = uvm_kvrealloc(va_range->blocks, new_size);
-    if (!new_blocks) {
+    new_leaves = uvm_kvrealloc(va_range->block_leaves, new_num_leaves * sizeof(va_range->block_leaves[0]));
+    if (!new_leaves) {
         // If we failed to allocate a smaller array, just leave the old one as-is
-        UVM_DBG_PRINT("Failed to shrink range [0x%llx, 0x%llx] from %zu blocks to %zu blocks\n",
+        UVM_DBG_PRINT("Failed to shrink range [0x%llx, 0x%llx] from %zu leaves to %zu leaves\n",
                       va_range->node.start,
                       va_range->node.end,
-                      uvm_kvsize(va_range->blocks) / sizeof(va_range->blocks[0]),
-                      new_num_blocks);
+                      num_leaves,
+                      new_num_leaves);
         return;
     }
 
-    va_range->blocks = new_blocks;
+    va_range->block_leaves = new_leaves;
 }
 
 static uvm_va_range_t *uvm_va_range_alloc(uvm_va_space_t *va_space, NvU64 start, NvU64 end)
@@ -113,7 +207,7 @@ static uvm_va_range_t *uvm_va_range_alloc(uvm_va_space_t *va_space, NvU64 start,
     if (!va_range)
         return NULL;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
     UVM_ASSERT(uvm_va_space_initialized(va_space) == NV_OK);
 
     va_range->va_space = va_space;
@@ -140,9 +234,10 @@ static uvm_va_range_t *uvm_va_range_alloc_managed(uvm_va_space_t *va_space, NvU6
     va_range->read_duplication = UVM_READ_DUPLICATION_UNSET;
     va_range->preferred_location = UVM_ID_INVALID;
 
-    va_range->blocks = uvm_kvmalloc_zero(uvm_va_range_num_blocks(va_range) * sizeof(va_range->blocks[0]));
-    if (!va_range->blocks) {
-        UVM_DBG_PRINT("Failed to allocate %zu blocks\n", uvm_va_range_num_blocks(va_range));
+    va_range->block_leaves = uvm_kvmalloc_zero(blocks_num_leaves(uvm_va_range_num_blocks(va_range)) *
+                                               sizeof(va_range->block_leaves[0]));
+    if (!va_range->block_leaves) {
+        UVM_DBG_PRINT("Failed to allocate the table for %zu blocks\n", uvm_va_range_num_blocks(va_range));
         goto error;
     }
 
@@ -388,12 +483,12 @@ static void uvm_va_range_destroy_managed(uvm_va_range_t *va_range)
 
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
 
-    if (va_range->blocks) {
+    if (va_range->block_leaves) {
         // Unmap and drop our ref count on each block
         for_each_va_block_in_va_range_safe(va_range, block, block_tmp)
             uvm_va_block_kill(block);
 
-        uvm_kvfree(va_range->blocks);
+        blocks_free(va_range);
     }
 
     event_data.range_destroy.range = va_range;
@@ -946,7 +1041,7 @@ void uvm_va_range_unregister_gpu(uvm_va_range_t *va_range,
     }
 }
 
-// Split existing's blocks into new. new's blocks array has already been
+// Split existing's blocks into new. new's leaf array has already been
 // allocated. This is called before existing's range node is split, so it
 // overlaps new. new is always in the upper region of existing.
 //
@@ -956,7 +1051,7 @@ void uvm_va_range_unregister_gpu(uvm_va_range_t *va_range,
 static NV_STATUS uvm_va_range_split_blocks(uvm_va_range_t *existing, uvm_va_range_t *new)
 {
     uvm_va_block_t *old_block, *block = NULL;
-    size_t existing_blocks, split_index, new_index = 0;
+    size_t existing_blocks, split_index, index, new_index = 0;
     NV_STATUS status;
 
     UVM_ASSERT(new->node.start >  existing->node.start);
@@ -964,6 +1059,18 @@ static NV_STATUS uvm_va_range_split_blocks(uvm_va_range_t *existing, uvm_va_rang
 
     split_index = uvm_va_range_block_index(existing, new->node.start);
 
+    // Block index split_index + i in existing becomes index i in new, including
+    // for a block spanning the split point. Allocate the leaves of new for all
+    // populated blocks up front, since nothing can fail once blocks start
+    // moving.
+    index = split_index;
+    while ((block = blocks_find_first(existing, index, &index))) {
+        if (!blocks_leaf_get_alloc(new, index - split_index))
+            return NV_ERR_NO_MEMORY;
+        ++index;
+    }
+    block = NULL;
+
     // Handle a block spanning the split point
     if (block_calc_start(existing, split_index) != new->node.start) {
         // If a populated block actually spans the split point, we have to split
@@ -975,9 +1082,7 @@ static NV_STATUS uvm_va_range_split_blocks(uvm_va_range_t *existing, uvm_va_rang
             if (status != NV_OK)
                 return status;
 
-            // No memory barrier is needed since we're holding the va_space lock in
-            // write mode, so no other thread can access the blocks array.
-            atomic_long_set(&new->blocks[0], (long)block);
+            blocks_set(new, 0, block);
         }
 
         new_index = 1;
@@ -1013,17 +1118,13 @@ static NV_STATUS uvm_va_range_split_blocks(uvm_va_range_t *existing, uvm_va_rang
     //  existing (before) [----- A ----][----- B ----][----- C ----]
     //  existing (after   [----- A ----][- B -]
     //  new                                    [- N -][----- C ----]
-    //                                            ^new->blocks[0]
+    //                                            ^new block 0
 
     // Note, if we split the last block of existing, this won't iterate at all.
-    for (; new_index < uvm_va_range_num_blocks(new); new_index++) {
-        block = uvm_va_range_block(existing, split_index + new_index);
-        if (!block) {
-            // new's array was cleared at allocation
-            UVM_ASSERT(uvm_va_range_block(new, new_index) == NULL);
-            continue;
-        }
-
+    // Only populated blocks are visited, new's table was cleared at
+    // allocation.
+    index = split_index + new_index;
+    while ((block = blocks_find_first(existing, index, &index))) {
         // As soon as we make this assignment and drop the lock, the reverse
         // mapping code can start looking at new, so new must be ready to go.
         uvm_mutex_lock(&block->lock);
@@ -1031,10 +1132,9 @@ static NV_STATUS uvm_va_range_split_blocks(uvm_va_range_t *existing, uvm_va_rang
         block->va_range = new;
         uvm_mutex_unlock(&block->lock);
 
-        // No memory barrier is needed since we're holding the va_space lock in
-        // write mode, so no other thread can access the blocks array.
-        atomic_long_set(&new->blocks[new_index], (long)block);
-        atomic_long_set(&existing->blocks[split_index + new_index], (long)NULL);
+        blocks_set(new, index - split_index, block);
+        blocks_set(existing, index, NULL);
+        ++index;
     }
 
     blocks_array_shrink(existing, existing_blocks);
@@ -1055,7 +1155,7 @@ NV_STATUS uvm_va_range_split(uvm_va_range_t *existing_va_range,
     UVM_ASSERT(new_end > existing_va_range->node.start);
     UVM_ASSERT(new_end < existing_va_range->node.end);
     UVM_ASSERT(PAGE_ALIGNED(new_end + 1));
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     new = uvm_va_range_alloc_managed(va_space, new_end + 1, existing_va_range->node.end);
     if (!new) {
@@ -1072,6 +1172,9 @@ NV_STATUS uvm_va_range_split(uvm_va_range_t *existing_va_range,
     new->read_duplication = existing_va_range->read_duplication;
     new->preferred_location = existing_va_range->preferred_location;
     memcpy(&new->accessed_by, &existing_va_range->accessed_by, sizeof(new->accessed_by));
+    new->access_counter_granularity = existing_va_range->access_counter_granularity;
+    new->access_counter_notification_threshold = existing_va_range->access_counter_notification_threshold;
+    new->residency_pinned = existing_va_range->residency_pinned;
     memcpy(&new->uvm_lite_gpus, &existing_va_range->uvm_lite_gpus, sizeof(new->uvm_lite_gpus));
 
     status = uvm_va_range_split_blocks(existing_va_range, new);
@@ -1096,6 +1199,111 @@ error:
 
 }
 
+static bool va_range_can_merge(uvm_va_range_t *lower, uvm_va_range_t *upper)
+{
+    if (lower->type != UVM_VA_RANGE_TYPE_MANAGED || upper->type != UVM_VA_RANGE_TYPE_MANAGED)
+        return false;
+
+    // Zombie ranges are only kept around to be destroyed
+    if (!lower->managed.vma_wrapper || lower->managed.vma_wrapper != upper->managed.vma_wrapper)
+        return false;
+
+    if (lower->node.end + 1 != upper->node.start)
+        return false;
+
+    // A block never spans two ranges, so if the boundary falls within a
+    // UVM_VA_BLOCK_SIZE region both ranges may have a block there.
+    if (!IS_ALIGNED(upper->node.start, UVM_VA_BLOCK_SIZE))
+        return false;
+
+    if (lower->inject_split_error || upper->inject_split_error)
+        return false;
+
+    return lower->read_duplication == upper->read_duplication &&
+           uvm_id_equal(lower->preferred_location, upper->preferred_location) &&
+           uvm_processor_mask_equal(&lower->accessed_by, &upper->accessed_by) &&
+           uvm_processor_mask_equal(&lower->uvm_lite_gpus, &upper->uvm_lite_gpus) &&
+           lower->access_counter_granularity == upper->access_counter_granularity &&
+           lower->access_counter_notification_threshold == upper->access_counter_notification_threshold &&
+           lower->residency_pinned == upper->residency_pinned;
+}
+
+// Merges upper into lower, which must be adjacent and satisfy
+// va_range_can_merge. On success upper is freed. This is the reverse of
+// uvm_va_range_split:
+//
+// Before: [---- lower ----][---- upper ----]
+// After:  [------------ lower -------------]
+//
+// If this fails both ranges are left unchanged.
+static NV_STATUS uvm_va_range_merge(uvm_va_range_t *lower, uvm_va_range_t *upper)
+{
+    uvm_va_space_t *va_space = lower->va_space;
+    size_t lower_blocks = uvm_va_range_num_blocks(lower);
+    size_t num_leaves = blocks_num_leaves(lower_blocks);
+    size_t new_num_leaves = blocks_num_leaves(lower_blocks + uvm_va_range_num_blocks(upper));
+    uvm_range_tree_node_t *node;
+    uvm_va_block_t *block;
+    size_t index, i;
+
+    UVM_ASSERT(va_range_can_merge(lower, upper));
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
+
+    // blocks_array_shrink may have left the leaf array larger than needed
+    if (uvm_kvsize(lower->block_leaves) < new_num_leaves * sizeof(lower->block_leaves[0])) {
+        atomic_long_t *new_leaves = uvm_kvrealloc(lower->block_leaves,
+                                                  new_num_leaves * sizeof(lower->block_leaves[0]));
+        if (!new_leaves)
+            return NV_ERR_NO_MEMORY;
+
+        lower->block_leaves = new_leaves;
+    }
+
+    for (i = num_leaves; i < new_num_leaves; i++)
+        atomic_long_set(&lower->block_leaves[i], (long)NULL);
+
+    // Block index i in upper becomes index lower_blocks + i in lower. Allocate
+    // the leaves for all populated blocks up front, since nothing can fail once
+    // blocks start moving.
+    index = 0;
+    while ((block = blocks_find_first(upper, index, &index))) {
+        if (!blocks_leaf_get_alloc(lower, lower_blocks + index)) {
+            // Drop the leaves past lower's current end. The array itself is
+            // left as-is, like in blocks_array_shrink.
+            for (i = num_leaves; i < new_num_leaves; i++) {
+                uvm_kvfree((void *)atomic_long_read(&lower->block_leaves[i]));
+                atomic_long_set(&lower->block_leaves[i], (long)NULL);
+            }
+
+            return NV_ERR_NO_MEMORY;
+        }
+        ++index;
+    }
+
+    // Update the VA range tree first so lower covers all of upper's blocks by
+    // the time they point to it.
+    node = uvm_range_tree_merge_next(&va_space->va_range_tree, &lower->node);
+    UVM_ASSERT(node == &upper->node);
+
+    index = 0;
+    while ((block = blocks_find_first(upper, index, &index))) {
+        uvm_mutex_lock(&block->lock);
+        UVM_ASSERT(block->va_range == upper);
+        block->va_range = lower;
+        uvm_mutex_unlock(&block->lock);
+
+        blocks_set(lower, lower_blocks + index, block);
+        ++index;
+    }
+
+    // upper no longer owns any blocks and its address range now belongs to
+    // lower, so none of the uvm_va_range_destroy_managed teardown applies.
+    blocks_free(upper);
+    kmem_cache_free(g_uvm_va_range_cache, upper);
+
+    return NV_OK;
+}
+
 static inline uvm_va_range_t *uvm_va_range_container(uvm_range_tree_node_t *node)
 {
     if (!node)
@@ -1105,7 +1313,7 @@ static inline uvm_va_range_t *uvm_va_range_container(uvm_range_tree_node_t *node
 
 uvm_va_range_t *uvm_va_range_find(uvm_va_space_t *va_space, NvU64 addr)
 {
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
     return uvm_va_range_container(uvm_range_tree_find(&va_space->va_range_tree, addr));
 }
 
@@ -1160,10 +1368,15 @@ size_t uvm_va_range_block_index(uvm_va_range_t *va_range, NvU64 addr)
 NV_STATUS uvm_va_range_block_create(uvm_va_range_t *va_range, size_t index, uvm_va_block_t **out_block)
 {
     uvm_va_block_t *block, *old;
+    atomic_long_t *leaf;
     NV_STATUS status;
 
     block = uvm_va_range_block(va_range, index);
     if (!block) {
+        leaf = blocks_leaf_get_alloc(va_range, index);
+        if (!leaf)
+            return NV_ERR_NO_MEMORY;
+
         // No block has been created here yet, so allocate one and attempt to
         // insert it. Note that this runs the risk of an out-of-memory error
         // when multiple threads race and all concurrently allocate a block for
@@ -1178,7 +1391,7 @@ NV_STATUS uvm_va_range_block_create(uvm_va_range_t *va_range, size_t index, uvm_
             return status;
 
         // Try to insert it
-        old = (uvm_va_block_t *)nv_atomic_long_cmpxchg(&va_range->blocks[index],
+        old = (uvm_va_block_t *)nv_atomic_long_cmpxchg(&leaf[index % UVM_VA_RANGE_BLOCKS_PER_LEAF],
                                                       (long)NULL,
                                                       (long)block);
         if (old) {
@@ -1197,23 +1410,20 @@ uvm_va_block_t *uvm_va_range_block_next(uvm_va_range_t *va_range, uvm_va_block_t
     uvm_va_space_t *va_space = va_range->va_space;
     size_t i = 0;
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
 
     if (va_block)
         i = uvm_va_range_block_index(va_range, va_block->start) + 1;
 
-    for (; i < uvm_va_range_num_blocks(va_range); i++) {
-        va_block = uvm_va_range_block(va_range, i);
-        if (va_block) {
-            UVM_ASSERT(va_block->va_range == va_range);
-            UVM_ASSERT(uvm_va_range_block_index(va_range, va_block->start) == i);
-            return va_block;
-        }
+    va_block = blocks_find_first(va_range, i, &i);
+    if (va_block) {
+        UVM_ASSERT(va_block->va_range == va_range);
+        UVM_ASSERT(uvm_va_range_block_index(va_range, va_block->start) == i);
     }
 
-    return NULL;
+    return va_block;
 }
 
 static NV_STATUS range_unmap_mask(uvm_va_range_t *va_range,
@@ -1299,7 +1509,7 @@ static void calc_uvm_lite_gpus_mask(uvm_va_space_t *va_space,
 {
     uvm_gpu_id_t gpu_id;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     // Zero out the mask first
     uvm_processor_mask_zero(uvm_lite_gpus);
@@ -1352,7 +1562,7 @@ NV_STATUS uvm_va_range_set_preferred_location(uvm_va_range_t *va_range,
     uvm_va_block_t *va_block;
     uvm_va_block_context_t *va_block_context;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
 
     if (uvm_id_equal(va_range->preferred_location, preferred_location))
@@ -1588,7 +1798,7 @@ NV_STATUS uvm_va_space_split_as_needed(uvm_va_space_t *va_space,
     UVM_ASSERT(va_space);
     UVM_ASSERT(PAGE_ALIGNED(addr));
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     va_range = uvm_va_range_find(va_space, addr);
     if (!va_range)
@@ -1623,6 +1833,29 @@ NV_STATUS uvm_va_space_split_span_as_needed(uvm_va_space_t *va_space,
     return uvm_va_space_split_as_needed(va_space, end_addr, split_needed_cb, data);
 }
 
+void uvm_va_space_merge_span_as_needed(uvm_va_space_t *va_space, NvU64 start_addr, NvU64 end_addr)
+{
+    uvm_va_range_t *va_range, *next;
+
+    UVM_ASSERT(start_addr <= end_addr);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
+
+    // Also consider the VA range ending right before start_addr
+    va_range = uvm_va_space_iter_first(va_space, start_addr ? start_addr - 1 : 0, end_addr);
+    while (va_range) {
+        next = uvm_va_space_iter_next(va_range, end_addr);
+        if (!next)
+            break;
+
+        // Merging is only an optimization, so failures are ignored. On success
+        // va_range grew, so check it again against its new neighbor.
+        if (va_range_can_merge(va_range, next) && uvm_va_range_merge(va_range, next) == NV_OK)
+            continue;
+
+        va_range = next;
+    }
+}
+
 uvm_vma_wrapper_t *uvm_vma_wrapper_alloc(struct vm_area_struct *vma)
 {
     uvm_vma_wrapper_t *vma_wrapper = nv_kmem_cache_zalloc(g_uvm_vma_wrapper_cache, NV_UVM_GFP_FLAGS);
@@ -351,6 +351,21 @@ struct uvm_va_range_struct
     // Mask of processors that are accessing this VA range
     uvm_processor_mask_t accessed_by;
 
+    // Access counter policy of this VA range, set with
+    // UVM_SET_ACCESS_COUNTER_POLICY. Both are 0 if no policy is set.
+    //
+    // Size in bytes of the aligned regions migrated on access counter
+    // notifications, or 0 to migrate the regions reported by the GPU.
+    NvU32 access_counter_granularity;
+
+    // Number of notifications a VA block has to receive before being
+    // serviced. 0 and 1 both service every notification.
+    NvU8 access_counter_notification_threshold;
+
+    // Whether the GPU memory of this VA range is exempted from eviction, set
+    // with UVM_SET_RESIDENCY_PINNED
+    bool residency_pinned;
+
     // Mask of UVM-Lite GPUs for the VA range
     //
     // If the preferred location is set to a non-faultable GPU or the CPU,
@@ -363,25 +378,26 @@ struct uvm_va_range_struct
     // location is changed or a GPU stops being a UVM-Lite GPU.
     uvm_processor_mask_t uvm_lite_gpus;
 
-    // This is a uvm_va_block_t ** array of all VA block pointers under this
-    // range. The pointers can be accessed using the functions
-    // uvm_va_range_block() and uvm_va_range_block_create(). The latter
-    // allocates the block if it doesn't already exist. Once allocated, the
-    // blocks persist in the array until the parent VA range is destroyed.
+    // Two-level table of all VA block pointers under this range. The pointers
+    // can be accessed using the functions uvm_va_range_block() and
+    // uvm_va_range_block_create(). The latter allocates the block if it
+    // doesn't already exist. Once allocated, the blocks persist in the table
+    // until the parent VA range is destroyed.
+    //
+    // block_leaves is an array of pointers to leaves, each holding
+    // UVM_VA_RANGE_BLOCKS_PER_LEAF block pointers. Only the leaf array is
+    // allocated with the range, so creating a huge range costs one pointer per
+    // UVM_VA_RANGE_BLOCKS_PER_LEAF * UVM_VA_BLOCK_SIZE bytes of VA (1GB with
+    // 4K pages). Leaves are allocated on demand along with their first block.
     //
     // Concurrent on-demand allocation requires the use of either atomics or a
     // spin lock. Given that we don't want to take a spin lock for every lookup,
-    // and that the blocks are persistent, atomics are preferred.
+    // and that the leaves and blocks are persistent, atomics are preferred at
+    // both levels.
     //
     // The number of blocks is calculated from the range size using
     // uvm_va_range_num_blocks().
-    //
-    // TODO: Bug 1766585: Compare perf of up-front allocation and demand-
-    //       allocation of blocks in the common case (lots of accessed blocks)
-    //       and the sparse case. If the common case is hurt by demand-
-    //       allocation, or if the sparse case isn't helped much, just allocate
-    //       them all at range allocation.
-    atomic_long_t *blocks;
+    atomic_long_t *block_leaves;
 
     uvm_va_range_type_t type;
     union
@@ -537,8 +553,6 @@ NV_STATUS uvm_va_range_split(uvm_va_range_t *existing_va_range,
                              NvU64 new_end,
                              uvm_va_range_t **new_va_range);
 
-// TODO: Bug 1707562: Merge va ranges
-
 // Returns the va_range containing addr, if any
 uvm_va_range_t *uvm_va_range_find(uvm_va_space_t *va_space, NvU64 addr);
 
@@ -645,6 +659,17 @@ NV_STATUS uvm_va_space_split_span_as_needed(uvm_va_space_t *va_space,
                                             uvm_va_range_is_split_needed_t split_needed_cb,
                                             void *data);
 
+// Merge adjacent managed VA ranges overlapping [start_addr, end_addr], and the
+// one ending right before start_addr, back together if they belong to the same
+// vma and have identical policies. This undoes the splits done by
+// uvm_va_space_split_span_as_needed once the policies of the split-off VA
+// ranges become equal again. Only VA ranges meeting on a UVM_VA_BLOCK_SIZE
+// boundary are merged.
+//
+// VA ranges may be freed by this call, so the caller must not use any
+// uvm_va_range_t pointers in the span afterwards.
+void uvm_va_space_merge_span_as_needed(uvm_va_space_t *va_space, NvU64 start_addr, NvU64 end_addr);
+
 // Only call this if you're sure that either:
 // 1) You have a reference on the vma's vm_mm and that vma->vm_mm's mmap_lock is
 //    held; or
@@ -660,7 +685,7 @@ static struct vm_area_struct *uvm_va_range_vma(uvm_va_range_t *va_range)
     UVM_ASSERT_MSG(va_range->type == UVM_VA_RANGE_TYPE_MANAGED, "type: %d", va_range->type);
     UVM_ASSERT(va_range->managed.vma_wrapper);
 
-    uvm_assert_rwsem_locked(&va_range->va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_range->va_space->lock);
 
     // vm_file, vm_private_data, vm_start, and vm_end are all safe to access
     // here because they can't change without the kernel calling vm_ops->open
@@ -747,35 +772,44 @@ static struct vm_area_struct *uvm_va_range_vma_current(uvm_va_range_t *va_range)
     return uvm_va_range_vma_check(va_range, current->mm);
 }
 
+// Number of VA block pointers in each leaf of va_range->block_leaves
+#define UVM_VA_RANGE_BLOCKS_PER_LEAF (PAGE_SIZE / sizeof(atomic_long_t))
+
 // Returns the maximum number of VA blocks which could be contained with the
-// given va_range (number of elements in the va_range->blocks array).
+// given va_range (number of entries in the va_range->block_leaves table).
 // va_range->node.start and .end must be set.
 //
 // The va_range must have type UVM_VA_RANGE_TYPE_MANAGED.
 size_t uvm_va_range_num_blocks(uvm_va_range_t *va_range);
 
-// Get the index within the va_range->blocks array of the VA block
+// Get the index within the va_range->block_leaves table of the VA block
 // corresponding to addr. The block pointer is not guaranteed to be valid. Use
 // either uvm_va_range_block or uvm_va_range_block_create to look up the block.
 //
 // The va_range must have type UVM_VA_RANGE_TYPE_MANAGED.
 size_t uvm_va_range_block_index(uvm_va_range_t *va_range, NvU64 addr);
 
-// Looks up the VA block at va_range->blocks[index]. If no block is present at
-// that index, NULL is returned.
+// Looks up the VA block at the given index. If no block is present at that
+// index, NULL is returned.
 //
 // The va_range must have type UVM_VA_RANGE_TYPE_MANAGED.
 static uvm_va_block_t *uvm_va_range_block(uvm_va_range_t *va_range, size_t index)
 {
+    atomic_long_t *leaf;
+
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
     UVM_ASSERT(index < uvm_va_range_num_blocks(va_range));
-    uvm_assert_rwsem_locked(&va_range->va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_range->va_space->lock);
+
+    leaf = (atomic_long_t *)atomic_long_read(&va_range->block_leaves[index / UVM_VA_RANGE_BLOCKS_PER_LEAF]);
+    if (!leaf)
+        return NULL;
 
-    return (uvm_va_block_t *)atomic_long_read(&va_range->blocks[index]);
+    return (uvm_va_block_t *)atomic_long_read(&leaf[index % UVM_VA_RANGE_BLOCKS_PER_LEAF]);
 }
 
 // Same as uvm_va_range_block except that the block is created if not already
-// present in the array. If NV_OK is returned, the block has been allocated
+// present in the table. If NV_OK is returned, the block has been allocated
 // successfully.
 //
 // The va_range must have type UVM_VA_RANGE_TYPE_MANAGED.
@@ -42,6 +42,12 @@
 #include "nv_uvm_interface.h"
 #include "nv-kthread-q.h"
 
+// Index the VA range tree of each VA space to speed up uvm_va_range_find and
+// uvm_va_block_find on the fault paths. See uvm_range_tree_index_enable.
+static unsigned uvm_va_range_tree_index = 1;
+module_param(uvm_va_range_tree_index, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_va_range_tree_index, "Use a sorted array index for VA range lookups.");
+
 static bool processor_mask_array_test(const uvm_processor_mask_t *mask,
                                       uvm_processor_id_t mask_id,
                                       uvm_processor_id_t id)
@@ -88,13 +94,14 @@ static void init_tools_data(uvm_va_space_t *va_space)
         INIT_LIST_HEAD(va_space->tools.counters + i);
     for (i = 0; i < ARRAY_SIZE(va_space->tools.queues); i++)
         INIT_LIST_HEAD(va_space->tools.queues + i);
+    INIT_LIST_HEAD(&va_space->tools.histograms);
 }
 
 static NV_STATUS register_gpu_nvlink_peers(uvm_va_space_t *va_space, uvm_gpu_t *gpu)
 {
     uvm_gpu_t *other_gpu;
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     for_each_va_space_gpu(other_gpu, va_space) {
         uvm_gpu_peer_t *peer_caps;
@@ -119,7 +126,7 @@ static bool va_space_check_processors_masks(uvm_va_space_t *va_space)
     uvm_processor_id_t processor;
     uvm_processor_mask_t processors;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     uvm_processor_mask_copy(&processors, &va_space->registered_gpus);
     uvm_processor_mask_set(&processors, UVM_ID_CPU);
@@ -169,11 +176,15 @@ NV_STATUS uvm_va_space_create(struct inode *inode, struct file *filp)
     if (!va_space)
         return NV_ERR_NO_MEMORY;
 
-    uvm_init_rwsem(&va_space->lock, UVM_LOCK_ORDER_VA_SPACE);
+    status = uvm_init_percpu_rwsem(&va_space->lock, UVM_LOCK_ORDER_VA_SPACE);
+    if (status != NV_OK) {
+        uvm_kvfree(va_space);
+        return status;
+    }
+
     uvm_mutex_init(&va_space->serialize_writers_lock, UVM_LOCK_ORDER_VA_SPACE_SERIALIZE_WRITERS);
-    uvm_mutex_init(&va_space->read_acquire_write_release_lock,
-                   UVM_LOCK_ORDER_VA_SPACE_READ_ACQUIRE_WRITE_RELEASE_LOCK);
     uvm_spin_lock_init(&va_space->va_space_mm.lock, UVM_LOCK_ORDER_LEAF);
+    uvm_spin_lock_init(&va_space->cpu_fault_readahead.lock, UVM_LOCK_ORDER_LEAF);
     uvm_range_tree_init(&va_space->va_range_tree);
     uvm_rwlock_irqsave_init(&va_space->ats.rwlock, UVM_LOCK_ORDER_LEAF);
 
@@ -203,6 +214,8 @@ NV_STATUS uvm_va_space_create(struct inode *inode, struct file *filp)
     // Init to 0 since we rely on atomic_inc_return behavior to return 1 as the first ID
     atomic64_set(&va_space->range_group_id_counter, 0);
 
+    va_space->fault_service_weight = UVM_FAULT_SERVICE_WEIGHT_DEFAULT;
+
     INIT_RADIX_TREE(&va_space->range_groups, NV_UVM_GFP_FLAGS);
     uvm_range_tree_init(&va_space->range_group_ranges);
 
@@ -240,6 +253,12 @@ NV_STATUS uvm_va_space_create(struct inode *inode, struct file *filp)
 
     uvm_va_space_down_write(va_space);
 
+    if (uvm_va_range_tree_index) {
+        status = uvm_range_tree_index_enable(&va_space->va_range_tree);
+        if (status != NV_OK)
+            goto fail;
+    }
+
     status = uvm_perf_init_va_space_events(va_space, &va_space->perf_events);
     if (status != NV_OK)
         goto fail;
@@ -267,6 +286,8 @@ fail:
     uvm_perf_destroy_va_space_events(&va_space->perf_events);
     uvm_va_space_up_write(va_space);
 
+    uvm_range_tree_index_disable(&va_space->va_range_tree);
+    uvm_deinit_percpu_rwsem(&va_space->lock);
     uvm_kvfree(va_space);
 
     return status;
@@ -284,7 +305,7 @@ static void unregister_gpu(uvm_va_space_t *va_space,
     uvm_va_range_t *va_range;
     NvU32 peer_table_index;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     if (peers_to_release)
         uvm_global_processor_mask_zero(peers_to_release);
@@ -402,6 +423,137 @@ void uvm_va_space_detach_all_user_channels(uvm_va_space_t *va_space, struct list
         uvm_gpu_va_space_detach_all_user_channels(gpu_va_space, deferred_free_list);
 }
 
+// Minimum number of VA blocks in a VA space for its teardown to be spread over
+// the teardown workers
+#define UVM_VA_SPACE_TEARDOWN_MIN_BLOCKS 64
+
+typedef struct va_space_teardown_struct va_space_teardown_t;
+
+typedef struct
+{
+    nv_kthread_q_item_t q_item;
+
+    // Block context private to the worker
+    uvm_va_block_context_t *block_context;
+
+    va_space_teardown_t *teardown;
+} va_space_teardown_worker_t;
+
+// State shared by the workers tearing down the VA blocks of a VA space, see
+// va_space_teardown_blocks()
+struct va_space_teardown_struct
+{
+    // Blocks to tear down, claimed one at a time by the workers through next
+    uvm_va_block_t **blocks;
+    size_t num_blocks;
+    atomic_long_t next;
+
+    va_space_teardown_worker_t workers[UVM_VA_SPACE_TEARDOWN_THREADS_MAX];
+};
+
+static void va_space_teardown_worker(va_space_teardown_worker_t *worker)
+{
+    va_space_teardown_t *teardown = worker->teardown;
+    size_t i;
+
+    // The destroying thread holds the VA space lock in write mode on behalf
+    // of the workers until they are all done, but lock tracking only knows
+    // about the locks taken by the current thread.
+    uvm_thread_context_lock_disable_tracking();
+
+    while ((i = atomic_long_inc_return(&teardown->next) - 1) < teardown->num_blocks)
+        uvm_va_block_teardown(teardown->blocks[i], worker->block_context);
+
+    uvm_thread_context_lock_enable_tracking();
+}
+
+static void va_space_teardown_worker_entry(void *args)
+{
+    UVM_ENTRY_VOID(va_space_teardown_worker((va_space_teardown_worker_t *)args));
+}
+
+// Tear down the VA blocks of all the managed VA ranges on the VA space teardown
+// workers. The blocks stay in their VA ranges, uvm_va_range_destroy() only has
+// to drop their references afterwards. If parallel teardown is disabled, the
+// VA space is small or the allocations fail, nothing is done and the blocks are
+// torn down by uvm_va_range_destroy() instead.
+static void va_space_teardown_blocks(uvm_va_space_t *va_space)
+{
+    unsigned num_workers = g_uvm_global.va_space_teardown.num_qs;
+    va_space_teardown_t *teardown;
+    uvm_va_range_t *va_range;
+    uvm_va_block_t *block;
+    size_t num_blocks = 0;
+    unsigned i;
+
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
+
+    if (num_workers == 0)
+        return;
+
+    uvm_for_each_va_range(va_range, va_space) {
+        if (va_range->type != UVM_VA_RANGE_TYPE_MANAGED || !va_range->block_leaves)
+            continue;
+
+        for_each_va_block_in_va_range(va_range, block)
+            ++num_blocks;
+    }
+
+    if (num_blocks < UVM_VA_SPACE_TEARDOWN_MIN_BLOCKS)
+        return;
+
+    teardown = uvm_kvmalloc_zero(sizeof(*teardown));
+    if (!teardown)
+        return;
+
+    teardown->blocks = uvm_kvmalloc(num_blocks * sizeof(teardown->blocks[0]));
+    if (!teardown->blocks)
+        goto out;
+
+    uvm_for_each_va_range(va_range, va_space) {
+        if (va_range->type != UVM_VA_RANGE_TYPE_MANAGED || !va_range->block_leaves)
+            continue;
+
+        // The workers don't hold the VA space lock, so the fault block caches
+        // are cleared here
+        for_each_va_block_in_va_range(va_range, block) {
+            uvm_va_space_fault_block_cache_remove(va_space, block);
+            teardown->blocks[teardown->num_blocks++] = block;
+        }
+    }
+
+    UVM_ASSERT(teardown->num_blocks == num_blocks);
+    atomic_long_set(&teardown->next, 0);
+
+    for (i = 0; i < num_workers; ++i) {
+        va_space_teardown_worker_t *worker = &teardown->workers[i];
+
+        worker->block_context = uvm_va_block_context_alloc(NULL);
+        if (!worker->block_context)
+            break;
+
+        worker->teardown = teardown;
+        nv_kthread_q_item_init(&worker->q_item, va_space_teardown_worker_entry, worker);
+    }
+
+    num_workers = i;
+
+    for (i = 0; i < num_workers; ++i)
+        nv_kthread_q_schedule_q_item(&g_uvm_global.va_space_teardown.qs[i], &teardown->workers[i].q_item);
+
+    // Single barrier for all the workers. Any blocks left if no worker could
+    // be started are torn down by uvm_va_range_destroy().
+    for (i = 0; i < num_workers; ++i)
+        nv_kthread_q_flush(&g_uvm_global.va_space_teardown.qs[i]);
+
+    for (i = 0; i < num_workers; ++i)
+        uvm_va_block_context_free(teardown->workers[i].block_context);
+
+out:
+    uvm_kvfree(teardown->blocks);
+    uvm_kvfree(teardown);
+}
+
 void uvm_va_space_destroy(uvm_va_space_t *va_space)
 {
     uvm_va_range_t *va_range, *va_range_next;
@@ -442,6 +594,10 @@ void uvm_va_space_destroy(uvm_va_space_t *va_space)
 
     uvm_va_space_detach_all_user_channels(va_space, &deferred_free_list);
 
+    // Unmapping the blocks and freeing their memory dominates the teardown of
+    // large VA spaces. Do that in parallel first.
+    va_space_teardown_blocks(va_space);
+
     // Destroy all VA ranges. We do this before unregistering the GPUs for
     // performance, since GPU unregister will walk all VA ranges in the VA space
     // multiple times.
@@ -560,6 +716,8 @@ void uvm_va_space_destroy(uvm_va_space_t *va_space)
 
     uvm_mutex_unlock(&g_uvm_global.global_lock);
 
+    uvm_range_tree_index_disable(&va_space->va_range_tree);
+    uvm_deinit_percpu_rwsem(&va_space->lock);
     uvm_kvfree(va_space);
 }
 
@@ -618,7 +776,7 @@ void uvm_va_space_stop_all_user_channels(uvm_va_space_t *va_space)
     if (atomic_read(&va_space->user_channels_stopped))
         return;
 
-    uvm_assert_rwsem_locked_read(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_read(&va_space->lock);
 
     for_each_gpu_va_space(gpu_va_space, va_space) {
         list_for_each_entry(user_channel, &gpu_va_space->registered_channels, list_node)
@@ -957,7 +1115,7 @@ static void disable_peers(uvm_va_space_t *va_space,
     NvU32 table_index;
     uvm_va_range_t *va_range;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     table_index = uvm_gpu_peer_table_index(gpu0->id, gpu1->id);
 
@@ -996,7 +1154,7 @@ static NV_STATUS enable_peers(uvm_va_space_t *va_space, uvm_gpu_t *gpu0, uvm_gpu
     uvm_va_range_t *va_range;
     LIST_HEAD(deferred_free_list);
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     // We know the GPUs were retained already, so now verify that they've been
     // registered by this specific VA space.
@@ -1119,6 +1277,19 @@ static void free_gpu_va_space(nv_kref_t *nv_kref)
     uvm_kvfree(gpu_va_space);
 }
 
+void uvm_va_space_fault_block_cache_remove(uvm_va_space_t *va_space, uvm_va_block_t *va_block)
+{
+    uvm_gpu_va_space_t *gpu_va_space;
+    size_t index = uvm_gpu_va_space_fault_block_cache_index(va_block->start);
+
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
+
+    for_each_gpu_va_space(gpu_va_space, va_space) {
+        if (gpu_va_space->fault_block_cache[index] == va_block)
+            gpu_va_space->fault_block_cache[index] = NULL;
+    }
+}
+
 void uvm_gpu_va_space_release(uvm_gpu_va_space_t *gpu_va_space)
 {
     if (gpu_va_space)
@@ -1128,7 +1299,7 @@ void uvm_gpu_va_space_release(uvm_gpu_va_space_t *gpu_va_space)
 void uvm_gpu_va_space_unset_page_dir(uvm_gpu_va_space_t *gpu_va_space)
 {
     if (gpu_va_space->va_space)
-        uvm_assert_rwsem_locked_read(&gpu_va_space->va_space->lock);
+        uvm_assert_percpu_rwsem_locked_read(&gpu_va_space->va_space->lock);
 
     if (gpu_va_space->did_set_page_directory) {
         NV_STATUS status = uvm_rm_locked_call(nvUvmInterfaceUnsetPageDirectory(gpu_va_space->duped_gpu_va_space));
@@ -1309,7 +1480,7 @@ static NV_STATUS add_gpu_va_space(uvm_va_space_t *va_space, uvm_gpu_va_space_t *
     uvm_gpu_t *other_gpu;
     uvm_gpu_va_space_t *other_gpu_va_space;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     // If this GPU VA space uses ATS then pageable memory access must not have
     // been disabled in the VA space.
@@ -1479,7 +1650,7 @@ static void remove_gpu_va_space(uvm_gpu_va_space_t *gpu_va_space,
         return;
 
     va_space = gpu_va_space->va_space;
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     uvm_gpu_va_space_detach_all_user_channels(gpu_va_space, deferred_free_list);
 
@@ -1668,7 +1839,7 @@ uvm_user_channel_t *uvm_gpu_va_space_get_user_channel(uvm_gpu_va_space_t *gpu_va
     uvm_va_space_t *va_space = gpu_va_space->va_space;
 
     UVM_ASSERT(uvm_gpu_va_space_state(gpu_va_space) == UVM_GPU_VA_SPACE_STATE_ACTIVE);
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     // TODO: Bug 1880191: This is called on every non-replayable fault service.
     // Evaluate the performance impact of this list traversal and potentially
@@ -1683,6 +1854,20 @@ uvm_user_channel_t *uvm_gpu_va_space_get_user_channel(uvm_gpu_va_space_t *gpu_va
     return NULL;
 }
 
+NV_STATUS uvm_api_set_fault_service_weight(UVM_SET_FAULT_SERVICE_WEIGHT_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+
+    if (params->weight == 0 || params->weight > UVM_FAULT_SERVICE_WEIGHT_MAX)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    // Batches being serviced keep the weight sampled when their faults were
+    // translated
+    WRITE_ONCE(va_space->fault_service_weight, params->weight);
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_api_enable_peer_access(UVM_ENABLE_PEER_ACCESS_PARAMS *params, struct file *filp)
 {
     uvm_va_space_t *va_space = uvm_va_space_get(filp);
@@ -1965,7 +2150,7 @@ static void va_space_remove_dummy_thread_contexts(uvm_va_space_t *va_space)
 {
     size_t i;
 
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     if (va_space->test.dummy_thread_context_wrappers == NULL) {
         UVM_ASSERT(va_space->test.num_dummy_thread_context_wrappers == 0);
@@ -94,6 +94,10 @@ typedef enum
     UVM_GPU_VA_SPACE_STATE_COUNT
 } uvm_gpu_va_space_state_t;
 
+// Number of entries in uvm_gpu_va_space_t::fault_block_cache. Must be a power
+// of 2.
+#define UVM_GPU_VA_SPACE_FAULT_BLOCK_CACHE_SIZE 64
+
 struct uvm_gpu_va_space_struct
 {
     // Parent pointers
@@ -134,6 +138,17 @@ struct uvm_gpu_va_space_struct
     // to the va_space.
     bool needs_fault_buffer_flush;
 
+    // Direct-mapped cache of the VA blocks looked up by replayable fault
+    // servicing, indexed by VA block number. Consecutive fault batches tend to
+    // hit the same blocks, so this saves most of the VA range lookups.
+    //
+    // Lookups and insertions are done by the fault servicing thread of the GPU
+    // with the VA space lock held in read mode. Entries are cleared by
+    // block_kill, which runs with the VA space lock held in write mode, before
+    // the block can be freed. Blocks which are split stay in the cache, but
+    // lookups check the block bounds.
+    uvm_va_block_t *fault_block_cache[UVM_GPU_VA_SPACE_FAULT_BLOCK_CACHE_SIZE];
+
     // Node for the deferred free list where this GPU VA space is stored upon
     // being unregistered.
     uvm_deferred_free_object_t deferred_free;
@@ -185,22 +200,32 @@ struct uvm_va_space_struct
     // Mask of processors registered with the va space that support replayable faults
     uvm_processor_mask_t faultable_processors;
 
-    // Semaphore protecting the state of the va space
-    uvm_rw_semaphore_t lock;
+    // Semaphore protecting the state of the va space. Taken in read mode by
+    // every fault and most API calls, hence per-CPU.
+    uvm_percpu_rw_semaphore_t lock;
 
     // Lock taken prior to taking the VA space lock in write mode, or prior to
     // taking the VA space lock in read mode on a path which will call in RM.
     // See UVM_LOCK_ORDER_VA_SPACE_SERIALIZE_WRITERS in uvm_lock.h.
     uvm_mutex_t serialize_writers_lock;
 
-    // Lock taken to serialize down_reads on the VA space lock with up_writes in
-    // other threads. See
-    // UVM_LOCK_ORDER_VA_SPACE_READ_ACQUIRE_WRITE_RELEASE_LOCK in uvm_lock.h.
-    uvm_mutex_t read_acquire_write_release_lock;
-
     // Tree of uvm_va_range_t's
     uvm_range_tree_t va_range_tree;
 
+    // State of the CPU fault readahead heuristic. See
+    // uvm_va_block_cpu_fault_readahead.
+    struct
+    {
+        uvm_spinlock_t lock;
+
+        // End address of the VA block of the last CPU fault that migrated
+        // data to the CPU
+        NvU64 last_block_end;
+
+        // End address of the last region read ahead
+        NvU64 end;
+    } cpu_fault_readahead;
+
     // Kernel mapping structure passed to unmap_mapping range to unmap CPU PTEs
     // in this process.
     struct address_space mapping;
@@ -322,6 +347,28 @@ struct uvm_va_space_struct
         // Lists of counters listening for events on this VA space
         struct list_head counters[UVM_TOTAL_COUNTERS];
         struct list_head queues[UvmEventNumTypesAll];
+        struct list_head histograms;
+
+        // Sampling of the events, computed from the sampling requested by
+        // the queues listening to each event type. When several queues
+        // request different sampling, the densest one applies to all of them.
+        struct
+        {
+            NvU32 interval;
+            NvU64 period_ns;
+            atomic_t count;
+            atomic64_t next_timestamp;
+        } sampling[UvmEventNumTypesAll];
+
+        // Last time calibration sample recorded for each GPU, used to compute
+        // the drift reported in UvmEventTypeTimeCalibration events. The
+        // sample is only updated by the caller that wins next_timestamp.
+        struct
+        {
+            atomic64_t next_timestamp;
+            NvU64 cpu_time_ns;
+            NvU64 gpu_time_ns;
+        } time_calibration[UVM_ID_MAX_GPUS];
 
         // Node for this va_space in global subscribers list
         struct list_head node;
@@ -339,6 +386,12 @@ struct uvm_va_space_struct
 
     bool user_channel_stops_are_immediate;
 
+    // Weight of the VA space in the servicing of replayable faults, see
+    // UVM_SET_FAULT_SERVICE_WEIGHT. Written with WRITE_ONCE and read with
+    // READ_ONCE, since it is sampled by the fault servicing without the VA
+    // space lock.
+    NvU32 fault_service_weight;
+
     // Block context used for GPU unmap operations so that allocation is not
     // required on the teardown path. This can only be used while the VA space
     // lock is held in write mode. Access using uvm_va_space_block_context().
@@ -457,55 +510,44 @@ void uvm_va_space_destroy(uvm_va_space_t *va_space);
 #define uvm_va_space_down_write(__va_space)                             \
     do {                                                                \
         uvm_mutex_lock(&(__va_space)->serialize_writers_lock);          \
-        uvm_mutex_lock(&(__va_space)->read_acquire_write_release_lock); \
-        uvm_down_write(&(__va_space)->lock);                            \
+        uvm_percpu_down_write(&(__va_space)->lock);                     \
     } while (0)
 
-#define uvm_va_space_up_write(__va_space)                                   \
-    do {                                                                    \
-        uvm_up_write(&(__va_space)->lock);                                  \
-        uvm_mutex_unlock(&(__va_space)->read_acquire_write_release_lock);   \
-        uvm_mutex_unlock(&(__va_space)->serialize_writers_lock);            \
+#define uvm_va_space_up_write(__va_space)                               \
+    do {                                                                \
+        uvm_percpu_up_write(&(__va_space)->lock);                       \
+        uvm_mutex_unlock(&(__va_space)->serialize_writers_lock);        \
     } while (0)
 
-#define uvm_va_space_downgrade_write(__va_space)                                        \
-    do {                                                                                \
-        uvm_downgrade_write(&(__va_space)->lock);                                       \
-        uvm_mutex_unlock_out_of_order(&(__va_space)->read_acquire_write_release_lock);  \
-        uvm_mutex_unlock_out_of_order(&(__va_space)->serialize_writers_lock);           \
+#define uvm_va_space_downgrade_write(__va_space)                                \
+    do {                                                                        \
+        uvm_percpu_downgrade_write(&(__va_space)->lock);                        \
+        uvm_mutex_unlock_out_of_order(&(__va_space)->serialize_writers_lock);   \
     } while (0)
 
 // Call this when holding the VA space lock for write in order to downgrade to
 // read on a path which also needs to make RM calls.
-#define uvm_va_space_downgrade_write_rm(__va_space)                                     \
-    do {                                                                                \
-        uvm_assert_mutex_locked(&(__va_space)->serialize_writers_lock);                 \
-        uvm_downgrade_write(&(__va_space)->lock);                                       \
-        uvm_mutex_unlock_out_of_order(&(__va_space)->read_acquire_write_release_lock);  \
+#define uvm_va_space_downgrade_write_rm(__va_space)                             \
+    do {                                                                        \
+        uvm_assert_mutex_locked(&(__va_space)->serialize_writers_lock);         \
+        uvm_percpu_downgrade_write(&(__va_space)->lock);                        \
     } while (0)
 
-#define uvm_va_space_down_read(__va_space)                                              \
-    do {                                                                                \
-        uvm_mutex_lock(&(__va_space)->read_acquire_write_release_lock);                 \
-        uvm_down_read(&(__va_space)->lock);                                             \
-        uvm_mutex_unlock_out_of_order(&(__va_space)->read_acquire_write_release_lock);  \
-    } while (0)
+#define uvm_va_space_down_read(__va_space) uvm_percpu_down_read(&(__va_space)->lock)
 
 // Call this if RM calls need to be made while holding the VA space lock in read
-// mode. Note that taking read_acquire_write_release_lock is unnecessary since
-// the down_read is serialized with another thread's up_write by the
-// serialize_writers_lock.
+// mode.
 #define uvm_va_space_down_read_rm(__va_space)                           \
     do {                                                                \
         uvm_mutex_lock(&(__va_space)->serialize_writers_lock);          \
-        uvm_down_read(&(__va_space)->lock);                             \
+        uvm_percpu_down_read(&(__va_space)->lock);                      \
     } while (0)
 
-#define uvm_va_space_up_read(__va_space) uvm_up_read(&(__va_space)->lock)
+#define uvm_va_space_up_read(__va_space) uvm_percpu_up_read(&(__va_space)->lock)
 
 #define uvm_va_space_up_read_rm(__va_space)                             \
     do {                                                                \
-        uvm_up_read(&(__va_space)->lock);                               \
+        uvm_percpu_up_read(&(__va_space)->lock);                        \
         uvm_mutex_unlock(&(__va_space)->serialize_writers_lock);        \
     } while (0)
 
@@ -593,7 +635,7 @@ static uvm_va_space_t *uvm_va_space_get(struct file *filp)
 
 static uvm_va_block_context_t *uvm_va_space_block_context(uvm_va_space_t *va_space, struct mm_struct *mm)
 {
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
     uvm_va_block_context_init(&va_space->va_block_context, mm);
     return &va_space->va_block_context;
 }
@@ -641,7 +683,7 @@ static uvm_gpu_va_space_t *uvm_gpu_va_space_get_by_parent_gpu(uvm_va_space_t *va
 {
     uvm_gpu_va_space_t *gpu_va_space;
 
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     if (!parent_gpu || !uvm_processor_mask_test(&va_space->registered_gpu_va_spaces, parent_gpu->id))
         return NULL;
@@ -668,6 +710,38 @@ static uvm_gpu_va_space_t *uvm_gpu_va_space_get(uvm_va_space_t *va_space, uvm_gp
     return gpu_va_space;
 }
 
+static size_t uvm_gpu_va_space_fault_block_cache_index(NvU64 addr)
+{
+    return (addr / UVM_VA_BLOCK_SIZE) & (UVM_GPU_VA_SPACE_FAULT_BLOCK_CACHE_SIZE - 1);
+}
+
+// Returns the cached VA block containing addr, or NULL on a miss. See
+// uvm_gpu_va_space_t::fault_block_cache.
+static uvm_va_block_t *uvm_gpu_va_space_fault_block_cache_lookup(uvm_gpu_va_space_t *gpu_va_space, NvU64 addr)
+{
+    uvm_va_block_t *va_block = gpu_va_space->fault_block_cache[uvm_gpu_va_space_fault_block_cache_index(addr)];
+
+    uvm_assert_percpu_rwsem_locked(&gpu_va_space->va_space->lock);
+
+    if (va_block && addr >= va_block->start && addr <= va_block->end)
+        return va_block;
+
+    return NULL;
+}
+
+static void uvm_gpu_va_space_fault_block_cache_insert(uvm_gpu_va_space_t *gpu_va_space, uvm_va_block_t *va_block)
+{
+    uvm_assert_percpu_rwsem_locked(&gpu_va_space->va_space->lock);
+
+    // Only blocks of managed VA ranges are cleared by block_kill
+    if (va_block->va_range)
+        gpu_va_space->fault_block_cache[uvm_gpu_va_space_fault_block_cache_index(va_block->start)] = va_block;
+}
+
+// Clear the given VA block from the fault block caches of all the GPU VA
+// spaces. The VA space lock must be held in write mode.
+void uvm_va_space_fault_block_cache_remove(uvm_va_space_t *va_space, uvm_va_block_t *va_block);
+
 #define for_each_gpu_va_space(__gpu_va_space, __va_space)                                                   \
     for (__gpu_va_space =                                                                                   \
             uvm_gpu_va_space_get(                                                                           \
@@ -706,7 +780,7 @@ static uvm_gpu_t *uvm_processor_mask_find_first_va_space_gpu(const uvm_processor
 
 static uvm_gpu_t *uvm_va_space_find_first_gpu(uvm_va_space_t *va_space)
 {
-    uvm_assert_rwsem_locked(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked(&va_space->lock);
 
     return uvm_processor_mask_find_first_va_space_gpu(&va_space->registered_gpus, va_space);
 }
@@ -747,7 +821,7 @@ static uvm_gpu_t *uvm_processor_mask_find_next_va_space_gpu(const uvm_processor_
 }
 
 #define for_each_va_space_gpu_in_mask(gpu, va_space, mask)                                       \
-    for (({uvm_assert_rwsem_locked(&(va_space)->lock);                                           \
+    for (({uvm_assert_percpu_rwsem_locked(&(va_space)->lock);                                           \
            gpu = uvm_processor_mask_find_first_va_space_gpu(mask, va_space);});                  \
            gpu != NULL;                                                                          \
            gpu = __uvm_processor_mask_find_next_va_space_gpu(mask, va_space, gpu))
@@ -282,7 +282,7 @@ NV_STATUS uvm_va_space_mm_register(uvm_va_space_t *va_space)
     int ret;
 
     uvm_assert_mmap_lock_locked_write(current->mm);
-    uvm_assert_rwsem_locked_write(&va_space->lock);
+    uvm_assert_percpu_rwsem_locked_write(&va_space->lock);
 
     UVM_ASSERT(uvm_va_space_initialized(va_space) != NV_OK);
     if (!uvm_va_space_mm_enabled(va_space))
@@ -412,6 +412,41 @@ void uvm_va_space_mm_or_current_release(uvm_va_space_t *va_space, struct mm_stru
         uvm_va_space_mm_release(va_space);
 }
 
+struct mm_struct *uvm_va_space_mm_cached_retain(uvm_va_space_mm_retain_cache_t *cache, uvm_va_space_t *va_space)
+{
+    if (cache->va_space == va_space) {
+        // The cached retention keeps uvm_va_space_mm_shutdown() from
+        // completing, so va_space is still valid. Reading alive without the
+        // lock is fine: a stale value only delays dropping the retention until
+        // the next call, and shutdown waits for it.
+        if (READ_ONCE(va_space->va_space_mm.alive))
+            return cache->mm;
+    }
+
+    uvm_va_space_mm_retain_cache_flush(cache);
+
+    cache->mm = uvm_va_space_mm_retain(va_space);
+
+    // Only retained mms are cached, since the VA space may be destroyed at any
+    // point otherwise
+    if (cache->mm)
+        cache->va_space = va_space;
+
+    return cache->mm;
+}
+
+void uvm_va_space_mm_retain_cache_flush(uvm_va_space_mm_retain_cache_t *cache)
+{
+    if (!cache->va_space)
+        return;
+
+    UVM_ASSERT(cache->mm);
+
+    uvm_va_space_mm_release(cache->va_space);
+    cache->va_space = NULL;
+    cache->mm = NULL;
+}
+
 static void uvm_va_space_mm_shutdown_delay(uvm_va_space_t *va_space)
 {
     uvm_va_space_mm_t *va_space_mm = &va_space->va_space_mm;
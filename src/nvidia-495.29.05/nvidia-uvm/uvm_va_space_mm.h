@@ -178,6 +178,52 @@ static void uvm_va_space_mm_or_current_release_unlock(uvm_va_space_t *va_space,
     uvm_va_space_mm_or_current_release(va_space, mm);
 }
 
+// Retention of a VA space mm which a background worker (fault or access
+// counter servicing) keeps across consecutive batches on the same VA space,
+// rather than retaining and releasing the mm for each of them.
+//
+// uvm_va_space_mm_shutdown() waits for all retainers, so the worker must flush
+// the cache with uvm_va_space_mm_retain_cache_flush() before going idle. A
+// cached retention is also dropped as soon as the mm is marked as dead.
+typedef struct
+{
+    // VA space whose mm is retained, or NULL if the cache is empty
+    uvm_va_space_t *va_space;
+
+    struct mm_struct *mm;
+} uvm_va_space_mm_retain_cache_t;
+
+// Returns the mm of va_space with the guarantees of uvm_va_space_mm_retain(),
+// reusing the retention held by the cache if it's for the same VA space and the
+// mm is still alive. Otherwise the cached retention is dropped and the mm is
+// retained again. The caller must not release the returned mm, which remains
+// valid until the next call on the cache or
+// uvm_va_space_mm_retain_cache_flush().
+//
+// The cache must be serialized by the caller.
+struct mm_struct *uvm_va_space_mm_cached_retain(uvm_va_space_mm_retain_cache_t *cache, uvm_va_space_t *va_space);
+
+// Drops the retention held by the cache, if any.
+void uvm_va_space_mm_retain_cache_flush(uvm_va_space_mm_retain_cache_t *cache);
+
+// Convenience wrapper around uvm_va_space_mm_cached_retain() which also locks
+// mmap_lock for read if valid. The lock is dropped with
+// uvm_va_space_mm_cached_unlock().
+static struct mm_struct *uvm_va_space_mm_cached_retain_lock(uvm_va_space_mm_retain_cache_t *cache,
+                                                            uvm_va_space_t *va_space)
+{
+    struct mm_struct *mm = uvm_va_space_mm_cached_retain(cache, va_space);
+    if (mm)
+        uvm_down_read_mmap_lock(mm);
+    return mm;
+}
+
+static void uvm_va_space_mm_cached_unlock(struct mm_struct *mm)
+{
+    if (mm)
+        uvm_up_read_mmap_lock(mm);
+}
+
 NV_STATUS uvm_test_va_space_mm_retain(UVM_TEST_VA_SPACE_MM_RETAIN_PARAMS *params, struct file *filp);
 NV_STATUS uvm_test_va_space_mm_delay_shutdown(UVM_TEST_VA_SPACE_MM_DELAY_SHUTDOWN_PARAMS *params, struct file *filp);
 
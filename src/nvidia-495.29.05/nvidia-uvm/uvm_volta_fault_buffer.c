@@ -336,6 +336,49 @@ void uvm_hal_volta_fault_buffer_parse_entry(uvm_parent_gpu_t *parent_gpu,
     parent_gpu->fault_buffer_hal->entry_clear_valid(parent_gpu, index);
 }
 
+NvU32 uvm_hal_volta_fault_buffer_parse_entries(uvm_parent_gpu_t *parent_gpu,
+                                               NvU32 index,
+                                               NvU32 count,
+                                               uvm_fault_buffer_entry_t *buffer_entries)
+{
+    fault_buffer_entry_c369_t *hw_entries;
+    NvU32 num_valid = 0;
+    NvU32 i;
+
+    UVM_ASSERT(count > 0);
+    UVM_ASSERT(index + count <= parent_gpu->fault_buffer_info.replayable.max_faults);
+
+    hw_entries = (fault_buffer_entry_c369_t *)get_fault_buffer_entry(parent_gpu, index);
+
+    // Find the run of valid entries first, so that a single barrier orders the
+    // reads of all of them
+    while (num_valid < count &&
+           READ_HWVALUE_MW((NvU32 *)&hw_entries[num_valid], C369, BUF_ENTRY, VALID) == NVC369_BUF_ENTRY_VALID_TRUE)
+        ++num_valid;
+
+    if (num_valid == 0)
+        return 0;
+
+    // Prevent the reads of the entries being moved above the reads of the
+    // valid bits
+    smp_rmb();
+
+    for (i = 0; i < num_valid; ++i) {
+        NvU32 fault_entry[NVC369_BUF_SIZE / sizeof(NvU32)];
+
+        // Copy the entry out of the fault buffer with a few sequential reads
+        // rather than reading it field by field, and decode the local copy
+        memcpy(fault_entry, &hw_entries[i], sizeof(fault_entry));
+        parse_fault_entry_common(parent_gpu, fault_entry, &buffer_entries[i]);
+    }
+
+    // Automatically clear valid bit for the entries in the fault buffer
+    for (i = 0; i < num_valid; ++i)
+        WRITE_HWCONST_MW((NvU32 *)&hw_entries[i], C369, BUF_ENTRY, VALID, FALSE);
+
+    return num_valid;
+}
+
 void uvm_hal_volta_fault_buffer_parse_non_replayable_entry(uvm_parent_gpu_t *parent_gpu,
                                                            void *fault_packet,
                                                            uvm_fault_buffer_entry_t *buffer_entry)
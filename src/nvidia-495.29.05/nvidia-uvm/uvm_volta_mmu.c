@@ -168,7 +168,7 @@ static void make_pde_volta(void *entry, uvm_mmu_page_table_alloc_t **phys_allocs
 
 // Direct copy of make_pte_pascal, but adds the bits necessary for 47-bit
 // physical addressing
-static NvU64 make_pte_volta(uvm_aperture_t aperture, NvU64 address, uvm_prot_t prot, NvU64 flags)
+NvU64 uvm_hal_volta_mmu_make_pte(uvm_aperture_t aperture, NvU64 address, uvm_prot_t prot, NvU64 flags)
 {
     NvU8 aperture_bits = 0;
     NvU64 pte_bits = 0;
@@ -265,7 +265,7 @@ uvm_mmu_mode_hal_t *uvm_hal_mmu_mode_volta(NvU32 big_page_size)
         uvm_assert_mutex_locked(&g_uvm_global.global_lock);
 
         volta_mmu_mode_hal = *pascal_mmu_mode_hal;
-        volta_mmu_mode_hal.make_pte = make_pte_volta;
+        volta_mmu_mode_hal.make_pte = uvm_hal_volta_mmu_make_pte;
         volta_mmu_mode_hal.make_pde = make_pde_volta;
 
         initialized = true;
@@ -194,6 +194,60 @@ typedef struct
     NVSWITCH_IOCTL_CODE(NVSWITCH_CTL_IO_TYPE, CTRL_NVSWITCH_GET_DEVICES_V2, NVSWITCH_GET_DEVICES_V2_PARAMS, \
                         NVSWITCH_IO_READ_ONLY)
 
+/*
+ * NVSWITCH_DEV_BATCH
+ *
+ * Issued on an nvidia-nvswitchX device node. Runs a vector of device IOCTLs
+ * in a single system call, taking the device lock once. This is intended for
+ * telemetry clients which poll many counters on every port.
+ *
+ * Only commands which return data (_IOC_READ set in the request code) can be
+ * batched, and each one is subject to the same access checks as when it is
+ * issued on its own. Commands run in order; a failing command does not stop
+ * the remaining ones.
+ *
+ * Parameters:
+ * entries[in]
+ *    User pointer to an array of numEntries NVSWITCH_DEV_BATCH_ENTRY.
+ * numEntries[in]
+ *    Number of entries, at most NVSWITCH_DEV_BATCH_MAX_ENTRIES.
+ * numFailed[out]
+ *    Number of entries whose status is not zero.
+ *
+ * NVSWITCH_DEV_BATCH_ENTRY:
+ * cmd[in]
+ *    Device IOCTL request code, as would be passed to ioctl().
+ * params[in]
+ *    User pointer to the parameters of cmd.
+ * status[out]
+ *    Zero on success, or the negative errno cmd would have failed with.
+ */
+#define NVSWITCH_DEV_BATCH_MAX_ENTRIES 256
+
+typedef struct
+{
+    NvU32 cmd;
+    NvS32 status;
+    NvP64 params NV_ALIGN_BYTES(8);
+} NVSWITCH_DEV_BATCH_ENTRY;
+
+typedef struct
+{
+    NvP64 entries NV_ALIGN_BYTES(8);
+    NvU32 numEntries;
+    NvU32 numFailed;
+} NVSWITCH_DEV_BATCH_PARAMS;
+
+/*
+ * Handled by the OS layer, outside of the range of the NvSwitch library
+ * device controls.
+ */
+#define CTRL_NVSWITCH_DEV_BATCH           0xF0
+
+#define IOCTL_NVSWITCH_DEV_BATCH \
+    NVSWITCH_IOCTL_CODE(NVSWITCH_DEV_IO_TYPE, CTRL_NVSWITCH_DEV_BATCH, NVSWITCH_DEV_BATCH_PARAMS, \
+                        NVSWITCH_IO_WRITE_READ)
+
 #ifdef __cplusplus
 }
 #endif
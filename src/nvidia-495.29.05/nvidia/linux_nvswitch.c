@@ -852,6 +852,144 @@ nvswitch_ioctl_state_sync
     return rc;
 }
 
+//
+// Run a single command of a batch, see NVSWITCH_DEV_BATCH.
+//
+// The kernel buffer is shared by all the commands of the batch and grown as
+// needed, so that polling many counters does not allocate for each of them.
+//
+static int
+nvswitch_device_ioctl_batch_entry
+(
+    NVSWITCH_DEV *nvswitch_dev,
+    struct file *file,
+    NVSWITCH_DEV_BATCH_ENTRY *entry,
+    void **kernel_params,
+    unsigned long *kernel_params_alloc_size
+)
+{
+    void __user *user_params = KERNEL_POINTER_FROM_NvP64(void __user *, entry->params);
+    unsigned long size = _IOC_SIZE(entry->cmd);
+    NvlStatus retval;
+    int rc;
+
+    if ((_IOC_TYPE(entry->cmd) != NVSWITCH_DEV_IO_TYPE) ||
+        (_IOC_NR(entry->cmd) == CTRL_NVSWITCH_DEV_BATCH) ||
+        (0 == (_IOC_DIR(entry->cmd) & _IOC_READ)) ||
+        (0 == size))
+    {
+        return -EINVAL;
+    }
+
+    if (size > *kernel_params_alloc_size)
+    {
+        kfree(*kernel_params);
+        *kernel_params_alloc_size = 0;
+
+        *kernel_params = kmalloc(size, GFP_KERNEL);
+        if (NULL == *kernel_params)
+        {
+            return -ENOMEM;
+        }
+
+        *kernel_params_alloc_size = size;
+    }
+
+    // Same as nvswitch_ioctl_state_start(), _IOR() commands get zeroed params
+    if (_IOC_DIR(entry->cmd) & _IOC_WRITE)
+    {
+        if (copy_from_user(*kernel_params, user_params, size))
+        {
+            return -EFAULT;
+        }
+    }
+    else
+    {
+        memset(*kernel_params, 0, size);
+    }
+
+    retval = nvswitch_lib_ctrl(nvswitch_dev->lib_device,
+                               _IOC_NR(entry->cmd),
+                               *kernel_params,
+                               size,
+                               file->private_data);
+    rc = nvswitch_map_status(retval);
+    if (rc)
+    {
+        return rc;
+    }
+
+    if (copy_to_user(user_params, *kernel_params, size))
+    {
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+//
+// Run the commands of a batch with the device mutex held by the caller.
+//
+// Failures of individual commands are reported through their status; the
+// batch itself only fails if the entries array cannot be accessed.
+//
+static int
+nvswitch_device_ioctl_batch
+(
+    NVSWITCH_DEV *nvswitch_dev,
+    struct file *file,
+    void *params,
+    unsigned long params_size
+)
+{
+    NVSWITCH_DEV_BATCH_PARAMS *p = params;
+    NVSWITCH_DEV_BATCH_ENTRY __user *user_entries;
+    NVSWITCH_DEV_BATCH_ENTRY entry;
+    void *kernel_params = NULL;
+    unsigned long kernel_params_alloc_size = 0;
+    NvU32 i;
+    int rc = 0;
+
+    if ((params_size != sizeof(*p)) ||
+        (p->numEntries > NVSWITCH_DEV_BATCH_MAX_ENTRIES))
+    {
+        return -EINVAL;
+    }
+
+    user_entries = KERNEL_POINTER_FROM_NvP64(NVSWITCH_DEV_BATCH_ENTRY __user *,
+                                             p->entries);
+    p->numFailed = 0;
+
+    for (i = 0; i < p->numEntries; i++)
+    {
+        if (copy_from_user(&entry, &user_entries[i], sizeof(entry)))
+        {
+            rc = -EFAULT;
+            break;
+        }
+
+        entry.status = nvswitch_device_ioctl_batch_entry(nvswitch_dev,
+                                                         file,
+                                                         &entry,
+                                                         &kernel_params,
+                                                         &kernel_params_alloc_size);
+        if (entry.status)
+        {
+            p->numFailed++;
+        }
+
+        if (put_user(entry.status, &user_entries[i].status))
+        {
+            rc = -EFAULT;
+            break;
+        }
+    }
+
+    kfree(kernel_params);
+
+    return rc;
+}
+
 static int
 nvswitch_device_ioctl
 (
@@ -898,12 +1036,23 @@ nvswitch_device_ioctl
         goto nvswitch_device_ioctl_exit;
     }
 
-    retval = nvswitch_lib_ctrl(nvswitch_dev->lib_device,
-                               _IOC_NR(cmd),
-                               state.kernel_params,
-                               state.kernel_params_size,
-                               file->private_data);
-    rc = nvswitch_map_status(retval);
+    if (_IOC_NR(cmd) == CTRL_NVSWITCH_DEV_BATCH)
+    {
+        rc = nvswitch_device_ioctl_batch(nvswitch_dev,
+                                         file,
+                                         state.kernel_params,
+                                         state.kernel_params_size);
+    }
+    else
+    {
+        retval = nvswitch_lib_ctrl(nvswitch_dev->lib_device,
+                                   _IOC_NR(cmd),
+                                   state.kernel_params,
+                                   state.kernel_params_size,
+                                   file->private_data);
+        rc = nvswitch_map_status(retval);
+    }
+
     if (!rc)
     {
         rc = nvswitch_ioctl_state_sync(&state, cmd, arg);
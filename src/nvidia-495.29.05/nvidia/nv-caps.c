@@ -461,6 +461,14 @@ static nv_proc_ops_t g_nv_cap_procfs_fops = {
 /* forward declaration of g_nv_cap_drv_fops */
 static struct file_operations g_nv_cap_drv_fops;
 
+/*
+ * Validation is intentionally not cached per fd. The checks are O(1): the
+ * fd's file must use g_nv_cap_drv_fops and its minor must match cap->minor,
+ * which nv_cap_create_file_entry() resolved once through the hash table.
+ * An fd number can be closed and reused for another file between two calls,
+ * so a cached result keyed on it would have to be revalidated with the same
+ * fget() anyway, and the reference taken here is handed to the new fd.
+ */
 int NV_API_CALL nv_cap_validate_and_dup_fd(const nv_cap_t *cap, int fd)
 {
     struct file *file;
@@ -104,6 +104,34 @@ static void nv_dma_unmap_contig(nv_dma_map_t *dma_map)
 #endif
 }
 
+/*
+ * Whether the pages are physically contiguous and can be mapped as a single
+ * segment, which costs a single IOVA allocation and IOMMU mapping instead of
+ * building and mapping a scatterlist.
+ */
+static NvBool nv_dma_pages_are_contiguous(
+    struct page **pages,
+    NvU64 page_count
+)
+{
+#if defined(NV_DOM0_KERNEL_PRESENT)
+    // Pseudo-physical contiguity says nothing about machine contiguity
+    return NV_FALSE;
+#else
+    NvU64 i;
+
+    for (i = 1; i < page_count; i++)
+    {
+        if (page_to_pfn(pages[i]) != page_to_pfn(pages[i - 1]) + 1)
+        {
+            return NV_FALSE;
+        }
+    }
+
+    return NV_TRUE;
+#endif
+}
+
 static void nv_fill_scatterlist
 (
     struct scatterlist *sgl,
@@ -542,8 +570,38 @@ NV_STATUS NV_API_CALL nv_dma_map_pages(
 
     if (dma_map->page_count > 1 && !dma_map->contiguous)
     {
-        dma_map->mapping.discontig.submap_count = 0;
-        status = nv_dma_map_scatterlist(dma_dev, dma_map, va_array);
+        status = NV_ERR_NOT_SUPPORTED;
+
+        /*
+         * Map physically contiguous pages as a single segment, falling back
+         * to a scatterlist if that fails, e.g. because the single segment
+         * would need to be bounced.
+         */
+        if (nv_dma_pages_are_contiguous(dma_map->pages, dma_map->page_count))
+        {
+            dma_map->contiguous = NV_TRUE;
+
+            status = nv_dma_map_contig(dma_dev, dma_map, va_array);
+            if (status == NV_OK)
+            {
+                NvU64 i;
+
+                for (i = 1; i < dma_map->page_count; i++)
+                {
+                    va_array[i] = va_array[0] + (i << PAGE_SHIFT);
+                }
+            }
+            else
+            {
+                dma_map->contiguous = NV_FALSE;
+            }
+        }
+
+        if (status != NV_OK)
+        {
+            dma_map->mapping.discontig.submap_count = 0;
+            status = nv_dma_map_scatterlist(dma_dev, dma_map, va_array);
+        }
     }
     else
     {
@@ -563,8 +621,10 @@ NV_STATUS NV_API_CALL nv_dma_map_pages(
     else
     {
         *priv = dma_map;
+
+        // The caller expects one address per page unless it asked for contig
         nv_dma_nvlink_addr_compress(dma_dev, va_array, dma_map->page_count,
-                                    dma_map->contiguous);
+                                    contig || (dma_map->page_count == 1));
     }
 
     return status;
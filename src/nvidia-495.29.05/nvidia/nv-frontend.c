@@ -88,6 +88,15 @@ static int add_device(nvidia_module_t *module, nv_linux_state_t *device, NvBool
     NvU32 i;
     int rc = -1;
 
+    // keep the minor number the caller asked for, if it is free
+    if ((all == NV_FALSE) &&
+        (device->minor_num < NV_FRONTEND_CONTROL_DEVICE_MINOR_MIN) &&
+        (nv_minor_num_table[device->minor_num] == NULL))
+    {
+        nv_minor_num_table[device->minor_num] = module;
+        return 0;
+    }
+
     // look for free a minor number and assign unique minor number to this device
     for (i = 0; i <= NV_FRONTEND_CONTROL_DEVICE_MINOR_MIN; i++)
     {
@@ -30,6 +30,74 @@
 
 #if defined(CONFIG_I2C) || defined(CONFIG_I2C_MODULE)
 
+#define NV_I2C_SMBUS_CAPABLE_UNKNOWN    0
+#define NV_I2C_SMBUS_CAPABLE_NO         1
+#define NV_I2C_SMBUS_CAPABLE_YES        2
+
+//
+// The adapter handed to RM and registered with the kernel is the first
+// member, so RM and the I2C core see a plain struct i2c_adapter.
+//
+typedef struct
+{
+    struct i2c_adapter adapter;
+
+    // Whether RM can issue SMBus commands on this port, queried on first use
+    int smbus_capable;
+} nv_i2c_adapter_t;
+
+static const unsigned int nv_i2c_supported_flags = I2C_M_RD
+#if defined(I2C_M_DMA_SAFE)
+    | I2C_M_DMA_SAFE
+#endif
+    ;
+
+static NvBool nv_i2c_is_smbus_capable(nvidia_stack_t *sp, struct i2c_adapter *adapter)
+{
+    nv_i2c_adapter_t *nv_adapter = container_of(adapter, nv_i2c_adapter_t, adapter);
+    nv_state_t *nv = (nv_state_t *)adapter->algo_data;
+
+    if (nv_adapter->smbus_capable == NV_I2C_SMBUS_CAPABLE_UNKNOWN)
+    {
+        nv_adapter->smbus_capable = rm_i2c_is_smbus_capable(sp, nv, adapter) ?
+                                        NV_I2C_SMBUS_CAPABLE_YES :
+                                        NV_I2C_SMBUS_CAPABLE_NO;
+    }
+
+    return nv_adapter->smbus_capable == NV_I2C_SMBUS_CAPABLE_YES;
+}
+
+//
+// Register reads are usually issued as a write of a one byte register index
+// followed by a read from the same device. Such a pair can be sent to RM as
+// a single SMBus read command instead of two transfers. Only the byte and
+// word lengths nv_i2c_algo_smbus_xfer() issues are combined.
+//
+static NvBool nv_i2c_is_index_read(
+    nvidia_stack_t *sp,
+    struct i2c_adapter *adapter,
+    struct i2c_msg *write,
+    struct i2c_msg *read
+)
+{
+    if ((write->flags & ~nv_i2c_supported_flags) ||
+        (read->flags & ~nv_i2c_supported_flags))
+    {
+        return NV_FALSE;
+    }
+
+    if ((write->flags & I2C_M_RD) || !(read->flags & I2C_M_RD))
+        return NV_FALSE;
+
+    if ((write->addr != read->addr) || (write->len != 1) ||
+        (read->len < 1) || (read->len > 2))
+    {
+        return NV_FALSE;
+    }
+
+    return nv_i2c_is_smbus_capable(sp, adapter);
+}
+
 static int nv_i2c_algo_master_xfer(struct i2c_adapter *adapter, struct i2c_msg msgs[], int num)
 {
     nv_state_t *nv = (nv_state_t *)adapter->algo_data;
@@ -37,11 +105,6 @@ static int nv_i2c_algo_master_xfer(struct i2c_adapter *adapter, struct i2c_msg m
     int rc;
     NV_STATUS rmStatus = NV_OK;
     nvidia_stack_t *sp = NULL;
-    const unsigned int supported_i2c_flags = I2C_M_RD
-#if defined(I2C_M_DMA_SAFE)
-    | I2C_M_DMA_SAFE
-#endif
-    ;
 
     rc = nv_kmem_cache_alloc_stack(&sp);
     if (rc != 0)
@@ -53,7 +116,7 @@ static int nv_i2c_algo_master_xfer(struct i2c_adapter *adapter, struct i2c_msg m
 
     for (i = 0; ((i < (unsigned int)num) && (rmStatus == NV_OK)); i++)
     {
-        if (msgs[i].flags & ~supported_i2c_flags)
+        if (msgs[i].flags & ~nv_i2c_supported_flags)
         {
             /* we only support basic I2C reads/writes, reject any other commands */
             rc = -EINVAL;
@@ -61,6 +124,17 @@ static int nv_i2c_algo_master_xfer(struct i2c_adapter *adapter, struct i2c_msg m
                       msgs[i].flags);
             rmStatus = NV_ERR_INVALID_ARGUMENT;
         }
+        else if ((i + 1 < (unsigned int)num) &&
+                 nv_i2c_is_index_read(sp, adapter, &msgs[i], &msgs[i + 1]))
+        {
+            rmStatus = rm_i2c_transfer(sp, nv, (void *)adapter,
+                                       NV_I2C_CMD_SMBUS_READ,
+                                       (NvU8)(msgs[i].addr & 0x7f),
+                                       (NvU8)msgs[i].buf[0],
+                                       (NvU32)msgs[i + 1].len,
+                                       (NvU8 *)msgs[i + 1].buf);
+            i++;
+        }
         else
         {
             rmStatus = rm_i2c_transfer(sp, nv, (void *)adapter,
@@ -188,7 +262,7 @@ static u32 nv_i2c_algo_functionality(struct i2c_adapter *adapter)
         return 0;
     }
 
-    if (rm_i2c_is_smbus_capable(sp, nv, adapter))
+    if (nv_i2c_is_smbus_capable(sp, adapter))
     {
         ret |= (I2C_FUNC_SMBUS_QUICK |
                 I2C_FUNC_SMBUS_BYTE |
@@ -218,15 +292,19 @@ void* NV_API_CALL nv_i2c_add_adapter(nv_state_t *nv, NvU32 port)
 {
     NV_STATUS rmStatus;
     nv_linux_state_t *nvl = NV_GET_NVL_FROM_NV_STATE(nv);
+    nv_i2c_adapter_t *nv_adapter = NULL;
     struct i2c_adapter *pI2cAdapter = NULL;
     int osstatus = 0;
 
     // get a i2c adapter
-    rmStatus = os_alloc_mem((void **)&pI2cAdapter,sizeof(struct i2c_adapter));
+    rmStatus = os_alloc_mem((void **)&nv_adapter, sizeof(*nv_adapter));
 
     if (rmStatus != NV_OK)
         return NULL;
 
+    nv_adapter->smbus_capable = NV_I2C_SMBUS_CAPABLE_UNKNOWN;
+    pI2cAdapter = &nv_adapter->adapter;
+
     // fill in with default structure
     os_mem_copy(pI2cAdapter, &nv_i2c_adapter_prototype, sizeof(struct i2c_adapter));
 
@@ -253,7 +331,7 @@ void* NV_API_CALL nv_i2c_add_adapter(nv_state_t *nv, NvU32 port)
     if (osstatus)
     {
         // free the memory and NULL the ptr
-        os_free_mem(pI2cAdapter);
+        os_free_mem(nv_adapter);
 
         pI2cAdapter = NULL;
     }
@@ -269,7 +347,7 @@ void NV_API_CALL nv_i2c_del_adapter(nv_state_t *nv, void *data)
     {
         // release with the OS
         i2c_del_adapter(pI2cAdapter);
-        os_free_mem(pI2cAdapter);
+        os_free_mem(container_of(pI2cAdapter, nv_i2c_adapter_t, adapter));
     }
 }
 
@@ -24,86 +24,82 @@
 #include "nv-memdbg.h"
 #include "nv-linux.h"
 
+#include <linux/hash.h>
+
 /* track who's allocating memory and print out a list of leaked allocations at
  * teardown.
+ *
+ * Allocations are tracked in a hash table keyed by address. The table is
+ * split into shards, each with its own lock, so that allocations and frees
+ * on different CPUs rarely contend. A free usually runs on a different CPU
+ * than the matching allocation, so shards are picked by address rather than
+ * by CPU.
  */
 
+#define NV_MEMDBG_SHARD_BITS    5
+#define NV_MEMDBG_BUCKET_BITS   7
+#define NV_MEMDBG_NUM_SHARDS    (1 << NV_MEMDBG_SHARD_BITS)
+#define NV_MEMDBG_NUM_BUCKETS   (1 << NV_MEMDBG_BUCKET_BITS)
+
 typedef struct {
-    struct rb_node rb_node;
+    struct hlist_node hlist_node;
     void *addr;
-    NvU64 size;
-    NvU32 line;
     const char *file;
+    unsigned long size;
+    NvU32 line;
 } nv_memdbg_node_t;
 
-struct
+typedef struct
 {
-    struct rb_root rb_root;
+    nv_spinlock_t lock;
+    struct hlist_head buckets[NV_MEMDBG_NUM_BUCKETS];
     NvU64 untracked_bytes;
     NvU64 num_untracked_allocs;
-    nv_spinlock_t lock;
-} g_nv_memdbg;
+} ____cacheline_aligned_in_smp nv_memdbg_shard_t;
 
-void nv_memdbg_init(void)
-{
-    NV_SPIN_LOCK_INIT(&g_nv_memdbg.lock);
-    g_nv_memdbg.rb_root = RB_ROOT;
-}
+static nv_memdbg_shard_t g_nv_memdbg_shards[NV_MEMDBG_NUM_SHARDS];
 
-static nv_memdbg_node_t *nv_memdbg_node_entry(struct rb_node *rb_node)
-{
-    return rb_entry(rb_node, nv_memdbg_node_t, rb_node);
-}
-
-static void nv_memdbg_insert_node(nv_memdbg_node_t *new)
+void nv_memdbg_init(void)
 {
-    nv_memdbg_node_t *node;
-    struct rb_node **rb_node = &g_nv_memdbg.rb_root.rb_node;
-    struct rb_node *rb_parent = NULL;
+    unsigned int i, j;
 
-    while (*rb_node)
+    for (i = 0; i < NV_MEMDBG_NUM_SHARDS; i++)
     {
-        node = nv_memdbg_node_entry(*rb_node);
-
-        WARN_ON(new->addr == node->addr);
+        nv_memdbg_shard_t *shard = &g_nv_memdbg_shards[i];
 
-        rb_parent = *rb_node;
-
-        if (new->addr < node->addr)
-            rb_node = &(*rb_node)->rb_left;
-        else
-            rb_node = &(*rb_node)->rb_right;
+        NV_SPIN_LOCK_INIT(&shard->lock);
+        for (j = 0; j < NV_MEMDBG_NUM_BUCKETS; j++)
+            INIT_HLIST_HEAD(&shard->buckets[j]);
     }
+}
 
-    rb_link_node(&new->rb_node, rb_parent, rb_node);
-    rb_insert_color(&new->rb_node, &g_nv_memdbg.rb_root);
+/* The high bits of the hash pick the shard, the low bits the bucket in it. */
+static struct hlist_head *nv_memdbg_bucket(void *addr, nv_memdbg_shard_t **shard)
+{
+    unsigned long hash = hash_ptr(addr, NV_MEMDBG_SHARD_BITS + NV_MEMDBG_BUCKET_BITS);
+
+    *shard = &g_nv_memdbg_shards[hash >> NV_MEMDBG_BUCKET_BITS];
+    return &(*shard)->buckets[hash & (NV_MEMDBG_NUM_BUCKETS - 1)];
 }
 
-static nv_memdbg_node_t *nv_memdbg_remove_node(void *addr)
+static nv_memdbg_node_t *nv_memdbg_find_node(struct hlist_head *bucket, void *addr)
 {
-    nv_memdbg_node_t *node = NULL;
-    struct rb_node *rb_node = g_nv_memdbg.rb_root.rb_node;
+    nv_memdbg_node_t *node;
 
-    while (rb_node)
+    nv_hlist_for_each_entry(node, bucket, hlist_node)
     {
-        node = nv_memdbg_node_entry(rb_node);
-        if (addr == node->addr)
-            break;
-        else if (addr < node->addr)
-            rb_node = rb_node->rb_left;
-        else
-            rb_node = rb_node->rb_right;
+        if (node->addr == addr)
+            return node;
     }
 
-    WARN_ON(!node || node->addr != addr);
-
-    rb_erase(&node->rb_node, &g_nv_memdbg.rb_root);
-    return node;
+    return NULL;
 }
 
 void nv_memdbg_add(void *addr, NvU64 size, const char *file, int line)
 {
     nv_memdbg_node_t *node;
+    nv_memdbg_shard_t *shard;
+    struct hlist_head *bucket;
     unsigned long flags;
 
     WARN_ON(addr == NULL);
@@ -119,38 +115,49 @@ void nv_memdbg_add(void *addr, NvU64 size, const char *file, int line)
         node->line = line;
     }
 
-    NV_SPIN_LOCK_IRQSAVE(&g_nv_memdbg.lock, flags);
+    bucket = nv_memdbg_bucket(addr, &shard);
+
+    NV_SPIN_LOCK_IRQSAVE(&shard->lock, flags);
 
     if (node)
     {
-        nv_memdbg_insert_node(node);
+        WARN_ON(nv_memdbg_find_node(bucket, addr) != NULL);
+        hlist_add_head(&node->hlist_node, bucket);
     }
     else
     {
-        ++g_nv_memdbg.num_untracked_allocs;
-        g_nv_memdbg.untracked_bytes += size;
+        ++shard->num_untracked_allocs;
+        shard->untracked_bytes += size;
     }
 
-    NV_SPIN_UNLOCK_IRQRESTORE(&g_nv_memdbg.lock, flags);
+    NV_SPIN_UNLOCK_IRQRESTORE(&shard->lock, flags);
 }
 
 void nv_memdbg_remove(void *addr, NvU64 size, const char *file, int line)
 {
     nv_memdbg_node_t *node;
+    nv_memdbg_shard_t *shard;
+    struct hlist_head *bucket;
     unsigned long flags;
 
-    NV_SPIN_LOCK_IRQSAVE(&g_nv_memdbg.lock, flags);
+    bucket = nv_memdbg_bucket(addr, &shard);
+
+    NV_SPIN_LOCK_IRQSAVE(&shard->lock, flags);
 
-    node = nv_memdbg_remove_node(addr);
-    if (!node)
+    node = nv_memdbg_find_node(bucket, addr);
+    if (node)
+    {
+        hlist_del(&node->hlist_node);
+    }
+    else
     {
-        WARN_ON(g_nv_memdbg.num_untracked_allocs == 0);
-        WARN_ON(g_nv_memdbg.untracked_bytes < size);
-        --g_nv_memdbg.num_untracked_allocs;
-        g_nv_memdbg.untracked_bytes -= size;
+        WARN_ON(shard->num_untracked_allocs == 0);
+        WARN_ON(shard->untracked_bytes < size);
+        --shard->num_untracked_allocs;
+        shard->untracked_bytes -= size;
     }
 
-    NV_SPIN_UNLOCK_IRQRESTORE(&g_nv_memdbg.lock, flags);
+    NV_SPIN_UNLOCK_IRQRESTORE(&shard->lock, flags);
 
     if (node)
     {
@@ -158,7 +165,7 @@ void nv_memdbg_remove(void *addr, NvU64 size, const char *file, int line)
         {
             nv_printf(NV_DBG_ERRORS,
                 "NVRM: size mismatch on free: %llu != %llu\n",
-                size, node->size);
+                size, (NvU64)node->size);
             if (node->file)
             {
                 nv_printf(NV_DBG_ERRORS,
@@ -182,51 +189,66 @@ void nv_memdbg_exit(void)
 {
     nv_memdbg_node_t *node;
     NvU64 leaked_bytes = 0, num_leaked_allocs = 0;
+    NvU64 untracked_bytes = 0, num_untracked_allocs = 0;
+    unsigned int i, j;
 
-    if (!RB_EMPTY_ROOT(&g_nv_memdbg.rb_root))
-    {
-        nv_printf(NV_DBG_ERRORS,
-            "NVRM: list of leaked memory allocations:\n");
-    }
-
-    while (!RB_EMPTY_ROOT(&g_nv_memdbg.rb_root))
+    for (i = 0; i < NV_MEMDBG_NUM_SHARDS; i++)
     {
-        node = nv_memdbg_node_entry(rb_first(&g_nv_memdbg.rb_root));
-
-        leaked_bytes += node->size;
-        ++num_leaked_allocs;
+        nv_memdbg_shard_t *shard = &g_nv_memdbg_shards[i];
 
-        if (node->file)
-        {
-            nv_printf(NV_DBG_ERRORS,
-                "NVRM:    %llu bytes, 0x%p @ %s:%d\n",
-                node->size, node->addr, node->file, node->line);
-        }
-        else
+        for (j = 0; j < NV_MEMDBG_NUM_BUCKETS; j++)
         {
-            nv_printf(NV_DBG_ERRORS,
-                "NVRM:    %llu bytes, 0x%p\n",
-                node->size, node->addr);
+            struct hlist_head *bucket = &shard->buckets[j];
+
+            while (!hlist_empty(bucket))
+            {
+                node = hlist_entry(bucket->first, nv_memdbg_node_t, hlist_node);
+
+                if (num_leaked_allocs == 0)
+                {
+                    nv_printf(NV_DBG_ERRORS,
+                        "NVRM: list of leaked memory allocations:\n");
+                }
+
+                leaked_bytes += node->size;
+                ++num_leaked_allocs;
+
+                if (node->file)
+                {
+                    nv_printf(NV_DBG_ERRORS,
+                        "NVRM:    %llu bytes, 0x%p @ %s:%d\n",
+                        (NvU64)node->size, node->addr, node->file, node->line);
+                }
+                else
+                {
+                    nv_printf(NV_DBG_ERRORS,
+                        "NVRM:    %llu bytes, 0x%p\n",
+                        (NvU64)node->size, node->addr);
+                }
+
+                hlist_del(&node->hlist_node);
+                kfree(node);
+            }
         }
 
-        rb_erase(&node->rb_node, &g_nv_memdbg.rb_root);
-        kfree(node);
+        untracked_bytes += shard->untracked_bytes;
+        num_untracked_allocs += shard->num_untracked_allocs;
     }
 
     /* If we failed to allocate a node at some point, we may have leaked memory
-     * even if the tree is empty */
-    if (num_leaked_allocs > 0 || g_nv_memdbg.num_untracked_allocs > 0)
+     * even if the table is empty */
+    if (num_leaked_allocs > 0 || num_untracked_allocs > 0)
     {
         nv_printf(NV_DBG_ERRORS,
             "NVRM: total leaked memory: %llu bytes in %llu allocations\n",
-            leaked_bytes + g_nv_memdbg.untracked_bytes,
-            num_leaked_allocs + g_nv_memdbg.num_untracked_allocs);
+            leaked_bytes + untracked_bytes,
+            num_leaked_allocs + num_untracked_allocs);
 
-        if (g_nv_memdbg.num_untracked_allocs > 0)
+        if (num_untracked_allocs > 0)
         {
             nv_printf(NV_DBG_ERRORS,
                 "NVRM:                      %llu bytes in %llu allocations untracked\n",
-                g_nv_memdbg.untracked_bytes, g_nv_memdbg.num_untracked_allocs);
+                untracked_bytes, num_untracked_allocs);
         }
     }
 }
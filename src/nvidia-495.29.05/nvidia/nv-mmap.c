@@ -212,6 +212,10 @@ static vm_fault_t nvidia_fault(
     NvU64 num_pages = NV_VMA_SIZE(vma) >> PAGE_SHIFT;
     NvU64 pfn_start =
         (nvlfp->mmap_context.mmap_start >> PAGE_SHIFT) + vma->vm_pgoff;
+    NvU64 fault_around_pages =
+        ((NvU64)NVreg_MmapFaultAroundSize << 10) >> PAGE_SHIFT;
+    NvU64 first_page = 0;
+    NvU64 last_page = num_pages;
 
     // Mapping revocation is only supported for GPU mappings.
     if (NV_IS_CTL_DEVICE(nv))
@@ -219,17 +223,26 @@ static vm_fault_t nvidia_fault(
         return VM_FAULT_SIGBUS;
     }
 
-    down(&nvl->mmap_lock);
+    //
+    // Faults only need nvl->mmap_lock to keep safe_to_mmap stable while they
+    // insert PFNs, so they take it shared and run concurrently. Revocation
+    // and the other users take it exclusively.
+    //
+    down_read(&nvl->mmap_lock);
 
     // Wake up the GPU if it is not currently safe to mmap.
     if (!nvl->safe_to_mmap)
     {
         NV_STATUS status;
 
-        if (!nvl->gpu_wakeup_callback_needed)
+        // Scheduling the wakeup updates state, which needs the lock exclusive.
+        up_read(&nvl->mmap_lock);
+        down_write(&nvl->mmap_lock);
+
+        if (nvl->safe_to_mmap || !nvl->gpu_wakeup_callback_needed)
         {
-            // GPU wakeup callback already scheduled.
-            up(&nvl->mmap_lock);
+            // Already awake, or GPU wakeup callback already scheduled.
+            up_write(&nvl->mmap_lock);
             return VM_FAULT_NOPAGE;
         }
 
@@ -242,18 +255,28 @@ static vm_fault_t nvidia_fault(
         {
             nv_printf(NV_DBG_ERRORS,
                       "NVRM: VM: rm_schedule_gpu_wakeup failed: %x\n", status);
-            up(&nvl->mmap_lock);
+            up_write(&nvl->mmap_lock);
             return VM_FAULT_SIGBUS;
         }
         // Ensure that we do not schedule duplicate GPU wakeup callbacks.
         nvl->gpu_wakeup_callback_needed = NV_FALSE;
 
-        up(&nvl->mmap_lock);
+        up_write(&nvl->mmap_lock);
         return VM_FAULT_NOPAGE;
     }
 
-    // Safe to mmap, map all pages in this VMA.
-    for (page = 0; page < num_pages; page++)
+    //
+    // Safe to mmap. Map the aligned fault-around window containing the
+    // faulting page, or all pages in this VMA if no window is set.
+    //
+    if (fault_around_pages != 0)
+    {
+        page = (nv_page_fault_va(vmf) - vma->vm_start) >> PAGE_SHIFT;
+        first_page = page - (page % fault_around_pages);
+        last_page = min(first_page + fault_around_pages, num_pages);
+    }
+
+    for (page = first_page; page < last_page; page++)
     {
         NvU64 virt_addr = vma->vm_start + (page << PAGE_SHIFT);
         NvU64 pfn = pfn_start + page;
@@ -267,10 +290,11 @@ static vm_fault_t nvidia_fault(
             break;
         }
 
+        // Every concurrent fault only ever clears the flag.
         nvl->all_mappings_revoked = NV_FALSE;
     }
 
-    up(&nvl->mmap_lock);
+    up_read(&nvl->mmap_lock);
 
     return ret;
 }
@@ -533,7 +557,7 @@ int nvidia_mmap_helper(
             }
         }
 
-        down(&nvl->mmap_lock);
+        down_write(&nvl->mmap_lock);
         if (nvl->safe_to_mmap)
         {
             nvl->all_mappings_revoked = NV_FALSE;
@@ -551,7 +575,7 @@ int nvidia_mmap_helper(
                 ret = nvidia_mmap_numa(vma, mmap_context);
                 if (ret)
                 {
-                    up(&nvl->mmap_lock);
+                    up_write(&nvl->mmap_lock);
                     return ret;
                 }
             }
@@ -560,12 +584,12 @@ int nvidia_mmap_helper(
                 if (nv_io_remap_page_range(vma, mmap_start, mmap_length,
                         remap_prot_extra) != 0)
                 {
-                    up(&nvl->mmap_lock);
+                    up_write(&nvl->mmap_lock);
                     return -EAGAIN;
                 }
             }
         }
-        up(&nvl->mmap_lock);
+        up_write(&nvl->mmap_lock);
 
         vma->vm_flags |= VM_IO | VM_PFNMAP | VM_DONTEXPAND;
     }
@@ -689,9 +713,16 @@ nv_revoke_gpu_mappings_locked(
     nv_linux_state_t *nvl = NV_GET_NVL_FROM_NV_STATE(nv);
     nv_linux_file_private_t *nvlfp;
 
-    /* Revoke all mappings for every open file */
+    /*
+     * Revoke all mappings for every open file. Files that never mapped
+     * anything, or whose mappings are already gone, are skipped so that
+     * they don't pay for the i_mmap lock and the TLB shootdown.
+     */
     list_for_each_entry (nvlfp, &nvl->open_files, entry)
     {
+        if (!mapping_mapped(&nvlfp->mapping))
+            continue;
+
         unmap_mapping_range(&nvlfp->mapping, 0, ~0, 1);
     }
 
@@ -710,11 +741,50 @@ NV_STATUS NV_API_CALL nv_revoke_gpu_mappings(
         return NV_ERR_NOT_SUPPORTED;
     }
 
-    down(&nvl->mmap_lock);
+    down_write(&nvl->mmap_lock);
 
     nv_revoke_gpu_mappings_locked(nv);
 
-    up(&nvl->mmap_lock);
+    up_write(&nvl->mmap_lock);
+
+    return NV_OK;
+}
+
+/*
+ * Revoke the mappings of several GPUs in one call, e.g. when a reset or a
+ * power transition affects a whole group of GPUs. All devices are validated
+ * upfront so that either every GPU gets its mappings revoked or none does.
+ *
+ * The mmap locks are taken one GPU at a time rather than all at once, as
+ * callers revoking overlapping sets of GPUs concurrently would otherwise
+ * need a global lock ordering.
+ */
+NV_STATUS NV_API_CALL nv_revoke_gpu_mappings_multiple(
+    nv_state_t **nvs,
+    NvU32 count
+)
+{
+    NvU32 i;
+
+    for (i = 0; i < count; i++)
+    {
+        // Mapping revocation is only supported for GPU mappings.
+        if ((nvs[i] == NULL) || NV_IS_CTL_DEVICE(nvs[i]))
+        {
+            return NV_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        nv_linux_state_t *nvl = NV_GET_NVL_FROM_NV_STATE(nvs[i]);
+
+        down_write(&nvl->mmap_lock);
+
+        nv_revoke_gpu_mappings_locked(nvs[i]);
+
+        up_write(&nvl->mmap_lock);
+    }
 
     return NV_OK;
 }
@@ -724,7 +794,7 @@ void NV_API_CALL nv_acquire_mmap_lock(
 )
 {
     nv_linux_state_t *nvl = NV_GET_NVL_FROM_NV_STATE(nv);
-    down(&nvl->mmap_lock);
+    down_write(&nvl->mmap_lock);
 }
 
 void NV_API_CALL nv_release_mmap_lock(
@@ -732,7 +802,7 @@ void NV_API_CALL nv_release_mmap_lock(
 )
 {
     nv_linux_state_t *nvl = NV_GET_NVL_FROM_NV_STATE(nv);
-    up(&nvl->mmap_lock);
+    up_write(&nvl->mmap_lock);
 }
 
 NvBool NV_API_CALL nv_get_all_mappings_revoked_locked(
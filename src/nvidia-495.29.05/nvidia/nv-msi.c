@@ -140,6 +140,34 @@ failed:
     NV_DEV_PRINTF(NV_DBG_ERRORS, nv, "Failed to enable MSI-X.\n");
 }
 
+/*
+ * Give each MSI-X vector an affinity hint for a single CPU, picked
+ * round-robin from the online CPUs of the GPU's NUMA node, or from all
+ * online CPUs if the node is unknown or has none online.
+ */
+static void nv_spread_msix_irqs(nv_linux_state_t *nvl)
+{
+    const struct cpumask *mask = cpu_online_mask;
+    int node = dev_to_node(&nvl->pci_dev->dev);
+    unsigned int cpu = nr_cpu_ids;
+    int i;
+
+    if ((node != NUMA_NO_NODE) &&
+        (cpumask_first_and(cpumask_of_node(node), cpu_online_mask) < nr_cpu_ids))
+    {
+        mask = cpumask_of_node(node);
+    }
+
+    for (i = 0; i < nvl->num_intr; i++)
+    {
+        cpu = cpumask_next_and(cpu, mask, cpu_online_mask);
+        if (cpu >= nr_cpu_ids)
+            cpu = cpumask_first_and(mask, cpu_online_mask);
+
+        irq_set_affinity_hint(nvl->msix_entries[i].vector, cpumask_of(cpu));
+    }
+}
+
 NvS32 NV_API_CALL nv_request_msix_irq(nv_linux_state_t *nvl)
 {
     int i;
@@ -158,12 +186,15 @@ NvS32 NV_API_CALL nv_request_msix_irq(nv_linux_state_t *nvl)
         {
             for( j = 0; j < i; j++)
             {
-                free_irq(nvl->msix_entries[i].vector, (void *)nvl);
+                free_irq(nvl->msix_entries[j].vector, (void *)nvl);
             }
             break;
         }
     }
 
+    if ((rc == 0) && NVreg_SpreadMsixInterrupts)
+        nv_spread_msix_irqs(nvl);
+
     return rc;
 }
 #endif
@@ -34,6 +34,14 @@
 typedef struct nv_p2p_dma_mapping {
     struct list_head list_node;
     struct nvidia_p2p_dma_mapping *dma_mapping;
+
+    /*
+     * Number of nvidia_p2p_dma_map_pages() calls the mapping was returned by
+     * and that weren't unmapped yet. Mappings that drop to zero are kept
+     * until the page table is freed, to be reused by the next
+     * nvidia_p2p_dma_map_pages() call for the same peer.
+     */
+    NvU32 refcount;
 } nv_p2p_dma_mapping_t;
 
 typedef struct nv_p2p_mem_info {
@@ -46,6 +54,25 @@ typedef struct nv_p2p_mem_info {
     } dma_mapping_list;
 } nv_p2p_mem_info_t;
 
+/*
+ * ioremap()ed rsync registers shared by all nvidia_p2p_rsync_reg_info_t
+ * handed out by nvidia_p2p_get_rsync_registers(), so that clients asking for
+ * the registers at every connection setup don't map them again each time.
+ * The list is protected by the nv_linux_devices lock.
+ */
+typedef struct nv_p2p_rsync_mapping {
+    struct list_head list_node;
+    struct pci_dev *gpu;
+    NvU64 addr;
+    NvU64 size;
+    void *ptr;
+
+    /* Number of outstanding reg info entries using the mapping */
+    NvU32 refcount;
+} nv_p2p_rsync_mapping_t;
+
+static LIST_HEAD(nv_p2p_rsync_mappings);
+
 // declared and created in nv.c
 extern void *nvidia_p2p_page_t_cache;
 
@@ -124,6 +151,7 @@ static NV_STATUS nv_p2p_insert_dma_mapping(
     down(&mem_info->dma_mapping_list.lock);
 
     node->dma_mapping = dma_mapping;
+    node->refcount = 1;
     list_add_tail(&node->list_node, &mem_info->dma_mapping_list.list_head);
 
     up(&mem_info->dma_mapping_list.lock);
@@ -157,6 +185,61 @@ static struct nvidia_p2p_dma_mapping* nv_p2p_remove_dma_mapping(
     return ret_dma_mapping;
 }
 
+/*
+ * Take a reference on a mapping of the page table for the given peer, if one
+ * exists.
+ */
+static struct nvidia_p2p_dma_mapping* nv_p2p_get_dma_mapping(
+    struct nv_p2p_mem_info *mem_info,
+    struct pci_dev *peer
+)
+{
+    struct nv_p2p_dma_mapping *cur;
+    struct nvidia_p2p_dma_mapping *ret_dma_mapping = NULL;
+
+    down(&mem_info->dma_mapping_list.lock);
+
+    list_for_each_entry(cur, &mem_info->dma_mapping_list.list_head, list_node)
+    {
+        if (cur->dma_mapping->pci_dev == peer)
+        {
+            cur->refcount++;
+            ret_dma_mapping = cur->dma_mapping;
+            break;
+        }
+    }
+
+    up(&mem_info->dma_mapping_list.lock);
+
+    return ret_dma_mapping;
+}
+
+/*
+ * Drop a reference taken by nvidia_p2p_dma_map_pages(). The mapping itself
+ * stays cached until the page table is freed.
+ */
+static void nv_p2p_put_dma_mapping(
+    struct nv_p2p_mem_info *mem_info,
+    struct nvidia_p2p_dma_mapping *dma_mapping
+)
+{
+    struct nv_p2p_dma_mapping *cur;
+
+    down(&mem_info->dma_mapping_list.lock);
+
+    list_for_each_entry(cur, &mem_info->dma_mapping_list.list_head, list_node)
+    {
+        if (cur->dma_mapping == dma_mapping)
+        {
+            if (cur->refcount > 0)
+                cur->refcount--;
+            break;
+        }
+    }
+
+    up(&mem_info->dma_mapping_list.lock);
+}
+
 static void nv_p2p_free_dma_mapping(
     struct nvidia_p2p_dma_mapping *dma_mapping
 )
@@ -192,6 +275,8 @@ static void nv_p2p_free_dma_mapping(
 
     os_free_mem(dma_mapping->dma_addresses);
 
+    pci_dev_put(dma_mapping->pci_dev);
+
     os_free_mem(dma_mapping);
 }
 
@@ -592,13 +677,19 @@ int nvidia_p2p_dma_map_pages(
 
     mem_info = container_of(page_table, nv_p2p_mem_info_t, page_table);
 
+    // Reuse the existing mapping for this peer, if any
+    *dma_mapping = nv_p2p_get_dma_mapping(mem_info, peer);
+    if (*dma_mapping != NULL)
+    {
+        return 0;
+    }
+
     rc = nv_kmem_cache_alloc_stack(&sp);
     if (rc != 0)
     {
         return rc;
     }
 
-    *dma_mapping = NULL;
     status = os_alloc_mem((void **)dma_mapping, sizeof(**dma_mapping));
     if (status != NV_OK)
     {
@@ -642,7 +733,7 @@ int nvidia_p2p_dma_map_pages(
     (*dma_mapping)->entries = page_count;
     (*dma_mapping)->dma_addresses = dma_addresses;
     (*dma_mapping)->private = priv;
-    (*dma_mapping)->pci_dev = peer;
+    (*dma_mapping)->pci_dev = pci_dev_get(peer);
 
     /*
      * All success, it is safe to insert dma_mapping now.
@@ -697,24 +788,14 @@ int nvidia_p2p_dma_unmap_pages(
     mem_info = container_of(page_table, nv_p2p_mem_info_t, page_table);
 
     /*
-     * nv_p2p_remove_dma_mapping returns dma_mapping if the dma_mapping was
-     * found and got unlinked from the mem_info->dma_mapping_list (atomically).
-     * This ensures that the RM's tear-down path does not race with this path.
+     * The mapping is only dropped from the mem_info->dma_mapping_list, and
+     * unmapped, when the page table is freed. This lets repeated
+     * nvidia_p2p_dma_map_pages() calls for the same peer reuse it.
      *
-     * nv_p2p_remove_dma_mappings returns NULL if the dma_mapping was already
-     * unlinked.
+     * If the RM's tear-down path already freed the page table's mappings,
+     * dma_mapping is no longer in the list and this is a no-op.
      */
-    if (nv_p2p_remove_dma_mapping(mem_info, dma_mapping) == NULL)
-    {
-        return 0;
-    }
-
-    WARN_ON(peer != dma_mapping->pci_dev);
-
-    BUG_ON((dma_mapping->page_size_type <= NVIDIA_P2P_PAGE_SIZE_4KB) ||
-           (dma_mapping->page_size_type >= NVIDIA_P2P_PAGE_SIZE_COUNT));
-
-    nv_p2p_free_dma_mapping(dma_mapping);
+    nv_p2p_put_dma_mapping(mem_info, dma_mapping);
 
     return 0;
 }
@@ -797,6 +878,80 @@ void nvidia_p2p_unregister_rsync_driver(
 
 EXPORT_SYMBOL(nvidia_p2p_unregister_rsync_driver);
 
+/* Must be called with the nv_linux_devices lock held. */
+static void *nv_p2p_rsync_mapping_retain(
+    struct pci_dev *gpu,
+    NvU64 addr,
+    NvU64 size
+)
+{
+    nv_p2p_rsync_mapping_t *mapping;
+    NV_STATUS status;
+
+    list_for_each_entry(mapping, &nv_p2p_rsync_mappings, list_node)
+    {
+        if ((mapping->gpu == gpu) &&
+            (mapping->addr == addr) &&
+            (mapping->size == size))
+        {
+            mapping->refcount++;
+            return mapping->ptr;
+        }
+    }
+
+    status = os_alloc_mem((void**)&mapping, sizeof(*mapping));
+    if (status != NV_OK)
+    {
+        return NULL;
+    }
+
+    mapping->ptr = nv_ioremap_nocache(addr, size);
+    if (mapping->ptr == NULL)
+    {
+        os_free_mem(mapping);
+        return NULL;
+    }
+
+    mapping->gpu = gpu;
+    mapping->addr = addr;
+    mapping->size = size;
+    mapping->refcount = 1;
+
+    list_add(&mapping->list_node, &nv_p2p_rsync_mappings);
+
+    return mapping->ptr;
+}
+
+/* Must be called with the nv_linux_devices lock held. */
+static void nv_p2p_rsync_mapping_release(
+    void *ptr,
+    size_t size
+)
+{
+    nv_p2p_rsync_mapping_t *mapping;
+
+    list_for_each_entry(mapping, &nv_p2p_rsync_mappings, list_node)
+    {
+        if (mapping->ptr == ptr)
+        {
+            WARN_ON(mapping->refcount == 0);
+
+            if (--mapping->refcount == 0)
+            {
+                list_del(&mapping->list_node);
+                nv_iounmap(mapping->ptr, mapping->size);
+                os_free_mem(mapping);
+            }
+
+            return;
+        }
+    }
+
+    /* Not a cached mapping, this should not happen */
+    WARN_ON(1);
+    nv_iounmap(ptr, size);
+}
+
 int nvidia_p2p_get_rsync_registers(
     nvidia_p2p_rsync_reg_info_t **reg_info
 )
@@ -856,7 +1011,7 @@ int nvidia_p2p_get_rsync_registers(
             continue;
         }
 
-        ptr = nv_ioremap_nocache(addr, size);
+        ptr = nv_p2p_rsync_mapping_retain(nvl->pci_dev, addr, size);
         if (ptr == NULL)
         {
             continue;
@@ -904,16 +1059,20 @@ void nvidia_p2p_put_rsync_registers(
 
     if (reg_info->regs)
     {
+        LOCK_NV_LINUX_DEVICES();
+
         for (i = 0; i < reg_info->entries; i++)
         {
             regs = &reg_info->regs[i];
 
             if (regs->ptr)
             {
-                nv_iounmap(regs->ptr, regs->size);
+                nv_p2p_rsync_mapping_release(regs->ptr, regs->size);
             }
         }
 
+        UNLOCK_NV_LINUX_DEVICES();
+
         os_free_mem(reg_info->regs);
     }
 
@@ -80,12 +80,6 @@ static void nv_setup_pat_entries(void *info)
     unsigned long pat1, pat2, cr4;
     unsigned long eflags;
 
-#if defined(NV_ENABLE_HOTPLUG_CPU)
-    int cpu = (NvUPtr)info;
-    if ((cpu != 0) && (cpu != (int)smp_processor_id()))
-        return;
-#endif
-
     NV_SAVE_FLAGS(eflags);
     NV_CLI();
     nv_disable_caches(&cr4);
@@ -106,12 +100,6 @@ static void nv_restore_pat_entries(void *info)
     unsigned long cr4;
     unsigned long eflags;
 
-#if defined(NV_ENABLE_HOTPLUG_CPU)
-    int cpu = (NvUPtr)info;
-    if ((cpu != 0) && (cpu != (int)smp_processor_id()))
-        return;
-#endif
-
     NV_SAVE_FLAGS(eflags);
     NV_CLI();
     nv_disable_caches(&cr4);
@@ -145,6 +133,11 @@ static void nv_restore_pat_entries(void *info)
  * are present, we still use register_cpu_notifier().
  */
 
+/*
+ * Only the CPU going online or offline needs its PAT updated, so target it
+ * alone rather than interrupting every other CPU. With cpuhp_setup_state()
+ * the callbacks already run on that CPU; CPU notifiers run elsewhere.
+ */
 static int
 nvidia_cpu_teardown(unsigned int cpu)
 {
@@ -154,7 +147,7 @@ nvidia_cpu_teardown(unsigned int cpu)
     if (this_cpu == cpu)
         nv_restore_pat_entries(NULL);
     else
-        smp_call_function(nv_restore_pat_entries, &cpu, 1);
+        smp_call_function_single(cpu, nv_restore_pat_entries, NULL, 1);
 
     put_cpu();
 #endif
@@ -170,7 +163,7 @@ nvidia_cpu_online(unsigned int cpu)
     if (this_cpu == cpu)
         nv_setup_pat_entries(NULL);
     else
-        smp_call_function(nv_setup_pat_entries, &cpu, 1);
+        smp_call_function_single(cpu, nv_setup_pat_entries, NULL, 1);
 
     put_cpu();
 #endif
@@ -218,6 +218,50 @@ static void nv_init_dynamic_power_management
 
 
 
+
+/*
+ * Count the supported devices, in the order the PCI core enumerates them,
+ * that come before 'stop', or all of them if 'stop' is NULL.
+ */
+static int
+nv_pci_count_devices_before(struct pci_dev *stop, NvBool print_legacy_warning)
+{
+    static const unsigned int classes[] = {
+        PCI_CLASS_DISPLAY_VGA,
+        PCI_CLASS_DISPLAY_3D
+    };
+    struct pci_dev *pci_dev;
+    int count = 0;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(classes); i++)
+    {
+        pci_dev = pci_get_class(classes[i] << 8, NULL);
+        while (pci_dev)
+        {
+            if (pci_dev == stop)
+            {
+                pci_dev_put(pci_dev);
+                return count;
+            }
+
+            if (rm_is_supported_pci_device(
+                    (pci_dev->class >> 16) & 0xFF,
+                    (pci_dev->class >> 8) & 0xFF,
+                    pci_dev->vendor,
+                    pci_dev->device,
+                    pci_dev->subsystem_vendor,
+                    pci_dev->subsystem_device,
+                    print_legacy_warning))
+            {
+                count++;
+            }
+            pci_dev = pci_get_class(classes[i] << 8, pci_dev);
+        }
+    }
+
+    return count;
+}
 
 /* find nvidia devices and set initial state */
 static int
@@ -306,7 +350,9 @@ nv_pci_probe
         goto failed;
     }
 
+    LOCK_NV_LINUX_DEVICES();
     num_probed_nv_devices++;
+    UNLOCK_NV_LINUX_DEVICES();
 
     if (pci_enable_device(pci_dev) != 0)
     {
@@ -437,6 +483,16 @@ next_bar:
 
     os_mem_set(nvl, 0, sizeof(nv_linux_state_t));
 
+    //
+    // Asynchronous probes complete in any order. Ask the frontend for the
+    // minor number matching the device's position on the bus, so minor
+    // numbers stay the same from boot to boot.
+    //
+    if (NVreg_EnableAsyncProbe)
+    {
+        nvl->minor_num = nv_pci_count_devices_before(pci_dev, NV_FALSE);
+    }
+
     nv  = NV_STATE_PTR(nvl);
 
     pci_set_drvdata(pci_dev, (void *)nvl);
@@ -469,6 +525,7 @@ next_bar:
     nvl->safe_to_mmap = NV_TRUE;
     nvl->gpu_wakeup_callback_needed = NV_TRUE;
     INIT_LIST_HEAD(&nvl->open_files);
+    nv_idle_linger_init(nvl);
 
     for (i = 0, j = 0; i < NVRM_PCICFG_NUM_BARS && j < NV_GPU_NUM_BARS; i++)
     {
@@ -556,8 +613,6 @@ next_bar:
               PCI_FUNC(pci_dev->devfn), nv->pci_info.vendor_id, nv->pci_info.device_id,
               nv->fb->cpu_address, (nv->fb->size >> 20));
 
-    num_nv_devices++;
-
     /*
      * The newly created nvl object is added to the nv_linux_devices global list
      * only after all the initialization operations for that nvl object are
@@ -566,6 +621,8 @@ next_bar:
      */
     LOCK_NV_LINUX_DEVICES();
 
+    num_nv_devices++;
+
     nv_linux_add_device_locked(nvl);
 
     UNLOCK_NV_LINUX_DEVICES();
@@ -657,6 +714,16 @@ nv_pci_remove(struct pci_dev *pci_dev)
         return;
     }
 
+    /*
+     * Stop a lingering device, and keep it from lingering again, before
+     * taking the locks: the linger callback takes nvl->ldata_lock.
+     */
+    nvl = pci_get_drvdata(pci_dev);
+    if ((nvl != NULL) && (nvl->pci_dev == pci_dev))
+    {
+        nv_idle_linger_stop(nvl, sp);
+    }
+
     LOCK_NV_LINUX_DEVICES();
     nvl = pci_get_drvdata(pci_dev);
     if (!nvl || (nvl->pci_dev != pci_dev))
@@ -911,49 +978,12 @@ NvU8 nv_find_pci_capability(struct pci_dev *pci_dev, NvU8 capability)
 int
 nv_pci_count_devices(void)
 {
-    struct pci_dev *pci_dev;
-    int count = 0;
-
     if (NVreg_RegisterPCIDriver == 0)
     {
         return 0;
     }
 
-    pci_dev = pci_get_class(PCI_CLASS_DISPLAY_VGA << 8, NULL);
-    while (pci_dev)
-    {
-        if (rm_is_supported_pci_device(
-                PCI_BASE_CLASS_DISPLAY,
-                PCI_CLASS_DISPLAY_VGA & 0xFF,
-                pci_dev->vendor,
-                pci_dev->device,
-                pci_dev->subsystem_vendor,
-                pci_dev->subsystem_device,
-                NV_TRUE /* print_legacy_warning */))
-        {
-            count++;
-        }
-        pci_dev = pci_get_class(PCI_CLASS_DISPLAY_VGA << 8, pci_dev);
-    }
-
-    pci_dev = pci_get_class(PCI_CLASS_DISPLAY_3D << 8, NULL);
-    while (pci_dev)
-    {
-        if (rm_is_supported_pci_device(
-                (pci_dev->class >> 16) & 0xFF,
-                (pci_dev->class >> 8) & 0xFF,
-                pci_dev->vendor,
-                pci_dev->device,
-                pci_dev->subsystem_vendor,
-                pci_dev->subsystem_device,
-                NV_TRUE /* print_legacy_warning */))
-        {
-            count++;
-        }
-        pci_dev = pci_get_class(PCI_CLASS_DISPLAY_3D << 8, pci_dev);
-    }
-
-    return count;
+    return nv_pci_count_devices_before(NULL, NV_TRUE);
 }
 
 #if defined(NV_PCI_ERROR_RECOVERY)
@@ -1080,5 +1110,13 @@ int nv_pci_register_driver(void)
     {
         return 0;
     }
+
+#if defined(NV_DEVICE_DRIVER_HAS_PROBE_TYPE)
+    if (NVreg_EnableAsyncProbe)
+    {
+        nv_pci_driver.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS;
+    }
+#endif
+
     return pci_register_driver(&nv_pci_driver);
 }
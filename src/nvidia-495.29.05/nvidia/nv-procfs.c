@@ -257,6 +257,30 @@ nv_procfs_read_version(
 
 NV_DEFINE_SINGLE_NVRM_PROCFS_FILE(version);
 
+static int
+nv_procfs_read_alloc_caches(
+    struct seq_file *s,
+    void *v
+)
+{
+    unsigned int i;
+    NvU32 size;
+    NvU64 allocs, frees;
+
+    seq_printf(s, "%10s %20s %20s %12s\n", "Size", "Allocations", "Frees",
+               "In use");
+
+    for (i = 0; nv_os_alloc_cache_get_stats(i, &size, &allocs, &frees); i++)
+    {
+        seq_printf(s, "%10u %20llu %20llu %12lld\n", size, allocs, frees,
+                   (long long)(allocs - frees));
+    }
+
+    return 0;
+}
+
+NV_DEFINE_SINGLE_NVRM_PROCFS_FILE(alloc_caches);
+
 static void
 nv_procfs_close_file(
     nv_procfs_private_t *nvpp
@@ -907,6 +931,9 @@ nv_procfs_close_unbind_lock(
         down(&nvl->ldata_lock);
         if ((value == 1) && !(nv->flags & NV_FLAG_UNBIND_LOCK))
         {
+            /* A lingering device has no clients left; stop it first */
+            nv_idle_linger_end_locked(nvl, sp);
+
             if (NV_ATOMIC_READ(nvl->usage_count) == 0)
                 rm_unbind_lock(sp, nv);
 
@@ -1379,6 +1406,14 @@ int nv_procfs_init(void)
     if (!entry)
         goto failed;
 
+    if (NVreg_EnableOsAllocCaches)
+    {
+        entry = NV_CREATE_PROC_FILE("alloc_caches", proc_nvidia, alloc_caches,
+                                    NULL);
+        if (!entry)
+            goto failed;
+    }
+
     proc_nvidia_gpus = NV_CREATE_PROC_DIR("gpus", proc_nvidia);
     if (!proc_nvidia_gpus)
         goto failed;
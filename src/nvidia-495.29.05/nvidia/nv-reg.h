@@ -773,6 +773,183 @@
 #define NV_REG_ENABLE_GPU_FIRMWARE_DEFAULT_VALUE          0x00000012
 #define NV_REG_ENABLE_GPU_FIRMWARE_INVALID_VALUE          0xFFFFFFFF
 
+/*
+ * Option: EnableParallelDevicePowerManagement
+ *
+ * Description:
+ *
+ * When this option is enabled, the per-device steps of system power
+ * management transitions initiated through the driver procfs interface
+ * (preempting and restoring user channels, suspending and resuming each
+ * device) are run concurrently on a temporary kernel thread per device,
+ * instead of one device after the other. This reduces the suspend and
+ * resume latency on systems with several GPUs.
+ *
+ * Possible values:
+ *  0 - Transition the devices one after the other (default)
+ *  1 - Transition the devices concurrently
+ */
+#define __NV_ENABLE_PARALLEL_DEVICE_POWER_MANAGEMENT EnableParallelDevicePowerManagement
+#define NV_REG_ENABLE_PARALLEL_DEVICE_POWER_MANAGEMENT \
+    NV_REG_STRING(__NV_ENABLE_PARALLEL_DEVICE_POWER_MANAGEMENT)
+
+/*
+ * Option: EnableHugeSysmemAllocations
+ *
+ * Description:
+ *
+ * When this option is enabled, non-contiguous system memory allocations
+ * of at least one PMD worth of memory (2MB on x86_64) are backed by
+ * PMD-sized compound pages where the kernel can provide them, falling back
+ * to smaller chunks otherwise. This greatly reduces the number of page
+ * allocations needed for large pinned host buffers and keeps them
+ * physically contiguous in large chunks.
+ *
+ * Possible values:
+ *  0 - Allocate chunks of at most PAGE_ALLOC_COSTLY_ORDER (default)
+ *  1 - Allocate PMD-sized chunks when possible
+ */
+#define __NV_ENABLE_HUGE_SYSMEM_ALLOCATIONS EnableHugeSysmemAllocations
+#define NV_REG_ENABLE_HUGE_SYSMEM_ALLOCATIONS \
+    NV_REG_STRING(__NV_ENABLE_HUGE_SYSMEM_ALLOCATIONS)
+
+/*
+ * Option: UncachedSysmemPoolSize
+ *
+ * Description:
+ *
+ * Uncached and write-combined system memory allocations require changing
+ * the caching attributes of the kernel mapping of their pages, both when
+ * they are allocated and when they are freed. Each change flushes caches
+ * and TLBs on all CPUs. This option sets the size, in megabytes, of a pool
+ * of pages kept in the uncached state when such allocations are freed, and
+ * reused by later ones without changing their attributes again.
+ *
+ * Possible values:
+ *  0 - Don't pool uncached pages (default)
+ *  N - Pool up to N megabytes of uncached pages
+ */
+#define __NV_UNCACHED_SYSMEM_POOL_SIZE UncachedSysmemPoolSize
+#define NV_REG_UNCACHED_SYSMEM_POOL_SIZE \
+    NV_REG_STRING(__NV_UNCACHED_SYSMEM_POOL_SIZE)
+
+/*
+ * Option: MmapFaultAroundSize
+ *
+ * Description:
+ *
+ * GPU mappings that were revoked, e.g. while the GPU was powered down, are
+ * restored on fault. By default, a fault maps the whole VMA it hits, which
+ * can take long for large mappings. This option sets the size, in
+ * kilobytes, of the naturally aligned window around the faulting address
+ * that is mapped instead. The rest of the VMA is mapped when it is
+ * accessed.
+ *
+ * Possible values:
+ *  0 - Map the whole VMA on fault (default)
+ *  N - Map the N KB aligned window containing the faulting address
+ */
+#define __NV_MMAP_FAULT_AROUND_SIZE MmapFaultAroundSize
+#define NV_REG_MMAP_FAULT_AROUND_SIZE \
+    NV_REG_STRING(__NV_MMAP_FAULT_AROUND_SIZE)
+
+/*
+ * Option: SpreadMsixInterrupts
+ *
+ * Description:
+ *
+ * When MSI-X is used, the GPU's interrupt vectors are left to the kernel
+ * (or irqbalance) to place, and can end up on CPUs far from the GPU.
+ * When this option is enabled, each vector is given an affinity hint for
+ * its own CPU, picked round-robin from the online CPUs of the GPU's NUMA
+ * node. The threaded bottom half of a vector follows its affinity, so it
+ * then runs on the CPU that took the interrupt.
+ *
+ * Possible values:
+ *  0 - Leave MSI-X vector placement to the kernel (default)
+ *  1 - Spread MSI-X vectors across the CPUs local to the GPU
+ */
+#define __NV_SPREAD_MSIX_INTERRUPTS SpreadMsixInterrupts
+#define NV_REG_SPREAD_MSIX_INTERRUPTS \
+    NV_REG_STRING(__NV_SPREAD_MSIX_INTERRUPTS)
+
+/*
+ * Option: EnableOsAllocCaches
+ *
+ * Description:
+ *
+ * When this option is enabled, small internal allocations made by the
+ * resource manager are served from dedicated, size-bucketed slab caches
+ * instead of the kernel's generic kmalloc caches. Per-cache allocation
+ * statistics are reported in /proc/driver/nvidia/alloc_caches.
+ *
+ * Possible values:
+ *  0 - Use the generic kmalloc caches (default)
+ *  1 - Use dedicated allocation caches
+ */
+#define __NV_ENABLE_OS_ALLOC_CACHES EnableOsAllocCaches
+#define NV_REG_ENABLE_OS_ALLOC_CACHES \
+    NV_REG_STRING(__NV_ENABLE_OS_ALLOC_CACHES)
+
+/*
+ * Option: EnableAsyncProbe
+ *
+ * Description:
+ *
+ * By default, the kernel probes NVIDIA GPUs one at a time when the driver
+ * is loaded. When this option is enabled, the GPUs are probed in
+ * parallel, which shortens module load on systems with many GPUs. Device
+ * minor numbers and the order of the driver's device list still follow
+ * the PCI topology, so they don't depend on the order the probes complete
+ * in. Requires Linux 4.2 or newer; ignored on older kernels.
+ *
+ * Possible values:
+ *  0 - Probe GPUs one at a time (default)
+ *  1 - Probe GPUs in parallel
+ */
+#define __NV_ENABLE_ASYNC_PROBE EnableAsyncProbe
+#define NV_REG_ENABLE_ASYNC_PROBE NV_REG_STRING(__NV_ENABLE_ASYNC_PROBE)
+
+/*
+ * Option: GpuIdleLingerTime
+ *
+ * Description:
+ *
+ * By default, a GPU is torn down when its last client closes it, and
+ * fully initialized again when the next client opens it. Workloads made
+ * of many short-lived jobs pay that cost on every job unless a
+ * persistence daemon keeps the GPU open. This option sets the time, in
+ * seconds, a GPU is kept initialized after its last client closes it. An
+ * open during that time reuses the initialized GPU. The GPU is kept
+ * powered on while it lingers.
+ *
+ * Possible values:
+ *  0 - Tear the GPU down on last close (default)
+ *  N - Keep the GPU initialized for N seconds after last close
+ */
+#define __NV_GPU_IDLE_LINGER_TIME GpuIdleLingerTime
+#define NV_REG_GPU_IDLE_LINGER_TIME NV_REG_STRING(__NV_GPU_IDLE_LINGER_TIME)
+
+/*
+ * Option: CoalesceRcTimers
+ *
+ * Description:
+ *
+ * By default, every GPU arms its own one second timer to run the RC
+ * watchdog, so a system with many GPUs wakes up once per GPU every
+ * second, on whatever CPUs the timers happen to be queued on. When this
+ * option is enabled, the watchdog checks of all GPUs run from a single
+ * deferrable timer, queued on a CPU local to the GPUs. The timer does not
+ * wake up idle CPUs, so the checks may be delayed while the system is
+ * idle.
+ *
+ * Possible values:
+ *  0 - Use one timer per GPU (default)
+ *  1 - Use one deferrable timer for all GPUs
+ */
+#define __NV_COALESCE_RC_TIMERS CoalesceRcTimers
+#define NV_REG_COALESCE_RC_TIMERS NV_REG_STRING(__NV_COALESCE_RC_TIMERS)
+
 
 #if defined(NV_DEFINE_REGISTRY_KEY_TABLE)
 
@@ -810,6 +987,15 @@ NV_DEFINE_REG_ENTRY_GLOBAL(__NV_VMALLOC_HEAP_MAX_SIZE, 0);
 NV_DEFINE_REG_ENTRY_GLOBAL(__NV_IGNORE_MMIO_CHECK, 0);
 NV_DEFINE_REG_ENTRY_GLOBAL(__NV_NVLINK_DISABLE, 0);
 NV_DEFINE_REG_ENTRY_GLOBAL(__NV_ENABLE_PCIE_RELAXED_ORDERING_MODE, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_ENABLE_PARALLEL_DEVICE_POWER_MANAGEMENT, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_ENABLE_HUGE_SYSMEM_ALLOCATIONS, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_UNCACHED_SYSMEM_POOL_SIZE, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_MMAP_FAULT_AROUND_SIZE, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_SPREAD_MSIX_INTERRUPTS, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_ENABLE_OS_ALLOC_CACHES, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_ENABLE_ASYNC_PROBE, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_GPU_IDLE_LINGER_TIME, 0);
+NV_DEFINE_REG_ENTRY_GLOBAL(__NV_COALESCE_RC_TIMERS, 0);
 
 
 
@@ -866,6 +1052,15 @@ nv_parm_t nv_parms[] = {
     NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_REGISTER_PCI_DRIVER),
     NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_ENABLE_PCIE_RELAXED_ORDERING_MODE),
     NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_ENABLE_GPU_FIRMWARE),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_ENABLE_PARALLEL_DEVICE_POWER_MANAGEMENT),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_ENABLE_HUGE_SYSMEM_ALLOCATIONS),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_UNCACHED_SYSMEM_POOL_SIZE),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_MMAP_FAULT_AROUND_SIZE),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_SPREAD_MSIX_INTERRUPTS),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_ENABLE_OS_ALLOC_CACHES),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_ENABLE_ASYNC_PROBE),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_GPU_IDLE_LINGER_TIME),
+    NV_DEFINE_PARAMS_TABLE_ENTRY(__NV_COALESCE_RC_TIMERS),
     {NULL, NULL}
 };
 
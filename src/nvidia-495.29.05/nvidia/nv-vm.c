@@ -148,7 +148,16 @@ static inline void nv_set_contig_memory_type(
     }
 }
 
-static inline void nv_set_memory_type(nv_alloc_t *at, NvU32 type)
+/*
+ * Set the cache type of the num_pages pages of at->page_table starting at
+ * index first.
+ */
+static inline void nv_set_memory_type(
+    nv_alloc_t *at,
+    NvU32 first,
+    NvU32 num_pages,
+    NvU32 type
+)
 {
     NvU32 i;
     NV_STATUS status = NV_OK;
@@ -163,16 +172,19 @@ static inline void nv_set_memory_type(nv_alloc_t *at, NvU32 type)
     nvidia_pte_t *page_ptr;
     struct page *page;
 
+    if (num_pages == 0)
+        return;
+
     if (nv_set_memory_array_type_present(type))
     {
         status = os_alloc_mem((void **)&pages,
-                at->num_pages * sizeof(unsigned long));
+                num_pages * sizeof(unsigned long));
 
     }
     else if (nv_set_pages_array_type_present(type))
     {
         status = os_alloc_mem((void **)&pages,
-                at->num_pages * sizeof(struct page*));
+                num_pages * sizeof(struct page*));
     }
 
     if (status != NV_OK)
@@ -185,9 +197,9 @@ static inline void nv_set_memory_type(nv_alloc_t *at, NvU32 type)
     //
     if (pages)
     {
-        for (i = 0; i < at->num_pages; i++)
+        for (i = 0; i < num_pages; i++)
         {
-            page_ptr = at->page_table[i];
+            page_ptr = at->page_table[first + i];
             page = NV_GET_PAGE_STRUCT(page_ptr->phys_addr);
 #if defined(NV_SET_MEMORY_ARRAY_UC_PRESENT)
             pages[i] = (unsigned long)page_address(page);
@@ -196,22 +208,37 @@ static inline void nv_set_memory_type(nv_alloc_t *at, NvU32 type)
 #endif
         }
 #if defined(NV_SET_MEMORY_ARRAY_UC_PRESENT)
-        nv_set_memory_array_type(pages, at->num_pages, type);
+        nv_set_memory_array_type(pages, num_pages, type);
 #elif defined(NV_SET_PAGES_ARRAY_UC_PRESENT)
-        nv_set_pages_array_type(pages, at->num_pages, type);
+        nv_set_pages_array_type(pages, num_pages, type);
 #endif
         os_free_mem(pages);
     }
 
     //
     // If the set_{memory,page}_array_* functions aren't present in the kernel
-    // interface, each page has to be set individually, which has been measured
-    // to be ~10x slower than using the set_{memory,page}_array_* functions.
+    // interface, each physically contiguous range has to be set individually,
+    // which has been measured to be ~10x slower than using the
+    // set_{memory,page}_array_* functions when the ranges are single pages.
+    // nv_alloc_system_pages() mostly hands out multi-page compound pages, so
+    // coalesce the ranges to keep the number of calls down.
     //
     else
     {
-        for (i = 0; i < at->num_pages; i++)
-            nv_set_contig_memory_type(at->page_table[i], 1, type);
+        NvU32 start = first;
+
+        for (i = first + 1; i <= first + num_pages; i++)
+        {
+            if ((i < first + num_pages) &&
+                (at->page_table[i]->phys_addr ==
+                 at->page_table[i - 1]->phys_addr + PAGE_SIZE))
+            {
+                continue;
+            }
+
+            nv_set_contig_memory_type(at->page_table[start], i - start, type);
+            start = i;
+        }
     }
 }
 
@@ -228,6 +255,25 @@ static NvU64 nv_get_max_sysmem_address(void)
     return ((global_max_pfn + 1) << PAGE_SHIFT) - 1;
 }
 
+/*
+ * Returns the node to allocate the backing pages of at from: node 0 when the
+ * allocation requires it, otherwise the node of the device the allocation is
+ * for, so that its DMA stays socket-local. Only node 0 is a hard requirement,
+ * other nodes are preferences the page allocator may fall back from.
+ * NUMA_NO_NODE leaves the choice, including the task's mempolicy, to the
+ * kernel.
+ */
+static int nv_alloc_get_node(nv_alloc_t *at)
+{
+    if (at->flags.node0)
+        return 0;
+
+    if (at->dev != NULL)
+        return dev_to_node(at->dev);
+
+    return NUMA_NO_NODE;
+}
+
 static unsigned int nv_compute_gfp_mask(
     nv_state_t *nv,
     nv_alloc_t *at
@@ -363,7 +409,7 @@ NV_STATUS nv_alloc_contig_pages(
 {
     NV_STATUS status;
     nvidia_pte_t *page_ptr;
-    NvU32 i, j;
+    NvU32 i;
     unsigned int gfp_mask;
     unsigned long virt_addr = 0;
     NvU64 phys_addr;
@@ -379,9 +425,9 @@ NV_STATUS nv_alloc_contig_pages(
     at->order = get_order(at->num_pages * PAGE_SIZE);
     gfp_mask = nv_compute_gfp_mask(nv, at);
 
-    if (at->flags.node0)
+    if (nv_alloc_get_node(at) != NUMA_NO_NODE)
     {
-        NV_ALLOC_PAGES_NODE(virt_addr, 0, at->order, gfp_mask);
+        NV_ALLOC_PAGES_NODE(virt_addr, nv_alloc_get_node(at), at->order, gfp_mask);
     }
     else
     {
@@ -407,22 +453,27 @@ NV_STATUS nv_alloc_contig_pages(
         memset((void *)virt_addr, 0, (at->num_pages * PAGE_SIZE));
 #endif
 
-    for (i = 0; i < at->num_pages; i++, virt_addr += PAGE_SIZE)
+    //
+    // The buffer is a single high-order allocation from the kernel's direct
+    // map, so it is physically contiguous. Translate its base address once
+    // and derive the address of every page from it.
+    //
+    phys_addr = nv_get_kern_phys_address(virt_addr);
+    if (phys_addr == 0)
     {
-        phys_addr = nv_get_kern_phys_address(virt_addr);
-        if (phys_addr == 0)
-        {
-            nv_printf(NV_DBG_ERRORS,
-                "NVRM: VM: %s: failed to look up physical address\n",
-                __FUNCTION__);
-            status = NV_ERR_OPERATING_SYSTEM;
-            goto failed;
-        }
+        nv_printf(NV_DBG_ERRORS,
+            "NVRM: VM: %s: failed to look up physical address\n",
+            __FUNCTION__);
+        NV_FREE_PAGES(virt_addr, at->order);
+        return NV_ERR_OPERATING_SYSTEM;
+    }
 
+    for (i = 0; i < at->num_pages; i++)
+    {
         page_ptr = at->page_table[i];
-        page_ptr->phys_addr = phys_addr;
+        page_ptr->phys_addr = phys_addr + i * PAGE_SIZE;
         page_ptr->page_count = NV_GET_PAGE_COUNT(page_ptr);
-        page_ptr->virt_addr = virt_addr;
+        page_ptr->virt_addr = virt_addr + i * PAGE_SIZE;
         page_ptr->dma_addr = nv_phys_to_dma(dev, page_ptr->phys_addr);
 
         NV_MAYBE_RESERVE_PAGE(page_ptr);
@@ -438,18 +489,6 @@ NV_STATUS nv_alloc_contig_pages(
     at->flags.coherent = NV_FALSE;
 
     return NV_OK;
-
-failed:
-    if (i > 0)
-    {
-        for (j = 0; j < i; j++)
-            NV_MAYBE_UNRESERVE_PAGE(at->page_table[j]);
-    }
-
-    page_ptr = at->page_table[0];
-    NV_FREE_PAGES(page_ptr->virt_addr, at->order);
-
-    return status;
 }
 
 void nv_free_contig_pages(
@@ -495,6 +534,392 @@ void nv_free_contig_pages(
     NV_FREE_PAGES(page_ptr->virt_addr, at->order);
 }
 
+/*
+ * nv_alloc_system_pages() backs allocations with compound pages of up to
+ * NV_SYSMEM_CHUNK_ORDER, which the page allocator hands out cheaply, or of up
+ * to one PMD worth of memory when NVreg_EnableHugeSysmemAllocations is set.
+ */
+#define NV_SYSMEM_CHUNK_ORDER   PAGE_ALLOC_COSTLY_ORDER
+#define NV_SYSMEM_HUGE_ORDER    (PMD_SHIFT - PAGE_SHIFT)
+
+static unsigned int nv_get_system_pages_max_order(
+    nv_alloc_t *at
+)
+{
+    unsigned int order = NV_SYSMEM_CHUNK_ORDER;
+
+    //
+    // With AMD SEV, chunks come from dma_alloc_coherent(), which changes the
+    // encryption attribute of each one separately. Larger chunks keep those
+    // changes few, but there is no point in asking for more than the cheap
+    // orders as the direct map gets split for them anyway.
+    //
+    if (os_sev_enabled && (at->dev != NULL))
+        return NV_SYSMEM_CHUNK_ORDER;
+
+    if (NVreg_EnableHugeSysmemAllocations)
+        order = max(order, (unsigned int)NV_SYSMEM_HUGE_ORDER);
+
+#if defined(MAX_ORDER)
+    order = min(order, (unsigned int)(MAX_ORDER - 1));
+#endif
+
+    return order;
+}
+
+/*
+ * Point at->page_table[index] and the (1 << order) - 1 entries that follow it
+ * at the pages of the chunk at virt_addr/phys_addr. bus_addr is only used for
+ * chunks from dma_alloc_coherent().
+ */
+static void nv_fill_system_page_chunk(
+    nv_alloc_t *at,
+    NvU32 index,
+    unsigned int order,
+    unsigned long virt_addr,
+    NvU64 phys_addr,
+    dma_addr_t bus_addr
+)
+{
+    nvidia_pte_t *page_ptr;
+    struct device *dev = at->dev;
+    NvU32 i;
+
+    for (i = 0; i < (1U << order); i++)
+    {
+        page_ptr = at->page_table[index + i];
+        page_ptr->phys_addr = phys_addr + i * PAGE_SIZE;
+        page_ptr->page_count = NV_GET_PAGE_COUNT(page_ptr);
+        page_ptr->virt_addr = virt_addr + i * PAGE_SIZE;
+        page_ptr->coherent_pages = 0;
+
+        //
+        // Use unencrypted dma_addr returned by dma_alloc_coherent() as
+        // nv_phys_to_dma() returns encrypted dma_addr when AMD SEV is enabled.
+        //
+        if (at->flags.coherent)
+            page_ptr->dma_addr = bus_addr + i * PAGE_SIZE;
+        else if (dev)
+            page_ptr->dma_addr = nv_phys_to_dma(dev, page_ptr->phys_addr);
+        else
+            page_ptr->dma_addr = page_ptr->phys_addr;
+
+        NV_MAYBE_RESERVE_PAGE(page_ptr);
+    }
+
+    if (at->flags.coherent)
+        at->page_table[index]->coherent_pages = 1U << order;
+    else if (order > 0)
+        at->flags.compound = NV_TRUE;
+}
+
+/*
+ * Get a chunk of (1 << order) pages from dma_alloc_coherent(), which returns
+ * unencrypted memory when AMD SEV is enabled.
+ */
+static unsigned long nv_alloc_coherent_page_chunk(
+    nv_alloc_t *at,
+    unsigned int gfp_mask,
+    unsigned int order,
+    dma_addr_t *bus_addr
+)
+{
+    at->flags.coherent = NV_TRUE;
+    at->flags.unencrypted = NV_TRUE;
+
+    return (unsigned long)dma_alloc_coherent(at->dev, PAGE_SIZE << order,
+                                             bus_addr, gfp_mask);
+}
+
+/*
+ * Back at->page_table[index] and the (1 << order) - 1 entries that follow it
+ * with a single compound page. Failing to get one is expected under
+ * fragmentation, so don't try hard and let the caller fall back to a lower
+ * order.
+ */
+static NV_STATUS nv_alloc_system_page_chunk(
+    nv_alloc_t *at,
+    unsigned int gfp_mask,
+    NvU32 index,
+    unsigned int order
+)
+{
+    unsigned long virt_addr = 0;
+    NvU64 phys_addr;
+    dma_addr_t bus_addr = 0;
+
+#if defined(__GFP_RETRY_MAYFAIL)
+    gfp_mask &= ~__GFP_RETRY_MAYFAIL;
+#endif
+#if defined(__GFP_NORETRY)
+    gfp_mask |= __GFP_NORETRY;
+#endif
+    gfp_mask |= __GFP_NOWARN;
+
+    if (os_sev_enabled && (at->dev != NULL))
+    {
+        virt_addr = nv_alloc_coherent_page_chunk(at, gfp_mask, order, &bus_addr);
+    }
+    else if (nv_alloc_get_node(at) != NUMA_NO_NODE)
+    {
+        NV_ALLOC_PAGES_NODE(virt_addr, nv_alloc_get_node(at), order,
+                            gfp_mask | __GFP_COMP);
+    }
+    else
+    {
+        NV_GET_FREE_PAGES(virt_addr, order, gfp_mask | __GFP_COMP);
+    }
+
+    if (virt_addr == 0)
+        return NV_ERR_NO_MEMORY;
+
+#if !defined(__GFP_ZERO)
+    if (at->flags.zeroed)
+        memset((void *)virt_addr, 0, PAGE_SIZE << order);
+#endif
+
+    phys_addr = nv_get_kern_phys_address(virt_addr);
+
+    //
+    // Let the order-0 path deal with failed lookups and with the low pages
+    // it discards.
+    //
+    if ((phys_addr == 0)
+#if defined(_PAGE_NX)
+        || (((_PAGE_NX & pgprot_val(PAGE_KERNEL)) != 0) &&
+            (phys_addr < 0x400000))
+#endif
+       )
+    {
+        if (at->flags.coherent)
+        {
+            dma_free_coherent(at->dev, PAGE_SIZE << order, (void *)virt_addr,
+                              bus_addr);
+        }
+        else
+        {
+            NV_FREE_PAGES(virt_addr, order);
+        }
+        return NV_ERR_NO_MEMORY;
+    }
+
+    nv_fill_system_page_chunk(at, index, order, virt_addr, phys_addr, bus_addr);
+
+    return NV_OK;
+}
+
+static unsigned int nv_get_system_page_order(
+    nv_alloc_t *at,
+    nvidia_pte_t *page_ptr
+)
+{
+    struct page *page = NV_GET_PAGE_STRUCT(page_ptr->phys_addr);
+
+    if (at->flags.compound && PageHead(page))
+        return compound_order(page);
+
+    return 0;
+}
+
+/*
+ * Free the num_pages pages of at->page_table starting at index first. The
+ * range must not start or end in the middle of a compound page allocated by
+ * nv_alloc_system_page_chunk().
+ */
+static void nv_free_system_page_range(
+    nv_alloc_t *at,
+    NvU32 first,
+    NvU32 num_pages
+)
+{
+    nvidia_pte_t *page_ptr;
+    struct device *dev = at->dev;
+    unsigned int order;
+    NvU32 i;
+
+    for (i = first; i < first + num_pages; i++)
+    {
+        page_ptr = at->page_table[i];
+
+        if (at->flags.coherent)
+        {
+            dma_free_coherent(dev, page_ptr->coherent_pages * PAGE_SIZE,
+                              (void *)page_ptr->virt_addr, page_ptr->dma_addr);
+            i += page_ptr->coherent_pages - 1;
+        }
+        else
+        {
+            order = nv_get_system_page_order(at, page_ptr);
+            NV_FREE_PAGES(page_ptr->virt_addr, order);
+            i += (1U << order) - 1;
+        }
+    }
+}
+
+/*
+ * Pool of chunks whose kernel mapping has already been switched to
+ * NV_MEMORY_UNCACHED. Non-cached allocations are served from it first and
+ * return their chunks to it when freed, so that the cache attribute changes,
+ * and the TLB shootdowns and cache flushes that come with them, mostly stay
+ * off the allocation and free paths. The pool holds at most
+ * NVreg_UncachedSysmemPoolSize MB.
+ */
+static struct
+{
+    nv_spinlock_t lock;
+
+    // Chunks of each order, linked through the lru field of their head page
+    struct list_head chunks[NV_SYSMEM_HUGE_ORDER + 1];
+
+    NvU64 num_pages;
+} nv_uc_pool;
+
+static NvBool nv_uc_pool_enabled(
+    nv_alloc_t *at
+)
+{
+    if (NVreg_UncachedSysmemPoolSize == 0)
+        return NV_FALSE;
+
+    if (at->cache_type == NV_MEMORY_CACHED)
+        return NV_FALSE;
+
+    // dma_alloc_coherent() pages are never converted
+    return !(os_sev_enabled && (at->dev != NULL));
+}
+
+/*
+ * Fill at->page_table from index 0 with chunks from the pool and return the
+ * number of pages filled. These pages are already NV_MEMORY_UNCACHED.
+ */
+static NvU32 nv_uc_pool_get(
+    nv_alloc_t *at,
+    unsigned int gfp_mask
+)
+{
+    struct page *page;
+    unsigned long virt_addr;
+    NvU32 num_pages = 0;
+    int order;
+
+    if (!nv_uc_pool_enabled(at))
+        return 0;
+
+    // The pool's pages come from any node and zone
+    if (at->flags.node0)
+        return 0;
+#if defined(__GFP_DMA32)
+    if (gfp_mask & __GFP_DMA32)
+        return 0;
+#endif
+
+    for (order = ARRAY_SIZE(nv_uc_pool.chunks) - 1; order >= 0; order--)
+    {
+        while ((1U << order) <= (at->num_pages - num_pages))
+        {
+            NV_SPIN_LOCK(&nv_uc_pool.lock);
+            page = list_first_entry_or_null(&nv_uc_pool.chunks[order],
+                                            struct page, lru);
+            if (page != NULL)
+            {
+                list_del(&page->lru);
+                nv_uc_pool.num_pages -= 1U << order;
+            }
+            NV_SPIN_UNLOCK(&nv_uc_pool.lock);
+
+            if (page == NULL)
+                break;
+
+            virt_addr = (unsigned long)page_address(page);
+            if (at->flags.zeroed)
+                memset((void *)virt_addr, 0, PAGE_SIZE << order);
+
+            nv_fill_system_page_chunk(at, num_pages, order, virt_addr,
+                                      nv_get_kern_phys_address(virt_addr));
+            num_pages += 1U << order;
+        }
+    }
+
+    return num_pages;
+}
+
+/*
+ * Move chunks from the first num_pages pages of at->page_table to the pool
+ * while it has room, and return the number of pages moved. The pages must be
+ * NV_MEMORY_UNCACHED and no longer reserved.
+ */
+static NvU32 nv_uc_pool_put(
+    nv_alloc_t *at,
+    NvU32 num_pages
+)
+{
+    NvU64 max_pages = ((NvU64)NVreg_UncachedSysmemPoolSize << 20) >> PAGE_SHIFT;
+    nvidia_pte_t *page_ptr;
+    unsigned int order;
+    NvU32 i = 0;
+
+    if (!nv_uc_pool_enabled(at))
+        return 0;
+
+    NV_SPIN_LOCK(&nv_uc_pool.lock);
+
+    while (i < num_pages)
+    {
+        page_ptr = at->page_table[i];
+        order = nv_get_system_page_order(at, page_ptr);
+
+        if ((order >= ARRAY_SIZE(nv_uc_pool.chunks)) ||
+            ((nv_uc_pool.num_pages + (1U << order)) > max_pages))
+        {
+            break;
+        }
+
+        list_add(&NV_GET_PAGE_STRUCT(page_ptr->phys_addr)->lru,
+                 &nv_uc_pool.chunks[order]);
+        nv_uc_pool.num_pages += 1U << order;
+        i += 1U << order;
+    }
+
+    NV_SPIN_UNLOCK(&nv_uc_pool.lock);
+
+    return i;
+}
+
+void nv_vm_init(void)
+{
+    unsigned int order;
+
+    NV_SPIN_LOCK_INIT(&nv_uc_pool.lock);
+
+    for (order = 0; order < ARRAY_SIZE(nv_uc_pool.chunks); order++)
+        INIT_LIST_HEAD(&nv_uc_pool.chunks[order]);
+}
+
+void nv_vm_exit(void)
+{
+    struct page *page, *next;
+    nvidia_pte_t pte;
+    unsigned long virt_addr;
+    unsigned int order;
+
+    memset(&pte, 0, sizeof(pte));
+
+    for (order = 0; order < ARRAY_SIZE(nv_uc_pool.chunks); order++)
+    {
+        list_for_each_entry_safe(page, next, &nv_uc_pool.chunks[order], lru)
+        {
+            list_del(&page->lru);
+
+            virt_addr = (unsigned long)page_address(page);
+            pte.phys_addr = nv_get_kern_phys_address(virt_addr);
+            nv_set_contig_memory_type(&pte, 1U << order, NV_MEMORY_WRITEBACK);
+            NV_FREE_PAGES(virt_addr, order);
+        }
+    }
+
+    nv_uc_pool.num_pages = 0;
+}
+
 NV_STATUS nv_alloc_system_pages(
     nv_state_t *nv,
     nv_alloc_t *at
@@ -508,30 +933,44 @@ NV_STATUS nv_alloc_system_pages(
     NvU64 phys_addr;
     struct device *dev = at->dev;
     dma_addr_t bus_addr;
+    unsigned int order;
+    NvU32 num_pooled, num_returned;
 
     nv_printf(NV_DBG_MEMINFO,
             "NVRM: VM: %u: %u pages\n", __FUNCTION__, at->num_pages);
 
     gfp_mask = nv_compute_gfp_mask(nv, at);
+    order = nv_get_system_pages_max_order(at);
 
-    for (i = 0; i < at->num_pages; i++)
+    num_pooled = nv_uc_pool_get(at, gfp_mask);
+
+    for (i = num_pooled; i < at->num_pages; i++)
     {
+        //
+        // Use the highest order that fits in the remaining pages and that the
+        // kernel can still provide. The order only ever goes down, so once
+        // the kernel runs out of large pages we stop asking for them.
+        //
+        while ((order > 0) &&
+               (((1U << order) > (at->num_pages - i)) ||
+                (nv_alloc_system_page_chunk(at, gfp_mask, i, order) != NV_OK)))
+        {
+            order--;
+        }
+
+        if (order > 0)
+        {
+            i += (1U << order) - 1;
+            continue;
+        }
+
         if (os_sev_enabled && (dev != NULL))
         {
-            virt_addr = (unsigned long)dma_alloc_coherent(dev,
-                                                          PAGE_SIZE,
-                                                          &bus_addr,
-                                                          gfp_mask);
-            at->flags.coherent = NV_TRUE;
-            //
-            // dma_alloc_coherent() allocates unencrypted memory when AMD SEV
-            // is enabled.
-            //
-            at->flags.unencrypted = NV_TRUE;
+            virt_addr = nv_alloc_coherent_page_chunk(at, gfp_mask, 0, &bus_addr);
         }
-        else if (at->flags.node0)
+        else if (nv_alloc_get_node(at) != NUMA_NO_NODE)
         {
-            NV_ALLOC_PAGES_NODE(virt_addr, 0, 0, gfp_mask);
+            NV_ALLOC_PAGES_NODE(virt_addr, nv_alloc_get_node(at), 0, gfp_mask);
         }
         else
         {
@@ -577,6 +1016,7 @@ NV_STATUS nv_alloc_system_pages(
         page_ptr->phys_addr = phys_addr;
         page_ptr->page_count = NV_GET_PAGE_COUNT(page_ptr);
         page_ptr->virt_addr = virt_addr;
+        page_ptr->coherent_pages = at->flags.coherent ? 1 : 0;
 
         //
         // Use unencrypted dma_addr returned by dma_alloc_coherent() as
@@ -593,29 +1033,25 @@ NV_STATUS nv_alloc_system_pages(
     }
 
     if (at->cache_type != NV_MEMORY_CACHED)
-        nv_set_memory_type(at, NV_MEMORY_UNCACHED);
+    {
+        nv_set_memory_type(at, num_pooled, at->num_pages - num_pooled,
+                           NV_MEMORY_UNCACHED);
+    }
 
     return NV_OK;
 
 failed:
-    if (i > 0)
+    for (j = 0; j < i; j++)
     {
-        for (j = 0; j < i; j++)
-        {
-            page_ptr = at->page_table[j];
-            NV_MAYBE_UNRESERVE_PAGE(page_ptr);
-            if (at->flags.coherent)
-            {
-                dma_free_coherent(dev, PAGE_SIZE, (void *)page_ptr->virt_addr,
-                                  page_ptr->dma_addr);
-            }
-            else
-            {
-                NV_FREE_PAGES(page_ptr->virt_addr, 0);
-            }
-        }
+        page_ptr = at->page_table[j];
+        NV_MAYBE_UNRESERVE_PAGE(page_ptr);
     }
 
+    num_returned = nv_uc_pool_put(at, num_pooled);
+    nv_set_memory_type(at, num_returned, num_pooled - num_returned,
+                       NV_MEMORY_WRITEBACK);
+    nv_free_system_page_range(at, num_returned, i - num_returned);
+
     return status;
 }
 
@@ -625,14 +1061,11 @@ void nv_free_system_pages(
 {
     nvidia_pte_t *page_ptr;
     unsigned int i;
-    struct device *dev = at->dev;
+    NvU32 num_pooled;
 
     nv_printf(NV_DBG_MEMINFO,
             "NVRM: VM: %s: %u pages\n", __FUNCTION__, at->num_pages);
 
-    if (at->cache_type != NV_MEMORY_CACHED)
-        nv_set_memory_type(at, NV_MEMORY_WRITEBACK);
-
     for (i = 0; i < at->num_pages; i++)
     {
         page_ptr = at->page_table[i];
@@ -650,16 +1083,50 @@ void nv_free_system_pages(
         }
 
         NV_MAYBE_UNRESERVE_PAGE(page_ptr);
-        if (at->flags.coherent)
-        {
-            dma_free_coherent(dev, PAGE_SIZE, (void *)page_ptr->virt_addr,
-                              page_ptr->dma_addr);
-        }
-        else
-        {
-            NV_FREE_PAGES(page_ptr->virt_addr, 0);
-        }
     }
+
+    num_pooled = nv_uc_pool_put(at, at->num_pages);
+
+    if (at->cache_type != NV_MEMORY_CACHED)
+    {
+        nv_set_memory_type(at, num_pooled, at->num_pages - num_pooled,
+                           NV_MEMORY_WRITEBACK);
+    }
+
+    nv_free_system_page_range(at, num_pooled, at->num_pages - num_pooled);
+}
+
+/*
+ * Physically contiguous, cached pages are already mapped by the kernel's
+ * direct map, which uses the largest page size the CPU supports. Returns the
+ * direct map address of such pages so callers can use it instead of building
+ * a vmap() mapping out of 4K PTEs, or 0 if the pages don't qualify.
+ */
+static NvUPtr nv_vm_map_pages_direct(
+    struct page **pages,
+    NvU32 count,
+    NvBool cached,
+    NvBool unencrypted
+)
+{
+    unsigned long pfn;
+    NvU32 i;
+
+    /* The direct map is cached, and encrypted when memory encryption is on */
+    if (!cached || unencrypted)
+        return 0;
+
+    if (PageHighMem(pages[0]))
+        return 0;
+
+    pfn = page_to_pfn(pages[0]);
+    for (i = 1; i < count; i++)
+    {
+        if (page_to_pfn(pages[i]) != pfn + i)
+            return 0;
+    }
+
+    return (NvUPtr)page_address(pages[0]);
 }
 
 NvUPtr nv_vm_map_pages(
@@ -680,6 +1147,10 @@ NvUPtr nv_vm_map_pages(
         return virt_addr;
     }
 
+    virt_addr = nv_vm_map_pages_direct(pages, count, cached, unencrypted);
+    if (virt_addr != 0)
+        return virt_addr;
+
     virt_addr = nv_vmap(pages, count, cached, unencrypted);
     return virt_addr;
 }
@@ -698,6 +1169,10 @@ void nv_vm_unmap_pages(
         return;
     }
 
+    /* Mappings handed out by nv_vm_map_pages_direct() need no teardown */
+    if (!is_vmalloc_addr((void *)virt_addr))
+        return;
+
     nv_vunmap(virt_addr, count);
 }
 
@@ -48,6 +48,7 @@
 #include "nv-rsync.h"
 #include "nv-kthread-q.h"
 #include "nv-pat.h"
+#include "nv-hash.h"
 
 #if !defined(CONFIG_RETPOLINE)
 #include "nv-retpoline.h"
@@ -105,12 +106,31 @@ NvU32 num_probed_nv_devices = 0;
 
 nv_linux_state_t *nv_linux_devices;
 
+/*
+ * Lookup tables for nv_linux_devices, protected by nv_linux_devices_lock.
+ * gpu_id never changes once a device is on the list, so the gpu_id table is
+ * maintained by nv_linux_add_device_locked() and
+ * nv_linux_remove_device_locked(). Minor numbers are assigned by the
+ * frontend after the device is added, so the minor table is a cache filled
+ * by find_minor() and checked against nvl->minor_num on use.
+ */
+static NV_DECLARE_HASHTABLE(nv_linux_devices_by_gpu_id, 5);
+static nv_linux_state_t *nv_linux_devices_by_minor[NV_FRONTEND_CONTROL_DEVICE_MINOR_MIN + 1];
+
 /*
  * And one for the control device
  */
 nv_linux_state_t nv_ctl_device = { { 0 } };
 
-nv_kthread_q_t nv_kthread_q;
+struct os_work_queue nv_work_queue;
+
+/*
+ * With NVreg_CoalesceRcTimers, the RC watchdog of every device on
+ * nv_rc_timer_list runs from this timer, see nv_start_rc_timer().
+ */
+static struct nv_timer nv_rc_timer;
+static struct list_head nv_rc_timer_list;
+static spinlock_t nv_rc_timer_lock;
 nv_kthread_q_t nv_deferred_close_kthread_q;
 
 struct rw_semaphore nv_system_pm_lock;
@@ -174,6 +194,7 @@ static irqreturn_t   nvidia_isr_common_bh   (void *);
 static void          nvidia_isr_bh_unlocked (void *);
 static int           nvidia_ctl_open        (struct inode *, struct file *);
 static int           nvidia_ctl_close       (struct inode *, struct file *);
+static void          nv_rc_timer_callback   (struct nv_timer *);
 
 const char *nv_device_name = MODULE_NAME;
 static const char *nvidia_stack_cache_name = MODULE_NAME "_stack_cache";
@@ -283,8 +304,10 @@ nv_alloc_t *nvos_create_alloc(
 {
     nv_alloc_t *at;
     unsigned int pt_size, i;
+    int node = (dev != NULL) ? dev_to_node(dev) : NUMA_NO_NODE;
 
-    NV_KMALLOC(at, sizeof(nv_alloc_t));
+    /* Keep the tracking structures on the same node as the device */
+    NV_KMALLOC_NODE(at, sizeof(nv_alloc_t), node);
     if (at == NULL)
     {
         nv_printf(NV_DBG_ERRORS, "NVRM: failed to allocate alloc info\n");
@@ -308,7 +331,7 @@ nv_alloc_t *nvos_create_alloc(
 
     for (i = 0; i < at->num_pages; i++)
     {
-        at->page_table[i] = NV_KMEM_CACHE_ALLOC(nvidia_pte_t_cache);
+        at->page_table[i] = NV_KMEM_CACHE_ALLOC_NODE(nvidia_pte_t_cache, node);
         if (at->page_table[i] == NULL)
         {
             nv_printf(NV_DBG_ERRORS,
@@ -354,6 +377,10 @@ nv_module_resources_exit(nv_stack_t *sp)
 {
     nv_kmem_cache_free_stack(sp);
 
+    nv_vm_exit();
+
+    nv_os_alloc_caches_exit();
+
     NV_KMEM_CACHE_DESTROY(nvidia_p2p_page_t_cache);
     NV_KMEM_CACHE_DESTROY(nvidia_pte_t_cache);
     NV_KMEM_CACHE_DESTROY(nvidia_stack_t_cache);
@@ -364,6 +391,10 @@ nv_module_resources_init(nv_stack_t **sp)
 {
     int rc = -ENOMEM;
 
+    nv_vm_init();
+
+    nv_os_alloc_caches_init();
+
     nvidia_stack_t_cache = NV_KMEM_CACHE_CREATE(nvidia_stack_cache_name,
                                                 nvidia_stack_t);
     if (nvidia_stack_t_cache == NULL)
@@ -402,6 +433,8 @@ exit:
     {
         nv_kmem_cache_free_stack(*sp);
 
+        nv_os_alloc_caches_exit();
+
         NV_KMEM_CACHE_DESTROY(nvidia_p2p_page_t_cache);
         NV_KMEM_CACHE_DESTROY(nvidia_pte_t_cache);
         NV_KMEM_CACHE_DESTROY(nvidia_stack_t_cache);
@@ -477,7 +510,9 @@ nv_module_state_exit(nv_stack_t *sp)
     nv_teardown_pat_support();
 
     nv_kthread_q_stop(&nv_deferred_close_kthread_q);
-    nv_kthread_q_stop(&nv_kthread_q);
+    nv_os_work_queue_stop(&nv_work_queue);
+
+    del_timer_sync(&nv_rc_timer.kernel_timer);
 
     nv_lock_destroy_locks(sp, nv);
 }
@@ -495,7 +530,7 @@ nv_module_state_init(nv_stack_t *sp)
         return -ENOMEM;
     }
 
-    rc = nv_kthread_q_init(&nv_kthread_q, "nv_queue");
+    rc = nv_os_work_queue_init(&nv_work_queue, NV_KTHREAD_NO_NODE);
     if (rc != 0)
     {
         goto exit;
@@ -504,7 +539,7 @@ nv_module_state_init(nv_stack_t *sp)
     rc = nv_kthread_q_init(&nv_deferred_close_kthread_q, "nv_queue");
     if (rc != 0)
     {
-        nv_kthread_q_stop(&nv_kthread_q);
+        nv_os_work_queue_stop(&nv_work_queue);
         goto exit;
     }
 
@@ -512,11 +547,13 @@ nv_module_state_init(nv_stack_t *sp)
     if (rc < 0)
     {
         nv_kthread_q_stop(&nv_deferred_close_kthread_q);
-        nv_kthread_q_stop(&nv_kthread_q);
+        nv_os_work_queue_stop(&nv_work_queue);
         goto exit;
     }
 
     nv_linux_devices = NULL;
+    nv_hash_init(nv_linux_devices_by_gpu_id);
+    memset(nv_linux_devices_by_minor, 0, sizeof(nv_linux_devices_by_minor));
     NV_INIT_MUTEX(&nv_linux_devices_lock);
     init_rwsem(&nv_system_pm_lock);
 
@@ -528,6 +565,10 @@ nv_module_state_init(nv_stack_t *sp)
 
     NV_SPIN_LOCK_INIT(&nv_ctl_device.snapshot_timer_lock);
 
+    INIT_LIST_HEAD(&nv_rc_timer_list);
+    spin_lock_init(&nv_rc_timer_lock);
+    nv_timer_setup_deferrable(&nv_rc_timer, nv_rc_timer_callback);
+
 exit:
     if (rc < 0)
     {
@@ -807,6 +848,15 @@ int __init nvidia_init_module(void)
         goto module_exit;
     }
 
+    //
+    // With asynchronous probing, pci_register_driver() returns before the
+    // probes complete. Wait for them before checking their results below.
+    //
+    if (NVreg_EnableAsyncProbe)
+    {
+        wait_for_device_probe();
+    }
+
     if (num_probed_nv_devices != count)
     {
         nv_printf(NV_DBG_ERRORS,
@@ -917,12 +967,32 @@ static void *nv_alloc_file_private(void)
     {
         NV_INIT_MUTEX(&nvlfp->fops_sp_lock[i]);
     }
+    NV_SPIN_LOCK_INIT(&nvlfp->ioctl_sp_pool.lock);
     init_waitqueue_head(&nvlfp->waitqueue);
     NV_SPIN_LOCK_INIT(&nvlfp->fp_lock);
 
     return nvlfp;
 }
 
+/*
+ * Free the stacks in the file's ioctl stack pool. All ioctls on the file must
+ * have returned, so every allocated stack is idle.
+ */
+static void nv_free_ioctl_stack_pool(nv_linux_file_private_t *nvlfp)
+{
+    unsigned int i;
+
+    WARN_ON(nvlfp->ioctl_sp_pool.num_free != nvlfp->ioctl_sp_pool.num_allocated);
+
+    for (i = 0; i < nvlfp->ioctl_sp_pool.num_free; ++i)
+    {
+        nv_kmem_cache_free_stack(nvlfp->ioctl_sp_pool.free[i]);
+    }
+
+    nvlfp->ioctl_sp_pool.num_free = 0;
+    nvlfp->ioctl_sp_pool.num_allocated = 0;
+}
+
 static void nv_free_file_private(nv_linux_file_private_t *nvlfp)
 {
     nvidia_event_t *nvet;
@@ -958,18 +1028,34 @@ static int nv_is_control_device(
  */
 static nv_linux_state_t *find_minor(NvU32 minor)
 {
-    nv_linux_state_t *nvl;
+    nv_linux_state_t *nvl = NULL;
 
     LOCK_NV_LINUX_DEVICES();
-    nvl = nv_linux_devices;
-    while (nvl != NULL)
+
+    if (minor < ARRAY_SIZE(nv_linux_devices_by_minor))
+    {
+        nvl = nv_linux_devices_by_minor[minor];
+    }
+
+    if ((nvl == NULL) || (nvl->minor_num != minor))
     {
-        if (nvl->minor_num == minor)
+        nvl = nv_linux_devices;
+        while (nvl != NULL)
         {
-            down(&nvl->ldata_lock);
-            break;
+            if (nvl->minor_num == minor)
+                break;
+            nvl = nvl->next;
         }
-        nvl = nvl->next;
+
+        if ((nvl != NULL) && (minor < ARRAY_SIZE(nv_linux_devices_by_minor)))
+        {
+            nv_linux_devices_by_minor[minor] = nvl;
+        }
+    }
+
+    if (nvl != NULL)
+    {
+        down(&nvl->ldata_lock);
     }
 
     UNLOCK_NV_LINUX_DEVICES();
@@ -983,22 +1069,23 @@ static nv_linux_state_t *find_minor(NvU32 minor)
 static nv_linux_state_t *find_gpu_id(NvU32 gpu_id)
 {
     nv_linux_state_t *nvl;
+    nv_linux_state_t *found = NULL;
 
     LOCK_NV_LINUX_DEVICES();
-    nvl = nv_linux_devices;
-    while (nvl != NULL)
+
+    nv_hash_for_each_possible(nv_linux_devices_by_gpu_id, nvl, gpu_id_node, gpu_id)
     {
         nv_state_t *nv = NV_STATE_PTR(nvl);
         if (nv->gpu_id == gpu_id)
         {
             down(&nvl->ldata_lock);
+            found = nvl;
             break;
         }
-        nvl = nvl->next;
     }
 
     UNLOCK_NV_LINUX_DEVICES();
-    return nvl;
+    return found;
 }
 
 /*
@@ -1017,6 +1104,17 @@ nv_linux_state_t *find_uuid(const NvU8 *uuid)
     for (nvl = nv_linux_devices; nvl; nvl = nvl->next)
     {
         nv = NV_STATE_PTR(nvl);
+
+        /*
+         * A GPU's UUID never changes, so a device whose cached UUID doesn't
+         * match can be skipped without waiting for its ldata_lock, which
+         * may be held for long, e.g. while the device is being started.
+         * Check again under the lock for the one that does match.
+         */
+        dev_uuid = nv_get_cached_uuid(nv);
+        if (!dev_uuid || memcmp(dev_uuid, uuid, GPU_UUID_LEN) != 0)
+            continue;
+
         down(&nvl->ldata_lock);
         dev_uuid = nv_get_cached_uuid(nv);
         if (dev_uuid && memcmp(dev_uuid, uuid, GPU_UUID_LEN) == 0)
@@ -1446,7 +1544,8 @@ static int nv_start_device(nv_state_t *nv, nvidia_stack_t *sp)
             goto failed;
         kthread_init = NV_TRUE;
 
-        rc = nv_kthread_q_init(&nvl->queue.nvk, "nv_queue");
+        rc = nv_os_work_queue_init(&nvl->queue,
+                                   dev_to_node(&nvl->pci_dev->dev));
         if (rc)
             goto failed;
         nv->queue = &nvl->queue;
@@ -1527,7 +1626,7 @@ failed:
     if (nv->queue && !(nv->flags & NV_FLAG_PERSISTENT_SW_STATE))
     {
         nv->queue = NULL;
-        nv_kthread_q_stop(&nvl->queue.nvk);
+        nv_os_work_queue_stop(&nvl->queue);
     }
 
     if (kthread_init && !(nv->flags & NV_FLAG_PERSISTENT_SW_STATE))
@@ -1607,6 +1706,9 @@ static int nv_open_device(nv_state_t *nv, nvidia_stack_t *sp)
         return -EBUSY;
     }
 
+    // A lingering device is still open; this open takes it over.
+    nvl->idle_lingering = NV_FALSE;
+
     NV_ATOMIC_INC(nvl->usage_count);
     return 0;
 }
@@ -1616,7 +1718,7 @@ static void nv_init_mapping_revocation(nv_linux_state_t *nvl,
                                        nv_linux_file_private_t *nvlfp,
                                        struct inode *inode)
 {
-    down(&nvl->mmap_lock);
+    down_write(&nvl->mmap_lock);
 
     /* Set up struct address_space for use with unmap_mapping_range() */
     nv_address_space_init_once(&nvlfp->mapping);
@@ -1630,7 +1732,7 @@ static void nv_init_mapping_revocation(nv_linux_state_t *nvl,
     /* Add nvlfp to list of open files in nvl for mapping revocation */
     list_add(&nvlfp->entry, &nvl->open_files);
 
-    up(&nvl->mmap_lock);
+    up_write(&nvl->mmap_lock);
 }
 
 /*
@@ -1777,7 +1879,7 @@ void nv_shutdown_adapter(nvidia_stack_t *sp,
     if (nv->queue != NULL)
     {
         nv->queue = NULL;
-        nv_kthread_q_stop(&nvl->queue.nvk);
+        nv_os_work_queue_stop(&nvl->queue);
     }
 
     if (nvl->isr_bh_unlocked_mutex)
@@ -1893,6 +1995,116 @@ static void nv_stop_device(nv_state_t *nv, nvidia_stack_t *sp)
  * Decreases nvl->usage_count, stopping the device when it reaches 0. Assumes
  * nvl->ldata_lock is held.
  */
+/*
+ * Stops a lingering device whose linger time is over, or right away if
+ * 'force' is set. Assumes nvl->ldata_lock is held.
+ */
+static void nv_idle_linger_expire_locked(nv_linux_state_t *nvl,
+                                         nvidia_stack_t *sp, NvBool force)
+{
+    nv_state_t *nv = NV_STATE_PTR(nvl);
+
+    if (!nvl->idle_lingering || (NV_ATOMIC_READ(nvl->usage_count) != 0))
+        return;
+
+    // The timer was re-armed by a later close; wait for that one.
+    if (!force && time_before(jiffies, nvl->idle_linger_deadline))
+        return;
+
+    nvl->idle_lingering = NV_FALSE;
+    nv_stop_device(nv, sp);
+}
+
+static void nv_idle_linger_callback(void *args)
+{
+    nv_linux_state_t *nvl = args;
+    nvidia_stack_t *sp = NULL;
+
+    if (nv_kmem_cache_alloc_stack(&sp) != 0)
+    {
+        // Try again later rather than leaving the device started
+        mod_timer(&nvl->idle_linger_timer.kernel_timer, jiffies + HZ);
+        return;
+    }
+
+    NV_READ_LOCK_SYSTEM_PM_LOCK();
+    down(&nvl->ldata_lock);
+
+    nv_idle_linger_expire_locked(nvl, sp, NV_FALSE);
+
+    up(&nvl->ldata_lock);
+    NV_READ_UNLOCK_SYSTEM_PM_LOCK();
+
+    nv_kmem_cache_free_stack(sp);
+}
+
+static void nv_idle_linger_timer_callback(struct nv_timer *nv_timer)
+{
+    nv_linux_state_t *nvl =
+        container_of(nv_timer, nv_linux_state_t, idle_linger_timer);
+
+    nv_kthread_q_schedule_q_item(&nv_work_queue.nvk, &nvl->idle_linger_q_item);
+}
+
+void nv_idle_linger_init(nv_linux_state_t *nvl)
+{
+    nv_timer_setup(&nvl->idle_linger_timer, nv_idle_linger_timer_callback);
+    nv_kthread_q_item_init(&nvl->idle_linger_q_item, nv_idle_linger_callback,
+                           nvl);
+}
+
+/*
+ * Stops the device now if it is lingering. Assumes nvl->ldata_lock is held.
+ */
+void nv_idle_linger_end_locked(nv_linux_state_t *nvl, nvidia_stack_t *sp)
+{
+    nv_idle_linger_expire_locked(nvl, sp, NV_TRUE);
+}
+
+/*
+ * Disables lingering and stops the device if it is lingering. Called before
+ * the device is removed, without nvl->ldata_lock held.
+ */
+void nv_idle_linger_stop(nv_linux_state_t *nvl, nvidia_stack_t *sp)
+{
+    down(&nvl->ldata_lock);
+    nvl->idle_linger_disabled = NV_TRUE;
+    up(&nvl->ldata_lock);
+
+    del_timer_sync(&nvl->idle_linger_timer.kernel_timer);
+    nv_kthread_q_flush(&nv_work_queue.nvk);
+
+    down(&nvl->ldata_lock);
+    nv_idle_linger_end_locked(nvl, sp);
+    up(&nvl->ldata_lock);
+}
+
+/*
+ * Keeps the device started after its last close if lingering is enabled.
+ * Returns NV_TRUE if it does. Assumes nvl->ldata_lock is held.
+ */
+static NvBool nv_idle_linger_start_locked(nv_linux_state_t *nvl,
+                                          nvidia_stack_t *sp)
+{
+    nv_state_t *nv = NV_STATE_PTR(nvl);
+
+    if ((NVreg_GpuIdleLingerTime == 0) ||
+        nvl->idle_linger_disabled ||
+        nv->removed ||
+        NV_IS_DEVICE_IN_SURPRISE_REMOVAL(nv) ||
+        (nv->flags & (NV_FLAG_PERSISTENT_SW_STATE | NV_FLAG_UNBIND_LOCK)) ||
+        rm_get_device_remove_flag(sp, nv->gpu_id))
+    {
+        return NV_FALSE;
+    }
+
+    nvl->idle_lingering = NV_TRUE;
+    nvl->idle_linger_deadline = jiffies + NVreg_GpuIdleLingerTime * HZ;
+    mod_timer(&nvl->idle_linger_timer.kernel_timer, nvl->idle_linger_deadline);
+
+    return NV_TRUE;
+}
+
 static void nv_close_device(nv_state_t *nv, nvidia_stack_t *sp)
 {
     nv_linux_state_t *nvl = NV_GET_NVL_FROM_NV_STATE(nv);
@@ -1907,7 +2119,10 @@ static void nv_close_device(nv_state_t *nv, nvidia_stack_t *sp)
     }
 
     if (NV_ATOMIC_DEC_AND_TEST(nvl->usage_count))
-        nv_stop_device(nv, sp);
+    {
+        if (!nv_idle_linger_start_locked(nvl, sp))
+            nv_stop_device(nv, sp);
+    }
 }
 
 /*
@@ -1929,9 +2144,9 @@ nvidia_close_callback(
 
     rm_cleanup_file_private(sp, nv, &nvlfp->nvfp);
 
-    down(&nvl->mmap_lock);
+    down_write(&nvl->mmap_lock);
     list_del(&nvlfp->entry);
-    up(&nvl->mmap_lock);
+    up_write(&nvl->mmap_lock);
 
     down(&nvl->ldata_lock);
     nv_close_device(nv, sp);
@@ -1945,6 +2160,8 @@ nvidia_close_callback(
         nv_kmem_cache_free_stack(nvlfp->fops_sp[i]);
     }
 
+    nv_free_ioctl_stack_pool(nvlfp);
+
     nv_free_file_private(nvlfp);
 
     /*
@@ -2140,6 +2357,248 @@ out:
     return rc;
 }
 
+/*
+ * Fill in an nv_ioctl_gpu_status_t snapshot of all GPUs.
+ *
+ * The NUMA state of initialized GPUs has to be read from RM with the
+ * device's ldata_lock held. The lock is only tried, so that a snapshot
+ * never waits for a GPU being opened or closed; such GPUs are reported
+ * with NV_IOCTL_GPU_STATUS_FLAG_BUSY instead.
+ */
+static int nvidia_get_events(
+    nv_linux_file_private_t *nvlfp,
+    void *params,
+    size_t params_size
+)
+{
+    nv_ioctl_get_events_t *api = params;
+    nv_ioctl_event_t *events;
+    nvidia_event_t *nvet, *drained = NULL;
+    size_t num_entries;
+    unsigned long eflags;
+    NvU32 count = 0;
+
+    if (params_size < sizeof(*api))
+    {
+        return -EINVAL;
+    }
+
+    events = (nv_ioctl_event_t *)(api + 1);
+    num_entries = (params_size - sizeof(*api)) / sizeof(events[0]);
+
+    NV_SPIN_LOCK_IRQSAVE(&nvlfp->fp_lock, eflags);
+
+    while ((count < num_entries) && (nvlfp->event_data_head != NULL))
+    {
+        nvet = nvlfp->event_data_head;
+
+        events[count].hObject = nvet->event.hObject;
+        events[count].index = nvet->event.index;
+        events[count].info32 = nvet->event.info32;
+        events[count].info16 = nvet->event.info16;
+        count++;
+
+        nvlfp->event_data_head = nvet->next;
+        if (nvlfp->event_data_tail == nvet)
+            nvlfp->event_data_tail = NULL;
+
+        nvet->next = drained;
+        drained = nvet;
+    }
+
+    api->num_events = count;
+    api->more_events = (nvlfp->event_data_head != NULL);
+
+    NV_SPIN_UNLOCK_IRQRESTORE(&nvlfp->fp_lock, eflags);
+
+    while (drained != NULL)
+    {
+        nvet = drained;
+        drained = nvet->next;
+        NV_KFREE(nvet, sizeof(nvidia_event_t));
+    }
+
+    return 0;
+}
+
+static int nvidia_read_gpu_status(
+    nvidia_stack_t *sp,
+    void *params,
+    size_t params_size
+)
+{
+    nv_ioctl_gpu_status_t *status = params;
+    nv_ioctl_gpu_status_entry_t *entries;
+    nv_offline_addresses_t *offline = NULL;
+    nv_linux_state_t *nvl;
+    size_t num_entries;
+    size_t i = 0;
+    int rc = 0;
+
+    if (params_size < sizeof(*status))
+    {
+        return -EINVAL;
+    }
+
+    entries = (nv_ioctl_gpu_status_entry_t *)(status + 1);
+    num_entries = (params_size - sizeof(*status)) / sizeof(entries[0]);
+
+    if (status->version != NV_IOCTL_GPU_STATUS_VERSION)
+    {
+        rc = -EINVAL;
+    }
+
+    status->version = NV_IOCTL_GPU_STATUS_VERSION;
+    status->entry_size = sizeof(entries[0]);
+    status->num_gpus = 0;
+
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    memset(entries, 0, num_entries * sizeof(entries[0]));
+
+    NV_KMALLOC(offline, sizeof(*offline));
+    if (offline == NULL)
+    {
+        return -ENOMEM;
+    }
+
+    LOCK_NV_LINUX_DEVICES();
+
+    status->num_gpus = num_nv_devices;
+
+    if (num_entries < num_nv_devices)
+    {
+        rc = -EINVAL;
+        goto out;
+    }
+
+    for (nvl = nv_linux_devices; nvl && i < num_entries; nvl = nvl->next)
+    {
+        nv_state_t *nv = NV_STATE_PTR(nvl);
+        nv_ioctl_gpu_status_entry_t *entry = &entries[i++];
+
+        entry->pci_info       = nv->pci_info;
+        entry->gpu_id         = nv->gpu_id;
+        entry->minor_number   = nvl->minor_num;
+        entry->interrupt_line = nv->interrupt_line;
+        entry->numa_node_id   = nvl->numa_info.node_id;
+        entry->numa_status    = nv_get_numa_status(nvl);
+
+        if ((nv->flags & NV_FLAG_EXCLUDE) != 0)
+            entry->flags |= NV_IOCTL_GPU_STATUS_FLAG_EXCLUDED;
+
+        if ((nv->flags & NV_FLAG_OPEN) != 0)
+            entry->flags |= NV_IOCTL_GPU_STATUS_FLAG_INITIALIZED;
+
+        if (!nv_platform_supports_numa(nvl) ||
+            ((entry->flags & NV_IOCTL_GPU_STATUS_FLAG_INITIALIZED) == 0))
+        {
+            continue;
+        }
+
+        if (down_trylock(&nvl->ldata_lock))
+        {
+            entry->flags |= NV_IOCTL_GPU_STATUS_FLAG_BUSY;
+            continue;
+        }
+
+        if ((nv->flags & NV_FLAG_OPEN) != 0)
+        {
+            offline->numEntries = ARRAY_SIZE(offline->addresses);
+
+            if (rm_get_gpu_numa_info(sp, nv,
+                                     &entry->numa_node_id,
+                                     &entry->numa_mem_addr,
+                                     &entry->numa_mem_size,
+                                     offline->addresses,
+                                     &offline->numEntries) == NV_OK)
+            {
+                entry->num_offline_pages = offline->numEntries;
+            }
+            else
+            {
+                entry->flags |= NV_IOCTL_GPU_STATUS_FLAG_BUSY;
+            }
+        }
+        else
+        {
+            entry->flags &= ~NV_IOCTL_GPU_STATUS_FLAG_INITIALIZED;
+        }
+
+        entry->numa_status = nv_get_numa_status(nvl);
+
+        up(&nvl->ldata_lock);
+    }
+
+out:
+    UNLOCK_NV_LINUX_DEVICES();
+
+    NV_KFREE(offline, sizeof(*offline));
+
+    return rc;
+}
+
+/*
+ * Get a stack for an ioctl entering RM. The file's primary ioctl stack is used
+ * if it's idle, otherwise an idle stack from the file's pool, which is grown
+ * on demand up to NV_FOPS_IOCTL_STACK_POOL_SIZE stacks. This lets independent
+ * ioctls issued on the same file from different threads run concurrently,
+ * leaving RM's own locking to serialize them where needed. Only once the pool
+ * can't grow is the primary stack waited on.
+ */
+static nvidia_stack_t *nv_ioctl_get_stack(nv_linux_file_private_t *nvlfp)
+{
+    nvidia_stack_t *sp = NULL;
+    NvBool grow = NV_FALSE;
+
+    if (down_trylock(&nvlfp->fops_sp_lock[NV_FOPS_STACK_INDEX_IOCTL]) == 0)
+        return nvlfp->fops_sp[NV_FOPS_STACK_INDEX_IOCTL];
+
+    NV_SPIN_LOCK(&nvlfp->ioctl_sp_pool.lock);
+    if (nvlfp->ioctl_sp_pool.num_free > 0)
+    {
+        sp = nvlfp->ioctl_sp_pool.free[--nvlfp->ioctl_sp_pool.num_free];
+    }
+    else if (nvlfp->ioctl_sp_pool.num_allocated < NV_FOPS_IOCTL_STACK_POOL_SIZE)
+    {
+        nvlfp->ioctl_sp_pool.num_allocated++;
+        grow = NV_TRUE;
+    }
+    NV_SPIN_UNLOCK(&nvlfp->ioctl_sp_pool.lock);
+
+    if (sp != NULL)
+        return sp;
+
+    if (grow)
+    {
+        if (nv_kmem_cache_alloc_stack(&sp) == 0)
+            return sp;
+
+        NV_SPIN_LOCK(&nvlfp->ioctl_sp_pool.lock);
+        nvlfp->ioctl_sp_pool.num_allocated--;
+        NV_SPIN_UNLOCK(&nvlfp->ioctl_sp_pool.lock);
+    }
+
+    down(&nvlfp->fops_sp_lock[NV_FOPS_STACK_INDEX_IOCTL]);
+    return nvlfp->fops_sp[NV_FOPS_STACK_INDEX_IOCTL];
+}
+
+static void nv_ioctl_put_stack(nv_linux_file_private_t *nvlfp, nvidia_stack_t *sp)
+{
+    if (sp == nvlfp->fops_sp[NV_FOPS_STACK_INDEX_IOCTL])
+    {
+        up(&nvlfp->fops_sp_lock[NV_FOPS_STACK_INDEX_IOCTL]);
+        return;
+    }
+
+    NV_SPIN_LOCK(&nvlfp->ioctl_sp_pool.lock);
+    nvlfp->ioctl_sp_pool.free[nvlfp->ioctl_sp_pool.num_free++] = sp;
+    NV_SPIN_UNLOCK(&nvlfp->ioctl_sp_pool.lock);
+}
+
 int
 nvidia_ioctl(
     struct inode *inode,
@@ -2166,9 +2625,6 @@ nvidia_ioctl(
     if (status < 0)
         return status;
 
-    down(&nvlfp->fops_sp_lock[NV_FOPS_STACK_INDEX_IOCTL]);
-    sp = nvlfp->fops_sp[NV_FOPS_STACK_INDEX_IOCTL];
-
     rmStatus = nv_check_gpu_state(nv);
     if (rmStatus == NV_ERR_GPU_IS_LOST)
     {
@@ -2225,6 +2681,17 @@ nvidia_ioctl(
         goto done;
     }
 
+    if (arg_cmd == NV_ESC_ATTACH_GPUS_TO_FD)
+    {
+        /* Attaching GPUs updates the file's private state; keep it serialized */
+        down(&nvlfp->fops_sp_lock[NV_FOPS_STACK_INDEX_IOCTL]);
+        sp = nvlfp->fops_sp[NV_FOPS_STACK_INDEX_IOCTL];
+    }
+    else
+    {
+        sp = nv_ioctl_get_stack(nvlfp);
+    }
+
     switch (arg_cmd)
     {
         case NV_ESC_QUERY_DEVICE_INTR:
@@ -2257,6 +2724,20 @@ nvidia_ioctl(
             break;
         }
 
+        case NV_ESC_GPU_STATUS:
+        {
+            NV_CTL_DEVICE_ONLY(nv);
+
+            status = nvidia_read_gpu_status(sp, arg_copy, arg_size);
+            break;
+        }
+
+        case NV_ESC_GET_EVENTS:
+        {
+            status = nvidia_get_events(nvlfp, arg_copy, arg_size);
+            break;
+        }
+
         case NV_ESC_ATTACH_GPUS_TO_FD:
         {
             size_t num_arg_gpus = arg_size / sizeof(NvU32);
@@ -2461,7 +2942,8 @@ unlock:
     }
 
 done:
-    up(&nvlfp->fops_sp_lock[NV_FOPS_STACK_INDEX_IOCTL]);
+    if (sp != NULL)
+        nv_ioctl_put_stack(nvlfp, sp);
 
     NV_READ_UNLOCK_SYSTEM_PM_LOCK();
 
@@ -2722,12 +3204,15 @@ nvidia_isr_bh_unlocked(
     os_release_mutex(nvl->isr_bh_unlocked_mutex);
 }
 
-static void
-nvidia_rc_timer_callback(
-    struct nv_timer *nv_timer
+/*
+ * Run the RC watchdog of the device. Returns NV_FALSE if the watchdog
+ * shouldn't run again.
+ */
+static NvBool
+nvidia_rc_timer_run(
+    nv_linux_state_t *nvl
 )
 {
-    nv_linux_state_t *nvl = container_of(nv_timer, nv_linux_state_t, rc_timer);
     nv_state_t *nv = NV_STATE_PTR(nvl);
     nvidia_stack_t *sp = nvl->sp[NV_DEV_STACK_TIMER];
     NV_STATUS status;
@@ -2737,16 +3222,93 @@ nvidia_rc_timer_callback(
     {
         nv_printf(NV_DBG_INFO,
             "NVRM: GPU is lost, skipping device timer callbacks\n");
-        return;
+        return NV_FALSE;
     }
 
-    if (rm_run_rc_callback(sp, nv) == NV_OK)
+    return (rm_run_rc_callback(sp, nv) == NV_OK);
+}
+
+static void
+nvidia_rc_timer_callback(
+    struct nv_timer *nv_timer
+)
+{
+    nv_linux_state_t *nvl = container_of(nv_timer, nv_linux_state_t, rc_timer);
+
+    if (nvidia_rc_timer_run(nvl))
     {
         // set another timeout 1 sec in the future:
         mod_timer(&nvl->rc_timer.kernel_timer, jiffies + HZ);
     }
 }
 
+/*
+ * Queue the shared RC timer 1 sec in the future, on a CPU of the NUMA node
+ * of the first device on the list. nv_rc_timer_lock must be held, and the
+ * timer must not be pending.
+ *
+ * Preemption is disabled while the CPU is picked and the timer is added, so
+ * a CPU seen online can't finish going offline before the timer is on it;
+ * its timers are then migrated along with the others.
+ */
+static void
+nv_rc_timer_arm_locked(void)
+{
+    nv_linux_state_t *nvl = list_first_entry(&nv_rc_timer_list,
+                                             nv_linux_state_t,
+                                             rc_timer_list_node);
+    int node = dev_to_node(nvl->dev);
+    int cpu = get_cpu();
+
+    if (node != NUMA_NO_NODE)
+    {
+        int local_cpu = cpumask_any_and(cpumask_of_node(node), cpu_online_mask);
+
+        if (local_cpu < nr_cpu_ids)
+        {
+            cpu = local_cpu;
+        }
+    }
+
+    nv_rc_timer.kernel_timer.expires = jiffies + HZ;
+    add_timer_on(&nv_rc_timer.kernel_timer, cpu);
+
+    put_cpu();
+}
+
+/*
+ * Runs the RC watchdog of every device on nv_rc_timer_list. The lock is held
+ * throughout, so once nv_stop_rc_timer() has taken a device off the list the
+ * callback is no longer using it. A device whose watchdog shouldn't run
+ * again is taken off the list, as the per-device timer would not be
+ * re-armed in that case.
+ */
+static void
+nv_rc_timer_callback(
+    struct nv_timer *nv_timer
+)
+{
+    nv_linux_state_t *nvl, *tmp;
+
+    spin_lock(&nv_rc_timer_lock);
+
+    list_for_each_entry_safe(nvl, tmp, &nv_rc_timer_list, rc_timer_list_node)
+    {
+        if (!nvidia_rc_timer_run(nvl))
+        {
+            list_del_init(&nvl->rc_timer_list_node);
+        }
+    }
+
+    if (!list_empty(&nv_rc_timer_list) &&
+        !timer_pending(&nv_rc_timer.kernel_timer))
+    {
+        nv_rc_timer_arm_locked();
+    }
+
+    spin_unlock(&nv_rc_timer_lock);
+}
+
 /*
 ** nvidia_ctl_open
 **
@@ -2859,6 +3421,8 @@ nvidia_ctl_close(
         nv_kmem_cache_free_stack(nvlfp->fops_sp[i]);
     }
 
+    nv_free_ioctl_stack_pool(nvlfp);
+
     nv_free_file_private(nvlfp);
     NV_SET_FILE_PRIVATE(file, NULL);
 
@@ -3611,7 +4175,7 @@ NvBool nv_lock_init_locks
     nvl = NV_GET_NVL_FROM_NV_STATE(nv);
 
     NV_INIT_MUTEX(&nvl->ldata_lock);
-    NV_INIT_MUTEX(&nvl->mmap_lock);
+    init_rwsem(&nvl->mmap_lock);
 
     NV_ATOMIC_SET(nvl->usage_count, 0);
 
@@ -3853,12 +4417,29 @@ int NV_API_CALL nv_start_rc_timer(
 
     nv_printf(NV_DBG_INFO, "NVRM: initializing rc timer\n");
 
-    nv_timer_setup(&nvl->rc_timer, nvidia_rc_timer_callback);
-
     nv->rc_timer_enabled = 1;
+    nvl->rc_timer_coalesced = (NVreg_CoalesceRcTimers != 0);
+
+    if (nvl->rc_timer_coalesced)
+    {
+        spin_lock_bh(&nv_rc_timer_lock);
+
+        list_add_tail(&nvl->rc_timer_list_node, &nv_rc_timer_list);
+
+        if (!timer_pending(&nv_rc_timer.kernel_timer))
+        {
+            nv_rc_timer_arm_locked();
+        }
+
+        spin_unlock_bh(&nv_rc_timer_lock);
+    }
+    else
+    {
+        nv_timer_setup(&nvl->rc_timer, nvidia_rc_timer_callback);
 
-    // set the timeout for 1 second in the future:
-    mod_timer(&nvl->rc_timer.kernel_timer, jiffies + HZ);
+        // set the timeout for 1 second in the future:
+        mod_timer(&nvl->rc_timer.kernel_timer, jiffies + HZ);
+    }
 
     nv_printf(NV_DBG_INFO, "NVRM: rc timer initialized\n");
 
@@ -3876,7 +4457,24 @@ int NV_API_CALL nv_stop_rc_timer(
 
     nv_printf(NV_DBG_INFO, "NVRM: stopping rc timer\n");
     nv->rc_timer_enabled = 0;
-    del_timer_sync(&nvl->rc_timer.kernel_timer);
+
+    if (nvl->rc_timer_coalesced)
+    {
+        spin_lock_bh(&nv_rc_timer_lock);
+
+        list_del_init(&nvl->rc_timer_list_node);
+
+        if (list_empty(&nv_rc_timer_list))
+        {
+            del_timer(&nv_rc_timer.kernel_timer);
+        }
+
+        spin_unlock_bh(&nv_rc_timer_lock);
+    }
+    else
+    {
+        del_timer_sync(&nvl->rc_timer.kernel_timer);
+    }
     nv_printf(NV_DBG_INFO, "NVRM: rc timer stopped\n");
 
     return 0;
@@ -4054,11 +4652,11 @@ nv_restore_user_channels(
     status = rm_restart_user_channels(sp, nv);
     WARN_ON(status != NV_OK);
 
-    down(&nvl->mmap_lock);
+    down_write(&nvl->mmap_lock);
 
     nv_set_safe_to_mmap_locked(nv, NV_TRUE);
 
-    up(&nvl->mmap_lock);
+    up_write(&nvl->mmap_lock);
 
     rm_unref_dynamic_power(sp, nv, NV_DYNAMIC_PM_FINE);
 
@@ -4094,12 +4692,12 @@ nv_preempt_user_channels(
     status = rm_ref_dynamic_power(sp, nv, NV_DYNAMIC_PM_FINE);
     WARN_ON(status != NV_OK);
 
-    down(&nvl->mmap_lock);
+    down_write(&nvl->mmap_lock);
 
     nv_set_safe_to_mmap_locked(nv, NV_FALSE);
     nv_revoke_gpu_mappings_locked(nv);
 
-    up(&nvl->mmap_lock);
+    up_write(&nvl->mmap_lock);
 
     status = rm_stop_user_channels(sp, nv);
     WARN_ON(status != NV_OK);
@@ -4228,13 +4826,161 @@ done:
     return status;
 }
 
+typedef NV_STATUS (*nv_device_pm_func_t)(nv_linux_state_t *nvl, nv_pm_action_t pm_action);
+
+typedef struct
+{
+    nv_kthread_q_t q;
+    nv_kthread_q_item_t q_item;
+    NvBool q_initialized;
+    nv_linux_state_t *nvl;
+    nv_pm_action_t pm_action;
+    nv_device_pm_func_t func;
+    NV_STATUS status;
+} nv_device_pm_work_t;
+
+static NV_STATUS
+nv_device_pm_preempt_user_channels(
+    nv_linux_state_t *nvl,
+    nv_pm_action_t pm_action
+)
+{
+    return nv_preempt_user_channels(NV_STATE_PTR(nvl));
+}
+
+static NV_STATUS
+nv_device_pm_restore_user_channels(
+    nv_linux_state_t *nvl,
+    nv_pm_action_t pm_action
+)
+{
+    return nv_restore_user_channels(NV_STATE_PTR(nvl));
+}
+
+static NV_STATUS
+nv_device_pm_suspend(
+    nv_linux_state_t *nvl,
+    nv_pm_action_t pm_action
+)
+{
+    return nvidia_suspend(nvl->dev, pm_action, NV_TRUE);
+}
+
+static NV_STATUS
+nv_device_pm_resume(
+    nv_linux_state_t *nvl,
+    nv_pm_action_t pm_action
+)
+{
+    return nvidia_resume(nvl->dev, pm_action);
+}
+
+static void
+nv_device_pm_work(
+    void *args
+)
+{
+    nv_device_pm_work_t *work = args;
+
+    work->status = work->func(work->nvl, work->pm_action);
+    WARN_ON(work->status != NV_OK);
+}
+
+/*
+ * Run func on each device, and return the first failure. Devices are
+ * transitioned one after the other, stopping at the first failure if
+ * stop_on_error is set, unless NVreg_EnableParallelDevicePowerManagement is
+ * set. In that case all devices are transitioned concurrently, each on its own
+ * temporary kthread. If a kthread can't be created, that device is transitioned
+ * inline instead.
+ *
+ * The caller must hold the nv_linux_devices lock.
+ */
+static NV_STATUS
+nv_for_each_device_pm(
+    nv_device_pm_func_t func,
+    nv_pm_action_t pm_action,
+    NvBool stop_on_error
+)
+{
+    nv_linux_state_t *nvl;
+    nv_device_pm_work_t *work = NULL;
+    NV_STATUS status = NV_OK;
+    NvU32 num_devices = 0;
+    NvU32 i;
+
+    for (nvl = nv_linux_devices; nvl != NULL; nvl = nvl->next)
+    {
+        num_devices++;
+    }
+
+    if (NVreg_EnableParallelDevicePowerManagement && (num_devices > 1))
+    {
+        NV_KMALLOC(work, num_devices * sizeof(*work));
+    }
+
+    if (work == NULL)
+    {
+        for (nvl = nv_linux_devices; nvl != NULL && (status == NV_OK || !stop_on_error); nvl = nvl->next)
+        {
+            NV_STATUS device_status = func(nvl, pm_action);
+
+            WARN_ON(device_status != NV_OK);
+            if (status == NV_OK)
+            {
+                status = device_status;
+            }
+        }
+
+        return status;
+    }
+
+    memset(work, 0, num_devices * sizeof(*work));
+
+    for (nvl = nv_linux_devices, i = 0; nvl != NULL; nvl = nvl->next, i++)
+    {
+        work[i].nvl = nvl;
+        work[i].pm_action = pm_action;
+        work[i].func = func;
+
+        nv_kthread_q_item_init(&work[i].q_item, nv_device_pm_work, &work[i]);
+
+        if (nv_kthread_q_init(&work[i].q, "nv_pm") == 0)
+        {
+            work[i].q_initialized = NV_TRUE;
+            nv_kthread_q_schedule_q_item(&work[i].q, &work[i].q_item);
+        }
+        else
+        {
+            nv_device_pm_work(&work[i]);
+        }
+    }
+
+    for (i = 0; i < num_devices; i++)
+    {
+        // Stopping the queue flushes the pending item first
+        if (work[i].q_initialized)
+        {
+            nv_kthread_q_stop(&work[i].q);
+        }
+
+        if (status == NV_OK)
+        {
+            status = work[i].status;
+        }
+    }
+
+    NV_KFREE(work, num_devices * sizeof(*work));
+
+    return status;
+}
+
 static NV_STATUS
 nv_resume_devices(
     nv_pm_action_t pm_action,
     nv_pm_action_depth_t pm_action_depth
 )
 {
-    nv_linux_state_t *nvl;
     NvBool resume_devices = NV_TRUE;
     NV_STATUS status;
 
@@ -4248,29 +4994,21 @@ nv_resume_devices(
         resume_devices = NV_FALSE;
     }
 
-    LOCK_NV_LINUX_DEVICES();
-
-    for (nvl = nv_linux_devices; nvl != NULL; nvl = nvl->next)
+    if (resume_devices)
     {
-        if (resume_devices)
-        {
-            status = nvidia_resume(nvl->dev, pm_action);
-            WARN_ON(status != NV_OK);
-        }
-    }
+        LOCK_NV_LINUX_DEVICES();
 
-    UNLOCK_NV_LINUX_DEVICES();
+        nv_for_each_device_pm(nv_device_pm_resume, pm_action, NV_FALSE);
+
+        UNLOCK_NV_LINUX_DEVICES();
+    }
 
     status = nv_uvm_resume();
     WARN_ON(status != NV_OK);
 
     LOCK_NV_LINUX_DEVICES();
 
-    for (nvl = nv_linux_devices; nvl != NULL; nvl = nvl->next)
-    {
-        status = nv_restore_user_channels(NV_STATE_PTR(nvl));
-        WARN_ON(status != NV_OK);
-    }
+    nv_for_each_device_pm(nv_device_pm_restore_user_channels, pm_action, NV_FALSE);
 
     UNLOCK_NV_LINUX_DEVICES();
 
@@ -4299,11 +5037,7 @@ nv_suspend_devices(
 
     LOCK_NV_LINUX_DEVICES();
 
-    for (nvl = nv_linux_devices; nvl != NULL && status == NV_OK; nvl = nvl->next)
-    {
-        status = nv_preempt_user_channels(NV_STATE_PTR(nvl));
-        WARN_ON(status != NV_OK);
-    }
+    status = nv_for_each_device_pm(nv_device_pm_preempt_user_channels, pm_action, NV_TRUE);
 
     UNLOCK_NV_LINUX_DEVICES();
 
@@ -4324,11 +5058,7 @@ nv_suspend_devices(
 
     LOCK_NV_LINUX_DEVICES();
 
-    for (nvl = nv_linux_devices; nvl != NULL && status == NV_OK; nvl = nvl->next)
-    {
-        status = nvidia_suspend(nvl->dev, pm_action, NV_TRUE);
-        WARN_ON(status != NV_OK);
-    }
+    status = nv_for_each_device_pm(nv_device_pm_suspend, pm_action, NV_TRUE);
     if (status != NV_OK)
     {
         resume_devices = NV_TRUE;
@@ -5220,16 +5950,48 @@ NvBool NV_API_CALL nv_dynamic_power_available(
 #endif
 }
 
-/* caller should hold nv_linux_devices_lock using LOCK_NV_LINUX_DEVICES */
+static NvBool nv_linux_device_is_before(nv_linux_state_t *a, nv_linux_state_t *b)
+{
+    nv_pci_info_t *pa = &NV_STATE_PTR(a)->pci_info;
+    nv_pci_info_t *pb = &NV_STATE_PTR(b)->pci_info;
+
+    if (pa->domain != pb->domain)
+        return pa->domain < pb->domain;
+    if (pa->bus != pb->bus)
+        return pa->bus < pb->bus;
+    if (pa->slot != pb->slot)
+        return pa->slot < pb->slot;
+    return pa->function < pb->function;
+}
+
+/*
+ * caller should hold nv_linux_devices_lock using LOCK_NV_LINUX_DEVICES
+ *
+ * With asynchronous probing, devices are added in the order their probes
+ * complete, so they are kept sorted by PCI location instead.
+ */
 void nv_linux_add_device_locked(nv_linux_state_t *nvl)
 {
+    nv_hash_add(nv_linux_devices_by_gpu_id, &nvl->gpu_id_node,
+                NV_STATE_PTR(nvl)->gpu_id);
+
     if (nv_linux_devices == NULL) {
         nv_linux_devices = nvl;
     }
+    else if (NVreg_EnableAsyncProbe && nv_linux_device_is_before(nvl, nv_linux_devices))
+    {
+        nvl->next = nv_linux_devices;
+        nv_linux_devices = nvl;
+    }
     else
     {
         nv_linux_state_t *tnvl;
-        for (tnvl = nv_linux_devices; tnvl->next != NULL;  tnvl = tnvl->next);
+        for (tnvl = nv_linux_devices; tnvl->next != NULL;  tnvl = tnvl->next)
+        {
+            if (NVreg_EnableAsyncProbe && nv_linux_device_is_before(nvl, tnvl->next))
+                break;
+        }
+        nvl->next = tnvl->next;
         tnvl->next = nvl;
     }
 }
@@ -5237,6 +5999,14 @@ void nv_linux_add_device_locked(nv_linux_state_t *nvl)
 /* caller should hold nv_linux_devices_lock using LOCK_NV_LINUX_DEVICES */
 void nv_linux_remove_device_locked(nv_linux_state_t *nvl)
 {
+    hlist_del(&nvl->gpu_id_node);
+
+    if ((nvl->minor_num < ARRAY_SIZE(nv_linux_devices_by_minor)) &&
+        (nv_linux_devices_by_minor[nvl->minor_num] == nvl))
+    {
+        nv_linux_devices_by_minor[nvl->minor_num] = NULL;
+    }
+
     if (nvl == nv_linux_devices) {
         nv_linux_devices = nvl->next;
     }
@@ -57,6 +57,13 @@ static void setUvmEvents(struct UvmOpsUvmEvents *newEvents)
 static nvidia_stack_t *g_sp;
 static struct semaphore g_spLock;
 
+// One preallocated stack per CPU, taken and returned with this_cpu_xchg() and
+// this_cpu_cmpxchg() so the common case of nvUvmGetSafeStack neither
+// allocates nor takes a lock. An empty slot means the stack is in use, e.g. by
+// a preempted caller, and the next caller on that CPU falls back to the
+// allocating path.
+static nvidia_stack_t * __percpu *g_cpuSp;
+
 // Use these to test g_sp usage. When DEBUG_GLOBAL_STACK, one out of every
 // DEBUG_GLOBAL_STACK_THRESHOLD calls to nvUvmGetSafeStack will use g_sp.
 #define DEBUG_GLOBAL_STACK 0
@@ -64,13 +71,43 @@ static struct semaphore g_spLock;
 
 static atomic_t g_debugGlobalStackCount = ATOMIC_INIT(0);
 
+static void freeCpuStacks(void)
+{
+    int cpu;
+
+    if (g_cpuSp == NULL)
+        return;
+
+    for_each_possible_cpu(cpu)
+        nv_kmem_cache_free_stack(*per_cpu_ptr(g_cpuSp, cpu));
+
+    free_percpu(g_cpuSp);
+    g_cpuSp = NULL;
+}
+
 // Called at module load, not by an external client
 int nv_uvm_init(void)
 {
+    int cpu;
     int rc = nv_kmem_cache_alloc_stack(&g_sp);
     if (rc != 0)
         return rc;
 
+    // The per-CPU stacks are only an optimization, so failing to allocate
+    // them is not fatal.
+    g_cpuSp = alloc_percpu(nvidia_stack_t *);
+    if (g_cpuSp != NULL)
+    {
+        for_each_possible_cpu(cpu)
+        {
+            if (nv_kmem_cache_alloc_stack(per_cpu_ptr(g_cpuSp, cpu)) != 0)
+            {
+                freeCpuStacks();
+                break;
+            }
+        }
+    }
+
     NV_INIT_MUTEX(&g_spLock);
     NV_INIT_MUTEX(&g_pNvUvmEventsLock);
     return 0;
@@ -83,6 +120,7 @@ void nv_uvm_exit(void)
     // memory.
     WARN_ON(getUvmEvents() != NULL);
 
+    freeCpuStacks();
     nv_kmem_cache_free_stack(g_sp);
 }
 
@@ -101,29 +139,51 @@ static NvBool forceGlobalStack(void)
     return NV_FALSE;
 }
 
-// Guaranteed to always return a valid stack. It first attempts to allocate one
-// from the pool. If that fails, it falls back to the global pre-allocated
-// stack. This fallback will serialize.
+// Guaranteed to always return a valid stack. It first attempts to take the
+// current CPU's preallocated stack, then to allocate one from the pool. If
+// that fails, it falls back to the global pre-allocated stack. This fallback
+// will serialize.
 //
 // This is required so paths that free resources do not themselves require
 // allocation of resources.
 static nvidia_stack_t *nvUvmGetSafeStack(void)
 {
-    nvidia_stack_t *sp;
-    if (forceGlobalStack() || nv_kmem_cache_alloc_stack(&sp) != 0)
+    nvidia_stack_t *sp = NULL;
+
+    if (forceGlobalStack())
+        goto global;
+
+    if (g_cpuSp != NULL)
     {
-        sp = g_sp;
-        down(&g_spLock);
+        sp = this_cpu_xchg(*g_cpuSp, NULL);
+        if (sp != NULL)
+            return sp;
     }
+
+    if (nv_kmem_cache_alloc_stack(&sp) == 0)
+        return sp;
+
+global:
+    sp = g_sp;
+    down(&g_spLock);
     return sp;
 }
 
 static void nvUvmFreeSafeStack(nvidia_stack_t *sp)
 {
     if (sp == g_sp)
+    {
         up(&g_spLock);
-    else
-        nv_kmem_cache_free_stack(sp);
+        return;
+    }
+
+    // The caller may have migrated since nvUvmGetSafeStack, so this refills
+    // whichever CPU it runs on now if that CPU's slot is empty.
+    if ((sp != NULL) && (g_cpuSp != NULL) &&
+        (this_cpu_cmpxchg(*g_cpuSp, NULL, sp) == NULL))
+        return;
+
+    nv_kmem_cache_free_stack(sp);
 }
 
 NV_STATUS nvUvmInterfaceRegisterGpu(const NvProcessorUuid *gpuUuid, UvmGpuPlatformInfo *gpuInfo)
@@ -44,7 +44,7 @@ nv_spinlock_t nv_error_string_lock;
 
 extern nv_linux_state_t nv_ctl_device;
 
-extern nv_kthread_q_t nv_kthread_q;
+extern struct os_work_queue nv_work_queue;
 
 NvU32 os_page_size  = PAGE_SIZE;
 NvU64 os_page_mask  = NV_PAGE_MASK;
@@ -471,6 +471,141 @@ NvS32 NV_API_CALL os_mem_cmp(
 #endif
 
 #define VMALLOC_ALLOCATION_SIZE_FLAG (1 << 0)
+#define CACHE_ALLOCATION_SIZE_FLAG   (1 << 1)
+
+/*
+ * When enabled with the EnableOsAllocCaches option, small os_alloc_mem()
+ * requests, which RM makes constantly for control call parameters, are
+ * served from power-of-two sized kmem caches of our own. The slab
+ * allocator keeps per-CPU free lists for each of them, so these
+ * allocations don't compete with the rest of the kernel for the generic
+ * kmalloc caches. Allocation counts are kept per-CPU as well and are
+ * reported in /proc/driver/nvidia/alloc_caches.
+ */
+#define NV_OS_ALLOC_CACHE_MIN_SHIFT 5
+#define NV_OS_ALLOC_CACHE_MAX_SHIFT 12
+#define NV_OS_ALLOC_CACHE_COUNT \
+    (NV_OS_ALLOC_CACHE_MAX_SHIFT - NV_OS_ALLOC_CACHE_MIN_SHIFT + 1)
+
+typedef struct
+{
+    struct kmem_cache *cache;
+    unsigned int size;
+    unsigned long __percpu *allocs;
+    unsigned long __percpu *frees;
+    char name[24];
+} nv_os_alloc_cache_t;
+
+static nv_os_alloc_cache_t nv_os_alloc_caches[NV_OS_ALLOC_CACHE_COUNT];
+
+static nv_os_alloc_cache_t *nv_os_alloc_cache_get(unsigned long size)
+{
+    unsigned int shift;
+    nv_os_alloc_cache_t *entry;
+
+    if (size > (1UL << NV_OS_ALLOC_CACHE_MAX_SHIFT))
+        return NULL;
+
+    shift = max_t(unsigned int, fls_long(size - 1), NV_OS_ALLOC_CACHE_MIN_SHIFT);
+    entry = &nv_os_alloc_caches[shift - NV_OS_ALLOC_CACHE_MIN_SHIFT];
+
+    return (entry->cache != NULL) ? entry : NULL;
+}
+
+void nv_os_alloc_caches_exit(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < NV_OS_ALLOC_CACHE_COUNT; i++)
+    {
+        nv_os_alloc_cache_t *entry = &nv_os_alloc_caches[i];
+
+        NV_KMEM_CACHE_DESTROY(entry->cache);
+        entry->cache = NULL;
+
+        if (entry->allocs != NULL)
+            free_percpu(entry->allocs);
+        if (entry->frees != NULL)
+            free_percpu(entry->frees);
+        entry->allocs = NULL;
+        entry->frees = NULL;
+    }
+}
+
+void nv_os_alloc_caches_init(void)
+{
+    unsigned int i;
+
+    if (!NVreg_EnableOsAllocCaches)
+        return;
+
+    for (i = 0; i < NV_OS_ALLOC_CACHE_COUNT; i++)
+    {
+        nv_os_alloc_cache_t *entry = &nv_os_alloc_caches[i];
+
+        entry->size = 1U << (NV_OS_ALLOC_CACHE_MIN_SHIFT + i);
+        snprintf(entry->name, sizeof(entry->name), "nv_alloc_%u", entry->size);
+
+        entry->allocs = alloc_percpu(unsigned long);
+        entry->frees = alloc_percpu(unsigned long);
+        if ((entry->allocs == NULL) || (entry->frees == NULL))
+            goto failed;
+
+        entry->cache = nv_kmem_cache_create(entry->name, entry->size,
+                                            sizeof(void *));
+        if (entry->cache == NULL)
+            goto failed;
+    }
+
+    return;
+
+failed:
+    nv_printf(NV_DBG_ERRORS, "NVRM: failed to create allocation caches.\n");
+    nv_os_alloc_caches_exit();
+}
+
+NvBool nv_os_alloc_cache_get_stats(
+    unsigned int index,
+    NvU32 *size,
+    NvU64 *allocs,
+    NvU64 *frees
+)
+{
+    nv_os_alloc_cache_t *entry;
+    int cpu;
+
+    if (index >= NV_OS_ALLOC_CACHE_COUNT)
+        return NV_FALSE;
+
+    entry = &nv_os_alloc_caches[index];
+    if (entry->cache == NULL)
+        return NV_FALSE;
+
+    *size = entry->size;
+    *allocs = 0;
+    *frees = 0;
+
+    for_each_possible_cpu(cpu)
+    {
+        *allocs += *per_cpu_ptr(entry->allocs, cpu);
+        *frees += *per_cpu_ptr(entry->frees, cpu);
+    }
+
+    return NV_TRUE;
+}
+
+static void *nv_os_alloc_cache_alloc(nv_os_alloc_cache_t *entry, gfp_t gfp_mask)
+{
+    void *ptr = kmem_cache_alloc(entry->cache, gfp_mask);
+
+    if (ptr != NULL)
+    {
+        NV_MEMDBG_ADD(ptr, entry->size);
+        this_cpu_inc(*entry->allocs);
+    }
+
+    return ptr;
+}
 
 NV_STATUS NV_API_CALL os_alloc_mem(
     void **address,
@@ -478,6 +613,7 @@ NV_STATUS NV_API_CALL os_alloc_mem(
 )
 {
     unsigned long alloc_size;
+    nv_os_alloc_cache_t *entry;
 
     if (address == NULL)
         return NV_ERR_INVALID_ARGUMENT;
@@ -494,7 +630,19 @@ NV_STATUS NV_API_CALL os_alloc_mem(
     if (alloc_size != size)
         return NV_ERR_INVALID_PARAMETER;
 
-    if (!NV_MAY_SLEEP())
+    entry = nv_os_alloc_cache_get(alloc_size);
+    if (entry != NULL)
+    {
+        *address = nv_os_alloc_cache_alloc(entry,
+                                           NV_MAY_SLEEP() ? NV_GFP_NO_OOM :
+                                                            NV_GFP_ATOMIC);
+    }
+
+    if (*address != NULL)
+    {
+        alloc_size |= CACHE_ALLOCATION_SIZE_FLAG;
+    }
+    else if (!NV_MAY_SLEEP())
     {
         if (alloc_size <= KMALLOC_LIMIT)
             NV_KMALLOC_ATOMIC(*address, alloc_size);
@@ -523,7 +671,18 @@ void NV_API_CALL os_free_mem(void *address)
 
     NV_MEM_TRACKING_RETRIEVE_SIZE(address, size);
 
-    if (size & VMALLOC_ALLOCATION_SIZE_FLAG)
+    if (size & CACHE_ALLOCATION_SIZE_FLAG)
+    {
+        nv_os_alloc_cache_t *entry;
+
+        size &= ~CACHE_ALLOCATION_SIZE_FLAG;
+        entry = nv_os_alloc_cache_get(size);
+
+        NV_MEMDBG_REMOVE(address, entry->size);
+        kmem_cache_free(entry->cache, address);
+        this_cpu_inc(*entry->frees);
+    }
+    else if (size & VMALLOC_ALLOCATION_SIZE_FLAG)
     {
         size &= ~VMALLOC_ALLOCATION_SIZE_FLAG;
         nv_vfree(address, size);
@@ -996,52 +1155,133 @@ NV_STATUS NV_API_CALL os_schedule(void)
     }
 }
 
-typedef struct {
+typedef struct os_queue_data_s {
     nv_kthread_q_item_t item;
+    struct os_work_queue *queue;
     void *data;
+    struct os_queue_data_s *next;
 } os_queue_data_t;
 
-static void os_execute_work_item(void *_oqd)
+/*
+ * Preallocated work item wrappers, so that os_queue_work_item() only has to
+ * allocate (atomically) when all of them are in flight.
+ */
+#define OS_QUEUE_DATA_POOL_SIZE 64
+
+static os_queue_data_t os_queue_data_pool[OS_QUEUE_DATA_POOL_SIZE];
+static os_queue_data_t *os_queue_data_free_list;
+static nv_spinlock_t os_queue_data_pool_lock;
+
+static os_queue_data_t *os_queue_data_alloc(void)
 {
-    os_queue_data_t *oqd = _oqd;
-    nvidia_stack_t *sp = NULL;
-    void *data = oqd->data;
+    os_queue_data_t *oqd;
+    unsigned long eflags;
 
-    NV_KFREE(oqd, sizeof(os_queue_data_t));
+    NV_SPIN_LOCK_IRQSAVE(&os_queue_data_pool_lock, eflags);
+    oqd = os_queue_data_free_list;
+    if (oqd != NULL)
+        os_queue_data_free_list = oqd->next;
+    NV_SPIN_UNLOCK_IRQRESTORE(&os_queue_data_pool_lock, eflags);
 
-    if (nv_kmem_cache_alloc_stack(&sp) != 0)
+    if (oqd == NULL)
+    {
+        /* Allocate atomically just in case we're called in atomic context. */
+        NV_KMALLOC_ATOMIC(oqd, sizeof(os_queue_data_t));
+    }
+
+    return oqd;
+}
+
+static void os_queue_data_free(os_queue_data_t *oqd)
+{
+    unsigned long eflags;
+
+    if ((oqd < os_queue_data_pool) ||
+        (oqd >= os_queue_data_pool + OS_QUEUE_DATA_POOL_SIZE))
     {
+        NV_KFREE(oqd, sizeof(os_queue_data_t));
         return;
     }
 
-    rm_execute_work_item(sp, data);
+    NV_SPIN_LOCK_IRQSAVE(&os_queue_data_pool_lock, eflags);
+    oqd->next = os_queue_data_free_list;
+    os_queue_data_free_list = oqd;
+    NV_SPIN_UNLOCK_IRQRESTORE(&os_queue_data_pool_lock, eflags);
+}
 
-    nv_kmem_cache_free_stack(sp);
+int nv_os_work_queue_init(struct os_work_queue *queue, int node)
+{
+    int rc;
+    unsigned int i;
+
+    //
+    // The global queue is set up at module load, before any per-GPU queue
+    // exists and before any work item can be queued.
+    //
+    if (queue == &nv_work_queue)
+    {
+        NV_SPIN_LOCK_INIT(&os_queue_data_pool_lock);
+        os_queue_data_free_list = NULL;
+        for (i = 0; i < OS_QUEUE_DATA_POOL_SIZE; i++)
+            os_queue_data_free(&os_queue_data_pool[i]);
+    }
+
+    rc = nv_kmem_cache_alloc_stack(&queue->sp);
+    if (rc != 0)
+        return rc;
+
+    rc = nv_kthread_q_init_on_node(&queue->nvk, "nv_queue", node);
+    if (rc != 0)
+    {
+        nv_kmem_cache_free_stack(queue->sp);
+        queue->sp = NULL;
+    }
+
+    return rc;
+}
+
+void nv_os_work_queue_stop(struct os_work_queue *queue)
+{
+    nv_kthread_q_stop(&queue->nvk);
+
+    nv_kmem_cache_free_stack(queue->sp);
+    queue->sp = NULL;
+}
+
+static void os_execute_work_item(void *_oqd)
+{
+    os_queue_data_t *oqd = _oqd;
+    nvidia_stack_t *sp = oqd->queue->sp;
+    void *data = oqd->data;
+
+    os_queue_data_free(oqd);
+
+    rm_execute_work_item(sp, data);
 }
 
 NV_STATUS NV_API_CALL os_queue_work_item(struct os_work_queue *queue, void *data)
 {
     os_queue_data_t *oqd;
-    nv_kthread_q_t *kthread;
 
     /* Use the global queue unless a valid queue was provided */
-    kthread = queue ? &queue->nvk : &nv_kthread_q;
+    if (queue == NULL)
+        queue = &nv_work_queue;
 
     /* Make sure the kthread is active */
-    if (unlikely(!kthread->q_kthread)) {
+    if (unlikely(!queue->nvk.q_kthread)) {
         nv_printf(NV_DBG_ERRORS, "NVRM: queue is not enabled\n");
         return NV_ERR_NOT_READY;
     }
 
-    /* Allocate atomically just in case we're called in atomic context. */
-    NV_KMALLOC_ATOMIC(oqd, sizeof(os_queue_data_t));
+    oqd = os_queue_data_alloc();
     if (!oqd)
         return NV_ERR_NO_MEMORY;
 
     nv_kthread_q_item_init(&oqd->item, os_execute_work_item, oqd);
+    oqd->queue = queue;
     oqd->data = data;
 
-    nv_kthread_q_schedule_q_item(kthread, &oqd->item);
+    nv_kthread_q_schedule_q_item(&queue->nvk, &oqd->item);
 
     return NV_OK;
 }
@@ -1051,7 +1291,7 @@ NV_STATUS NV_API_CALL os_flush_work_queue(struct os_work_queue *queue)
     nv_kthread_q_t *kthread;
 
     /* Use the global queue unless a valid queue was provided */
-    kthread = queue ? &queue->nvk : &nv_kthread_q;
+    kthread = queue ? &queue->nvk : &nv_work_queue.nvk;
 
     if (NV_MAY_SLEEP())
     {
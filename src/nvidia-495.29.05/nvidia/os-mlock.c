@@ -211,6 +211,14 @@ done:
     return rmStatus;
 }
 
+//
+// Maximum number of pages pinned with a single get_user_pages() call. mmap_lock
+// is dropped between calls, so pinning a large buffer doesn't stall page
+// faults and mmap() calls from other threads of the process for its whole
+// duration.
+//
+#define NV_LOCK_USER_PAGES_CHUNK    (1ULL << 15)
+
 NV_STATUS NV_API_CALL os_lock_user_pages(
     void   *address,
     NvU64   page_count,
@@ -223,7 +231,7 @@ NV_STATUS NV_API_CALL os_lock_user_pages(
     struct page **user_pages;
     NvU64 i, pinned;
     NvBool write = DRF_VAL(_LOCK_USER_PAGES, _FLAGS, _WRITE, flags), force = 0;
-    int ret;
+    long ret;
 
     if (!NV_MAY_SLEEP())
     {
@@ -241,18 +249,29 @@ NV_STATUS NV_API_CALL os_lock_user_pages(
         return rmStatus;
     }
 
-    nv_mmap_read_lock(mm);
-    ret = NV_GET_USER_PAGES((unsigned long)address,
-                            page_count, write, force, user_pages, NULL);
-    nv_mmap_read_unlock(mm);
-    pinned = ret;
-
-    if (ret < 0)
+    pinned = 0;
+    while (pinned < page_count)
     {
-        os_free_mem(user_pages);
-        return NV_ERR_INVALID_ADDRESS;
+        NvU64 chunk = NV_MIN(page_count - pinned, NV_LOCK_USER_PAGES_CHUNK);
+
+        nv_mmap_read_lock(mm);
+        ret = NV_GET_USER_PAGES((unsigned long)address + (pinned << PAGE_SHIFT),
+                                chunk, write, force, &user_pages[pinned], NULL);
+        nv_mmap_read_unlock(mm);
+
+        //
+        // get_user_pages() may pin fewer pages than requested without
+        // failing, in which case the next call picks up where it stopped.
+        //
+        if (ret <= 0)
+            break;
+
+        pinned += ret;
+
+        cond_resched();
     }
-    else if (pinned < page_count)
+
+    if (pinned < page_count)
     {
         for (i = 0; i < pinned; i++)
             put_page(user_pages[i]);
@@ -272,12 +291,21 @@ NV_STATUS NV_API_CALL os_unlock_user_pages(
 {
     NvBool write = 1;
     struct page **user_pages = page_array;
-    NvU32 i;
+    struct page *dirty_head = NULL;
+    NvU64 i;
 
     for (i = 0; i < page_count; i++)
     {
-        if (write)
-            set_page_dirty_lock(user_pages[i]);
+        //
+        // get_user_pages() returns every 4K subpage of a huge page, but the
+        // dirty state is tracked on the head page. Only lock and dirty each
+        // compound page once instead of once per subpage.
+        //
+        if (write && (compound_head(user_pages[i]) != dirty_head))
+        {
+            dirty_head = compound_head(user_pages[i]);
+            set_page_dirty_lock(dirty_head);
+        }
         put_page(user_pages[i]);
     }
 